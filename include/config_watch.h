@@ -0,0 +1,67 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-supportability
+ *
+ * @file
+ * Header file for the watch of the supportability configuration files, so
+ * that a changed file is parsed again without restarting the process.
+ ***************************************************************************/
+
+#ifndef _CONFIG_WATCH_H_
+#define _CONFIG_WATCH_H_
+
+#include <time.h>
+
+#define CONFIG_WATCH_DIR         "/etc/openswitch/supportability"
+/* changes on disk are looked for at most once per interval */
+#define CONFIG_WATCH_INTERVAL    1       /* seconds */
+
+/* A configuration file compiled by its owner. The owner checks
+ * config_watch_changed() before using what it compiled, and when it returns
+ * TRUE parses the file again between config_watch_begin() and
+ * config_watch_done(). What was compiled before is only replaced once the
+ * new file parsed, so a broken file never replaces a working one. */
+struct config_watch {
+    const char *name;           /* shown by the CLI */
+    const char *path;           /* file in CONFIG_WATCH_DIR */
+    unsigned changes;           /* changes seen on disk */
+    unsigned seen;              /* changes when the last load began */
+    unsigned generation;        /* successful loads */
+    unsigned failures;          /* failed loads since the last success */
+    time_t loaded;              /* time of the last successful load */
+    struct config_watch *next;
+};
+
+#define CONFIG_WATCH_INITIALIZER(NAME, PATH) \
+    { NAME, PATH, 0, 0, 0, 0, 0, NULL }
+
+/* Returns TRUE if the file changed since the last load began */
+int config_watch_changed(struct config_watch *w);
+
+/* A load of the file begins, the changes seen so far are taken */
+void config_watch_begin(struct config_watch *w);
+
+/* A load of the file ended. Returns the generation now in use, 0 if the
+ * file never loaded. */
+unsigned config_watch_done(struct config_watch *w, int success);
+
+/* Watch after w, the first one when w is NULL. Watches are registered by
+ * their first config_watch_begin() and never removed. */
+struct config_watch *config_watch_next(const struct config_watch *w);
+
+#endif /* _CONFIG_WATCH_H_ */
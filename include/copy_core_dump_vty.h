@@ -49,13 +49,12 @@ void cli_post_init(void);
     "Specify coredump instance ID\n"
 #define KERNEL_STR \
     "Copy kernel coredump\n"
+#define ZSTD_STR \
+    "Recompress with zstd on every CPU while copying\n"
 
 #define MAX_FILE_STR_LEN        512
 #define MAX_LOG_STR_LEN         512
-#define MAX_COMMAND_STR_LEN     1024
 
-#define TFTP_NOI_SCRIPT         "/usr/bin/tftp_noi.sh"
-#define SFTP_NOI_SCRIPT         "/usr/bin/sftp_noi.sh"
 #define TFTP_STR                "tftp"
 #define SFTP_STR                "sftp"
 
@@ -29,8 +29,13 @@
 
 
 #define GB_PATTERN    "%s/core.*"
+/* daemon core dumps are stored compressed by crash processing (.zst), the
+ * ones systemd compressed (.xz, .lz4) are recompressed once processed. The
+ * file names are matched by
+ * scan_core_file_name(), the pattern documents the format. */
 #define CORE_FILE_PATTERN \
-"core\\.(.*)\\.([0-9]+)\\.([0-9a-f]{1,64})\\.([0-9]{1,8})\\.([0-9]{1,16})"
+"core\\.(.*)\\.([0-9]+)\\.([0-9a-f]{1,64})\\.([0-9]{1,8})\\.([0-9]{1,16})" \
+"(\\.(xz|lz4|zst))?$"
 
 #define KERN_GB_PATTERN \
    "vmcore.[0-9][0-9][0-9][0-9][0-9][0-9][0-9][0-9].[0-9][0-9][0-9]" \
@@ -41,6 +46,8 @@ e.g.     "/var/lib/systemd/coredump\
 /core.vtysh.0.68b62225067c4523af7d4d38e723da39.682.1459547856000000.xz"
 OR
 /core.vtysh.0.eb5ed4346e5f40d8a942b3549ffd55b3.6173.991256265000000"
+OR, once compressed by crash processing
+/core.vtysh.0.eb5ed4346e5f40d8a942b3549ffd55b3.6173.991256265000000.zst"
 */
 
 #define DAEMON_CORE_PATH        "\\/var\\/diagnostics\\/coredump"
@@ -85,9 +92,14 @@ struct core_dump_data {
 };
 
 int
-extract_info (
-      regex_t * regexst, const char * filename,
-      struct core_dump_data* cd,int type);
+extract_info (const char * filename, struct core_dump_data* cd,int type);
+
+/* Match the file name of a core dump of type, the matches are those of
+ * regexec with CORE_FILE_PATTERN or KERN_CORE_FILE_PATTERN. Returns 0 on
+ * a match, REG_NOMATCH otherwise. */
+int
+scan_core_file_name(const char *filename, int type,
+        regmatch_t match[TOTAL_INFO]);
 
 int
 get_file_list(int type, glob_t* globbuf, const char* globpattern ,
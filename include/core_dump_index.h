@@ -0,0 +1,62 @@
+/* Core dump index.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: core_dump_index.h
+ *
+ * Purpose: Metadata of the core dumps present on the switch, kept up to date
+ *          through inotify and persisted between CLI sessions, so that
+ *          listing core dumps does not need any per file system call.
+ */
+
+#ifndef _CORE_DUMP_INDEX_H
+#define _CORE_DUMP_INDEX_H
+
+#include <stddef.h>
+#include "core_dump.h"
+
+#define CORE_DUMP_DIR           "/var/diagnostics/coredump"
+#define KERNEL_CORE_DIR         "/var/diagnostics/coredump/kernel-core"
+#define CORE_INDEX_FILE         "/var/diagnostics/coredump.index"
+#define CORE_INDEX_NAME_SIZE    256
+
+struct core_index_entry
+{
+   int type;                             /* TYPE_DAEMON or TYPE_KERNEL */
+   int valid;                            /* cd could be extracted */
+   char name[CORE_INDEX_NAME_SIZE];      /* file name in its directory */
+   struct core_dump_data cd;
+};
+
+/* Bring the index up to date and return a copy of it, daemon core dumps
+ * first, each type sorted by file name. The copy is freed by the caller.
+ * Returns 0 on success. */
+int
+core_index_snapshot(struct core_index_entry** entries, size_t* count);
+
+/* Full path of the core dump of an entry. Returns 0 on success. */
+int
+core_index_path(const struct core_index_entry* entry, char* buf,
+        size_t size);
+
+/* Whether a daemon core dump belongs to daemon, and to instance_id when it
+ * is not NULL, as copy core-dump selects them. */
+int
+core_index_match(const struct core_index_entry* entry, const char* daemon,
+        const char* instance_id);
+
+#endif /* _CORE_DUMP_INDEX_H */
@@ -0,0 +1,59 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-supportability
+ *
+ * @file
+ * Header file for the retention of daemon core dumps.
+ ***************************************************************************/
+
+#ifndef _CORE_RETENTION_H_
+#define _CORE_RETENTION_H_
+
+#define CORE_RETENTION_FILE \
+    "/etc/openswitch/supportability/ops_coredump_retention.yaml"
+#define CORE_RETENTION_EVENT_NAME    "SUPPORTABILITY_CORE_EVICTED"
+
+/* used when the policy file is missing, a limit of 0 disables it */
+#define CORE_RETENTION_MAX_BYTES     (1024ULL * 1024 * 1024)
+#define CORE_RETENTION_MAX_PER_DAEMON 5
+#define CORE_RETENTION_MAX_AGE_DAYS  30
+
+/* Load the policy and the core dumps present, and enforce the policy.
+ * Returns 0 on success. */
+int core_retention_init(void);
+
+/* Account for a stored core dump, signature is its stack signature or NULL,
+ * and enforce the policy. Returns FALSE when the policy evicted the core
+ * dump itself, TRUE otherwise. */
+int core_retention_add(const char *name, const char *process,
+                       const char *signature);
+
+/* Remove the core dumps which exceeded the age limit */
+void core_retention_run(void);
+
+/* Returns the msecs until the next core dump exceeds the age limit, -1 when
+ * none will */
+int core_retention_timeout(void);
+
+/* Forget a core dump which was deleted */
+void core_retention_remove(const char *name);
+
+/* Release the core dumps accounted for */
+void core_retention_destroy(void);
+
+#endif /* _CORE_RETENTION_H_ */
@@ -0,0 +1,110 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-supportability
+ *
+ * @file
+ * Header file for post crash processing of daemon core dumps.
+ ***************************************************************************/
+
+#ifndef _CRASHPROCESSING_H_
+#define _CRASHPROCESSING_H_
+
+#include <stddef.h>
+
+#define CRASH_CORE_DIR           "/var/lib/systemd/coredump"
+#define CRASH_CORE_PATTERN       "core*"
+/* names of the processed core dumps, one per line, only ever appended to */
+#define CRASH_JOURNAL            CRASH_CORE_DIR "/processed_core_files.journal"
+/* list written by earlier versions, imported once */
+#define CRASH_LEGACY_LIST        CRASH_CORE_DIR "/processed_core_files.cfl"
+/* stack signatures of the crashes, one per line:
+ * <hash> <crashes> <core dumps not kept> <process> <crash site> */
+#define CRASH_SIGNATURE_DB       CRASH_CORE_DIR "/crash_signatures"
+/* core dumps kept per stack signature, the first and the latest ones */
+#define CRASH_DEDUP_KEEP         3
+#define CRASH_COMPRESSED_EXT     ".zst"
+/* extended attributes crash processing adds to the kept core dumps, the
+ * stack signature and the backtrace of the crashing thread, one frame per
+ * line */
+#define CRASH_SIG_XATTR          "user.coredump.signature"
+#define CRASH_BT_XATTR           "user.coredump.backtrace"
+#define CRASH_BT_SIZE            2048
+/* flight recorders stored with the core dumps, and their temporary files,
+ * FLIGHTREC_EXT comes from flightrec.h */
+#define CRASH_FLIGHTREC_PATTERN  "*" FLIGHTREC_EXT "*"
+#define CRASH_EVENT_CATEGORY     "SUPPORTABILITY"
+#define CRASH_EVENT_NAME         "SUPPORTABILITY_DAEMON_CRASH"
+
+/* local socket the crashes are announced on, one message per crash made of
+ * key=value lines, see struct crash_notification */
+#define CRASH_NOTIFY_SOCKET      "/var/run/openvswitch/ops-crash-notify.sock"
+#define CRASH_NOTIFY_MAX_SUBSCRIBERS 32
+#define CRASH_NOTIFY_MSG_SIZE    1024
+#define CRASH_NOTIFY_NAME_SIZE   256
+#define CRASH_NOTIFY_SIZE        64
+
+/* A crash as announced to the subscribers */
+struct crash_notification {
+    char process[CRASH_NOTIFY_SIZE];
+    int pid;
+    int signal_num;
+    long long timestamp;                    /* usec since the epoch */
+    int stored;                             /* the core dump was kept */
+    int evicted;                            /* stored, then removed by the
+                                               core dump retention policy */
+    char file[CRASH_NOTIFY_NAME_SIZE];      /* core dump, when stored or
+                                               evicted */
+    char signature[CRASH_NOTIFY_SIZE];      /* stack signature, may be "" */
+    char site[CRASH_NOTIFY_SIZE * 2];       /* object+offset of the crash */
+    unsigned int crashes;                   /* with this signature */
+};
+
+/* Load the journal, start watching the core dump directory and process the
+ * core dumps created while nobody was watching, and start listening for
+ * subscribers on CRASH_NOTIFY_SOCKET. Returns the fd to poll for new core
+ * dumps and subscribers, -1 on failure. */
+int crash_processing_init(void);
+
+/* Process the core dumps announced on the fd since the last call, logs a
+ * crash event for each new one and stores it compressed. Once
+ * CRASH_DEDUP_KEEP core dumps of its stack signature are kept, it replaces
+ * the oldest of them other than the first. Each crash is then announced to
+ * the subscribers. Returns the number of events logged. */
+int crash_processing_run(void);
+
+/* Returns the msecs until crash_processing_run() must be called again
+ * without a new core dump, for a core dump exceeding the age limit of core
+ * dump retention, -1 when there is no such core dump. */
+int crash_processing_timeout(void);
+
+/* Subscribe to the crash notifications. Returns the fd to poll and read
+ * with crash_notify_receive(), -1 on failure. */
+int crash_notify_subscribe(void);
+
+/* Read the next notification from a subscription. Returns 1 when n was
+ * filled, 0 when there is none pending, -1 when the subscription ended. */
+int crash_notify_receive(int fd, struct crash_notification *n);
+
+/* Format n as a message. Returns its length, -1 if it does not fit. */
+int crash_notify_format(const struct crash_notification *n, char *buf,
+                        size_t size);
+
+/* Stop watching and release the journal */
+void crash_processing_destroy(void);
+
+#endif /* _CRASHPROCESSING_H_ */
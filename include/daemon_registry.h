@@ -0,0 +1,53 @@
+/* Daemon registry header file
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: daemon_registry.h
+ *
+ * Purpose: The daemons running, as their pid files and unixctl sockets in
+ *          the OVS run directory show.
+ */
+
+#ifndef _DAEMON_REGISTRY_H_
+#define _DAEMON_REGISTRY_H_
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define DAEMON_REGISTRY_DIR        "/run/openvswitch"
+#define DAEMON_REGISTRY_PID_EXT    ".pid"
+#define DAEMON_REGISTRY_CTL_EXT    ".ctl"
+
+struct daemon_entry
+{
+   char* name;
+   pid_t pid;         /* from the unixctl socket name, 0 if unknown */
+   int has_pidfile;   /* <name>.pid exists */
+   int has_ctl;       /* <name>.<pid>.ctl exists */
+};
+
+/* Returns 1 if daemon has a pid file or a unixctl socket whose pid is
+ * alive, 0 otherwise */
+int daemon_registry_running(const char* daemon);
+
+/* Copies the daemons, sorted by name, into *entries which the caller
+ * releases with daemon_registry_free. Returns the number of daemons, -1 on
+ * failure. */
+int daemon_registry_list(struct daemon_entry** entries);
+
+void daemon_registry_free(struct daemon_entry* entries, int count);
+
+#endif /* _DAEMON_REGISTRY_H_ */
@@ -0,0 +1,76 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-supportability
+ *
+ * @file
+ * Header file for the debug ring, which keeps the debug output of a daemon
+ * in memory instead of the log until it is asked for.
+ ***************************************************************************/
+
+#ifndef _DEBUG_RING_H_
+#define _DEBUG_RING_H_
+
+#include <stddef.h>
+#include "openvswitch/vlog.h"
+
+/* unixctl commands registered by debug_ring_init() */
+#define DEBUG_RING_MODE_CMD         "debug-ring/mode"   /* log|ring [KB] */
+#define DEBUG_RING_DUMP_CMD         "debug-ring/dump"   /* [clear] */
+#define DEBUG_RING_MODE_LOG         "log"
+#define DEBUG_RING_MODE_RING        "ring"
+#define DEBUG_RING_DUMP_CLEAR       "clear"
+
+#define DEBUG_RING_SIZE_DEFAULT     1024    /* KB */
+#define DEBUG_RING_SIZE_MIN         64      /* KB */
+#define DEBUG_RING_SIZE_MAX         65536   /* KB */
+#define DEBUG_RING_LINE_MAX         1024    /* longer lines are cut */
+
+/* Logs a debug line with VLOG, or keeps it in the ring when the ring mode
+ * is on. The ring takes the line whatever the configured log levels. */
+#define DEBUG_RING_VLOG_DBG(...)                                            \
+    do {                                                                    \
+        if(!debug_ring_log(vlog_get_module_name(THIS_MODULE),               \
+                           __VA_ARGS__)) {                                  \
+            VLOG_DBG(__VA_ARGS__);                                          \
+        }                                                                   \
+    } while (0)
+
+/* Registers DEBUG_RING_MODE_CMD and DEBUG_RING_DUMP_CMD, the daemon starts
+ * in the log mode. Returns 0 on success, -1 on failure. */
+int debug_ring_init(void);
+
+/* Turns the ring mode on with a ring of size KB, the lines kept so far are
+ * kept if the size does not change, or off when size is 0. Returns 0 on
+ * success, -1 on failure. */
+int debug_ring_set(size_t size);
+
+/* Returns 1 if the ring mode is on, 0 otherwise */
+int debug_ring_enabled(void);
+
+/* Keeps a line of module in the ring. Returns 1 if it was kept, 0 when the
+ * ring mode is off and the caller logs the line itself. */
+int debug_ring_log(const char *module, const char *format, ...)
+    __attribute__ ((format (printf, 2, 3)));
+int debug_ring_record(const char *module, const char *message);
+
+/* Returns the lines of the ring as text, oldest first, with a line of
+ * counters ahead, and empties the ring if clear is set. The caller frees
+ * the text. Returns NULL on failure. */
+char *debug_ring_dump(int clear);
+
+#endif /* _DEBUG_RING_H_ */
@@ -30,18 +30,21 @@
 #include "feature_mapping.h"
 #include "supportability_utils.h"
 
+#define     FUN_MAX_TIME      60      /*in secs - maximum task timeout limit*/
+#define     USER_INT_ALARM    10      /*in secs - user interrupt*/
+#define     DIAG_CMD_ARGC_MAX 2
+#define     DIAG_ARG_LEN_MAX  256
+#define     DIAG_DUMP_NO_DAEMON 2     /*task rc, daemon not reachable*/
+
+/* Argument of a diag dump executor task. The strings are copied since the
+ * task may outlive the CLI handler when it times out. */
 typedef struct
 {
-    char* daemon ;
-    char **cmd_type ;
+    char daemon[DIAG_ARG_LEN_MAX] ;
+    char cmd_argv[DIAG_CMD_ARGC_MAX][DIAG_ARG_LEN_MAX] ;
     int cmd_argc ;
-    struct vty *vty ;
-    int fd ;
 }thread_arg;
 
-#define     FUN_MAX_TIME      60      /*in secs - maximum thread timeout limit*/
-#define     USER_INT_ALARM    10      /*in secs - user interrupt*/
-
 #ifndef FALSE
 #define     FALSE             0
 #endif
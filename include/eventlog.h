@@ -61,5 +61,8 @@ typedef struct {
 
 extern int event_log_init(char *category);
 extern int log_event(char *ev_name,...);
+/* log_event() for bindings, pairs are count "key=value" strings */
+extern int log_event_kv(char *ev_name, char *identifier, int count,
+                        char *pairs[]);
 extern char *key_value_string(char *s1, ...);
 #endif /* __EVENTLOG_H_ */
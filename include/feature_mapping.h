@@ -24,6 +24,8 @@
 #ifndef __FEATURE_MAPPING_H
 #define __FEATURE_MAPPING_H
 
+#include <stddef.h>
+
 #define FEATURE_MAPPING_CONF  \
     "/etc/openswitch/supportability/ops_featuremapping.yaml"
 #define FEATURE_SIZE           30
@@ -63,6 +65,41 @@ enum  {
 } ;
 
 
+/* a feature served by a daemon, with the diag-dump flag of the pair */
+struct daemon_feature {
+   struct feature* feature;
+   diag_enable diag_flag;
+};
+
+/* a daemon of the feature mapping and the features it serves, in the
+   order of the config file */
+struct daemon_features {
+   const char* name;
+   /* Enable this flag if the daemon supports diag-dump for any feature */
+   diag_enable diag_flag;
+   size_t n_features;
+   struct daemon_feature* features;
+};
+
+/* The feature mapping is compiled in to a table with hash indexes of
+   feature names and daemon names, again when the config file changes.
+   Everything returned stays valid for the life of the process, a reload
+   does not free the previous table. */
+
 struct feature* get_feature_mapping(void);
 
+/* feature named name, NULL if there is none or the mapping failed */
+struct feature* feature_mapping_find(const char* name);
+
+/* features served by daemon, NULL if it serves none */
+const struct daemon_features* feature_mapping_find_daemon(const char* daemon);
+
+/* number of features, and feature index in the order of the config file */
+size_t feature_mapping_count(void);
+struct feature* feature_mapping_get(size_t index);
+
+/* number of daemons, and daemon index in order of first appearance */
+size_t feature_mapping_daemon_count(void);
+const struct daemon_features* feature_mapping_get_daemon(size_t index);
+
 #endif  /* __FEATURE_MAPPING_H */
@@ -0,0 +1,76 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-supportability
+ *
+ * @file
+ * Header file for the flight recorder, the last events and log lines of a
+ * daemon kept in shared memory so that they outlive a crash.
+ ***************************************************************************/
+
+#ifndef _FLIGHTREC_H_
+#define _FLIGHTREC_H_
+
+#include <sys/types.h>
+#include "openvswitch/vlog.h"
+
+/* one segment per process, FLIGHTREC_SHM_PREFIX<pid> */
+#define FLIGHTREC_SHM_DIR        "/dev/shm"
+#define FLIGHTREC_SHM_PREFIX     "ops_flightrec."
+#define FLIGHTREC_RECORDS        1024    /* power of two */
+#define FLIGHTREC_TEXT_SIZE      232     /* records of 256 bytes */
+/* snapshot stored next to a core dump, <core dump>FLIGHTREC_EXT */
+#define FLIGHTREC_EXT            ".flightrec"
+
+/* Logs with VLOG and records the line in the flight recorder, whatever the
+ * configured log levels */
+#define FLIGHTREC_VLOG(LEVEL, ...)                                          \
+    do {                                                                    \
+        VLOG(LEVEL, __VA_ARGS__);                                           \
+        flightrec_log(LEVEL, vlog_get_module_name(THIS_MODULE),             \
+                      __VA_ARGS__);                                         \
+    } while (0)
+#define FLIGHTREC_VLOG_ERR(...)  FLIGHTREC_VLOG(VLL_ERR, __VA_ARGS__)
+#define FLIGHTREC_VLOG_WARN(...) FLIGHTREC_VLOG(VLL_WARN, __VA_ARGS__)
+#define FLIGHTREC_VLOG_INFO(...) FLIGHTREC_VLOG(VLL_INFO, __VA_ARGS__)
+#define FLIGHTREC_VLOG_DBG(...)  FLIGHTREC_VLOG(VLL_DBG, __VA_ARGS__)
+
+/* Map the flight recorder of this process, done by event_log_init() and on
+ * the first record. Returns 0 on success, -1 on failure. */
+int flightrec_init(void);
+
+/* Record a log line of module */
+void flightrec_log(enum vlog_level level, const char *module,
+                   const char *format, ...)
+    __attribute__ ((format (printf, 3, 4)));
+
+/* Record an event logged at severity, a syslog level */
+void flightrec_event(int severity, const char *message);
+
+/* Write the flight recorder of a crashed process to path as text, oldest
+ * record first, and release it. process is the name of the crashed process,
+ * checked against the recorder in case pid was reused. Returns 0 on
+ * success, -1 if the process had no flight recorder. */
+int flightrec_snapshot(pid_t pid, const char *process, const char *path);
+
+/* Release the flight recorder of a process which crashed */
+void flightrec_discard(pid_t pid);
+
+/* Release the flight recorders of the processes which are gone */
+void flightrec_sweep(void);
+
+#endif /* _FLIGHTREC_H_ */
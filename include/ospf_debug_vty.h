@@ -36,6 +36,11 @@
 
 #define DBG_CMD_LEN_MAX    50
 
+#define OSPF_FEATURE          "ospfv2"
+#define OSPF_DEBUG_CMD        "ospf/debug"
+#define OSPF_SHOW_DEBUG_CMD   "ospf/show-debug"
+#define OSPF_NO_DEBUG_CMD     "ospf/no-debug"
+
 #define  ERR_STR\
     "Error in retrieving the mapping of feature names to daemon names"
 #define DBG_STR            "Debug Configuration\n"
@@ -69,5 +74,13 @@
 #define OSPFv2_NSSA_INFO      "OSPFv2 NSSA information\n"
 #define OSPFv2_INTF_INFO      "OSPFv2 interface information\n"
 #define OSPFv2_REDIST_INFO    "OSPFv2 redistribute information\n"
+#define OSPFv2_PROFILE        "OSPFv2 debug categories by purpose\n"
+#define OSPFv2_PROFILE_ADJ    "ISM, NSM, Hello and Database Description\n"
+#define OSPFv2_PROFILE_FLOOD  "LSA flooding, Link State Request, Update and Acknowledgment\n"
+#define OSPFv2_PROFILE_ROUTE  "LSA generation and install, events, interfaces and redistribution\n"
+#define OSPFv2_PROFILE_ALL    "All the OSPFv2 debug categories\n"
+#define OSPFv2_CAPTURE        "Where OSPFv2 debug output goes (no effect until ospfd supports the debug ring)\n"
+#define OSPFv2_CAPTURE_RING   "Keep debug output in memory instead of the log (needs ospfd support)\n"
+#define OSPFv2_CAPTURE_SIZE   "Size of the ring in KB (Default: 1024)\n"
 
 #endif /*__ZLOG_LIST_VTY_H*/
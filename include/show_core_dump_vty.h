@@ -27,7 +27,13 @@
 #include "core_dump.h"
 
 #define SHOW_CORE_DUMP_STR              "Display core-dump list\n"
+#define SHOW_CORE_DUMP_DETAIL_STR       "Display core-dumps with their backtrace\n"
+#define TERMINAL_STR                    "Set terminal line parameters\n"
+#define MONITOR_STR                     "Copy alerts to the current terminal line\n"
+#define MONITOR_CORE_DUMP_STR           "Announce daemon crashes as they happen\n"
 
 #define SIGNAL_DESC_STR_LEN         128
+/* records of the flight recorder shown by show core-dump detail */
+#define CORE_DETAIL_FLIGHTREC_LINES 50
 
 #endif //_SHOW_CORE_DUMP_VTY_H
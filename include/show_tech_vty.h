@@ -27,6 +27,10 @@
 void cli_pre_init(void);
 void cli_post_init(void);
 
+/* Programs running each show tech command in a process of its own */
+#define SHOW_TECH_VTYSH_PATH       "/usr/bin/vtysh"
+#define SHOW_TECH_CAT_PATH         "/bin/cat"
+
 #define SHOW_TECH_STR              "Display output of a predefined command sequence used by technical support\n"
 #define SHOW_TECH_LIST_STR         "Display supported feature groups\n"
 #define SHOW_TECH_FILE_STR         "Capture command-output into a specified file\n"
@@ -34,6 +38,8 @@ void cli_post_init(void);
 #define SHOW_TECH_FEATURE_STR      "Display output of feature-specific predefined command sequence used by technical support\n"
 #define SHOW_TECH_SUB_FEATURE_STR  "Display output of sub feature-specific predefined command sequence used by technical support\n"
 #define SHOW_TECH_FILE_FORCE_STR   "Overwrite if the given file exists\n"
+#define SHOW_TECH_DIFF_STR         "Display only the changes since the previous show tech diff\n"
 void show_tech_vty_init();
+int cli_show_tech_reload(void);
 
 #endif //_SHOW_TECH_VTY_H
@@ -40,7 +40,16 @@
 #define SHOW_VLOG_DAEMON         "Displays ops-daemon vlog configurations\n"
 #define SHOW_VLOG_FILTER_SEV     "Display vlogs for specified severity\n"
 #define SHOW_VLOG_FILTER_DAEMON  "Display vlogs for specified ops-daemon\n"
-#define SHOW_VLOG_FILTER_WORD    "Display logs for specified ops-daemon\n"
+#define SHOW_VLOG_FILTER_WORD    "Display logs for specified ops-daemons, " \
+                                 "separated by commas\n"
+#define SHOW_VLOG_FILTER_LAST    "Display only the latest vlogs\n"
+#define SHOW_VLOG_FILTER_LAST_COUNT "Number of vlogs\n"
+#define SHOW_VLOG_FILTER_SINCE   "Display vlogs logged at or after a time\n"
+#define SHOW_VLOG_FILTER_UNTIL   "Display vlogs logged at or before a time\n"
+#define SHOW_VLOG_FILTER_TIME    "YYYY-MM-DD:HH:MM:SS, or an age as 30s, " \
+                                 "10m, 2h or 1d\n"
+#define SHOW_VLOG_FILTER_MATCH   "Display vlogs whose message matches\n"
+#define SHOW_VLOG_FILTER_REGEX   "Extended regular expression\n"
 #define VLOG_CONFIG_FEATURE      "Specify feature name\n"
 #define VLOG_CONFIG_DAEMON       "Specify ops-daemon name\n"
 #define VLOG_CONFIG              "Specify feature or ops-daemon name\n"
@@ -53,7 +62,11 @@
 #define VLOG_LOG_LEVEL_INFO      "Capture emergency,error,warning and info logs only\n"
 #define VLOG_LOG_LEVEL_DBG       "Capture all logs\n"
 #define VLOG_LOG_LEVEL_OFF       "Disable logging to specified destination\n"
-#define VLOG_CMD                 "show vlog { severity \
-                                 (emer | err | warn | info | debug) | daemon ("
+#define VLOG_CONFIG_FEATURE_LIST "Feature names separated by commas\n"
+#define VLOG_LOG_SETTING         "Destination and level, as syslog:dbg, " \
+                                 "file:info or all:off\n"
+#define VLOG_DURATION            "Revert to the current levels after a while\n"
+#define VLOG_DURATION_SECS       "Seconds before the levels are reverted\n"
+#define SUPPORTABILITY_DAEMON    "ops_supportability"
 
 #endif /*__VLOG_LIST_VTY_H*/
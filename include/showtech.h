@@ -24,12 +24,34 @@
 #ifndef _SHOWTECH_H_
 #define _SHOWTECH_H_
 
+#include <sys/types.h>
+#include <time.h>
 #include "supportability_utils.h"
 
+#define SHOWTECH_DEFAULT_CONFIG "/etc/openswitch/supportability/ops_showtech.yaml"
+
+/* Per command limits, used when the configuration does not set them */
+#define SHOWTECH_CMD_DEFAULT_TIMEOUT   60        /* in secs */
+#define SHOWTECH_CMD_MAX_TIMEOUT       3600      /* in secs */
+
+/* Execution classes, show tech runs the critical commands of every selected
+ * feature first, then the high, normal and low priority ones */
+enum showtech_priority
+{
+  SHOWTECH_PRIORITY_CRITICAL,
+  SHOWTECH_PRIORITY_HIGH,
+  SHOWTECH_PRIORITY_NORMAL,
+  SHOWTECH_PRIORITY_LOW,
+  SHOWTECH_PRIORITY_MAX
+};
+
  struct clicmds
  {
   char* command;
   int command_failed;
+  unsigned int timeout;           /* in secs */
+  enum showtech_priority priority;
+  size_t max_output_bytes;        /* 0 for no limit */
   struct clicmds* next;
 };
 
@@ -66,7 +88,61 @@ struct feature
   struct feature* next;
 };
 
-/* Return Show Tech Configuration Datastructure Header */
+/* One row of the compiled command table. Sub features without commands and
+ * features without sub features are kept as rows with a NULL clicmd, so
+ * that their banners are still printed. */
+struct showtech_cmd
+{
+  struct feature* feature;
+  struct sub_feature* sub_feature;
+  struct clicmds* clicmd;
+};
+
+/* Hash index entry, a contiguous range of the command table covering a
+ * feature (sub_feature == NULL) or one of its sub features */
+struct showtech_group
+{
+  const char* feature;
+  const char* sub_feature;
+  struct feature* p_feature;
+  struct sub_feature* p_subfeature;
+  size_t first;
+  size_t count;
+};
+
+/* Compiled, immutable view of one version of the configuration file */
+struct showtech_table
+{
+  struct feature* feature_head;
+  struct showtech_cmd* cmds;
+  size_t n_cmds;
+  struct showtech_group* index;
+  size_t index_size;
+  unsigned int generation;
+  int refcnt;
+  char* config_file;
+  dev_t dev;
+  ino_t ino;
+  off_t size;
+  struct timespec mtime;
+};
+
+/* Return the current command table, reloading it first if the configuration
+ * file changed on disk. The table must be given back with
+ * showtech_table_release. */
+struct showtech_table* showtech_table_acquire(const char* config_file);
+/* Drop a reference obtained with showtech_table_acquire */
+void showtech_table_release(struct showtech_table* table);
+/* O(1) lookup of a feature or a feature/sub feature pair */
+const struct showtech_group* showtech_table_lookup(
+  const struct showtech_table* table, const char* feature,
+  const char* sub_feature);
+
+/* Name of a priority class as used in the configuration file */
+const char* showtech_priority_name(enum showtech_priority priority);
+
+/* Return Show Tech Configuration Datastructure Header, valid until the next
+ * call or free_show_tech_config. Prefer showtech_table_acquire. */
 struct feature* get_showtech_config(const char* config_file);
 /* Frees the Show Tech Configuration Datastructure */
 void free_show_tech_config(void);
@@ -0,0 +1,81 @@
+/* Show Tech capture store and diff
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: showtech_diff.h
+ *
+ * Purpose: Content addressed store of the last output of every show tech
+ *          command, and unified diff of two captures.
+ *
+ *          Layout of the store directory:
+ *            objects/<sha256>  output of a command, named by its digest
+ *            index             one "<sha256> <command>" line per command,
+ *                              the reference of show tech diff
+ *            index.<feature>   the same for show tech diff <feature>
+ *            lock              held shared by every session from open to
+ *                              close, exclusive to remove the objects no
+ *                              index refers to
+ */
+
+#ifndef _SHOWTECH_DIFF_H_
+#define _SHOWTECH_DIFF_H_
+
+#include <stddef.h>
+#include "supportability_sha256.h"
+
+#define SHOWTECH_DIFF_DIR          "/var/diagnostics/showtech"
+#define SHOWTECH_DIFF_CONTEXT      3      /* lines of context in a hunk */
+#define SHOWTECH_DIFF_MAX_EDITS    2000   /* beyond this, replace wholesale */
+
+struct showtech_store;
+
+/* Open the store in dir (SHOWTECH_DIFF_DIR when NULL), creating it if
+ * needed, and load the index of scope, a feature name, or the index of
+ * every feature when NULL. Blocks while objects are being removed.
+ * Returns NULL on failure. */
+struct showtech_store* showtech_store_open(const char* dir,
+                                           const char* scope);
+
+/* Digest of the last capture of command, NULL if it was never captured */
+const char* showtech_store_lookup(const struct showtech_store* store,
+                                  const char* command);
+
+/* Read a stored capture. *data is malloc'ed and NUL terminated.
+ * Returns 0 on success. */
+int showtech_store_read(const struct showtech_store* store, const char* digest,
+                        char** data, size_t* len);
+
+/* Store the capture of command and point the index at it. The digest of
+ * data is returned in digest. Returns 0 on success. */
+int showtech_store_put(struct showtech_store* store, const char* command,
+                       const char* data, size_t len,
+                       char digest[SHA256_HEX_LEN]);
+
+/* Write the index atomically. When no other session has the store open,
+ * remove the objects which no index refers to. Call it last before close.
+ * Returns 0 on success. */
+int showtech_store_commit(struct showtech_store* store);
+
+void showtech_store_close(struct showtech_store* store);
+
+/* Unified diff of old_text and new_text with SHOWTECH_DIFF_CONTEXT lines of
+ * context. Returns a malloc'ed string, empty when the inputs are equal, or
+ * NULL on allocation failure. */
+char* showtech_unified_diff(const char* old_text, size_t old_len,
+                            const char* new_text, size_t new_len,
+                            const char* old_label, const char* new_label);
+
+#endif /* _SHOWTECH_DIFF_H_ */
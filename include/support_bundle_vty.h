@@ -0,0 +1,55 @@
+/* SUPPORT_BUNDLE CLI commands.
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: support_bundle_vty.h
+ *
+ * Purpose: To collect show tech, diag-dump, events and core dumps in to a
+ *          single archive from CLI.
+ */
+
+#ifndef _SUPPORT_BUNDLE_VTY_H
+#define _SUPPORT_BUNDLE_VTY_H
+
+#define SUPPORT_BUNDLE_STR          "Collect support data in to a single archive\n"
+#define SUPPORT_BUNDLE_CREATE_STR   "Create a support bundle with show tech, diag-dump, events and core dumps\n"
+#define SUPPORT_BUNDLE_FILE_STR     "Specify the file name of the support bundle\n"
+#define SUPPORT_BUNDLE_CORES_STR    "Select the core dumps added to the support bundle\n"
+#define SUPPORT_BUNDLE_LATEST_STR   "Add the latest core dumps only (Default)\n"
+#define SUPPORT_BUNDLE_NONE_STR     "Do not add core dumps\n"
+
+/* kept on persistent storage, a bundle with core dumps outgrows tmpfs */
+#define SUPPORT_BUNDLE_PARENT_DIR   "/var/diagnostics"
+#define SUPPORT_BUNDLE_DIR          "/var/diagnostics/support-bundle"
+#define SUPPORT_BUNDLE_SUFFIX       ".tar.zst"
+#define SUPPORT_BUNDLE_PART_SUFFIX  ".part"
+#define SUPPORT_BUNDLE_MANIFEST     "MANIFEST"
+#define SUPPORT_BUNDLE_NAME_REGEX   "^([A-Za-z0-9_.-]){1,50}$"
+#define SUPPORT_BUNDLE_PATH_LEN     256
+#define SUPPORT_BUNDLE_MAX_CORES    3       /* latest core dumps added */
+#define SUPPORT_BUNDLE_MAX_CORE_BYTES (512ULL * 1024 * 1024)
+
+/* core dumps added to the support bundle */
+enum support_bundle_cores {
+    SUPPORT_BUNDLE_CORES_LATEST = 0,
+    SUPPORT_BUNDLE_CORES_NONE
+};
+
+int cli_support_bundle_create(const char* fname,
+                              enum support_bundle_cores cores);
+
+#endif /* _SUPPORT_BUNDLE_VTY_H */
@@ -0,0 +1,74 @@
+/* Supportability archive writer
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: supportability_archive.h
+ *
+ * Purpose: Streaming writer of zstd compressed ustar archives. Members are
+ *          compressed and written out as they are added, nothing is staged
+ *          in temporary files.
+ */
+
+#ifndef _SUPPORTABILITY_ARCHIVE_H_
+#define _SUPPORTABILITY_ARCHIVE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+#include "supportability_sha256.h"
+
+#define ARCHIVE_ZSTD_LEVEL        3     /* zstd default, fast enough inline */
+#define ARCHIVE_ZSTD_WORKERS      2     /* compression threads, 0 inline */
+#define ARCHIVE_NAME_MAX          255   /* ustar prefix + name */
+
+struct archive_writer;
+
+/* Per member bookkeeping, as needed for a manifest */
+struct archive_member_info
+{
+    uint64_t offset;                 /* of the header in the tar stream */
+    uint64_t size;                   /* of the member data */
+    char sha256[SHA256_HEX_LEN];     /* of the member data */
+};
+
+/* Start a compressed archive on fd. The fd is not closed by the writer.
+ * Returns NULL on failure. */
+struct archive_writer* archive_open(int fd);
+
+/* Add a member from memory. Returns 0 on success, -1 once the archive is
+ * broken. */
+int archive_add_buffer(struct archive_writer* aw, const char* name,
+                       const void* data, size_t len, time_t mtime,
+                       struct archive_member_info* info);
+
+/* Add a member streamed from a file on disk. A file which changes size
+ * while it is read is cut or zero padded to the size it had when added.
+ * Returns 0 on success, 1 if path cannot be read and nothing was added, -1
+ * once the archive is broken. */
+int archive_add_file(struct archive_writer* aw, const char* name,
+                     const char* path, struct archive_member_info* info);
+
+/* Uncompressed bytes written so far */
+uint64_t archive_tar_size(const struct archive_writer* aw);
+
+/* Compressed bytes written so far */
+uint64_t archive_compressed_size(const struct archive_writer* aw);
+
+/* Write the end of archive marker, flush the compressor and free the
+ * writer. Returns 0 when the whole archive was written. */
+int archive_close(struct archive_writer* aw);
+
+#endif /* _SUPPORTABILITY_ARCHIVE_H_ */
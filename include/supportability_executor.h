@@ -0,0 +1,113 @@
+/* Supportability command executor
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: supportability_executor.h
+ *
+ * Purpose: Shared worker pool used by show tech and diag-dump to run
+ *          commands with a deadline.
+ *
+ *          Tasks are run by a small set of persistent worker threads.
+ *          Deadlines are tracked by a single timer thread using a timer
+ *          wheel, they start once a worker picks the task up. When a
+ *          deadline expires or the user interrupts, the task's cancel flag
+ *          is set and the submitter stops waiting. Task bodies never write
+ *          to the caller's output, they hand their output back with
+ *          executor_task_set_result. A task body which can block for good
+ *          runs the work in a child registered with executor_task_set_pid,
+ *          which is killed when the task is abandoned. Threads are never
+ *          killed: the worker of an abandoned task leaves the pool and is
+ *          replaced, up to EXECUTOR_MAX_STUCK_WORKERS of them.
+ */
+
+#ifndef _SUPPORTABILITY_EXECUTOR_H_
+#define _SUPPORTABILITY_EXECUTOR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+#define EXECUTOR_MAX_WORKERS       4     /* upper bound of the worker pool */
+#define EXECUTOR_MAX_STUCK_WORKERS 16    /* workers left in abandoned tasks */
+#define EXECUTOR_TICK_MSEC         100   /* timer wheel resolution */
+#define EXECUTOR_WHEEL_SLOTS       512   /* 51.2 secs per wheel revolution */
+
+/* Completion status returned by executor_run_task */
+enum executor_status {
+    EXECUTOR_TASK_DONE = 0,       /* task ran to completion */
+    EXECUTOR_TASK_TIMEDOUT,       /* deadline expired before completion */
+    EXECUTOR_TASK_INTERRUPTED,    /* cancelled through executor_interrupt */
+    EXECUTOR_TASK_ERROR           /* task could not be queued */
+};
+
+/* Opaque handle of a running task, doubles as its cancellation token */
+struct executor_task;
+
+/* Task body. arg points to the executor's private copy of the argument. */
+typedef int (*executor_task_fn)(void *arg, const struct executor_task *task);
+
+/* Run fn on a pooled worker and wait until it completes, its deadline of
+ * timeout_secs expires (0 means no deadline) or it is interrupted.
+ * arg_len bytes of arg are copied, so the task may outlive the caller's
+ * stack frame once it is abandoned. The value returned by fn is stored in
+ * task_rc only on EXECUTOR_TASK_DONE. */
+enum executor_status
+executor_run_task(executor_task_fn fn, const void *arg, size_t arg_len,
+                  unsigned int timeout_secs, int *task_rc);
+
+/* Queue fn without waiting, so that several tasks can run concurrently.
+ * Every handle returned must be passed to executor_wait exactly once.
+ * Returns NULL if the task could not be queued. */
+struct executor_task *
+executor_submit(executor_task_fn fn, const void *arg, size_t arg_len,
+                unsigned int timeout_secs);
+
+/* Wait for a task queued by executor_submit, with the same semantics as
+ * executor_run_task, and release the handle */
+enum executor_status
+executor_wait(struct executor_task *task, int *task_rc);
+
+/* executor_wait which also claims the result stored by the task body with
+ * executor_task_set_result. *result is set only on EXECUTOR_TASK_DONE and
+ * must be freed by the caller. */
+enum executor_status
+executor_wait_result(struct executor_task *task, int *task_rc, void **result);
+
+/* Store a malloc'ed result for the submitter. Results of abandoned tasks
+ * are freed by the executor. */
+void
+executor_task_set_result(const struct executor_task *task, void *result);
+
+/* Register the child process running the task, which must lead a process
+ * group of its own. The group is killed with SIGKILL when the task times
+ * out or is interrupted. Register 0 before reaping the child. */
+void
+executor_task_set_pid(const struct executor_task *task, pid_t pid);
+
+/* Cancellation token check for task bodies */
+bool
+executor_task_cancelled(const struct executor_task *task);
+
+/* Interrupt every in-flight task after grace_secs seconds (0 cancels
+ * immediately). Safe to call from a signal handler. */
+void
+executor_interrupt(unsigned int grace_secs);
+
+/* Drop an interrupt request which has not been processed yet */
+void
+executor_clear_interrupt(void);
+
+#endif /* _SUPPORTABILITY_EXECUTOR_H_ */
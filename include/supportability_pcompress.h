@@ -0,0 +1,52 @@
+/* Supportability parallel compression
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: supportability_pcompress.h
+ *
+ * Purpose: zstd compression of a file on every CPU, streamed to a socket.
+ *
+ *          The input, gunzipped on the way when it is gzip compressed, is
+ *          cut in blocks compressed as independent zstd frames by a pool
+ *          of threads and written out in order. Each frame is preceded by
+ *          a skippable frame holding its compressed size, the layout of
+ *          pzstd, so that it also decompresses in parallel. zstd reads it
+ *          as any other zstd file.
+ */
+
+#ifndef _SUPPORTABILITY_PCOMPRESS_H_
+#define _SUPPORTABILITY_PCOMPRESS_H_
+
+#define PCOMPRESS_BLOCK_SIZE      (1024 * 1024)
+#define PCOMPRESS_LEVEL           3
+#define PCOMPRESS_MAX_WORKERS     4
+#define PCOMPRESS_EXT             ".zst"
+
+struct pcompress;
+
+/* Start compressing path. The compressed stream is read from
+ * pcompress_fd() until its end. Returns NULL on failure. */
+struct pcompress* pcompress_start(const char* path);
+
+/* fd to read the compressed stream from, owned by pc */
+int pcompress_fd(const struct pcompress* pc);
+
+/* Stop the threads, reading the stream may stop early, and release pc.
+ * Returns -1 if the input could not be read or compressed, the stream then
+ * ends with a read error rather than its end, 0 otherwise. */
+int pcompress_finish(struct pcompress* pc);
+
+#endif /* _SUPPORTABILITY_PCOMPRESS_H_ */
@@ -0,0 +1,52 @@
+/* Supportability SHA-256 helper
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: supportability_sha256.h
+ *
+ * Purpose: FIPS 180-4 SHA-256, used to content address captured outputs
+ *          and to verify transferred files.
+ */
+
+#ifndef _SUPPORTABILITY_SHA256_H_
+#define _SUPPORTABILITY_SHA256_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SHA256_DIGEST_LEN     32
+#define SHA256_HEX_LEN        (2 * SHA256_DIGEST_LEN + 1)
+
+struct sha256_ctx
+{
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t block[64];
+    size_t block_len;
+};
+
+void sha256_init(struct sha256_ctx *ctx);
+void sha256_update(struct sha256_ctx *ctx, const void *data, size_t len);
+void sha256_final(struct sha256_ctx *ctx, uint8_t digest[SHA256_DIGEST_LEN]);
+
+/* One shot digest of a buffer as a NUL terminated lowercase hex string */
+void sha256_hex(const void *data, size_t len, char hex[SHA256_HEX_LEN]);
+
+/* Convert a binary digest to a NUL terminated lowercase hex string */
+void sha256_to_hex(const uint8_t digest[SHA256_DIGEST_LEN],
+                   char hex[SHA256_HEX_LEN]);
+
+#endif /* _SUPPORTABILITY_SHA256_H_ */
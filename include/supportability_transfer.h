@@ -0,0 +1,98 @@
+/* Supportability file transfer
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: supportability_transfer.h
+ *
+ * Purpose: Upload of files to a tftp or sftp server, used to copy core
+ *          dumps off the switch.
+ *
+ *          tftp negotiates the block size and window size options (RFC 2348,
+ *          RFC 7440) and on loss resends the window from the last
+ *          acknowledged block. sftp speaks the version 3 protocol to the
+ *          sftp subsystem of ssh, with several chunks written in flight.
+ *          The file is written as <name>.part and renamed once complete, so
+ *          an upload of a file which failed is resumed from the data already
+ *          on the server, by the next session or the next copy of the same
+ *          file.
+ *
+ *          The SHA-256 of the file is computed while it is sent and stored
+ *          next to it on the server as <name>.sha256, in sha256sum format.
+ */
+
+#ifndef _SUPPORTABILITY_TRANSFER_H_
+#define _SUPPORTABILITY_TRANSFER_H_
+
+#include <stdint.h>
+#include "supportability_sha256.h"
+#include "supportability_executor.h"
+
+#define TRANSFER_TFTP_PORT         "69"
+#define TRANSFER_TFTP_BLKSIZE      1428  /* fits an ethernet frame */
+#define TRANSFER_TFTP_WINDOWSIZE   16
+#define TRANSFER_TFTP_TIMEOUT_MSEC 2000  /* wait for an ack of the window */
+#define TRANSFER_SSH_PATH          "/usr/bin/ssh"
+#define TRANSFER_SFTP_CHUNK        (32 * 1024)
+#define TRANSFER_SFTP_WINDOW       16    /* chunks written in flight */
+#define TRANSFER_SFTP_TIMEOUT_MSEC 30000 /* wait for a reply of the server */
+#define TRANSFER_RETRIES           5     /* per window or per session */
+#define TRANSFER_PART_EXT          ".part"
+#define TRANSFER_SUM_EXT           ".sha256"
+
+#define TRANSFER_USER_LEN          64
+#define TRANSFER_HOST_LEN          260
+#define TRANSFER_PATH_LEN          512
+#define TRANSFER_ERROR_LEN         128
+
+enum transfer_protocol {
+    TRANSFER_TFTP = 0,
+    TRANSFER_SFTP
+};
+
+/* What to send where. user is only used by sftp. */
+struct transfer_request
+{
+    enum transfer_protocol protocol;
+    char user[TRANSFER_USER_LEN];
+    char host[TRANSFER_HOST_LEN];
+    char local[TRANSFER_PATH_LEN];
+    char remote[TRANSFER_PATH_LEN];
+};
+
+struct transfer_result
+{
+    uint64_t size;                   /* of the file sent */
+    uint64_t resumed;                /* bytes kept from an earlier upload */
+    unsigned int restarts;           /* sessions opened again after a loss */
+    int sum_stored;                  /* whether <name>.sha256 was written */
+    char sha256[SHA256_HEX_LEN];
+    char error[TRANSFER_ERROR_LEN];  /* why the upload failed */
+};
+
+/* Upload req->local as req->remote. task is polled to give up early, it may
+ * be NULL. Returns 0 on success, otherwise res->error tells why. */
+int transfer_file(const struct transfer_request *req,
+                  struct transfer_result *res,
+                  const struct executor_task *task);
+
+/* Upload what is read from fd until its end as req->remote, req->local only
+ * names the data in logs. A stream cannot be sent again, so it is not
+ * resumed when the connection is lost. */
+int transfer_stream(const struct transfer_request *req, int fd,
+                    struct transfer_result *res,
+                    const struct executor_task *task);
+
+#endif /* _SUPPORTABILITY_TRANSFER_H_ */
@@ -34,9 +34,10 @@
 
 #define MAX_STR_BUFF_LEN           512
 
-/* compile the regular expression for the given pattern */
-int
-compile_corefile_pattern (regex_t * regexst, const char * pattern);
+/* regular expression compiled once for the given pattern, NULL if it does
+ * not compile */
+const regex_t*
+regex_cache_get(const char * pattern);
 
 /* strcmp with null check of arguments */
 int strcmp_with_nullcheck( const char * str1, const char * str2 );
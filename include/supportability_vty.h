@@ -42,16 +42,18 @@
 #define MAX_EV_CATEGORIES     999
 #define MAX_FEATURE_HELP_SIZE (MAX_FEATURES*MAX_HELP_SIZE)
 #define MAX_EV_HELP_SIZE      (MAX_EV_CATEGORIES*MAX_HELP_SIZE)
-#define PID_DIRECTORY         "/run/openvswitch/"
-#define MAX_FILENAME_SIZE     100
-#define MAX_DAEMONS           200
-#define MAX_VLOG_CMD          (MAX_DAEMONS*MAX_FEATURE_NAME_SIZE)
+#define SUPPORTABILITY_STR    "Supportability information\n"
+#define SUPPORTABILITY_CONFIG_STR \
+    "Configuration files and their reload generation\n"
 
 extern char * get_yaml_tokens(yaml_parser_t *parser,  yaml_event_t **tok, FILE *fh);
 extern struct cmd_element vtysh_diag_dump_list_cmd;
 extern struct cmd_element vtysh_diag_dump_cmd;
 extern struct cmd_element cli_platform_show_tech_cmd;
 extern struct cmd_element cli_platform_show_tech_list_cmd;
+extern struct cmd_element cli_platform_show_tech_diff_cmd;
+extern struct cmd_element cli_platform_support_bundle_create_cmd;
+extern struct cmd_element cli_platform_support_bundle_create_cores_cmd;
 extern struct cmd_element cli_platform_show_tech_feature_cmd;
 extern struct cmd_element cli_platform_show_tech_file_cmd;
 extern struct cmd_element cli_platform_show_tech_file_force_cmd;
@@ -59,13 +61,21 @@ extern struct cmd_element cli_platform_show_tech_feature_file_cmd;
 extern struct cmd_element cli_platform_show_tech_feature_file_force_cmd;
 extern struct cmd_element cli_platform_show_events_cmd;
 extern struct cmd_element cli_platform_show_core_dump_cmd;
+extern struct cmd_element cli_platform_show_core_dump_detail_cmd;
+extern struct cmd_element cli_platform_monitor_core_dump_cmd;
+extern struct cmd_element no_cli_platform_monitor_core_dump_cmd;
+extern struct cmd_element cli_platform_show_supportability_config_cmd;
 extern struct cmd_element cli_platform_show_vlog_config_cmd;
 extern struct cmd_element cli_platform_show_vlog_cmd;
 extern struct cmd_element cli_platform_show_vlog_config_list_cmd;
 extern struct cmd_element cli_platform_show_vlog_feature_cmd;
 extern struct cmd_element cli_platform_show_vlog_daemon_cmd;
 extern struct cmd_element cli_config_vlog_feature_set_cmd;
+extern struct cmd_element cli_config_vlog_feature_set_duration_cmd;
+extern struct cmd_element cli_config_vlog_features_set_cmd;
+extern struct cmd_element cli_config_vlog_features_set_duration_cmd;
 extern struct cmd_element cli_config_vlog_daemon_set_cmd;
+extern struct cmd_element cli_config_vlog_daemon_set_duration_cmd;
 /* Syslog Command */
 
 extern struct cmd_element vtysh_config_syslog_basic_cmd;
@@ -91,6 +101,8 @@ extern struct cmd_element cli_platform_copy_core_dump_tftp_cmd;
 extern struct cmd_element cli_platform_copy_core_dump_sftp_cmd;
 extern struct cmd_element cli_platform_copy_core_dump_kernel_tftp_cmd;
 extern struct cmd_element cli_platform_copy_core_dump_kernel_sftp_cmd;
+extern struct cmd_element cli_platform_copy_core_dump_kernel_zstd_tftp_cmd;
+extern struct cmd_element cli_platform_copy_core_dump_kernel_zstd_sftp_cmd;
 extern struct cmd_element cli_platform_copy_core_dump_tftp_cmd_inst;
 extern struct cmd_element cli_platform_copy_core_dump_sftp_cmd_inst;
 
@@ -107,6 +119,9 @@ extern struct cmd_element debug_ospf_lsa_cmd;
 extern struct cmd_element debug_ospf_event_cmd;
 extern struct cmd_element debug_ospf_nssa_cmd;
 extern struct cmd_element debug_ospf_intf_redst_cmd;
+extern struct cmd_element debug_ospf_profile_cmd;
+extern struct cmd_element debug_ospf_capture_ring_cmd;
+extern struct cmd_element debug_ospf_capture_ring_size_cmd;
 
 extern struct cmd_element no_debug_ospf_packet_send_recv_detail_cmd;
 extern struct cmd_element no_debug_ospf_packet_send_recv_cmd;
@@ -120,5 +135,9 @@ extern struct cmd_element no_debug_ospf_lsa_cmd;
 extern struct cmd_element no_debug_ospf_event_cmd;
 extern struct cmd_element no_debug_ospf_nssa_cmd;
 extern struct cmd_element no_debug_ospf_intf_redst_cmd;
+extern struct cmd_element no_debug_ospf_profile_cmd;
+extern struct cmd_element no_debug_ospf_capture_cmd;
+extern struct cmd_element show_debugging_ospf_capture_cmd;
+extern struct cmd_element clear_debugging_ospf_capture_cmd;
 
 #endif /* _SUPPORTABILITY_VTY_H_ */
@@ -0,0 +1,78 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-supportability
+ *
+ * @file
+ * Header file for the syslog forwarder, which sends the journal to the
+ * remote syslog servers of the Syslog_Remote table.
+ ***************************************************************************/
+
+#ifndef _SYSLOG_FORWARD_H_
+#define _SYSLOG_FORWARD_H_
+
+#include <stddef.h>
+
+/* one spool per remote and the cursor of the last journal entry read */
+#define SYSLOG_FWD_DIR              "/var/diagnostics/syslog"
+#define SYSLOG_FWD_CURSOR_FILE      SYSLOG_FWD_DIR "/cursor"
+#define SYSLOG_FWD_SPOOL_MAX        (4 * 1024 * 1024)   /* bytes per remote */
+#define SYSLOG_FWD_MSG_MAX          2048    /* longer messages are cut */
+#define SYSLOG_FWD_BATCH            64      /* messages per send */
+#define SYSLOG_FWD_READ_MAX         512     /* journal entries per run */
+/* an unreachable remote is retried with a backoff between these */
+#define SYSLOG_FWD_RETRY_MIN        1000    /* msec */
+#define SYSLOG_FWD_RETRY_MAX        60000   /* msec */
+#define SYSLOG_FWD_CONNECT_TIMEOUT  5000    /* msec */
+/* a remote which took nothing for so long drops instead of holding back
+ * the journal */
+#define SYSLOG_FWD_STALL_MAX        30000   /* msec */
+/* wait for a socket which took all it could */
+#define SYSLOG_FWD_POLL_INTERVAL    100     /* msec */
+
+/* Opens the journal from the saved cursor, from its end if there is none.
+ * Returns the fd to poll for new entries, -1 on failure. */
+int syslog_forward_init(void);
+
+/* The remotes are set between syslog_forward_begin() and
+ * syslog_forward_commit(), a remote which is not added again is removed
+ * along with its spool. Nothing is forwarded before the first commit, then
+ * a remote can also be added, or have its severity changed, and removed on
+ * its own. transport is "udp" or "tcp", severity the highest syslog level
+ * forwarded, info when NULL. Returns 0 on success, -1 on failure. */
+void syslog_forward_begin(void);
+int syslog_forward_add(const char *host, const char *transport, int port,
+                       const char *severity);
+void syslog_forward_commit(void);
+int syslog_forward_remove(const char *host, const char *transport, int port);
+
+/* Reads the new journal entries, spools them and sends the spools. Returns
+ * the number of entries read. */
+int syslog_forward_run(void);
+
+/* Returns the msec until syslog_forward_run() has to be called again, -1 if
+ * the fd of syslog_forward_init() is enough. */
+int syslog_forward_timeout(void);
+
+/* Writes a line per remote with its spool and connection state. Returns the
+ * length written, -1 if buf is too small. */
+int syslog_forward_stats(char *buf, size_t size);
+
+/* Saves the spools and closes the journal */
+void syslog_forward_exit(void);
+
+#endif /* _SYSLOG_FORWARD_H_ */
@@ -0,0 +1,558 @@
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License.
+
+from pytest import mark
+from time import sleep
+
+TOPOLOGY = """
+#
+# +-------+
+# |  sw1  |
+# +-------+
+#
+
+# Nodes
+[type=openswitch name="Switch 1"] sw1
+"""
+
+CORE_DIR = "/var/diagnostics/coredump"
+CORE_INDEX = "/var/diagnostics/coredump.index"
+CRASH_DIR = "/var/lib/systemd/coredump"
+CRASH_JOURNAL = CRASH_DIR + "/processed_core_files.journal"
+CRASH_SIGNATURES = CRASH_DIR + "/crash_signatures"
+EVENT_LOG = "/var/log/event.log"
+FLIGHTREC = "/dev/shm/ops_flightrec."
+BOOT_ID = "68b62225067c4523af7d4d38e723da39"
+CRASH_NOTIFY_SOCKET = "/var/run/openvswitch/ops-crash-notify.sock"
+MONITOR_OUT = "/tmp/ctmon.out"
+
+# vtysh on a pseudo terminal, as readline only waits for alerts on a tty.
+# The monitoring session is ended when <output>.stop appears, vtysh exits
+# when <output>.end appears.
+MONITOR_SCRIPT = [
+    "import os, pty, select, sys, time",
+    "out = open(sys.argv[1], \"w\")",
+    "pid, fd = pty.fork()",
+    "if pid == 0:",
+    "    os.execvp(\"vtysh\", [\"vtysh\"])",
+    "time.sleep(2)",
+    "os.write(fd, b\"terminal monitor core-dump\\n\")",
+    "stopped = False",
+    "end = time.time() + 120",
+    "while time.time() < end and not os.path.exists(sys.argv[1] + \".end\"):",
+    "    if not stopped and os.path.exists(sys.argv[1] + \".stop\"):",
+    "        os.write(fd, b\"no terminal monitor core-dump\\n\")",
+    "        stopped = True",
+    "    if select.select([fd], [], [], 0.5)[0]:",
+    "        try:",
+    "            data = os.read(fd, 4096)",
+    "        except OSError:",
+    "            break",
+    "        out.write(data.decode(\"utf-8\", \"replace\"))",
+    "        out.flush()",
+    "os.write(fd, b\"exit\\n\")",
+    "os.waitpid(pid, 0)",
+]
+
+
+def _now_usecs(sw1):
+    # recent enough for the core dump retention to keep the cores
+    return int(sw1("date +%s", shell="bash").splitlines()[-1]) * 1000000
+
+
+def _core_name(daemon, pid, timestamp, signal=11):
+    # the timestamp is in usecs, as systemd-coredump names the files
+    return "core.%s.%d.%s.%d.%d.zst" % (daemon, signal, BOOT_ID, pid,
+                                        timestamp)
+
+
+def _add_core(sw1, name):
+    # only the name is looked at when the extended attributes are missing
+    sw1("echo ctcore > %s/%s" % (CORE_DIR, name), shell="bash")
+
+
+def _add_crash(sw1, name, process, signal=11, compress=None, pid=None,
+               mtime=None, signature=None):
+    # written aside and moved in, as systemd-coredump does, with the
+    # extended attributes crash processing reads. The temporary file is on
+    # the same file system, /tmp may not keep user extended attributes.
+    # Retention ages a core dump by its modification time, which a core dump
+    # already compressed with zstd keeps.
+    tmp = "%s/.%s" % (CRASH_DIR, name)
+    if compress:
+        sw1("echo ctcore | %s > %s" % (compress, tmp), shell="bash")
+    else:
+        sw1("echo ctcore > %s" % tmp, shell="bash")
+    sw1("setfattr -n user.coredump.comm -v %s %s" % (process, tmp),
+        shell="bash")
+    sw1("setfattr -n user.coredump.signal -v %d %s" % (signal, tmp),
+        shell="bash")
+    sw1("setfattr -n user.coredump.timestamp -v $(date +%%s) %s" % tmp,
+        shell="bash")
+    if pid:
+        sw1("setfattr -n user.coredump.pid -v %d %s" % (pid, tmp),
+            shell="bash")
+    if signature:
+        sw1("setfattr -n user.coredump.signature -v %s %s" %
+            (signature, tmp), shell="bash")
+    if mtime:
+        sw1("touch -d @%d %s" % (mtime, tmp), shell="bash")
+    sw1("mv %s %s/%s" % (tmp, CRASH_DIR, name), shell="bash")
+
+
+def _crash_events(sw1, process):
+    output = sw1("grep '|14001|' %s | grep -c '%s crashed due to'" %
+                 (EVENT_LOG, process), shell="bash")
+    return int(output.splitlines()[-1])
+
+
+def _start_recording(sw1, marker):
+    # a process of the library with a flight recorder, which logged an event
+    # holding the marker
+    script = ("import ops_eventlog, time; "
+              "ops_eventlog.event_log_init('SUPPORTABILITY'); "
+              "ops_eventlog.log_event('SUPPORTABILITY_CORE_EVICTED', "
+              "('process', 'ctfr'), ('file', '%s'), ('reason', 'test')); "
+              "time.sleep(600)" % marker)
+    output = sw1("python -c \"%s\" > /dev/null 2>&1 & echo $!" % script,
+                 shell="bash")
+    pid = int(output.splitlines()[-1])
+    sleep(2)
+    comm = sw1("cat /proc/%d/comm" % pid, shell="bash").splitlines()[-1]
+    return pid, comm.strip()
+
+
+def _write_script(sw1, lines, script):
+    sw1("rm -f %s" % script, shell="bash")
+    for line in lines:
+        sw1("echo '%s' >> %s" % (line, script), shell="bash")
+
+
+def _start_subscriber(sw1, output):
+    # a subscriber of the crash notification socket, which prints the first
+    # notification received
+    script = ("import socket; "
+              "s = socket.socket(socket.AF_UNIX, socket.SOCK_SEQPACKET); "
+              "s.connect('%s'); s.settimeout(30); "
+              "print(s.recv(4096).decode())" % CRASH_NOTIFY_SOCKET)
+    sw1("python -c \"%s\" > %s 2>&1 &" % (script, output), shell="bash")
+    sleep(1)
+
+
+def check_core_dump_index(sw1):
+    print("\n############################################")
+    print("1.1 Running Core Dump Index Test")
+    print("############################################\n")
+
+    sw1("mkdir -p %s; rm -f %s/core.ctidx.*" % (CORE_DIR, CORE_DIR),
+        shell="bash")
+    now = _now_usecs(sw1)
+    pids = [41001, 41002, 41003]
+    for pid in pids:
+        _add_core(sw1, _core_name("ctidx", pid, now))
+
+    # cores added on disk are listed by the running session
+    output = sw1("show core-dump")
+    for pid in pids:
+        assert str(pid) in output
+    assert "ctidx" in output
+
+    # the index is saved, and a new session starts from it
+    output = sw1("test -s %s && echo saved" % CORE_INDEX, shell="bash")
+    assert "saved" in output
+    output = sw1("vtysh -c 'show core-dump'", shell="bash")
+    for pid in pids:
+        assert str(pid) in output
+
+    # a removed core is dropped from the listing and the saved index
+    sw1("rm -f %s/%s" % (CORE_DIR, _core_name("ctidx", pids[0], now)),
+        shell="bash")
+    output = sw1("show core-dump")
+    assert str(pids[0]) not in output
+    assert str(pids[1]) in output
+    output = sw1("vtysh -c 'show core-dump'", shell="bash")
+    assert str(pids[0]) not in output
+
+    sw1("rm -f %s/core.ctidx.*" % CORE_DIR, shell="bash")
+    output = sw1("show core-dump")
+    assert "ctidx" not in output
+
+
+def check_core_dump_malformed_names(sw1):
+    print("\n############################################")
+    print("1.6 Running Malformed Core Dump Name Test")
+    print("############################################\n")
+
+    sw1("rm -f %s/*ctbad* %s/core..11.*" % (CORE_DIR, CORE_DIR),
+        shell="bash")
+    now = _now_usecs(sw1)
+    good = {45001: _core_name("ctbad", 45001, now),
+            # dots belong to the daemon name
+            45002: _core_name("ct.bad", 45002, now).replace(".zst", "")}
+    name = _core_name("ctbad", 45100, now).replace(".zst", "")
+    bad = {45003: "core.ctbad.11.%s.45003" % BOOT_ID,
+           45004: "core.ctbad.x.%s.45004.%d" % (BOOT_ID, now),
+           45005: "core.ctbad.11.%szz.45005.%d" % (BOOT_ID, now),
+           123456789: "core.ctbad.11.%s.123456789.%d" % (BOOT_ID, now),
+           45006: name.replace("45100", "45006") + ".gz",
+           45007: "x" + name.replace("45100", "45007"),
+           45008: "core.ctbad.11.%s.45008.%d0" % (BOOT_ID, now * 10),
+           45009: name.replace("45100", "45009") + ".",
+           45010: "core.ctbad.11..45010.%d" % now,
+           45011: "core..11.%s.45011.%d" % (BOOT_ID, now),
+           45012: name.replace("45100", "45012") + ".zst.flightrec",
+           45013: name.replace("45100", "45013") + ".zst.sha256"}
+    for core in list(good.values()) + list(bad.values()):
+        _add_core(sw1, core)
+
+    # without extended attributes only a well formed name is listed
+    output = sw1("show core-dump")
+    print(output)
+    for pid in good:
+        assert str(pid) in output
+    assert "ct.bad" in output
+    for pid in bad:
+        assert str(pid) not in output
+
+    sw1("rm -f %s/*ctbad* %s/core..11.*" % (CORE_DIR, CORE_DIR),
+        shell="bash")
+
+
+def check_crash_processing_journal(sw1):
+    print("\n############################################")
+    print("1.2 Running Crash Processing Journal Test")
+    print("############################################\n")
+
+    sw1("rm -f %s/core.ctjrnl.*" % CRASH_DIR, shell="bash")
+    now = _now_usecs(sw1)
+    first = _core_name("ctjrnl", 42001, now).replace(".zst", "0")
+    # a prefix of the first name, the former substring match took it as
+    # processed
+    second = _core_name("ctjrnl", 42001, now).replace(".zst", "")
+    assert first.startswith(second)
+    events = _crash_events(sw1, "ctjrnl")
+
+    _add_crash(sw1, first, "ctjrnl")
+    sleep(2)
+    assert _crash_events(sw1, "ctjrnl") == events + 1
+    output = sw1("grep -cx '%s' %s" % (first, CRASH_JOURNAL), shell="bash")
+    assert output.splitlines()[-1] == "1"
+
+    _add_crash(sw1, second, "ctjrnl")
+    sleep(2)
+    assert _crash_events(sw1, "ctjrnl") == events + 2
+
+    # writes to the processed core dumps are not new crashes
+    sw1("for f in %s/core.ctjrnl.*; do echo >> $f; done" % CRASH_DIR,
+        shell="bash")
+    sleep(2)
+    assert _crash_events(sw1, "ctjrnl") == events + 2
+
+    sw1("rm -f %s/core.ctjrnl.*" % CRASH_DIR, shell="bash")
+
+
+def check_crash_processing_compressed(sw1):
+    print("\n############################################")
+    print("1.3 Running Compressed Core Dump Test")
+    print("############################################\n")
+
+    sw1("rm -f %s/core.ctxz.*" % CRASH_DIR, shell="bash")
+    raw = _core_name("ctxz", 43001, _now_usecs(sw1)).replace(".zst", "")
+
+    # a core dump systemd-coredump compressed is stored with zstd
+    _add_crash(sw1, raw + ".xz", "ctxz", compress="xz")
+    sleep(2)
+    output = sw1("ls %s/core.ctxz.*" % CRASH_DIR, shell="bash")
+    assert raw + ".zst" in output
+    assert raw + ".xz" not in output
+    # zstd frame magic
+    output = sw1("od -An -tx1 -N4 %s/%s.zst" % (CRASH_DIR, raw),
+                 shell="bash")
+    assert "28 b5 2f fd" in output
+    output = sw1("getfattr -n user.coredump.comm --only-values %s/%s.zst" %
+                 (CRASH_DIR, raw), shell="bash")
+    assert "ctxz" in output
+
+    # nothing could be unwound from a core dump which is no ELF file
+    output = sw1("show core-dump detail")
+    assert "Daemon Name  : ctxz" in output
+    section = output.split("Daemon Name  : ctxz")[1].split("=====")[0]
+    assert "Instance ID  : 43001" in section
+    assert "File         : %s.zst" % raw in section
+    assert "Signature    : Not available" in section
+    assert "Backtrace    : Not available" in section
+
+    sw1("rm -f %s/core.ctxz.*" % CRASH_DIR, shell="bash")
+
+
+def check_core_dump_retention(sw1):
+    print("\n############################################")
+    print("1.4 Running Core Dump Retention Test")
+    print("############################################\n")
+
+    # the shipped policy keeps 5 core dumps per daemon
+    sw1("rm -f %s/core.ctret.*" % CRASH_DIR, shell="bash")
+    now = _now_usecs(sw1)
+    pids = range(44001, 44008)
+    for pid in pids:
+        _add_crash(sw1, _core_name("ctret", pid, now).replace(".zst", ""),
+                   "ctret")
+        sleep(1)
+    sleep(2)
+
+    output = sw1("ls %s/core.ctret.*" % CRASH_DIR, shell="bash")
+    for pid in pids[:2]:
+        assert ".%d." % pid not in output
+    for pid in pids[2:]:
+        assert ".%d." % pid in output
+
+    # each eviction is logged
+    for pid in pids[:2]:
+        output = sw1("grep '|14002|' %s | grep -c 'Core dump %s of ctret "
+                     "removed, core dumps per daemon limit exceeded'" %
+                     (EVENT_LOG, _core_name("ctret", pid, now)),
+                     shell="bash")
+        assert int(output.splitlines()[-1]) == 1
+
+    sw1("rm -f %s/core.ctret.*" % CRASH_DIR, shell="bash")
+
+    # the shipped policy keeps core dumps 30 days, one reaching the limit is
+    # removed then even when no other core dump is stored
+    name = _core_name("ctret", 44010, now)
+    _add_crash(sw1, name, "ctret",
+               mtime=now // 1000000 - 30 * 24 * 60 * 60 + 6)
+    sleep(2)
+    output = sw1("ls %s/%s" % (CRASH_DIR, name), shell="bash")
+    assert "No such file or directory" not in output
+    sleep(8)
+    output = sw1("ls %s/%s" % (CRASH_DIR, name), shell="bash")
+    assert "No such file or directory" in output
+    output = sw1("grep '|14002|' %s | grep -c 'Core dump %s of ctret "
+                 "removed, age limit exceeded'" % (EVENT_LOG, name),
+                 shell="bash")
+    assert int(output.splitlines()[-1]) == 1
+
+    sw1("rm -f %s/core.ctret.*" % CRASH_DIR, shell="bash")
+
+
+def check_repeated_crashes(sw1):
+    print("\n############################################")
+    print("1.8 Running Repeated Crashes Test")
+    print("############################################\n")
+
+    # two stack signatures known to crash processing, a core dump compressed
+    # already carries its signature as a kept one does
+    sig_a = "00000000000ca11a"
+    sig_b = "00000000000ca11b"
+    sw1("systemctl stop ops_supportability", shell="bash")
+    sw1("rm -f %s/core.ctsig.*; touch %s; cp -p %s /tmp/ctsig.db" %
+        (CRASH_DIR, CRASH_SIGNATURES, CRASH_SIGNATURES), shell="bash")
+    sw1("echo '%s 0 0 ctsig ctsig+0x10' >> %s" % (sig_a, CRASH_SIGNATURES),
+        shell="bash")
+    sw1("echo '%s 0 0 ctsig ctsig+0x20' >> %s" % (sig_b, CRASH_SIGNATURES),
+        shell="bash")
+    sw1("systemctl start ops_supportability", shell="bash")
+    sleep(5)
+
+    # the first and the latest 2 core dumps of a signature are kept, a new
+    # one replaces the oldest kept one other than the first
+    now = _now_usecs(sw1)
+    names = {}
+    for i, pid in enumerate(range(48001, 48008)):
+        names[pid] = _core_name("ctsig", pid, now)
+        _add_crash(sw1, names[pid], "ctsig",
+                   signature=sig_a if pid < 48005 else sig_b,
+                   mtime=now // 1000000 - 1000 + i * 100)
+        sleep(2)
+        if pid == 48004:
+            output = sw1("ls %s/core.ctsig.*" % CRASH_DIR, shell="bash")
+            assert names[48002] not in output
+            for kept in (48001, 48003, 48004):
+                assert names[kept] in output
+            output = sw1("grep '^%s ' %s" % (sig_a, CRASH_SIGNATURES),
+                         shell="bash")
+            assert "%s 4 1 ctsig" % sig_a in output
+
+    # retention then keeps the same ones, the per daemon limit of 5 removes
+    # the core dump which is neither the first nor the latest of its
+    # signature
+    output = sw1("ls %s/core.ctsig.*" % CRASH_DIR, shell="bash")
+    assert names[48003] not in output
+    for kept in (48001, 48004, 48005, 48006, 48007):
+        assert names[kept] in output
+    output = sw1("grep '|14002|' %s | grep -c 'Core dump %s of ctsig "
+                 "removed, core dumps per daemon limit exceeded'" %
+                 (EVENT_LOG, names[48003]), shell="bash")
+    assert int(output.splitlines()[-1]) == 1
+
+    output = sw1("show core-dump")
+    print(output)
+    assert "first and the latest 2 core dumps of each are kept" in output
+    assert "ctsig+0x10" in output
+    assert "ctsig+0x20" not in output
+
+    sw1("systemctl stop ops_supportability", shell="bash")
+    sw1("rm -f %s/core.ctsig.*; mv /tmp/ctsig.db %s" %
+        (CRASH_DIR, CRASH_SIGNATURES), shell="bash")
+    sw1("systemctl start ops_supportability", shell="bash")
+    sleep(5)
+
+
+def check_flight_recorder(sw1):
+    print("\n############################################")
+    print("1.5 Running Flight Recorder Test")
+    print("############################################\n")
+
+    pid, comm = _start_recording(sw1, "ctfr-marker")
+    output = sw1("test -s %s%d && echo recording" % (FLIGHTREC, pid),
+                 shell="bash")
+    assert "recording" in output
+
+    # the recorder outlives the crash, and is stored with the core dump
+    sw1("kill -9 %d" % pid, shell="bash")
+    raw = _core_name(comm, pid, _now_usecs(sw1)).replace(".zst", "")
+    _add_crash(sw1, raw, comm)
+    sleep(2)
+    snapshot = "%s/%s.zst.flightrec" % (CRASH_DIR, raw)
+    output = sw1("grep -c ' event .*ctfr-marker' %s" % snapshot,
+                 shell="bash")
+    assert output.splitlines()[-1] == "1"
+    output = sw1("ls %s%d" % (FLIGHTREC, pid), shell="bash")
+    assert "No such file or directory" in output
+
+    output = sw1("show core-dump detail")
+    section = output.split("Instance ID  : %d" % pid)[1].split("=====")[0]
+    assert "Flight Recorder :" in section
+    assert "ctfr-marker" in section
+
+    # the snapshot goes with its core dump
+    sw1("rm -f %s/%s.zst" % (CRASH_DIR, raw), shell="bash")
+    sleep(2)
+    output = sw1("ls %s" % snapshot, shell="bash")
+    assert "No such file or directory" in output
+
+    # the recorder of a pid reused by another process is not taken
+    pid, comm = _start_recording(sw1, "ctfr-other")
+    sw1("kill -9 %d" % pid, shell="bash")
+    raw = _core_name("ctfrother", pid, _now_usecs(sw1)).replace(".zst", "")
+    _add_crash(sw1, raw, "ctfrother")
+    sleep(2)
+    output = sw1("ls %s/%s.zst.flightrec" % (CRASH_DIR, raw), shell="bash")
+    assert "No such file or directory" in output
+    output = sw1("ls %s%d" % (FLIGHTREC, pid), shell="bash")
+    assert "No such file or directory" in output
+
+    sw1("rm -f %s/%s*" % (CRASH_DIR, raw), shell="bash")
+
+
+def check_crash_notifications(sw1):
+    print("\n############################################")
+    print("1.7 Running Crash Notification Test")
+    print("############################################\n")
+
+    sw1("rm -f %s/core.ctntf.* %s*" % (CRASH_DIR, MONITOR_OUT), shell="bash")
+    output = sw1("test -S %s && echo listening" % CRASH_NOTIFY_SOCKET,
+                 shell="bash")
+    assert "listening" in output
+
+    # a subscriber gets the crash, once the core dump is stored
+    _start_subscriber(sw1, "/tmp/ctntf.out")
+    raw = _core_name("ctntf", 46001, _now_usecs(sw1)).replace(".zst", "")
+    _add_crash(sw1, raw, "ctntf", pid=46001)
+    sleep(3)
+    output = sw1("cat /tmp/ctntf.out", shell="bash")
+    print(output)
+    assert "process=ctntf" in output
+    assert "pid=46001" in output
+    assert "signal=11" in output
+    assert "status=stored" in output
+    assert "file=%s.zst" % raw in output
+    sw1("rm -f /tmp/ctntf.out", shell="bash")
+
+    # a core dump the retention policy removes as soon as it is stored, here
+    # older than the age limit, is announced as evicted
+    _start_subscriber(sw1, "/tmp/ctntf.out")
+    old = _core_name("ctntf", 46004, _now_usecs(sw1))
+    _add_crash(sw1, old, "ctntf", pid=46004,
+               mtime=_now_usecs(sw1) // 1000000 - 31 * 24 * 60 * 60)
+    sleep(3)
+    output = sw1("cat /tmp/ctntf.out", shell="bash")
+    print(output)
+    assert "pid=46004" in output
+    assert "status=evicted" in output
+    assert "file=%s" % old in output
+    output = sw1("ls %s/%s" % (CRASH_DIR, old), shell="bash")
+    assert "No such file or directory" in output
+    sw1("rm -f /tmp/ctntf.out", shell="bash")
+
+    # a session monitoring core dumps prints the alert at the prompt, and
+    # no more once it stopped monitoring
+    _write_script(sw1, MONITOR_SCRIPT, "/tmp/ctmon.py")
+    sw1("python /tmp/ctmon.py %s > /dev/null 2>&1 &" % MONITOR_OUT,
+        shell="bash")
+    sleep(5)
+    first = _core_name("ctntf", 46002, _now_usecs(sw1)).replace(".zst", "")
+    _add_crash(sw1, first, "ctntf", pid=46002)
+    sleep(3)
+    sw1("touch %s.stop" % MONITOR_OUT, shell="bash")
+    sleep(2)
+    second = _core_name("ctntf", 46003, _now_usecs(sw1)).replace(".zst", "")
+    _add_crash(sw1, second, "ctntf")
+    sleep(3)
+    sw1("touch %s.end" % MONITOR_OUT, shell="bash")
+    sleep(2)
+    output = sw1("cat %s" % MONITOR_OUT, shell="bash")
+    print(output)
+    assert "Crash notifications are not available" not in output
+    assert "ctntf (46002) crashed: Segmentation fault" in output
+    assert "Core dump %s.zst" % first in output
+    assert second not in output
+    # the crash was stored whether anyone monitored it or not
+    output = sw1("ls %s/core.ctntf.*" % CRASH_DIR, shell="bash")
+    assert second + ".zst" in output
+
+    sw1("rm -f %s/core.ctntf.* %s* /tmp/ctmon.py" % (CRASH_DIR, MONITOR_OUT),
+        shell="bash")
+
+
+@mark.gate
+def test_core_dump_listing(topology, step):
+    sw1 = topology.get('sw1')
+
+    assert sw1 is not None
+
+    step("Core dump index")
+    check_core_dump_index(sw1)
+
+    step("Crash processing journal")
+    check_crash_processing_journal(sw1)
+
+    step("Compressed core dumps")
+    check_crash_processing_compressed(sw1)
+
+    step("Core dump retention")
+    check_core_dump_retention(sw1)
+
+    step("Repeated crashes")
+    check_repeated_crashes(sw1)
+
+    step("Flight recorder")
+    check_flight_recorder(sw1)
+
+    step("Malformed core dump names")
+    check_core_dump_malformed_names(sw1)
+
+    step("Crash notifications")
+    check_crash_notifications(sw1)
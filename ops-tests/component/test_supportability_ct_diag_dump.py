@@ -47,6 +47,22 @@ def gen_shell_cmd_add_conf(daemon, feature):
     return shell_cmd
 
 
+# Generates shell command to write a config file of several features, each
+# given as (feature, [(daemon, diag_dump), ...])
+
+def gen_shell_cmd_write_conf(features):
+    conf = "\\n---\\n"
+    for feature, daemons in features:
+        conf += ("  -\\n    feature_name: '{}'\\n"
+                 "    feature_desc: 'Sample feature {}'\\n"
+                 "    daemon:\\n".format(feature, feature))
+        for daemon, diag in daemons:
+            conf += ("     - [name: '{}', 'diag_dump':'{}']\\n"
+                     "".format(daemon, diag))
+    return ("printf \"" + conf + "\" > "
+            "/etc/openswitch/supportability/ops_featuremapping.yaml")
+
+
 def check_unknown_command(output):
     assert match(".*(unknown command)", output, I) is not None
 
@@ -357,6 +373,48 @@ def check_corrupted_yaml_file(step, sw1):
     # check_unknown_command(output)
 
 
+def check_feature_mapping_lookup(step, sw1):
+    # Variables
+    features = [('ctf{}'.format(i), [('ops-lldpd', 'y')]) for i in range(40)]
+    # a feature supports diag dump if any of its daemons does
+    features.append(('ctmix', [('ops-fand', 'n'), ('ops-lldpd', 'y')]))
+    features.append(('ctoff', [('ops-fand', 'n')]))
+
+    step("\n############################################")
+    step("4.1 Running feature mapping lookup test")
+    step("############################################\n")
+
+    shell_cmd = gen_shell_cmd_backup_conf()
+    sw1(shell_cmd, shell='bash')
+    sw1(gen_shell_cmd_write_conf(features), shell='bash')
+    # changes are looked for once per second
+    sleep(2)
+
+    output = sw1('diag-dump list')
+    step(str(output))
+    listed = [line.split()[0] for line in output.splitlines()
+              if line.startswith('ct')]
+    assert listed == ['ctf{}'.format(i) for i in range(40)] + ['ctmix']
+
+    # every feature is found, whatever its place in the file
+    for feature in ['ctf0', 'ctf17', 'ctf39', 'ctmix']:
+        output = sw1('diag-dump ' + feature + ' basic')
+        assert 'Diagnostic dump captured for feature ' + feature in output
+        assert '[Start] Feature ' + feature in output
+
+    output = sw1('diag-dump ctf40 basic')
+    step(str(output))
+    assert 'ctf40 feature is not present' in output
+
+    shell_cmd = gen_shell_cmd_restore_conf()
+    sw1(shell_cmd, shell='bash')
+    sleep(2)
+
+    output = sw1('diag-dump list')
+    assert 'ctf0' not in output
+    assert 'lldp' in output
+
+
 @mark.gate
 def test_supportability_diag_dump(topology, step):
     sw1 = topology.get("sw1")
@@ -391,3 +449,5 @@ def test_supportability_diag_dump(topology, step):
     check_empty_file(step, sw1)
 
     check_corrupted_yaml_file(step, sw1)
+
+    check_feature_mapping_lookup(step, sw1)
@@ -0,0 +1,178 @@
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License.
+
+from pytest import mark
+from time import sleep
+
+TOPOLOGY = """
+#
+# +-------+
+# |  sw1  |
+# +-------+
+#
+
+# Nodes
+[type=openswitch name="Switch 1"] sw1
+"""
+
+FEATURE_CONF = "/etc/openswitch/supportability/ops_featuremapping.yaml"
+FEATURE_CONF_BACKUP = "/tmp/ctospf_featuremapping.yaml"
+RUN_DIR = "/var/run/openvswitch"
+DAEMON = "ops-ctospf"
+DAEMON_LOG = "/tmp/ctospf.log"
+
+# A stand-in for the ospfv2 daemon, which logs each request with the number
+# of the connection it came on, and fails the redistribute category. The
+# log is appended to, so that it can be emptied meanwhile. It exits when
+# <log>.end appears.
+DAEMON_SCRIPT = [
+    "import os, sys",
+    "import ovs.poller, ovs.unixctl, ovs.unixctl.server",
+    "log = open(sys.argv[1], \"a\")",
+    "conns = [0]",
+    "def request(conn, argv, cmd):",
+    "    if not hasattr(conn, \"ctseq\"):",
+    "        conns[0] += 1",
+    "        conn.ctseq = conns[0]",
+    "    log.write(\"%d %s\\n\" % (conn.ctseq, \" \".join([cmd] + argv)))",
+    "    log.flush()",
+    "    if \"redistribute\" in argv:",
+    "        conn.reply_error(\"ctospf refused \" + \" \".join(argv))",
+    "    else:",
+    "        conn.reply(\"ctospf \" + \" \".join([cmd] + argv))",
+    "for cmd in [\"ospf/debug\", \"ospf/no-debug\", \"ospf/show-debug\",",
+    "            \"debug-ring/mode\", \"debug-ring/dump\"]:",
+    "    ovs.unixctl.command_register(cmd, \"\", 0, 4, request, cmd)",
+    "ctl = \"%s/%s.%d.ctl\" % (sys.argv[2], sys.argv[3], os.getpid())",
+    "error, server = ovs.unixctl.server.UnixctlServer.create(ctl)",
+    "pidfile = \"%s/%s.pid\" % (sys.argv[2], sys.argv[3])",
+    "open(pidfile, \"w\").write(\"%d\\n\" % os.getpid())",
+    "while not os.path.exists(sys.argv[1] + \".end\"):",
+    "    server.run()",
+    "    poller = ovs.poller.Poller()",
+    "    server.wait(poller)",
+    "    poller.timer_wait(500)",
+    "    poller.block()",
+    "server.close()",
+    "os.remove(pidfile)",
+]
+
+PROFILES = {
+    "adjacency": ["ism", "nsm", "packet hello", "packet dd"],
+    "flooding": ["lsa flooding", "packet ls-request", "packet ls-update",
+                 "packet ls-ack"],
+    "routing": ["lsa generate", "lsa install", "event", "interface",
+                "redistribute"],
+    "all": ["packet all", "ism", "nsm", "lsa", "event", "nssa", "interface",
+            "redistribute"],
+}
+
+
+def _write_script(sw1, lines, script):
+    sw1("rm -f %s" % script, shell="bash")
+    for line in lines:
+        sw1("echo '%s' >> %s" % (line, script), shell="bash")
+
+
+def _requests(sw1):
+    # the requests received since the last call, as (connection, request)
+    output = sw1("cat %s; > %s" % (DAEMON_LOG, DAEMON_LOG), shell="bash")
+    requests = []
+    for line in output.splitlines():
+        words = line.split(" ", 1)
+        if len(words) == 2 and words[0].isdigit():
+            requests.append((int(words[0]), words[1]))
+    return requests
+
+
+def _config(sw1, command):
+    sw1("configure terminal")
+    output = sw1(command)
+    sw1("end")
+    return output
+
+
+def check_ospf_debug_profiles(sw1):
+    print("\n############################################")
+    print("1.1 OSPFv2 debug profiles and capture")
+    print("############################################\n")
+
+    # The ospfv2 feature is mapped to the stand-in daemon, the mapping is
+    # read again as it changed on disk
+    sw1("cp %s %s" % (FEATURE_CONF, FEATURE_CONF_BACKUP), shell="bash")
+    sw1("sed -i '/feature_name: \"ospfv2\"/,/ops-ospfd/ s/ops-ospfd/%s/' %s"
+        % (DAEMON, FEATURE_CONF), shell="bash")
+    _write_script(sw1, DAEMON_SCRIPT, "/tmp/ctospf.py")
+    sw1("rm -f %s*; python /tmp/ctospf.py %s %s %s > /dev/null 2>&1 &"
+        % (DAEMON_LOG, DAEMON_LOG, RUN_DIR, DAEMON), shell="bash")
+    sleep(3)
+    _requests(sw1)
+
+    # A profile turns its categories on over a single connection
+    for profile in ["adjacency", "flooding", "all"]:
+        output = _config(sw1, "debug ospfv2 profile %s" % profile)
+        requests = _requests(sw1)
+        print(requests)
+        assert len(set(conn for conn, request in requests)) == 1
+        assert [request for conn, request in requests] == \
+            ["ospf/debug ospfv2 %s" % c for c in PROFILES[profile]]
+        assert "ctospf ospf/debug ospfv2 %s" % PROFILES[profile][0] in output
+    assert "daemon %s failed 1 of 8 requests" % DAEMON in output
+
+    # The no form turns them off, a request refused is reported and the
+    # others are still sent
+    output = _config(sw1, "no debug ospfv2 profile routing")
+    requests = _requests(sw1)
+    print(requests)
+    assert len(set(conn for conn, request in requests)) == 1
+    assert [request for conn, request in requests] == \
+        ["ospf/no-debug ospfv2 %s" % c for c in PROFILES["routing"]]
+    assert "daemon %s failed 1 of 5 requests" % DAEMON in output
+
+    # A single category is sent as before
+    _config(sw1, "debug ospfv2 ism")
+    assert [request for conn, request in _requests(sw1)] == \
+        ["ospf/debug ospfv2 ism"]
+
+    # The capture commands drive the debug ring of the daemon
+    _config(sw1, "debug ospfv2 capture ring 256")
+    _config(sw1, "debug ospfv2 capture ring")
+    _config(sw1, "no debug ospfv2 capture")
+    output = sw1("show debugging ospfv2 capture")
+    assert "ctospf debug-ring/dump" in output
+    sw1("clear debugging ospfv2 capture")
+    assert [request for conn, request in _requests(sw1)] == \
+        ["debug-ring/mode ring 256", "debug-ring/mode ring",
+         "debug-ring/mode log", "debug-ring/dump", "debug-ring/dump clear"]
+
+    # A daemon which is not running is reported
+    sw1("touch %s.end" % DAEMON_LOG, shell="bash")
+    sleep(2)
+    output = _config(sw1, "debug ospfv2 profile adjacency")
+    assert "failed to connect daemon %s" % DAEMON in output
+
+    sw1("cp %s %s" % (FEATURE_CONF_BACKUP, FEATURE_CONF), shell="bash")
+    sw1("rm -f %s %s* /tmp/ctospf.py" % (FEATURE_CONF_BACKUP, DAEMON_LOG),
+        shell="bash")
+
+
+@mark.gate
+def test_ospf_debug(topology, step):
+    sw1 = topology.get('sw1')
+
+    assert sw1 is not None
+
+    step("OSPFv2 debug profiles")
+    check_ospf_debug_profiles(sw1)
@@ -14,6 +14,7 @@
 #    under the License.
 
 from pytest import mark
+from time import sleep
 import uuid
 
 TOPOLOGY = """
@@ -39,6 +40,36 @@ def check_show_tech_list(sw1):
     assert "Show Tech Supported Features List" in output
 
 
+def check_show_tech_list_reload(sw1):
+    print("\n############################################")
+    print("1.10 Running Show Tech List Reload Test")
+    print("############################################\n")
+
+    sw1("cp /etc/openswitch/supportability/ops_showtech.yaml \
+    /etc/openswitch/supportability/ops_showtech.yaml2", shell="bash")
+
+    # A feature added on disk is listed and looked up without a restart
+    command = "printf '\\n  feature:\\n  -\\n    feature_desc: \"stlist\"\\n" \
+              "    feature_name: list1234\\n    cli_cmds:\\n" \
+              "      - \"show version\"\\n' >> " \
+              "/etc/openswitch/supportability/ops_showtech.yaml"
+    sw1(command, shell="bash")
+    output = sw1("show tech list")
+    assert "list1234" in output
+    output = sw1("show tech list1234")
+    assert "Show Tech commands executed successfully" in output
+
+    # and dropped again once the file is restored
+    sw1("mv \
+    /etc/openswitch/supportability/ops_showtech.yaml2 \
+    /etc/openswitch/supportability/ops_showtech.yaml", shell="bash")
+    output = sw1("show tech list")
+    assert "Show Tech Supported Features List" in output
+    assert "list1234" not in output
+    output = sw1("show tech list1234")
+    assert "is not supported" in output
+
+
 def check_show_tech(sw1):
     print("\n############################################")
     print("1.2 Running Show Tech Test")
@@ -107,6 +138,293 @@ def check_show_tech_feature_lag(sw1):
     assert "Show Tech commands executed successfully" in output
 
 
+def _diff_lines(output):
+    return [line.rstrip("\r") for line in output.splitlines()]
+
+
+def check_show_tech_diff(sw1):
+    print("\n############################################")
+    print("1.8 Running Show tech diff Test ")
+    print("############################################\n")
+
+    sw1("rm -rf /var/diagnostics/showtech", shell="bash")
+
+    # First run has no previous capture, every command is new
+    output = sw1("show tech diff basic")
+    assert "0 changed" in output
+    assert "0 unchanged" in output
+
+    # Second run only reports the commands whose output changed
+    output = sw1("show tech diff basic")
+    assert "0 new" in output
+    assert "Show Tech diff :" in output
+
+    # Two features reading the same file, each with its own reference
+    sw1("cp /etc/openswitch/supportability/ops_showtech.yaml \
+    /etc/openswitch/supportability/ops_showtech.yaml2", shell="bash")
+    sw1("printf 'one\\ntwo\\nthree\\n' > /tmp/st_diff", shell="bash")
+    for name in ["diff1234", "diff5678"]:
+        command = "printf '\\n  feature:\\n  -\\n" \
+                  "    feature_desc: \"stdiff\"\\n" \
+                  "    feature_name: " + name + "\\n    cli_cmds:\\n" \
+                  "      - \"bashcat /tmp/st_diff\"\\n' >> " \
+                  "/etc/openswitch/supportability/ops_showtech.yaml"
+        sw1(command, shell="bash")
+    output = sw1("show tech diff diff1234")
+    assert "0 changed, 1 new, 0 unchanged" in output
+    output = sw1("show tech diff diff5678")
+    assert "0 changed, 1 new, 0 unchanged" in output
+
+    # The reference of a feature survives the diff of another one
+    output = sw1("show tech diff diff1234")
+    assert "0 changed, 0 new, 1 unchanged" in output
+
+    # A changed line is shown as a hunk against the previous capture
+    sw1("printf 'one\\nTWO\\nthree\\n' > /tmp/st_diff", shell="bash")
+    output = sw1("show tech diff diff1234")
+    sw1("mv \
+    /etc/openswitch/supportability/ops_showtech.yaml2 \
+    /etc/openswitch/supportability/ops_showtech.yaml", shell="bash")
+    sw1("rm -f /tmp/st_diff", shell="bash")
+    print(output)
+    assert "Command : bashcat /tmp/st_diff (changed)" in output
+    assert "1 changed, 0 new, 0 unchanged" in output
+    lines = _diff_lines(output)
+    start = lines.index("--- bashcat /tmp/st_diff (previous)")
+    assert lines[start:start + 7] == [
+        "--- bashcat /tmp/st_diff (previous)",
+        "+++ bashcat /tmp/st_diff (current)",
+        "@@ -1,4 +1,4 @@",
+        " one",
+        "-two",
+        "+TWO",
+        " three"]
+
+
+def check_support_bundle(sw1):
+    print("\n############################################")
+    print("1.9 Running Support bundle Test ")
+    print("############################################\n")
+
+    sw1("rm -rf /var/diagnostics/support-bundle", shell="bash")
+
+    output = sw1("support-bundle create ct_bundle")
+    assert "stored in /var/diagnostics/support-bundle/ct_bundle.tar.zst" \
+        in output
+
+    # The manifest is the last member and lists show tech, collected
+    # before the diag dumps
+    output = sw1("zstd -dc /var/diagnostics/support-bundle/ct_bundle.tar.zst"
+                 " | tar -xOf - MANIFEST", shell="bash")
+    assert "name: showtech.txt" in output
+    assert "timed out" not in output
+
+    # An existing bundle is never overwritten
+    output = sw1("support-bundle create ct_bundle")
+    assert "already exists" in output
+
+    # Core dumps can be left out
+    output = sw1("support-bundle create ct_nocore core-dumps none")
+    assert "(0 core dumps)" in output
+    output = sw1("zstd -dc /var/diagnostics/support-bundle/ct_nocore.tar.zst"
+                 " | tar -tf -", shell="bash")
+    assert "coredump/" not in output
+    sw1("rm -rf /var/diagnostics/support-bundle", shell="bash")
+
+
+def check_show_tech_command_keys(sw1):
+    print("\n############################################")
+    print("1.11 Running Show tech Command Keys Test ")
+    print("############################################\n")
+
+    sw1("cp /etc/openswitch/supportability/ops_showtech.yaml \
+    /etc/openswitch/supportability/ops_showtech.yaml2", shell="bash")
+    sw1("echo st_low > /tmp/st_keys_low; echo st_crit > /tmp/st_keys_crit; "
+        "seq 1000 > /tmp/st_keys_big; rm -f /tmp/st_keys_hang; "
+        "mkfifo /tmp/st_keys_hang", shell="bash")
+
+    command = "printf '\\n  feature:\\n  -\\n    feature_desc: \"stkeys\"\\n" \
+              "    feature_name: keys1234\\n    cli_cmds:\\n" \
+              "      - command: \"bashcat /tmp/st_keys_low\"\\n" \
+              "        priority: low\\n" \
+              "      - command: \"bashcat /tmp/st_keys_big\"\\n" \
+              "        max_output_bytes: 100\\n" \
+              "      - command: \"bashcat /tmp/st_keys_hang\"\\n" \
+              "        timeout: 2\\n" \
+              "      - command: \"bashcat /tmp/st_keys_crit\"\\n" \
+              "        priority: critical\\n" \
+              "' >> /etc/openswitch/supportability/ops_showtech.yaml"
+    sw1(command, shell="bash")
+
+    output = sw1("show tech keys1234")
+
+    sw1("mv \
+    /etc/openswitch/supportability/ops_showtech.yaml2 \
+    /etc/openswitch/supportability/ops_showtech.yaml", shell="bash")
+    sw1("rm -f /tmp/st_keys_*", shell="bash")
+
+    # priority: critical first and low last, under a single banner
+    assert output.count("[Begin] Feature keys1234") == 1
+    assert output.count("[End] Feature keys1234") == 1
+    crit = output.index("Command : bashcat /tmp/st_keys_crit")
+    big = output.index("Command : bashcat /tmp/st_keys_big")
+    low = output.index("Command : bashcat /tmp/st_keys_low")
+    assert crit < big < low
+
+    # max_output_bytes: the output is cut at a line boundary
+    assert "[Output truncated," in output
+    assert "\n999\n" not in output.replace("\r", "")
+
+    # timeout: the command is reported as the only failed one
+    assert "Command bashcat /tmp/st_keys_hang Timed Out" in output
+    assert "1 show tech command failed to execute" in output
+    failed = output[output.index("Failed command:"):]
+    assert "1. bashcat /tmp/st_keys_hang" in failed
+    assert "2." not in failed
+
+
+def _uptime_after(output, command):
+    # /proc/uptime read by command, the first line of output after its
+    # banner which is not made of stars
+    lines = output.replace("\r", "").split("\n")
+    start = lines.index("Command : " + command)
+    for line in lines[start + 1:]:
+        if line and not line.startswith("*"):
+            return float(line.split()[0])
+    return None
+
+
+def check_show_tech_priority_order(sw1):
+    print("\n############################################")
+    print("1.13 Running Show tech Priority Order Test ")
+    print("############################################\n")
+
+    sw1("cp /etc/openswitch/supportability/ops_showtech.yaml \
+    /etc/openswitch/supportability/ops_showtech.yaml2", shell="bash")
+    sw1("rm -f /tmp/st_order_hang; mkfifo /tmp/st_order_hang", shell="bash")
+
+    # The critical command of the last feature runs before the normal ones
+    # of the first feature, which wait 2 secs for a fifo first
+    command = "printf -- '---\\n  feature:\\n  -\\n" \
+              "    feature_desc: \"order1\"\\n" \
+              "    feature_name: order1\\n    cli_cmds:\\n" \
+              "      - command: \"bashcat /tmp/st_order_hang\"\\n" \
+              "        timeout: 2\\n" \
+              "      - \"bashcat /proc/uptime\"\\n\\n" \
+              "  feature:\\n  -\\n" \
+              "    feature_desc: \"order2\"\\n" \
+              "    feature_name: order2\\n    cli_cmds:\\n" \
+              "      - command: \"bashcat /proc/self/../uptime\"\\n" \
+              "        priority: critical\\n' > " \
+              "/etc/openswitch/supportability/ops_showtech.yaml"
+    sw1(command, shell="bash")
+
+    output = sw1("show tech")
+
+    sw1("mv \
+    /etc/openswitch/supportability/ops_showtech.yaml2 \
+    /etc/openswitch/supportability/ops_showtech.yaml", shell="bash")
+    sw1("rm -f /tmp/st_order_hang", shell="bash")
+    print(output)
+
+    critical = _uptime_after(output, "bashcat /proc/self/../uptime")
+    normal = _uptime_after(output, "bashcat /proc/uptime")
+    assert critical is not None and normal is not None
+    assert normal - critical >= 1.5
+
+    # the output keeps the order of the configuration
+    assert output.index("[Begin] Feature order1") < \
+        output.index("Command : bashcat /proc/uptime") < \
+        output.index("[End] Feature order1") < \
+        output.index("[Begin] Feature order2") < \
+        output.index("Command : bashcat /proc/self/../uptime")
+    assert "Command bashcat /tmp/st_order_hang Timed Out" in output
+
+
+def _config_row(sw1, name):
+    output = sw1("show supportability configuration")
+    for line in output.splitlines():
+        if line.startswith(name + " "):
+            return line[len(name):].split()
+    return []
+
+
+def check_supportability_configuration(sw1):
+    print("\n############################################")
+    print("1.12 Running Supportability Configuration Reload Test")
+    print("############################################\n")
+
+    row = _config_row(sw1, "feature mapping")
+    assert row[-1] == "OK"
+    row = _config_row(sw1, "show tech")
+    assert row[-1] == "OK"
+    generation = int(row[0])
+
+    # a broken file is reported, and never replaces the working one
+    sw1("cp /etc/openswitch/supportability/ops_showtech.yaml \
+    /etc/openswitch/supportability/ops_showtech.yaml2", shell="bash")
+    sw1("printf 'values: [ : : {\\n' > "
+        "/etc/openswitch/supportability/ops_showtech.yaml", shell="bash")
+    # changes are looked for once per second
+    sleep(2)
+    row = _config_row(sw1, "show tech")
+    assert int(row[0]) == generation
+    assert "Invalid, 1 failed loads" in " ".join(row)
+    output = sw1("show tech list")
+    assert "Show Tech Supported Features List" in output
+    assert "basic" in output
+
+    # the file put back in place is loaded again
+    sw1("mv \
+    /etc/openswitch/supportability/ops_showtech.yaml2 \
+    /etc/openswitch/supportability/ops_showtech.yaml", shell="bash")
+    sleep(2)
+    row = _config_row(sw1, "show tech")
+    assert int(row[0]) == generation + 1
+    assert row[-1] == "OK"
+
+
+def check_show_tech_hung_command(sw1):
+    print("\n############################################")
+    print("2.6 Running Show tech Hung Command Test ")
+    print("############################################\n")
+
+    sw1("cp /etc/openswitch/supportability/ops_showtech.yaml \
+    /etc/openswitch/supportability/ops_showtech.yaml2", shell="bash")
+
+    # Reading a fifo without a writer never returns, one more command than
+    # there are executor workers
+    cmds = ""
+    for i in range(5):
+        sw1("rm -f /tmp/st_hang%d; mkfifo /tmp/st_hang%d" % (i, i),
+            shell="bash")
+        cmds += "      - command: \"bashcat /tmp/st_hang%d\"\\n" \
+                "        timeout: 2\\n" % i
+    command = "printf '\\n  feature:\\n  -\\n    feature_desc: \"sthang\"\\n" \
+              "    feature_name: hang1234\\n    cli_cmds:\\n" + cmds + \
+              "' >> /etc/openswitch/supportability/ops_showtech.yaml"
+    sw1(command, shell="bash")
+
+    output = sw1("show tech hang1234")
+    for i in range(5):
+        assert "Command bashcat /tmp/st_hang%d Timed Out" % i in output
+
+    # The children were killed, nobody holds the fifos any more
+    output = sw1("fuser /tmp/st_hang0 /tmp/st_hang1 /tmp/st_hang2 "
+                 "/tmp/st_hang3 /tmp/st_hang4; echo rc=$?", shell="bash")
+    assert "rc=1" in output
+
+    # The hung commands do not hold the workers
+    output = sw1("show tech basic")
+
+    sw1("mv \
+    /etc/openswitch/supportability/ops_showtech.yaml2 \
+    /etc/openswitch/supportability/ops_showtech.yaml", shell="bash")
+    sw1("rm -f /tmp/st_hang*", shell="bash")
+
+    assert "Show Tech commands executed successfully" in output
+
+
 def check_invalid_command_failure(sw1):
     print("\n############################################")
     print("2.1 Running Show tech Cli Command Failure")
@@ -259,6 +577,7 @@ def test_showtech(topology, step):
 
     step("Positive TestCases")
     check_show_tech_list(sw1)
+    check_show_tech_list_reload(sw1)
 
     # removing show tech test case since it is redundant to show tech localfile
     # check_show_tech(sw1)
@@ -270,6 +589,12 @@ def test_showtech(topology, step):
 
     check_show_tech_to_file(sw1)
 
+    check_show_tech_command_keys(sw1)
+    check_show_tech_priority_order(sw1)
+    check_supportability_configuration(sw1)
+    check_show_tech_diff(sw1)
+    check_support_bundle(sw1)
+
     step("Failure Test Cases")
     check_invalid_command_failure(sw1)
 
@@ -277,6 +602,8 @@ def test_showtech(topology, step):
 
     check_show_tech_un_supported_feature(sw1)
 
+    check_show_tech_hung_command(sw1)
+
     # def test_unsupported_subfeature(self):
     #   global sw1
     #    assert(check_show_tech_un_supported_sub_feature(sw1))
@@ -0,0 +1,87 @@
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the 'License');
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# 'AS IS' BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+# Checks the layout of a file written by copy core-dump kernel zstd: zstd
+# frames each preceded by a skippable frame holding its compressed size, as
+# pzstd writes them.
+#
+# Usage : python pzstd_frames.py FILE
+#
+# Prints
+#   frames <n> content <bytes>
+# where content is the sum of the content sizes the frame headers declare,
+# or
+#   bad <offset> <reason>
+
+import struct
+import sys
+
+SKIPPABLE_MAGIC = 0x184D2A50
+ZSTD_MAGIC = 0xFD2FB528
+
+
+def content_size(data, pos):
+    # frame header descriptor, RFC 8878 section 3.1.1.1.1
+    fhd = struct.unpack('<B', data[pos + 4:pos + 5])[0]
+    fcs_flag = fhd >> 6
+    single_segment = (fhd >> 5) & 1
+    at = pos + 5
+    if not single_segment:
+        at += 1
+    at += [0, 1, 2, 4][fhd & 3]
+    if fcs_flag == 0:
+        if not single_segment:
+            return None
+        return struct.unpack('<B', data[at:at + 1])[0]
+    if fcs_flag == 1:
+        return struct.unpack('<H', data[at:at + 2])[0] + 256
+    if fcs_flag == 2:
+        return struct.unpack('<I', data[at:at + 4])[0]
+    return struct.unpack('<Q', data[at:at + 8])[0]
+
+
+def main():
+    with open(sys.argv[1], 'rb') as f:
+        data = f.read()
+    pos = 0
+    frames = 0
+    total = 0
+    while pos < len(data):
+        if len(data) - pos < 12:
+            print('bad %d truncated' % pos)
+            return 1
+        magic, size, frame_len = struct.unpack('<III', data[pos:pos + 12])
+        if magic != SKIPPABLE_MAGIC or size != 4:
+            print('bad %d no size frame' % pos)
+            return 1
+        pos += 12
+        if frame_len > len(data) - pos or \
+           struct.unpack('<I', data[pos:pos + 4])[0] != ZSTD_MAGIC:
+            print('bad %d no zstd frame' % pos)
+            return 1
+        size = content_size(data, pos)
+        if size is None:
+            print('bad %d no content size' % pos)
+            return 1
+        total += size
+        frames += 1
+        pos += frame_len
+    print('frames %d content %d' % (frames, total))
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
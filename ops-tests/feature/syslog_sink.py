@@ -0,0 +1,179 @@
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the 'License');
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# 'AS IS' BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+# Syslog server writing each message received on a line, over UDP or over
+# TCP with octet counting (RFC 6587), which can read slowly or not at all
+# to exercise the spools of the syslog forwarder.
+#
+# Usage : python syslog_sink.py [options]
+#   --address ADDR       address to listen on (default: 0.0.0.0)
+#   --port PORT          port to listen on (default: 514)
+#   --transport PROTO    udp (default) or tcp
+#   --out FILE           file the messages are written to
+#                        (default: /tmp/syslog_sink.out)
+#   --rcvbuf N           receive buffer of the sockets, in bytes
+#   --rate N             read at most N bytes per second over TCP
+#   --stall              accept TCP connections but never read them
+#
+# Besides the messages, the file gets the lines
+#   CONNECT              a TCP connection was accepted
+#   PARTIAL <n>          a TCP connection closed with n bytes of an
+#                        incomplete frame
+#   BAD <data>           a TCP frame did not start with its octet count,
+#                        the connection is closed
+
+import socket
+import sys
+import time
+
+READ_SIZE = 4096
+
+
+def parse_args(argv):
+    conf = {'address': '0.0.0.0', 'port': 514, 'transport': 'udp',
+            'out': '/tmp/syslog_sink.out', 'rcvbuf': 0, 'rate': 0,
+            'stall': False}
+    i = 1
+    while i < len(argv):
+        opt = argv[i]
+        if opt == '--stall':
+            conf['stall'] = True
+            i += 1
+            continue
+        value = argv[i + 1] if i + 1 < len(argv) else None
+        if value is None:
+            sys.exit('missing value of %s' % opt)
+        if opt == '--address':
+            conf['address'] = value
+        elif opt == '--port':
+            conf['port'] = int(value)
+        elif opt == '--transport':
+            conf['transport'] = value
+        elif opt == '--out':
+            conf['out'] = value
+        elif opt == '--rcvbuf':
+            conf['rcvbuf'] = int(value)
+        elif opt == '--rate':
+            conf['rate'] = int(value)
+        else:
+            sys.exit('unknown option %s' % opt)
+        i += 2
+    return conf
+
+
+class Output(object):
+    '''
+    The output file, flushed on each line so that it can be checked while
+    the sink runs
+    '''
+
+    def __init__(self, path):
+        self.f = open(path, 'w')
+
+    def write(self, line):
+        self.f.write(line + '\n')
+        self.f.flush()
+
+
+def serve_udp(conf, out, sock):
+    while True:
+        data, addr = sock.recvfrom(65536)
+        out.write(data.decode('utf-8', 'replace'))
+
+
+def frames(buf):
+    '''
+    Splits the octet counted frames at the start of buf
+
+    :return: the messages, the rest of buf, False if a frame is invalid
+    '''
+    msgs = []
+    while True:
+        space = buf.find(b' ')
+        if space < 0:
+            if len(buf) > 10 or not buf.isdigit() and buf:
+                return msgs, buf, False
+            return msgs, buf, True
+        count = buf[:space]
+        if not count.isdigit() or count.startswith(b'0'):
+            return msgs, buf, False
+        end = space + 1 + int(count)
+        if len(buf) < end:
+            return msgs, buf, True
+        msgs.append(buf[space + 1:end].decode('utf-8', 'replace'))
+        buf = buf[end:]
+
+
+def serve_tcp_conn(conf, out, conn):
+    out.write('CONNECT')
+    if conf['stall']:
+        # keep the connection open until the peer gives up
+        while True:
+            time.sleep(60)
+    buf = b''
+    start = time.time()
+    total = 0
+    while True:
+        data = conn.recv(READ_SIZE)
+        if not data:
+            break
+        buf += data
+        msgs, buf, valid = frames(buf)
+        for msg in msgs:
+            out.write(msg)
+        if not valid:
+            out.write('BAD ' + buf[:32].decode('utf-8', 'replace'))
+            buf = b''
+            break
+        if conf['rate']:
+            total += len(data)
+            ahead = float(total) / conf['rate'] - (time.time() - start)
+            if ahead > 0:
+                time.sleep(ahead)
+    if buf:
+        out.write('PARTIAL %d' % len(buf))
+    conn.close()
+
+
+def main():
+    conf = parse_args(sys.argv)
+    out = Output(conf['out'])
+    if conf['transport'] == 'tcp':
+        sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+    else:
+        sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if conf['rcvbuf']:
+        # set before listen(), the connections accepted inherit it
+        sock.setsockopt(socket.SOL_SOCKET, socket.SO_RCVBUF, conf['rcvbuf'])
+    sock.bind((conf['address'], conf['port']))
+    print('syslog sink listening on %s %s:%d' %
+          (conf['transport'], conf['address'], conf['port']))
+    sys.stdout.flush()
+
+    if conf['transport'] != 'tcp':
+        serve_udp(conf, out, sock)
+        return
+    sock.listen(5)
+    # one connection at a time, so that the messages are written in the
+    # order they were sent across reconnections
+    while True:
+        conn, addr = sock.accept()
+        serve_tcp_conn(conf, out, conn)
+
+
+if __name__ == '__main__':
+    main()
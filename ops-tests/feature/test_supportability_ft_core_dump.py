@@ -22,8 +22,10 @@ List of Test Cases
         a. Post Crash Processing (Event Generation)
         b. Show Core Dump
         c. Copy Core Dump
+        d. Copy Core Dump to a tftp server losing packets
 """
 
+from os import path
 from pytest import mark
 from time import sleep
 # from .helpers import wait_until_interface_up
@@ -52,6 +54,19 @@ sw1:sp1 -- hs1:if01
 # Helper Functions
 
 
+def _copy_script(host, script, execscript):
+    """
+    Writes a script of this directory on the host, line by line
+
+    :return: None
+    """
+    host('rm -f ' + execscript, shell='bash')
+    with open(script, 'r') as fi:
+        for line in fi:
+            line = line.rstrip('\n').replace("'", "'\\''")
+            host("echo '" + line + "' >> " + execscript, shell='bash')
+
+
 def _run_dummy_daemon(switch):
     """
     Creates a dummy daemon by copying watch binary to a random name
@@ -206,6 +221,16 @@ def test_core_dump(topology):
     # hs1('instance_id_value', shell='bash')
     assert show_cor_dump_found
 
+    # the crashing thread was unwound on the switch when the core was stored
+    detail = sw1('show core-dump detail')
+    print(detail)
+    assert 'Daemon Name  : ' + daemon_name in detail
+    section = detail.split('Daemon Name  : ' + daemon_name)[1]
+    section = section.split('=====')[0]
+    assert 'Backtrace    :' in section
+    assert 'Backtrace    : Not available' not in section
+    assert '#0 ' in section
+
     # copy core dump check <copy core dump function have multiple parameter
 
     # switch and host config initial
@@ -230,14 +255,23 @@ def test_core_dump(topology):
     print("ping-received : " + str(ping['received']))
 
     hs1('chmod 777 /var/lib/tftpboot', shell='bash')
-    hs1('touch /var/lib/tftpboot/abc.xz', shell='bash')
-    hs1('chmod 777 /var/lib/tftpboot/abc.xz', shell='bash')
+    hs1('touch /var/lib/tftpboot/abc.zst', shell='bash')
+    hs1('chmod 777 /var/lib/tftpboot/abc.zst', shell='bash')
+    # the server creates no files, the checksum needs one to be written to
+    hs1('touch /var/lib/tftpboot/abc.zst.sha256', shell='bash')
+    hs1('chmod 777 /var/lib/tftpboot/abc.zst.sha256', shell='bash')
+
+    # systemd-coredump compresses the core dump with xz, crash processing
+    # stores it compressed with zstd instead
+    xz_cores = sw1('ls /var/lib/systemd/coredump/core.' + daemon_name +
+                   '.*.xz 2>/dev/null | wc -l', shell='bash')
+    assert xz_cores.splitlines()[-1].strip() == '0'
 
     # switch's core dump file size
     core_dump_size_switch = sw1(
         'stat -c "%s" /var/lib/systemd/coredump/core.' +
         daemon_name +
-        '.*.xz',
+        '.*.zst',
         shell='bash')
 
     print("size_begin " + core_dump_size_switch + " size_end")
@@ -258,7 +292,7 @@ def test_core_dump(topology):
                                         instance_id=instance_id_value,
                                         transport='tftp',
                                         serveraddress='10.0.12.1',
-                                        filename='abc.xz')
+                                        filename='abc.zst')
     length_of_result = len(scd)
     if length_of_result < 1:
         assert False
@@ -274,10 +308,10 @@ def test_core_dump(topology):
 
     assert core_dump_copied
 
-    # STEP-2 login to host and check file present or not abc.xz
+    # STEP-2 login to host and check file present or not abc.zst
 
     comand_output = hs1(
-        'stat -c "%s %n" /var/lib/tftpboot/abc.xz',
+        'stat -c "%s %n" /var/lib/tftpboot/abc.zst',
         shell='bash')
     if "No such file or directory" in comand_output:
         assert False
@@ -285,7 +319,7 @@ def test_core_dump(topology):
     # STEP-3 confirm desire file present or not
 
     # STPE-4 Check file size is not Zero. [optional]
-    core_dump_size_host = hs1('stat -c "%s" /var/lib/tftpboot/abc.xz',
+    core_dump_size_host = hs1('stat -c "%s" /var/lib/tftpboot/abc.zst',
                               shell='bash')
 
     if "No such file or directory" in core_dump_size_host:
@@ -306,11 +340,62 @@ def test_core_dump(topology):
 
     assert equal_size_check
 
-    # STEP-6 delete the core dump from host-machine
-    hs1('rm -f /var/lib/tftpboot/abc.xz', shell='bash')
+    # STEP-6 the checksum stored next to the copy matches the core dump
+    sha256_switch = sw1(
+        'sha256sum /var/lib/systemd/coredump/core.' +
+        daemon_name + '.*.zst | cut -d" " -f1',
+        shell='bash').splitlines()[-1]
+    sha256_host = hs1('sha256sum /var/lib/tftpboot/abc.zst | cut -d" " -f1',
+                      shell='bash')
+    sha256_stored = hs1('cut -d" " -f1 /var/lib/tftpboot/abc.zst.sha256',
+                        shell='bash')
+    assert sha256_host == sha256_switch
+    assert 'No such file or directory' not in sha256_stored
+    assert sha256_stored == sha256_host
+
+    # STEP-7 delete the core dump from host-machine
+    hs1('rm -f /var/lib/tftpboot/abc.zst /var/lib/tftpboot/abc.zst.sha256',
+        shell='bash')
+
+    # STEP-8 copy again to a server losing data packets and acknowledgements,
+    # the lost blocks are sent again and the copy is still whole
+    script = path.dirname(path.abspath(__file__)) + '/tftp_server.py'
+    execscript = '/tmp/tftp_server.py'
+    _copy_script(hs1, script, execscript)
+    hs1('service tftpd-hpa stop; pkill -x in.tftpd; true', shell='bash')
+    hs1('mkdir -p /tmp/tftpdrop; rm -f /tmp/tftpdrop/*', shell='bash')
+    hs1('python ' + execscript + ' --root /tmp/tftpdrop --loss 5 '
+        '--drop-acks 7 --sessions 2 > /tmp/tftpdrop.log 2>&1 &',
+        shell='bash')
+    sleep(1)
+
+    scd = sw1.libs.vtysh.copy_core_dump(daemonname=daemon_name,
+                                        instance_id=instance_id_value,
+                                        transport='tftp',
+                                        serveraddress='10.0.12.1',
+                                        filename='abc.zst')
+    print("status : " + scd['status'])
+    print("reason : " + scd['reason'])
+    assert scd['status'] == 'success'
+    sleep(3)
+
+    log = hs1('cat /tmp/tftpdrop.log', shell='bash')
+    print(log)
+    assert 'done abc.zst ' in log
+    assert 'done abc.zst.sha256 ' in log
+    sha256_host = hs1('sha256sum /tmp/tftpdrop/abc.zst | cut -d" " -f1',
+                      shell='bash')
+    sha256_stored = hs1('cut -d" " -f1 /tmp/tftpdrop/abc.zst.sha256',
+                        shell='bash')
+    assert sha256_host == sha256_switch
+    assert sha256_stored == sha256_host
+
+    hs1('pkill -f ' + execscript + '; rm -rf /tmp/tftpdrop '
+        '/tmp/tftpdrop.log ' + execscript, shell='bash')
+    hs1('service tftpd-hpa start; true', shell='bash')
 
     # clean up the core dumps
     sw1('rm -f /var/diagnostics/coredump/core.' +
-        daemon_name + '.*.xz', shell='bash')
+        daemon_name + '.*.zst', shell='bash')
 
     # assert 0
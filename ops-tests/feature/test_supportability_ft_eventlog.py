@@ -14,6 +14,7 @@
 #    under the License.
 
 from pytest import mark
+from time import sleep
 
 TOPOLOGY = """
 #
@@ -26,6 +27,23 @@ TOPOLOGY = """
 [type=openswitch name="Switch 1"] sw1
 """
 
+EVENTS_YAML = "/etc/openswitch/supportability/ops_events.yaml"
+
+# A process logging an event each time /tmp/ctcw.<step> appears, for each
+# step given, with the file key ctcw-<step>
+RELOAD_SCRIPT = [
+    "import os, sys, time",
+    "import ops_eventlog",
+    "ops_eventlog.event_log_init(\"SUPPORTABILITY\")",
+    "for step in sys.argv[1:]:",
+    "    while not os.path.exists(\"/tmp/ctcw.\" + step):",
+    "        time.sleep(0.2)",
+    "    ops_eventlog.log_event(\"SUPPORTABILITY_CORE_EVICTED\",",
+    "                           (\"process\", \"ctcw\"),",
+    "                           (\"file\", \"ctcw-\" + step),",
+    "                           (\"reason\", \"test\"))",
+]
+
 
 # Negative test case for show events severity filter
 def evtlogfilter_severity_cli(sw1):
@@ -132,6 +150,46 @@ def evtlogfeature_cli(sw1):
     assert "LLDP Enabled" or "LLDP Disabled" in output
 
 
+# An event definition changed on disk applies to a running process
+def evtlog_reload(sw1):
+    print("\n############################################")
+    print(" Running Event Log Reload Test")
+    print("############################################\n")
+
+    sw1("rm -f /tmp/ctcw.* /tmp/ctcw.py", shell="bash")
+    for line in RELOAD_SCRIPT:
+        sw1("echo '%s' >> /tmp/ctcw.py" % line, shell="bash")
+    sw1("cp %s /tmp/ctcw.yaml" % EVENTS_YAML, shell="bash")
+    sw1("python /tmp/ctcw.py before after broken > /tmp/ctcw.log 2>&1 &",
+        shell="bash")
+    sleep(2)
+    sw1("touch /tmp/ctcw.before", shell="bash")
+    sleep(2)
+
+    sw1("sed -i 's/removed, {reason} exceeded/dropped, {reason} exceeded/' "
+        "%s" % EVENTS_YAML, shell="bash")
+    # changes are looked for once per second
+    sleep(2)
+    sw1("touch /tmp/ctcw.after", shell="bash")
+    sleep(2)
+
+    # a broken file leaves the events loaded before
+    sw1("printf 'values: [ : : {\\n' > %s" % EVENTS_YAML, shell="bash")
+    sleep(2)
+    sw1("touch /tmp/ctcw.broken", shell="bash")
+    sleep(2)
+
+    sw1("mv /tmp/ctcw.yaml %s" % EVENTS_YAML, shell="bash")
+    print(sw1("cat /tmp/ctcw.log", shell="bash"))
+    output = sw1("show events event-id 14002")
+    print(output)
+    sw1("rm -f /tmp/ctcw.*", shell="bash")
+
+    assert "Core dump ctcw-before of ctcw removed, test exceeded" in output
+    assert "Core dump ctcw-after of ctcw dropped, test exceeded" in output
+    assert "Core dump ctcw-broken of ctcw dropped, test exceeded" in output
+
+
 @mark.gate
 def test_ft_evtlog_feature(topology, step):
     sw1 = topology.get('sw1')
@@ -152,3 +210,6 @@ def test_ft_evtlog_feature(topology, step):
 
     step("Test show events severity negative test case")
     evtlogfilter_severity_cli(sw1)
+
+    step("Test event definitions reload")
+    evtlog_reload(sw1)
@@ -0,0 +1,167 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for copy core-dump kernel zstd.
+List of Test Cases
+    1. Copy a kernel core dump bundle recompressed with zstd to a tftp
+       server losing packets and verify the following
+        a. The copy is made of independent frames with their size
+        b. The frames hold the whole bundle, gunzipped
+        c. The checksum stored matches the copy
+    2. Copy a truncated bundle, the copy fails and no checksum is stored
+"""
+
+from os import path
+from pytest import mark
+from time import sleep
+
+TOPOLOGY = """
+
+#  +---------+       +--------+
+#  |         |       |        |
+#  |   sw1   |<----->|  hs1   |
+#  |         |       |        |
+#  +---------+       +--------+
+
+# Nodes
+[type=openswitch name="Switch 1"] sw1
+[type=host name="Host 1"] hs1
+
+# Ports
+[force_name=oobm] sw1:sp1
+
+# Links
+sw1:sp1 -- hs1:if01
+"""
+
+KERNEL_CORE_DIR = '/var/diagnostics/coredump/kernel-core'
+BUNDLE = 'vmcore.20161019.120000.tar.gz'
+COPY = 'vmcore.20161019.120000.tar.zst'
+TFTP_ROOT = '/tmp/kcore'
+BLOCK_SIZE = 1024 * 1024
+
+# Helper Functions
+
+
+def _copy_script(host, script, execscript):
+    """
+    Writes a script of this directory on the host, line by line
+
+    :return: None
+    """
+    host('rm -f ' + execscript, shell='bash')
+    with open(script, 'r') as fi:
+        for line in fi:
+            line = line.rstrip('\n').replace("'", "'\\''")
+            host("echo '" + line + "' >> " + execscript, shell='bash')
+
+
+def _make_bundle(sw1):
+    """
+    Writes a kernel core dump bundle, part random and part text as a kernel
+    log, large enough for several blocks
+
+    :return: size of the bundle gunzipped
+    """
+    sw1('mkdir -p ' + KERNEL_CORE_DIR + '; rm -f ' + KERNEL_CORE_DIR +
+        '/vmcore.*', shell='bash')
+    sw1('rm -rf /tmp/kbundle; mkdir /tmp/kbundle', shell='bash')
+    sw1('head -c 3000000 /dev/urandom > /tmp/kbundle/vmcore', shell='bash')
+    sw1('seq 1 400000 > /tmp/kbundle/dmesg.txt', shell='bash')
+    sw1('tar -C /tmp/kbundle -czf ' + KERNEL_CORE_DIR + '/' + BUNDLE +
+        ' vmcore dmesg.txt', shell='bash')
+    sw1('rm -rf /tmp/kbundle', shell='bash')
+    size = sw1('gzip -dc ' + KERNEL_CORE_DIR + '/' + BUNDLE + ' | wc -c',
+               shell='bash')
+    return int(size.splitlines()[-1])
+
+
+@mark.gate
+@mark.timeout(1800)
+@mark.platform_incompatible(['docker'])
+def test_copy_kernel_core_zstd(topology):
+    sw1 = topology.get('sw1')
+    hs1 = topology.get('hs1')
+    assert sw1 is not None
+    assert hs1 is not None
+
+    # Configure IP and bring UP host 1 interfaces
+    try:
+        hs1('ip addr flush eth1')
+        hs1.libs.ip.interface('if01', addr='10.0.12.1/24', up=True)
+
+        # Configure IP and bring UP switch 1 interfaces
+        with sw1.libs.vtysh.ConfigInterfaceMgmt() as ctx:
+            ctx.ip_static('10.0.12.2/24')
+    except:
+        print("Exception while setting the ip")
+    sleep(25)
+    ping = hs1.libs.ping.ping(1, '10.0.12.2')
+    print("ping-received : " + str(ping['received']))
+
+    script_loc = path.dirname(path.abspath(__file__))
+    _copy_script(hs1, script_loc + '/tftp_server.py', '/tmp/tftp_server.py')
+    _copy_script(hs1, script_loc + '/pzstd_frames.py', '/tmp/pzstd_frames.py')
+    hs1('service tftpd-hpa stop; pkill -x in.tftpd; true', shell='bash')
+    hs1('rm -rf ' + TFTP_ROOT + '; mkdir -p ' + TFTP_ROOT, shell='bash')
+    hs1('python /tmp/tftp_server.py --root ' + TFTP_ROOT + ' --loss 2 '
+        '> /tmp/kcore.log 2>&1 &', shell='bash')
+    sleep(1)
+
+    # STEP-1 the bundle is sent recompressed, under its name ending .tar.zst
+    size = _make_bundle(sw1)
+    sleep(1)
+    output = sw1('copy core-dump kernel zstd tftp 10.0.12.1')
+    print(output)
+    assert 'Copied ' + BUNDLE in output
+    assert 'checksum file not stored' not in output
+    sha256_copy = output.split('SHA-256 ')[1].split()[0]
+
+    # STEP-2 one frame per block, declaring the whole bundle gunzipped
+    frames = hs1('python /tmp/pzstd_frames.py ' + TFTP_ROOT + '/' + COPY,
+                 shell='bash')
+    print(frames)
+    assert 'frames %d content %d' % ((size + BLOCK_SIZE - 1) // BLOCK_SIZE,
+                                     size) in frames
+
+    # STEP-3 the checksum printed and stored is the one of the copy
+    sha256_host = hs1('sha256sum ' + TFTP_ROOT + '/' + COPY +
+                      ' | cut -d" " -f1', shell='bash')
+    sha256_stored = hs1('cut -d" " -f1 ' + TFTP_ROOT + '/' + COPY +
+                        '.sha256', shell='bash')
+    assert sha256_host.splitlines()[-1] == sha256_copy
+    assert sha256_stored.splitlines()[-1] == sha256_copy
+
+    # STEP-4 a truncated bundle fails the copy, nothing passes for complete
+    hs1('rm -f ' + TFTP_ROOT + '/*', shell='bash')
+    sw1('head -c 2000000 ' + KERNEL_CORE_DIR + '/' + BUNDLE + ' > /tmp/kb; '
+        'mv /tmp/kb ' + KERNEL_CORE_DIR + '/' + BUNDLE, shell='bash')
+    sleep(1)
+    output = sw1('copy core-dump kernel zstd tftp 10.0.12.1 short.tar.zst')
+    print(output)
+    assert 'Failed to copy ' + BUNDLE in output
+    assert 'compression failed, the copy is incomplete' in output
+    stored = hs1('ls ' + TFTP_ROOT, shell='bash')
+    assert 'short.tar.zst.sha256' not in stored
+
+    # clean up
+    sw1('rm -f ' + KERNEL_CORE_DIR + '/vmcore.*', shell='bash')
+    hs1('pkill -f /tmp/tftp_server.py; rm -rf ' + TFTP_ROOT +
+        ' /tmp/kcore.log /tmp/tftp_server.py /tmp/pzstd_frames.py',
+        shell='bash')
+    hs1('service tftpd-hpa start; true', shell='bash')
@@ -56,10 +56,11 @@ def _syslog_conf_no_conf(switch,
 
     sleep(1)
 
-    # verify that the configuration is reflected in the rsyslog remote file
-    rsysconf = switch("cat /etc/rsyslog.remote.conf", shell='bash')
+    # verify that the configuration is reflected in the syslog forwarder
+    remotes = switch("ovs-appctl -t ops_supportability syslog/stats",
+                     shell='bash')
 
-    if cmp_str not in rsysconf:
+    if cmp_str not in remotes:
         assert False
 
     # Remove configuration from the switch
@@ -70,10 +71,11 @@ def _syslog_conf_no_conf(switch,
 
     sleep(1)
 
-    # verify that the configuration is reflected in the rsyslog remote file
-    rsysconf = switch("cat /etc/rsyslog.remote.conf", shell='bash')
+    # verify that the configuration is reflected in the syslog forwarder
+    remotes = switch("ovs-appctl -t ops_supportability syslog/stats",
+                     shell='bash')
 
-    if cmp_str in rsysconf:
+    if cmp_str in remotes:
         assert False
 
 
@@ -90,7 +92,7 @@ def test_logging_default(topology):
 
     # Send configuration for syslog
     _syslog_conf_no_conf(switch=sw1,
-                         cmp_str='*.info @10.0.0.8:514',
+                         cmp_str='udp 10.0.0.8:514 info',
                          rmt_host='10.0.0.8'
                          )
 
@@ -107,7 +109,7 @@ def test_logging_severity(topology):
 
     # Send configuration for syslog
     _syslog_conf_no_conf(switch=sw1,
-                         cmp_str='*.err @10.0.0.9:514',
+                         cmp_str='udp 10.0.0.9:514 err',
                          rmt_host='10.0.0.9',
                          svrty=' severity err ')
 
@@ -124,7 +126,7 @@ def test_logging_transport(topology):
 
     # Send configuration for syslog
     _syslog_conf_no_conf(switch=sw1,
-                         cmp_str='*.info @@10.0.0.10:10942',
+                         cmp_str='tcp 10.0.0.10:10942 info',
                          rmt_host='10.0.0.10',
                          trnsprt=' tcp 10942 ')
 
@@ -142,7 +144,7 @@ def test_logging_transport_and_severity(topology):
 
     # Send configuration for syslog
     _syslog_conf_no_conf(switch=sw1,
-                         cmp_str='*.warning @@10.0.0.11:429',
+                         cmp_str='tcp 10.0.0.11:4292 warning',
                          rmt_host='10.0.0.11',
                          trnsprt=' tcp 4292 ',
                          svrty=' severity warn')
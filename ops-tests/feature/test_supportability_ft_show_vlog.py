@@ -26,12 +26,14 @@ List of Test Cases
 1.5 Test the show vlog configuration list.
 1.6 Test the show vlog daemon with severity.
 1.7 Test the show vlog severity with daemon.
+1.8 Test the show vlog last, since, until and match filters.
 2.0 Test the show vlog invalid daemon.
 2.1 Test the show vlog invalid severity level.
 2.2 Test the show vlog invalid sub-command.
 """
 from __future__ import unicode_literals, absolute_import
 from __future__ import print_function, division
+from re import findall
 from time import sleep
 from pytest import mark
 
@@ -49,6 +51,18 @@ TOPOLOGY = """
 """
 
 
+def _log_vlogs(ops1, daemon, marks):
+    # as a daemon logs through syslog, with the vlog prefix
+    for mark_ in marks:
+        ops1("logger -t %s -p daemon.info 'ovs|00001|ctvlog|INFO|%s'" %
+             (daemon, mark_), shell="bash")
+
+
+def _vlogs(output):
+    # the marks of the vlogs printed, in the order of the output
+    return findall(r"\|ovs\|.*\|(ctmark-[ab]-\d)", output)
+
+
 @mark.gate
 def test_show_vlog_config(topology):
     """
@@ -260,3 +274,67 @@ def test_show_vlog_subcommand(topology):
         print('2.2 show vlog invalid sub-command test passed')
     else:
         print('show vlog invalid subcommand test failed')
+
+
+@mark.gate
+def test_show_vlog_filters(topology):
+    """
+    Test the show vlog last, since, until and match filters, and a list of
+    daemons
+    """
+    ops1 = topology.get('ops1')
+
+    assert ops1 is not None
+
+    marks = ["ctmark-a-%d" % i for i in range(1, 6)]
+    marks += ["ctmark-b-%d" % i for i in range(1, 4)]
+    _log_vlogs(ops1, "ops-ctvlga", marks[:3])
+    # not a vlog, the daemon printed it on its own
+    ops1("logger -t ops-ctvlga -p daemon.info ctmark-plain", shell="bash")
+    sleep(2)
+    middle = ops1("date +%Y-%m-%d:%H:%M:%S", shell="bash").splitlines()[-1]
+    sleep(2)
+    _log_vlogs(ops1, "ops-ctvlga", marks[3:5])
+    _log_vlogs(ops1, "ops-ctvlgb", marks[5:])
+    sleep(1)
+
+    # the last entries, oldest first
+    output = ops1("show vlog daemon ops-ctvlga last 2")
+    print(output)
+    assert _vlogs(output) == ["ctmark-a-4", "ctmark-a-5"]
+
+    # several daemons, and a regular expression on the message
+    output = ops1("show vlog daemon ops-ctvlga,ops-ctvlgb match "
+                  "ctmark-[ab]-[23]")
+    print(output)
+    assert _vlogs(output) == ["ctmark-a-2", "ctmark-a-3",
+                                     "ctmark-b-2", "ctmark-b-3"]
+
+    output = ops1("show vlog daemon ops-ctvlga since %s" % middle)
+    print(output)
+    assert _vlogs(output) == ["ctmark-a-4", "ctmark-a-5"]
+
+    output = ops1("show vlog daemon ops-ctvlga until %s" % middle)
+    print(output)
+    assert _vlogs(output) == ["ctmark-a-1", "ctmark-a-2",
+                                     "ctmark-a-3"]
+
+    # the last entries before a time
+    output = ops1("show vlog daemon ops-ctvlga,ops-ctvlgb last 1 until %s" %
+                  middle)
+    print(output)
+    assert _vlogs(output) == ["ctmark-a-3"]
+
+    output = ops1("show vlog daemon ops-ctvlgb since 1h")
+    print(output)
+    assert _vlogs(output) == marks[5:]
+
+    output = ops1("show vlog match ctmark-plain")
+    print(output)
+    assert "No match for the filter provided" in output
+
+    output = ops1("show vlog since yesterday")
+    print(output)
+    assert "Invalid time, expected YYYY-MM-DD:HH:MM:SS" in output
+
+    print('1.8 show vlog filters test passed')
@@ -24,6 +24,9 @@
 from re import search
 from re import compile as re_compile
 from pytest import mark
+from time import sleep
+
+RUN_DIR = "/run/openvswitch"
 
 TOPOLOGY = """
 # +-------+
@@ -170,6 +173,142 @@ def check_vlog_config_daemon(sw1, step):
     assert search(regex, output) is not None
 
 
+def check_vlog_config_feature_list(sw1, step):
+    step("\n############################################")
+    step("1.6 Check Vlog Configuration of Feature Lists  ")
+    step("############################################\n")
+
+    get_into_config(sw1, step)
+
+    # one row per daemon, lacp maps to ops-lacpd and ops-portd
+    output = sw1("vlog feature lldp,lacp syslog:dbg")
+    step(str(output))
+    assert search(r"ops-lldpd\s+ok\s+lldp\s", output) is not None
+    assert search(r"ops-lacpd\s+ok\s+lacp\s", output) is not None
+    assert search(r"ops-portd\s+ok\s+lacp\s", output) is not None
+
+    # a daemon serving several of the features is set once
+    output = sw1("vlog feature lacp,l3port file:info")
+    step(str(output))
+    assert len(re_compile(r"ops-portd\s").findall(output)) == 1
+    assert search(r"ops-portd\s+ok\s+lacp,l3port", output) is not None
+
+    # nothing is set when one of the features is unknown
+    output = sw1("vlog feature lldp,ctnone syslog:warn")
+    step(str(output))
+    assert "Feature not present: ctnone" in output
+
+    output = sw1("vlog feature lldp dbg")
+    step(str(output))
+    assert "Invalid setting dbg, expected destination:level" in output
+
+    get_out_of_config(sw1, step)
+
+    output = sw1("show vlog config daemon ops-lldpd")
+    step(str(output))
+    assert search(r"ops-lldpd\s+DBG\s", output) is not None
+    output = sw1("show vlog config daemon ops-portd")
+    step(str(output))
+    assert search(r"ops-portd\s+DBG\s+INFO", output) is not None
+
+
+def check_vlog_config_duration(sw1, step):
+    step("\n############################################")
+    step("1.7 Check Vlog Levels Raised for a Duration    ")
+    step("############################################\n")
+
+    get_into_config(sw1, step)
+    sw1("vlog daemon ops-lldpd syslog info")
+    output = sw1("vlog daemon ops-lldpd syslog dbg duration 6")
+    step(str(output))
+    output = sw1("vlog feature lacp syslog dbg duration 6")
+    step(str(output))
+    get_out_of_config(sw1, step)
+
+    output = sw1("show vlog config daemon ops-lldpd")
+    step(str(output))
+    assert search(r"ops-lldpd\s+DBG\s", output) is not None
+
+    # each daemon of a feature gets its revert
+    output = sw1("show vlog config")
+    step(str(output))
+    assert "Temporary levels" in output
+    assert search(r"ops-lldpd\s+syslog:dbg\s+[1-6]s", output) is not None
+    assert search(r"ops-lacpd\s+syslog:dbg\s+[1-6]s", output) is not None
+    assert search(r"ops-portd\s+syslog:dbg\s+[1-6]s", output) is not None
+
+    # raised again, only the deadline moves and the level before the first
+    # raise comes back
+    get_into_config(sw1, step)
+    sw1("vlog daemon ops-lldpd syslog warn duration 10")
+    get_out_of_config(sw1, step)
+    output = sw1("show vlog config daemon ops-lldpd")
+    step(str(output))
+    assert search(r"ops-lldpd\s+WARN\s", output) is not None
+
+    sleep(8)
+    output = sw1("show vlog config")
+    step(str(output))
+    assert search(r"ops-lldpd\s+syslog:warn\s+[1-4]s", output) is not None
+    assert search(r"ops-lacpd\s+syslog:dbg", output) is None
+
+    sleep(5)
+    output = sw1("show vlog config daemon ops-lldpd")
+    step(str(output))
+    assert search(r"ops-lldpd\s+INFO\s", output) is not None
+    output = sw1("show vlog config")
+    step(str(output))
+    assert "Temporary levels" not in output
+
+
+def check_vlog_daemon_registry(sw1, step):
+    step("\n############################################")
+    step("1.8 Check Vlog Daemons Started and Stopped    ")
+    step("############################################\n")
+
+    # a daemon is known from its pid file and unixctl socket, as soon as
+    # they are created
+    output = sw1("sleep 600 > /dev/null 2>&1 & echo $!", shell="bash")
+    pid = int(output.splitlines()[-1])
+    sw1("echo %d > %s/ops-ctreg.pid; touch %s/ops-ctreg.%d.ctl" %
+        (pid, RUN_DIR, RUN_DIR, pid), shell="bash")
+    sleep(1)
+
+    get_into_config(sw1, step)
+
+    # it runs, but does not answer on its fake socket
+    output = sw1("vlog daemon ops-ctreg syslog info")
+    step(str(output))
+    assert "Not able to communicate with daemon ops-ctreg" in output
+    assert "it is not running" not in output
+
+    # an unknown daemon lists the daemons found
+    output = sw1("vlog daemon ops-ctnone syslog info")
+    step(str(output))
+    assert ("Not able to communicate with daemon ops-ctnone, "
+            "it is not running") in output
+    assert "Running daemons:" in output
+    assert "  ops-ctreg" in output
+    assert "  ops-lacpd" in output
+
+    # a daemon killed leaves its files behind, and is no longer running
+    sw1("kill -9 %d" % pid, shell="bash")
+    sleep(1)
+    output = sw1("vlog daemon ops-ctreg syslog info")
+    step(str(output))
+    assert ("Not able to communicate with daemon ops-ctreg, "
+            "it is not running") in output
+
+    sw1("rm -f %s/ops-ctreg.*" % RUN_DIR, shell="bash")
+    sleep(1)
+    output = sw1("vlog daemon ops-ctnone syslog info")
+    step(str(output))
+    assert "  ops-ctreg" not in output
+
+    # Clean Up
+    get_out_of_config(sw1, step)
+
+
 def check_invalid_daemon(sw1, step):
     step("\n############################################")
     step("2.1 Run Show vlog for invalid daemon          ")
@@ -278,6 +417,9 @@ def test_supportability_show_vlog(topology, step):
     check_show_vlog(sw1, step)
     check_vlog_config_feature(sw1, step)
     check_vlog_config_daemon(sw1, step)
+    check_vlog_config_feature_list(sw1, step)
+    check_vlog_config_duration(sw1, step)
+    check_vlog_daemon_registry(sw1, step)
 
     # Negative Test Cases
     check_invalid_daemon(sw1, step)
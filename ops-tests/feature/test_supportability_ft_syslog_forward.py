@@ -0,0 +1,460 @@
+# -*- coding: utf-8 -*-
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+"""
+OpenSwitch Test for the syslog forwarder of ops_supportability.
+List of Test Cases
+    1. Forward over TCP to a slow server and restart ops_supportability
+       while a batch is sent, verify the following
+        a. Each message arrives once, in order, octet counted
+        b. The spool is empty afterwards
+    2. Forward over UDP, each message is a datagram
+    3. Forward over TCP to a server which is down, verify the following
+        a. The spool stops at its bound, the next messages are dropped and
+           counted
+        b. Once the server is up the spool is compacted while it is sent
+        c. The messages which did not fit are the last ones
+        d. While the spool is full the journal is held back, no message
+           logged then is dropped
+    4. Change the remotes one at a time, verify that the others keep their
+       connection and counters
+        a. A remote added, changed in severity and removed
+        b. A severity change applies to the running remote
+        c. A removal with the wrong port number leaves the remote alone
+        d. A change of the System row which is not about the remotes
+    5. Forward to remotes given by name, verify that a name which does not
+       resolve does not hold back the other remotes
+"""
+
+from os import path
+from pytest import mark
+from time import sleep
+
+TOPOLOGY = """
+
+#  +---------+       +--------+
+#  |         |       |        |
+#  |   sw1   |<----->|  hs1   |
+#  |         |       |        |
+#  +---------+       +--------+
+
+# Nodes
+[type=openswitch name="Switch 1"] sw1
+[type=host name="Host 1"] hs1
+
+# Ports
+[force_name=oobm] sw1:sp1
+
+# Links
+sw1:sp1 -- hs1:if01
+"""
+
+SINK_ADDR = '10.0.12.1'
+SPOOL_DIR = '/var/diagnostics/syslog'
+SPOOL_MAX = 4 * 1024 * 1024
+SPOOL_HEADER = 296
+JOURNALD_CONF = '/etc/systemd/journald.conf.d/ctfwd.conf'
+
+# Helper Functions
+
+
+def _copy_script(host, script, execscript):
+    """
+    Writes a script of this directory on the host, line by line
+
+    :return: None
+    """
+    host('rm -f ' + execscript, shell='bash')
+    with open(script, 'r') as fi:
+        for line in fi:
+            line = line.rstrip('\n').replace("'", "'\\''")
+            host("echo '" + line + "' >> " + execscript, shell='bash')
+
+
+def _start_sink(hs1, transport, port, out, options=''):
+    """
+    Starts the syslog sink on the host
+
+    :return: pid of the sink
+    """
+    output = hs1('python /tmp/syslog_sink.py --transport ' + transport +
+                 ' --port ' + str(port) + ' --out ' + out + ' ' + options +
+                 ' > /dev/null 2>&1 & echo $!', shell='bash')
+    sleep(1)
+    return int(output.splitlines()[-1])
+
+
+def _logging(sw1, transport, port, remove=False, host=SINK_ADDR,
+             severity=''):
+    """
+    Configures or removes a syslog remote of the switch, the sink by default
+
+    :return: None
+    """
+    if severity:
+        severity = ' severity ' + severity + ' '
+    with sw1.libs.vtysh.Configure() as ctx:
+        if remove:
+            ctx.no_logging(remote_host=host,
+                           transport=' ' + transport + ' ' + str(port),
+                           severity=severity)
+        else:
+            ctx.logging(remote_host=host,
+                        transport=' ' + transport + ' ' + str(port),
+                        severity=severity)
+
+
+def _journal_send(sw1, tag, count, size, priority=6):
+    """
+    Logs count messages tag-0000, tag-0001... padded with size bytes
+
+    :return: None
+    """
+    sw1('python -c \'from systemd import journal; '
+        '[journal.send("%s-%%04d %%s" %% (i, "x" * %d), PRIORITY="%d", '
+        'SYSLOG_IDENTIFIER="ctfwd") for i in range(%d)]\'' %
+        (tag, size, priority, count), shell='bash')
+
+
+def _stats(sw1, remote):
+    """
+    Reads the forwarder stats of a remote
+
+    :return: dictionary of severity, queued, sent, dropped and state, None
+             if the remote is not forwarded to
+    """
+    output = sw1('ovs-appctl -t ops_supportability syslog/stats',
+                 shell='bash')
+    for line in output.splitlines():
+        words = line.split()
+        if ' '.join(words[:2]) != remote or len(words) < 7:
+            continue
+        stats = {'severity': words[2], 'state': ' '.join(words[6:])}
+        for word in words[3:6]:
+            key, value = word.split('=')
+            stats[key] = int(value)
+        return stats
+    return None
+
+
+def _spool_size(sw1, name):
+    output = sw1('stat -c %s ' + SPOOL_DIR + '/' + name + '.spool',
+                 shell='bash')
+    return int(output.splitlines()[-1])
+
+
+def _received(hs1, out, tag):
+    """
+    Counts the messages tag-N the sink got, and those not in their place
+    if they are to be tag-0000, tag-0001... each once
+
+    :return: count, misplaced
+    """
+    output = hs1("grep -o '" + tag + "-[0-9]*' " + out + " | cut -d- -f2 | "
+                 "awk 'NR - 1 != $1 { bad++ } END { print NR, bad + 0 }'",
+                 shell='bash')
+    count, misplaced = output.splitlines()[-1].split()
+    return int(count), int(misplaced)
+
+
+def _connects(hs1, out):
+    output = hs1('grep -c ^CONNECT ' + out, shell='bash')
+    return int(output.splitlines()[-1])
+
+
+def _wait_received(hs1, out, tag, count, timeout=60):
+    for i in range(timeout):
+        if _received(hs1, out, tag)[0] >= count:
+            break
+        sleep(1)
+
+
+def _wait_drained(sw1, remote, timeout=60):
+    for i in range(timeout):
+        stats = _stats(sw1, remote)
+        if stats is not None and stats['queued'] == 0:
+            break
+        sleep(1)
+    return stats
+
+
+def _forward_tcp_restart(sw1, hs1):
+    out = '/tmp/ctfwd_tcp.out'
+    remote = 'tcp ' + SINK_ADDR + ':20514'
+
+    # STEP-1 a sink reading slowly through a small window keeps a backlog
+    # in the spool
+    pid = _start_sink(hs1, 'tcp', 20514, out, '--rcvbuf 2048 --rate 200000')
+    _logging(sw1, 'tcp', 20514)
+    sleep(2)
+    _journal_send(sw1, 'ctfwd', 2000, 1900)
+    sleep(3)
+    stats = _stats(sw1, remote)
+    print(stats)
+    assert stats['queued'] > 0
+
+    # STEP-2 restart in the middle of the batch
+    sw1('systemctl restart ops_supportability', shell='bash')
+    sleep(3)
+    stats = _wait_drained(sw1, remote, 120)
+    print(stats)
+    assert stats['queued'] == 0
+    assert stats['dropped'] == 0
+    assert _spool_size(sw1, 'tcp_' + SINK_ADDR + '_20514') == SPOOL_HEADER
+
+    # STEP-3 nothing lost nor sent twice, a frame cut by the restart is sent
+    # again whole on the new connection
+    _wait_received(hs1, out, 'ctfwd', 2000)
+    assert _received(hs1, out, 'ctfwd') == (2000, 0)
+    assert _connects(hs1, out) >= 2
+    partials = hs1('grep -c ^PARTIAL ' + out, shell='bash')
+    assert int(partials.splitlines()[-1]) <= 1
+    bad = hs1('grep -c ^BAD ' + out, shell='bash')
+    assert int(bad.splitlines()[-1]) == 0
+
+    _logging(sw1, 'tcp', 20514, remove=True)
+    hs1('kill ' + str(pid) + '; rm -f ' + out, shell='bash')
+
+
+def _forward_udp(sw1, hs1):
+    out = '/tmp/ctfwd_udp.out'
+    remote = 'udp ' + SINK_ADDR + ':20516'
+
+    pid = _start_sink(hs1, 'udp', 20516, out)
+    _logging(sw1, 'udp', 20516)
+    sleep(2)
+    _journal_send(sw1, 'ctudp', 100, 100)
+    _wait_received(hs1, out, 'ctudp', 100, 20)
+    assert _received(hs1, out, 'ctudp') == (100, 0)
+    stats = _stats(sw1, remote)
+    print(stats)
+    assert stats['sent'] >= 100
+    assert stats['dropped'] == 0
+
+    _logging(sw1, 'udp', 20516, remove=True)
+    hs1('kill ' + str(pid) + '; rm -f ' + out, shell='bash')
+
+
+def _forward_backpressure(sw1, hs1):
+    out = '/tmp/ctfwd_big.out'
+    remote = 'tcp ' + SINK_ADDR + ':20515'
+    spool = 'tcp_' + SINK_ADDR + '_20515'
+
+    # STEP-1 nothing listens, the spool fills up to its bound and the next
+    # messages are dropped
+    _logging(sw1, 'tcp', 20515)
+    sleep(2)
+    _journal_send(sw1, 'ctbig', 2400, 1900)
+    sleep(5)
+    stats = _stats(sw1, remote)
+    print(stats)
+    size = _spool_size(sw1, spool)
+    assert stats['dropped'] > 0
+    assert stats['sent'] == 0
+    assert stats['state'].startswith('retry in')
+    assert SPOOL_MAX - 2 * 2052 < size <= SPOOL_MAX
+    dropped = stats['dropped']
+
+    # STEP-2 once the sink is up, messages logged while the spool is full
+    # wait in the journal
+    pid = _start_sink(hs1, 'tcp', 20515, out, '--rcvbuf 2048 --rate 200000')
+    for i in range(90):
+        stats = _stats(sw1, remote)
+        if stats['state'] == 'connected':
+            break
+        sleep(1)
+    assert stats['state'] == 'connected'
+    _journal_send(sw1, 'ctmore', 300, 1900)
+
+    # STEP-3 the spool is compacted once half of it was sent, before it is
+    # empty
+    smallest = SPOOL_MAX
+    for i in range(120):
+        stats = _stats(sw1, remote)
+        if stats['queued'] == 0:
+            break
+        smallest = min(smallest, _spool_size(sw1, spool))
+        sleep(1)
+    print(stats)
+    assert stats['queued'] == 0
+    assert smallest < SPOOL_MAX - 1024 * 1024
+    assert _spool_size(sw1, spool) == SPOOL_HEADER
+
+    # STEP-4 the messages dropped are the last ones of the burst, the
+    # others and those held back in the journal arrive in order
+    _wait_received(hs1, out, 'ctmore', 300)
+    count, misplaced = _received(hs1, out, 'ctbig')
+    assert misplaced == 0
+    assert count < 2400
+    assert count + dropped >= 2400
+    assert _received(hs1, out, 'ctmore') == (300, 0)
+
+    _logging(sw1, 'tcp', 20515, remove=True)
+    hs1('kill ' + str(pid) + '; rm -f ' + out, shell='bash')
+
+
+def _forward_diff_apply(sw1, hs1):
+    out = '/tmp/ctfwd_diff.out'
+    remote = 'tcp ' + SINK_ADDR + ':20517'
+    other = 'udp 10.0.12.5:20518'
+
+    # STEP-1 the remote which is left alone
+    pid = _start_sink(hs1, 'tcp', 20517, out)
+    rsyslogd = sw1('pidof rsyslogd; true', shell='bash')
+    _logging(sw1, 'tcp', 20517)
+    sleep(2)
+    _journal_send(sw1, 'ctdiff', 50, 100)
+    _wait_received(hs1, out, 'ctdiff', 50, 20)
+    assert _received(hs1, out, 'ctdiff') == (50, 0)
+    sent = _stats(sw1, remote)['sent']
+    assert sent >= 50
+
+    # STEP-2 another remote is added, its severity changed, then removed
+    _logging(sw1, 'udp', 20518, host='10.0.12.5')
+    sleep(2)
+    _journal_send(sw1, 'ctother', 20, 100)
+    sleep(2)
+    stats = _stats(sw1, other)
+    print(stats)
+    assert stats['severity'] == 'info'
+    assert stats['sent'] >= 20
+    other_sent = stats['sent']
+    _logging(sw1, 'udp', 20518, host='10.0.12.5', severity='err')
+    sleep(2)
+    stats = _stats(sw1, other)
+    print(stats)
+    assert stats['severity'] == 'err'
+    assert stats['sent'] >= other_sent
+    _logging(sw1, 'udp', 20518, remove=True, host='10.0.12.5',
+             severity='err')
+    sleep(2)
+    assert _stats(sw1, other) is None
+    stats = _stats(sw1, remote)
+    assert stats['sent'] >= sent + 20
+    assert _connects(hs1, out) == 1
+    sent = stats['sent']
+
+    # STEP-3 a removal with another port number does not match the remote
+    sw1("configure terminal")
+    output = sw1("no logging " + SINK_ADDR + " tcp 20599")
+    sw1("end")
+    assert 'Syslog configuration not found' in output
+    sleep(2)
+    assert _stats(sw1, remote) is not None
+
+    # STEP-4 a severity change keeps the connection, lower severities stop
+    _logging(sw1, 'tcp', 20517, severity='err')
+    sleep(2)
+    _journal_send(sw1, 'ctinfo', 10, 100)
+    _journal_send(sw1, 'cterr', 10, 100, priority=3)
+    _wait_received(hs1, out, 'cterr', 10, 20)
+    assert _received(hs1, out, 'cterr') == (10, 0)
+    assert _received(hs1, out, 'ctinfo')[0] == 0
+    stats = _stats(sw1, remote)
+    print(stats)
+    assert stats['severity'] == 'err'
+    assert stats['sent'] >= sent + 10
+    assert _connects(hs1, out) == 1
+
+    # STEP-5 a change of the System row which leaves the remotes as they
+    # are
+    sw1('ovs-vsctl set system . other_config:ctdiff=1', shell='bash')
+    sleep(2)
+    sw1('ovs-vsctl remove system . other_config ctdiff', shell='bash')
+    sleep(2)
+    assert _connects(hs1, out) == 1
+    assert sw1('pidof rsyslogd; true', shell='bash') == rsyslogd
+
+    _logging(sw1, 'tcp', 20517, remove=True, severity='err')
+    hs1('kill ' + str(pid) + '; rm -f ' + out, shell='bash')
+
+
+@mark.gate
+@mark.timeout(1800)
+@mark.platform_incompatible(['docker'])
+def _forward_resolve(sw1, hs1):
+    out = '/tmp/ctfwd_name.out'
+    remote = 'udp ctfwd-sink:20517'
+    unresolved = 'tcp ctfwd.invalid:20518'
+
+    # STEP-1 the name of the sink resolves through the hosts file, the
+    # other name never does
+    sw1('echo "' + SINK_ADDR + ' ctfwd-sink" >> /etc/hosts', shell='bash')
+    pid = _start_sink(hs1, 'udp', 20517, out)
+    _logging(sw1, 'tcp', 20518, host='ctfwd.invalid')
+    _logging(sw1, 'udp', 20517, host='ctfwd-sink')
+    sleep(2)
+
+    # STEP-2 the names are looked up aside, the resolvable remote gets its
+    # messages while the other one is retried
+    _journal_send(sw1, 'ctname', 100, 100)
+    _wait_received(hs1, out, 'ctname', 100, 20)
+    assert _received(hs1, out, 'ctname') == (100, 0)
+    stats = _stats(sw1, remote)
+    print(stats)
+    assert stats['sent'] >= 100
+    stats = _stats(sw1, unresolved)
+    print(stats)
+    assert stats['sent'] == 0
+    assert stats['state'] == 'resolving' or \
+        stats['state'].startswith('retry in')
+
+    _logging(sw1, 'udp', 20517, remove=True, host='ctfwd-sink')
+    _logging(sw1, 'tcp', 20518, remove=True, host='ctfwd.invalid')
+    sw1('sed -i "/ctfwd-sink/d" /etc/hosts', shell='bash')
+    hs1('kill ' + str(pid) + '; rm -f ' + out, shell='bash')
+
+
+def test_syslog_forward(topology):
+    sw1 = topology.get('sw1')
+    hs1 = topology.get('hs1')
+    assert sw1 is not None
+    assert hs1 is not None
+
+    # Configure IP and bring UP host 1 interfaces
+    try:
+        hs1('ip addr flush eth1')
+        hs1.libs.ip.interface('if01', addr='10.0.12.1/24', up=True)
+
+        # Configure IP and bring UP switch 1 interfaces
+        with sw1.libs.vtysh.ConfigInterfaceMgmt() as ctx:
+            ctx.ip_static('10.0.12.2/24')
+    except:
+        print("Exception while setting the ip")
+    sleep(25)
+    ping = hs1.libs.ping.ping(1, '10.0.12.2')
+    print("ping-received : " + str(ping['received']))
+
+    script_loc = path.dirname(path.abspath(__file__))
+    _copy_script(hs1, script_loc + '/syslog_sink.py', '/tmp/syslog_sink.py')
+
+    # the bursts are larger than the journald rate limit
+    sw1('mkdir -p /etc/systemd/journald.conf.d; '
+        'printf "[Journal]\\nRateLimitInterval=0\\n" > ' + JOURNALD_CONF +
+        '; systemctl restart systemd-journald', shell='bash')
+    sleep(2)
+
+    _forward_tcp_restart(sw1, hs1)
+    _forward_udp(sw1, hs1)
+    _forward_backpressure(sw1, hs1)
+    _forward_diff_apply(sw1, hs1)
+    _forward_resolve(sw1, hs1)
+
+    # clean up
+    sw1('rm -f ' + JOURNALD_CONF + '; systemctl restart systemd-journald',
+        shell='bash')
+    hs1('rm -f /tmp/syslog_sink.py', shell='bash')
@@ -0,0 +1,280 @@
+#
+# Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+#
+# Licensed under the Apache License, Version 2.0 (the 'License');
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# 'AS IS' BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+
+# tftp server accepting uploads only, with the blksize, windowsize and
+# tsize options (RFC 2347, 2348, 2349, 7440), which can lose packets on
+# purpose to exercise the retransmissions of copy core-dump.
+#
+# Usage : python tftp_server.py [options]
+#   --address ADDR       address to listen on (default: 0.0.0.0)
+#   --port PORT          port to listen on (default: 69)
+#   --root DIR           directory the files are written to
+#                        (default: /var/lib/tftpboot)
+#   --drop N[,N...]      drop every Nth data packet received
+#   --loss PERCENT       drop this share of the data packets at random
+#   --seed N             seed of the random losses (default: 1)
+#   --drop-acks N        do not send every Nth acknowledgement
+#   --blksize N          largest block size granted
+#   --windowsize N       largest window size granted
+#   --options MODE       accept (default), ignore: answer as a server
+#                        without options, refuse: answer with error 8
+#   --refuse PATTERN     refuse to create files whose name ends with
+#                        PATTERN
+#   --sessions N         exit after N uploads (default: run forever)
+#
+# Each completed upload is logged to stdout as
+#   done <file> <bytes> blksize=<n> windowsize=<n> tsize=<n> dropped=<n>
+
+import os
+import random
+import socket
+import struct
+import sys
+import threading
+
+RRQ, WRQ, DATA, ACK, ERROR, OACK = 1, 2, 3, 4, 5, 6
+EACCESS, EBADOP, EOPTNEG = 2, 4, 8
+TIMEOUT = 1.0
+RETRIES = 5
+
+
+def parse_args(argv):
+    conf = {'address': '0.0.0.0', 'port': 69, 'root': '/var/lib/tftpboot',
+            'drop': [], 'loss': 0.0, 'seed': 1, 'drop_acks': 0,
+            'blksize': 65464, 'windowsize': 64,
+            'options': 'accept', 'refuse': None, 'sessions': 0}
+    i = 1
+    while i < len(argv):
+        opt = argv[i]
+        value = argv[i + 1] if i + 1 < len(argv) else None
+        if value is None:
+            sys.exit('missing value of %s' % opt)
+        if opt == '--address':
+            conf['address'] = value
+        elif opt == '--port':
+            conf['port'] = int(value)
+        elif opt == '--root':
+            conf['root'] = value
+        elif opt == '--drop':
+            conf['drop'] = [int(n) for n in value.split(',') if n]
+        elif opt == '--loss':
+            conf['loss'] = float(value)
+        elif opt == '--seed':
+            conf['seed'] = int(value)
+        elif opt == '--drop-acks':
+            conf['drop_acks'] = int(value)
+        elif opt == '--blksize':
+            conf['blksize'] = int(value)
+        elif opt == '--windowsize':
+            conf['windowsize'] = int(value)
+        elif opt == '--options':
+            conf['options'] = value
+        elif opt == '--refuse':
+            conf['refuse'] = value
+        elif opt == '--sessions':
+            conf['sessions'] = int(value)
+        else:
+            sys.exit('unknown option %s' % opt)
+        i += 2
+    return conf
+
+
+def error_packet(code, message):
+    return struct.pack('!HH', ERROR, code) + message.encode() + b'\0'
+
+
+def parse_request(pkt):
+    fields = pkt[2:].split(b'\0')
+    name = fields[0].decode()
+    mode = fields[1].decode().lower() if len(fields) > 1 else ''
+    options = {}
+    for i in range(2, len(fields) - 1, 2):
+        if fields[i]:
+            options[fields[i].decode().lower()] = fields[i + 1].decode()
+    return name, mode, options
+
+
+class Upload(object):
+    '''
+    One write session, on its own socket as the transfer id of the server
+    '''
+
+    def __init__(self, conf, client, name, options):
+        self.conf = conf
+        self.client = client
+        self.name = name
+        self.blksize = 512
+        self.windowsize = 1
+        self.tsize = -1
+        self.reply = None
+        self.data_seen = 0
+        self.acks_seen = 0
+        self.dropped = 0
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind((conf['address'], 0))
+        self.sock.settimeout(TIMEOUT)
+
+        acked = {}
+        if options and conf['options'] == 'refuse':
+            self.reply = error_packet(EOPTNEG, 'Options refused')
+            return
+        if options and conf['options'] == 'accept':
+            if 'blksize' in options:
+                self.blksize = min(int(options['blksize']), conf['blksize'])
+                acked['blksize'] = self.blksize
+            if 'windowsize' in options:
+                self.windowsize = min(int(options['windowsize']),
+                                      conf['windowsize'])
+                acked['windowsize'] = self.windowsize
+            if 'tsize' in options:
+                self.tsize = int(options['tsize'])
+                acked['tsize'] = self.tsize
+        if acked:
+            self.reply = struct.pack('!H', OACK)
+            for key in sorted(acked):
+                self.reply += ('%s\0%d\0' % (key, acked[key])).encode()
+        else:
+            self.reply = struct.pack('!HH', ACK, 0)
+
+    def send(self, pkt):
+        self.sock.sendto(pkt, self.client)
+
+    def ack(self, block):
+        self.acks_seen += 1
+        self.reply = struct.pack('!HH', ACK, block & 0xffff)
+        if self.conf['drop_acks'] and \
+           self.acks_seen % self.conf['drop_acks'] == 0:
+            return
+        self.send(self.reply)
+
+    def lost(self):
+        self.data_seen += 1
+        for n in self.conf['drop']:
+            if self.data_seen % n == 0:
+                self.dropped += 1
+                return True
+        if self.conf['loss'] and \
+           random.random() * 100 < self.conf['loss']:
+            self.dropped += 1
+            return True
+        return False
+
+    def run(self):
+        self.send(self.reply)
+        if self.reply[1:2] == struct.pack('!B', ERROR):
+            return None
+        chunks = []
+        received = 0        # blocks written, numbered from 1, no rollover
+        in_window = 0
+        retries = 0
+        while True:
+            try:
+                pkt, addr = self.sock.recvfrom(65536)
+            except socket.timeout:
+                retries += 1
+                if retries > RETRIES:
+                    return None
+                # RFC 7440: acknowledge what was received so far
+                if received:
+                    self.ack(received)
+                else:
+                    self.send(self.reply)
+                in_window = 0
+                continue
+            if addr != self.client:
+                self.sock.sendto(error_packet(5, 'Unknown TID'), addr)
+                continue
+            if len(pkt) < 4 or struct.unpack('!H', pkt[:2])[0] != DATA:
+                continue
+            if self.lost():
+                continue
+            retries = 0
+            block = struct.unpack('!H', pkt[2:4])[0]
+            expected = (received + 1) & 0xffff
+            if block != expected:
+                # a gap, or a block sent again: acknowledge the last block
+                # received in order, once per window
+                if in_window >= 0:
+                    self.ack(received)
+                    in_window = -1
+                continue
+            received += 1
+            data = pkt[4:]
+            chunks.append(data)
+            in_window = in_window + 1 if in_window >= 0 else 1
+            last = len(data) < self.blksize
+            if last or in_window == self.windowsize:
+                self.ack(received)
+                in_window = 0
+            if last:
+                return b''.join(chunks)
+
+    def dally(self):
+        # answer again a client which lost the final acknowledgement
+        self.sock.settimeout(TIMEOUT * 2)
+        try:
+            while True:
+                pkt, addr = self.sock.recvfrom(65536)
+                if addr == self.client:
+                    self.send(self.reply)
+        except socket.timeout:
+            pass
+        self.sock.close()
+
+
+def main():
+    conf = parse_args(sys.argv)
+    random.seed(conf['seed'])
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind((conf['address'], conf['port']))
+    print('tftp server listening on %s:%d' % (conf['address'], conf['port']))
+    sys.stdout.flush()
+
+    sessions = 0
+    while conf['sessions'] == 0 or sessions < conf['sessions']:
+        pkt, client = sock.recvfrom(65536)
+        if len(pkt) < 4:
+            continue
+        opcode = struct.unpack('!H', pkt[:2])[0]
+        if opcode != WRQ:
+            sock.sendto(error_packet(EBADOP, 'Uploads only'), client)
+            continue
+        name, mode, options = parse_request(pkt)
+        path = os.path.join(conf['root'], os.path.basename(name))
+        if conf['refuse'] and name.endswith(conf['refuse']):
+            sock.sendto(error_packet(EACCESS, 'Access violation'), client)
+            continue
+        upload = Upload(conf, client, name, options)
+        data = upload.run()
+        if data is None:
+            upload.sock.close()
+            print('failed %s' % name)
+            sys.stdout.flush()
+            continue
+        with open(path, 'wb') as f:
+            f.write(data)
+        sessions += 1
+        print('done %s %d blksize=%d windowsize=%d tsize=%d dropped=%d' %
+              (name, len(data), upload.blksize, upload.windowsize,
+               upload.tsize, upload.dropped))
+        sys.stdout.flush()
+        # the next request is served meanwhile, as a forking server does
+        threading.Thread(target=upload.dally).start()
+
+
+if __name__ == '__main__':
+    main()
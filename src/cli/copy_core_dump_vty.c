@@ -26,8 +26,8 @@
 #include <glob.h>
 #include <stdio.h>
 #include <regex.h>
+#include <stdlib.h>
 #include <string.h>
-#include <libgen.h>
 
 
 #include "vtysh/command.h"
@@ -39,14 +39,147 @@
 #include "openvswitch/vlog.h"
 #include "dynamic-string.h"
 #include "core_dump.h"
+#include "core_dump_index.h"
+#include "crashprocessing.h"
+#include "supportability_executor.h"
+#include "supportability_pcompress.h"
+#include "supportability_transfer.h"
 #include "supportability_utils.h"
 
 VLOG_DEFINE_THIS_MODULE (vtysh_copy_core_dump_cli);
 
 
+/* Function       : is_compressed_core
+ * Resposibility  : Whether a core dump is stored compressed by crash
+ *                  processing
+ * Returns        : 1 if compressed, 0 otherwise
+ */
+static int
+is_compressed_core(const char* name)
+{
+    size_t len = strlen(name);
+    size_t ext_len = strlen(CRASH_COMPRESSED_EXT);
+
+    return len > ext_len && !strcmp(name + len - ext_len, CRASH_COMPRESSED_EXT);
+}
+
+
+/* Argument of an upload task */
+struct copy_arg
+{
+    struct transfer_request req;
+    int recompress;
+};
+
+/* Upload of a core dump in flight */
+struct copy_job
+{
+    char name[MAX_FILE_STR_LEN];
+    struct executor_task *task;
+};
+
+
+/* Function       : copy_core_dump_task
+ * Resposibility  : Executor task uploading one core dump, the transfer
+ *                  result is handed over to the submitter. A core dump to
+ *                  recompress is compressed while it is sent, no copy of it
+ *                  is stored.
+ * Returns        : 0 on success
+ */
+static int
+copy_core_dump_task(void *arg, const struct executor_task *task)
+{
+    const struct copy_arg *copy = arg;
+    struct transfer_result *res = NULL;
+    struct pcompress *pc = NULL;
+    int rc = 0;
+
+    res = calloc(1, sizeof(*res));
+    if ( res == NULL ) {
+        return 1;
+    }
+    if ( !copy->recompress ) {
+        rc = transfer_file(&copy->req, res, task);
+    }
+    else if ( (pc = pcompress_start(copy->req.local)) == NULL ) {
+        snprintf(res->error, sizeof(res->error), "compression failed");
+        rc = 1;
+    }
+    else {
+        rc = transfer_stream(&copy->req, pcompress_fd(pc), res, task);
+        if ( pcompress_finish(pc) ) {
+            snprintf(res->error, sizeof(res->error),
+                    "compression failed, the copy is incomplete");
+            rc = 1;
+        }
+    }
+    executor_task_set_result(task, res);
+    return rc ? 1 : 0;
+}
+
+
+/* Function       : recompressed_name
+ * Resposibility  : Name of a kernel core dump bundle once recompressed,
+ *                  vmcore.<date>.<time>.tar.gz becomes .tar.zst
+ * Returns        : void
+ */
+static void
+recompressed_name(const char* name, char* buf, size_t len)
+{
+    size_t name_len = strlen(name);
+
+    if ( name_len > 3 && !strcmp(name + name_len - 3, ".gz") )
+        name_len -= 3;
+    snprintf(buf, len, "%.*s%s", (int)name_len, name, PCOMPRESS_EXT);
+}
+
+
+/* Function       : copy_core_dump_report
+ * Resposibility  : Wait for an upload and print its outcome
+ * Returns        : 0 on success
+ */
+static int
+copy_core_dump_report(struct copy_job *job)
+{
+    struct transfer_result *res = NULL;
+    enum executor_status status;
+    int rc = 1;
+
+    if ( job->task == NULL ) {
+        vty_out(vty,"Failed to copy %s%s",job->name,VTY_NEWLINE);
+        return 1;
+    }
+    status = executor_wait_result(job->task, &rc, (void **)&res);
+    if ( status != EXECUTOR_TASK_DONE || res == NULL ) {
+        vty_out(vty,"Failed to copy %s%s",job->name,VTY_NEWLINE);
+        free(res);
+        return 1;
+    }
+    if ( rc != 0 ) {
+        vty_out(vty,"Failed to copy %s: %s%s",job->name,res->error,
+                VTY_NEWLINE);
+        free(res);
+        return 1;
+    }
+
+    vty_out(vty,"Copied %s, %llu bytes",job->name,
+            (unsigned long long)res->size);
+    if ( res->resumed ) {
+        vty_out(vty,", resumed at %llu bytes",
+                (unsigned long long)res->resumed);
+    }
+    vty_out(vty,"%s  SHA-256 %s%s%s",VTY_NEWLINE,res->sha256,
+            res->sum_stored ? "" : " (checksum file not stored)",
+            VTY_NEWLINE);
+    free(res);
+    return 0;
+}
+
 
 /* Function       : cli_copy_core_dump
- * Resposibility  : Copy core dump to the destination using tftp or sftp
+ * Resposibility  : Copy core dump to the destination using tftp or sftp.
+ *                  The core dumps matching are uploaded concurrently on
+ *                  the shared executor.
  * Parameters
  *                : daemon_name - daemon name string
  *                : instance_id - instance id of the core-dump
@@ -55,6 +188,8 @@ VLOG_DEFINE_THIS_MODULE (vtysh_copy_core_dump_cli);
  *                : user_name - username of sshd server . This argument is valid
  *                              for sftp option
  *                : destination_file - (optional ) destination file name
+ *                : recompress - recompress with zstd on every CPU while
+ *                               copying
  *
  * Returns        : 0 on success
  */
@@ -62,22 +197,20 @@ VLOG_DEFINE_THIS_MODULE (vtysh_copy_core_dump_cli);
 int
 cli_copy_core_dump(const char* daemon_name,const char* instance_id,
       const char* protocol, const char* address,const char* user_name,
-      const char* destination_file )
+      const char* destination_file, int recompress )
 {
-    glob_t globbuf;
+    struct core_index_entry *entries = NULL;
+    struct copy_job *jobs = NULL;
+    struct transfer_request req;
+    struct copy_arg arg;
+    size_t count = 0;
     size_t i=0;
-    char *gb_pattern=NULL;
-    struct stat sb;
-
-    /* We need minimum 4 arg for sftp command */
-    int argc = 4;
-    char *arguments[argc];
+    int num_of_core = 0;
+    int failed = 0;
 
     int rc = 0;
-    char command[MAX_COMMAND_STR_LEN] = {0};
     char file_name[MAX_FILE_STR_LEN] = {0};
     char log_str[MAX_LOG_STR_LEN] = {0};
-    char * file_str_ptr = NULL;
     int type = -1;
 
     /* validate mandatory parameters
@@ -132,23 +265,10 @@ cli_copy_core_dump(const char* daemon_name,const char* instance_id,
     }
 
 
-    /* Validate protocol and checking existance of binary */
+    /* Validate protocol */
+    memset(&req, 0, sizeof(req));
     if ( 0 == strncmp_with_nullcheck( protocol , TFTP_STR , strlen(TFTP_STR))) {
-        strncpy (command,TFTP_NOI_SCRIPT ,sizeof(command));
-        STR_SAFE(command);
-        if  (
-                !(
-                    (0 == stat(command , &sb)) &&
-                    (S_ISREG(sb.st_mode)) &&
-                    (sb.st_mode & S_IXGRP)
-                 )
-            )
-        {
-            vty_out(vty,"Utility not available for execution:%s%s",command,
-                    VTY_NEWLINE);
-            VLOG_ERR("Utility not available for execution:%s", command);
-            return CMD_WARNING;
-        }
+        req.protocol = TRANSFER_TFTP;
     }
     else if (0 == strncmp_with_nullcheck ( protocol , SFTP_STR ,
                 strlen( SFTP_STR )))  {
@@ -167,56 +287,111 @@ cli_copy_core_dump(const char* daemon_name,const char* instance_id,
                     user_name,rc);
             return CMD_WARNING;
         }
-
-
-        strncpy (command, SFTP_NOI_SCRIPT, sizeof(command));
-        STR_SAFE(command);
-        if  (
-                !(
-                    (0 == stat(command , &sb)) &&
-                    (S_ISREG(sb.st_mode)) &&
-                    (sb.st_mode & S_IXGRP)
-                 )
-            )
-        {
-            vty_out(vty,"Utility not available for execution:%s%s",command,
-                    VTY_NEWLINE);
-            VLOG_ERR("Utility not available for execution:%s", command);
-            return CMD_WARNING;
-        }
+        req.protocol = TRANSFER_SFTP;
+        strncpy(req.user, user_name, sizeof(req.user));
+        STR_SAFE(req.user);
     }
     else {
         vty_out(vty,"Invalid parameter protocol :%s%s",protocol,VTY_NEWLINE);
         VLOG_ERR("Invalid parameter protocol :%s",protocol);
         return CMD_WARNING;
     }
+    strncpy(req.host, address, sizeof(req.host));
+    STR_SAFE(req.host);
     /* end of cli parameter validation */
 
 
     if ( 0 == strncmp_with_nullcheck((char*)daemon_name,"kernel",10))
     {
         type = TYPE_KERNEL;
-        gb_pattern = KERNEL_CORE_PATTERN;
     }
     else
     {
         /* systemd uses hardcoded path for coredump
            We dont need to read any config file for this */
         type = TYPE_DAEMON;
-        gb_pattern = DAEMON_CORE_PATTERN ;
     }
 
-    rc = get_file_list(type, &globbuf, gb_pattern ,
-            daemon_name, instance_id);
+    rc = core_index_snapshot(&entries, &count);
     if ( rc != 0 )
     {
         vty_out(vty,"Error to listing corefiles %s",VTY_NEWLINE);
-        VLOG_ERR("Glob failed to listing core files:%d", rc );
-        globfree(&globbuf);
+        VLOG_ERR("Failed to list core files:%d", rc );
+        return CMD_WARNING;
+    }
+
+    jobs = calloc(count ? count : 1, sizeof(*jobs));
+    if ( jobs == NULL )
+    {
+        vty_out(vty,"Memory allocation failed%s",VTY_NEWLINE);
+        VLOG_ERR("Memory allocation failed");
+        free(entries);
+        return CMD_WARNING;
+    }
+
+    for (i = 0; i < count;i++)
+    {
+        if ( type == TYPE_KERNEL ) {
+            if ( entries[i].type != TYPE_KERNEL )
+                continue;
+        }
+        else if ( !core_index_match(&entries[i], daemon_name, instance_id) ) {
+            continue;
+        }
+        num_of_core++;
+        strncpy(jobs[num_of_core - 1].name, entries[i].name,
+                sizeof(jobs[num_of_core - 1].name));
+        STR_SAFE(jobs[num_of_core - 1].name);
+
+        if ( core_index_path(&entries[i], req.local, sizeof(req.local)) ) {
+            vty_out(vty,"Failed to get filename%s",VTY_NEWLINE);
+            VLOG_ERR("Failed to get filename");
+            break;
+        }
+        if ( destination_file == NULL ||
+                destination_file[0] == ' ' ||
+                destination_file[0] == '\t' ) {
+            if ( recompress )
+                recompressed_name(entries[i].name,file_name,sizeof(file_name));
+            else
+                strncpy(file_name,entries[i].name,sizeof(file_name));
+        }
+        else if ( ( recompress || is_compressed_core(entries[i].name) ) &&
+                !is_compressed_core(destination_file) ) {
+            /* The core dump is copied as stored, keep the extension telling
+               it is zstd compressed */
+            snprintf(file_name,sizeof(file_name),"%s%s",destination_file,
+                    CRASH_COMPRESSED_EXT);
+        }
+        else {
+            strncpy(file_name,destination_file,sizeof(file_name));
+        }
+        STR_SAFE(file_name);
+
+        strncpy(req.remote, file_name, sizeof(req.remote));
+        STR_SAFE(req.remote);
+        arg.req = req;
+        arg.recompress = recompress;
+        jobs[num_of_core - 1].task = executor_submit(copy_core_dump_task,
+                &arg, sizeof(arg), 0);
+        /* Kernel Core file configuration is configured to generate only one
+         * core file. We don't expect more than one vmcore file  */
+        if (type == TYPE_KERNEL)
+            break;
+    }
+    free(entries);
+
+    for (i = 0; i < (size_t)num_of_core; i++)
+    {
+        failed += copy_core_dump_report(&jobs[i]);
+    }
+    free(jobs);
+    if ( failed )
+    {
         return CMD_WARNING;
     }
 
-    if ( globbuf.gl_pathc <= 0 )
+    if ( num_of_core == 0 )
     {
         if ( instance_id ) {
             if ( type == TYPE_KERNEL )
@@ -239,63 +414,7 @@ cli_copy_core_dump(const char* daemon_name,const char* instance_id,
 
         vty_out(vty,"%s%s",log_str, VTY_NEWLINE);
         VLOG_DBG(log_str);
-        globfree(&globbuf);
-        return CMD_SUCCESS;
     }
-
-
-    for (i = 0; i < globbuf.gl_pathc;i++)
-    {
-
-        if ( destination_file == NULL ||
-                destination_file[0] == ' ' ||
-                destination_file[0] == '\t' ) {
-
-            file_str_ptr  = basename(globbuf.gl_pathv[i]);
-            if ( file_str_ptr == NULL ) {
-                vty_out(vty,"Failed to get filename%s",VTY_NEWLINE);
-                VLOG_ERR("Failed to get filename");
-                globfree(&globbuf);
-                return CMD_WARNING;
-            }
-            strncpy(file_name,file_str_ptr,sizeof(file_name));
-        }
-        else {
-            strncpy(file_name,destination_file,sizeof(file_name));
-        }
-        STR_SAFE(file_name);
-
-        if ( 0 == strncmp_with_nullcheck(protocol, TFTP_STR, strlen(TFTP_STR)))
-        {
-            argc = 3;
-            arguments[0] = (char*) address;
-            arguments[1] = (char*) globbuf.gl_pathv[i];
-            arguments[2] = (char*) file_name;
-        }
-
-        if ( 0 == strncmp_with_nullcheck(protocol, SFTP_STR, strlen(SFTP_STR)))
-        {
-            argc = 4;
-            arguments[0] = (char*) user_name ;
-            arguments[1] = (char*) address ;
-            arguments[2] = (char*) globbuf.gl_pathv[i];
-            arguments[3] = (char*) file_name ;
-        }
-        rc = execute_command(command , argc, (const char **)arguments);
-        if ( rc != 0) {
-            vty_out(vty,"%s command is failed to execute%s",
-                    command,VTY_NEWLINE);
-            VLOG_ERR("%s command is failed to execute",command);
-            globfree(&globbuf);
-            return CMD_WARNING;
-        }
-        /* Kernel Core file configuration is configured to generate only one
-         * core file. We don't expect more than one vmcore file  */
-        if (type == TYPE_KERNEL)
-            break;
-    }
-
-    globfree(&globbuf);
     return CMD_SUCCESS;
 }
 
@@ -316,7 +435,8 @@ DEFUN_NOLOCK (cli_platform_copy_core_dump_tftp,
         HOST_IPv4
         HOST_NAME)
 {
-    return cli_copy_core_dump(argv[0], NULL, TFTP_STR, argv[1], NULL, NULL );
+    return cli_copy_core_dump(argv[0], NULL, TFTP_STR, argv[1], NULL, NULL,
+            0 );
 }
 
 
@@ -337,7 +457,8 @@ DEFUN_NOLOCK (cli_platform_copy_core_dump_sftp,
         HOST_IPv4
         HOST_NAME)
 {
-    return cli_copy_core_dump(argv[0], NULL, SFTP_STR, argv[2], argv[1], NULL );
+    return cli_copy_core_dump(argv[0], NULL, SFTP_STR, argv[2], argv[1], NULL,
+            0 );
 }
 
 
@@ -360,7 +481,7 @@ DEFUN_NOLOCK (cli_platform_copy_core_dump_kernel_tftp,
 {
     return cli_copy_core_dump("kernel", NULL, TFTP_STR, argv[0],NULL,
             /* additional check for optional parameter FILE_NAME */
-            ( ( argc >= 2 ) ? argv[1] : NULL ));
+            ( ( argc >= 2 ) ? argv[1] : NULL ), 0);
 }
 
 
@@ -384,8 +505,53 @@ DEFUN_NOLOCK (cli_platform_copy_core_dump_kernel_sftp,
 {
     return cli_copy_core_dump("kernel", NULL, SFTP_STR,argv[1],argv[0],
             /* additional check for optional parameter FILE_NAME */
-            ( ( argc >= 3 ) ? argv[2] : NULL ));
+            ( ( argc >= 3 ) ? argv[2] : NULL ), 0);
+
+}
+
+
+/*
+* Action routines for copy core dump CLI using tftp, recompressing the
+* kernel core dump bundle with zstd on every CPU while it is sent.
+*/
+DEFUN_NOLOCK (cli_platform_copy_core_dump_kernel_zstd_tftp,
+        cli_platform_copy_core_dump_kernel_zstd_tftp_cmd,
+        "copy core-dump kernel zstd tftp (A.B.C.D | WORD) [FILENAME]",
+        COPY_STR
+        CORE_DUMP_STR
+        KERNEL_STR
+        ZSTD_STR
+        TFTP_CLIENT_STR
+        HOST_IPv4
+        HOST_NAME
+        FILENAME_STR)
+{
+    return cli_copy_core_dump("kernel", NULL, TFTP_STR, argv[0],NULL,
+            /* additional check for optional parameter FILE_NAME */
+            ( ( argc >= 2 ) ? argv[1] : NULL ), 1);
+}
 
+
+/*
+* Action routines for copy core dump CLI using sftp, recompressing the
+* kernel core dump bundle with zstd on every CPU while it is sent.
+*/
+DEFUN_NOLOCK (cli_platform_copy_core_dump_kernel_zstd_sftp,
+        cli_platform_copy_core_dump_kernel_zstd_sftp_cmd,
+        "copy core-dump kernel zstd sftp USERNAME (A.B.C.D | WORD) [FILENAME]",
+        COPY_STR
+        CORE_DUMP_STR
+        KERNEL_STR
+        ZSTD_STR
+        SFTP_CLIENT_STR
+        SFTP_USER_STR
+        HOST_IPv4
+        HOST_NAME
+        FILENAME_STR)
+{
+    return cli_copy_core_dump("kernel", NULL, SFTP_STR,argv[1],argv[0],
+            /* additional check for optional parameter FILE_NAME */
+            ( ( argc >= 3 ) ? argv[2] : NULL ), 1);
 }
 
 /*
@@ -407,7 +573,7 @@ DEFUN_NOLOCK (cli_platform_copy_core_dump_tftp_inst,
 {
     return cli_copy_core_dump(argv[0], argv[1], TFTP_STR, argv[2], NULL,
             /* additional check for optional parameter FILE_NAME */
-            ( ( argc >= 4 ) ? argv[3] : NULL ));
+            ( ( argc >= 4 ) ? argv[3] : NULL ), 0);
 }
 
 
@@ -431,5 +597,5 @@ DEFUN_NOLOCK (cli_platform_copy_core_dump_sftp_inst,
 {
     return cli_copy_core_dump(argv[0], argv[1], SFTP_STR, argv[3], argv[2],
              /* additional check for optional parameter FILE_NAME */
-            ( ( argc >= 5 ) ? argv[4] : NULL ));
+            ( ( argc >= 5 ) ? argv[4] : NULL ), 0);
 }
@@ -23,6 +23,7 @@
 * Purpose: Library Routines for Core Dump CLI
 */
 
+#include <ctype.h>
 #include <glob.h>
 #include <stdio.h>
 #include <regex.h>
@@ -87,13 +88,163 @@ convert_to_date_and_time(char *buf_date,
 }
 
 
+/*
+ * Function       : scan_digits
+ * Responsibility : Goes back over the digits, or lower case hex digits,
+ *                  ending at end
+ * Returns        : start of the digits
+ */
+static const char *
+scan_digits(const char *start, const char *end, int hex)
+{
+    while(end > start && (isdigit((unsigned char) end[-1])
+                          || (hex && end[-1] >= 'a' && end[-1] <= 'f')))
+    {
+        end--;
+    }
+    return end;
+}
+
+/*
+ * Function       : scan_set
+ * Responsibility : Sets a match of the scan, as regexec does
+ * Returns        : void
+ */
+static void
+scan_set(regmatch_t *match, const char *filename, const char *start,
+        const char *end)
+{
+    match->rm_so = start - filename;
+    match->rm_eo = end - filename;
+}
+
+/*
+ * Function       : scan_daemon_core_name
+ * Responsibility : Matches the file name of a daemon core dump, in the
+ *                  format of CORE_FILE_PATTERN, scanning back from the end
+ *                  where the fields are fixed. Unlike the pattern, core.
+ *                  must start the file name rather than be anywhere in
+ *                  the path
+ * Returns        : 0 on a match, REG_NOMATCH otherwise
+ */
+static int
+scan_daemon_core_name(const char *filename, regmatch_t *match)
+{
+    static const char *exts[] = {".xz", ".lz4", ".zst"};
+    /* at most digits of the fields from the end, 0 for no limit */
+    static const struct { int hex; size_t max; } fields[] = {
+        {0, 16}, {0, 8}, {1, 64}, {0, 0}
+    };
+    const char *base = strrchr(filename, '/');
+    const char *end = NULL, *start = NULL;
+    size_t len = 0, ext_len = 0;
+    int i = 0;
+
+    base = base ? base + 1 : filename;
+    len = strlen(base);
+    if(strncmp(base, "core.", strlen("core.")))
+    {
+        return REG_NOMATCH;
+    }
+    end = base + len;
+    for(i = 0; i < sizeof(exts) / sizeof(exts[0]); i++)
+    {
+        ext_len = strlen(exts[i]);
+        if(len > ext_len && !strcmp(end - ext_len, exts[i]))
+        {
+            end -= ext_len;
+            break;
+        }
+    }
+    /* timestamp, pid, boot id and uid, the 5th to the 2nd match */
+    for(i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+    {
+        start = scan_digits(base, end, fields[i].hex);
+        if(start == end || (fields[i].max && end - start > fields[i].max)
+           || start - base < strlen("core.") || start[-1] != '.')
+        {
+            return REG_NOMATCH;
+        }
+        scan_set(&match[TOTAL_INFO - 1 - i], filename, start, end);
+        end = start - 1;
+    }
+    /* the daemon name is the rest, dots included, and not empty */
+    start = base + strlen("core.");
+    if(end <= start)
+    {
+        return REG_NOMATCH;
+    }
+    scan_set(&match[1], filename, start, end);
+    scan_set(&match[0], filename, base, base + len);
+    return 0;
+}
+
+/*
+ * Function       : scan_kernel_core_name
+ * Responsibility : Matches the date and time of the file name of a kernel
+ *                  core dump, as KERN_CORE_FILE_PATTERN does
+ * Returns        : 0 on a match, REG_NOMATCH otherwise
+ */
+static int
+scan_kernel_core_name(const char *filename, regmatch_t *match)
+{
+    const char *p = filename;
+    const char *date = NULL, *time = NULL;
+
+    while((p = strstr(p, ".tar.gz")) != NULL)
+    {
+        if(p - filename < SRC_DATE_STR_LEN + 1 + SRC_TIME_STR_LEN)
+        {
+            p++;
+            continue;
+        }
+        time = p - SRC_TIME_STR_LEN;
+        date = time - 1 - SRC_DATE_STR_LEN;
+        if(time[-1] == '.'
+           && scan_digits(time, p, 0) == time
+           && scan_digits(date, time - 1, 0) == date)
+        {
+            scan_set(&match[0], filename, date, p + strlen(".tar.gz"));
+            scan_set(&match[1], filename, date, time - 1);
+            scan_set(&match[2], filename, time, p);
+            return 0;
+        }
+        p++;
+    }
+    return REG_NOMATCH;
+}
+
+/*
+ * Function       : scan_core_file_name
+ * Responsibility : Matches the file name of a core dump, as regexec would
+ *                  with CORE_FILE_PATTERN or KERN_CORE_FILE_PATTERN, with
+ *                  no regular expression. A daemon core dump name must
+ *                  start with core. and name a daemon.
+ * Returns        : 0 on a match, REG_NOMATCH otherwise
+ */
+int
+scan_core_file_name(const char *filename, int type,
+        regmatch_t match[TOTAL_INFO])
+{
+    int i = 0;
+
+    for(i = 0; i < TOTAL_INFO; i++)
+    {
+        match[i].rm_so = match[i].rm_eo = -1;
+    }
+    if(type == TYPE_KERNEL)
+    {
+        return scan_kernel_core_name(filename, match);
+    }
+    return scan_daemon_core_name(filename, match);
+}
+
 /*
   Extract Code Dump information from the filename.
 */
 
 int
-extract_info (
- regex_t * regexst, const char * filename,struct core_dump_data* cd,int type)
+extract_info (const char * filename,struct core_dump_data* cd,int type)
 {
     char value[SIZE_DATE_AND_TIME+1];
     int strsize = 0;
@@ -115,7 +266,7 @@ extract_info (
 
         /* In case if fetching extended attributes failed, then we will use
            the information stored in the file name */
-        matchstatus = regexec (regexst, filename, TOTAL_INFO, match_found, 0);
+        matchstatus = scan_core_file_name (filename, type, match_found);
         /* Get Daemon Name */
         result = getxattr(filename, "user.coredump.comm",cd->daemon_name,DEAMON_NAME_SIZE );
 
@@ -250,7 +401,7 @@ extract_info (
     }
     else if (type == TYPE_KERNEL)
     {
-        matchstatus = regexec (regexst, filename, TOTAL_INFO, match_found, 0);
+        matchstatus = scan_core_file_name (filename, type, match_found);
         if (matchstatus)
         {
             return -1;
@@ -0,0 +1,904 @@
+/* Core dump index.
+*
+* Copyright (C) 1997, 98 Kunihiro Ishiguro
+* Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+*
+* GNU Zebra is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the
+* Free Software Foundation; either version 2, or (at your option) any
+* later version.
+*
+* GNU Zebra is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with GNU Zebra; see the file COPYING.  If not, write to the Free
+* Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+* 02111-1307, USA.
+*
+* File: core_dump_index.c
+*
+* Purpose: Keeps the metadata of every core dump, as extract_info finds it,
+*          in a sorted array. The array is updated from inotify events of
+*          the core dump directories and saved to CORE_INDEX_FILE whenever
+*          it changes.
+*
+*          A CLI session which starts with a saved index compares the
+*          directories with the ones the index was saved for. Only when they
+*          changed in between the directories are read again, and metadata
+*          is extracted only for the core dumps not yet known.
+*/
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <glob.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <regex.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "core_dump_index.h"
+#include "openvswitch/vlog.h"
+
+VLOG_DEFINE_THIS_MODULE (core_dump_index);
+
+#define CORE_INDEX_MAGIC        "OPSCIDX"
+#define CORE_INDEX_VERSION      1
+#define CORE_INDEX_DIRS         2
+#define CORE_INDEX_EVENT_BUF    4096
+#define CORE_INDEX_DAEMON_NAME  "core.*"
+#define CORE_INDEX_ADD_EVENTS   (IN_CREATE | IN_CLOSE_WRITE | IN_MOVED_TO)
+#define CORE_INDEX_DEL_EVENTS   (IN_DELETE | IN_MOVED_FROM)
+#define CORE_INDEX_WATCH_EVENTS (CORE_INDEX_ADD_EVENTS | CORE_INDEX_DEL_EVENTS \
+                                 | IN_DELETE_SELF | IN_MOVE_SELF)
+
+/* Identity of a core dump directory, any change of its entries changes the
+ * modification time */
+struct core_index_stamp
+{
+   uint64_t dev;
+   uint64_t ino;
+   int64_t mtime_sec;
+   int64_t mtime_nsec;
+   uint32_t present;
+   uint32_t reserved;
+};
+
+/* On disk header, followed by count records of a type byte, a valid byte
+ * and the NUL terminated name, daemon name, date, time, signal and instance
+ * id */
+struct core_index_header
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t count;
+   struct core_index_stamp stamp[CORE_INDEX_DIRS];
+};
+
+struct core_index_dir
+{
+   const char* path;
+   int type;
+   int wd;                           /* inotify watch, -1 if none */
+   int synced;                       /* entries match the directory */
+   struct core_index_stamp stamp;    /* directory the entries match */
+};
+
+static struct core_index_dir index_dirs[CORE_INDEX_DIRS] =
+{
+   { CORE_DUMP_DIR,   TYPE_DAEMON, -1, 0, {0,} },
+   { KERNEL_CORE_DIR, TYPE_KERNEL, -1, 0, {0,} },
+};
+
+static struct core_index_entry* index_entries = NULL;
+static size_t index_count = 0;
+static size_t index_max = 0;
+static int index_loaded = 0;
+static int index_inotify_fd = -1;
+static pthread_mutex_t index_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Function       : index_rank
+ * Responsibility : Position of a core dump type in the index, daemon core
+ *                  dumps are listed first
+ * Returns        : rank of the type
+ */
+static int
+index_rank(int type)
+{
+    return (type == TYPE_DAEMON) ? 0 : 1;
+}
+
+/*
+ * Function       : index_find
+ * Responsibility : Binary search of a core dump in the index
+ * Parameters
+ *                : type - TYPE_DAEMON or TYPE_KERNEL
+ *                : name - file name of the core dump
+ *                : pos  - set to the position of the entry, or to the
+ *                         position it has to be inserted at
+ * Returns        : 1 if found, 0 otherwise
+ */
+static int
+index_find(int type, const char* name, size_t* pos)
+{
+    size_t lo = 0, hi = index_count, mid = 0;
+    int cmp = 0;
+
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        cmp = index_rank(type) - index_rank(index_entries[mid].type);
+        if (cmp == 0)
+        {
+            cmp = strcmp(name, index_entries[mid].name);
+        }
+        if (cmp == 0)
+        {
+            *pos = mid;
+            return 1;
+        }
+        if (cmp < 0)
+        {
+            hi = mid;
+        }
+        else
+        {
+            lo = mid + 1;
+        }
+    }
+    *pos = lo;
+    return 0;
+}
+
+/*
+ * Function       : index_name_match
+ * Responsibility : Whether a file of a core dump directory is a core dump,
+ *                  the same files the glob patterns of get_file_list find
+ * Returns        : 1 for a core dump, 0 otherwise
+ */
+static int
+index_name_match(int type, const char* name)
+{
+    if (type == TYPE_KERNEL)
+    {
+        return fnmatch(KERN_GB_PATTERN, name, FNM_PERIOD) == 0;
+    }
+    return fnmatch(CORE_INDEX_DAEMON_NAME, name, FNM_PERIOD) == 0;
+}
+
+/*
+ * Function       : index_dir_of
+ * Responsibility : Directory a core dump type is stored in
+ * Returns        : directory on success, NULL on failure
+ */
+static const struct core_index_dir*
+index_dir_of(int type)
+{
+    int d = 0;
+
+    for (d = 0; d < CORE_INDEX_DIRS; d++)
+    {
+        if (index_dirs[d].type == type)
+        {
+            return &index_dirs[d];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Function       : index_fill
+ * Responsibility : Extracts the metadata of one core dump, this is the only
+ *                  place the core dump itself is looked at
+ * Returns        : void
+ */
+static void
+index_fill(struct core_index_entry* entry, int type, const char* name)
+{
+    char path[CORE_FILE_NAME];
+
+    memset(entry, 0, sizeof(*entry));
+    entry->type = type;
+    strncpy(entry->name, name, sizeof(entry->name));
+    STR_SAFE(entry->name);
+    if (core_index_path(entry, path, sizeof(path)))
+    {
+        return;
+    }
+    entry->valid = extract_info(path, &entry->cd, type) != -1;
+}
+
+/*
+ * Function       : index_upsert
+ * Responsibility : Adds a core dump to the index, or extracts the metadata
+ *                  again when the file was replaced
+ * Returns        : 0 on success
+ */
+static int
+index_upsert(int type, const char* name)
+{
+    struct core_index_entry* entries = NULL;
+    size_t pos = 0, max = 0;
+
+    if (index_find(type, name, &pos))
+    {
+        index_fill(&index_entries[pos], type, name);
+        return 0;
+    }
+    if (index_count == index_max)
+    {
+        max = index_max ? 2 * index_max : 64;
+        entries = realloc(index_entries, max * sizeof(*entries));
+        if (entries == NULL)
+        {
+            VLOG_ERR("core dump index: memory allocation failed");
+            return -1;
+        }
+        index_entries = entries;
+        index_max = max;
+    }
+    memmove(&index_entries[pos + 1], &index_entries[pos],
+            (index_count - pos) * sizeof(*index_entries));
+    index_count++;
+    index_fill(&index_entries[pos], type, name);
+    return 0;
+}
+
+/*
+ * Function       : index_remove
+ * Responsibility : Drops a core dump from the index
+ * Returns        : void
+ */
+static void
+index_remove(int type, const char* name)
+{
+    size_t pos = 0;
+
+    if (!index_find(type, name, &pos))
+    {
+        return;
+    }
+    memmove(&index_entries[pos], &index_entries[pos + 1],
+            (index_count - pos - 1) * sizeof(*index_entries));
+    index_count--;
+}
+
+/*
+ * Function       : index_stamp
+ * Responsibility : Identity and modification time of a directory
+ * Returns        : void
+ */
+static void
+index_stamp(const char* path, struct core_index_stamp* stamp)
+{
+    struct stat sb;
+
+    memset(stamp, 0, sizeof(*stamp));
+    if (stat(path, &sb) == 0)
+    {
+        stamp->dev = sb.st_dev;
+        stamp->ino = sb.st_ino;
+        stamp->mtime_sec = sb.st_mtim.tv_sec;
+        stamp->mtime_nsec = sb.st_mtim.tv_nsec;
+        stamp->present = 1;
+    }
+}
+
+static int
+index_stamp_equal(const struct core_index_stamp* s1,
+        const struct core_index_stamp* s2)
+{
+    return s1->present == s2->present && s1->dev == s2->dev
+        && s1->ino == s2->ino && s1->mtime_sec == s2->mtime_sec
+        && s1->mtime_nsec == s2->mtime_nsec;
+}
+
+static int
+index_name_cmp(const void* n1, const void* n2)
+{
+    return strcmp(*(char* const*) n1, *(char* const*) n2);
+}
+
+/*
+ * Function       : index_reconcile
+ * Responsibility : Replaces the entries of one directory with the core
+ *                  dumps found in it. Entries of core dumps already known are
+ *                  kept as they are, only new ones are extracted.
+ * Returns        : 0 on success
+ */
+static int
+index_reconcile(const struct core_index_dir* dir)
+{
+    struct core_index_entry* merged = NULL;
+    struct dirent* de = NULL;
+    char** names = NULL;
+    char** grown = NULL;
+    size_t n_names = 0, max_names = 0, n = 0, i = 0, pos = 0, max = 0;
+    DIR* dp = NULL;
+    int rc = -1;
+
+    dp = opendir(dir->path);
+    if (dp == NULL && errno != ENOENT)
+    {
+        VLOG_ERR("core dump index: failed to read %s: %s", dir->path,
+                strerror(errno));
+        return -1;
+    }
+    while (dp && (de = readdir(dp)) != NULL)
+    {
+        if (de->d_type == DT_DIR || !index_name_match(dir->type, de->d_name))
+        {
+            continue;
+        }
+        if (n_names == max_names)
+        {
+            max_names = max_names ? 2 * max_names : 64;
+            grown = realloc(names, max_names * sizeof(*names));
+            if (grown == NULL)
+            {
+                goto EXIT_FUN;
+            }
+            names = grown;
+        }
+        names[n_names] = strdup(de->d_name);
+        if (names[n_names] == NULL)
+        {
+            goto EXIT_FUN;
+        }
+        n_names++;
+    }
+    if (n_names)
+    {
+        qsort(names, n_names, sizeof(*names), index_name_cmp);
+    }
+
+    for (i = 0; i < index_count; i++)
+    {
+        if (index_entries[i].type != dir->type)
+        {
+            max++;
+        }
+    }
+    max += n_names;
+    merged = malloc((max ? max : 1) * sizeof(*merged));
+    if (merged == NULL)
+    {
+        goto EXIT_FUN;
+    }
+    for (i = 0; i < index_count; i++)
+    {
+        if (index_rank(index_entries[i].type) < index_rank(dir->type))
+        {
+            merged[n++] = index_entries[i];
+        }
+    }
+    for (i = 0; i < n_names; i++)
+    {
+        if (index_find(dir->type, names[i], &pos))
+        {
+            merged[n++] = index_entries[pos];
+        }
+        else
+        {
+            index_fill(&merged[n++], dir->type, names[i]);
+        }
+    }
+    for (i = 0; i < index_count; i++)
+    {
+        if (index_rank(index_entries[i].type) > index_rank(dir->type))
+        {
+            merged[n++] = index_entries[i];
+        }
+    }
+    free(index_entries);
+    index_entries = merged;
+    index_count = n;
+    index_max = max ? max : 1;
+    rc = 0;
+
+EXIT_FUN:
+    if (rc)
+    {
+        VLOG_ERR("core dump index: memory allocation failed");
+    }
+    for (i = 0; i < n_names; i++)
+    {
+        free(names[i]);
+    }
+    free(names);
+    if (dp)
+    {
+        closedir(dp);
+    }
+    return rc;
+}
+
+/*
+ * Function       : index_take_str
+ * Responsibility : Copies the next NUL terminated string of a saved index
+ * Returns        : 0 on success, -1 if the record is truncated
+ */
+static int
+index_take_str(const char** p, const char* end, char* dst, size_t size)
+{
+    const char* nul = memchr(*p, '\0', end - *p);
+
+    if (nul == NULL)
+    {
+        return -1;
+    }
+    snprintf(dst, size, "%s", *p);
+    *p = nul + 1;
+    return 0;
+}
+
+/*
+ * Function       : index_load
+ * Responsibility : Reads the index saved by an earlier CLI session. The
+ *                  directories are compared with the saved stamps before
+ *                  the entries are trusted.
+ * Returns        : 0 on success
+ */
+static int
+index_load(void)
+{
+    struct core_index_header header;
+    struct core_index_entry* entries = NULL;
+    struct core_index_entry* entry = NULL;
+    const char* p = NULL;
+    const char* end = NULL;
+    char* buf = NULL;
+    struct stat sb;
+    ssize_t len = 0;
+    size_t i = 0;
+    int fd = -1;
+    int d = 0;
+    int rc = -1;
+
+    fd = open(CORE_INDEX_FILE, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (fstat(fd, &sb) < 0 || (size_t) sb.st_size < sizeof(header))
+    {
+        goto EXIT_FUN;
+    }
+    buf = malloc(sb.st_size);
+    if (buf == NULL)
+    {
+        goto EXIT_FUN;
+    }
+    len = read(fd, buf, sb.st_size);
+    if (len != sb.st_size)
+    {
+        goto EXIT_FUN;
+    }
+    memcpy(&header, buf, sizeof(header));
+    if (memcmp(header.magic, CORE_INDEX_MAGIC, sizeof(CORE_INDEX_MAGIC))
+        || header.version != CORE_INDEX_VERSION)
+    {
+        goto EXIT_FUN;
+    }
+    entries = calloc(header.count ? header.count : 1, sizeof(*entries));
+    if (entries == NULL)
+    {
+        goto EXIT_FUN;
+    }
+    p = buf + sizeof(header);
+    end = buf + len;
+    for (i = 0; i < header.count; i++)
+    {
+        entry = &entries[i];
+        if (end - p < 2)
+        {
+            goto EXIT_FUN;
+        }
+        entry->type = (unsigned char) *p++;
+        entry->valid = (unsigned char) *p++;
+        if (index_take_str(&p, end, entry->name, sizeof(entry->name))
+            || index_take_str(&p, end, entry->cd.daemon_name,
+                sizeof(entry->cd.daemon_name))
+            || index_take_str(&p, end, entry->cd.crash_date,
+                sizeof(entry->cd.crash_date))
+            || index_take_str(&p, end, entry->cd.crash_time,
+                sizeof(entry->cd.crash_time))
+            || index_take_str(&p, end, entry->cd.crash_signal,
+                sizeof(entry->cd.crash_signal))
+            || index_take_str(&p, end, entry->cd.crash_instance_id,
+                sizeof(entry->cd.crash_instance_id)))
+        {
+            goto EXIT_FUN;
+        }
+        if (entry->type != TYPE_DAEMON && entry->type != TYPE_KERNEL)
+        {
+            goto EXIT_FUN;
+        }
+    }
+
+    free(index_entries);
+    index_entries = entries;
+    index_count = header.count;
+    index_max = header.count ? header.count : 1;
+    entries = NULL;
+    for (d = 0; d < CORE_INDEX_DIRS; d++)
+    {
+        index_dirs[d].stamp = header.stamp[d];
+        index_dirs[d].synced = 0;
+    }
+    rc = 0;
+
+EXIT_FUN:
+    if (rc)
+    {
+        VLOG_DBG("core dump index %s not usable, rebuilding it",
+                CORE_INDEX_FILE);
+    }
+    free(entries);
+    free(buf);
+    close(fd);
+    return rc;
+}
+
+/*
+ * Function       : index_save
+ * Responsibility : Writes the index for the next CLI session. The file is
+ *                  replaced atomically, readers never see a partial index.
+ * Returns        : 0 on success
+ */
+static int
+index_save(void)
+{
+    struct core_index_header header;
+    const struct core_index_entry* entry = NULL;
+    char tmp_path[CORE_FILE_NAME];
+    char* buf = NULL;
+    size_t size = 0, done = 0;
+    ssize_t len = 0;
+    FILE* fp = NULL;
+    size_t i = 0;
+    int fd = -1;
+    int d = 0;
+    int rc = -1;
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CORE_INDEX_MAGIC, sizeof(CORE_INDEX_MAGIC));
+    header.version = CORE_INDEX_VERSION;
+    header.count = index_count;
+    for (d = 0; d < CORE_INDEX_DIRS; d++)
+    {
+        header.stamp[d] = index_dirs[d].stamp;
+    }
+
+    fp = open_memstream(&buf, &size);
+    if (fp == NULL)
+    {
+        return -1;
+    }
+    fwrite(&header, sizeof(header), 1, fp);
+    for (i = 0; i < index_count; i++)
+    {
+        entry = &index_entries[i];
+        fputc(entry->type, fp);
+        fputc(entry->valid, fp);
+        fwrite(entry->name, strlen(entry->name) + 1, 1, fp);
+        fwrite(entry->cd.daemon_name, strlen(entry->cd.daemon_name) + 1, 1,
+                fp);
+        fwrite(entry->cd.crash_date, strlen(entry->cd.crash_date) + 1, 1, fp);
+        fwrite(entry->cd.crash_time, strlen(entry->cd.crash_time) + 1, 1, fp);
+        fwrite(entry->cd.crash_signal, strlen(entry->cd.crash_signal) + 1, 1,
+                fp);
+        fwrite(entry->cd.crash_instance_id,
+                strlen(entry->cd.crash_instance_id) + 1, 1, fp);
+    }
+    if (fclose(fp) != 0)
+    {
+        free(buf);
+        return -1;
+    }
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.%d", CORE_INDEX_FILE,
+            (int) getpid());
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+            S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+    if (fd < 0)
+    {
+        VLOG_DBG("core dump index not saved: %s", strerror(errno));
+        free(buf);
+        return -1;
+    }
+    while (done < size)
+    {
+        len = write(fd, buf + done, size - done);
+        if (len < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (len <= 0)
+        {
+            break;
+        }
+        done += len;
+    }
+    if (close(fd) == 0 && done == size && rename(tmp_path, CORE_INDEX_FILE) == 0)
+    {
+        rc = 0;
+    }
+    else
+    {
+        VLOG_DBG("core dump index not saved: %s", strerror(errno));
+        unlink(tmp_path);
+    }
+    free(buf);
+    return rc;
+}
+
+/*
+ * Function       : index_watch
+ * Responsibility : Starts watching the core dump directories which are not
+ *                  watched yet, a directory can be created later on
+ * Returns        : void
+ */
+static void
+index_watch(void)
+{
+    int d = 0;
+
+    if (index_inotify_fd < 0)
+    {
+        index_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (index_inotify_fd < 0)
+        {
+            VLOG_DBG("core dump index: inotify not available: %s",
+                    strerror(errno));
+            return;
+        }
+    }
+    for (d = 0; d < CORE_INDEX_DIRS; d++)
+    {
+        if (index_dirs[d].wd >= 0)
+        {
+            continue;
+        }
+        index_dirs[d].wd = inotify_add_watch(index_inotify_fd,
+                index_dirs[d].path, CORE_INDEX_WATCH_EVENTS | IN_ONLYDIR);
+        /* whatever happened before the watch is not known */
+        index_dirs[d].synced = 0;
+    }
+}
+
+/*
+ * Function       : index_drain_events
+ * Responsibility : Applies the pending inotify events to the index
+ * Parameters
+ *                : rescan - set for a directory whose events were lost
+ * Returns        : 1 if the index changed, 0 otherwise
+ */
+static int
+index_drain_events(int* rescan)
+{
+    char buf[CORE_INDEX_EVENT_BUF]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event* ev = NULL;
+    const char* p = NULL;
+    ssize_t len = 0;
+    int changed = 0;
+    int d = 0;
+
+    if (index_inotify_fd < 0)
+    {
+        return 0;
+    }
+    while ((len = read(index_inotify_fd, buf, sizeof(buf))) > 0)
+    {
+        for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len)
+        {
+            ev = (const struct inotify_event*) p;
+            if (ev->mask & IN_Q_OVERFLOW)
+            {
+                for (d = 0; d < CORE_INDEX_DIRS; d++)
+                {
+                    rescan[d] = 1;
+                }
+                continue;
+            }
+            for (d = 0; d < CORE_INDEX_DIRS; d++)
+            {
+                if (index_dirs[d].wd >= 0 && index_dirs[d].wd == ev->wd)
+                {
+                    break;
+                }
+            }
+            if (d == CORE_INDEX_DIRS)
+            {
+                continue;
+            }
+            if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+            {
+                /* the directory is gone, watch it again once it is back */
+                if (!(ev->mask & IN_IGNORED))
+                {
+                    inotify_rm_watch(index_inotify_fd, index_dirs[d].wd);
+                }
+                index_dirs[d].wd = -1;
+                rescan[d] = 1;
+                continue;
+            }
+            if (ev->len == 0 || (ev->mask & IN_ISDIR)
+                || !index_name_match(index_dirs[d].type, ev->name))
+            {
+                continue;
+            }
+            if (ev->mask & CORE_INDEX_ADD_EVENTS)
+            {
+                index_upsert(index_dirs[d].type, ev->name);
+                changed = 1;
+            }
+            else if (ev->mask & CORE_INDEX_DEL_EVENTS)
+            {
+                index_remove(index_dirs[d].type, ev->name);
+                changed = 1;
+            }
+        }
+    }
+    return changed;
+}
+
+/*
+ * Function       : index_refresh
+ * Responsibility : Brings the index up to date. A watched directory which
+ *                  stayed in sync only needs its events applied, any other
+ *                  directory is read again if it changed since the index
+ *                  was last synced with it.
+ * Returns        : 0 on success
+ */
+static int
+index_refresh(void)
+{
+    struct core_index_stamp now[CORE_INDEX_DIRS];
+    int rescan[CORE_INDEX_DIRS] = {0,};
+    int changed = 0;
+    int d = 0;
+
+    if (!index_loaded)
+    {
+        index_load();
+        index_loaded = 1;
+    }
+    index_watch();
+    /* stamps are taken before the events are read, a change after this
+     * point is either in the events or seen on the next refresh */
+    for (d = 0; d < CORE_INDEX_DIRS; d++)
+    {
+        index_stamp(index_dirs[d].path, &now[d]);
+    }
+    changed = index_drain_events(rescan);
+
+    for (d = 0; d < CORE_INDEX_DIRS; d++)
+    {
+        if (rescan[d]
+            || (!index_stamp_equal(&now[d], &index_dirs[d].stamp)
+                && !(index_dirs[d].synced && index_dirs[d].wd >= 0)))
+        {
+            if (index_reconcile(&index_dirs[d]))
+            {
+                return -1;
+            }
+            changed = 1;
+        }
+        if (!index_stamp_equal(&now[d], &index_dirs[d].stamp))
+        {
+            index_dirs[d].stamp = now[d];
+            changed = 1;
+        }
+        index_dirs[d].synced = 1;
+    }
+    if (changed)
+    {
+        index_save();
+    }
+    return 0;
+}
+
+/*
+ * Function       : core_index_snapshot
+ * Responsibility : Returns a copy of the up to date index
+ * Parameters
+ *                : entries - set to the copy, NULL when there are no core
+ *                            dumps, freed by the caller
+ *                : count   - set to the number of entries
+ * Returns        : 0 on success
+ */
+int
+core_index_snapshot(struct core_index_entry** entries, size_t* count)
+{
+    int rc = 0;
+
+    *entries = NULL;
+    *count = 0;
+    /* show core-dump can also run on an executor worker from show tech */
+    pthread_mutex_lock(&index_mutex);
+    rc = index_refresh();
+    if (rc == 0 && index_count)
+    {
+        *entries = malloc(index_count * sizeof(**entries));
+        if (*entries == NULL)
+        {
+            VLOG_ERR("core dump index: memory allocation failed");
+            rc = -1;
+        }
+        else
+        {
+            memcpy(*entries, index_entries, index_count * sizeof(**entries));
+            *count = index_count;
+        }
+    }
+    pthread_mutex_unlock(&index_mutex);
+    return rc;
+}
+
+/*
+ * Function       : core_index_path
+ * Responsibility : Full path of the core dump of an entry
+ * Returns        : 0 on success
+ */
+int
+core_index_path(const struct core_index_entry* entry, char* buf, size_t size)
+{
+    const struct core_index_dir* dir = index_dir_of(entry->type);
+    int len = 0;
+
+    if (dir == NULL)
+    {
+        return -1;
+    }
+    len = snprintf(buf, size, "%s/%s", dir->path, entry->name);
+    if (len < 0 || (size_t) len >= size)
+    {
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Function       : core_index_match
+ * Responsibility : Selects the core dumps of a daemon, and of one of its
+ *                  instances, by the name systemd gave the file
+ * Returns        : 1 on match, 0 otherwise
+ */
+int
+core_index_match(const struct core_index_entry* entry, const char* daemon,
+        const char* instance_id)
+{
+    size_t len = 0;
+
+    if (entry->type != TYPE_DAEMON || daemon == NULL)
+    {
+        return 0;
+    }
+    len = strlen(daemon);
+    if (strncmp(entry->name, "core.", 5) != 0
+        || strncmp(entry->name + 5, daemon, len) != 0
+        || entry->name[5 + len] != '.')
+    {
+        return 0;
+    }
+    if (instance_id
+        && (!entry->valid
+            || strcmp(entry->cd.crash_instance_id, instance_id) != 0))
+    {
+        return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,475 @@
+/* Daemon registry.
+*
+* Copyright (C) 1997, 98 Kunihiro Ishiguro
+* Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+*
+* GNU Zebra is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the
+* Free Software Foundation; either version 2, or (at your option) any
+* later version.
+*
+* GNU Zebra is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with GNU Zebra; see the file COPYING.  If not, write to the Free
+* Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+* 02111-1307, USA.
+*
+* File: daemon_registry.c
+*
+* Purpose: Keeps the daemons of the OVS run directory, from their pid files
+*          <name>.pid and unixctl sockets <name>.<pid>.ctl, in a sorted
+*          array. The directory is read once, the array is then updated
+*          from inotify events, so that a daemon started after vtysh is
+*          known as soon as it created either file.
+*
+*          Without inotify the directory is read on every use.
+*/
+
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+#include "daemon_registry.h"
+#include "openvswitch/vlog.h"
+
+VLOG_DEFINE_THIS_MODULE (daemon_registry);
+
+#define REGISTRY_EVENT_BUF      4096
+#define REGISTRY_ADD_EVENTS     (IN_CREATE | IN_MOVED_TO)
+#define REGISTRY_DEL_EVENTS     (IN_DELETE | IN_MOVED_FROM)
+#define REGISTRY_WATCH_EVENTS   (REGISTRY_ADD_EVENTS | REGISTRY_DEL_EVENTS \
+                                 | IN_DELETE_SELF | IN_MOVE_SELF)
+
+static struct daemon_entry* registry_entries = NULL;
+static size_t registry_count = 0;
+static size_t registry_max = 0;
+static int registry_synced = 0;
+static int registry_inotify_fd = -1;
+static int registry_wd = -1;
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/*
+ * Function       : registry_ends_with
+ * Responsibility : Checks the extension of a file name
+ * Returns        : length of name without ext, 0 if it does not end with it
+ */
+static size_t
+registry_ends_with(const char* name, size_t len, const char* ext)
+{
+    size_t ext_len = strlen(ext);
+
+    if (len <= ext_len || strcmp(name + len - ext_len, ext))
+    {
+        return 0;
+    }
+    return len - ext_len;
+}
+
+/*
+ * Function       : registry_parse
+ * Responsibility : Finds the daemon of a pid file or of a unixctl socket
+ * Parameters
+ *                : file - name in the run directory
+ *                : name - set to the daemon name, NAME_MAX + 1 bytes
+ *                : pid - set to the pid of a unixctl socket, 0 otherwise
+ *                : is_ctl - set for a unixctl socket
+ * Returns        : 0 on success, -1 if file is neither
+ */
+static int
+registry_parse(const char* file, char* name, pid_t* pid, int* is_ctl)
+{
+    size_t len = strnlen(file, NAME_MAX + 1);
+    size_t base = 0, i = 0;
+
+    *pid = 0;
+    *is_ctl = 0;
+    if (len > NAME_MAX)
+    {
+        return -1;
+    }
+    if ((base = registry_ends_with(file, len, DAEMON_REGISTRY_PID_EXT)) == 0)
+    {
+        if ((base = registry_ends_with(file, len, DAEMON_REGISTRY_CTL_EXT))
+            == 0)
+        {
+            return -1;
+        }
+        *is_ctl = 1;
+        /* <name>.<pid>.ctl */
+        for (i = base; i > 0 && file[i - 1] >= '0' && file[i - 1] <= '9'; i--);
+        if (i < base && i > 1 && file[i - 1] == '.')
+        {
+            *pid = (pid_t) strtol(file + i, NULL, 10);
+            base = i - 1;
+        }
+    }
+    memcpy(name, file, base);
+    name[base] = '\0';
+    return 0;
+}
+
+/*
+ * Function       : registry_find
+ * Responsibility : Binary search of a daemon
+ * Parameters
+ *                : pos - set to the position of the daemon, or to the one
+ *                        it would be inserted at
+ * Returns        : 1 if found, 0 otherwise
+ */
+static int
+registry_find(const char* name, size_t* pos)
+{
+    size_t low = 0, high = registry_count, mid = 0;
+    int cmp = 0;
+
+    while (low < high)
+    {
+        mid = low + (high - low) / 2;
+        cmp = strcmp(registry_entries[mid].name, name);
+        if (cmp == 0)
+        {
+            *pos = mid;
+            return 1;
+        }
+        if (cmp < 0)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+    *pos = low;
+    return 0;
+}
+
+/*
+ * Function       : registry_update
+ * Responsibility : Applies the creation or the removal of a file of the run
+ *                  directory. A daemon is dropped once both its pid file
+ *                  and its unixctl socket are gone
+ * Returns        : void
+ */
+static void
+registry_update(const char* file, int present)
+{
+    char name[NAME_MAX + 1];
+    struct daemon_entry* entry = NULL;
+    struct daemon_entry* grown = NULL;
+    size_t pos = 0, max = 0;
+    pid_t pid = 0;
+    int is_ctl = 0;
+
+    if (registry_parse(file, name, &pid, &is_ctl) || name[0] == '\0')
+    {
+        return;
+    }
+    if (!registry_find(name, &pos))
+    {
+        if (!present)
+        {
+            return;
+        }
+        if (registry_count == registry_max)
+        {
+            max = registry_max ? 2 * registry_max : 32;
+            grown = realloc(registry_entries, max * sizeof(*grown));
+            if (grown == NULL)
+            {
+                VLOG_ERR("daemon registry: memory allocation failed");
+                return;
+            }
+            registry_entries = grown;
+            registry_max = max;
+        }
+        memmove(&registry_entries[pos + 1], &registry_entries[pos],
+                (registry_count - pos) * sizeof(*registry_entries));
+        memset(&registry_entries[pos], 0, sizeof(*registry_entries));
+        registry_entries[pos].name = strdup(name);
+        if (registry_entries[pos].name == NULL)
+        {
+            memmove(&registry_entries[pos], &registry_entries[pos + 1],
+                    (registry_count - pos) * sizeof(*registry_entries));
+            return;
+        }
+        registry_count++;
+    }
+    entry = &registry_entries[pos];
+    if (is_ctl)
+    {
+        /* the socket of a previous instance going away leaves the one of
+         * the current instance */
+        if (present || entry->pid == pid || pid == 0)
+        {
+            entry->has_ctl = present;
+            entry->pid = present ? pid : 0;
+        }
+    }
+    else
+    {
+        entry->has_pidfile = present;
+    }
+    if (!entry->has_ctl && !entry->has_pidfile)
+    {
+        free(entry->name);
+        registry_count--;
+        memmove(entry, entry + 1,
+                (registry_count - pos) * sizeof(*registry_entries));
+    }
+}
+
+/*
+ * Function       : registry_clear
+ * Responsibility : Drops every daemon
+ * Returns        : void
+ */
+static void
+registry_clear(void)
+{
+    size_t i = 0;
+
+    for (i = 0; i < registry_count; i++)
+    {
+        free(registry_entries[i].name);
+    }
+    registry_count = 0;
+}
+
+/*
+ * Function       : registry_scan
+ * Responsibility : Reads the run directory again
+ * Returns        : void
+ */
+static void
+registry_scan(void)
+{
+    struct dirent* ent = NULL;
+    DIR* dir = NULL;
+
+    registry_clear();
+    dir = opendir(DAEMON_REGISTRY_DIR);
+    if (dir == NULL)
+    {
+        VLOG_ERR("daemon registry: failed to open %s: %s",
+                 DAEMON_REGISTRY_DIR, strerror(errno));
+        return;
+    }
+    while ((ent = readdir(dir)) != NULL)
+    {
+        registry_update(ent->d_name, 1);
+    }
+    closedir(dir);
+    registry_synced = (registry_wd >= 0);
+}
+
+/*
+ * Function       : registry_watch
+ * Responsibility : Starts watching the run directory, again once it was
+ *                  removed
+ * Returns        : void
+ */
+static void
+registry_watch(void)
+{
+    if (registry_inotify_fd < 0)
+    {
+        registry_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (registry_inotify_fd < 0)
+        {
+            VLOG_DBG("daemon registry: inotify not available: %s",
+                     strerror(errno));
+            return;
+        }
+    }
+    if (registry_wd < 0)
+    {
+        registry_wd = inotify_add_watch(registry_inotify_fd,
+                DAEMON_REGISTRY_DIR, REGISTRY_WATCH_EVENTS | IN_ONLYDIR);
+        /* whatever happened before the watch is not known */
+        registry_synced = 0;
+    }
+}
+
+/*
+ * Function       : registry_drain_events
+ * Responsibility : Applies the pending inotify events to the registry
+ * Returns        : void
+ */
+static void
+registry_drain_events(void)
+{
+    char buf[REGISTRY_EVENT_BUF]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event* ev = NULL;
+    const char* p = NULL;
+    ssize_t len = 0;
+
+    if (registry_inotify_fd < 0)
+    {
+        return;
+    }
+    while ((len = read(registry_inotify_fd, buf, sizeof(buf))) > 0)
+    {
+        for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len)
+        {
+            ev = (const struct inotify_event*) p;
+            if (ev->mask & IN_Q_OVERFLOW)
+            {
+                registry_synced = 0;
+                continue;
+            }
+            if (ev->wd != registry_wd)
+            {
+                continue;
+            }
+            if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF))
+            {
+                /* the directory is gone, watch it again once it is back */
+                if (!(ev->mask & IN_IGNORED))
+                {
+                    inotify_rm_watch(registry_inotify_fd, registry_wd);
+                }
+                registry_wd = -1;
+                registry_synced = 0;
+                continue;
+            }
+            if (ev->len == 0 || (ev->mask & IN_ISDIR))
+            {
+                continue;
+            }
+            if (ev->mask & REGISTRY_ADD_EVENTS)
+            {
+                registry_update(ev->name, 1);
+            }
+            else if (ev->mask & REGISTRY_DEL_EVENTS)
+            {
+                registry_update(ev->name, 0);
+            }
+        }
+    }
+}
+
+/*
+ * Function       : registry_refresh
+ * Responsibility : Brings the registry up to date, the run directory is
+ *                  only read when the events cannot be trusted
+ * Returns        : void
+ */
+static void
+registry_refresh(void)
+{
+    registry_watch();
+    registry_drain_events();
+    if (!registry_synced)
+    {
+        registry_scan();
+    }
+}
+
+/*
+ * Function       : daemon_registry_running
+ * Responsibility : Checks whether a daemon runs. A daemon which crashed
+ *                  leaves its files behind, its unixctl socket names its pid
+ * Returns        : 1 if it runs, 0 otherwise
+ */
+int
+daemon_registry_running(const char* daemon)
+{
+    const struct daemon_entry* entry = NULL;
+    size_t pos = 0;
+    int running = 0;
+
+    if (daemon == NULL)
+    {
+        return 0;
+    }
+    pthread_mutex_lock(&registry_mutex);
+    registry_refresh();
+    if (registry_find(daemon, &pos))
+    {
+        entry = &registry_entries[pos];
+        if (entry->has_ctl && entry->pid > 0)
+        {
+            running = (kill(entry->pid, 0) == 0 || errno == EPERM);
+        }
+        else
+        {
+            running = entry->has_pidfile;
+        }
+    }
+    pthread_mutex_unlock(&registry_mutex);
+    return running;
+}
+
+/*
+ * Function       : daemon_registry_list
+ * Responsibility : Copies the daemons, sorted by name
+ * Parameters
+ *                : entries - set to the copy, released with
+ *                            daemon_registry_free
+ * Returns        : number of daemons, -1 on failure
+ */
+int
+daemon_registry_list(struct daemon_entry** entries)
+{
+    struct daemon_entry* copy = NULL;
+    int count = 0;
+    size_t i = 0;
+
+    *entries = NULL;
+    pthread_mutex_lock(&registry_mutex);
+    registry_refresh();
+    copy = calloc(registry_count + 1, sizeof(*copy));
+    if (copy == NULL)
+    {
+        pthread_mutex_unlock(&registry_mutex);
+        return -1;
+    }
+    for (i = 0; i < registry_count; i++)
+    {
+        copy[i] = registry_entries[i];
+        copy[i].name = strdup(registry_entries[i].name);
+        if (copy[i].name == NULL)
+        {
+            pthread_mutex_unlock(&registry_mutex);
+            daemon_registry_free(copy, (int) i);
+            return -1;
+        }
+    }
+    count = (int) registry_count;
+    pthread_mutex_unlock(&registry_mutex);
+    *entries = copy;
+    return count;
+}
+
+/*
+ * Function       : daemon_registry_free
+ * Responsibility : Releases a copy returned by daemon_registry_list
+ * Returns        : void
+ */
+void
+daemon_registry_free(struct daemon_entry* entries, int count)
+{
+    int i = 0;
+
+    if (entries == NULL)
+    {
+        return;
+    }
+    for (i = 0; i < count; i++)
+    {
+        free(entries[i].name);
+    }
+    free(entries);
+}
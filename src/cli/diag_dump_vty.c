@@ -31,13 +31,15 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 #include "openvswitch/vlog.h"
 #include "unixctl.h"
 #include "diag_dump_vty.h"
 #include "jsonrpc.h"
-#include <pthread.h>
 #include <signal.h>
 #include "supportability_utils.h"
+#include "supportability_executor.h"
+#include "daemon_registry.h"
 #define ARGC 2
 #define  ERR_STR\
     "Feature to daemon mapping failed. Unable to retrieve the daemon name."
@@ -45,20 +47,23 @@
 VLOG_DEFINE_THIS_MODULE(vtysh_diag);
 
 
-struct jsonrpc *client=NULL;
 struct vty *gVty = NULL;
 
 
 static int
 vtysh_diag_dump_daemon( char* daemon , char **cmd_type ,
-        int cmd_argc , struct vty *vty , int fd );
+        int cmd_argc , const struct executor_task *task );
+
+static int
+vtysh_diag_dump_output( char* daemon , char **cmd_type ,
+        const char *cmd_result , struct vty *vty , int fd );
 
 static int
-vtysh_diag_dump_create_thread( char* daemon , char **cmd_type ,
+vtysh_diag_dump_run_task( char* daemon , char **cmd_type ,
         int cmd_argc , struct vty *vty , int fd );
 
-static void *
-vtysh_diag_dump_thread( void* arg);
+static int
+vtysh_diag_dump_task( void* arg , const struct executor_task *task );
 
 static void
 vtysh_diag_list_features (struct feature* head ,  struct vty *vty);
@@ -67,127 +72,39 @@ vtysh_diag_list_features (struct feature* head ,  struct vty *vty);
 static int vtysh_diag_check_crete_dir( char *dir);
 
 
-
-void diagdump_user_interrupt_handler(int );
-
 /* diag dump global var should be intialized to zero */
 bool gDiagDumpUserInterrupt        = FALSE ;
-bool gDiagDumpUserInterruptAlarm   = FALSE ;
-bool gDiagDumpCommandFailed        = FALSE ;
 bool gDiagDumpThreadCancelled      = FALSE ;
 
-pthread_mutex_t gDiagDumpwaitMutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t gDiagDumpWaitCond = PTHREAD_COND_INITIALIZER;
-pthread_mutex_t gDiagDumpCleanupMutex = PTHREAD_MUTEX_INITIALIZER;
-
-
-/* Function       : dd_mutex_lock
- * Resposibility  : wrapper for mutex lock sys call, to log failed state
- * Return         : NULL
- */
-int dd_mutex_lock(pthread_mutex_t *mutex)
-{
-    int rc = -1 ;
-    rc = pthread_mutex_lock(mutex);
-    if(rc)
-    {
-        VLOG_ERR("diag dump:mutex lock failed, rc =%d", rc);
-    }
-    return rc;
-}
-
-/* Function       : dd_mutex_unlock
- * Resposibility  : wrapper for mutex unlock sys call, to log failed state
- * Return         : NULL
- */
-int dd_mutex_unlock(pthread_mutex_t *mutex)
-{
-    int rc = -1 ;
-    rc = pthread_mutex_unlock(mutex);
-    if(rc)
-    {
-        VLOG_ERR("diag dump:mutex unlock failed, rc =%d", rc);
-    }
-    return rc;
-}
 
-/* Function       : dd_alarm
- * Resposibility  : wrapper for alarm sys call, to log failed state
- * Return         : NULL
- */
-unsigned dd_alarm(unsigned seconds)
-{
-    unsigned int rc = 0 ;
-    rc = alarm(seconds);
-    if(rc)
-    {
-        VLOG_ERR("diag dump:alarm failed, rc =%d", rc);
-    }
-    return rc;
-}
-
-/* Function       : diagdump_thread_cleanup_handler
- * Resposibility  : to clean the cmd thread , currently it will close the
- *                  connection
- * Return         : NULL
- */
-void diagdump_thread_cleanup_handler(void *arg )
-{
-   /* cli cleanup function for interrupt */
-   reset_page_break_on_interrupt();
-   jsonrpc_close(client);
-   client = NULL;
-   dd_mutex_unlock( &gDiagDumpCleanupMutex );
-}
-
-/* Function       : vtysh_diag_dump_thread
- * Resposibility  : call the function which execute the diag dump
+/* Function       : vtysh_diag_dump_task
+ * Resposibility  : executor task body, call the function which execute the
+ *                  diag dump
  * Return         : 0 on success and nonzero on failure
  */
-void *
-vtysh_diag_dump_thread(void * argc)
+static int
+vtysh_diag_dump_task(void * argc, const struct executor_task *task)
 {
-   thread_arg arg = *(thread_arg *) argc;
-   char *daemon;
-   char ** cmd_type;
-   int cmd_argc;
-   struct vty * vty;
-   int fd ;
-   daemon = arg.daemon;
-   cmd_type = arg.cmd_type;
-   cmd_argc = arg.cmd_argc;
-   vty = arg.vty;
-   fd = arg.fd;
-   if(pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL))
-   {
-       VLOG_ERR("diag dump - unable to set cancel state of new thread");
-       return (void *) 0;
-   }
-   if(pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL))
+   thread_arg *arg = (thread_arg *) argc;
+   char *cmd_type[DIAG_CMD_ARGC_MAX];
+   int i = 0;
+
+   if(executor_task_cancelled(task))
    {
-       VLOG_ERR("diag dump - unable to set cancel type of new thread");
-       return (void *) 0;
+       return 1;
    }
-   pthread_cleanup_push(diagdump_thread_cleanup_handler, NULL);
-   dd_mutex_lock( &gDiagDumpCleanupMutex );
-
-   if(vtysh_diag_dump_daemon( daemon , cmd_type ,cmd_argc ,vty ,fd ))
-       gDiagDumpCommandFailed = TRUE ;
-
-   dd_mutex_lock( &gDiagDumpwaitMutex );
-   if(pthread_cond_signal( &gDiagDumpWaitCond ))
+   for(i = 0; i < arg->cmd_argc; i++)
    {
-       VLOG_ERR("diag dump - unable to enable signal main thread");
+       cmd_type[i] = arg->cmd_argv[i];
    }
-   dd_mutex_unlock( &gDiagDumpwaitMutex );
-   pthread_cleanup_pop(0);
-   dd_mutex_unlock( &gDiagDumpCleanupMutex );
-   return (void *) 0;
+   return vtysh_diag_dump_daemon( arg->daemon , cmd_type , arg->cmd_argc ,
+                                  task );
 }
 
 /*
- * Function       : vtysh_diag_dump_create_thread
- * Responsibility : create new thread and run one diag dump function
+ * Function       : vtysh_diag_dump_run_task
+ * Responsibility : run one diag dump function on the shared executor with a
+ *                  deadline of FUN_MAX_TIME
  *
  * Parameters
  *                : daemon
@@ -200,100 +117,73 @@ vtysh_diag_dump_thread(void * argc)
  *
  */
 static int
-vtysh_diag_dump_create_thread(char* daemon , char **cmd_type ,
+vtysh_diag_dump_run_task(char* daemon , char **cmd_type ,
         int cmd_argc , struct vty *vty , int fd )
 {
-    pthread_t tid;
     thread_arg arg;
-    struct timespec   ts;
-    int error;
-    int threadCancelled = TRUE;
+    struct executor_task *task = NULL;
+    enum executor_status status = EXECUTOR_TASK_ERROR;
+    char *cmd_result = NULL;
+    int rc = 1;
+    int i = 0;
 
-    gDiagDumpCommandFailed = FALSE;
-    arg.daemon = daemon ;
-    arg.cmd_type = cmd_type ;
-    arg.cmd_argc = cmd_argc ;
-    arg.vty = vty;
-    arg.fd = fd ;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    ts.tv_sec += FUN_MAX_TIME;
-    if(pthread_create(&tid,NULL,vtysh_diag_dump_thread,(void *)&arg))
-    {
-        VLOG_ERR("unable to create diag dump command thread");
+    if (!(daemon && cmd_type) || cmd_argc > DIAG_CMD_ARGC_MAX) {
+        VLOG_ERR("invalid parameter daemon or command ");
         return 1;
     }
-    dd_mutex_lock(&gDiagDumpwaitMutex);
-    error = pthread_cond_timedwait(&gDiagDumpWaitCond, &gDiagDumpwaitMutex,&ts);
-    dd_mutex_unlock(&gDiagDumpwaitMutex);
 
-    if(gDiagDumpUserInterruptAlarm == TRUE)
-    {
-        dd_alarm(0);
-        threadCancelled = FALSE ;
-        gDiagDumpUserInterruptAlarm = FALSE;
+    memset(&arg, 0, sizeof(arg));
+    strncpy(arg.daemon, daemon, sizeof(arg.daemon));
+    STR_SAFE(arg.daemon);
+    for (i = 0; i < cmd_argc; i++) {
+        strncpy(arg.cmd_argv[i], STR_NULL_CHK(cmd_type[i]),
+                sizeof(arg.cmd_argv[i]));
+        STR_SAFE(arg.cmd_argv[i]);
     }
+    arg.cmd_argc = cmd_argc ;
 
-    if(error == ETIMEDOUT)
-    {
-        error = pthread_cancel(tid);
-        if(error != 0)
-        {
-            VLOG_ERR("unable to cancel diag dump command thread");
-            /* we should be able to cancel the thread */
-        }
-
-        /*wait for the cleanup function to complete */
-        dd_mutex_lock( &gDiagDumpCleanupMutex );
-        dd_mutex_unlock( &gDiagDumpCleanupMutex );
-
-        vty_out(vty,"%s%s",CLI_STR_HYPHEN,VTY_NEWLINE);
-        vty_out(vty,"Deamon %s Timed Out %s",daemon,VTY_NEWLINE);
-        VLOG_ERR("Daemon :%s Timed Out - %d secs",
-                        daemon,FUN_MAX_TIME);
-        vty_out(vty,"%s%s",CLI_STR_HYPHEN,VTY_NEWLINE);
-        gDiagDumpThreadCancelled = TRUE;
-        gDiagDumpCommandFailed = TRUE ;
-    }
-    else if(gDiagDumpUserInterrupt)
-    {
-        if(threadCancelled)
-        {
-            pthread_cancel(tid); /* pthread_cancle can fail here as well */
+    task = executor_submit(vtysh_diag_dump_task, &arg, sizeof(arg),
+                           FUN_MAX_TIME);
+    if (task) {
+        status = executor_wait_result(task, &rc, (void **)&cmd_result);
+    }
+    switch (status) {
+        case EXECUTOR_TASK_DONE:
+            if (rc == DIAG_DUMP_NO_DAEMON) {
+                vty_out(vty,"failed to connect daemon %s %s",daemon,
+                        VTY_NEWLINE);
+                rc = CMD_WARNING;
+            }
+            if (vtysh_diag_dump_output(daemon, cmd_type, cmd_result, vty,
+                                       fd) != CMD_SUCCESS) {
+                rc = CMD_WARNING;
+            }
+            FREE(cmd_result);
+            return rc;
 
-            /*wait for the cleanup function to complete */
-            dd_mutex_lock( &gDiagDumpCleanupMutex );
-            dd_mutex_unlock( &gDiagDumpCleanupMutex );
+        case EXECUTOR_TASK_TIMEDOUT:
+            reset_page_break_on_interrupt();
+            vty_out(vty,"%s%s",CLI_STR_HYPHEN,VTY_NEWLINE);
+            vty_out(vty,"Deamon %s Timed Out %s",daemon,VTY_NEWLINE);
+            VLOG_ERR("Daemon :%s Timed Out - %d secs",
+                            daemon,FUN_MAX_TIME);
+            vty_out(vty,"%s%s",CLI_STR_HYPHEN,VTY_NEWLINE);
+            gDiagDumpThreadCancelled = TRUE;
+            return 1;
 
+        case EXECUTOR_TASK_INTERRUPTED:
+            reset_page_break_on_interrupt();
             vty_out(vty,"%s%s",CLI_STR_HYPHEN,VTY_NEWLINE);
             vty_out(vty,"Daemon %s terminated due to user interrupt %s",
                 daemon,VTY_NEWLINE);
             vty_out(vty,"%s%s",CLI_STR_HYPHEN,VTY_NEWLINE);
-                gDiagDumpThreadCancelled = TRUE;
-        }
-    }
-    /* Need to join the thread so, that thread resources will be freed*/
-    if(pthread_join(tid, NULL))
-    {
-        VLOG_ERR("unable to join with diag dump command thread");
-        return 1;
-    }
-    if(gDiagDumpCommandFailed || (gDiagDumpUserInterrupt && threadCancelled))
-    {
-        return 1;
-    }
-    return 0;
-}
+            gDiagDumpThreadCancelled = TRUE;
+            return 1;
 
-/* Function       : diagdump_user_interrupt_handler
- * Resposibility  : ctrl c handler for diagDump
- * Return         : NULL
- */
-void diagdump_user_interrupt_handler(int signum)
-{
-    dd_mutex_lock( &gDiagDumpwaitMutex );
-    pthread_cond_signal( &gDiagDumpWaitCond );
-    dd_mutex_unlock( &gDiagDumpwaitMutex );
-    gDiagDumpUserInterruptAlarm = FALSE;
+        default:
+            VLOG_ERR("unable to run diag dump for daemon %s",daemon);
+            return 1;
+    }
 }
 
 /* Function       : diagdump_signal_handler
@@ -309,14 +199,10 @@ diagdump_signal_handler(int sig, siginfo_t *siginfo, void *context)
     if(!gDiagDumpUserInterrupt)
     {
         gDiagDumpUserInterrupt = TRUE ;
-        /*trigger the alarm only if it is not yet triggered .*/
         vty_out(vty,"USER INTERRUPT:Diag dump will be terminated in 10 secs%s"
               ,VTY_NEWLINE);
-        if(!gDiagDumpUserInterruptAlarm)
-        {
-            gDiagDumpUserInterruptAlarm = TRUE;
-            dd_alarm(USER_INT_ALARM);
-        }
+        /* give the running daemon USER_INT_ALARM secs to respond */
+        executor_interrupt(USER_INT_ALARM);
     }
   }
 
@@ -332,9 +218,7 @@ diagdump_Zsignal_handler(int sig, siginfo_t *siginfo, void *context)
     if(!gDiagDumpUserInterrupt)
     {
         gDiagDumpUserInterrupt = TRUE ;
-        dd_mutex_lock( &gDiagDumpwaitMutex );
-        pthread_cond_signal( &gDiagDumpWaitCond );
-        dd_mutex_unlock( &gDiagDumpwaitMutex );
+        executor_interrupt(0);
     }
 }
 
@@ -542,23 +426,20 @@ DEFUN (vtysh_diag_dump_show,
     char write_buff[MAX_STR_BUFF_LEN]={0};
     char err_buf[MAX_STR_BUFF_LEN] = {0};
     struct sigaction oldSignalHandler,newSignalHandler,oldZSignalHandler,
-                oldAlarmHandler,newAlarmHandler,newZSignalHandler;
+                newZSignalHandler;
     int return_val = CMD_SUCCESS;
-    struct feature* feature_head = NULL;
 
     /* init global var */
     gDiagDumpUserInterrupt      = FALSE;
     gDiagDumpThreadCancelled    = FALSE;
-    gDiagDumpUserInterruptAlarm = FALSE;
     gVty                        = vty;
+    executor_clear_interrupt();
 
     /*change the signal handler */
     memset (&oldSignalHandler, '\0', sizeof(oldSignalHandler));
     memset (&newSignalHandler, '\0', sizeof(newSignalHandler));
     memset (&oldZSignalHandler, '\0', sizeof(oldZSignalHandler));
     memset (&newZSignalHandler, '\0', sizeof(newZSignalHandler));
-    memset (&oldAlarmHandler, '\0', sizeof(oldAlarmHandler));
-    memset (&newAlarmHandler, '\0', sizeof(newAlarmHandler));
 
     newSignalHandler.sa_sigaction = diagdump_signal_handler;
     newSignalHandler.sa_flags = SA_SIGINFO;
@@ -566,26 +447,12 @@ DEFUN (vtysh_diag_dump_show,
     newZSignalHandler.sa_sigaction = diagdump_Zsignal_handler;
     newZSignalHandler.sa_flags = SA_SIGINFO;
 
-    newAlarmHandler.sa_handler =  diagdump_user_interrupt_handler ;
-
     if(sigaction(SIGINT, &newSignalHandler, &oldSignalHandler) != 0)
     {
       VLOG_ERR("Failed to change signal handler");
       vty_out(vty, "diag dump init failed %s" ,VTY_NEWLINE);
       return CMD_WARNING;
     }
-    if(sigaction(SIGALRM, &newAlarmHandler, &oldAlarmHandler) != 0)
-    {
-      VLOG_ERR("Failed to change Alarm handler");
-      vty_out(vty, "diag dump init failed %s" ,VTY_NEWLINE);
-      if(sigaction(SIGINT, &oldSignalHandler, NULL) != 0)
-      {
-         VLOG_ERR("Failed to change signal handler to old state");
-         exit(0); //should never hit this place
-         /* we changed the CLI behavior */
-      }
-      return CMD_WARNING;
-    }
     if(sigaction(SIGTSTP, &newZSignalHandler, &oldZSignalHandler) != 0)
     {
       VLOG_ERR("Failed to change Ctrl Z handler");
@@ -596,28 +463,18 @@ DEFUN (vtysh_diag_dump_show,
          exit(0); //should never hit this place
          /* we changed the CLI behavior */
       }
-      if(sigaction(SIGALRM, &oldAlarmHandler, NULL) != 0)
-      {
-        VLOG_ERR("Failed to change Alarm handler to old state");
-        exit(0); //should never hit this place
-        /* we changed the CLI behavior */
-      }
       return CMD_WARNING;
     }
     fun_argv[1] = (char *)  argv[0];
     fun_argv[0] = DIAG_BASIC;
 
-    feature_head  = get_feature_mapping();
-    if ( feature_head == NULL ) {
+    if ( get_feature_mapping() == NULL ) {
         vty_out(vty,"%s%s", ERR_STR ,VTY_NEWLINE);
         return_val = CMD_WARNING ;
         goto EXIT_FUN;
     }
 
-    /* traverse linkedlist to find node */
-    for (   iter=feature_head ;
-            iter && strcmp_with_nullcheck(iter->name,argv[0]);
-            iter = iter->next);
+    iter = feature_mapping_find(argv[0]);
 
     if (iter) {
 
@@ -707,8 +564,14 @@ DEFUN (vtysh_diag_dump_show,
                 goto USER_INTERRUPT;
             }
 
+            /* a stopped daemon counts as not responded, without waiting
+             * for its connection to time out */
+            if (!daemon_registry_running(iter_daemon->name)) {
+                VLOG_ERR("daemon :%s is not running", iter_daemon->name);
+                continue;
+            }
 
-            rc = vtysh_diag_dump_create_thread(iter_daemon->name, fun_argv,
+            rc = vtysh_diag_dump_run_task(iter_daemon->name, fun_argv,
                     fun_argc, vty, fd );
             /*Count daemon responded */
             if (!rc) {
@@ -801,15 +664,9 @@ DEFUN (vtysh_diag_dump_show,
         exit(0); /* should never hit this place */
         /* we changed the CLI behavior */
     }
-    if(sigaction(SIGALRM, &oldAlarmHandler, NULL) != 0)
-    {
-      VLOG_ERR("Failed to change Alarm handler to old state");
-      exit(0); //should never hit this place
-      /* we changed the CLI behavior */
-    }
     if(gDiagDumpThreadCancelled)
     {
-      VLOG_ERR("thread has been cancelled");
+      VLOG_ERR("diag dump task has been cancelled");
     }
     if  (( return_val == CMD_SUCCESS ) && (argc >= 2)) {
         vty_out(vty,"%s diagnostic-dump is collected at %s %s",
@@ -834,54 +691,28 @@ DEFUN (vtysh_diag_dump_show,
 
 /*
  * Function       : vtysh_diag_dump_daemon
- * Responsibility : send request to dump diagnostic info using unixctl and
- *                  print result to console or file .
+ * Responsibility : send request to dump diagnostic info using unixctl, on
+ *                  an executor worker. The reply is handed back as the task
+ *                  result and printed by vtysh_diag_dump_output on the CLI
+ *                  thread.
  * Parameters
  *                : daemon
  *                : cmd_type - basic  or advanced
  *                : cmd_argc
- *                : vty
- *                : fd - file descriptor
- *                  prints on vtysh if fd is NULL
- *                  writes to file if  fd is valid
- * Returns        : 0 on success and nonzero on failure
+ *                : task - executor task running the request
+ * Returns        : CMD_SUCCESS on success, DIAG_DUMP_NO_DAEMON if the daemon
+ *                  is not reachable and CMD_WARNING on other failures
  */
 
 static int
 vtysh_diag_dump_daemon( char* daemon , char **cmd_type ,
-        int cmd_argc , struct vty *vty , int fd)
+        int cmd_argc , const struct executor_task *task)
 {
-
-/* This macro is used to call write and handle failure case of write  */
-#define WRITE_ERR_HANDLE_LOG_DAEMON(FD,BUF) \
-    rc = write( FD , BUF , strlen( BUF ) ); \
-    if ( rc < 0 ) \
-    { \
-        strerror_r (errno,err_buf,sizeof(err_buf));\
-        vty_out(vty, "%s%s%s",\
-                "Failed to write diagnostic dump into file due to reason : ",\
-                err_buf ,VTY_NEWLINE ); \
-        jsonrpc_close(client); \
-        client = NULL ; \
-        FREE(cmd_result); \
-        FREE(cmd_error); \
-        return CMD_WARNING; \
-    }
-
-#define  FEATURE_BEGIN\
-    snprintf(write_buff,sizeof(write_buff),"%s\n",CLI_STR_HYPHEN);\
-    STR_SAFE(write_buff);\
-    WRITE_ERR_HANDLE_LOG_DAEMON(fd, write_buff );
-
-#define  FEATURE_END FEATURE_BEGIN
-
-    char err_buf[MAX_STR_BUFF_LEN]={0};
-    char write_buff[MAX_STR_BUFF_LEN]={0};
     char *cmd_result=NULL, *cmd_error=NULL;
     int rc=0;
     char  diag_cmd_str[DIAG_CMD_LEN_MAX] = {0};
+    struct jsonrpc *client = NULL;
 
-    client = NULL ;
     if  (!(daemon && cmd_type)) {
         VLOG_ERR("invalid parameter daemon or command ");
         return CMD_WARNING;
@@ -889,8 +720,7 @@ vtysh_diag_dump_daemon( char* daemon , char **cmd_type ,
 
     if (!(client = connect_to_daemon(daemon))) {
         VLOG_ERR("%s transaction error.client is null ", daemon);
-        vty_out(vty,"failed to connect daemon %s %s",daemon,VTY_NEWLINE);
-        return CMD_WARNING;
+        return DIAG_DUMP_NO_DAEMON;
     }
 
 
@@ -903,6 +733,8 @@ vtysh_diag_dump_daemon( char* daemon , char **cmd_type ,
 
     rc = unixctl_client_transact(client, diag_cmd_str, cmd_argc , cmd_type,
             &cmd_result, &cmd_error);
+    jsonrpc_close(client);
+    client = NULL;
 
    /*
    * unixctl_client_transact() api failure case
@@ -914,82 +746,117 @@ vtysh_diag_dump_daemon( char* daemon , char **cmd_type ,
     if (rc) {
         VLOG_ERR("%s: transaction error:%s , rc =%d", daemon ,
                 STR_NULL_CHK(cmd_error)  , rc);
-        jsonrpc_close(client);
-        client = NULL;
         FREE(cmd_result);
         FREE(cmd_error);
         return CMD_WARNING;
     }
 
-   /* rc == 0 and cmd_result contains string is success   */
-    else if ( !VALID_FD_CHECK(fd)  && !strcmp_with_nullcheck(*cmd_type,DIAG_BASIC)) {
-        /* basic ,  file not specified  =>  print on console */
-        /* print if buffer contains output*/
-        if (cmd_result) {
-            vty_out ( vty,"%s%s",CLI_STR_HYPHEN, VTY_NEWLINE );
-            vty_out (vty, "[Start] Daemon %s %s",daemon,VTY_NEWLINE);
-            vty_out ( vty,"%s%s",CLI_STR_HYPHEN, VTY_NEWLINE );
-
-            vty_out (vty,"%s %s",cmd_result,VTY_NEWLINE );
+    /* rc == 0 and cmd_result contains string is success, an abandoned
+     * result is freed by the executor */
+    if (cmd_result) {
+        executor_task_set_result(task, cmd_result);
+        cmd_result = NULL;
+    }
 
-            vty_out ( vty,"%s%s",CLI_STR_HYPHEN, VTY_NEWLINE );
-            vty_out (vty, "[End] Daemon %s %s",daemon,VTY_NEWLINE);
-            vty_out ( vty,"%s%s",CLI_STR_HYPHEN, VTY_NEWLINE );
+    /* if cmd_error contains string then failure case */
 
-        }
-    } else {
-        /* all other case dump to file  */
-        if ( VALID_FD_CHECK(fd) && !strcmp_with_nullcheck(*cmd_type,DIAG_BASIC)) {
-            if ( cmd_result ) {
+    if (cmd_error) {
+        VLOG_ERR("%s: server returned error:rc=%d,error str:%s",
+                daemon,rc,cmd_error);
+        FREE(cmd_error);
+        return CMD_WARNING;
+    }
+    return CMD_SUCCESS;
+}
 
-                /* print ------- */
-                FEATURE_BEGIN
+/*
+ * Function       : vtysh_diag_dump_output
+ * Responsibility : print the diag dump reply of a daemon to console or file
+ * Parameters
+ *                : daemon
+ *                : cmd_type - basic  or advanced
+ *                : cmd_result - reply of the daemon
+ *                : vty
+ *                : fd - file descriptor
+ *                  prints on vtysh if fd is NULL
+ *                  writes to file if  fd is valid
+ * Returns        : CMD_SUCCESS on success and CMD_WARNING on failure
+ */
 
-                snprintf(write_buff,sizeof(write_buff),
-                        "[Start] Daemon %s\n",daemon);
-                STR_SAFE(write_buff);
-                WRITE_ERR_HANDLE_LOG_DAEMON( fd , write_buff );
+static int
+vtysh_diag_dump_output( char* daemon , char **cmd_type ,
+        const char *cmd_result , struct vty *vty , int fd )
+{
 
+/* This macro is used to call write and handle failure case of write  */
+#define WRITE_ERR_HANDLE_LOG_DAEMON(FD,BUF) \
+    rc = write( FD , BUF , strlen( BUF ) ); \
+    if ( rc < 0 ) \
+    { \
+        strerror_r (errno,err_buf,sizeof(err_buf));\
+        vty_out(vty, "%s%s%s",\
+                "Failed to write diagnostic dump into file due to reason : ",\
+                err_buf ,VTY_NEWLINE ); \
+        return CMD_WARNING; \
+    }
 
-                /* print ------- */
-                FEATURE_BEGIN
+#define  FEATURE_BEGIN\
+    snprintf(write_buff,sizeof(write_buff),"%s\n",CLI_STR_HYPHEN);\
+    STR_SAFE(write_buff);\
+    WRITE_ERR_HANDLE_LOG_DAEMON(fd, write_buff );
 
-                WRITE_ERR_HANDLE_LOG_DAEMON( fd , cmd_result);
-                WRITE_ERR_HANDLE_LOG_DAEMON( fd , "\n");
+#define  FEATURE_END FEATURE_BEGIN
 
+    char err_buf[MAX_STR_BUFF_LEN]={0};
+    char write_buff[MAX_STR_BUFF_LEN]={0};
+    int rc=0;
 
-                /* print ------- */
-                FEATURE_END
+    if (cmd_result == NULL || strcmp_with_nullcheck(*cmd_type,DIAG_BASIC)) {
+        return CMD_SUCCESS;
+    }
 
-                snprintf(write_buff,sizeof(write_buff),
-                        "[End] Daemon %s\n",daemon );
-                STR_SAFE(write_buff);
-                WRITE_ERR_HANDLE_LOG_DAEMON( fd , write_buff );
+    if ( !VALID_FD_CHECK(fd) ) {
+        /* basic ,  file not specified  =>  print on console */
+        vty_out ( vty,"%s%s",CLI_STR_HYPHEN, VTY_NEWLINE );
+        vty_out (vty, "[Start] Daemon %s %s",daemon,VTY_NEWLINE);
+        vty_out ( vty,"%s%s",CLI_STR_HYPHEN, VTY_NEWLINE );
 
+        vty_out (vty,"%s %s",cmd_result,VTY_NEWLINE );
 
-                /* print ------- */
-                FEATURE_END
-            }
-        }
+        vty_out ( vty,"%s%s",CLI_STR_HYPHEN, VTY_NEWLINE );
+        vty_out (vty, "[End] Daemon %s %s",daemon,VTY_NEWLINE);
+        vty_out ( vty,"%s%s",CLI_STR_HYPHEN, VTY_NEWLINE );
+        return CMD_SUCCESS;
     }
 
-    /* if cmd_error contains string then failure case */
+    /* print ------- */
+    FEATURE_BEGIN
 
-    if (cmd_error) {
-        VLOG_ERR("%s: server returned error:rc=%d,error str:%s",
-                daemon,rc,cmd_error);
-        jsonrpc_close(client);
-        client = NULL;
-        FREE(cmd_result);
-        FREE(cmd_error);
-        return CMD_WARNING;
-    }
+    snprintf(write_buff,sizeof(write_buff),
+            "[Start] Daemon %s\n",daemon);
+    STR_SAFE(write_buff);
+    WRITE_ERR_HANDLE_LOG_DAEMON( fd , write_buff );
 
 
-    jsonrpc_close(client);
-    client = NULL ;
-    FREE(cmd_result);
-    FREE(cmd_error);
+    /* print ------- */
+    FEATURE_BEGIN
+
+    WRITE_ERR_HANDLE_LOG_DAEMON( fd , cmd_result);
+    WRITE_ERR_HANDLE_LOG_DAEMON( fd , "\n");
+
+
+    /* print ------- */
+    FEATURE_END
+
+    snprintf(write_buff,sizeof(write_buff),
+            "[End] Daemon %s\n",daemon );
+    STR_SAFE(write_buff);
+    WRITE_ERR_HANDLE_LOG_DAEMON( fd , write_buff );
+
+
+    /* print ------- */
+    FEATURE_END
+
     return CMD_SUCCESS;
 
 #undef  FEATURE_BEGIN
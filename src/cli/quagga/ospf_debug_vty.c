@@ -35,6 +35,7 @@
 #include "vtysh/vtysh.h"
 #include "vtysh/vtysh_user.h"
 #include "vtysh/memory.h"
+#include "debug_ring.h"
 #include "dynamic-string.h"
 #include "diag_dump_vty.h"
 #include "jsonrpc.h"
@@ -49,9 +50,6 @@
 
 VLOG_DEFINE_THIS_MODULE (vtysh_ospf_debug);
 
-static struct feature* feature_head;
-static char initialized = 0; /* flag to check before parseing yaml file */
-
 static int
 vtysh_ospf_read_pid_file (char *pidfile);
 
@@ -61,6 +59,10 @@ vtysh_ospf_connect_to_target(const char *target);
 static int
 ospf_debug(const char **argv, int argc, int flag);
 
+static int
+ospf_debug_batch(const char *cmd, char **reqs[], const int reqs_argc[],
+                int nreqs, struct vty *vty);
+
 /*
  * Function       : vtysh_ospf_read_pid_file
  * Responsibility : read pid file
@@ -195,6 +197,61 @@ vtysh_ospf_connect_to_target(const char *target)
     return client;
 }
 
+/*
+ * Function       : vtysh_ospf_transact
+ * Responsibility : send one request to a daemon over an open connection
+ *                  and print result to console.
+ * Parameters     : client - connection to the daemon
+ *                : daemon
+ *                : cmd - unixctl command
+ *                : cmd_type - arguments of the command
+ *                : cmd_argc
+ *                : vty
+ * Returns        : 0 on success and nonzero on failure
+ */
+static int
+vtysh_ospf_transact(struct jsonrpc *client, const char *daemon,
+                const char *cmd, char **cmd_type, int cmd_argc,
+                struct vty *vty)
+{
+    char *cmd_result = NULL, *cmd_error = NULL;
+    int rc;
+
+    rc = unixctl_client_transact(client, cmd, cmd_argc, cmd_type,
+            &cmd_result, &cmd_error);
+
+    if (rc)
+    {
+        VLOG_ERR("%s: transaction error:%s , rc = %d", daemon,
+                STR_NULL_CHK(cmd_error), rc);
+        FREE(cmd_result);
+        FREE(cmd_error);
+        return CMD_WARNING;
+    }
+    else if (cmd_result != NULL)
+    {
+        vty_out(vty, "%s%s", cmd_result, VTY_NEWLINE);
+    }
+
+   /*
+   * unixctl_client_transact() api failure case
+   *  check cmd_error and rc value.
+   */
+
+    if (cmd_error)
+    {
+        VLOG_ERR("%s: server returned error: rc=%d, error str: %s",
+                daemon, rc, cmd_error);
+        FREE(cmd_result);
+        FREE(cmd_error);
+        return CMD_WARNING;
+    }
+
+    FREE(cmd_result);
+    FREE(cmd_error);
+    return CMD_SUCCESS;
+}
+
 /*
  * Function       : vtysh_set_ospf_debug
  * Responsibility : send request to target daemon using unixctl and
@@ -213,7 +270,6 @@ vtysh_set_ospf_debug(char* daemon, char **cmd_type, int cmd_argc,
                 struct vty *vty, int fd, int flag)
 {
     struct jsonrpc *client = NULL;
-    char *cmd_result = NULL, *cmd_error = NULL;
     char  ospf_cmd_str[DBG_CMD_LEN_MAX] = {0};
     int rc;
 
@@ -223,25 +279,17 @@ vtysh_set_ospf_debug(char* daemon, char **cmd_type, int cmd_argc,
         return CMD_WARNING;
     }
 
-    client = vtysh_ospf_connect_to_target(daemon);
-    if (!client)
-    {
-        VLOG_ERR("%s transaction error.client is null ", daemon);
-        vty_out(vty,"failed to connect daemon %s %s",daemon,VTY_NEWLINE);
-        return CMD_WARNING;
-    }
-
     if (flag == 0)
     {
-        strncpy(ospf_cmd_str, "ospf/debug", sizeof(ospf_cmd_str));
+        strncpy(ospf_cmd_str, OSPF_DEBUG_CMD, sizeof(ospf_cmd_str));
     }
     else if (flag == 1)
     {
-        strncpy(ospf_cmd_str, "ospf/show-debug", sizeof(ospf_cmd_str));
+        strncpy(ospf_cmd_str, OSPF_SHOW_DEBUG_CMD, sizeof(ospf_cmd_str));
     }
     else if (flag == 2)
     {
-        strncpy(ospf_cmd_str, "ospf/no-debug", sizeof(ospf_cmd_str));
+        strncpy(ospf_cmd_str, OSPF_NO_DEBUG_CMD, sizeof(ospf_cmd_str));
     }
     else
     {
@@ -250,42 +298,18 @@ vtysh_set_ospf_debug(char* daemon, char **cmd_type, int cmd_argc,
     }
     STR_SAFE(ospf_cmd_str);
 
-    rc = unixctl_client_transact(client, ospf_cmd_str, cmd_argc, cmd_type,
-            &cmd_result, &cmd_error);
-
-    if (rc)
-    {
-        VLOG_ERR("%s: transaction error:%s , rc = %d", daemon,
-                STR_NULL_CHK(cmd_error), rc);
-        jsonrpc_close(client);
-        FREE(cmd_result);
-        FREE(cmd_error);
-        return CMD_WARNING;
-    }
-    else if (cmd_result != NULL)
-    {
-        vty_out(vty, "%s%s", cmd_result, VTY_NEWLINE);
-    }
-
-   /*
-   * unixctl_client_transact() api failure case
-   *  check cmd_error and rc value.
-   */
-
-    if (cmd_error)
+    client = vtysh_ospf_connect_to_target(daemon);
+    if (!client)
     {
-        VLOG_ERR("%s: server returned error: rc=%d, error str: %s",
-                daemon, rc, cmd_error);
-        jsonrpc_close(client);
-        FREE(cmd_result);
-        FREE(cmd_error);
+        VLOG_ERR("%s transaction error.client is null ", daemon);
+        vty_out(vty,"failed to connect daemon %s %s",daemon,VTY_NEWLINE);
         return CMD_WARNING;
     }
 
+    rc = vtysh_ospf_transact(client, daemon, ospf_cmd_str, cmd_type,
+            cmd_argc, vty);
     jsonrpc_close(client);
-    FREE(cmd_result);
-    FREE(cmd_error);
-    return CMD_SUCCESS;
+    return rc;
 }
 
 DEFUN (show_debugging_info,
@@ -299,31 +323,20 @@ DEFUN (show_debugging_info,
     int fd = -1;
     int rc = 0;
 
-    struct feature* iter = feature_head;
+    struct feature* iter = NULL;
     struct daemon* iter_daemon = NULL;
     char *fun_argv[argc];
 
     fun_argv[0] = (char *)  argv[0];
     flag = 1;
 
-    if (!initialized)
+    iter = feature_mapping_find(argv[0]);
+    if ( iter == NULL )
     {
-        feature_head  = get_feature_mapping();
-        if ( feature_head == NULL )
-        {
-            vty_out(vty,"%s%s", ERR_STR ,VTY_NEWLINE);
-            return  CMD_WARNING ;
-        }
-        else
-        {
-            initialized = 1;
-        }
+        vty_out(vty,"%s%s", ERR_STR ,VTY_NEWLINE);
+        return  CMD_WARNING ;
     }
 
-    /* traverse linkedlist to find node */
-    for (iter = feature_head ; iter &&
-               strcmp_with_nullcheck(iter->name, argv[0]); iter = iter->next);
-
     VLOG_DBG("feature:%s , desc:%s",STR_NULL_CHK(iter->name),
                 STR_NULL_CHK(iter->desc));
 
@@ -355,7 +368,7 @@ ospf_debug(const char **argv, int argc, int flag)
     int fun_argc;
     int fd = -1;
     int rc = 0;
-    struct feature* iter = feature_head;
+    struct feature* iter = NULL;
     struct daemon* iter_daemon = NULL;
     char *fun_argv[argc];
 
@@ -379,24 +392,13 @@ ospf_debug(const char **argv, int argc, int flag)
        default: break;
     }
 
-    if (!initialized)
+    iter = feature_mapping_find(argv[0]);
+    if ( iter == NULL )
     {
-        feature_head  = get_feature_mapping();
-        if ( feature_head == NULL )
-        {
-            vty_out(vty,"%s%s", ERR_STR ,VTY_NEWLINE);
-            return  CMD_WARNING ;
-        }
-        else
-        {
-            initialized = 1;
-        }
+        vty_out(vty,"%s%s", ERR_STR ,VTY_NEWLINE);
+        return  CMD_WARNING ;
     }
 
-    /* traverse linkedlist to find node */
-    for (iter = feature_head ; iter &&
-               strcmp_with_nullcheck(iter->name, argv[0]); iter = iter->next);
-
     VLOG_DBG("feature:%s , desc:%s",STR_NULL_CHK(iter->name),
                 STR_NULL_CHK(iter->desc));
 
@@ -712,3 +714,257 @@ DEFUN (no_debug_ospf_intf_redst,
 {
     return ospf_debug(argv, argc, 2);
 }
+
+/*
+ * Debug categories of the profiles, sent to the daemons as the arguments of
+ * "debug ospfv2 <category> [<sub>]".
+ */
+static const struct ospf_debug_category
+{
+    const char *profile;
+    const char *category;
+    const char *sub;
+} ospf_debug_profiles[] =
+{
+    { "adjacency", "ism",          NULL },
+    { "adjacency", "nsm",          NULL },
+    { "adjacency", "packet",       "hello" },
+    { "adjacency", "packet",       "dd" },
+    { "flooding",  "lsa",          "flooding" },
+    { "flooding",  "packet",       "ls-request" },
+    { "flooding",  "packet",       "ls-update" },
+    { "flooding",  "packet",       "ls-ack" },
+    { "routing",   "lsa",          "generate" },
+    { "routing",   "lsa",          "install" },
+    { "routing",   "event",        NULL },
+    { "routing",   "interface",    NULL },
+    { "routing",   "redistribute", NULL },
+    { "all",       "packet",       "all" },
+    { "all",       "ism",          NULL },
+    { "all",       "nsm",          NULL },
+    { "all",       "lsa",          NULL },
+    { "all",       "event",        NULL },
+    { "all",       "nssa",         NULL },
+    { "all",       "interface",    NULL },
+    { "all",       "redistribute", NULL },
+};
+
+#define OSPF_DEBUG_PROFILE_MAX \
+    (sizeof(ospf_debug_profiles) / sizeof(ospf_debug_profiles[0]))
+
+/*
+ * Function       : ospf_debug_batch
+ * Responsibility : send several requests to each ospfv2 daemon, over one
+ *                  connection per daemon.
+ * Parameters     : cmd - unixctl command of all the requests
+ *                : reqs - arguments of each request
+ *                : reqs_argc - number of arguments of each request
+ *                : nreqs
+ *                : vty
+ * Returns        : CMD_SUCCESS, CMD_WARNING if a daemon failed
+ */
+static int
+ospf_debug_batch(const char *cmd, char **reqs[], const int reqs_argc[],
+                int nreqs, struct vty *vty)
+{
+    struct feature* iter = NULL;
+    struct daemon* iter_daemon = NULL;
+    struct jsonrpc *client = NULL;
+    int i = 0, failed = 0, rc = CMD_SUCCESS;
+
+    iter = feature_mapping_find(OSPF_FEATURE);
+    if ( iter == NULL )
+    {
+        vty_out(vty,"%s%s", ERR_STR ,VTY_NEWLINE);
+        return  CMD_WARNING ;
+    }
+
+    iter_daemon = iter->p_daemon;
+    while(iter_daemon)
+    {
+        client = vtysh_ospf_connect_to_target(iter_daemon->name);
+        if (!client)
+        {
+            VLOG_ERR("%s transaction error.client is null ",
+                        iter_daemon->name);
+            vty_out(vty,"failed to connect daemon %s %s",
+                        iter_daemon->name, VTY_NEWLINE);
+            rc = CMD_WARNING;
+            iter_daemon = iter_daemon->next;
+            continue;
+        }
+
+        failed = 0;
+        for (i = 0; i < nreqs; i++)
+        {
+            if (vtysh_ospf_transact(client, iter_daemon->name, cmd, reqs[i],
+                        reqs_argc[i], vty))
+            {
+                failed++;
+            }
+        }
+        jsonrpc_close(client);
+
+        if (failed)
+        {
+            VLOG_ERR("daemon :%s failed %d of %d %s requests",
+                        iter_daemon->name, failed, nreqs, cmd);
+            vty_out(vty,"daemon %s failed %d of %d requests%s",
+                        iter_daemon->name, failed, nreqs, VTY_NEWLINE);
+            rc = CMD_WARNING;
+        }
+        iter_daemon = iter_daemon->next;
+    }
+    return rc;
+}
+
+/*
+ * Function       : ospf_debug_profile
+ * Responsibility : turn on or off the debug categories of a profile, all
+ *                  of them in one transaction per daemon.
+ * Parameters     : profile
+ *                : flag - 0 to turn on, 2 to turn off
+ *                : vty
+ * Returns        : CMD_SUCCESS, CMD_WARNING on failure
+ */
+static int
+ospf_debug_profile(const char *profile, int flag, struct vty *vty)
+{
+    char *args[OSPF_DEBUG_PROFILE_MAX][3];
+    char **reqs[OSPF_DEBUG_PROFILE_MAX];
+    int reqs_argc[OSPF_DEBUG_PROFILE_MAX];
+    int i = 0, nreqs = 0;
+
+    for (i = 0; i < (int) OSPF_DEBUG_PROFILE_MAX; i++)
+    {
+        if (!profile || strcmp(ospf_debug_profiles[i].profile, profile))
+        {
+            continue;
+        }
+        args[nreqs][0] = OSPF_FEATURE;
+        args[nreqs][1] = (char *) ospf_debug_profiles[i].category;
+        args[nreqs][2] = (char *) ospf_debug_profiles[i].sub;
+        reqs[nreqs] = args[nreqs];
+        reqs_argc[nreqs] = ospf_debug_profiles[i].sub ? 3 : 2;
+        nreqs++;
+    }
+
+    if (nreqs == 0)
+    {
+        vty_out(vty, "Unknown debug profile %s%s", STR_NULL_CHK(profile),
+                VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+
+    return ospf_debug_batch((flag == 2) ? OSPF_NO_DEBUG_CMD : OSPF_DEBUG_CMD,
+            reqs, reqs_argc, nreqs, vty);
+}
+
+DEFUN (debug_ospf_profile,
+       debug_ospf_profile_cmd,
+       "debug ospfv2 profile (adjacency|flooding|routing|all)",
+       DBG_STR
+       OSPF_STR
+       OSPFv2_PROFILE
+       OSPFv2_PROFILE_ADJ
+       OSPFv2_PROFILE_FLOOD
+       OSPFv2_PROFILE_ROUTE
+       OSPFv2_PROFILE_ALL)
+{
+    return ospf_debug_profile(argv[argc - 1], 0, vty);
+}
+
+DEFUN (no_debug_ospf_profile,
+       no_debug_ospf_profile_cmd,
+       "no debug ospfv2 profile (adjacency|flooding|routing|all)",
+       NO_STR
+       DBG_STR
+       OSPF_STR
+       OSPFv2_PROFILE
+       OSPFv2_PROFILE_ADJ
+       OSPFv2_PROFILE_FLOOD
+       OSPFv2_PROFILE_ROUTE
+       OSPFv2_PROFILE_ALL)
+{
+    return ospf_debug_profile(argv[argc - 1], 2, vty);
+}
+
+/*
+ * Function       : ospf_debug_capture
+ * Responsibility : send a debug ring request to the ospfv2 daemons.
+ * Parameters     : cmd - DEBUG_RING_MODE_CMD or DEBUG_RING_DUMP_CMD
+ *                : arg1, arg2 - arguments of the request, NULL if none
+ *                : vty
+ * Returns        : CMD_SUCCESS, CMD_WARNING on failure
+ */
+static int
+ospf_debug_capture(const char *cmd, const char *arg1, const char *arg2,
+                struct vty *vty)
+{
+    char *args[2] = { (char *) arg1, (char *) arg2 };
+    char **reqs[1] = { args };
+    int reqs_argc[1];
+
+    reqs_argc[0] = arg1 ? (arg2 ? 2 : 1) : 0;
+    return ospf_debug_batch(cmd, reqs, reqs_argc, 1, vty);
+}
+
+DEFUN (debug_ospf_capture_ring,
+       debug_ospf_capture_ring_cmd,
+       "debug ospfv2 capture ring",
+       DBG_STR
+       OSPF_STR
+       OSPFv2_CAPTURE
+       OSPFv2_CAPTURE_RING)
+{
+    return ospf_debug_capture(DEBUG_RING_MODE_CMD, DEBUG_RING_MODE_RING,
+            NULL, vty);
+}
+
+DEFUN (debug_ospf_capture_ring_size,
+       debug_ospf_capture_ring_size_cmd,
+       "debug ospfv2 capture ring <64-65536>",
+       DBG_STR
+       OSPF_STR
+       OSPFv2_CAPTURE
+       OSPFv2_CAPTURE_RING
+       OSPFv2_CAPTURE_SIZE)
+{
+    return ospf_debug_capture(DEBUG_RING_MODE_CMD, DEBUG_RING_MODE_RING,
+            argv[argc - 1], vty);
+}
+
+DEFUN (no_debug_ospf_capture,
+       no_debug_ospf_capture_cmd,
+       "no debug ospfv2 capture",
+       NO_STR
+       DBG_STR
+       OSPF_STR
+       OSPFv2_CAPTURE)
+{
+    return ospf_debug_capture(DEBUG_RING_MODE_CMD, DEBUG_RING_MODE_LOG,
+            NULL, vty);
+}
+
+DEFUN (show_debugging_ospf_capture,
+       show_debugging_ospf_capture_cmd,
+       "show debugging ospfv2 capture",
+       SHOW_STR
+       SHOW_DBG_STR
+       OSPF_STR
+       OSPFv2_CAPTURE)
+{
+    return ospf_debug_capture(DEBUG_RING_DUMP_CMD, NULL, NULL, vty);
+}
+
+DEFUN (clear_debugging_ospf_capture,
+       clear_debugging_ospf_capture_cmd,
+       "clear debugging ospfv2 capture",
+       CLEAR_STR
+       SHOW_DBG_STR
+       OSPF_STR
+       OSPFv2_CAPTURE)
+{
+    return ospf_debug_capture(DEBUG_RING_DUMP_CMD, DEBUG_RING_DUMP_CLEAR,
+            NULL, vty);
+}
@@ -24,14 +24,24 @@
 */
 
 #include <glob.h>
+#include <poll.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <regex.h>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <readline/readline.h>
 
 #include "vtysh/command.h"
 #include "vtysh/vtysh.h"
 #include "vtysh/vtysh_user.h"
 #include "show_core_dump_vty.h"
+#include "core_dump_index.h"
+#include "crashprocessing.h"
+#include "flightrec.h"
 #include "smap.h"
 #include "vtysh/memory.h"
 #include "openvswitch/vlog.h"
@@ -39,6 +49,11 @@
 
 VLOG_DEFINE_THIS_MODULE (vtysh_show_core_dump_cli);
 
+/* subscription of this session to the crash notifications, and the
+ * readline input function it is chained to */
+static int monitor_fd = -1;
+static rl_getc_func_t *monitor_saved_getc = NULL;
+
 /*
  * Function       : signal_desc
  * Responsibility : Provides description of signal
@@ -71,177 +86,334 @@ signal_desc(const char *sig_char , char *sig_str , unsigned int size)
     return 0;
 }
 
+/*
+ * Function       : print_core_dump_header
+ * Responsibility : Prints the header of the core dump table
+ * Returns        : void
+ */
+static void
+print_core_dump_header(void)
+{
+    vty_out(vty
+            ,"==================================================="
+             "===================================%s"
+            ,VTY_NEWLINE);
+    vty_out(vty,"%-20.20s| %-12.12s| %-30.30s| %-21.21s%s",
+            "Daemon Name","Instance ID","Crash Reason","Timestamp",
+            VTY_NEWLINE);
+    vty_out(vty
+            ,"==================================================="
+             "===================================%s"
+            ,VTY_NEWLINE);
+}
+
+/*
+ * Function       : print_repeated_crashes
+ * Responsibility : Prints the crashes of which not every core dump was
+ *                  kept, as counted per stack signature by crash processing
+ * Returns        : void
+ */
+static void
+print_repeated_crashes(void)
+{
+    char process[DEAMON_NAME_SIZE];
+    char site[CORE_FILE_NAME];
+    unsigned int seen = 0, discarded = 0;
+    int header_p = 0;
+    FILE *fp = NULL;
+
+    fp = fopen(CRASH_SIGNATURE_DB, "r");
+    if(fp == NULL)
+    {
+        return;
+    }
+    while(fscanf(fp, "%*s %u %u %255s %599s", &seen, &discarded, process,
+                 site) == 4)
+    {
+        if(discarded == 0)
+        {
+            continue;
+        }
+        if(header_p == 0)
+        {
+            vty_out(vty,"Repeated crashes, only the first and the latest %d "
+                    "core dumps of each are kept%s",CRASH_DEDUP_KEEP - 1,
+                    VTY_NEWLINE);
+            vty_out(vty,"%-20.20s| %-40.40s| %-8.8s| %-10.10s%s",
+                    "Daemon Name","Crash Site","Crashes","Not Kept",
+                    VTY_NEWLINE);
+            header_p = 1;
+        }
+        vty_out(vty,"%-20.20s  %-40.40s  %-8u  %-10u%s",
+                process,site,seen,discarded,VTY_NEWLINE);
+    }
+    fclose(fp);
+}
+
 int
 cli_show_core_dump(void)
 {
-    glob_t globbuf_daemon;
-    glob_t globbuf_kernel;
+    struct core_index_entry *entries = NULL;
+    const struct core_index_entry *cd = NULL;
+    size_t count = 0;
     size_t i;
-
-    regex_t regexst_daemon;
-    regex_t regexst_kern;
-    struct core_dump_data cd = {{0}};
     char sig_desc[SIGNAL_DESC_STR_LEN]={0};
 
     int header_p = 0;
     int num_of_core =0;
+    int kernel_p = 0;
 
-    /* Prepare the regular expression to parse information from the
-       core files */
-
-    if(0 != compile_corefile_pattern(&regexst_daemon, CORE_FILE_PATTERN))
+    /* The core dump index holds the information extracted from the core
+       files, daemon core dumps first */
+    if(core_index_snapshot(&entries, &count) != 0)
     {
-        vty_out(vty,"Invalid core dump pattern%s",VTY_NEWLINE);
-        regfree(&regexst_daemon);
+        /* Failed to locate Core Dump Files */
+        vty_out(vty,"Failed to list core dumps%s",VTY_NEWLINE);
         return CMD_WARNING;
     }
 
-    if(0 != compile_corefile_pattern(&regexst_kern, KERN_CORE_FILE_PATTERN))
+    for (i = 0; i < count; i++)
     {
-        vty_out(vty,"Invalid kernel core dump pattern%s",VTY_NEWLINE);
-        regfree(&regexst_daemon);
-        regfree(&regexst_kern);
-        return CMD_WARNING;
+        cd = &entries[i];
+        if(!cd->valid)
+        {
+            continue;
+        }
+        /* Kernel Core file configuration is configured to generate only one
+         * core file */
+        if(cd->type == TYPE_KERNEL && kernel_p)
+        {
+            continue;
+        }
+        if(header_p == 0)
+        {
+            print_core_dump_header();
+            header_p = 1;
+        }
+        num_of_core++;
+        if(cd->type == TYPE_KERNEL)
+        {
+            kernel_p = 1;
+            vty_out(vty,"%-20.20s  %-12.12s  %-30.30s %-11.11s%-10.10s%s"
+                    ,"kernel"," "," ",cd->cd.crash_date,cd->cd.crash_time,
+                    VTY_NEWLINE);
+        }
+        else
+        {
+            memset(sig_desc,0,SIGNAL_DESC_STR_LEN);
+            signal_desc(cd->cd.crash_signal ,sig_desc,sizeof(sig_desc));
+            vty_out(vty,"%-20.20s  %-12.12s  %-30.30s %-11.11s%-10.10s%s"
+                    ,cd->cd.daemon_name,cd->cd.crash_instance_id,sig_desc,
+                    cd->cd.crash_date,cd->cd.crash_time,VTY_NEWLINE);
+        }
     }
-    /* Get File List for Daemon Cores
-       On Success :
-       globbuf_daemon.gl_pathc will contain the number of core dumps found
-       globbuf_daemon.gl_pathv will contain the core dump file names
-       */
-    if(0 !=
-            get_file_list(TYPE_DAEMON,&globbuf_daemon,GB_PATTERN,
-                NULL,NULL)
-      )
+    if(header_p)
     {
-        /* Failed to locate Core Dump Files */
+        vty_out(vty
+                ,"=========================================================="
+                 "============================%s"
+                ,VTY_NEWLINE);
+        vty_out(vty
+                ,"Total number of core dumps : %d%s",num_of_core
+                ,VTY_NEWLINE);
+        vty_out(vty
+                ,"=========================================================="
+                 "============================%s"
+                ,VTY_NEWLINE);
+    }
+    else
+    {
+        vty_out(vty,"No core dumps are present%s",VTY_NEWLINE);
+    }
+    print_repeated_crashes();
 
-        regfree  (&regexst_daemon);
-        regfree  (&regexst_kern);
-        return CMD_WARNING;
+    free(entries);
+    return CMD_SUCCESS;
+}
+
+
+/*
+ * Function       : print_flight_recorder
+ * Responsibility : Prints the last records of the flight recorder stored
+ *                  with a core dump, the events and log lines of the daemon
+ *                  just before it crashed
+ * Returns        : void
+ */
+static void
+print_flight_recorder(const char *core_path)
+{
+    char path[CORE_FILE_NAME + sizeof(FLIGHTREC_EXT)];
+    struct stat st;
+    char *buf = NULL, *line = NULL, *end = NULL;
+    size_t len = 0;
+    int lines = 0;
+    FILE *fp = NULL;
+
+    snprintf(path, sizeof(path), "%s%s", core_path, FLIGHTREC_EXT);
+    fp = fopen(path, "r");
+    if(fp == NULL || fstat(fileno(fp), &st) || st.st_size == 0
+       || (buf = malloc(st.st_size + 1)) == NULL)
+    {
+        vty_out(vty,"Flight Recorder : Not available%s",VTY_NEWLINE);
+        if(fp)
+        {
+            fclose(fp);
+        }
+        return;
     }
+    len = fread(buf, 1, st.st_size, fp);
+    fclose(fp);
+    buf[len] = '\0';
 
-    /* For each core dump file present, extract the timestamp and daemon
-     * information from the file name */
-    for (i = 0; i < globbuf_daemon.gl_pathc;i++)
+    /* back from the end to the start of the last lines */
+    line = buf + len;
+    if(line > buf && line[-1] == '\n')
+    {
+        line--;
+    }
+    while(line > buf)
     {
-        if(extract_info(
-                    &regexst_daemon,globbuf_daemon.gl_pathv[i],&cd,TYPE_DAEMON)
-                != -1)
+        if(line[-1] == '\n' && ++lines == CORE_DETAIL_FLIGHTREC_LINES)
         {
-            if(header_p == 0)
-            {
-                vty_out(vty
-                        ,"==================================================="
-                         "===================================%s"
-                        ,VTY_NEWLINE);
-                vty_out(vty,"%-20.20s| %-12.12s| %-30.30s| %-21.21s%s",
-                        "Daemon Name","Instance ID","Crash Reason","Timestamp",
-                        VTY_NEWLINE);
-                vty_out(vty
-                        ,"==================================================="
-                         "===================================%s"
-                        ,VTY_NEWLINE);
-                header_p = 1;
-            }
-            num_of_core++;
-            memset(sig_desc,0,SIGNAL_DESC_STR_LEN);
-            signal_desc(cd.crash_signal ,sig_desc,sizeof(sig_desc));
-            vty_out(vty,"%-20.20s  %-12.12s  %-30.30s %-11.11s%-10.10s%s"
-                    ,cd.daemon_name,cd.crash_instance_id,sig_desc,
-                    cd.crash_date,cd.crash_time,VTY_NEWLINE);
-       }
+            break;
+        }
+        line--;
     }
+    if(line > buf)
+    {
+        vty_out(vty,"Flight Recorder : last %d records, all in %s%s",
+                CORE_DETAIL_FLIGHTREC_LINES,path,VTY_NEWLINE);
+    }
+    else
+    {
+        vty_out(vty,"Flight Recorder :%s",VTY_NEWLINE);
+    }
+    for(; line < buf + len && *line; line = end + 1)
+    {
+        end = strchr(line, '\n');
+        if(end == NULL)
+        {
+            end = buf + len;
+        }
+        *end = '\0';
+        vty_out(vty,"    %s%s",line,VTY_NEWLINE);
+    }
+    free(buf);
+}
 
+/*
+ * Function       : print_core_dump_detail
+ * Responsibility : Prints one core dump with the stack signature, the
+ *                  backtrace and the flight recorder crash processing
+ *                  stored with it
+ * Returns        : void
+ */
+static void
+print_core_dump_detail(const struct core_index_entry *cd)
+{
+    char path[CORE_FILE_NAME];
+    char sig_desc[SIGNAL_DESC_STR_LEN] = {0};
+    char signature[SIGNAL_DESC_STR_LEN] = {0};
+    char backtrace[CRASH_BT_SIZE + 1] = {0};
+    char *frame = NULL, *save = NULL;
+    ssize_t len = 0;
 
-    /* Get file list for kernel  cores
-       On Success :
-       globbuf_daemon.gl_pathc will contain the no of kernel core dumps
-       globbuf_daemon.gl_pathv will contain the kernel core dump file names
-       */
-    if(get_file_list(TYPE_KERNEL,
-                &globbuf_kernel,KERN_GB_PATTERN, NULL,NULL)  != 0)
+    vty_out(vty,"==================================================="
+             "===================================%s",VTY_NEWLINE);
+    if(cd->type == TYPE_KERNEL)
     {
-        /* Failed to locate Core Dump Files */
+        vty_out(vty,"Daemon Name  : kernel%s",VTY_NEWLINE);
+        vty_out(vty,"Timestamp    : %s %s%s",cd->cd.crash_date,
+                cd->cd.crash_time,VTY_NEWLINE);
+        vty_out(vty,"File         : %s%s",cd->name,VTY_NEWLINE);
+        return;
+    }
+    signal_desc(cd->cd.crash_signal,sig_desc,sizeof(sig_desc));
+    vty_out(vty,"Daemon Name  : %s%s",cd->cd.daemon_name,VTY_NEWLINE);
+    vty_out(vty,"Instance ID  : %s%s",cd->cd.crash_instance_id,VTY_NEWLINE);
+    vty_out(vty,"Crash Reason : %s%s",sig_desc,VTY_NEWLINE);
+    vty_out(vty,"Timestamp    : %s %s%s",cd->cd.crash_date,
+            cd->cd.crash_time,VTY_NEWLINE);
+    vty_out(vty,"File         : %s%s",cd->name,VTY_NEWLINE);
 
-        /* No Core Dump found so far, hence error out */
-        if(header_p != 0)
+    if(core_index_path(cd, path, sizeof(path)))
+    {
+        return;
+    }
+    len = getxattr(path, CRASH_SIG_XATTR, signature, sizeof(signature) - 1);
+    vty_out(vty,"Signature    : %s%s",(len > 0) ? signature : "Not available",
+            VTY_NEWLINE);
+    len = getxattr(path, CRASH_BT_XATTR, backtrace, sizeof(backtrace) - 1);
+    if(len <= 0)
+    {
+        vty_out(vty,"Backtrace    : Not available%s",VTY_NEWLINE);
+    }
+    else
+    {
+        vty_out(vty,"Backtrace    :%s",VTY_NEWLINE);
+        for(frame = strtok_r(backtrace, "\n", &save); frame;
+            frame = strtok_r(NULL, "\n", &save))
         {
-            /* Some Daemon Core Dumps are present,
-             * print the footer and return */
-            vty_out(vty
-                    ,"====================================================="
-                     "=================================%s"
-                    ,VTY_NEWLINE);
-            vty_out(vty
-                    ,"Total number of core dumps : %d%s",num_of_core
-                    ,VTY_NEWLINE);
-            vty_out(vty
-                    ,"====================================================="
-                     "=================================%s"
-                    ,VTY_NEWLINE);
-
+            vty_out(vty,"    %s%s",frame,VTY_NEWLINE);
         }
+    }
+    print_flight_recorder(path);
+}
 
-        globfree (&globbuf_daemon);
-        regfree  (&regexst_daemon);
-        regfree  (&regexst_kern);
+/*
+ * Function       : cli_show_core_dump_detail
+ * Responsibility : Displays every core dump with its backtrace, taken on the
+ *                  switch when the core dump was stored, so that a crash can
+ *                  be triaged without copying the core dump
+ * Returns        : CMD_SUCCESS on success
+ */
+int
+cli_show_core_dump_detail(void)
+{
+    struct core_index_entry *entries = NULL;
+    size_t count = 0;
+    size_t i;
+    int num_of_core = 0;
+    int kernel_p = 0;
 
+    if(core_index_snapshot(&entries, &count) != 0)
+    {
+        vty_out(vty,"Failed to list core dumps%s",VTY_NEWLINE);
         return CMD_WARNING;
     }
-    else
+
+    for (i = 0; i < count; i++)
     {
-        if(globbuf_kernel.gl_pathc  > 0)
+        if(!entries[i].valid)
         {
-
-            if(extract_info(&regexst_kern,globbuf_kernel.gl_pathv[0],&cd
-                        ,TYPE_KERNEL) != -1)
+            continue;
+        }
+        /* Kernel Core file configuration is configured to generate only one
+         * core file */
+        if(entries[i].type == TYPE_KERNEL)
+        {
+            if(kernel_p)
             {
-                if(header_p == 0)
-                {
-                    vty_out(vty
-                            ,"=============================================="
-                             "========================================%s"
-                            ,VTY_NEWLINE);
-                    vty_out(vty,"%-20.20s| %-12.12s| %-30.30s| %-21.21s%s",
-                            "Daemon Name","Instance ID","Crash Reason","Timestamp",
-                            VTY_NEWLINE);
-                    vty_out(vty
-                            ,"=============================================="
-                             "========================================%s"
-                            ,VTY_NEWLINE);
-                    header_p = 1;
-                }
-                num_of_core++;
-                vty_out(vty,"%-20.20s  %-12.12s  %-30.30s %-11.11s%-10.10s%s"
-                        ,"kernel"," "," ",cd.crash_date,cd.crash_time,
-                        VTY_NEWLINE);
+                continue;
             }
+            kernel_p = 1;
         }
+        num_of_core++;
+        print_core_dump_detail(&entries[i]);
     }
-    if(header_p)
+    if(num_of_core)
     {
-        vty_out(vty
-                ,"=========================================================="
-                 "============================%s"
-                ,VTY_NEWLINE);
-        vty_out(vty
-                ,"Total number of core dumps : %d%s",num_of_core
-                ,VTY_NEWLINE);
-        vty_out(vty
-                ,"=========================================================="
-                 "============================%s"
-                ,VTY_NEWLINE);
+        vty_out(vty,"==================================================="
+                 "===================================%s",VTY_NEWLINE);
+        vty_out(vty,"Total number of core dumps : %d%s",num_of_core,
+                VTY_NEWLINE);
     }
     else
     {
         vty_out(vty,"No core dumps are present%s",VTY_NEWLINE);
     }
 
-    globfree (&globbuf_daemon);
-    globfree (&globbuf_kernel);
-    regfree  (&regexst_daemon);
-    regfree  (&regexst_kern);
-
+    free(entries);
     return CMD_SUCCESS;
 }
 
@@ -257,3 +429,193 @@ DEFUN_NOLOCK (cli_platform_show_core_dump,
   {
     return cli_show_core_dump();
   }
+
+
+/*
+* Action routines for Show Core Dump Detail
+*/
+DEFUN_NOLOCK (cli_platform_show_core_dump_detail,
+  cli_platform_show_core_dump_detail_cmd,
+  "show core-dump detail",
+  SHOW_STR
+  SHOW_CORE_DUMP_STR
+  SHOW_CORE_DUMP_DETAIL_STR)
+  {
+    return cli_show_core_dump_detail();
+  }
+
+
+/*
+ * Function       : core_dump_monitor_print
+ * Responsibility : Prints the alert of one crash
+ * Returns        : void
+ */
+static void
+core_dump_monitor_print(const struct crash_notification *n)
+{
+    char sig_str[SIGNAL_STR_SIZE + 1];
+    char sig_desc[SIGNAL_DESC_STR_LEN] = {0};
+    char stamp[DATE_STR_SIZE + TIME_STR_SIZE] = {0};
+    struct tm tm;
+    time_t t = (time_t) (n->timestamp / MICRO_SEC_IN_SEC);
+
+    snprintf(sig_str, sizeof(sig_str), "%d", n->signal_num);
+    signal_desc(sig_str, sig_desc, sizeof(sig_desc));
+    if(localtime_r(&t, &tm) == NULL
+       || strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm) == 0)
+    {
+        stamp[0] = '\0';
+    }
+    vty_out(vty,"%% %s %s (%d) crashed: %s%s",stamp,n->process,n->pid,
+            sig_desc,VTY_NEWLINE);
+    if(n->stored)
+    {
+        vty_out(vty,"%%   Core dump %s%s",n->file,VTY_NEWLINE);
+    }
+    else if(n->evicted)
+    {
+        vty_out(vty,"%%   Core dump %s removed by the retention policy%s",
+                n->file,VTY_NEWLINE);
+    }
+    else
+    {
+        vty_out(vty,"%%   Core dump not stored, %u crashes in %s%s",
+                n->crashes,n->site,VTY_NEWLINE);
+    }
+}
+
+/*
+ * Function       : core_dump_monitor_stop
+ * Responsibility : Ends the subscription of the session and gives readline
+ *                  its input function back
+ * Returns        : void
+ */
+static void
+core_dump_monitor_stop(void)
+{
+    if(monitor_fd >= 0)
+    {
+        close(monitor_fd);
+        monitor_fd = -1;
+    }
+    if(monitor_saved_getc)
+    {
+        rl_getc_function = monitor_saved_getc;
+        monitor_saved_getc = NULL;
+    }
+}
+
+/*
+ * Function       : core_dump_monitor_alert
+ * Responsibility : Prints the pending crash alerts above the line being
+ *                  typed, which is then redrawn as it was
+ * Returns        : void
+ */
+static void
+core_dump_monitor_alert(void)
+{
+    struct crash_notification n;
+    char *saved_line = rl_copy_text(0, rl_end);
+    int saved_point = rl_point;
+    int rc = 0;
+
+    rl_save_prompt();
+    rl_replace_line("", 0);
+    rl_redisplay();
+    vty_out(vty,"%s",VTY_NEWLINE);
+    while((rc = crash_notify_receive(monitor_fd, &n)) > 0)
+    {
+        core_dump_monitor_print(&n);
+    }
+    if(rc < 0)
+    {
+        vty_out(vty,"%% Crash notifications ended%s",VTY_NEWLINE);
+        core_dump_monitor_stop();
+    }
+    rl_restore_prompt();
+    rl_replace_line(saved_line ? saved_line : "", 0);
+    rl_point = saved_point;
+    rl_forced_update_display();
+    free(saved_line);
+}
+
+/*
+ * Function       : core_dump_monitor_getc
+ * Responsibility : Readline input function of a monitoring session, waits
+ *                  for a key or a crash notification, whichever comes
+ *                  first, so alerts show up while the prompt is idle
+ * Returns        : the key read
+ */
+static int
+core_dump_monitor_getc(FILE *stream)
+{
+    rl_getc_func_t *next = monitor_saved_getc;
+    struct pollfd fds[2];
+
+    while(monitor_fd >= 0)
+    {
+        fds[0].fd = fileno(stream);
+        fds[0].events = POLLIN;
+        fds[1].fd = monitor_fd;
+        fds[1].events = POLLIN;
+        fds[0].revents = fds[1].revents = 0;
+        /* on a signal readline is left to handle it */
+        if(poll(fds, 2, -1) < 0 || fds[0].revents)
+        {
+            break;
+        }
+        if(fds[1].revents)
+        {
+            core_dump_monitor_alert();
+        }
+    }
+    return next ? next(stream) : rl_getc(stream);
+}
+
+/*
+ * Function       : cli_monitor_core_dump
+ * Responsibility : Subscribes the session to the crash notifications
+ * Returns        : CMD_SUCCESS on success
+ */
+static int
+cli_monitor_core_dump(void)
+{
+    if(monitor_fd >= 0)
+    {
+        return CMD_SUCCESS;
+    }
+    monitor_fd = crash_notify_subscribe();
+    if(monitor_fd < 0)
+    {
+        vty_out(vty,"Crash notifications are not available%s",VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+    monitor_saved_getc = rl_getc_function;
+    rl_getc_function = core_dump_monitor_getc;
+    return CMD_SUCCESS;
+}
+
+/*
+* Action routines for Terminal Monitor Core Dump
+*/
+DEFUN_NOLOCK (cli_platform_monitor_core_dump,
+  cli_platform_monitor_core_dump_cmd,
+  "terminal monitor core-dump",
+  TERMINAL_STR
+  MONITOR_STR
+  MONITOR_CORE_DUMP_STR)
+  {
+    return cli_monitor_core_dump();
+  }
+
+DEFUN_NOLOCK (no_cli_platform_monitor_core_dump,
+  no_cli_platform_monitor_core_dump_cmd,
+  "no terminal monitor core-dump",
+  NO_STR
+  TERMINAL_STR
+  MONITOR_STR
+  MONITOR_CORE_DUMP_STR)
+  {
+    core_dump_monitor_stop();
+    return CMD_SUCCESS;
+  }
@@ -34,17 +34,21 @@
 #include "showtech.h"
 #include "vtysh/buffer.h"
 #include <errno.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <time.h>
-#include <pthread.h>
 #include <signal.h>
+#include <sys/wait.h>
+#include "supportability_executor.h"
+#include "showtech_diff.h"
 
 VLOG_DEFINE_THIS_MODULE (vtysh_show_tech_cli);
 
-#define     READ_LINE_SIZE    256
 #define     BASH_CAT_CMD      "bashcat"
-#define     CMD_MAX_TIME      60       //in secs
 #define     USER_INT_ALARM    10       //in secs
+#define     DIFF_LABEL_SIZE   300
+#define     CMD_READ_SIZE     4096
+#define     CMD_OUTPUT_MAX    (64 * 1024 * 1024)  //output kept per command
 
 #ifndef FALSE
 #define     FALSE             0
@@ -54,262 +58,250 @@ VLOG_DEFINE_THIS_MODULE (vtysh_show_tech_cli);
 #define     TRUE              1
 #endif
 
-void user_interrupt_handler(int );
-
 /* show tech global var should be intialized to zero */
 bool gUserInterrupt        = FALSE ;
-bool gUserInterruptAlarm   = FALSE ;
 bool gCommandFailed        = FALSE ;
 bool gThreadCancelled      = FALSE ;
 int  gVtyOldType           = 0     ;
 int  gUserInterruptVtyType = -1;
 
-pthread_mutex_t waitMutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t waitCond = PTHREAD_COND_INITIALIZER;
-pthread_mutex_t cleanupMutex = PTHREAD_MUTEX_INITIALIZER;
-
 
-extern pthread_mutex_t vtysh_ovsdb_mutex;
 extern int skip_further_execution;
 extern void reset_page_break_on_interrupt();
 
-/* Function       : st_mutex_lock
- * Resposibility  : wrapper for mutex lock sys call, to log failed state
- * Return         : NULL
- */
-int st_mutex_lock(pthread_mutex_t *mutex)
+/* Per run counters of show tech diff */
+struct showtech_diff_stats
 {
-    int rc = -1 ;
-    rc = pthread_mutex_lock(mutex);
-    if(rc)
-    {
-        VLOG_ERR("show tech:mutex lock failed, rc =%d", rc);
-    }
-    return rc;
-}
+   int changed;
+   int added;
+   int unchanged;
+};
+
+/* Rows of one feature and sub feature, with the output of their commands
+ * run so far. The output is kept until every priority class ran, so that
+ * it is displayed in configuration order. */
+struct showtech_block
+{
+   size_t first;
+   size_t end;
+   struct ds output;
+};
 
-/* Function       : st_mutex_unlock
- * Resposibility  : wrapper for mutex unlock sys call, to log failed state
- * Return         : NULL
- */
-int st_mutex_unlock(pthread_mutex_t *mutex)
+/* vty state saved while the output is captured */
+struct vty_capture
 {
-    int rc = -1 ;
-    rc = pthread_mutex_unlock(mutex);
-    if(rc)
-    {
-        VLOG_ERR("show tech:mutex unlock failed, rc =%d", rc);
-    }
-    return rc;
-}
+   char* pending;
+   int old_type;
+};
 
-/* Function       : st_alarm
- * Resposibility  : wrapper for alarm sys call, to log failed state
- * Return         : NULL
+/* Function       : showtech_trim
+ * Resposibility  : skip the whitespace at the beginning of str
+ * Return         : first non whitespace character of str
  */
-unsigned st_alarm(unsigned seconds)
+static const char*
+showtech_trim(const char* str)
 {
-    unsigned int rc = 0 ;
-    rc = alarm(seconds);
-    if(rc)
-    {
-        VLOG_ERR("show tech:alarm failed, rc =%d", rc);
-    }
-    return rc;
+   while ( isspace((unsigned char)(*str)))
+   {
+      str++;
+   }
+   return str;
 }
 
-/* Function       : exec_showtech_cmd_on_thread
- * Resposibility  : Parse the cli command and execute as needed on new thread
+/* Function       : showtech_exec
+ * Resposibility  : run argv in a process of its own and collect its output.
+ *                  The CLI is multithreaded, so the child only calls async
+ *                  signal safe functions before it execs: a lock held by
+ *                  another thread at fork time would never be released in
+ *                  the child. The child leads a process group of its own:
+ *                  the interrupts of the terminal are for the CLI, and the
+ *                  executor kills the whole group, with the processes the
+ *                  command started, when it gives up.
  * Return         : CMD_SUCCESS on success CMD_WARNING otherwise
  */
-int
-exec_showtech_cmd_on_thread(const char* cmd)
+static int
+showtech_exec(char* const argv[], struct ds* output,
+              const struct executor_task *task)
 {
-   const char* trim_cmd = cmd;
-   FILE *catFile;
-   char line[READ_LINE_SIZE];
-   /* Input argument validation */
-   if(cmd == NULL)
+   struct sigaction dfl;
+   sigset_t none;
+   char buf[CMD_READ_SIZE];
+   int pipefd[2] = {-1, -1};
+   ssize_t n = 0;
+   pid_t pid = 0;
+   int status = 0;
+   int null_fd = -1;
+
+   memset(&dfl, 0, sizeof(dfl));
+   dfl.sa_handler = SIG_DFL;
+   sigemptyset(&none);
+   /* close on exec, so that the children of concurrent commands do not
+    * keep each other's pipe open */
+   if(pipe2(pipefd, O_CLOEXEC) < 0)
    {
-     return CMD_WARNING;
+      VLOG_ERR("show tech: pipe failed, errno=%d", errno);
+      return CMD_WARNING;
    }
-
-   /* Ignore whitespace at the beginning */
-   while ( isspace((unsigned char)(*trim_cmd)))
+   null_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+   pid = fork();
+   if(pid < 0)
    {
-      trim_cmd++;
-   }
-
-   /* command contains only whitespaces :-( */
-   if(*trim_cmd == 0)
-   {
-      vty_out(vty,"Invalid command%s",VTY_NEWLINE);
+      VLOG_ERR("show tech: fork failed, errno=%d", errno);
+      close(pipefd[0]);
+      close(pipefd[1]);
+      if(null_fd >= 0)
+      {
+         close(null_fd);
+      }
       return CMD_WARNING;
    }
-
-   /* Check if the command is bashcat */
-   if(strncmp_with_nullcheck(BASH_CAT_CMD,trim_cmd,strlen(BASH_CAT_CMD)) == 0)
+   if(pid == 0)
    {
-      trim_cmd += strlen(BASH_CAT_CMD);
-      /* Ignore whitespace at the beginning  of file name*/
-      while ( isspace((unsigned char)(*trim_cmd)))
+      setpgid(0, 0);
+      sigaction(SIGINT, &dfl, NULL);
+      sigaction(SIGTSTP, &dfl, NULL);
+      sigaction(SIGPIPE, &dfl, NULL);
+      sigprocmask(SIG_SETMASK, &none, NULL);
+      if(null_fd >= 0)
+      {
+         dup2(null_fd, STDIN_FILENO);
+      }
+      if(dup2(pipefd[1], STDOUT_FILENO) < 0
+         || dup2(pipefd[1], STDERR_FILENO) < 0)
       {
-         trim_cmd++;
+         _exit(127);
       }
+      execv(argv[0], argv);
+      _exit(127);
+   }
+   close(pipefd[1]);
+   if(null_fd >= 0)
+   {
+      close(null_fd);
+   }
+   /* set on both sides, the group must exist before it can be killed */
+   setpgid(pid, pid);
+   executor_task_set_pid(task, pid);
 
-      /* filename not given :-( */
-      if(*trim_cmd == 0)
+   /* ends once the child exits or is killed */
+   for(;;)
+   {
+      n = read(pipefd[0], buf, sizeof(buf));
+      if(n < 0 && errno == EINTR)
       {
-         vty_out(vty,"Invalid file name%s",VTY_NEWLINE);
-         return CMD_WARNING;
+         continue;
       }
-      catFile = fopen(trim_cmd, "r");
-      if(catFile == NULL)
+      if(n <= 0)
       {
-         /* Not able to read the file */
-         vty_out(vty,"File %s is not readable%s",trim_cmd,VTY_NEWLINE);
-         return CMD_WARNING;
+         break;
       }
-
-      while(fgets(line, READ_LINE_SIZE,catFile) != NULL)
+      if(output->length < CMD_OUTPUT_MAX)
       {
-         /* check if the last character is \n, if so replace it, since \n
-          * wont work with vty_out properly, we need to use VTY_NEWLINE */
-         if(line[READ_LINE_SIZE-2] == '\n')
-         {
-            line[READ_LINE_SIZE-2] = 0;
-            vty_out(vty,"%s%s",line,VTY_NEWLINE);
-         }
-         vty_out(vty,"%s",line);
+         ds_put_buffer(output, buf, n);
       }
-      vty_out(vty,"%s",VTY_NEWLINE);
-      fclose(catFile);
-      return CMD_SUCCESS;
    }
-   else
+   close(pipefd[0]);
+
+   executor_task_set_pid(task, 0);
+   while(waitpid(pid, &status, 0) < 0 && errno == EINTR);
+
+   if(WIFEXITED(status) && WEXITSTATUS(status) == 0)
    {
-      return vtysh_execute(trim_cmd);
+      return CMD_SUCCESS;
    }
+   return CMD_WARNING;
 }
 
-/* Function       : cmd_thread_cleanup_handler
- * Resposibility  : to clean the cmd thread , currently it will release
-                    vtysh_ovsdb_mutex
- * Return         : NULL
+/* Function       : showtech_cmd_task
+ * Resposibility  : executor task body, runs one show tech command and hands
+ *                  its output back as the task result. The worker never
+ *                  touches the vty: bashcat runs cat, any other command runs
+ *                  in a vtysh of its own, and the executor kills either when
+ *                  the command times out or is interrupted.
+ * Return         : CMD_SUCCESS on success CMD_WARNING otherwise
  */
-void cmd_thread_cleanup_handler(void *arg )
+static int
+showtech_cmd_task(void *cmd, const struct executor_task *task)
 {
-   /* cli cleanup function for interrupt */
-   reset_page_break_on_interrupt();
-    //VTYSH_OVSDB_UNLOCK;
-   pthread_mutex_trylock(&vtysh_ovsdb_mutex); /* locks the mutex if thread don't
-                                                 own it */
-   pthread_mutex_unlock(&vtysh_ovsdb_mutex);
-   pthread_mutex_unlock( &cleanupMutex );
-}
+   struct ds output = DS_EMPTY_INITIALIZER;
+   const char* trim_cmd = showtech_trim((const char *)cmd);
+   const char* file = NULL;
+   int rc = CMD_WARNING;
 
-/* Function       : showtech_cmd_thread
- * Resposibility  : call the function which parse and execute the command
- *                  set the global var respectively
- * Return         : NULL , it sets the global var gCommadFail to CMD_SUCCESS on
- *                  success CMD_WARNING otherwise
- */
-void *
-showtech_cmd_thread(void * cmd)
-{
-  if(pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL))
+   if(executor_task_cancelled(task))
    {
-       VLOG_ERR("show tech - unable to set cancel state of new thread");
-       return (void *) 0;
+      return CMD_WARNING;
    }
-   if(pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL))
+
+   /* command contains only whitespaces :-( */
+   if(*trim_cmd == 0)
    {
-       VLOG_ERR("show tech - unable to set cancel type of new thread");
-       return (void *) 0;
+      ds_put_format(&output,"Invalid command\n");
    }
-   pthread_cleanup_push(cmd_thread_cleanup_handler, NULL);
-
-   st_mutex_lock( &cleanupMutex );
-
-   if(exec_showtech_cmd_on_thread((char *)cmd) != CMD_SUCCESS )
-       gCommandFailed = TRUE ;
-
-   st_mutex_lock( &waitMutex );
-   if(pthread_cond_signal( &waitCond ))
+   /* Check if the command is bashcat */
+   else if(strncmp_with_nullcheck(BASH_CAT_CMD,trim_cmd,
+              strlen(BASH_CAT_CMD)) == 0)
    {
-       VLOG_ERR("show tech - unable to enable signal main thread");
+      file = showtech_trim(trim_cmd + strlen(BASH_CAT_CMD));
+      if(*file == 0)
+      {
+         /* filename not given :-( */
+         ds_put_format(&output,"Invalid file name\n");
+      }
+      else if(access(file, R_OK) != 0)
+      {
+         /* Not able to read the file */
+         ds_put_format(&output,"File %s is not readable\n",file);
+      }
+      else
+      {
+         char* const argv[] = { SHOW_TECH_CAT_PATH, "--", (char *)file,
+                                NULL };
+         rc = showtech_exec(argv, &output, task);
+         ds_put_cstr(&output, "\n");
+      }
+   }
+   else
+   {
+      char* const argv[] = { SHOW_TECH_VTYSH_PATH, "-c", (char *)trim_cmd,
+                             NULL };
+      rc = showtech_exec(argv, &output, task);
    }
-   st_mutex_unlock( &waitMutex );
-   pthread_cleanup_pop(0);
-   st_mutex_unlock( &cleanupMutex );
-   return (void *) 0;
+
+   executor_task_set_result(task, ds_steal_cstr(&output));
+   return rc;
 }
+
 /* Function       : exec_showtech_cmd
  * Resposibility  : Parse the cli command and execute as needed
- *                  it is just a wrapper , it created a new thread and call the
- *                  function which parse and execute the command
+ *                  it is just a wrapper , it hands the command to the shared
+ *                  executor and waits for it with a deadline of timeout secs.
+ *                  The output is printed here, on the CLI thread, only once
+ *                  the command completed.
  * Return         : CMD_SUCCESS on success CMD_WARNING otherwise
  */
 int
-exec_showtech_cmd(const char* cmd)
+exec_showtech_cmd(const char* cmd, unsigned int timeout)
 {
-    pthread_t tid;
-    struct timespec   ts;
-    int error;
-    int threadCancelled = TRUE;
+    struct executor_task *task = NULL;
+    enum executor_status status = EXECUTOR_TASK_ERROR;
+    char *output = NULL;
+    int rc = CMD_WARNING;
 
-    gCommandFailed = FALSE;
-    clock_gettime(CLOCK_REALTIME, &ts);
-    ts.tv_sec += CMD_MAX_TIME;
-    if(pthread_create(&tid,NULL,showtech_cmd_thread,(void *)cmd))
+    if(cmd == NULL)
     {
-        VLOG_ERR("unable to create show tech command thread");
-        return 1;
+        return CMD_WARNING;
     }
-    st_mutex_lock(&waitMutex);
-    error = pthread_cond_timedwait(&waitCond, &waitMutex,&ts);
-    st_mutex_unlock(&waitMutex);
 
-    if(gUserInterruptAlarm == TRUE)
+    gCommandFailed = FALSE;
+    task = executor_submit(showtech_cmd_task, cmd, strlen(cmd) + 1, timeout);
+    if(task)
     {
-        st_alarm(0);
-        threadCancelled = FALSE ;
-        gUserInterruptAlarm = FALSE;
+        status = executor_wait_result(task, &rc, (void **)&output);
     }
 
-    if(error == ETIMEDOUT)
+    if(gUserInterrupt)
     {
-        error = pthread_cancel(tid);
-        if(error != 0)
-        {
-            VLOG_ERR("unable to cancel show tech command thread");
-            // we should be able to cancel the thread
-        }
-
-        /*wait for the cleanup function to complete */
-        st_mutex_lock( &cleanupMutex );
-        st_mutex_unlock( &cleanupMutex );
-
-        vty_out(vty,"%s---------------------------------%s"
-                ,VTY_NEWLINE,VTY_NEWLINE);
-        vty_out(vty,"Command %s Timed Out%s",(char *)cmd,VTY_NEWLINE);
-        vty_out(vty,"---------------------------------%s"
-            ,VTY_NEWLINE);
-        gThreadCancelled = TRUE;
-        gCommandFailed = TRUE ;
-    }
-    else if(gUserInterrupt)
-    {
-        if(threadCancelled)
-        {
-            pthread_cancel(tid);
-
-            /*wait for the cleanup function to complete */
-            st_mutex_lock( &cleanupMutex );
-            st_mutex_unlock( &cleanupMutex );
-
-        }
-
         if(gUserInterruptVtyType != -1)
         {
             vty->type = gUserInterruptVtyType ;
@@ -318,75 +310,341 @@ exec_showtech_cmd(const char* cmd)
         {
             buffer_reset(vty->obuf);
         }
+    }
 
-        if(threadCancelled)
-        {
+    switch(status)
+    {
+        case EXECUTOR_TASK_DONE:
+            if(output && !gUserInterrupt)
+            {
+                vty_out(vty,"%s",output);
+            }
+            if(rc != CMD_SUCCESS)
+                gCommandFailed = TRUE ;
+            break;
+
+        case EXECUTOR_TASK_TIMEDOUT:
+            reset_page_break_on_interrupt();
+            vty_out(vty,"%s---------------------------------%s"
+                    ,VTY_NEWLINE,VTY_NEWLINE);
+            vty_out(vty,"Command %s Timed Out%s",cmd,VTY_NEWLINE);
+            vty_out(vty,"---------------------------------%s"
+                ,VTY_NEWLINE);
+            gThreadCancelled = TRUE;
+            gCommandFailed = TRUE ;
+            break;
+
+        case EXECUTOR_TASK_INTERRUPTED:
+            reset_page_break_on_interrupt();
             vty_out(vty,"%s---------------------------------%s"
                 ,VTY_NEWLINE,VTY_NEWLINE);
             vty_out(vty,"Command %s terminated due to user interrupt %s",
-                   (char *)cmd,VTY_NEWLINE);
+                   cmd,VTY_NEWLINE);
             vty_out(vty,"---------------------------------%s"
                 ,VTY_NEWLINE);
             gThreadCancelled = TRUE;
-        }
-    }
-    /* Need to join the thread so, that thread resources will be freed*/
-    if(pthread_join(tid, NULL))
-    {
-        VLOG_ERR("unable to join with show tech command thread");
-        return 1;
+            gCommandFailed = TRUE ;
+            break;
+
+        default:
+            VLOG_ERR("unable to run show tech command %s", cmd);
+            gCommandFailed = TRUE ;
+            break;
     }
-    if(gCommandFailed || (gUserInterrupt && threadCancelled))
+    free(output);
+
+    if(gCommandFailed)
     {
         return CMD_WARNING;
     }
     return CMD_SUCCESS;
 }
 /* Function       : print_failed_commands
- * Resposibility  : Print the list of cli commands that failed to execute as
- *                  well as to reset the failure status.
+ * Resposibility  : Print the list of cli commands that failed to execute,
+ *                  failed holds the failure status of every row of the
+ *                  table for this run only, the table is shared.
  * Return         : void
  */
 
 void
-print_failed_commands(struct feature* head)
+print_failed_commands(const struct showtech_table* table, const char* failed)
 {
-   struct feature* iter = head;
-   struct sub_feature* iter_sub = NULL;
+   size_t row = 0;
    struct clicmds* iter_cli = NULL;
    int count = 1;
-   while (iter != NULL)
+   for (row = 0; row < table->n_cmds; row++)
+   {
+      iter_cli = table->cmds[row].clicmd;
+      if(iter_cli && failed[row])
+      {
+         vty_out(vty,"  %d. %s%s",count++,iter_cli->command,VTY_NEWLINE);
+      }
+   }
+}
+
+/* Function       : print_feature_banner
+ * Resposibility  : Print the [Begin]/[End] banner of a feature
+ * Return         : void
+ */
+static void
+print_feature_banner(const char* tag, const char* name)
+{
+   vty_out(vty,"====================================================%s"
+         ,VTY_NEWLINE);
+   vty_out(vty,"[%s] Feature %s%s", tag, name, VTY_NEWLINE);
+   vty_out(vty,"====================================================%s%s"
+         ,VTY_NEWLINE,VTY_NEWLINE);
+}
+
+/* Function       : print_sub_feature_banner
+ * Resposibility  : Print the [Begin]/[End] banner of a sub feature
+ * Return         : void
+ */
+static void
+print_sub_feature_banner(const char* tag, const char* name)
+{
+   vty_out(vty,"= = = = = = = = = = = = = = = = = = = = = = = = = = =%s"
+         ,VTY_NEWLINE);
+   vty_out(vty,"[%s] Sub Feature %s%s", tag, name, VTY_NEWLINE);
+   vty_out(vty,"= = = = = = = = = = = = = = = = = = = = = = = = = = =%s%s"
+         ,VTY_NEWLINE,VTY_NEWLINE);
+}
+
+/* Function       : print_text_lines
+ * Resposibility  : Print a multi line buffer, \n wont work with vty_out
+ *                  properly so every line is terminated with VTY_NEWLINE
+ * Return         : void
+ */
+static void
+print_text_lines(const char* text)
+{
+   const char* nl = NULL;
+   int len = 0;
+
+   while(text && *text)
+   {
+      nl = strchr(text, '\n');
+      len = nl ? (int)(nl - text) : (int)strlen(text);
+      if(len && text[len - 1] == '\r')
+      {
+         len--;
+      }
+      vty_out(vty,"%.*s%s", len, text, VTY_NEWLINE);
+      if(nl == NULL)
+      {
+         break;
+      }
+      text = nl + 1;
+   }
+}
+
+/* Function       : vty_capture_begin
+ * Resposibility  : Keep what is printed on the vty from now on instead of
+ *                  displaying it, until vty_capture_end. Captures nest.
+ * Return         : void
+ */
+static void
+vty_capture_begin(struct vty_capture* capture)
+{
+   capture->pending = NULL;
+   /* output already queued on a file vty has to survive the capture */
+   if(vty->type == VTY_FILE)
+   {
+      capture->pending = buffer_getstr(vty->obuf);
+      buffer_reset(vty->obuf);
+   }
+   capture->old_type = vty->type;
+   vty->type = VTY_FILE;
+}
+
+/* Function       : vty_capture_end
+ * Resposibility  : End a capture started by vty_capture_begin
+ * Return         : what was printed, to be freed by the caller
+ */
+static char*
+vty_capture_end(struct vty_capture* capture)
+{
+   char* output = buffer_getstr(vty->obuf);
+
+   buffer_reset(vty->obuf);
+   vty->type = capture->old_type;
+   if(capture->pending)
    {
-      iter_sub = iter->p_subfeature;
+      vty_out(vty,"%s",capture->pending);
+      free(capture->pending);
+      capture->pending = NULL;
+   }
+   return output;
+}
+
+/* Function       : capture_showtech_cmd
+ * Resposibility  : Run a show tech command with its output captured instead
+ *                  of displayed. Output beyond max_output_bytes of the
+ *                  command is dropped, at a line boundary when possible.
+ * Return         : CMD_SUCCESS on success CMD_WARNING otherwise
+ */
+static int
+capture_showtech_cmd(const struct clicmds* clicmd, char** output,
+                     size_t* omitted)
+{
+   struct vty_capture capture;
+   size_t len = 0, cut = 0;
+   int rc = CMD_SUCCESS;
 
-      while (iter_sub)
+   *omitted = 0;
+   vty_capture_begin(&capture);
+   rc = exec_showtech_cmd(clicmd->command, clicmd->timeout);
+   *output = vty_capture_end(&capture);
+
+   if(*output && clicmd->max_output_bytes)
+   {
+      len = strlen(*output);
+      if(len > clicmd->max_output_bytes)
       {
-         iter_cli = iter_sub->p_clicmds;
-         while (iter_cli)
+         cut = clicmd->max_output_bytes;
+         while(cut && (*output)[cut - 1] != '\n')
          {
-            if(iter_cli->command_failed)
-            {
-               vty_out(vty,"  %d. %s%s",count++,iter_cli->command,VTY_NEWLINE);
-               iter_cli->command_failed = 0;
-            }
-            iter_cli = iter_cli->next;
+            cut--;
+         }
+         if(cut == 0)
+         {
+            /* a single long line, cut it where the limit is */
+            cut = clicmd->max_output_bytes;
          }
-         iter_sub = iter_sub->next;
+         (*output)[cut] = 0;
+         *omitted = len - cut;
       }
-      iter = iter->next;
    }
+   return rc;
 }
 
-/* Function       : user_interrupt_handler
- * Resposibility  : ctrl c handler for showtech
- * Return         : NULL
+/* Function       : print_showtech_cmd
+ * Resposibility  : Run a show tech command, the output of commands with an
+ *                  output limit is captured and cut before it is displayed
+ * Return         : CMD_SUCCESS on success CMD_WARNING otherwise
  */
-void user_interrupt_handler(int signum)
+static int
+print_showtech_cmd(const struct clicmds* clicmd)
 {
-    st_mutex_lock( &waitMutex );
-    pthread_cond_signal( &waitCond );
-    st_mutex_unlock( &waitMutex );
-    gUserInterruptAlarm = FALSE;
+   char* output = NULL;
+   size_t omitted = 0;
+   int rc = CMD_SUCCESS;
+
+   if(clicmd->max_output_bytes == 0)
+   {
+      return exec_showtech_cmd(clicmd->command, clicmd->timeout);
+   }
+   rc = capture_showtech_cmd(clicmd, &output, &omitted);
+   print_text_lines(output);
+   if(omitted)
+   {
+      vty_out(vty,"%s[Output truncated, %zu bytes omitted]%s",
+            VTY_NEWLINE, omitted, VTY_NEWLINE);
+   }
+   free(output);
+   return rc;
+}
+
+/* Function       : diff_showtech_cmd
+ * Resposibility  : Run a show tech command with its output captured, print
+ *                  it as a unified diff against the previous capture when it
+ *                  changed, and store it as the new reference.
+ *                  A failed command keeps the previous reference and its
+ *                  output is printed as is.
+ * Return         : CMD_SUCCESS on success CMD_WARNING otherwise
+ */
+static int
+diff_showtech_cmd(struct showtech_store* store, const struct clicmds* clicmd,
+                  struct showtech_diff_stats* stats)
+{
+   const char* command = clicmd->command;
+   char old_digest[SHA256_HEX_LEN] = {0,};
+   char new_digest[SHA256_HEX_LEN] = {0,};
+   char old_label[DIFF_LABEL_SIZE];
+   char new_label[DIFF_LABEL_SIZE];
+   const char* digest = NULL;
+   const char* state = NULL;
+   char* output = NULL;
+   const char* text = "";
+   char* prev = NULL;
+   char* diff = NULL;
+   size_t prev_len = 0;
+   size_t omitted = 0;
+   int rc = CMD_SUCCESS;
+
+   rc = capture_showtech_cmd(clicmd, &output, &omitted);
+   if(output)
+   {
+      text = output;
+   }
+
+   if(rc != CMD_SUCCESS)
+   {
+      vty_out(vty,"%s*********************************%s"
+            ,VTY_NEWLINE,VTY_NEWLINE);
+      vty_out(vty,"Command : %s%s", command,VTY_NEWLINE);
+      vty_out(vty,"*********************************%s"
+            ,VTY_NEWLINE);
+      print_text_lines(text);
+      free(output);
+      return CMD_WARNING;
+   }
+
+   digest = showtech_store_lookup(store, command);
+   if(digest)
+   {
+      strncpy(old_digest, digest, SHA256_HEX_LEN - 1);
+   }
+   if(showtech_store_put(store, command, text, strlen(text), new_digest) != 0)
+   {
+      VLOG_ERR("Failed to store the output of %s", command);
+   }
+   if(old_digest[0] && strcmp(old_digest, new_digest) == 0)
+   {
+      stats->unchanged++;
+      free(output);
+      return CMD_SUCCESS;
+   }
+
+   if(old_digest[0]
+      && showtech_store_read(store, old_digest, &prev, &prev_len) == 0)
+   {
+      state = "changed";
+      stats->changed++;
+   }
+   else
+   {
+      state = "new";
+      stats->added++;
+   }
+   snprintf(old_label, sizeof(old_label), "%s (previous)", command);
+   snprintf(new_label, sizeof(new_label), "%s (current)", command);
+   diff = showtech_unified_diff(prev ? prev : "", prev_len,
+         text, strlen(text), old_label, new_label);
+
+   vty_out(vty,"%s*********************************%s"
+         ,VTY_NEWLINE,VTY_NEWLINE);
+   vty_out(vty,"Command : %s (%s)%s", command, state, VTY_NEWLINE);
+   vty_out(vty,"*********************************%s"
+         ,VTY_NEWLINE);
+   if(diff)
+   {
+      print_text_lines(diff);
+   }
+   else
+   {
+      /* not enough memory for the diff, fall back to the full output */
+      print_text_lines(text);
+   }
+   if(omitted)
+   {
+      vty_out(vty,"%s[Output truncated, %zu bytes omitted]%s",
+            VTY_NEWLINE, omitted, VTY_NEWLINE);
+   }
+   free(diff);
+   free(prev);
+   free(output);
+   return CMD_SUCCESS;
 }
 
 /* Function       : showtech_signal_handler
@@ -400,15 +658,12 @@ showtech_signal_handler(int sig, siginfo_t *siginfo, void *context)
     {
         /* process only one signal */
         gUserInterrupt = TRUE ;
-        if(!gUserInterruptAlarm)
-        {
-            gUserInterruptAlarm = TRUE;
-            vty_out(vty,"USER INTERRUPT:Show tech will be terminated with in 10 sec %s"
-                   ,VTY_NEWLINE);
-            gUserInterruptVtyType = vty->type ;
-            vty->type = VTY_FILE;
-            st_alarm(USER_INT_ALARM);
-        }
+        vty_out(vty,"USER INTERRUPT:Show tech will be terminated with in 10 sec %s"
+               ,VTY_NEWLINE);
+        gUserInterruptVtyType = vty->type ;
+        vty->type = VTY_FILE;
+        /* give the running command USER_INT_ALARM secs to complete */
+        executor_interrupt(USER_INT_ALARM);
     }
 }
 
@@ -423,44 +678,155 @@ showtech_Zsignal_handler(int sig, siginfo_t *siginfo, void *context)
     {
         /* process only one signal */
         gUserInterrupt = TRUE ;
-        st_mutex_lock( &waitMutex );
-        pthread_cond_signal( &waitCond );
-        st_mutex_unlock( &waitMutex );
+        executor_interrupt(0);
     }
 }
 
-/* Function       : cli_show_tech
- * Resposibility  : Display Show Tech Information
+/* Function       : run_showtech_row
+ * Resposibility  : Run the command of a row of the table and print its
+ *                  output, or its diff when store is given
+ * Return         : CMD_SUCCESS on success CMD_WARNING otherwise
+ */
+static int
+run_showtech_row(const struct clicmds* clicmd, struct showtech_store* store,
+                 struct showtech_diff_stats* diff_stats)
+{
+   int cmd_rc = CMD_SUCCESS;
+
+   if(store)
+   {
+      cmd_rc = diff_showtech_cmd(store, clicmd, diff_stats);
+   }
+   else
+   {
+      vty_out(vty,"%s*********************************%s"
+            ,VTY_NEWLINE,VTY_NEWLINE);
+      vty_out(vty,"Command : %s%s", clicmd->command,VTY_NEWLINE);
+      vty_out(vty,"*********************************%s"
+            ,VTY_NEWLINE);
+      cmd_rc = print_showtech_cmd(clicmd);
+   }
+   if (cmd_rc != CMD_SUCCESS)
+   {
+      vty_out(vty,"%s*********************************%s"
+            ,VTY_NEWLINE,VTY_NEWLINE);
+      vty_out(vty,"Command %s failed to execute%s",
+            clicmd->command,VTY_NEWLINE);
+      vty_out(vty,"*********************************%s"
+            ,VTY_NEWLINE);
+   }
+   return cmd_rc;
+}
+
+/* Function       : print_showtech_blocks
+ * Resposibility  : Print the output collected for each block, in
+ *                  configuration order and within the banners of its
+ *                  feature and sub feature
+ * Return         : void
+ */
+static void
+print_showtech_blocks(const struct showtech_table* table,
+                      const struct showtech_block* blocks, size_t n_blocks,
+                      int feature_banner, int sub_feature_banner)
+{
+   const struct showtech_cmd*    iter_cmd = NULL;
+   struct feature*      curr_feature = NULL;
+   struct sub_feature*  curr_sub = NULL;
+   size_t               block = 0;
+
+   for(block = 0; block < n_blocks; block++)
+   {
+      if(skip_further_execution)
+      {
+         return;
+      }
+      iter_cmd = &table->cmds[blocks[block].first];
+      /* CLI Commands are grouped under SubFeature, In order to support
+       * configurations without any subfeature, we internally add a
+       * dummy subfeature and set the flag is_dummy to true.
+       * Checking the Dummy Flag before printing Sub Feature Information
+       */
+      if(curr_sub && !curr_sub->is_dummy && sub_feature_banner)
+      {
+         print_sub_feature_banner("End", curr_sub->name);
+      }
+      if(iter_cmd->feature != curr_feature)
+      {
+         if(curr_feature && feature_banner)
+         {
+            print_feature_banner("End", curr_feature->name);
+         }
+         if(feature_banner)
+         {
+            print_feature_banner("Begin", iter_cmd->feature->name);
+         }
+      }
+      if(iter_cmd->sub_feature && !iter_cmd->sub_feature->is_dummy
+         && sub_feature_banner)
+      {
+         print_sub_feature_banner("Begin", iter_cmd->sub_feature->name);
+      }
+      curr_feature = iter_cmd->feature;
+      curr_sub = iter_cmd->sub_feature;
+      if(blocks[block].output.length)
+      {
+         vty_out(vty,"%s",blocks[block].output.string);
+      }
+   }
+   if(curr_sub && !curr_sub->is_dummy && sub_feature_banner)
+   {
+      print_sub_feature_banner("End", curr_sub->name);
+   }
+   if(curr_feature && feature_banner)
+   {
+      print_feature_banner("End", curr_feature->name);
+   }
+}
+
+/* Function       : run_show_tech
+ * Resposibility  : Display Show Tech Information, when store is given only
+ *                  the commands whose output changed since the capture in
+ *                  store are displayed, as unified diffs
  * Return         : 0 on success 1 otherwise
  */
-int
-cli_show_tech(const char* feature,const char* sub_feature)
+static int
+run_show_tech(const char* feature,const char* sub_feature,
+              struct showtech_store* store)
 {
-   struct feature       *iter,*head;
-   struct sub_feature*  iter_sub = NULL;
+   struct showtech_table*        table = NULL;
+   const struct showtech_group*  group = NULL;
+   const struct showtech_cmd*    iter_cmd = NULL;
+   struct showtech_block*        blocks = NULL;
    struct clicmds*      iter_cli = NULL;
-   int                  valid_cmd = 0;
+   struct vty_capture   capture;
+   size_t               row = 0, first = 0, last = 0;
+   size_t               n_blocks = 0, block = 0, cmd_row = 0;
+   char*                failed = NULL;
+   char*                output = NULL;
+   int                  pass = SHOWTECH_PRIORITY_CRITICAL;
+   int                  feature_banner = 1;
+   int                  sub_feature_banner = 1;
    int                  failure_count = 0;
+   int                  interrupted = 0;
+   struct showtech_diff_stats diff_stats = {0, 0, 0};
    time_t               showtech_start, showtech_end;
    char timebuf[32];
    double showtech_exec_time = 0.0;
    struct sigaction oldSignalHandler,newSignalHandler,oldZSignalHandler,
-                newZSignalHandler,oldAlarmHandler,newAlarmHandler;
+                newZSignalHandler;
    int return_val = CMD_SUCCESS;
 
    /* init global var */
    gUserInterrupt      = FALSE;
    gThreadCancelled    = FALSE;
-   gUserInterruptAlarm = FALSE;
    gUserInterruptVtyType = -1;
+   executor_clear_interrupt();
 
    /*change the signal handler */
    memset (&oldSignalHandler, '\0', sizeof(oldSignalHandler));
    memset (&newSignalHandler, '\0', sizeof(newSignalHandler));
    memset (&oldZSignalHandler, '\0', sizeof(oldZSignalHandler));
    memset (&newZSignalHandler, '\0', sizeof(newZSignalHandler));
-   memset (&oldAlarmHandler, '\0', sizeof(oldAlarmHandler));
-   memset (&newAlarmHandler, '\0', sizeof(newAlarmHandler));
 
    newSignalHandler.sa_sigaction = showtech_signal_handler;
    newSignalHandler.sa_flags = SA_SIGINFO;
@@ -468,26 +834,12 @@ cli_show_tech(const char* feature,const char* sub_feature)
    newZSignalHandler.sa_sigaction = showtech_Zsignal_handler;
    newZSignalHandler.sa_flags = SA_SIGINFO;
 
-   newAlarmHandler.sa_handler =  user_interrupt_handler ;
-
    if(sigaction(SIGINT, &newSignalHandler, &oldSignalHandler) != 0)
    {
       VLOG_ERR("Failed to change signal handler");
       vty_out(vty, "show tech init failed %s" ,VTY_NEWLINE);
       return CMD_WARNING;
    }
-   if(sigaction(SIGALRM, &newAlarmHandler, &oldAlarmHandler) != 0)
-   {
-      VLOG_ERR("Failed to change Alarm handler");
-      vty_out(vty, "show tech init failed %s" ,VTY_NEWLINE);
-      if(sigaction(SIGINT, &oldSignalHandler, NULL) != 0)
-      {
-         VLOG_ERR("Failed to change signal handler to old state");
-         exit(0); //should never hit this place
-         /* we changed the CLI behavior */
-      }
-      return CMD_WARNING;
-   }
    if(sigaction(SIGTSTP, &newZSignalHandler, &oldZSignalHandler) != 0)
     {
       VLOG_ERR("Failed to change Ctrl Z handler");
@@ -498,21 +850,16 @@ cli_show_tech(const char* feature,const char* sub_feature)
          exit(0); //should never hit this place
          /* we changed the CLI behavior */
       }
-      if(sigaction(SIGALRM, &oldAlarmHandler, NULL) != 0)
-      {
-        VLOG_ERR("Failed to change Alarm handler to old state");
-        exit(0); //should never hit this place
-        /* we changed the CLI behavior */
-      }
       return CMD_WARNING;
     }
-   /* Retrive the Show Tech Configuration Header */
-   head = get_showtech_config(NULL);
-   iter = head;
-   /* If the Header is NULL, then report the Show Tech Configuration failure
+   /* Retrive the compiled Show Tech command table, this reloads the
+    * configuration if the file has changed since the last run
+    */
+   table = showtech_table_acquire(NULL);
+   /* If the table is NULL, then report the Show Tech Configuration failure
     * and exit
     */
-   if(iter == NULL)
+   if(table == NULL)
    {
       VLOG_ERR("Failed to obtain Show Tech configuration");
       vty_out(vty, "Failed to obtain show tech configuration," \
@@ -531,296 +878,136 @@ cli_show_tech(const char* feature,const char* sub_feature)
    vty_out(vty,"====================================================%s"
          ,VTY_NEWLINE);
 
-   /* Show Tech All */
+   /* Show Tech All runs the whole table, Feature and Sub Feature run the
+    * contiguous range found through the hash index
+    */
    if(feature == NULL)
    {
-      /* Show Tech (all) is a valid command, hence update the flag */
-      valid_cmd = 1;
-      while (iter != NULL)
+      first = 0;
+      last = table->n_cmds;
+   }
+   else
+   {
+      group = showtech_table_lookup(table, feature, sub_feature);
+      /* The Feature or Sub Feature Specified is not valid/found */
+      if(group == NULL)
       {
-         vty_out(vty,"====================================================%s"
-               ,VTY_NEWLINE);
-         vty_out(vty,"[Begin] Feature %s%s", iter->name, VTY_NEWLINE);
-         vty_out(vty,"====================================================%s%s"
-               ,VTY_NEWLINE,VTY_NEWLINE);
-
-         iter_sub = iter->p_subfeature;
-
-         while (iter_sub)
+         if(sub_feature == NULL)
          {
-            /* CLI Commands are grouped under SubFeature, In order to support
-             * configurations without any subfeature, we internally add a
-             * dummy subfeature and set the flag is_dummy to true.
-             * Checking the Dummy Flag before printing Sub Feature Information
-             */
-            if(!iter_sub->is_dummy)
-            {
-               vty_out(vty,
-                     "= = = = = = = = = = = = = = = = = = = = = = = = = = =%s"
-                     ,VTY_NEWLINE);
-               vty_out(vty,
-                     "[Begin] Sub Feature %s%s", iter_sub->name,VTY_NEWLINE);
-               vty_out(vty,
-                  "= = = = = = = = = = = = = = = = = = = = = = = = = = =%s%s"
-                  ,VTY_NEWLINE,VTY_NEWLINE);
-            }
-            iter_cli = iter_sub->p_clicmds;
-            while (iter_cli)
-            {
-               vty_out(vty,"%s*********************************%s"
-                     ,VTY_NEWLINE,VTY_NEWLINE);
-               vty_out(vty,"Command : %s%s", iter_cli->command,VTY_NEWLINE);
-               vty_out(vty,"*********************************%s"
-                     ,VTY_NEWLINE);
-               if (exec_showtech_cmd(iter_cli->command) != CMD_SUCCESS)
-               {
-                  failure_count++;
-                  iter_cli->command_failed = 1;
-                  vty_out(vty,"%s*********************************%s"
-                        ,VTY_NEWLINE,VTY_NEWLINE);
-                  vty_out(vty,
-                        "Command %s failed to execute%s",
-                        iter_cli->command,VTY_NEWLINE);
-                  vty_out(vty,"*********************************%s"
-                        ,VTY_NEWLINE);
-
-               }
-               if(gUserInterrupt || skip_further_execution)
-               {
-                  iter_cli->command_failed = 0;
-                  goto USER_INTERRUPT;
-               }
-               iter_cli = iter_cli->next;
-            }
-            if(!iter_sub->is_dummy)
-            {
-               vty_out(vty,"= = = = = = = = = = = = = = = = = = = = = = = = = = =%s"
-                     ,VTY_NEWLINE);
-               vty_out(vty,"[End] Sub Feature %s%s", iter_sub->name,VTY_NEWLINE);
-               vty_out(vty,"= = = = = = = = = = = = = = = = = = = = = = = = = = =%s%s"
-                     ,VTY_NEWLINE,VTY_NEWLINE);
-            }
-
-            iter_sub = iter_sub->next;
+            /* Feature Specific Command */
+            vty_out(vty,"Feature %s is not supported%s",feature,VTY_NEWLINE);
          }
-         vty_out(vty,"====================================================%s"
-               ,VTY_NEWLINE);
-         vty_out(vty,"[End] Feature %s%s", iter->name, VTY_NEWLINE);
-         vty_out(vty,"====================================================%s%s"
-               ,VTY_NEWLINE,VTY_NEWLINE);
+         else
+         {
+            /* Sub Feature Specific Command */
+            vty_out(vty,"Sub Feature %s is not supported%s",sub_feature,VTY_NEWLINE);
+         }
+         return_val = CMD_SUCCESS;
+         goto EXIT_FUN;
+      }
+      first = group->first;
+      last = group->first + group->count;
+   }
 
+   failed = calloc(table->n_cmds ? table->n_cmds : 1, 1);
+   if(failed == NULL)
+   {
+      VLOG_ERR("show tech: memory allocation failed");
+      vty_out(vty, "show tech init failed %s" ,VTY_NEWLINE);
+      return_val = CMD_WARNING;
+      goto EXIT_FUN;
+   }
 
-         iter = iter->next;
+   /* A block is the run of rows of one feature and sub feature */
+   blocks = calloc((last > first) ? last - first : 1, sizeof *blocks);
+   if(blocks == NULL)
+   {
+      VLOG_ERR("show tech: memory allocation failed");
+      vty_out(vty, "show tech init failed %s" ,VTY_NEWLINE);
+      return_val = CMD_WARNING;
+      goto EXIT_FUN;
+   }
+   for(row = first; row < last; row++)
+   {
+      iter_cmd = &table->cmds[row];
+      if(n_blocks == 0
+         || iter_cmd->feature != table->cmds[row - 1].feature
+         || iter_cmd->sub_feature != table->cmds[row - 1].sub_feature)
+      {
+         blocks[n_blocks].first = row;
+         ds_init(&blocks[n_blocks].output);
+         n_blocks++;
       }
+      blocks[n_blocks - 1].end = row + 1;
    }
-   /* Show Tech All Ends Here */
-   else
+
+   /* The selected commands run one priority class after the other, across
+    * every feature, so that the critical ones are all done first, and keep
+    * the configuration order within a class. The output of each block is
+    * kept and displayed afterwards, within the banners of the
+    * configuration.
+    */
+   for(pass = SHOWTECH_PRIORITY_CRITICAL;
+       pass < SHOWTECH_PRIORITY_MAX && !interrupted; pass++)
    {
-      /* Show Tech Feature */
-      if(sub_feature == NULL)
+      for(block = 0; block < n_blocks && !interrupted; block++)
       {
-         while (iter != NULL)
+         for(cmd_row = blocks[block].first; cmd_row < blocks[block].end;
+             cmd_row++)
          {
-            if(strcmp_with_nullcheck(iter->name,feature))
+            iter_cli = table->cmds[cmd_row].clicmd;
+            if(iter_cli == NULL || (int)iter_cli->priority != pass)
             {
-               /* Run till the matched feature */
-               iter = iter->next;
+               /* feature or sub feature without commands */
                continue;
             }
-            valid_cmd = 1;
-            vty_out(vty,"====================================================%s"
-                  ,VTY_NEWLINE);
-            vty_out(vty,"[Begin] Feature %s%s", iter->name, VTY_NEWLINE);
-            vty_out(vty,"====================================================%s%s"
-                  ,VTY_NEWLINE,VTY_NEWLINE);
-            iter_sub = iter->p_subfeature;
-
-            while (iter_sub)
-            {
-               /* CLI Commands are grouped under SubFeature, In order to support
-                * configurations without any subfeature, we internally add a
-                * dummy subfeature and set the flag is_dummy to true.
-                * Checking the Dummy Flag before printing Sub Feature Information
-                */
-               if(!iter_sub->is_dummy)
-               {
-                  vty_out(vty,
-                     "= = = = = = = = = = = = = = = = = = = = = = = = = = =%s"
-                     ,VTY_NEWLINE);
-                  vty_out(vty,
-                     "[Begin] Sub Feature %s%s", iter_sub->name,VTY_NEWLINE);
-                  vty_out(vty,
-                  "= = = = = = = = = = = = = = = = = = = = = = = = = = =%s%s"
-                   ,VTY_NEWLINE,VTY_NEWLINE);
-               }
-               iter_cli = iter_sub->p_clicmds;
-               while (iter_cli)
-               {
-                  if(gUserInterrupt || skip_further_execution)
-                  {
-                     goto USER_INTERRUPT;
-                  }
-                  vty_out(vty,"%s*********************************%s"
-                        ,VTY_NEWLINE,VTY_NEWLINE);
-                  vty_out(vty,"Command : %s%s", iter_cli->command,VTY_NEWLINE);
-                  vty_out(vty,"*********************************%s"
-                        ,VTY_NEWLINE);
-                  if (exec_showtech_cmd(iter_cli->command) != CMD_SUCCESS)
-                  {
-                     failure_count++;
-                     iter_cli->command_failed = 1;
-                     vty_out(vty,"%s*********************************%s"
-                           ,VTY_NEWLINE,VTY_NEWLINE);
-                     vty_out(vty,"Command %s failed to execute%s",
-                           iter_cli->command,VTY_NEWLINE);
-                     vty_out(vty,"*********************************%s"
-                           ,VTY_NEWLINE);
-                  }
-                  if(gUserInterrupt || skip_further_execution)
-                  {
-                     iter_cli->command_failed = 0;
-                     goto USER_INTERRUPT;
-                  }
-                  iter_cli = iter_cli->next;
-               }
-               if(!iter_sub->is_dummy)
-               {
-                  vty_out(vty,
-                     "= = = = = = = = = = = = = = = = = = = = = = = = = = =%s"
-                     ,VTY_NEWLINE);
-                  vty_out(vty,
-                        "[End] Sub Feature %s%s", iter_sub->name,VTY_NEWLINE);
-                  vty_out(vty,
-                  "= = = = = = = = = = = = = = = = = = = = = = = = = = =%s%s"
-                  ,VTY_NEWLINE,VTY_NEWLINE);
-               }
-               iter_sub = iter_sub->next;
-            }
-
-            if(valid_cmd)
+            if(gUserInterrupt || skip_further_execution)
             {
-               vty_out(vty,
-                     "====================================================%s"
-                     ,VTY_NEWLINE);
-               vty_out(vty,"[End] Feature %s%s", iter->name, VTY_NEWLINE);
-               vty_out(vty,
-                     "====================================================%s%s"
-                     ,VTY_NEWLINE,VTY_NEWLINE);
-
-               /* Required Feature Commands are Executed */
+               interrupted = 1;
                break;
             }
-            iter = iter->next;
-         }
-      }
-      /* Show Tech Feature Ends here */
-
-      /* Show Tech Sub Feature */
-      else
-      {
-         while (iter != NULL)
-         {
-            if(strcmp_with_nullcheck(iter->name,feature))
+            vty_capture_begin(&capture);
+            if(run_showtech_row(iter_cli, store, &diff_stats) != CMD_SUCCESS)
             {
-               /* Run till the matched feature */
-               iter = iter->next;
-               continue;
+               failure_count++;
+               failed[cmd_row] = 1;
             }
-            iter_sub = iter->p_subfeature;
-
-            while (iter_sub)
+            output = vty_capture_end(&capture);
+            if(output)
             {
-               /* CLI Commands are grouped under SubFeature, In order to support
-                * configurations without any subfeature, we internally add a
-                * dummy subfeature and set the flag is_dummy to true.
-                * Checking the Dummy Flag before printing Sub Feature Information
-                */
-               if(iter_sub->is_dummy || strcmp_with_nullcheck(iter_sub->name,sub_feature))
-               {
-                  /* Run till the matched sub feature */
-                  iter_sub = iter_sub->next;
-                  continue;
-               }
-               if(valid_cmd == 0)
-               {
-                  valid_cmd = 1;
-               }
-
-               vty_out(vty,"= = = = = = = = = = = = = = = = = = = = = = = = = = =%s"
-                     ,VTY_NEWLINE);
-               vty_out(vty,"[Begin] Sub Feature %s%s", iter_sub->name,VTY_NEWLINE);
-               vty_out(vty,"= = = = = = = = = = = = = = = = = = = = = = = = = = =%s%s"
-                     ,VTY_NEWLINE,VTY_NEWLINE);
-               iter_cli = iter_sub->p_clicmds;
-               while (iter_cli)
-               {
-                  if(gUserInterrupt)
-                  {
-                     goto USER_INTERRUPT;
-                  }
-                  vty_out(vty,"%s*********************************%s"
-                        ,VTY_NEWLINE,VTY_NEWLINE);
-                  vty_out(vty,"Command : %s%s", iter_cli->command,VTY_NEWLINE);
-                  vty_out(vty,"*********************************%s"
-                        ,VTY_NEWLINE);
-                  if (exec_showtech_cmd(iter_cli->command) != CMD_SUCCESS)
-                  {
-                     failure_count++;
-                     iter_cli->command_failed = 1;
-                     vty_out(vty,"%s*********************************%s"
-                           ,VTY_NEWLINE,VTY_NEWLINE);
-                     vty_out(vty,"Command %s failed to execute%s", iter_cli->command,VTY_NEWLINE);
-                     vty_out(vty,"*********************************%s"
-                           ,VTY_NEWLINE);
-                  }
-                  if(gUserInterrupt)
-                  {
-                     iter_cli->command_failed = 0;
-                     goto USER_INTERRUPT;
-                  }
-                  iter_cli = iter_cli->next;
-               }
-               if(valid_cmd)
-               {
-                  vty_out(vty,"= = = = = = = = = = = = = = = = = = = = = = = = = = =%s"
-                        ,VTY_NEWLINE);
-                  vty_out(vty,"[End] Sub Feature %s%s", iter_sub->name,VTY_NEWLINE);
-                  vty_out(vty,"= = = = = = = = = = = = = = = = = = = = = = = = = = =%s%s"
-                        ,VTY_NEWLINE,VTY_NEWLINE);
-
-                  /* Required Sub Feature Commands are Executed */
-                  break;
-               }
-
-               iter_sub = iter_sub->next;
+               ds_put_cstr(&blocks[block].output, output);
+               free(output);
             }
-            if(valid_cmd)
+            if(gUserInterrupt || skip_further_execution)
             {
-               /* Required Feature Commands are Executed */
+               interrupted = 1;
                break;
             }
-            iter = iter->next;
          }
       }
-      /* Show Tech SubFeature Ends here */
-
+   }
 
-      /* The Feature or Sub Feature Specified is not valid/found */
-      if(valid_cmd == 0)
-      {
-         if(sub_feature == NULL)
-         {
-            /* Feature Specific Command */
-            vty_out(vty,"Feature %s is not supported%s",feature,VTY_NEWLINE);
-         }
-         else
-         {
-            /* Sub Feature Specific Command */
-            vty_out(vty,"Sub Feature %s is not supported%s",sub_feature,VTY_NEWLINE);
-         }
-         return_val = CMD_SUCCESS;
-         goto EXIT_FUN;
-      }
+   /* Sub Feature output is not wrapped in the Feature banner, a diff
+    * carries the command name only
+    */
+   feature_banner = (sub_feature == NULL) && (store == NULL);
+   sub_feature_banner = (store == NULL);
+   /* what completed before an interrupt is displayed too */
+   print_showtech_blocks(table, blocks, n_blocks, feature_banner,
+                         sub_feature_banner);
+   if(interrupted)
+   {
+      goto USER_INTERRUPT;
+   }
+   if(store)
+   {
+      vty_out(vty,"%s====================================================%s"
+            ,VTY_NEWLINE,VTY_NEWLINE);
+      vty_out(vty,"Show Tech diff : %d changed, %d new, %d unchanged%s",
+            diff_stats.changed, diff_stats.added, diff_stats.unchanged,
+            VTY_NEWLINE);
+      vty_out(vty,"====================================================%s"
+            ,VTY_NEWLINE);
    }
 
    /* If Any Show Command has failed, then report the Failures
@@ -847,7 +1034,7 @@ cli_show_tech(const char* feature,const char* sub_feature)
                ,VTY_NEWLINE);
          vty_out(vty,"Failed commands:%s",VTY_NEWLINE);
       }
-      print_failed_commands(head);
+      print_failed_commands(table, failed);
    }
    else
    {
@@ -884,16 +1071,72 @@ cli_show_tech(const char* feature,const char* sub_feature)
       exit(0); //should never hit this place
       /* we changed the CLI behavior */
     }
-    if(sigaction(SIGALRM, &oldAlarmHandler, NULL) != 0)
+   if(gThreadCancelled)
    {
-      VLOG_ERR("Failed to change Alarm handler to old state");
-      exit(0); //should never hit this place
-      /* we changed the CLI behavior */
+      VLOG_ERR("show tech command has been cancelled");
    }
-   if(gThreadCancelled)
+   for(block = 0; block < n_blocks; block++)
+   {
+      ds_destroy(&blocks[block].output);
+   }
+   free(blocks);
+   free(failed);
+   showtech_table_release(table);
+   return return_val;
+}
+
+/* Function       : cli_show_tech
+ * Resposibility  : Display Show Tech Information
+ * Return         : 0 on success 1 otherwise
+ */
+int
+cli_show_tech(const char* feature,const char* sub_feature)
+{
+   return run_show_tech(feature, sub_feature, NULL);
+}
+
+/* Function       : cli_show_tech_reload
+ * Resposibility  : Reload the Show Tech configuration if it changed on
+ *                  disk, without running anything
+ * Return         : 0 if a configuration is loaded, 1 otherwise
+ */
+int
+cli_show_tech_reload(void)
+{
+   struct showtech_table* table = showtech_table_acquire(NULL);
+
+   showtech_table_release(table);
+   return table == NULL;
+}
+
+/* Function       : cli_show_tech_diff
+ * Resposibility  : Display the changes of Show Tech output since the
+ *                  previous show tech diff, and keep the current output as
+ *                  the reference for the next one
+ * Return         : CMD_SUCCESS on success CMD_WARNING on failure
+ */
+int
+cli_show_tech_diff(const char* feature)
+{
+   struct showtech_store* store = NULL;
+   int return_val = CMD_SUCCESS;
+
+   store = showtech_store_open(NULL, feature);
+   if(store == NULL)
+   {
+      vty_out(vty,"Failed to open the show tech capture store %s%s",
+            SHOWTECH_DIFF_DIR,VTY_NEWLINE);
+      return CMD_WARNING;
+   }
+   return_val = run_show_tech(feature, NULL, store);
+   /* commands completed before an interrupt still update the reference */
+   if(showtech_store_commit(store) != 0)
    {
-      VLOG_ERR("thread has been cancelled");
+      vty_out(vty,"Failed to save the show tech capture in %s%s",
+            SHOWTECH_DIFF_DIR,VTY_NEWLINE);
+      return_val = CMD_WARNING;
    }
+   showtech_store_close(store);
    return return_val;
 }
 
@@ -906,11 +1149,14 @@ cli_show_tech(const char* feature,const char* sub_feature)
 int
 cli_show_tech_list(void)
 {
+  struct showtech_table* table = NULL;
   struct feature* iter;
 #ifdef _ST_SUBFEATURE_ENABLED
   struct sub_feature* iter_sub = NULL;
 #endif /* _ST_SUBFEATURE_ENABLED */
-  iter = get_showtech_config(NULL);
+  /* the reference keeps the list alive across a concurrent reload */
+  table = showtech_table_acquire(NULL);
+  iter = table ? table->feature_head : NULL;
 
   /* If the Header is NULL, then report the Show Tech Configuration failure
    * and exit
@@ -918,6 +1164,7 @@ cli_show_tech_list(void)
 
   if(iter == NULL)
   {
+    showtech_table_release(table);
     VLOG_ERR("Failed to obtain Show Tech configuration");
     vty_out(vty, "Failed to obtain show tech configuration," \
             " please restore the configuration file using default file.%s" \
@@ -955,6 +1202,7 @@ cli_show_tech_list(void)
 #endif /* _ST_SUBFEATURE_ENABLED */
     iter = iter->next;
   }
+  showtech_table_release(table);
   return CMD_SUCCESS;
 }
 
@@ -1075,6 +1323,25 @@ DEFUN_NOLOCK (cli_platform_show_tech,
   }
 
 
+/*
+* Action routines for Show Tech diff
+*/
+DEFUN_NOLOCK (cli_platform_show_tech_diff,
+  cli_platform_show_tech_diff_cmd,
+  "show tech diff [FEATURE]",
+  SHOW_STR
+  SHOW_TECH_STR
+  SHOW_TECH_DIFF_STR
+  SHOW_TECH_FEATURE_STR)
+  {
+    if(argc > 0 && argv[0] != NULL)
+    {
+      return cli_show_tech_diff(argv[0]);
+    }
+    return cli_show_tech_diff(NULL);
+  }
+
+
 /*
 * Action routines for Show Tech List
 */
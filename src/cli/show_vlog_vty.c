@@ -23,6 +23,7 @@
  * Purpose: To Run Show Events Commands from CLI
  */
 
+#define _GNU_SOURCE
 #include "vtysh/command.h"
 #include "vtysh/vtysh.h"
 #include "vtysh/vtysh_user.h"
@@ -39,7 +40,12 @@
 #include "dynamic-string.h"
 #include "supportability_vty.h"
 #include "supportability_utils.h"
+#include "daemon_registry.h"
+#include "supportability_executor.h"
 #include <errno.h>
+#include <regex.h>
+#include <stdint.h>
+#include <time.h>
 
 #define LIST_ARGC                0
 #define ARGC                     2
@@ -59,18 +65,55 @@
 #define SET_REQUEST              4
 #define DAEMON_INDEX             1
 #define SEVERITY_INDEX           0
+#define LAST_INDEX               2
+#define SINCE_INDEX              3
+#define UNTIL_INDEX              4
+#define MATCH_INDEX              5
+#define DAEMON_SEPARATOR         ","
+#define VLOG_MESSAGE_FIELD       "MESSAGE="
+#define VLOG_MESSAGE_PREFIX      "ovs|"
+#define VLOG_IDENTIFIER_FIELD    "SYSLOG_IDENTIFIER="
+#define VLOG_TIME_FORMAT         "%Y-%m-%d:%H:%M:%S"
+#define USEC_PER_SEC             1000000ULL
 #define MESSAGE_OVS_MATCH        "_TRANSPORT=syslog"
+#define FEATURE_SEPARATOR        ","
+#define VLOG_SET_TIMEOUT         10      /* secs, per daemon */
+#define VLOG_REVERT              "vlog/revert"
+#define VLOG_OVERRIDES           "vlog/overrides"
+#define VLOG_REVERT_FIXED_ARGC   3       /* daemon, seconds, setting */
 
 VLOG_DEFINE_THIS_MODULE(vtysh_show_vlog_cli);
 
+/* Function       :  vlog_daemon_running
+ * Responsibility :  Checks that a daemon runs before talking to it, lists
+ *                   the running daemons otherwise
+ * Return         :  1 if it runs, 0 otherwise
+ */
 static int
-vtysh_vlog_interface_daemon(char *feature,char *daemon ,char **cmd_type ,
-      int cmd_argc , int request);
+vlog_daemon_running(const char *daemon)
+{
+   struct daemon_entry *entries = NULL;
+   int count = 0, i = 0;
 
-static struct feature *feature_head =NULL;
+   if(daemon_registry_running(daemon)) {
+      return 1;
+   }
+   vty_out(vty,"Not able to communicate with daemon %s, it is not running%s",
+         daemon,VTY_NEWLINE);
+   count = daemon_registry_list(&entries);
+   if(count > 0) {
+      vty_out(vty,"Running daemons:%s",VTY_NEWLINE);
+      for(i = 0; i < count; i++) {
+         vty_out(vty,"  %s%s",entries[i].name,VTY_NEWLINE);
+      }
+   }
+   daemon_registry_free(entries,count);
+   return 0;
+}
 
-/*flag to check before parsing yaml file */
-static int initialized =0;
+static int
+vtysh_vlog_interface_daemon(char *feature,char *daemon ,char **cmd_type ,
+      int cmd_argc , int request);
 
 static int flag = 0;
 
@@ -228,7 +271,7 @@ cli_show_vlog_feature_or_daemon(const char *type, const char *name)
 
    static int rc = 0;
    int fun_argc = LIST_ARGC;
-   struct feature *iter = feature_head;
+   struct feature *iter = NULL;
    struct daemon *iter_daemon = NULL;
    int request;
 
@@ -247,28 +290,25 @@ cli_show_vlog_feature_or_daemon(const char *type, const char *name)
    }else if(!strcmp_with_nullcheck(type,FEATURE)) {
       /*argv0 matches feature request*/
       request = FEATURE_REQUEST;
-      if(!initialized) {
-         feature_head = get_feature_mapping();
-         if(feature_head == NULL){
-            vty_out(vty,"Error in retrieving the mapping of feature names \
-                  to daemon names%s",VTY_NEWLINE);
-            FREE(fun_argv);
-            return CMD_WARNING;
-         }
-         else {
-            initialized = 1;
-         }
+      if(get_feature_mapping() == NULL){
+         vty_out(vty,"Error in retrieving the mapping of feature names \
+               to daemon names%s",VTY_NEWLINE);
+         FREE(fun_argv);
+         return CMD_WARNING;
       }
 
-      /* traverse linked list to find feature */
-      for (iter=feature_head ; iter && strcmp_with_nullcheck(iter->name,name);
-            iter = iter->next);
+      iter = feature_mapping_find(name);
 
       if(iter) {
          VLOG_DBG("feature:%s",iter->name);
          iter_daemon = iter->p_daemon;
          /*traverse all daemons*/
          while(iter_daemon) {
+            if(!daemon_registry_running(iter_daemon->name)) {
+               VLOG_DBG("daemon :%s not running",iter_daemon->name);
+               iter_daemon = iter_daemon->next;
+               continue;
+            }
             rc = vtysh_vlog_interface_daemon(iter->name,iter_daemon->name,
                   &fun_argv,fun_argc,request);
             if (!rc) {
@@ -290,6 +330,10 @@ cli_show_vlog_feature_or_daemon(const char *type, const char *name)
    }
    if(!strcmp_with_nullcheck(type,DAEMON)){
       request = DAEMON_REQUEST;
+      if(!vlog_daemon_running(name)) {
+         FREE(fun_argv);
+         return CMD_WARNING;
+      }
       /*Directly given daemon name */
       rc = vtysh_vlog_interface_daemon(NULL,(char *)name,&fun_argv,
             fun_argc,request);
@@ -320,19 +364,13 @@ cli_show_vlog_feature_or_daemon(const char *type, const char *name)
 cli_show_vlog_config_list(void)
 {
 
-   if(!initialized) {
-      /* feature to daemon mapping */
-      feature_head = get_feature_mapping();
-      if(feature_head == NULL){
-         vty_out(vty,"Error in retrieving the mapping of feature \
-               names to daemon names%s",VTY_NEWLINE);
-         return CMD_WARNING;
-      }
-      else {
-         initialized = 1;
-      }
+   /* feature to daemon mapping */
+   struct feature *iter = get_feature_mapping();
+   if(iter == NULL){
+      vty_out(vty,"Error in retrieving the mapping of feature \
+            names to daemon names%s",VTY_NEWLINE);
+      return CMD_WARNING;
    }
-   struct feature *iter = feature_head;
    vty_out(vty,"==============================================%s",VTY_NEWLINE);
    vty_out(vty,"Features          Description%s",VTY_NEWLINE);
    vty_out(vty,"==============================================%s",VTY_NEWLINE);
@@ -344,6 +382,408 @@ cli_show_vlog_config_list(void)
 }
 
 
+/* Function       :  vlog_valid_level
+ * Responsibility :  Checks a level name of a vlog/list reply
+ * Return         :  1 if valid, 0 otherwise
+ */
+static int
+vlog_valid_level(const char *level)
+{
+   static const char *levels[] = {"off","emer","err","warn","info","dbg"};
+   size_t i = 0;
+
+   for(i = 0; i < sizeof(levels) / sizeof(levels[0]); i++) {
+      if(!strcasecmp(level,levels[i])) {
+         return 1;
+      }
+   }
+   return 0;
+}
+
+/* Function       :  vlog_revert_specs
+ * Responsibility :  Turns the vlog/list reply of a daemon, one line per
+ *                   module with its console, syslog and file levels, into
+ *                   the vlog/set specs restoring the levels of destination.
+ *                   The specs are appended to argv after its first
+ *                   VLOG_REVERT_FIXED_ARGC entries
+ * Return         :  argc, -1 on allocation failure
+ */
+static int
+vlog_revert_specs(char *list, const char *destination, char ***argv)
+{
+   static const char *columns[] = {"console","syslog","file"};
+   char module[MAX_SIZE], levels[3][MAX_SIZE];
+   char *line = NULL, *save = NULL;
+   char **grown = NULL;
+   /* argv comes with its first VLOG_REVERT_FIXED_ARGC entries */
+   int argc = VLOG_REVERT_FIXED_ARGC, max = VLOG_REVERT_FIXED_ARGC, i = 0;
+   size_t len = strlen(destination);
+   /* the destination may be abbreviated as on the command line */
+   int any = !strncasecmp(destination,"any",len)
+      || !strncasecmp(destination,"all",len);
+
+   for(line = strtok_r(list,"\n",&save); line;
+         line = strtok_r(NULL,"\n",&save)) {
+      /* the header lines have three words */
+      if(sscanf(line,"%99s %99s %99s %99s",module,levels[0],levels[1],
+               levels[2]) != 4) {
+         continue;
+      }
+      for(i = 0; i < 3; i++) {
+         if((!any && strncasecmp(destination,columns[i],len))
+               || !vlog_valid_level(levels[i])) {
+            continue;
+         }
+         if(argc == max) {
+            max = 2 * max + 64;
+            grown = realloc(*argv,max * sizeof(*grown));
+            if(grown == NULL) {
+               return -1;
+            }
+            *argv = grown;
+         }
+         (*argv)[argc] = xasprintf("%s:%s:%s",module,columns[i],levels[i]);
+         argc++;
+      }
+   }
+   return argc;
+}
+
+/* Function       :  vlog_schedule_revert
+ * Responsibility :  Captures the current levels of destination on a daemon
+ *                   and hands them to the supportability daemon, which
+ *                   restores them once duration expired. Called before the
+ *                   new level is set, so that no raised level is left
+ *                   without its revert
+ * Return         :  0 on success, -1 otherwise
+ */
+static int
+vlog_schedule_revert(const char *daemon, const char *destination,
+      const char *setting, unsigned int duration)
+{
+   struct jsonrpc *client = NULL;
+   char *cmd_result = NULL, *cmd_error = NULL;
+   char **argv = NULL;
+   char seconds[16];
+   int argc = 0, rc = 0, i = 0;
+
+   client = connect_to_daemon(daemon);
+   if(client == NULL) {
+      return -1;
+   }
+   rc = unixctl_client_transact(client,LIST,0,NULL,&cmd_result,&cmd_error);
+   jsonrpc_close(client);
+   if(rc || cmd_error || cmd_result == NULL) {
+      VLOG_ERR("%s: transaction error:%s , rc =%d",daemon,
+            (cmd_error?cmd_error:"error"),rc);
+      FREE(cmd_result);
+      FREE(cmd_error);
+      return -1;
+   }
+   argv = calloc(VLOG_REVERT_FIXED_ARGC,sizeof(*argv));
+   if(argv != NULL) {
+      argc = vlog_revert_specs(cmd_result,destination,&argv);
+   }
+   FREE(cmd_result);
+   if(argv == NULL || argc < 0) {
+      VLOG_ERR("memory allocation failed");
+      rc = -1;
+      goto done;
+   }
+
+   snprintf(seconds,sizeof(seconds),"%u",duration);
+   argv[0] = (char *)daemon;
+   argv[1] = seconds;
+   argv[2] = (char *)setting;
+   client = connect_to_daemon(SUPPORTABILITY_DAEMON);
+   if(client == NULL) {
+      rc = -1;
+      goto done;
+   }
+   rc = unixctl_client_transact(client,VLOG_REVERT,argc,argv,&cmd_result,
+         &cmd_error);
+   jsonrpc_close(client);
+   if(rc || cmd_error) {
+      VLOG_ERR("%s: transaction error:%s , rc =%d",SUPPORTABILITY_DAEMON,
+            (cmd_error?cmd_error:"error"),rc);
+      rc = -1;
+   }
+   FREE(cmd_result);
+   FREE(cmd_error);
+
+done:
+   for(i = VLOG_REVERT_FIXED_ARGC; i < argc; i++) {
+      free(argv[i]);
+   }
+   free(argv);
+   return rc;
+}
+
+/* Function       :  cli_show_vlog_overrides
+ * Responsibility :  Displays the levels set with a duration which are not
+ *                   reverted yet
+ * Return         :  void
+ */
+static void
+cli_show_vlog_overrides(void)
+{
+   struct jsonrpc *client = NULL;
+   char *cmd_result = NULL, *cmd_error = NULL;
+   char *line = NULL, *save = NULL;
+   char daemon[MAX_SIZE], setting[MAX_SIZE];
+   unsigned int remaining = 0;
+   int rc = 0, header = 0;
+
+   client = connect_to_daemon(SUPPORTABILITY_DAEMON);
+   if(client == NULL) {
+      return;
+   }
+   rc = unixctl_client_transact(client,VLOG_OVERRIDES,0,NULL,&cmd_result,
+         &cmd_error);
+   jsonrpc_close(client);
+   if(rc || cmd_error || cmd_result == NULL) {
+      VLOG_DBG("%s: transaction error:%s , rc =%d",SUPPORTABILITY_DAEMON,
+            (cmd_error?cmd_error:"error"),rc);
+      FREE(cmd_result);
+      FREE(cmd_error);
+      return;
+   }
+   /* one "daemon setting seconds" line per override */
+   for(line = strtok_r(cmd_result,"\n",&save); line;
+         line = strtok_r(NULL,"\n",&save)) {
+      if(sscanf(line,"%99s %99s %u",daemon,setting,&remaining) != 3) {
+         continue;
+      }
+      if(!header) {
+         vty_out(vty,"%sTemporary levels%s",VTY_NEWLINE,VTY_NEWLINE);
+         vty_out(vty,"=================================================%s",
+               VTY_NEWLINE);
+         vty_out(vty,"Daemon            Setting          Reverts in%s",
+               VTY_NEWLINE);
+         vty_out(vty,"=================================================%s",
+               VTY_NEWLINE);
+         header = 1;
+      }
+      vty_out(vty,"%-17.17s %-16.16s %us%s",daemon,setting,remaining,
+            VTY_NEWLINE);
+   }
+   FREE(cmd_result);
+}
+
+/* Argument of a vlog/set executor task */
+struct vlog_set_arg
+{
+   char daemon[MAX_SIZE];
+   char destination[MAX_SIZE];
+   char setting[MAX_SIZE];
+   unsigned int duration;    /* secs before the revert, 0 for none */
+};
+
+/* vlog/set request of one daemon, shared by the features it serves */
+struct vlog_set_job
+{
+   const char *daemon;
+   char features[MAX_SIZE];
+   int running;
+   struct executor_task *task;
+};
+
+/* Function       :  vlog_set_task
+ * Responsibility :  executor task body, send vlog/set to one daemon
+ * Return         :  0 on success, 1 with the error as result otherwise
+ */
+static int
+vlog_set_task(void *arg, const struct executor_task *task)
+{
+   struct vlog_set_arg *set = arg;
+   struct jsonrpc *client = NULL;
+   char *cmd_result = NULL, *cmd_error = NULL;
+   char *cmd_argv[1];
+   int rc = 0;
+
+   if(executor_task_cancelled(task)) {
+      return 1;
+   }
+   if(set->duration && vlog_schedule_revert(set->daemon,set->destination,
+            set->setting,set->duration)) {
+      executor_task_set_result(task,
+            xstrdup("Not able to schedule the revert, level not changed"));
+      return 1;
+   }
+   client = connect_to_daemon(set->daemon);
+   if(client == NULL) {
+      return 1;
+   }
+   cmd_argv[0] = set->setting;
+   rc = unixctl_client_transact(client,SET,1,cmd_argv,&cmd_result,
+         &cmd_error);
+   jsonrpc_close(client);
+   FREE(cmd_result);
+   if(rc || cmd_error) {
+      VLOG_ERR("%s: transaction error:%s , rc =%d",set->daemon,
+            (cmd_error?cmd_error:"error"),rc);
+      executor_task_set_result(task,cmd_error);
+      return 1;
+   }
+   return 0;
+}
+
+/* Function       :  vlog_set_add_job
+ * Responsibility :  adds a daemon to the batch, once however many of the
+ *                   features map to it
+ * Return         :  0 on success, -1 on allocation failure
+ */
+static int
+vlog_set_add_job(struct vlog_set_job **jobs, size_t *n_jobs,
+      size_t *max_jobs, const char *daemon, const char *feature)
+{
+   struct vlog_set_job *job = NULL;
+   size_t i = 0, max = 0, len = 0;
+
+   for(i = 0; i < *n_jobs; i++) {
+      if(!strcmp((*jobs)[i].daemon,daemon)) {
+         job = &(*jobs)[i];
+         break;
+      }
+   }
+   if(job == NULL) {
+      if(*n_jobs == *max_jobs) {
+         max = *max_jobs ? 2 * *max_jobs : 16;
+         job = realloc(*jobs,max * sizeof(*job));
+         if(job == NULL) {
+            return -1;
+         }
+         *jobs = job;
+         *max_jobs = max;
+      }
+      job = &(*jobs)[(*n_jobs)++];
+      memset(job,0,sizeof(*job));
+      job->daemon = daemon;
+   }
+   len = strlen(job->features);
+   snprintf(job->features + len,sizeof(job->features) - len,"%s%s",
+         len ? FEATURE_SEPARATOR : "",feature);
+   return 0;
+}
+
+/* Function       :  cli_config_vlog_set_features
+ * Responsibility :  Sets the log level of several features at once. Every
+ *                   feature is looked up before anything is sent, the
+ *                   daemons they map to get one vlog/set each, all of them
+ *                   in flight together, and the results are shown per daemon
+ * Parameters     :  features - feature names separated by commas
+ *                   destination - syslog, file or any
+ *                   setting - destination:level
+ *                   duration - secs before the levels are reverted, 0
+ *                              to keep them
+ * Return         :  CMD_SUCCESS if every running daemon applied it
+ */
+static int
+cli_config_vlog_set_features(const char *features, const char *destination,
+      const char *setting, unsigned int duration)
+{
+   struct vlog_set_job *jobs = NULL;
+   struct vlog_set_arg arg;
+   struct feature *iter = NULL;
+   struct daemon *iter_daemon = NULL;
+   enum executor_status status;
+   size_t n_jobs = 0, max_jobs = 0, i = 0;
+   char *names = NULL, *name = NULL, *save = NULL;
+   char *error = NULL;
+   const char *result = NULL;
+   int rc = 0, ret = CMD_SUCCESS;
+
+   if(get_feature_mapping() == NULL) {
+      vty_out(vty,"Error in retrieving the mapping of feature \
+            names to daemon names%s",VTY_NEWLINE);
+      return CMD_WARNING;
+   }
+   names = strdup(features);
+   if(names == NULL) {
+      VLOG_ERR("memory allocation failed");
+      return CMD_WARNING;
+   }
+   for(name = strtok_r(names,FEATURE_SEPARATOR,&save); name;
+         name = strtok_r(NULL,FEATURE_SEPARATOR,&save)) {
+      iter = feature_mapping_find(name);
+      if(iter == NULL) {
+         vty_out(vty,"Feature not present: %s%s",name,VTY_NEWLINE);
+         ret = CMD_WARNING;
+         goto done;
+      }
+      for(iter_daemon = iter->p_daemon; iter_daemon;
+            iter_daemon = iter_daemon->next) {
+         if(vlog_set_add_job(&jobs,&n_jobs,&max_jobs,iter_daemon->name,
+                  iter->name)) {
+            VLOG_ERR("memory allocation failed");
+            ret = CMD_WARNING;
+            goto done;
+         }
+      }
+   }
+   if(n_jobs == 0) {
+      vty_out(vty,"Feature not present %s",VTY_NEWLINE);
+      ret = CMD_WARNING;
+      goto done;
+   }
+
+   memset(&arg,0,sizeof(arg));
+   strncpy(arg.destination,destination,sizeof(arg.destination));
+   STR_SAFE(arg.destination);
+   strncpy(arg.setting,setting,sizeof(arg.setting));
+   STR_SAFE(arg.setting);
+   arg.duration = duration;
+   for(i = 0; i < n_jobs; i++) {
+      jobs[i].running = daemon_registry_running(jobs[i].daemon);
+      if(!jobs[i].running) {
+         continue;
+      }
+      strncpy(arg.daemon,jobs[i].daemon,sizeof(arg.daemon));
+      STR_SAFE(arg.daemon);
+      jobs[i].task = executor_submit(vlog_set_task,&arg,sizeof(arg),
+            VLOG_SET_TIMEOUT);
+   }
+
+   vty_out(vty,"============================================================%s",
+         VTY_NEWLINE);
+   vty_out(vty,"Daemon            Result       Features%s",VTY_NEWLINE);
+   vty_out(vty,"============================================================%s",
+         VTY_NEWLINE);
+   /* every task is waited for, to release the executor handles */
+   for(i = 0; i < n_jobs; i++) {
+      error = NULL;
+      rc = 1;
+      if(!jobs[i].running) {
+         result = "not running";
+      } else if(jobs[i].task == NULL) {
+         result = "failed";
+      } else {
+         status = executor_wait_result(jobs[i].task,&rc,(void **)&error);
+         if(status == EXECUTOR_TASK_TIMEDOUT) {
+            result = "timed out";
+         } else if(status == EXECUTOR_TASK_DONE && rc == 0) {
+            result = "ok";
+         } else {
+            result = "failed";
+         }
+      }
+      if(strcmp(result,"ok")) {
+         ret = CMD_WARNING;
+      }
+      vty_out(vty,"%-17.17s %-12.12s %s%s",jobs[i].daemon,result,
+            jobs[i].features,VTY_NEWLINE);
+      if(error) {
+         vty_out(vty,"%-17.17s %s%s","",error,VTY_NEWLINE);
+      }
+      FREE(error);
+   }
+
+done:
+   free(jobs);
+   free(names);
+   return ret;
+}
+
 /* Function       :  cli_config_vlog_set
  * Responsibility :  configure feature loglevel
  * Return         :  0 on Success 1 otherwise
@@ -352,7 +792,7 @@ cli_show_vlog_config_list(void)
    int
 cli_config_vlog_set(const char* type,
       const char *fd_name ,const char *destination,
-      const char *level)
+      const char *level, unsigned int duration)
 {
    static int rc =0;
    int len = 0;
@@ -360,8 +800,6 @@ cli_config_vlog_set(const char* type,
    char *fun_argv[SET_ARGC];
    char *name = NULL;
    int request = SET_REQUEST;
-   struct feature *iter = feature_head;
-   struct daemon *iter_daemon = NULL;
    int dest_len = strlen(destination);
    int level_len = strlen(level);
 
@@ -406,44 +844,28 @@ cli_config_vlog_set(const char* type,
 
    if(strcmp_with_nullcheck(type,FEATURE) == 0)
    {
-      if(!initialized) {
-         feature_head = get_feature_mapping();
-         if(feature_head == NULL){
-            vty_out(vty,"Error in retrieving the mapping of feature \
-                  names to daemon names%s",VTY_NEWLINE);
-            FREE(name);
-            return CMD_WARNING;
-         }
-         else {
-            initialized = 1;
-         }
-      }
-      /*traverse linked list to find feature*/
-      for (iter=feature_head ; iter && strcmp_with_nullcheck(iter->name,fd_name);
-            iter = iter->next);
-
-      if(iter != NULL) {
-         VLOG_DBG("feature:%s",iter->name);
-         iter_daemon = iter->p_daemon;
-         while(iter_daemon) {
-            /*Feature name is passing as an argument to
-             * vtysh_vlog_interface_daemon*/
-            rc = vtysh_vlog_interface_daemon(iter->name,iter_daemon->name,
-                  fun_argv,fun_argc, request);
-            if (!rc) {
-               VLOG_DBG("daemon :%s , rc:%d",iter_daemon->name,rc);
-            }
-            iter_daemon = iter_daemon->next;
-         }
-      }
-      else {
-         vty_out(vty,"Feature not present %s",VTY_NEWLINE);
-         FREE(name);
+      if(name == NULL) {
+         VLOG_ERR("memory allocation failed");
          return CMD_WARNING;
       }
+      rc = cli_config_vlog_set_features(fd_name,destination,name,
+            duration);
+      FREE(name);
+      return rc;
    }
    else
    {
+      if(!vlog_daemon_running(fd_name)) {
+         FREE(name);
+         return CMD_WARNING;
+      }
+      if(duration && vlog_schedule_revert(fd_name,destination,name,
+               duration)) {
+         vty_out(vty,"Not able to schedule the revert, level not changed%s",
+               VTY_NEWLINE);
+         FREE(name);
+         return CMD_WARNING;
+      }
       /* daemon Name is directly given */
       rc = vtysh_vlog_interface_daemon(NULL,(char *)fd_name,fun_argv,
             fun_argc,request);
@@ -462,6 +884,31 @@ cli_config_vlog_set(const char* type,
    return CMD_SUCCESS;
 }
 
+/* Function       :  cli_config_vlog_set_setting
+ * Responsibility :  configure the loglevel of features given as
+ *                   destination:level
+ * Return         :  0 on Success 1 otherwise
+ */
+static int
+cli_config_vlog_set_setting(const char *features, const char *setting,
+      unsigned int duration)
+{
+   char destination[MAX_SIZE] = {0,};
+   char *level = NULL;
+
+   /* destination:level, checked by cli_config_vlog_set */
+   strncpy(destination,setting,sizeof(destination));
+   STR_SAFE(destination);
+   level = strchr(destination,':');
+   if(level == NULL || level == destination || level[1] == '\0') {
+      vty_out(vty,"Invalid setting %s, expected destination:level%s",
+            setting,VTY_NEWLINE);
+      return CMD_WARNING;
+   }
+   *level++ = '\0';
+   return cli_config_vlog_set(FEATURE,features,destination,level,duration);
+}
+
 /*CLI to configure the log settings of FILE or SYSLOG */
 
 DEFUN_NOLOCK (cli_config_daemon_set_vlog,
@@ -481,10 +928,31 @@ DEFUN_NOLOCK (cli_config_daemon_set_vlog,
       VLOG_LOG_LEVEL_DBG
       VLOG_LOG_LEVEL_OFF)
 {
-   return cli_config_vlog_set(DAEMON,argv[0],argv[1],argv[2]);
+   return cli_config_vlog_set(DAEMON,argv[0],argv[1],argv[2],0);
 }
 
-
+DEFUN_NOLOCK (cli_config_daemon_set_vlog_duration,
+      cli_config_vlog_daemon_set_duration_cmd,
+      "vlog daemon NAME (syslog | file | all) " \
+      "(emer | err | warn | info | dbg | off) duration <1-86400>",
+      VLOG_CONFIG
+      VLOG_CONFIG_DAEMON
+      SHOW_VLOG_DAEMON_NAME
+      VLOG_LOG_DEST_SYSLOG
+      VLOG_LOG_DEST_FILE
+      VLOG_LOG_DEST_ALL
+      VLOG_LOG_LEVEL_EMER
+      VLOG_LOG_LEVEL_ERR
+      VLOG_LOG_LEVEL_WARN
+      VLOG_LOG_LEVEL_INFO
+      VLOG_LOG_LEVEL_DBG
+      VLOG_LOG_LEVEL_OFF
+      VLOG_DURATION
+      VLOG_DURATION_SECS)
+{
+   return cli_config_vlog_set(DAEMON,argv[0],argv[1],argv[2],
+         strtoul(argv[3],NULL,10));
+}
 
 DEFUN_NOLOCK (cli_config_feature_set_vlog,
       cli_config_vlog_feature_set_cmd,
@@ -503,11 +971,56 @@ DEFUN_NOLOCK (cli_config_feature_set_vlog,
       VLOG_LOG_LEVEL_DBG
       VLOG_LOG_LEVEL_OFF)
 {
-   return cli_config_vlog_set(FEATURE,argv[0],argv[1],argv[2]);
+   return cli_config_vlog_set(FEATURE,argv[0],argv[1],argv[2],0);
 }
 
+DEFUN_NOLOCK (cli_config_feature_set_vlog_duration,
+      cli_config_vlog_feature_set_duration_cmd,
+      "vlog feature NAME (syslog | file | all) " \
+      "(emer | err | warn | info | dbg | off) duration <1-86400>",
+      VLOG_CONFIG
+      VLOG_CONFIG_FEATURE
+      SHOW_VLOG_FEATURE_NAME
+      VLOG_LOG_DEST_SYSLOG
+      VLOG_LOG_DEST_FILE
+      VLOG_LOG_DEST_ALL
+      VLOG_LOG_LEVEL_EMER
+      VLOG_LOG_LEVEL_ERR
+      VLOG_LOG_LEVEL_WARN
+      VLOG_LOG_LEVEL_INFO
+      VLOG_LOG_LEVEL_DBG
+      VLOG_LOG_LEVEL_OFF
+      VLOG_DURATION
+      VLOG_DURATION_SECS)
+{
+   return cli_config_vlog_set(FEATURE,argv[0],argv[1],argv[2],
+         strtoul(argv[3],NULL,10));
+}
 
+DEFUN_NOLOCK (cli_config_features_set_vlog,
+      cli_config_vlog_features_set_cmd,
+      "vlog feature NAME SETTING",
+      VLOG_CONFIG
+      VLOG_CONFIG_FEATURE
+      VLOG_CONFIG_FEATURE_LIST
+      VLOG_LOG_SETTING)
+{
+   return cli_config_vlog_set_setting(argv[0],argv[1],0);
+}
 
+DEFUN_NOLOCK (cli_config_features_set_vlog_duration,
+      cli_config_vlog_features_set_duration_cmd,
+      "vlog feature NAME SETTING duration <1-86400>",
+      VLOG_CONFIG
+      VLOG_CONFIG_FEATURE
+      VLOG_CONFIG_FEATURE_LIST
+      VLOG_LOG_SETTING
+      VLOG_DURATION
+      VLOG_DURATION_SECS)
+{
+   return cli_config_vlog_set_setting(argv[0],argv[1],
+         strtoul(argv[2],NULL,10));
+}
 
 /*Action routine for show vlog features list*/
 
@@ -524,16 +1037,222 @@ DEFUN_NOLOCK (cli_platform_show_vlog_list,
 
 
 
+/* Filters of show vlog which are not journal matches */
+struct vlog_query
+{
+   uint64_t since;           /* usec, 0 for none */
+   uint64_t until;           /* usec, 0 for none */
+   unsigned long last;       /* latest entries only, 0 for all */
+   int has_regex;
+   regex_t regex;            /* on the message */
+};
+
+/* Walks the vlog entries of a journal matching a query, oldest first */
+struct vlog_iter
+{
+   sd_journal *journal;
+   const struct vlog_query *query;
+   unsigned long remaining;  /* entries left when query->last is set */
+   int pending;              /* the current entry was not returned yet */
+   const char *message;      /* of the current entry, not terminated */
+   size_t message_len;
+};
+
+/* Function       :  vlog_parse_time
+ * Responsibility :  Parses a show vlog time, either VLOG_TIME_FORMAT in
+ *                   local time or an age as a number of seconds, minutes,
+ *                   hours or days, as 30s, 10m, 2h or 1d
+ * Return         :  0 on success -1 otherwise
+ */
+static int
+vlog_parse_time(const char *arg, uint64_t *usec)
+{
+   static const struct { char unit; unsigned long secs; } units[] = {
+      {'s',1}, {'m',60}, {'h',3600}, {'d',86400}};
+   unsigned long value = 0;
+   const char *end = NULL;
+   char *unit = NULL;
+   struct tm tm;
+   time_t t = 0;
+   size_t i = 0;
+
+   memset(&tm,0,sizeof(tm));
+   end = strptime(arg,VLOG_TIME_FORMAT,&tm);
+   if(end != NULL && *end == '\0') {
+      tm.tm_isdst = -1;
+      t = mktime(&tm);
+      if(t == (time_t)-1) {
+         return -1;
+      }
+      *usec = (uint64_t)t * USEC_PER_SEC;
+      return 0;
+   }
+   errno = 0;
+   value = strtoul(arg,&unit,10);
+   if(errno || unit == arg || unit[0] == '\0' || unit[1] != '\0') {
+      return -1;
+   }
+   for(i = 0; i < sizeof(units) / sizeof(units[0]); i++) {
+      if(units[i].unit == unit[0]) {
+         t = time(NULL) - (time_t)(value * units[i].secs);
+         *usec = t > 0 ? (uint64_t)t * USEC_PER_SEC : 0;
+         return 0;
+      }
+   }
+   return -1;
+}
+
+/* Function       :  vlog_entry_match
+ * Responsibility :  Checks the current journal entry against the filters
+ *                   of the query, the message is read only once the time
+ *                   passed
+ * Return         :  1 if it matches, 0 if not, -1 once past the until time
+ */
+static int
+vlog_entry_match(struct vlog_iter *it)
+{
+   const struct vlog_query *q = it->query;
+   const void *data = NULL;
+   size_t len = 0, field_len = strlen(VLOG_MESSAGE_FIELD);
+   regmatch_t match;
+   uint64_t usec = 0;
+
+   if((q->since || q->until)
+         && sd_journal_get_realtime_usec(it->journal,&usec) >= 0) {
+      if(q->until && usec > q->until) {
+         return -1;
+      }
+      if(usec < q->since) {
+         return 0;
+      }
+   }
+   if(sd_journal_get_data(it->journal,"MESSAGE",&data,&len) < 0
+         || len < field_len) {
+      return 0;
+   }
+   it->message = (const char *)data + field_len;
+   it->message_len = len - field_len;
+   /* vlog messages only, not what the daemons print on their own */
+   if(it->message_len < strlen(VLOG_MESSAGE_PREFIX)
+         || strncmp(it->message,VLOG_MESSAGE_PREFIX,
+            strlen(VLOG_MESSAGE_PREFIX))) {
+      return 0;
+   }
+   if(q->has_regex) {
+      match.rm_so = 0;
+      match.rm_eo = it->message_len;
+      if(regexec(&q->regex,it->message,1,&match,REG_STARTEND)) {
+         return 0;
+      }
+   }
+   return 1;
+}
+
+/* Function       :  vlog_iter_start
+ * Responsibility :  Positions the iterator. For the last entries the
+ *                   journal is walked backwards from the end, or from the
+ *                   until time, until enough entries matched, so that
+ *                   only those are read again forwards
+ * Return         :  0 on success, a negative errno otherwise
+ */
+static int
+vlog_iter_start(struct vlog_iter *it, sd_journal *journal,
+      const struct vlog_query *query)
+{
+   unsigned long found = 0;
+   int r = 0, match = 0;
+
+   memset(it,0,sizeof(*it));
+   it->journal = journal;
+   it->query = query;
+   if(query->last == 0) {
+      return query->since ?
+         sd_journal_seek_realtime_usec(journal,query->since) :
+         sd_journal_seek_head(journal);
+   }
+   it->remaining = query->last;
+   r = query->until ?
+      sd_journal_seek_realtime_usec(journal,query->until + 1) :
+      sd_journal_seek_tail(journal);
+   while(r >= 0 && found < query->last
+         && (r = sd_journal_previous(journal)) > 0) {
+      it->pending = 1;
+      match = vlog_entry_match(it);
+      if(match > 0) {
+         found++;
+      }
+      else if(match == 0 && query->since) {
+         uint64_t usec = 0;
+         if(sd_journal_get_realtime_usec(journal,&usec) >= 0
+               && usec < query->since) {
+            break;
+         }
+      }
+   }
+   return r < 0 ? r : 0;
+}
+
+/* Function       :  vlog_iter_next
+ * Responsibility :  Moves to the next matching entry, it->message is then
+ *                   the message of the entry
+ * Return         :  1 on an entry, 0 at the end, a negative errno otherwise
+ */
+static int
+vlog_iter_next(struct vlog_iter *it)
+{
+   int r = 0, match = 0;
+
+   for(;;) {
+      if(it->query->last && it->remaining == 0) {
+         return 0;
+      }
+      if(it->pending) {
+         it->pending = 0;
+         r = 1;
+      }
+      else {
+         r = sd_journal_next(it->journal);
+      }
+      if(r <= 0) {
+         return r;
+      }
+      match = vlog_entry_match(it);
+      if(match < 0) {
+         return 0;
+      }
+      if(match) {
+         if(it->query->last) {
+            it->remaining--;
+         }
+         return 1;
+      }
+   }
+}
+
 /* Function       :  cli_show_vlog
- * Responsibility :  Display vlogs
+ * Responsibility :  Display vlogs, as they are read from the journal
  * Return         :  0 on Success 1 otherwise
  */
    int
-cli_show_vlog(sd_journal *journal_handle,const char *argv,int filter)
+cli_show_vlog(sd_journal *journal_handle,const struct vlog_query *query,
+      int filter)
 {
+   struct vlog_iter it;
+   const void *data = NULL;
+   const char *module = "";
+   size_t module_len = 0, len = 0;
+   size_t field_len = strlen(VLOG_IDENTIFIER_FIELD);
    int return_value = 0;
    int vlog_count = 0;
 
+   return_value = vlog_iter_start(&it,journal_handle,query);
+   if(return_value < 0) {
+      VLOG_ERR("Failed to seek the journal: %s",strerror(-return_value));
+      vty_out(vty,"Not able to read the log files%s",VTY_NEWLINE);
+      sd_journal_close(journal_handle);
+      return CMD_WARNING;
+   }
+
    /* Success, Now print the Header */
    vty_out(vty,"%s---------------------------------------------------%s",
          VTY_NEWLINE,VTY_NEWLINE);
@@ -542,80 +1261,23 @@ cli_show_vlog(sd_journal *journal_handle,const char *argv,int filter)
          VTY_NEWLINE);
 
    /* For Each Log Message  */
-   SD_JOURNAL_FOREACH(journal_handle)
+   while((return_value = vlog_iter_next(&it)) > 0)
    {
-      const char *message_data = NULL;
-      const char *ch = "|";
-      const char *msg = NULL;
-      char *msg_str = NULL;
-      char *message = NULL;
-      size_t data_length = 0;
-      const char *module_name = NULL;
-      const char *module = NULL;
-      size_t module_length = 0;
-      char err_buf[BUF_SIZE] = {0};
-
-      return_value = sd_journal_get_data(journal_handle
-            , "SYSLOG_IDENTIFIER"
-            ,(const void **)&module_name
-            , &module_length);
-      if (return_value < 0) {
-         strerror_r (errno,err_buf,sizeof(err_buf));
-         VLOG_DBG("Failed to read module name field: %s\n",err_buf);
-      }
-
-      if(module_name != NULL){
-         module = get_value(module_name);
-         if(module==NULL) {
-            VLOG_DBG("failed to read module-value from module field");
-         }
-      }
-
-      return_value = sd_journal_get_data(journal_handle
-            , "MESSAGE"
-            ,(const void **)&message_data
-            , &data_length);
-      /*message_data is local for iter loop , no need to free it*/
-      if (return_value < 0) {
-         strerror_r (errno,err_buf,sizeof(err_buf));
-         VLOG_DBG("Failed to read message field: %s\n",err_buf);
+      module = "";
+      module_len = 0;
+      if(sd_journal_get_data(journal_handle,"SYSLOG_IDENTIFIER",&data,&len)
+            >= 0 && len > field_len) {
+         module = (const char *)data + field_len;
+         module_len = len - field_len;
       }
-
       ++vlog_count;
-      /*read the log message from journal*/
-      if(message_data != NULL){
-         msg = get_value(message_data);
-         if(msg == NULL) {
-            VLOG_DBG("failed to read msg from message field");
-         }
-      }
-      /*duplicate the log message and search for ovs logs*/
-      if(msg != NULL){
-         msg_str = xstrdup(msg);
-         if(msg_str == NULL) {
-            VLOG_DBG("failed to duplicate the message");
-         }
-      }
-      /*show vlog daemon*/
-      if(argv != NULL && module != NULL && msg_str != NULL){
-         if(!strcmp_with_nullcheck(module,argv)){
-            message = strtok(msg_str,ch);
-            if(message != NULL && !strcmp_with_nullcheck(message,"ovs")){
-               vty_out(vty,"%-25.25s|%-200.200s%s",argv,msg,VTY_NEWLINE);
-            }
-         }
-         FREE(msg_str);
-      }
-      else{
-         /*show vlog and show vlog severity*/
-         if(msg_str != NULL) {
-            message = strtok(msg_str,ch);
-            if(!strcmp_with_nullcheck(message,"ovs") && (message != NULL)){
-               vty_out(vty,"%-25.25s|%-200.200s%s",module,msg,VTY_NEWLINE);
-            }
-         }
-         FREE(msg_str);
-      }
+      vty_out(vty,"%-25.*s|%-200.*s%s",
+            (int)(module_len < 25 ? module_len : 25),module,
+            (int)(it.message_len < 200 ? it.message_len : 200),it.message,
+            VTY_NEWLINE);
+   }
+   if(return_value < 0) {
+      VLOG_ERR("Failed to read the journal: %s",strerror(-return_value));
    }
    if(!vlog_count){
       if(filter){
@@ -640,19 +1302,15 @@ cli_show_vlog_config(void)
    static int rc = 0;
    int fun_argc = LIST_ARGC;
    int request = SHOW_VLOG_CONFIG_REQUEST;
-   struct feature *iter = feature_head;
+   struct feature *feature_head = NULL;
+   struct feature *iter = NULL;
    struct daemon *iter_daemon = NULL;
    char *fun_argv = NULL;
-   if(!initialized) {
-      feature_head = get_feature_mapping();
-      if(feature_head == NULL){
-         vty_out(vty,"Error in retrieving the mapping of feature \
-               names to daemon names%s",VTY_NEWLINE);
-         return CMD_WARNING;
-      }
-      else {
-         initialized = 1;
-      }
+   feature_head = get_feature_mapping();
+   if(feature_head == NULL){
+      vty_out(vty,"Error in retrieving the mapping of feature \
+            names to daemon names%s",VTY_NEWLINE);
+      return CMD_WARNING;
    }
 
    fun_argv= (char *)calloc(LIST_SIZE,sizeof(char));
@@ -676,6 +1334,11 @@ cli_show_vlog_config(void)
       if(iter) {
          iter_daemon = iter->p_daemon;
          while(iter_daemon) {
+            if(!daemon_registry_running(iter_daemon->name)) {
+               VLOG_DBG("daemon :%s not running",iter_daemon->name);
+               iter_daemon = iter_daemon->next;
+               continue;
+            }
             rc = vtysh_vlog_interface_daemon(iter->name,iter_daemon->name,
                   &fun_argv,fun_argc,request);
             if (!rc) {
@@ -692,6 +1355,7 @@ cli_show_vlog_config(void)
       }
    }
    FREE(fun_argv);
+   cli_show_vlog_overrides();
    return CMD_SUCCESS;
 }
 
@@ -708,8 +1372,20 @@ vlog_filter(char *arg, int index, sd_journal *journal_handle)
    char buf[BUF_SIZE] = {0,};
    int level = 0, return_value = 0;
    if(index == DAEMON_INDEX) {
-      /*filter for daemon*/
-      snprintf(buf, BUF_SIZE, "SYSLOG_IDENTIFIER=%s", arg);
+      /*filter for daemons, matches of the same field are ORed*/
+      char *names = xstrdup(arg), *name = NULL, *save = NULL;
+      for(name = strtok_r(names,DAEMON_SEPARATOR,&save); name;
+            name = strtok_r(NULL,DAEMON_SEPARATOR,&save)) {
+         snprintf(buf, BUF_SIZE, "SYSLOG_IDENTIFIER=%s", name);
+         return_value = sd_journal_add_match(journal_handle,buf,0);
+         if(return_value < 0) {
+            VLOG_ERR("Failed to log the message at daemon:%s",name);
+            FREE(names);
+            return -1;
+         }
+      }
+      FREE(names);
+      return 0;
    }
    else if(index == SEVERITY_INDEX) {
       level = sev_level((char*)arg);
@@ -786,7 +1462,8 @@ DEFUN_NOLOCK (cli_platform_showvlog_daemon_list,
 DEFUN_NOLOCK (cli_platform_show_vlog,
       cli_platform_show_vlog_cmd,
       "show vlog "
-      "{daemon WORD | severity (emer | err | warn | info | debug)}",
+      "{severity (emer | err | warn | info | debug) | daemon WORD | "
+      "last <1-1000000> | since WORD | until WORD | match WORD}",
       SHOW_STR
       SHOW_VLOG_STR
       SHOW_VLOG_FILTER_SEV
@@ -795,18 +1472,51 @@ DEFUN_NOLOCK (cli_platform_show_vlog,
       SEVERITY_LEVEL_WARN
       SEVERITY_LEVEL_INFO
       SEVERITY_LEVEL_DBG
-      SHOW_VLOG_FILTER_DAEMON)
+      SHOW_VLOG_FILTER_DAEMON
+      SHOW_VLOG_FILTER_WORD
+      SHOW_VLOG_FILTER_LAST
+      SHOW_VLOG_FILTER_LAST_COUNT
+      SHOW_VLOG_FILTER_SINCE
+      SHOW_VLOG_FILTER_TIME
+      SHOW_VLOG_FILTER_UNTIL
+      SHOW_VLOG_FILTER_TIME
+      SHOW_VLOG_FILTER_MATCH
+      SHOW_VLOG_FILTER_REGEX)
 {
    sd_journal *journal_handle = NULL;
+   struct vlog_query query;
    int i = 0, return_value = 0, filter = 0;
 
+   memset(&query,0,sizeof(query));
+   if(argv[LAST_INDEX] != NULL) {
+      query.last = strtoul(argv[LAST_INDEX],NULL,10);
+   }
+   if((argv[SINCE_INDEX] != NULL
+            && vlog_parse_time(argv[SINCE_INDEX],&query.since))
+         || (argv[UNTIL_INDEX] != NULL
+            && vlog_parse_time(argv[UNTIL_INDEX],&query.until))) {
+      vty_out(vty,"Invalid time, expected YYYY-MM-DD:HH:MM:SS or an age "
+            "as 30s, 10m, 2h or 1d%s",VTY_NEWLINE);
+      return CMD_WARNING;
+   }
+   if(argv[MATCH_INDEX] != NULL) {
+      if(regcomp(&query.regex,argv[MATCH_INDEX],REG_EXTENDED | REG_NOSUB)) {
+         vty_out(vty,"Invalid regular expression %s%s",argv[MATCH_INDEX],
+               VTY_NEWLINE);
+         return CMD_WARNING;
+      }
+      query.has_regex = 1;
+   }
+   filter = (argv[SINCE_INDEX] || argv[UNTIL_INDEX] || query.has_regex);
+
    /* Open Journal File to read Logs */
    return_value = sd_journal_open(&journal_handle,SD_JOURNAL_LOCAL_ONLY);
 
    if(return_value < 0) {
       VLOG_ERR("Failed to open journal");
       vty_out(vty,"Not able to read the log files%s",VTY_NEWLINE);
-      return CMD_WARNING;
+      return_value = CMD_WARNING;
+      goto done;
    }
    /* Filter Vlogs from other Journal Logs */
    return_value = sd_journal_add_match(journal_handle,MESSAGE_OVS_MATCH,0) ;
@@ -814,7 +1524,8 @@ DEFUN_NOLOCK (cli_platform_show_vlog,
       VLOG_ERR("Failed to log");
       vty_out(vty,"Not able to filter vlogs from  the log files%s",VTY_NEWLINE);
       sd_journal_close(journal_handle);
-      return CMD_WARNING;
+      return_value = CMD_WARNING;
+      goto done;
    }
 
    while(i < ARGC)
@@ -826,11 +1537,18 @@ DEFUN_NOLOCK (cli_platform_show_vlog,
             VLOG_ERR("Failed to Filter log messages");
             vty_out(vty,"Failed to filter vlog messages%s",VTY_NEWLINE);
             sd_journal_close(journal_handle);
-            return CMD_WARNING;
+            return_value = CMD_WARNING;
+            goto done;
          }
          filter = TRUE;
       }
       i++;
    }
-   return cli_show_vlog(journal_handle,argv[1],filter);
+   return_value = cli_show_vlog(journal_handle,&query,filter);
+
+done:
+   if(query.has_regex) {
+      regfree(&query.regex);
+   }
+   return return_value;
 }
@@ -0,0 +1,808 @@
+/* System SUPPORT_BUNDLE CLI commands
+*
+* Copyright (C) 1997, 98 Kunihiro Ishiguro
+* Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+*
+* GNU Zebra is free software; you can redistribute it and/or modify it
+* under the terms of the GNU General Public License as published by the
+* Free Software Foundation; either version 2, or (at your option) any
+* later version.
+*
+* GNU Zebra is distributed in the hope that it will be useful, but
+* WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+* General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with GNU Zebra; see the file COPYING.  If not, write to the Free
+* Software Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA
+* 02111-1307, USA.
+*
+* File: support_bundle_vty.c
+*
+* Purpose: To collect show tech, diag-dump, events and core dumps in to one
+*          zstd compressed tar archive, with a manifest of its members.
+*
+*          Show tech is captured first, so that its commands have the
+*          shared executor to themselves. The diag-dump requests are then
+*          sent to every daemon at once, while the CLI thread captures the
+*          event log and streams the latest core dumps in to the archive.
+*          Members are compressed as they are added straight in to the
+*          bundle, which is kept on persistent storage.
+*/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "vtysh/command.h"
+#include "vtysh/vtysh.h"
+#include "vtysh/vtysh_user.h"
+#include "vtysh/buffer.h"
+#include "openvswitch/vlog.h"
+#include "jsonrpc.h"
+#include "unixctl.h"
+#include "systemd/sd-journal.h"
+#include "support_bundle_vty.h"
+#include "show_events_vty.h"
+#include "diag_dump_vty.h"
+#include "core_dump.h"
+#include "core_dump_index.h"
+#include "supportability_archive.h"
+#include "supportability_executor.h"
+#include "supportability_utils.h"
+
+VLOG_DEFINE_THIS_MODULE (vtysh_support_bundle_cli);
+
+#define BUNDLE_SOURCE_LEN     128
+
+/* show tech and show events globals, see show_tech_vty.c */
+extern int  gVtyOldType;
+extern bool gUserInterrupt;
+extern int  cli_show_tech(const char* feature, const char* sub_feature);
+extern int  cli_show_events(sd_journal *journal_handle, int reverse,
+                            int filter);
+
+/* Argument of a diag-dump executor task */
+struct bundle_diag_arg
+{
+    char feature[DIAG_ARG_LEN_MAX];
+    char daemon[DIAG_ARG_LEN_MAX];
+};
+
+/* Diag-dump request in flight */
+struct bundle_job
+{
+    char name[ARCHIVE_NAME_MAX + 1];
+    char source[BUNDLE_SOURCE_LEN];
+    struct executor_task *task;
+};
+
+/* One line of the manifest */
+struct bundle_entry
+{
+    char name[ARCHIVE_NAME_MAX + 1];
+    char source[BUNDLE_SOURCE_LEN];
+    const char *status;
+    int archived;
+    struct archive_member_info info;
+};
+
+struct bundle
+{
+    struct archive_writer *aw;
+    struct bundle_entry *entries;
+    size_t n_entries;
+    size_t max_entries;
+    int broken;                  /* archive write failed, give up */
+};
+
+static volatile sig_atomic_t gBundleUserInterrupt = 0;
+
+/* Function       : bundle_record
+ * Resposibility  : append a member, or a source which could not be
+ *                  collected, to the manifest
+ * Return         : void
+ */
+static void
+bundle_record(struct bundle *b, const char *name, const char *source,
+              const char *status, const struct archive_member_info *info)
+{
+    struct bundle_entry *entries = NULL;
+    struct bundle_entry *entry = NULL;
+    size_t max = 0;
+
+    if (b->n_entries == b->max_entries) {
+        max = b->max_entries ? 2 * b->max_entries : 32;
+        entries = realloc(b->entries, max * sizeof(*entries));
+        if (entries == NULL) {
+            VLOG_ERR("support bundle: manifest allocation failed");
+            return;
+        }
+        b->entries = entries;
+        b->max_entries = max;
+    }
+    entry = &b->entries[b->n_entries++];
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->name, name, sizeof(entry->name));
+    STR_SAFE(entry->name);
+    strncpy(entry->source, source, sizeof(entry->source));
+    STR_SAFE(entry->source);
+    entry->status = status;
+    if (info) {
+        entry->archived = 1;
+        entry->info = *info;
+    }
+}
+
+/* Function       : bundle_add_buffer
+ * Resposibility  : add a captured output to the archive and the manifest
+ * Return         : 0 on success, -1 once the archive is broken
+ */
+static int
+bundle_add_buffer(struct bundle *b, const char *name, const char *source,
+                  const char *data)
+{
+    struct archive_member_info info;
+
+    if (data == NULL) {
+        bundle_record(b, name, source, "failed", NULL);
+        return 0;
+    }
+    if (archive_add_buffer(b->aw, name, data, strlen(data), time(NULL),
+                           &info)) {
+        b->broken = 1;
+        return -1;
+    }
+    bundle_record(b, name, source, "ok", &info);
+    return 0;
+}
+
+/* Function       : bundle_diag_task
+ * Resposibility  : executor task body, request the basic diag dump of one
+ *                  feature from one daemon and hand the text back
+ * Return         : 0 on success and nonzero on failure
+ */
+static int
+bundle_diag_task(void *arg, const struct executor_task *task)
+{
+    struct bundle_diag_arg *diag = arg;
+    char *cmd_argv[DIAG_CMD_ARGC_MAX];
+    char *cmd_result = NULL, *cmd_error = NULL;
+    struct jsonrpc *client = NULL;
+    int rc = 0;
+
+    if (executor_task_cancelled(task)) {
+        return 1;
+    }
+    client = connect_to_daemon(diag->daemon);
+    if (client == NULL) {
+        VLOG_ERR("support bundle: failed to connect daemon %s",
+                 diag->daemon);
+        return 1;
+    }
+    cmd_argv[0] = DIAG_BASIC;
+    cmd_argv[1] = diag->feature;
+    rc = unixctl_client_transact(client, DIAG_DUMP_BASIC_CMD,
+            DIAG_CMD_ARGC_MAX, cmd_argv, &cmd_result, &cmd_error);
+    jsonrpc_close(client);
+    if (rc || cmd_error || cmd_result == NULL) {
+        VLOG_ERR("%s: diag dump of %s failed:%s , rc =%d", diag->daemon,
+                 diag->feature, STR_NULL_CHK(cmd_error), rc);
+        FREE(cmd_result);
+        FREE(cmd_error);
+        return 1;
+    }
+    executor_task_set_result(task, cmd_result);
+    return 0;
+}
+
+/* Function       : bundle_submit_diag
+ * Resposibility  : send the diag dump requests of every supported feature
+ *                  and daemon to the executor without waiting for them
+ * Return         : array of jobs, *n_jobs set to its length
+ */
+static struct bundle_job *
+bundle_submit_diag(size_t *n_jobs)
+{
+    struct feature *feature_head = NULL, *iter = NULL;
+    struct daemon *iter_daemon = NULL;
+    struct bundle_job *jobs = NULL;
+    struct bundle_diag_arg arg;
+    size_t count = 0;
+
+    *n_jobs = 0;
+    feature_head = get_feature_mapping();
+    for (iter = feature_head; iter; iter = iter->next) {
+        for (iter_daemon = iter->p_daemon; iter_daemon;
+             iter_daemon = iter_daemon->next) {
+            if (iter->diag_flag == ENABLE && iter_daemon->diag_flag == ENABLE) {
+                count++;
+            }
+        }
+    }
+    if (count == 0) {
+        return NULL;
+    }
+    jobs = calloc(count, sizeof(*jobs));
+    if (jobs == NULL) {
+        VLOG_ERR("support bundle: memory allocation failed");
+        return NULL;
+    }
+    for (iter = feature_head; iter; iter = iter->next) {
+        if (iter->diag_flag != ENABLE) {
+            continue;
+        }
+        for (iter_daemon = iter->p_daemon; iter_daemon;
+             iter_daemon = iter_daemon->next) {
+            if (iter_daemon->diag_flag != ENABLE) {
+                continue;
+            }
+            memset(&arg, 0, sizeof(arg));
+            strncpy(arg.feature, iter->name, sizeof(arg.feature));
+            STR_SAFE(arg.feature);
+            strncpy(arg.daemon, iter_daemon->name, sizeof(arg.daemon));
+            STR_SAFE(arg.daemon);
+
+            snprintf(jobs[*n_jobs].name, sizeof(jobs[*n_jobs].name),
+                     "diag-dump/%s/%s.txt", arg.feature, arg.daemon);
+            snprintf(jobs[*n_jobs].source, sizeof(jobs[*n_jobs].source),
+                     "diag-dump %s basic (%s)", arg.feature, arg.daemon);
+            jobs[*n_jobs].task = executor_submit(bundle_diag_task, &arg,
+                                                 sizeof(arg), FUN_MAX_TIME);
+            (*n_jobs)++;
+        }
+    }
+    return jobs;
+}
+
+/* Function       : bundle_collect_diag
+ * Resposibility  : wait for every diag dump request and archive the
+ *                  replies. Every job is waited for, even once the bundle
+ *                  is abandoned, to release the executor handles.
+ * Return         : void
+ */
+static void
+bundle_collect_diag(struct bundle *b, struct bundle_job *jobs, size_t n_jobs)
+{
+    enum executor_status status;
+    void *result = NULL;
+    size_t i = 0;
+    int rc = 1;
+
+    for (i = 0; i < n_jobs; i++) {
+        if (jobs[i].task == NULL) {
+            bundle_record(b, jobs[i].name, jobs[i].source, "failed", NULL);
+            continue;
+        }
+        result = NULL;
+        rc = 1;
+        status = executor_wait_result(jobs[i].task, &rc, &result);
+        if (b->broken || gBundleUserInterrupt) {
+            FREE(result);
+            continue;
+        }
+        switch (status) {
+            case EXECUTOR_TASK_DONE:
+                if (rc == 0) {
+                    bundle_add_buffer(b, jobs[i].name, jobs[i].source, result);
+                } else {
+                    bundle_record(b, jobs[i].name, jobs[i].source, "failed",
+                                  NULL);
+                }
+                break;
+            case EXECUTOR_TASK_TIMEDOUT:
+                bundle_record(b, jobs[i].name, jobs[i].source, "timed out",
+                              NULL);
+                break;
+            case EXECUTOR_TASK_INTERRUPTED:
+                bundle_record(b, jobs[i].name, jobs[i].source, "interrupted",
+                              NULL);
+                break;
+            default:
+                bundle_record(b, jobs[i].name, jobs[i].source, "failed", NULL);
+                break;
+        }
+        FREE(result);
+    }
+}
+
+/* Function       : bundle_capture_show_tech
+ * Resposibility  : run show tech with its output captured, the same way
+ *                  show tech localfile does
+ * Return         : captured output, NULL on failure
+ */
+static char *
+bundle_capture_show_tech(void)
+{
+    char *output = NULL;
+
+    gVtyOldType = vty->type;
+    vty->type = VTY_FILE;
+    cli_show_tech(NULL, NULL);
+    vty->type = gVtyOldType;
+    if (vty->obuf == NULL) {
+        return NULL;
+    }
+    output = buffer_getstr(vty->obuf);
+    buffer_reset(vty->obuf);
+    return output;
+}
+
+/* Function       : bundle_capture_events
+ * Resposibility  : capture the complete event log, as show events prints it
+ * Return         : captured output, NULL on failure
+ */
+static char *
+bundle_capture_events(void)
+{
+    sd_journal *journal_handle = NULL;
+    char *output = NULL;
+    int old_type = 0;
+    int rc = 0;
+
+    if (sd_journal_open(&journal_handle, SD_JOURNAL_LOCAL_ONLY) < 0) {
+        VLOG_ERR("Failed to open journal");
+        return NULL;
+    }
+    if (sd_journal_add_match(journal_handle, MESSAGE_OPS_EVT_MATCH, 0) < 0) {
+        VLOG_ERR("Failed to add the event log match");
+        sd_journal_close(journal_handle);
+        return NULL;
+    }
+    old_type = vty->type;
+    vty->type = VTY_FILE;
+    rc = cli_show_events(journal_handle, 0, 0);
+    vty->type = old_type;
+    if (rc != CMD_SUCCESS) {
+        /* closed by cli_show_events only on success */
+        sd_journal_close(journal_handle);
+    }
+    if (vty->obuf == NULL) {
+        return NULL;
+    }
+    output = buffer_getstr(vty->obuf);
+    buffer_reset(vty->obuf);
+    if (rc != CMD_SUCCESS) {
+        FREE(output);
+    }
+    return output;
+}
+
+/* Function       : bundle_core_newer
+ * Resposibility  : qsort comparison of core dump entries, newest first
+ * Return         : <0, 0 or >0 as qsort expects
+ */
+static int
+bundle_core_newer(const void *a, const void *b)
+{
+    const struct core_index_entry *ea = *(const struct core_index_entry **)a;
+    const struct core_index_entry *eb = *(const struct core_index_entry **)b;
+    int rc = 0;
+
+    rc = strcmp(eb->cd.crash_date, ea->cd.crash_date);
+    if (rc == 0) {
+        rc = strcmp(eb->cd.crash_time, ea->cd.crash_time);
+    }
+    return rc;
+}
+
+/* Function       : bundle_select_cores
+ * Resposibility  : pick the latest SUPPORT_BUNDLE_MAX_CORES core dumps,
+ *                  in all at most SUPPORT_BUNDLE_MAX_CORE_BYTES large
+ * Return         : array of the selection flags of entries, NULL on failure
+ */
+static char *
+bundle_select_cores(const struct core_index_entry *entries, size_t n_entries)
+{
+    const struct core_index_entry **order = NULL;
+    char path[CORE_FILE_NAME];
+    unsigned long long total = 0;
+    struct stat sb;
+    char *selected = NULL;
+    size_t i = 0, n = 0;
+
+    selected = calloc(n_entries ? n_entries : 1, 1);
+    order = calloc(n_entries ? n_entries : 1, sizeof(*order));
+    if (selected == NULL || order == NULL) {
+        free(selected);
+        free(order);
+        return NULL;
+    }
+    for (i = 0; i < n_entries; i++) {
+        order[i] = &entries[i];
+    }
+    qsort(order, n_entries, sizeof(*order), bundle_core_newer);
+    for (i = 0; i < n_entries && n < SUPPORT_BUNDLE_MAX_CORES; i++) {
+        if (core_index_path(order[i], path, sizeof(path))
+            || stat(path, &sb) < 0
+            || total + sb.st_size > SUPPORT_BUNDLE_MAX_CORE_BYTES) {
+            continue;
+        }
+        total += sb.st_size;
+        selected[order[i] - entries] = 1;
+        n++;
+    }
+    free(order);
+    return selected;
+}
+
+/* Function       : bundle_add_cores
+ * Resposibility  : stream the latest daemon and kernel core dumps in to the
+ *                  archive, the others are listed in the manifest only
+ * Return         : number of core dumps archived
+ */
+static int
+bundle_add_cores(struct bundle *b)
+{
+    struct archive_member_info info;
+    struct core_index_entry *entries = NULL;
+    char name[ARCHIVE_NAME_MAX + 1];
+    char path[CORE_FILE_NAME];
+    char *selected = NULL;
+    size_t n_entries = 0;
+    size_t i = 0;
+    int count = 0;
+    int rc = 0;
+
+    if (core_index_snapshot(&entries, &n_entries) != 0) {
+        bundle_record(b, "coredump", "core-dump", "failed", NULL);
+        return 0;
+    }
+    selected = bundle_select_cores(entries, n_entries);
+    if (selected == NULL) {
+        bundle_record(b, "coredump", "core-dump", "failed", NULL);
+        free(entries);
+        return 0;
+    }
+    for (i = 0; i < n_entries; i++) {
+        if (gBundleUserInterrupt) {
+            break;
+        }
+        snprintf(name, sizeof(name), "%s/%s",
+                 (entries[i].type == TYPE_KERNEL) ? "coredump/kernel"
+                                                  : "coredump",
+                 entries[i].name);
+        if (!selected[i]) {
+            /* older or over the size limit, copy core-dump fetches it */
+            bundle_record(b, name, "core-dump", "skipped", NULL);
+            continue;
+        }
+        if (core_index_path(&entries[i], path, sizeof(path))) {
+            bundle_record(b, name, "core-dump", "unreadable", NULL);
+            continue;
+        }
+        rc = archive_add_file(b->aw, name, path, &info);
+        if (rc < 0) {
+            b->broken = 1;
+            break;
+        }
+        if (rc > 0) {
+            /* removed or unreadable, the rest is still worth having */
+            bundle_record(b, name, "core-dump", "unreadable", NULL);
+            continue;
+        }
+        bundle_record(b, name, "core-dump", "ok", &info);
+        count++;
+    }
+    free(selected);
+    free(entries);
+    return count;
+}
+
+/* Function       : bundle_add_manifest
+ * Resposibility  : describe every member, with its offset in the tar
+ *                  stream, size and SHA-256, as the last archive member
+ * Return         : 0 on success, -1 once the archive is broken
+ */
+static int
+bundle_add_manifest(struct bundle *b, const char *bundle_name,
+                    time_t created, double collection_secs)
+{
+    const struct bundle_entry *entry = NULL;
+    char timebuf[32] = {0};
+    struct tm tm_created;
+    char *buf = NULL;
+    size_t size = 0;
+    size_t i = 0;
+    FILE *fp = NULL;
+    int rc = 0;
+
+    fp = open_memstream(&buf, &size);
+    if (fp == NULL) {
+        return -1;
+    }
+    if (localtime_r(&created, &tm_created)) {
+        strftime(timebuf, sizeof(timebuf), "%Y-%m-%d %H:%M:%S", &tm_created);
+    }
+    fprintf(fp, "bundle: %s\n", bundle_name);
+    fprintf(fp, "created: %s\n", timebuf);
+    fprintf(fp, "collection_secs: %.3f\n", collection_secs);
+    fprintf(fp, "members:\n");
+    for (i = 0; i < b->n_entries; i++) {
+        entry = &b->entries[i];
+        fprintf(fp, "  - index: %zu\n", i + 1);
+        fprintf(fp, "    name: %s\n", entry->name);
+        fprintf(fp, "    source: %s\n", entry->source);
+        fprintf(fp, "    status: %s\n", entry->status);
+        if (entry->archived) {
+            fprintf(fp, "    offset: %llu\n",
+                    (unsigned long long)entry->info.offset);
+            fprintf(fp, "    size: %llu\n",
+                    (unsigned long long)entry->info.size);
+            fprintf(fp, "    sha256: %s\n", entry->info.sha256);
+        }
+    }
+    fclose(fp);
+    rc = archive_add_buffer(b->aw, SUPPORT_BUNDLE_MANIFEST, buf, size,
+                            created, NULL);
+    free(buf);
+    if (rc) {
+        b->broken = 1;
+    }
+    return rc;
+}
+
+/* Function       : bundle_signal_handler
+ * Resposibility  : signal handler for support bundle
+ * Return         : NULL
+ */
+static void
+bundle_signal_handler(int sig, siginfo_t *siginfo, void *context)
+{
+    if (!gBundleUserInterrupt) {
+        gBundleUserInterrupt = 1;
+        executor_interrupt(0);
+    }
+}
+
+/* Function       : bundle_file_name
+ * Resposibility  : derive the archive file name from the user given name,
+ *                  or from the current time
+ * Return         : 0 on success, nonzero on invalid name
+ */
+static int
+bundle_file_name(const char *fname, char *name, size_t size)
+{
+    size_t len = 0, suffix_len = strlen(SUPPORT_BUNDLE_SUFFIX);
+    struct tm tm_now;
+    time_t now;
+
+    if (fname == NULL) {
+        time(&now);
+        if (localtime_r(&now, &tm_now) == NULL) {
+            return 1;
+        }
+        strftime(name, size, "support-bundle-%Y%m%d.%H%M%S"
+                 SUPPORT_BUNDLE_SUFFIX, &tm_now);
+        return 0;
+    }
+    if (validate_cli_args(fname, SUPPORT_BUNDLE_NAME_REGEX) != 0) {
+        return 1;
+    }
+    len = strlen(fname);
+    if (len > suffix_len
+        && !strcmp(fname + len - suffix_len, SUPPORT_BUNDLE_SUFFIX)) {
+        snprintf(name, size, "%s", fname);
+    } else {
+        snprintf(name, size, "%s%s", fname, SUPPORT_BUNDLE_SUFFIX);
+    }
+    return 0;
+}
+
+/* Function       : cli_support_bundle_create
+ * Resposibility  : Collect show tech, diag-dump, events and core dumps in
+ *                  to a single archive
+ * Return         : CMD_SUCCESS on success CMD_WARNING on failure
+ */
+int
+cli_support_bundle_create(const char *fname, enum support_bundle_cores cores)
+{
+    char name[SUPPORT_BUNDLE_PATH_LEN] = {0};
+    char path[SUPPORT_BUNDLE_PATH_LEN] = {0};
+    char part_path[SUPPORT_BUNDLE_PATH_LEN] = {0};
+    char err_buf[MAX_STR_BUFF_LEN] = {0};
+    struct sigaction oldSignalHandler, newSignalHandler, oldZSignalHandler,
+                     newZSignalHandler;
+    struct bundle_job *jobs = NULL;
+    struct timespec start, end;
+    struct bundle b;
+    size_t n_jobs = 0;
+    char *output = NULL;
+    time_t created;
+    double secs = 0.0;
+    int n_cores = 0;
+    int fd = -1;
+    int return_val = CMD_SUCCESS;
+
+    memset(&b, 0, sizeof(b));
+    if (bundle_file_name(fname, name, sizeof(name))) {
+        vty_out(vty, "Failed to validate file name:%s%s", fname, VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+    if ((mkdir(SUPPORT_BUNDLE_PARENT_DIR, S_IRWXU | S_IRGRP | S_IXGRP) < 0
+         && errno != EEXIST)
+        || (mkdir(SUPPORT_BUNDLE_DIR, S_IRWXU | S_IRGRP | S_IXGRP) < 0
+            && errno != EEXIST)) {
+        strerror_r(errno, err_buf, sizeof(err_buf));
+        vty_out(vty, "failed to check or create dir:%s reason:%s%s",
+                SUPPORT_BUNDLE_DIR, err_buf, VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+    snprintf(path, sizeof(path), "%s/%s", SUPPORT_BUNDLE_DIR, name);
+    snprintf(part_path, sizeof(part_path), "%s%s", path,
+             SUPPORT_BUNDLE_PART_SUFFIX);
+    if (access(path, F_OK) == 0) {
+        vty_out(vty, "%s already exists, please give different name%s",
+                path, VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+    /* the archive only gets its final name once it is complete */
+    fd = open(part_path, O_CREAT | O_EXCL | O_WRONLY, S_IRUSR | S_IWUSR | S_IRGRP);
+    if (!VALID_FD_CHECK(fd)) {
+        strerror_r(errno, err_buf, sizeof(err_buf));
+        vty_out(vty, "failed to open file error:%s file:%s%s", err_buf,
+                part_path, VTY_NEWLINE);
+        return CMD_WARNING;
+    }
+    b.aw = archive_open(fd);
+    if (b.aw == NULL) {
+        vty_out(vty, "Support bundle init failed%s", VTY_NEWLINE);
+        close(fd);
+        unlink(part_path);
+        return CMD_WARNING;
+    }
+
+    gBundleUserInterrupt = 0;
+    executor_clear_interrupt();
+    memset(&oldSignalHandler, '\0', sizeof(oldSignalHandler));
+    memset(&newSignalHandler, '\0', sizeof(newSignalHandler));
+    memset(&oldZSignalHandler, '\0', sizeof(oldZSignalHandler));
+    memset(&newZSignalHandler, '\0', sizeof(newZSignalHandler));
+    newSignalHandler.sa_sigaction = bundle_signal_handler;
+    newSignalHandler.sa_flags = SA_SIGINFO;
+    newZSignalHandler.sa_sigaction = bundle_signal_handler;
+    newZSignalHandler.sa_flags = SA_SIGINFO;
+    if (sigaction(SIGINT, &newSignalHandler, &oldSignalHandler) != 0) {
+        VLOG_ERR("Failed to change signal handler");
+        vty_out(vty, "Support bundle init failed%s", VTY_NEWLINE);
+        archive_close(b.aw);
+        close(fd);
+        unlink(part_path);
+        return CMD_WARNING;
+    }
+    if (sigaction(SIGTSTP, &newZSignalHandler, &oldZSignalHandler) != 0) {
+        VLOG_ERR("Failed to change Ctrl Z handler");
+        vty_out(vty, "Support bundle init failed%s", VTY_NEWLINE);
+        if (sigaction(SIGINT, &oldSignalHandler, NULL) != 0) {
+            VLOG_ERR("Failed to change signal handler to old state");
+            exit(0); /* should never hit this place */
+        }
+        archive_close(b.aw);
+        close(fd);
+        unlink(part_path);
+        return CMD_WARNING;
+    }
+
+    time(&created);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    /* show tech first, its commands would otherwise queue up behind the
+     * diag dumps on the executor and time out there */
+    vty_out(vty, "Collecting show tech%s", VTY_NEWLINE);
+    output = bundle_capture_show_tech();
+    if (gUserInterrupt) {
+        /* show tech consumed the interrupt with its own handler */
+        gBundleUserInterrupt = 1;
+        executor_interrupt(0);
+    }
+    if (gBundleUserInterrupt
+        || bundle_add_buffer(&b, "showtech.txt", "show tech", output)) {
+        goto COLLECT_DIAG;
+    }
+    FREE(output);
+
+    /* daemons build their diag dumps while the CLI thread works below */
+    jobs = bundle_submit_diag(&n_jobs);
+
+    vty_out(vty, "Collecting event logs%s", VTY_NEWLINE);
+    output = bundle_capture_events();
+    if (gBundleUserInterrupt
+        || bundle_add_buffer(&b, "events.txt", "show events", output)) {
+        goto COLLECT_DIAG;
+    }
+    FREE(output);
+
+    if (cores != SUPPORT_BUNDLE_CORES_NONE) {
+        vty_out(vty, "Collecting core dumps%s", VTY_NEWLINE);
+        n_cores = bundle_add_cores(&b);
+    }
+
+COLLECT_DIAG:
+    FREE(output);
+    if (n_jobs && !b.broken && !gBundleUserInterrupt) {
+        vty_out(vty, "Collecting diagnostic dumps%s", VTY_NEWLINE);
+    }
+    bundle_collect_diag(&b, jobs, n_jobs);
+    FREE(jobs);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    if (!b.broken && !gBundleUserInterrupt) {
+        bundle_add_manifest(&b, name, created, secs);
+    }
+
+    if (archive_close(b.aw) != 0) {
+        b.broken = 1;
+    }
+    b.aw = NULL;
+    if (fsync(fd) < 0) {
+        b.broken = 1;
+    }
+    CLOSE(fd);
+
+    if (gBundleUserInterrupt) {
+        unlink(part_path);
+        vty_out(vty, "USER INTERRUPT:Support bundle terminated%s",
+                VTY_NEWLINE);
+        return_val = CMD_WARNING;
+    } else if (b.broken || rename(part_path, path) < 0) {
+        unlink(part_path);
+        vty_out(vty, "Support bundle creation failed, please check the free "
+                "space in %s%s", SUPPORT_BUNDLE_DIR, VTY_NEWLINE);
+        return_val = CMD_WARNING;
+    } else {
+        vty_out(vty, "Support bundle with %zu members (%d core dumps) stored "
+                "in %s%s", b.n_entries, n_cores, path, VTY_NEWLINE);
+        vty_out(vty, "Support bundle took %.1f seconds for collection%s",
+                secs, VTY_NEWLINE);
+    }
+
+    if (sigaction(SIGINT, &oldSignalHandler, NULL) != 0) {
+        VLOG_ERR("Failed to change signal handler to old state");
+        exit(0); /* should never hit this place */
+    }
+    if (sigaction(SIGTSTP, &oldZSignalHandler, NULL) != 0) {
+        VLOG_ERR("Failed to change ctrl-z signal handler to old state");
+        exit(0); /* should never hit this place */
+    }
+    free(b.entries);
+    return return_val;
+}
+
+/*
+* Action routines for support bundle
+*/
+DEFUN_NOLOCK (cli_platform_support_bundle_create,
+        cli_platform_support_bundle_create_cmd,
+        "support-bundle create [FILENAME]",
+        SUPPORT_BUNDLE_STR
+        SUPPORT_BUNDLE_CREATE_STR
+        SUPPORT_BUNDLE_FILE_STR)
+{
+    return cli_support_bundle_create((argc >= 1) ? argv[0] : NULL,
+                                     SUPPORT_BUNDLE_CORES_LATEST);
+}
+
+DEFUN_NOLOCK (cli_platform_support_bundle_create_cores,
+        cli_platform_support_bundle_create_cores_cmd,
+        "support-bundle create FILENAME core-dumps (latest|none)",
+        SUPPORT_BUNDLE_STR
+        SUPPORT_BUNDLE_CREATE_STR
+        SUPPORT_BUNDLE_FILE_STR
+        SUPPORT_BUNDLE_CORES_STR
+        SUPPORT_BUNDLE_LATEST_STR
+        SUPPORT_BUNDLE_NONE_STR)
+{
+    return cli_support_bundle_create(argv[0],
+            (strcmp(argv[1], "none") == 0) ? SUPPORT_BUNDLE_CORES_NONE
+                                           : SUPPORT_BUNDLE_CORES_LATEST);
+}
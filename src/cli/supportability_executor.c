@@ -0,0 +1,686 @@
+/* Supportability command executor
+ *
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: supportability_executor.c
+ *
+ * Purpose: Persistent worker pool with timer wheel deadlines, shared by the
+ *          show tech and diag-dump commands.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include "openvswitch/vlog.h"
+#include "supportability_executor.h"
+
+VLOG_DEFINE_THIS_MODULE(supportability_executor);
+
+enum task_state {
+    TASK_PENDING = 0,
+    TASK_RUNNING,
+    TASK_FINISHED
+};
+
+struct executor_task {
+    executor_task_fn fn;
+    int task_rc;
+    enum task_state state;
+    int cancelled;                       /* 0 or enum executor_status */
+    int expire_status;                   /* reported when deadline fires */
+    unsigned long long timeout_ticks;    /* deadline once running, 0 none */
+    unsigned long long deadline_tick;    /* 0 means no deadline */
+    pid_t pid;                           /* child killed on expiry, 0 none */
+    int abandoned;                       /* its worker left the pool */
+    int refcnt;                          /* submitter + worker */
+    void *result;                        /* malloc'ed, owned until claimed */
+    struct executor_task *queue_next;
+    struct executor_task *wheel_next;
+    struct executor_task *inflight_next;
+    char arg[];
+};
+
+static pthread_once_t executor_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t executor_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t queue_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t done_cond = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t timer_cond;
+
+/* run queue, protected by executor_mutex */
+static struct executor_task *queue_head = NULL;
+static struct executor_task *queue_tail = NULL;
+static int queue_len = 0;
+static int n_workers = 0;
+static int n_idle_workers = 0;
+static int n_stuck_workers = 0;
+static int timer_started = 0;
+
+/* timer wheel, protected by executor_mutex */
+static struct executor_task *wheel[EXECUTOR_WHEEL_SLOTS];
+static struct executor_task *inflight_head = NULL;
+static unsigned long long current_tick = 0;
+
+/* written from signal handlers, consumed by the timer thread */
+static volatile sig_atomic_t interrupt_pending = 0;
+static volatile sig_atomic_t interrupt_grace = 0;
+
+static void *executor_worker_thread(void *arg);
+static int executor_spawn(void *(*start)(void *));
+
+
+/* Function       : executor_now_tick
+ * Resposibility  : current monotonic time in timer wheel ticks
+ * Return         : tick count
+ */
+static unsigned long long
+executor_now_tick(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((unsigned long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000)
+           / EXECUTOR_TICK_MSEC;
+}
+
+/* Function       : executor_init
+ * Resposibility  : one time initialization of the timer condition variable
+ * Return         : void
+ */
+static void
+executor_init(void)
+{
+    pthread_condattr_t attr;
+
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&timer_cond, &attr);
+    pthread_condattr_destroy(&attr);
+    memset(wheel, 0, sizeof(wheel));
+}
+
+/* Function       : executor_task_unref
+ * Resposibility  : drop one reference, free the task on the last one.
+ *                  Caller holds executor_mutex.
+ * Return         : void
+ */
+static void
+executor_task_unref(struct executor_task *task)
+{
+    if (--task->refcnt == 0) {
+        free(task->result);
+        free(task);
+    }
+}
+
+/* Function       : executor_wheel_insert
+ * Resposibility  : hash the task into the slot of its deadline tick
+ * Return         : void
+ */
+static void
+executor_wheel_insert(struct executor_task *task)
+{
+    struct executor_task **slot;
+
+    slot = &wheel[task->deadline_tick % EXECUTOR_WHEEL_SLOTS];
+    task->wheel_next = *slot;
+    *slot = task;
+}
+
+/* Function       : executor_wheel_remove
+ * Resposibility  : unlink the task from its timer wheel slot, if any
+ * Return         : void
+ */
+static void
+executor_wheel_remove(struct executor_task *task)
+{
+    struct executor_task **pp;
+
+    if (!task->deadline_tick) {
+        return;
+    }
+    pp = &wheel[task->deadline_tick % EXECUTOR_WHEEL_SLOTS];
+    for (; *pp; pp = &(*pp)->wheel_next) {
+        if (*pp == task) {
+            *pp = task->wheel_next;
+            task->wheel_next = NULL;
+            return;
+        }
+    }
+}
+
+/* Function       : executor_inflight_remove
+ * Resposibility  : unlink the task from the in-flight list, if present
+ * Return         : void
+ */
+static void
+executor_inflight_remove(struct executor_task *task)
+{
+    struct executor_task **pp;
+
+    for (pp = &inflight_head; *pp; pp = &(*pp)->inflight_next) {
+        if (*pp == task) {
+            *pp = task->inflight_next;
+            task->inflight_next = NULL;
+            return;
+        }
+    }
+}
+
+/* Function       : executor_can_grow
+ * Resposibility  : whether another worker may be started. Workers stuck in
+ *                  abandoned tasks are bounded too, once they are all used
+ *                  up tasks can not be queued any more.
+ *                  Caller holds executor_mutex.
+ * Return         : 1 if a worker may be started, 0 otherwise
+ */
+static int
+executor_can_grow(void)
+{
+    return n_workers < EXECUTOR_MAX_WORKERS
+           && n_stuck_workers < EXECUTOR_MAX_STUCK_WORKERS;
+}
+
+/* Function       : executor_abandon
+ * Resposibility  : stop waiting for a running task. Its child, if any, is
+ *                  killed so that the task body returns. Its worker leaves
+ *                  the pool, and a replacement is started for the queued
+ *                  tasks, so that a task which never returns cannot hold
+ *                  the pool.
+ *                  Caller holds executor_mutex.
+ * Return         : void
+ */
+static void
+executor_abandon(struct executor_task *task)
+{
+    if (task->pid > 0) {
+        kill(-task->pid, SIGKILL);
+    }
+    task->abandoned = 1;
+    n_workers--;
+    n_stuck_workers++;
+    if (queue_len > n_idle_workers && executor_can_grow()) {
+        if (executor_spawn(executor_worker_thread) == 0) {
+            n_workers++;
+        }
+    }
+}
+
+/* Function       : executor_expire
+ * Resposibility  : raise the cancellation token and wake the submitter
+ * Return         : void
+ */
+static void
+executor_expire(struct executor_task *task, int status)
+{
+    executor_wheel_remove(task);
+    executor_inflight_remove(task);
+    __atomic_store_n(&task->cancelled, status, __ATOMIC_RELEASE);
+    if (task->state == TASK_RUNNING) {
+        executor_abandon(task);
+    }
+    pthread_cond_broadcast(&done_cond);
+}
+
+/* Function       : executor_process_slot
+ * Resposibility  : expire every task of a slot whose deadline has passed
+ * Return         : void
+ */
+static void
+executor_process_slot(unsigned int slot, unsigned long long now)
+{
+    struct executor_task *task = wheel[slot];
+    struct executor_task *next = NULL;
+
+    for (; task; task = next) {
+        next = task->wheel_next;
+        if (task->deadline_tick <= now) {
+            executor_expire(task, task->expire_status);
+        }
+    }
+}
+
+/* Function       : executor_process_interrupt
+ * Resposibility  : pull the deadline of every in-flight task in to the
+ *                  interrupt grace period
+ * Return         : void
+ */
+static void
+executor_process_interrupt(unsigned long long now)
+{
+    struct executor_task *task = inflight_head;
+    struct executor_task *next = NULL;
+    unsigned long long deadline;
+
+    deadline = now + ((unsigned long long)interrupt_grace * 1000)
+                     / EXECUTOR_TICK_MSEC;
+    for (; task; task = next) {
+        next = task->inflight_next;
+        if (task->deadline_tick && task->deadline_tick <= deadline) {
+            /* it will time out before the grace period ends anyway */
+            continue;
+        }
+        executor_wheel_remove(task);
+        task->deadline_tick = deadline;
+        task->expire_status = EXECUTOR_TASK_INTERRUPTED;
+        if (deadline <= current_tick) {
+            executor_expire(task, EXECUTOR_TASK_INTERRUPTED);
+        } else {
+            executor_wheel_insert(task);
+        }
+    }
+}
+
+/* Function       : executor_timer_thread
+ * Resposibility  : advance the timer wheel one tick at a time while tasks
+ *                  are in flight, sleep otherwise
+ * Return         : NULL
+ */
+static void *
+executor_timer_thread(void *arg)
+{
+    struct timespec ts;
+    unsigned long long now;
+    unsigned int slot;
+
+    pthread_mutex_lock(&executor_mutex);
+    for (;;) {
+        if (inflight_head == NULL) {
+            pthread_cond_wait(&timer_cond, &executor_mutex);
+            continue;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        ts.tv_nsec += EXECUTOR_TICK_MSEC * 1000000L;
+        if (ts.tv_nsec >= 1000000000L) {
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000L;
+        }
+        pthread_cond_timedwait(&timer_cond, &executor_mutex, &ts);
+
+        now = executor_now_tick();
+        if (now - current_tick >= EXECUTOR_WHEEL_SLOTS) {
+            /* fell behind by a full revolution, sweep every slot once */
+            for (slot = 0; slot < EXECUTOR_WHEEL_SLOTS; slot++) {
+                executor_process_slot(slot, now);
+            }
+            current_tick = now;
+        }
+        while (current_tick < now) {
+            current_tick++;
+            executor_process_slot(current_tick % EXECUTOR_WHEEL_SLOTS, now);
+        }
+        if (interrupt_pending) {
+            interrupt_pending = 0;
+            executor_process_interrupt(now);
+        }
+    }
+    pthread_mutex_unlock(&executor_mutex);
+    return NULL;
+}
+
+/* Function       : executor_start_deadline
+ * Resposibility  : start the deadline of a task as a worker picks it up,
+ *                  so that the time spent in the queue does not count. An
+ *                  interrupt deadline set while queued is kept if earlier.
+ *                  Caller holds executor_mutex.
+ * Return         : void
+ */
+static void
+executor_start_deadline(struct executor_task *task)
+{
+    unsigned long long deadline;
+
+    if (!task->timeout_ticks) {
+        return;
+    }
+    deadline = executor_now_tick() + task->timeout_ticks;
+    if (deadline <= current_tick) {
+        deadline = current_tick + 1;
+    }
+    if (task->deadline_tick && task->deadline_tick <= deadline) {
+        return;
+    }
+    executor_wheel_remove(task);
+    task->deadline_tick = deadline;
+    task->expire_status = EXECUTOR_TASK_TIMEDOUT;
+    executor_wheel_insert(task);
+}
+
+/* Function       : executor_worker_thread
+ * Resposibility  : persistent worker, runs queued tasks until process exit
+ *                  or until it returns from a task it was abandoned on
+ * Return         : NULL
+ */
+static void *
+executor_worker_thread(void *arg)
+{
+    struct executor_task *task = NULL;
+    int rc = 0;
+
+    pthread_mutex_lock(&executor_mutex);
+    for (;;) {
+        n_idle_workers++;
+        while (queue_head == NULL) {
+            pthread_cond_wait(&queue_cond, &executor_mutex);
+        }
+        n_idle_workers--;
+        task = queue_head;
+        queue_head = task->queue_next;
+        if (queue_head == NULL) {
+            queue_tail = NULL;
+        }
+        queue_len--;
+
+        /* submitter already gave up on it, don't even start */
+        if (__atomic_load_n(&task->cancelled, __ATOMIC_ACQUIRE)) {
+            executor_task_unref(task);
+            continue;
+        }
+        executor_start_deadline(task);
+        task->state = TASK_RUNNING;
+        pthread_mutex_unlock(&executor_mutex);
+
+        rc = task->fn(task->arg, task);
+
+        pthread_mutex_lock(&executor_mutex);
+        task->task_rc = rc;
+        task->state = TASK_FINISHED;
+        executor_wheel_remove(task);
+        executor_inflight_remove(task);
+        pthread_cond_broadcast(&done_cond);
+        if (task->abandoned) {
+            /* a replacement took its place, rejoin only if there is room */
+            n_stuck_workers--;
+            executor_task_unref(task);
+            if (n_workers >= EXECUTOR_MAX_WORKERS) {
+                break;
+            }
+            n_workers++;
+            continue;
+        }
+        executor_task_unref(task);
+    }
+    pthread_mutex_unlock(&executor_mutex);
+    return NULL;
+}
+
+/* Function       : executor_spawn
+ * Resposibility  : create a detached executor thread with every signal
+ *                  blocked, so that the CLI signal handlers always run on
+ *                  the vtysh thread
+ * Return         : 0 on success and nonzero on failure
+ */
+static int
+executor_spawn(void *(*start)(void *))
+{
+    pthread_t tid;
+    pthread_attr_t attr;
+    sigset_t all, old;
+    int rc = 0;
+
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    rc = pthread_create(&tid, &attr, start, NULL);
+    pthread_attr_destroy(&attr);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (rc) {
+        VLOG_ERR("executor: unable to create thread, rc=%d", rc);
+    }
+    return rc;
+}
+
+/*
+ * Function       : executor_submit
+ * Responsibility : queue a task on the worker pool without waiting for it
+ * Parameters
+ *                : fn - task body
+ *                : arg, arg_len - argument, copied in to the task
+ *                : timeout_secs - deadline, 0 for none
+ *
+ * Returns        : task handle to pass to executor_wait, NULL on failure
+ */
+struct executor_task *
+executor_submit(executor_task_fn fn, const void *arg, size_t arg_len,
+                unsigned int timeout_secs)
+{
+    struct executor_task *task = NULL;
+
+    if (fn == NULL) {
+        return NULL;
+    }
+    pthread_once(&executor_once, executor_init);
+
+    task = calloc(1, sizeof(*task) + arg_len);
+    if (task == NULL) {
+        VLOG_ERR("executor: memory allocation failed");
+        return NULL;
+    }
+    task->fn = fn;
+    task->state = TASK_PENDING;
+    task->expire_status = EXECUTOR_TASK_TIMEDOUT;
+    task->refcnt = 2;
+    if (arg && arg_len) {
+        memcpy(task->arg, arg, arg_len);
+    }
+
+    pthread_mutex_lock(&executor_mutex);
+    if (!timer_started) {
+        if (executor_spawn(executor_timer_thread)) {
+            pthread_mutex_unlock(&executor_mutex);
+            free(task);
+            return NULL;
+        }
+        timer_started = 1;
+    }
+    if (n_idle_workers <= queue_len && executor_can_grow()) {
+        if (executor_spawn(executor_worker_thread) == 0) {
+            n_workers++;
+        }
+    }
+    if (n_workers == 0) {
+        pthread_mutex_unlock(&executor_mutex);
+        free(task);
+        return NULL;
+    }
+
+    if (inflight_head == NULL) {
+        /* wheel was idle, resynchronize it with the clock */
+        current_tick = executor_now_tick();
+    }
+    task->inflight_next = inflight_head;
+    inflight_head = task;
+    /* the deadline only starts once a worker picks the task up */
+    task->timeout_ticks = ((unsigned long long)timeout_secs * 1000)
+                          / EXECUTOR_TICK_MSEC;
+    pthread_cond_signal(&timer_cond);
+
+    if (queue_tail) {
+        queue_tail->queue_next = task;
+    } else {
+        queue_head = task;
+    }
+    queue_tail = task;
+    queue_len++;
+    pthread_cond_signal(&queue_cond);
+    pthread_mutex_unlock(&executor_mutex);
+    return task;
+}
+
+/*
+ * Function       : executor_wait_result
+ * Responsibility : wait for a submitted task to complete, time out or be
+ *                  interrupted, and release the submitter's handle
+ * Parameters
+ *                : task - handle returned by executor_submit
+ *                : task_rc - return value of the task body on completion
+ *                : result - result set by the task body on completion,
+ *                           the caller frees it. NULL to discard it.
+ *
+ * Returns        : enum executor_status
+ */
+enum executor_status
+executor_wait_result(struct executor_task *task, int *task_rc, void **result)
+{
+    enum executor_status status = EXECUTOR_TASK_ERROR;
+
+    if (task == NULL) {
+        return EXECUTOR_TASK_ERROR;
+    }
+    pthread_mutex_lock(&executor_mutex);
+    while (task->state != TASK_FINISHED &&
+           !__atomic_load_n(&task->cancelled, __ATOMIC_ACQUIRE)) {
+        pthread_cond_wait(&done_cond, &executor_mutex);
+    }
+
+    if (task->state == TASK_FINISHED) {
+        status = EXECUTOR_TASK_DONE;
+        if (task_rc) {
+            *task_rc = task->task_rc;
+        }
+        if (result) {
+            *result = task->result;
+            task->result = NULL;
+        }
+    } else {
+        status = task->cancelled;
+        if (task->state == TASK_RUNNING) {
+            VLOG_ERR("executor: abandoned a running task, status=%d", status);
+        }
+    }
+    executor_task_unref(task);
+    pthread_mutex_unlock(&executor_mutex);
+    return status;
+}
+
+/*
+ * Function       : executor_wait
+ * Responsibility : executor_wait_result without a result
+ * Returns        : enum executor_status
+ */
+enum executor_status
+executor_wait(struct executor_task *task, int *task_rc)
+{
+    return executor_wait_result(task, task_rc, NULL);
+}
+
+/*
+ * Function       : executor_run_task
+ * Responsibility : queue a task on the worker pool and wait for it to
+ *                  complete, time out or be interrupted
+ * Parameters
+ *                : fn - task body
+ *                : arg, arg_len - argument, copied in to the task
+ *                : timeout_secs - deadline, 0 for none
+ *                : task_rc - return value of fn on completion
+ *
+ * Returns        : enum executor_status
+ */
+enum executor_status
+executor_run_task(executor_task_fn fn, const void *arg, size_t arg_len,
+                  unsigned int timeout_secs, int *task_rc)
+{
+    struct executor_task *task = NULL;
+
+    task = executor_submit(fn, arg, arg_len, timeout_secs);
+    if (task == NULL) {
+        return EXECUTOR_TASK_ERROR;
+    }
+    return executor_wait(task, task_rc);
+}
+
+/* Function       : executor_task_cancelled
+ * Resposibility  : cancellation token check for task bodies
+ * Return         : true once the submitter stopped waiting for the task
+ */
+bool
+executor_task_cancelled(const struct executor_task *task)
+{
+    if (task == NULL) {
+        return false;
+    }
+    return __atomic_load_n(&task->cancelled, __ATOMIC_ACQUIRE) != 0;
+}
+
+/* Function       : executor_task_set_result
+ * Resposibility  : hand a malloc'ed result over to the submitter. It is
+ *                  freed with the task when nobody waits for it any more.
+ * Return         : void
+ */
+void
+executor_task_set_result(const struct executor_task *task, void *result)
+{
+    struct executor_task *t = (struct executor_task *)task;
+
+    if (t == NULL) {
+        free(result);
+        return;
+    }
+    pthread_mutex_lock(&executor_mutex);
+    free(t->result);
+    t->result = result;
+    pthread_mutex_unlock(&executor_mutex);
+}
+
+/* Function       : executor_task_set_pid
+ * Resposibility  : register the child process running the task, which
+ *                  leads a process group of its own. The group is killed
+ *                  if the task is abandoned. 0 unregisters it, which the
+ *                  task body does before it reaps the child.
+ * Return         : void
+ */
+void
+executor_task_set_pid(const struct executor_task *task, pid_t pid)
+{
+    struct executor_task *t = (struct executor_task *)task;
+
+    if (t == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&executor_mutex);
+    t->pid = pid;
+    if (pid > 0 && __atomic_load_n(&t->cancelled, __ATOMIC_ACQUIRE)) {
+        /* abandoned before the child was registered */
+        kill(-pid, SIGKILL);
+    }
+    pthread_mutex_unlock(&executor_mutex);
+}
+
+/* Function       : executor_interrupt
+ * Resposibility  : single interrupt path for the CLI signal handlers. Only
+ *                  records the request, the timer thread applies it on the
+ *                  next tick.
+ * Return         : void
+ */
+void
+executor_interrupt(unsigned int grace_secs)
+{
+    interrupt_grace = grace_secs;
+    interrupt_pending = 1;
+}
+
+/* Function       : executor_clear_interrupt
+ * Resposibility  : discard an interrupt which was not consumed yet
+ * Return         : void
+ */
+void
+executor_clear_interrupt(void)
+{
+    interrupt_pending = 0;
+}
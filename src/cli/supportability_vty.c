@@ -33,78 +33,18 @@
 #include "show_tech_vty.h"
 #include "diag_dump_vty.h"
 #include <sys/types.h>
-#include <dirent.h>
 #include "openvswitch/vlog.h"
 #include "show_vlog_vty.h"
 #include "supportability_utils.h"
 #include "vtysh_ovsdb_syslog_context.h"
 #include "vtysh/vtysh_ovsdb_config.h"
 #include "feature_mapping.h"
+#include "config_watch.h"
+#include <time.h>
 
 VLOG_DEFINE_THIS_MODULE (vtysh_supportability_cli);
 
 
-/*
- * Function           : install_show_vlog
- * Responsibility     : Install the show vlog command
- */
-int
-install_show_vlog()
-{
-    DIR * fd;
-    struct dirent *fd1;
-    char str[MAX_FILENAME_SIZE] = {0,};
-    char *ptr = NULL, *cmd = NULL;
-    int install = 0;
-    fd = opendir(PID_DIRECTORY);
-    if(fd == NULL) {
-        VLOG_ERR("Directory open failure");
-        return 1;
-    }
-    cmd = (char*)calloc(MAX_DAEMONS, MAX_FEATURE_NAME_SIZE);
-    if(cmd == NULL) {
-        VLOG_ERR("Memory allocation failure");
-        closedir(fd);
-        return 1;
-    }
-    strncpy(cmd, VLOG_CMD, (MAX_VLOG_CMD-1));
-    fd1 = readdir(fd);
-    if(fd1 == NULL) {
-        VLOG_ERR("Directory read failure");
-        free(cmd);
-        closedir(fd);
-        return 1;
-    }
-    while(fd1)
-    {
-        strncpy(str, fd1->d_name, (MAX_FILENAME_SIZE-1));
-        if(strstr(fd1->d_name, "ops"))
-        {
-            if(strstr(fd1->d_name, ".pid"))
-            {
-                strncpy(str, fd1->d_name, (MAX_FILENAME_SIZE-1));
-                STR_SAFE(str);
-                ptr = strtok(str, ".");
-                strncat(cmd, ptr, ((MAX_VLOG_CMD - strlen(cmd)) - 1));
-                strncat(cmd, "|", ((MAX_VLOG_CMD - strlen(cmd)) - 1));
-                install = 1;
-            }
-        }
-        fd1 = readdir(fd);
-    }
-    if(!install) {
-       VLOG_ERR("Unable to read daemon list for VLOG");
-       free(cmd);
-       closedir(fd);
-       return 1;
-    }
-    strncat(cmd, ")}", ((MAX_VLOG_CMD - strlen(cmd)) - 1));
-    cli_platform_show_vlog_cmd.string = cmd;
-    install_element (ENABLE_NODE, &cli_platform_show_vlog_cmd);
-    closedir(fd);
-    return 0;
-}
-
 /*
  * Function           : install_diag_dump
  * Responsibility     : Install the diag dump command
@@ -379,6 +319,62 @@ install_show_evnts()
     return 0;
 }
 
+/*
+ * Function           : cli_show_supportability_config
+ * Responsibility     : Display the generation of each configuration file,
+ *                      after reloading the files changed on disk
+ * Returns            : CMD_SUCCESS
+ */
+static int
+cli_show_supportability_config(struct vty *vty)
+{
+    struct config_watch *w = NULL;
+    struct tm tm;
+    char loaded[32] = {0};
+
+    /* a changed file is only parsed again on its next use */
+    get_feature_mapping();
+    cli_show_tech_reload();
+
+    vty_out(vty,"%-18s %-10s %-20s %s%s","Configuration","Generation",
+            "Loaded","Status",VTY_NEWLINE);
+    vty_out(vty,"%s%s",
+            "-----------------------------------------------------------------",
+            VTY_NEWLINE);
+    for (w = config_watch_next(NULL); w; w = config_watch_next(w))
+    {
+        strncpy(loaded,"-",sizeof(loaded));
+        if (w->generation && localtime_r(&w->loaded,&tm))
+        {
+            strftime(loaded,sizeof(loaded),"%Y-%m-%d %H:%M:%S",&tm);
+        }
+        if (w->failures)
+        {
+            vty_out(vty,"%-18s %-10u %-20s Invalid, %u failed loads%s",
+                    w->name,w->generation,loaded,w->failures,VTY_NEWLINE);
+        }
+        else
+        {
+            vty_out(vty,"%-18s %-10u %-20s OK%s",w->name,w->generation,
+                    loaded,VTY_NEWLINE);
+        }
+    }
+    return CMD_SUCCESS;
+}
+
+/*
+* Action routines for Show Supportability Configuration
+*/
+DEFUN_NOLOCK (cli_platform_show_supportability_config,
+  cli_platform_show_supportability_config_cmd,
+  "show supportability configuration",
+  SHOW_STR
+  SUPPORTABILITY_STR
+  SUPPORTABILITY_CONFIG_STR)
+  {
+    return cli_show_supportability_config(vty);
+  }
+
 /*
  * Function           : cli_pre_init
  * Responsibility     : Install the cli nodes
@@ -416,12 +412,17 @@ cli_post_init()
       VLOG_ERR("diag-dump command installation with CLI expand failed");
       return;
   }
-  if(install_show_vlog()) {
-      VLOG_ERR("show vlog command installation with CLI expand failed");
-      return;
-  }
+  /* daemon names are checked against the running daemons when used */
+  install_element (ENABLE_NODE, &cli_platform_show_vlog_cmd);
   install_element (ENABLE_NODE, &cli_platform_show_tech_list_cmd);
+  install_element (ENABLE_NODE, &cli_platform_show_tech_diff_cmd);
+  install_element (ENABLE_NODE, &cli_platform_support_bundle_create_cmd);
+  install_element (ENABLE_NODE, &cli_platform_support_bundle_create_cores_cmd);
   install_element (ENABLE_NODE, &cli_platform_show_core_dump_cmd);
+  install_element (ENABLE_NODE, &cli_platform_show_core_dump_detail_cmd);
+  install_element (ENABLE_NODE, &cli_platform_monitor_core_dump_cmd);
+  install_element (ENABLE_NODE, &no_cli_platform_monitor_core_dump_cmd);
+  install_element (ENABLE_NODE, &cli_platform_show_supportability_config_cmd);
 
   install_element (ENABLE_NODE, &vtysh_diag_dump_list_cmd);
   install_element (ENABLE_NODE, &cli_platform_show_vlog_config_cmd);
@@ -429,7 +430,11 @@ cli_post_init()
   install_element (ENABLE_NODE, &cli_platform_show_vlog_feature_cmd);
   install_element (ENABLE_NODE, &cli_platform_show_vlog_daemon_cmd);
   install_element (CONFIG_NODE, &cli_config_vlog_daemon_set_cmd);
+  install_element (CONFIG_NODE, &cli_config_vlog_daemon_set_duration_cmd);
   install_element (CONFIG_NODE, &cli_config_vlog_feature_set_cmd);
+  install_element (CONFIG_NODE, &cli_config_vlog_feature_set_duration_cmd);
+  install_element (CONFIG_NODE, &cli_config_vlog_features_set_cmd);
+  install_element (CONFIG_NODE, &cli_config_vlog_features_set_duration_cmd);
   install_element (CONFIG_NODE, &vtysh_config_syslog_basic_cmd);
   install_element (CONFIG_NODE, &vtysh_config_syslog_udp_cmd);
   install_element (CONFIG_NODE, &vtysh_config_syslog_tcp_cmd);
@@ -461,6 +466,10 @@ cli_post_init()
   install_element (ENABLE_NODE, &cli_platform_copy_core_dump_sftp_cmd);
   install_element (ENABLE_NODE, &cli_platform_copy_core_dump_kernel_tftp_cmd);
   install_element (ENABLE_NODE, &cli_platform_copy_core_dump_kernel_sftp_cmd);
+  install_element (ENABLE_NODE,
+          &cli_platform_copy_core_dump_kernel_zstd_tftp_cmd);
+  install_element (ENABLE_NODE,
+          &cli_platform_copy_core_dump_kernel_zstd_sftp_cmd);
   install_element (ENABLE_NODE, &cli_platform_copy_core_dump_tftp_cmd_inst);
   install_element (ENABLE_NODE, &cli_platform_copy_core_dump_sftp_cmd_inst);
 
@@ -477,6 +486,9 @@ cli_post_init()
   install_element (CONFIG_NODE, &debug_ospf_event_cmd);
   install_element (CONFIG_NODE, &debug_ospf_nssa_cmd);
   install_element (CONFIG_NODE, &debug_ospf_intf_redst_cmd);
+  install_element (CONFIG_NODE, &debug_ospf_profile_cmd);
+  install_element (CONFIG_NODE, &debug_ospf_capture_ring_cmd);
+  install_element (CONFIG_NODE, &debug_ospf_capture_ring_size_cmd);
 
   install_element (CONFIG_NODE, &no_debug_ospf_packet_send_recv_detail_cmd);
   install_element (CONFIG_NODE, &no_debug_ospf_packet_send_recv_cmd);
@@ -490,4 +502,8 @@ cli_post_init()
   install_element (CONFIG_NODE, &no_debug_ospf_event_cmd);
   install_element (CONFIG_NODE, &no_debug_ospf_nssa_cmd);
   install_element (CONFIG_NODE, &no_debug_ospf_intf_redst_cmd);
+  install_element (CONFIG_NODE, &no_debug_ospf_profile_cmd);
+  install_element (CONFIG_NODE, &no_debug_ospf_capture_cmd);
+  install_element (ENABLE_NODE, &show_debugging_ospf_capture_cmd);
+  install_element (ENABLE_NODE, &clear_debugging_ospf_capture_cmd);
 }
@@ -35,6 +35,8 @@
 #include "vtysh/memory.h"
 #include "openvswitch/vlog.h"
 #include "dynamic-string.h"
+#include "hash.h"
+#include "hmap.h"
 #include "vtysh/buffer.h"
 #include <errno.h>
 #include <unistd.h>
@@ -71,6 +73,87 @@ VLOG_ERR(OVSDB_TXN_CREATE_ERROR)
 #define DO_NO_LOGGING               0
 
 
+/* Syslog_Remote row indexed by its remote host, with the transport, port
+ * number and severity the row defaults to */
+struct syslog_remote_node
+{
+    struct hmap_node hmap_node;     /* In syslog_remote_index */
+    const struct ovsrec_syslog_remote *row;
+    int transport;                  /* UDP or TCP_TRANS_PROTOCOL */
+    int64_t port_number;
+    const char *severity;
+};
+
+/* The rows are indexed again when the IDL seqno changed, the IDL does not
+ * free a row before that */
+static struct hmap syslog_remote_index =
+    HMAP_INITIALIZER(&syslog_remote_index);
+static unsigned int syslog_remote_index_seqno = 0;
+static int syslog_remote_index_built = 0;
+
+/* Function          :  syslog_remote_index_refresh
+ * Responsibility    :  Index the Syslog_Remote rows by remote host, if the
+ *                      IDL changed since they were
+ * Returns           :  void
+ */
+static void
+syslog_remote_index_refresh(void)
+{
+    const struct ovsrec_syslog_remote *row = NULL;
+    struct syslog_remote_node *node = NULL;
+    struct syslog_remote_node *next = NULL;
+    unsigned int seqno = ovsdb_idl_get_seqno(idl);
+
+    if(syslog_remote_index_built && seqno == syslog_remote_index_seqno)
+    {
+        return;
+    }
+
+    HMAP_FOR_EACH_SAFE(node, next, hmap_node, &syslog_remote_index)
+    {
+        hmap_remove(&syslog_remote_index, &node->hmap_node);
+        free(node);
+    }
+
+    OVSREC_SYSLOG_REMOTE_FOR_EACH(row,idl)
+    {
+        if(row->remote_host == NULL)
+        {
+            continue;
+        }
+        node = xmalloc(sizeof *node);
+        node->row = row;
+
+        /* Default is UDP, port 514 for UDP and 1470 for TCP, severity info */
+        if((row->transport == NULL) || !strcmp(row->transport,"udp"))
+        {
+            node->transport = UDP_TRANS_PROTOCOL;
+        }
+        else
+        {
+            node->transport = TCP_TRANS_PROTOCOL;
+        }
+        if(row->port_number != NULL)
+        {
+            node->port_number = *row->port_number;
+        }
+        else if(node->transport == UDP_TRANS_PROTOCOL)
+        {
+            node->port_number = DEFAULT_UDP_PORT;
+        }
+        else
+        {
+            node->port_number = DEFAULT_TCP_PORT;
+        }
+        node->severity = (row->severity != NULL) ? row->severity : "info";
+
+        hmap_insert(&syslog_remote_index, &node->hmap_node,
+                hash_string(row->remote_host, 0));
+    }
+    syslog_remote_index_seqno = seqno;
+    syslog_remote_index_built = 1;
+}
+
 /* Function          :  syslog_remote_get_config
  * Responsibility    :  Find if similar configuration exist in the OVSDB
  * Returns           :  row if similar configuration exist otherwise NULL
@@ -92,6 +175,10 @@ VLOG_ERR(OVSDB_TXN_CREATE_ERROR)
    Usecase :  Used by add configuration to check if the same
    configuration already exists
    Condition : host_only_match is false, exact_match is true
+
+The rows are looked up by remote host in syslog_remote_index, the
+transport, port number and severity are compared to the defaults of the
+row when it has none.
 */
 const struct ovsrec_syslog_remote*
 syslog_remote_get_config(const char* remote_host,
@@ -101,23 +188,26 @@ syslog_remote_get_config(const char* remote_host,
               int host_only_match,
               int exact_match)
 {
+    struct syslog_remote_node *node = NULL;
+    int transport_protocol = UDP_TRANS_PROTOCOL;
 
-    const struct ovsrec_syslog_remote *row= NULL;
-    const struct ovsrec_syslog_remote *next= NULL;
-    int curr_transport = UDP_TRANS_PROTOCOL;
+    if(remote_host == NULL)
+    {
+        return NULL;
+    }
 
-    /* Browse through each record present in the OVSDB */
-    OVSREC_SYSLOG_REMOTE_FOR_EACH_SAFE(row,next,idl)
+    if(transport != NULL && strcmp(transport,"udp"))
     {
-        /* Current Transport variable is used to determine the default port
-        number, since we use 514 as default for UDP and 1470 as default for
-        tcp, we need to know the transport currently used in this record */
-        curr_transport = 0;
+        transport_protocol = TCP_TRANS_PROTOCOL;
+    }
 
+    syslog_remote_index_refresh();
+    HMAP_FOR_EACH_WITH_HASH(node, hmap_node, hash_string(remote_host, 0),
+            &syslog_remote_index)
+    {
         /* Compare Host name */
         /* This is common for both use case 1 and 2 */
-        if((row != NULL )
-                && (strcmp_with_nullcheck(row->remote_host,remote_host)))
+        if(strcmp(node->row->remote_host,remote_host))
         {
             continue;
         }
@@ -126,132 +216,60 @@ syslog_remote_get_config(const char* remote_host,
         if(!host_only_match)
         {
             /* Compare Transport */
-            /* If the user has provided input then perform comparision */
-            if(transport != NULL)
-            {
-                if( (row != NULL) && (row->transport != NULL))
-                {
-                    if(strcmp_with_nullcheck(row->transport,transport))
-                    {
-                        continue;
-                    }
-                }
-                else
-                {
-                    /* Default is UDP, hence compare against it */
-                    if(strcmp_with_nullcheck("udp",transport))
-                    {
-                        continue;
-                    }
-                }
-            }
-            else if (exact_match)
-            {
-               /* We need to find the exact row which matches the given input */
-               /* For eg., consider the following row in OVSDB
-                  logging 10.0.0.2 tcp 559
-                  and in query if only remote_host is given, we should not match
-                  since the default is udp where as the record in OVSDB is tcp */
-                if( (row != NULL) && row->transport != NULL)
-                {
-                    if(strcmp_with_nullcheck(row->transport,"udp"))
-                    {
-                        continue;
-                    }
-                }
-
-            }
-
-            /* Set whether the transport protocol is udp or tcp
-             * It is sufficient to check just row->transport for protocol,
-             * since we would reach this point only if both matches. */
-            if( (row != NULL) && ( (row->transport == NULL) ||
-                    !strcmp_with_nullcheck(row->transport,"udp")) )
-            {
-                curr_transport = UDP_TRANS_PROTOCOL;
-            }
-            else
+            /* If the user has not provided it, we need to find the exact
+               row which matches the given input, the default udp.
+               For eg., consider the following row in OVSDB
+               logging 10.0.0.2 tcp 559
+               and in query if only remote_host is given, we should not match
+               since the default is udp where as the record in OVSDB is tcp */
+            if((transport != NULL || exact_match)
+                    && node->transport != transport_protocol)
             {
-                curr_transport = TCP_TRANS_PROTOCOL;
+                continue;
             }
 
-
             /* Compare Port_Number*/
-            /* If the user has provided port number, then compare */
+            /* If the user has provided port number, then compare, else
+               an exact match has the default port of the transport */
             if(port_number != NULL)
             {
-                if( (row != NULL) && row->port_number == NULL)
+                if(node->port_number != *port_number)
                 {
-                    if(curr_transport ==UDP_TRANS_PROTOCOL &&
-                            *port_number != DEFAULT_UDP_PORT)
-                    {
-                        continue;
-                    }
-                    else if(curr_transport == TCP_TRANS_PROTOCOL &&
-                            *port_number != DEFAULT_TCP_PORT)
-                    {
-                        continue;
-                    }
-                }
-                else
-                {
-                    if( (row != NULL) && (next != NULL) &&
-                            ((*row->port_number) != *port_number))
-                    {
-                        continue;
-                    }
+                    continue;
                 }
             }
-            else if (exact_match)
+            else if(exact_match)
             {
-                if( (row !=NULL) && row->port_number != NULL)
+                if(node->transport == UDP_TRANS_PROTOCOL &&
+                        node->port_number != DEFAULT_UDP_PORT)
+                {
+                    continue;
+                }
+                else if(node->transport == TCP_TRANS_PROTOCOL &&
+                        node->port_number != DEFAULT_TCP_PORT)
                 {
-                    if(curr_transport ==UDP_TRANS_PROTOCOL &&
-                            *(row->port_number) != DEFAULT_UDP_PORT)
-                    {
-                        continue;
-                    }
-                    else if(curr_transport == TCP_TRANS_PROTOCOL &&
-                            *(row->port_number) != DEFAULT_TCP_PORT)
-                    {
-                        continue;
-                    }
+                    continue;
                 }
             }
-            /* If both of them are NULL, then they match  */
 
-
-            /* Compare severity only if provided by user */
+            /* Compare severity only if provided by user, an exact match
+               has the default severity otherwise */
             if(severity != NULL)
             {
-                if( (row !=NULL) && row->severity != NULL)
-                {
-                    if(strcmp(row->severity,severity))
-                    {
-                        continue;
-                    }
-                }
-                else
+                if(strcmp(node->severity,severity))
                 {
-                    /* Compare with default severity */
-                    if(strcmp_with_nullcheck("info",severity))
-                    {
-                        continue;
-                    }
+                    continue;
                 }
             }
-            else if (exact_match)
+            else if(exact_match)
             {
-                if( (row !=NULL) && row->severity != NULL)
+                if(strcmp(node->severity,"info"))
                 {
-                    if(strcmp_with_nullcheck(row->severity,"info"))
-                    {
-                        continue;
-                    }
+                    continue;
                 }
             }
         }
-        return row;
+        return node->row;
     }
     return NULL;
 }
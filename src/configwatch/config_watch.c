@@ -0,0 +1,233 @@
+/*
+ Copyright (C) 2016 Hewlett-Packard Development Company, L.P.
+ All Rights Reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License"); you may
+    not use this file except in compliance with the License. You may obtain
+    a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+    License for the specific language governing permissions and limitations
+    under the License.
+*/
+
+/*************************************************************************//**
+ * @ingroup ops_supportability
+ * This module watches CONFIG_WATCH_DIR with inotify for the configuration
+ * files of supportability, the event definitions, the show tech
+ * configuration and the feature mapping.
+ *
+ * There is no thread, the inotify fd is read by config_watch_changed() at
+ * most once per CONFIG_WATCH_INTERVAL, which costs a read of the coarse
+ * clock otherwise, so that it can be called on every use of a compiled
+ * configuration, log_event() included. A change only marks the file, its
+ * owner parses it again on its next use.
+ *
+ * @file
+ * Source file for the configuration watch of supportability library.
+ *
+ ****************************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include "config_watch.h"
+#include "openvswitch/vlog.h"
+
+VLOG_DEFINE_THIS_MODULE(config_watch);
+
+#define CONFIG_WATCH_EVENTS      (IN_CLOSE_WRITE | IN_MOVED_TO)
+
+static pthread_mutex_t watch_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct config_watch *watches = NULL;
+static int watch_fd = -1;
+static int watch_wd = -1;
+static time_t last_poll = 0;
+
+/* config_watch_file
+ * Name of the watched file in CONFIG_WATCH_DIR.
+ *
+ * Returns the name, NULL if the file is not in CONFIG_WATCH_DIR.
+ */
+static const char *
+config_watch_file(const struct config_watch *w)
+{
+    size_t len = strlen(CONFIG_WATCH_DIR);
+
+    if(strncmp(w->path, CONFIG_WATCH_DIR, len) || w->path[len] != '/') {
+        return NULL;
+    }
+    return w->path + len + 1;
+}
+
+/* config_watch_add
+ * Watches CONFIG_WATCH_DIR, again after it was removed. Called with
+ * watch_mutex held.
+ */
+static void
+config_watch_add(void)
+{
+    if(watch_fd < 0) {
+        watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if(watch_fd < 0) {
+            VLOG_ERR("Failed to create inotify fd, configuration changes "
+                     "need a restart: %s", strerror(errno));
+            return;
+        }
+    }
+    if(watch_wd < 0) {
+        watch_wd = inotify_add_watch(watch_fd, CONFIG_WATCH_DIR,
+                                     CONFIG_WATCH_EVENTS | IN_ONLYDIR);
+        if(watch_wd < 0) {
+            VLOG_DBG("Failed to watch %s: %s", CONFIG_WATCH_DIR,
+                     strerror(errno));
+        }
+    }
+}
+
+/* config_watch_mark
+ * Marks the watches of a changed file, all of them when name is NULL.
+ * Called with watch_mutex held.
+ */
+static void
+config_watch_mark(const char *name)
+{
+    struct config_watch *w = NULL;
+    const char *file = NULL;
+
+    for(w = watches; w; w = w->next) {
+        file = config_watch_file(w);
+        if(file && (name == NULL || !strcmp(file, name))) {
+            __atomic_add_fetch(&w->changes, 1, __ATOMIC_RELEASE);
+        }
+    }
+}
+
+/* config_watch_poll
+ * Reads the pending inotify events, at most once per CONFIG_WATCH_INTERVAL.
+ */
+static void
+config_watch_poll(void)
+{
+    char buf[4096]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev = NULL;
+    struct timespec now;
+    ssize_t len = 0;
+    char *p = NULL;
+
+    if(clock_gettime(CLOCK_MONOTONIC_COARSE, &now)
+       || now.tv_sec - __atomic_load_n(&last_poll, __ATOMIC_RELAXED)
+          < CONFIG_WATCH_INTERVAL) {
+        return;
+    }
+    /* somebody else is polling */
+    if(pthread_mutex_trylock(&watch_mutex)) {
+        return;
+    }
+    __atomic_store_n(&last_poll, now.tv_sec, __ATOMIC_RELAXED);
+    if(watch_fd >= 0 && watch_wd < 0) {
+        config_watch_add();
+        if(watch_wd >= 0) {
+            /* the directory came back, its files may have changed */
+            config_watch_mark(NULL);
+        }
+    }
+    while(watch_fd >= 0 && (len = read(watch_fd, buf, sizeof(buf))) > 0) {
+        for(p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+            ev = (const struct inotify_event *) p;
+            if(ev->mask & IN_Q_OVERFLOW) {
+                config_watch_mark(NULL);
+            }
+            else if(ev->mask & IN_IGNORED) {
+                watch_wd = -1;
+            }
+            else if(ev->len) {
+                config_watch_mark(ev->name);
+            }
+        }
+    }
+    pthread_mutex_unlock(&watch_mutex);
+}
+
+/* config_watch_changed
+ * Checks whether the file changed since the last load began.
+ *
+ * Returns TRUE if it changed, FALSE otherwise.
+ */
+int
+config_watch_changed(struct config_watch *w)
+{
+    config_watch_poll();
+    return __atomic_load_n(&w->changes, __ATOMIC_ACQUIRE)
+           != __atomic_load_n(&w->seen, __ATOMIC_RELAXED);
+}
+
+/* config_watch_begin
+ * Registers the watch on its first load and takes the changes seen so far,
+ * a change during the load is seen by the next config_watch_changed().
+ */
+void
+config_watch_begin(struct config_watch *w)
+{
+    struct config_watch **iter = NULL;
+
+    pthread_mutex_lock(&watch_mutex);
+    for(iter = &watches; *iter && *iter != w; iter = &(*iter)->next);
+    if(*iter == NULL) {
+        *iter = w;
+        config_watch_add();
+    }
+    pthread_mutex_unlock(&watch_mutex);
+    __atomic_store_n(&w->seen, __atomic_load_n(&w->changes, __ATOMIC_ACQUIRE),
+                     __ATOMIC_RELAXED);
+}
+
+/* config_watch_done
+ * Records the result of a load.
+ *
+ * Returns the generation in use, 0 if the file never loaded.
+ */
+unsigned
+config_watch_done(struct config_watch *w, int success)
+{
+    if(success) {
+        w->generation++;
+        w->failures = 0;
+        w->loaded = time(NULL);
+        if(w->generation > 1) {
+            VLOG_INFO("Reloaded %s, generation %u", w->path, w->generation);
+        }
+    }
+    else {
+        w->failures++;
+        if(w->generation) {
+            VLOG_ERR("Failed to reload %s, keeping generation %u", w->path,
+                     w->generation);
+        }
+    }
+    return w->generation;
+}
+
+/* config_watch_next
+ * Iterates over the registered watches.
+ *
+ * Returns the watch after w, the first one when w is NULL.
+ */
+struct config_watch *
+config_watch_next(const struct config_watch *w)
+{
+    struct config_watch *next = NULL;
+
+    pthread_mutex_lock(&watch_mutex);
+    next = w ? w->next : watches;
+    pthread_mutex_unlock(&watch_mutex);
+    return next;
+}
@@ -0,0 +1,544 @@
+/*
+ Copyright (C) 2016 Hewlett-Packard Development Company, L.P.
+ All Rights Reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License"); you may
+    not use this file except in compliance with the License. You may obtain
+    a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+    License for the specific language governing permissions and limitations
+    under the License.
+*/
+
+/*************************************************************************//**
+ * @ingroup ops_supportability
+ * This module bounds the space daemon core dumps take.
+ *
+ * The policy limits the total size of the core dumps, the number of core
+ * dumps of a daemon and their age. The core dumps present are loaded once,
+ * crash processing then reports each stored and deleted core dump, so the
+ * core dump directory is never scanned again. When a limit is exceeded the
+ * first and the latest core dump of each stack signature are kept the
+ * longest, as crash processing keeps the first and the latest ones of a
+ * repeated crash.
+ *
+ * @file
+ * Source file for core dump retention part of supportability library.
+ *
+ ****************************************************************************/
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/xattr.h>
+#include <yaml.h>
+#include "core_retention.h"
+#include "crashprocessing.h"
+#include "eventlog.h"
+#include "flightrec.h"
+#include "openvswitch/vlog.h"
+
+VLOG_DEFINE_THIS_MODULE(core_retention);
+
+#define RETENTION_NAME_SIZE      256
+#define RETENTION_ATTR_SIZE      64
+#define RETENTION_SECS_PER_DAY   (24 * 60 * 60)
+/* the age limit is checked at least this often, the wall clock may be set
+ * while the daemon waits */
+#define RETENTION_CHECK_SECS     (60 * 60)
+
+/* A core dump accounted for */
+struct retention_core {
+    char name[RETENTION_NAME_SIZE];
+    char process[RETENTION_ATTR_SIZE];
+    char signature[RETENTION_ATTR_SIZE];    /* empty when unknown */
+    uint64_t bytes;                         /* space taken on disk */
+    time_t time;
+};
+
+static struct {
+    uint64_t max_bytes;
+    unsigned long max_per_daemon;
+    unsigned long max_age_days;
+} policy = {
+    CORE_RETENTION_MAX_BYTES,
+    CORE_RETENTION_MAX_PER_DAEMON,
+    CORE_RETENTION_MAX_AGE_DAYS,
+};
+
+/* crash processing reports from its worker and its poll loop */
+static pthread_mutex_t retention_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct retention_core *cores = NULL;
+static size_t num_cores = 0;
+static uint64_t total_bytes = 0;
+
+/* retention_policy_set
+ * Sets a limit of the policy from the policy file.
+ */
+static void
+retention_policy_set(const char *key, const char *value)
+{
+    char *end = NULL;
+    unsigned long long limit = 0;
+
+    errno = 0;
+    limit = strtoull(value, &end, 10);
+    if(errno || end == value || *end != '\0') {
+        VLOG_ERR("Invalid %s in %s: %s", key, CORE_RETENTION_FILE, value);
+        return;
+    }
+    if(!strcmp(key, "max_total_bytes")) {
+        policy.max_bytes = limit;
+    }
+    else if(!strcmp(key, "max_cores_per_daemon")) {
+        policy.max_per_daemon = limit;
+    }
+    else if(!strcmp(key, "max_age_days")) {
+        policy.max_age_days = limit;
+    }
+}
+
+/* retention_policy_load
+ * Loads the policy, the defaults are kept for the limits the policy file
+ * does not set.
+ */
+static void
+retention_policy_load(void)
+{
+    yaml_parser_t parser;
+    yaml_token_t token;
+    char key[RETENTION_ATTR_SIZE] = {0,};
+    int is_key = FALSE, is_value = FALSE;
+    FILE *fh = NULL;
+
+    fh = fopen(CORE_RETENTION_FILE, "r");
+    if(fh == NULL) {
+        return;
+    }
+    if(!yaml_parser_initialize(&parser)) {
+        VLOG_ERR("YAML Initialize failed");
+        fclose(fh);
+        return;
+    }
+    yaml_parser_set_input_file(&parser, fh);
+    do {
+        if(!yaml_parser_scan(&parser, &token)) {
+            VLOG_ERR("Failed to parse %s", CORE_RETENTION_FILE);
+            break;
+        }
+        switch(token.type) {
+            case YAML_KEY_TOKEN:
+                is_key = TRUE;
+                break;
+
+            case YAML_VALUE_TOKEN:
+                is_value = TRUE;
+                break;
+
+            case YAML_SCALAR_TOKEN:
+                if(is_key) {
+                    snprintf(key, sizeof(key), "%s",
+                             (char *) token.data.scalar.value);
+                }
+                else if(is_value) {
+                    retention_policy_set(key,
+                                         (char *) token.data.scalar.value);
+                }
+                is_key = is_value = FALSE;
+                break;
+
+            default:
+                is_key = is_value = FALSE;
+                break;
+        }
+        if(token.type == YAML_STREAM_END_TOKEN) {
+            yaml_token_delete(&token);
+            break;
+        }
+        yaml_token_delete(&token);
+    } while(TRUE);
+    yaml_parser_delete(&parser);
+    fclose(fh);
+}
+
+/* retention_find
+ * Returns the index of a core dump, -1 if it is not accounted for.
+ */
+static int
+retention_find(const char *name)
+{
+    size_t i = 0;
+
+    for(i = 0; i < num_cores; i++) {
+        if(!strcmp(cores[i].name, name)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* retention_forget
+ * Stops accounting for a core dump.
+ */
+static void
+retention_forget(size_t i)
+{
+    total_bytes -= cores[i].bytes;
+    cores[i] = cores[--num_cores];
+}
+
+/* retention_older
+ * Returns TRUE if core dump a is older than core dump b, the name orders
+ * core dumps of the same second.
+ */
+static int
+retention_older(size_t a, size_t b)
+{
+    if(cores[a].time != cores[b].time) {
+        return cores[a].time < cores[b].time;
+    }
+    return strcmp(cores[a].name, cores[b].name) < 0;
+}
+
+/* retention_preferred
+ * Returns TRUE for the first and the latest core dump of a signature, and
+ * for a core dump without signature.
+ */
+static int
+retention_preferred(size_t i)
+{
+    int first = TRUE, latest = TRUE;
+    size_t j = 0;
+
+    if(cores[i].signature[0] == '\0') {
+        return TRUE;
+    }
+    for(j = 0; j < num_cores; j++) {
+        if(j == i || strcmp(cores[j].signature, cores[i].signature)) {
+            continue;
+        }
+        if(retention_older(j, i)) {
+            first = FALSE;
+        }
+        else {
+            latest = FALSE;
+        }
+    }
+    return first || latest;
+}
+
+/* retention_pick
+ * Picks the core dump to evict, of process or of any process when process
+ * is NULL: the oldest one which is not preferred, or the oldest one.
+ *
+ * Returns the index of the core dump, -1 if there is none.
+ */
+static int
+retention_pick(const char *process)
+{
+    int oldest = -1, oldest_other = -1;
+    size_t i = 0;
+
+    for(i = 0; i < num_cores; i++) {
+        if(process && strcmp(cores[i].process, process)) {
+            continue;
+        }
+        if(oldest < 0 || retention_older(i, oldest)) {
+            oldest = i;
+        }
+        if(!retention_preferred(i)
+           && (oldest_other < 0 || retention_older(i, oldest_other))) {
+            oldest_other = i;
+        }
+    }
+    return (oldest_other >= 0) ? oldest_other : oldest;
+}
+
+/* retention_evict
+ * Deletes a core dump and logs the eviction event.
+ */
+static void
+retention_evict(size_t i, const char *reason)
+{
+    char path[RETENTION_NAME_SIZE * 2];
+
+    snprintf(path, sizeof(path), "%s/%s", CRASH_CORE_DIR, cores[i].name);
+    if(unlink(path) && errno != ENOENT) {
+        VLOG_ERR("Failed to remove core dump %s: %s", cores[i].name,
+                 strerror(errno));
+    }
+    else {
+        VLOG_INFO("Core dump %s of %s removed, %s exceeded", cores[i].name,
+                  cores[i].process, reason);
+        log_event(CORE_RETENTION_EVENT_NAME,
+                  EV_KV("process", "%s", cores[i].process),
+                  EV_KV("file", "%s", cores[i].name),
+                  EV_KV("reason", "%s", reason),
+                  NULL);
+    }
+    /* forgotten even when it could not be removed, it is not retried on
+     * every event */
+    retention_forget(i);
+}
+
+/* retention_expire
+ * Evicts the core dumps which exceeded the age limit.
+ */
+static void
+retention_expire(void)
+{
+    time_t oldest_kept = 0;
+    size_t i = 0;
+
+    if(policy.max_age_days == 0) {
+        return;
+    }
+    oldest_kept = time(NULL) - policy.max_age_days * RETENTION_SECS_PER_DAY;
+    for(i = num_cores; i-- > 0;) {
+        if(cores[i].time <= oldest_kept) {
+            retention_evict(i, "age limit");
+        }
+    }
+}
+
+/* retention_enforce
+ * Evicts core dumps until the policy is met.
+ */
+static void
+retention_enforce(void)
+{
+    unsigned long count = 0;
+    size_t i = 0, j = 0;
+    int victim = -1;
+
+    retention_expire();
+
+    i = 0;
+    while(policy.max_per_daemon && i < num_cores) {
+        count = 0;
+        for(j = 0; j < num_cores; j++) {
+            count += !strcmp(cores[j].process, cores[i].process);
+        }
+        if(count <= policy.max_per_daemon) {
+            i++;
+            continue;
+        }
+        victim = retention_pick(cores[i].process);
+        retention_evict(victim, "core dumps per daemon limit");
+        /* the array was reordered */
+        i = 0;
+    }
+
+    while(policy.max_bytes && total_bytes > policy.max_bytes) {
+        victim = retention_pick(NULL);
+        if(victim < 0) {
+            break;
+        }
+        retention_evict(victim, "total size limit");
+    }
+}
+
+/* retention_account
+ * Accounts for a core dump, or updates it when it is already.
+ *
+ * Returns 0 on success, -1 if the core dump is not accounted for.
+ */
+static int
+retention_account(const char *name, const char *process,
+                  const char *signature)
+{
+    struct retention_core *grown = NULL, *core = NULL;
+    char path[RETENTION_NAME_SIZE * 2];
+    struct stat st;
+    int i = 0;
+
+    snprintf(path, sizeof(path), "%s/%s", CRASH_CORE_DIR, name);
+    if(stat(path, &st) || !S_ISREG(st.st_mode)) {
+        return -1;
+    }
+    i = retention_find(name);
+    if(i >= 0) {
+        retention_forget(i);
+    }
+    grown = realloc(cores, (num_cores + 1) * sizeof(*cores));
+    if(grown == NULL) {
+        VLOG_ERR("Memory allocation failure");
+        return -1;
+    }
+    cores = grown;
+    core = &cores[num_cores++];
+    memset(core, 0, sizeof(*core));
+    strncpy(core->name, name, sizeof(core->name) - 1);
+    strncpy(core->process, process, sizeof(core->process) - 1);
+    if(signature) {
+        strncpy(core->signature, signature, sizeof(core->signature) - 1);
+    }
+    core->bytes = (uint64_t) st.st_blocks * 512;
+    core->time = st.st_mtime;
+    total_bytes += core->bytes;
+    return 0;
+}
+
+/* retention_get_attr
+ * Reads an extended attribute of a core dump, value is left empty when the
+ * core dump does not have it.
+ */
+static void
+retention_get_attr(const char *path, const char *attr, char *value,
+                   size_t size)
+{
+    ssize_t len = getxattr(path, attr, value, size - 1);
+
+    value[(len > 0) ? len : 0] = '\0';
+}
+
+/* core_retention_init
+ * Loads the policy and the core dumps present, and enforces the policy.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+core_retention_init(void)
+{
+    char path[RETENTION_NAME_SIZE * 2];
+    char process[RETENTION_ATTR_SIZE];
+    char signature[RETENTION_ATTR_SIZE];
+    struct dirent *de = NULL;
+    DIR *dp = NULL;
+
+    retention_policy_load();
+    VLOG_INFO("Core dump retention: %llu bytes, %lu per daemon, %lu days",
+              (unsigned long long) policy.max_bytes, policy.max_per_daemon,
+              policy.max_age_days);
+
+    dp = opendir(CRASH_CORE_DIR);
+    if(dp == NULL) {
+        VLOG_ERR("Failed to open %s: %s", CRASH_CORE_DIR, strerror(errno));
+        return -1;
+    }
+    pthread_mutex_lock(&retention_mutex);
+    while((de = readdir(dp)) != NULL) {
+        if(fnmatch(CRASH_CORE_PATTERN, de->d_name, FNM_PERIOD) != 0
+           || fnmatch(CRASH_FLIGHTREC_PATTERN, de->d_name, 0) == 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", CRASH_CORE_DIR, de->d_name);
+        retention_get_attr(path, "user.coredump.comm", process,
+                           sizeof(process));
+        retention_get_attr(path, CRASH_SIG_XATTR, signature,
+                           sizeof(signature));
+        retention_account(de->d_name, process, signature);
+    }
+    closedir(dp);
+    retention_enforce();
+    pthread_mutex_unlock(&retention_mutex);
+    return 0;
+}
+
+/* core_retention_add
+ * Accounts for a stored core dump and enforces the policy.
+ *
+ * Returns FALSE when the policy evicted the core dump itself, TRUE
+ * otherwise.
+ */
+int
+core_retention_add(const char *name, const char *process,
+                   const char *signature)
+{
+    int kept = TRUE;
+
+    pthread_mutex_lock(&retention_mutex);
+    if(retention_account(name, process, signature) == 0) {
+        retention_enforce();
+        kept = (retention_find(name) >= 0);
+    }
+    pthread_mutex_unlock(&retention_mutex);
+    return kept;
+}
+
+/* core_retention_run
+ * Evicts the core dumps which exceeded the age limit while no core dump was
+ * stored.
+ */
+void
+core_retention_run(void)
+{
+    pthread_mutex_lock(&retention_mutex);
+    retention_expire();
+    pthread_mutex_unlock(&retention_mutex);
+}
+
+/* core_retention_timeout
+ * Returns the msecs until the oldest core dump exceeds the age limit, at
+ * most RETENTION_CHECK_SECS, -1 when there is no core dump or no age limit.
+ */
+int
+core_retention_timeout(void)
+{
+    time_t oldest = 0, wait = 0;
+    size_t i = 0;
+
+    pthread_mutex_lock(&retention_mutex);
+    for(i = 0; i < num_cores; i++) {
+        if(i == 0 || cores[i].time < oldest) {
+            oldest = cores[i].time;
+        }
+    }
+    if(policy.max_age_days == 0 || num_cores == 0) {
+        pthread_mutex_unlock(&retention_mutex);
+        return -1;
+    }
+    pthread_mutex_unlock(&retention_mutex);
+
+    wait = oldest + policy.max_age_days * RETENTION_SECS_PER_DAY - time(NULL);
+    if(wait < 0) {
+        wait = 0;
+    }
+    if(wait > RETENTION_CHECK_SECS) {
+        wait = RETENTION_CHECK_SECS;
+    }
+    return wait * 1000;
+}
+
+/* core_retention_remove
+ * Forgets a core dump which was deleted.
+ */
+void
+core_retention_remove(const char *name)
+{
+    int i = 0;
+
+    pthread_mutex_lock(&retention_mutex);
+    i = retention_find(name);
+    if(i >= 0) {
+        retention_forget(i);
+    }
+    pthread_mutex_unlock(&retention_mutex);
+}
+
+/* core_retention_destroy
+ * Releases the core dumps accounted for.
+ */
+void
+core_retention_destroy(void)
+{
+    pthread_mutex_lock(&retention_mutex);
+    free(cores);
+    cores = NULL;
+    num_cores = 0;
+    total_bytes = 0;
+    pthread_mutex_unlock(&retention_mutex);
+}
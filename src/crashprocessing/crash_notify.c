@@ -0,0 +1,173 @@
+/*
+ Copyright (C) 2016 Hewlett-Packard Development Company, L.P.
+ All Rights Reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License"); you may
+    not use this file except in compliance with the License. You may obtain
+    a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+    License for the specific language governing permissions and limitations
+    under the License.
+*/
+
+/*************************************************************************//**
+ * @ingroup ops_supportability
+ * This module is the format of the crash notifications crash processing
+ * sends on CRASH_NOTIFY_SOCKET, and the subscriber side of the socket.
+ *
+ * The socket is a SOCK_SEQPACKET one, each message is one crash made of
+ * key=value lines, so that it can be read with no parsing library, with
+ * socat for instance. Unknown keys are ignored.
+ *
+ * @file
+ * Source file for the crash notifications of supportability library.
+ *
+ ****************************************************************************/
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "crashprocessing.h"
+
+/* crash_notify_format
+ * Formats a notification as a message.
+ *
+ * Returns the length of the message, -1 if it does not fit.
+ */
+int
+crash_notify_format(const struct crash_notification *n, char *buf,
+                    size_t size)
+{
+    int len = snprintf(buf, size,
+                       "process=%s\npid=%d\nsignal=%d\ntimestamp=%lld\n"
+                       "status=%s\nfile=%s\nsignature=%s\nsite=%s\n"
+                       "crashes=%u\n",
+                       n->process, n->pid, n->signal_num, n->timestamp,
+                       n->stored ? "stored"
+                       : n->evicted ? "evicted" : "discarded", n->file,
+                       n->signature, n->site, n->crashes);
+
+    if(len < 0 || (size_t) len >= size) {
+        return -1;
+    }
+    return len;
+}
+
+/* crash_notify_copy
+ * Copies the value of a line in to a field.
+ */
+static void
+crash_notify_copy(char *field, size_t size, const char *value)
+{
+    strncpy(field, value, size - 1);
+    field[size - 1] = '\0';
+}
+
+/* crash_notify_parse
+ * Fills a notification from the lines of a message, msg is modified.
+ */
+static void
+crash_notify_parse(char *msg, struct crash_notification *n)
+{
+    char *line = NULL, *save = NULL, *value = NULL;
+
+    memset(n, 0, sizeof(*n));
+    for(line = strtok_r(msg, "\n", &save); line;
+        line = strtok_r(NULL, "\n", &save)) {
+        value = strchr(line, '=');
+        if(value == NULL) {
+            continue;
+        }
+        *value++ = '\0';
+        if(!strcmp(line, "process")) {
+            crash_notify_copy(n->process, sizeof(n->process), value);
+        }
+        else if(!strcmp(line, "pid")) {
+            n->pid = atoi(value);
+        }
+        else if(!strcmp(line, "signal")) {
+            n->signal_num = atoi(value);
+        }
+        else if(!strcmp(line, "timestamp")) {
+            n->timestamp = atoll(value);
+        }
+        else if(!strcmp(line, "status")) {
+            n->stored = !strcmp(value, "stored");
+            n->evicted = !strcmp(value, "evicted");
+        }
+        else if(!strcmp(line, "file")) {
+            crash_notify_copy(n->file, sizeof(n->file), value);
+        }
+        else if(!strcmp(line, "signature")) {
+            crash_notify_copy(n->signature, sizeof(n->signature), value);
+        }
+        else if(!strcmp(line, "site")) {
+            crash_notify_copy(n->site, sizeof(n->site), value);
+        }
+        else if(!strcmp(line, "crashes")) {
+            n->crashes = strtoul(value, NULL, 10);
+        }
+    }
+}
+
+/* crash_notify_subscribe
+ * Connects to the crash notifications.
+ *
+ * Returns the connected fd on success, -1 on failure.
+ */
+int
+crash_notify_subscribe(void)
+{
+    struct sockaddr_un addr;
+    int fd = -1;
+
+    fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+    if(fd < 0) {
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, CRASH_NOTIFY_SOCKET, sizeof(addr.sun_path) - 1);
+    if(connect(fd, (struct sockaddr *) &addr, sizeof(addr))) {
+        close(fd);
+        return -1;
+    }
+    /* nothing is ever sent to crash processing, it takes anything readable
+     * as the end of the subscription */
+    return fd;
+}
+
+/* crash_notify_receive
+ * Reads the next notification of a subscription.
+ *
+ * Returns 1 when a notification was read, 0 when none is pending and -1
+ * when the subscription ended.
+ */
+int
+crash_notify_receive(int fd, struct crash_notification *n)
+{
+    char msg[CRASH_NOTIFY_MSG_SIZE + 1];
+    ssize_t len = 0;
+
+    do {
+        len = recv(fd, msg, CRASH_NOTIFY_MSG_SIZE, MSG_DONTWAIT);
+    } while(len < 0 && errno == EINTR);
+    if(len < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    if(len == 0) {
+        return -1;
+    }
+    msg[len] = '\0';
+    crash_notify_parse(msg, n);
+    return 1;
+}
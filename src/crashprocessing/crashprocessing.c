@@ -0,0 +1,2405 @@
+/*
+ Copyright (C) 2016 Hewlett-Packard Development Company, L.P.
+ All Rights Reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License"); you may
+    not use this file except in compliance with the License. You may obtain
+    a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+    License for the specific language governing permissions and limitations
+    under the License.
+*/
+
+/*************************************************************************//**
+ * @ingroup ops_supportability
+ * This module logs a crash event for every daemon core dump, exactly once.
+ *
+ * New core dumps are reported by inotify and only the announced file is
+ * looked at. The names of core dumps are appended to a journal once they
+ * are stored, which is loaded in to a hash set on start up. Storing is
+ * idempotent, a core dump the daemon stopped storing is stored again.
+ *
+ * Each daemon core dump is then stored compressed with zstd, keeping the
+ * extended attributes systemd-coredump set. A core dump systemd-coredump
+ * compressed with xz or lz4 is decompressed first, its notes could not be
+ * read otherwise. When the plain core dump would not fit, it is streamed
+ * in to zstd instead and stored without unwinding. Repeated crashes are
+ * detected by the stack signature of the crashing thread, the first and the
+ * latest CRASH_DEDUP_KEEP - 1 core dumps of a signature are kept and the
+ * others are counted in CRASH_SIGNATURE_DB.
+ *
+ * Storing is done by a worker thread, which also unwinds the crashing thread
+ * of each kept core dump with libdw against the binaries on the switch. The
+ * backtrace is stored with the core dump, as CRASH_BT_XATTR. The flight
+ * recorder the crashed process left in shared memory is written next to
+ * the kept core dump, as <core dump>FLIGHTREC_EXT. The stored and the
+ * deleted core dumps are reported to core dump retention.
+ *
+ * Once stored or dropped, each crash is announced to the processes
+ * subscribed on CRASH_NOTIFY_SOCKET, vtysh sessions among them. A
+ * subscriber which does not keep up misses notifications rather than
+ * slowing crash processing down.
+ *
+ * @file
+ * Source file for crash processing part of supportability library.
+ *
+ ****************************************************************************/
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <elf.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <pthread.h>
+#include <signal.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/procfs.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/un.h>
+#include <sys/xattr.h>
+#include <elfutils/libdwfl.h>
+#include <lz4frame.h>
+#include <lzma.h>
+#include <zstd.h>
+#include "core_retention.h"
+#include "crashprocessing.h"
+#include "eventlog.h"
+#include "flightrec.h"
+#include "openvswitch/vlog.h"
+
+VLOG_DEFINE_THIS_MODULE(crashprocessing);
+
+#define CRASH_NAME_SIZE          256
+#define CRASH_ATTR_SIZE          64
+#define CRASH_EVENT_BUF          4096
+#define CRASH_SET_MIN_SIZE       64
+/* only events announcing a complete core dump, it is compressed right away */
+#define CRASH_NEW_EVENTS         (IN_MOVED_TO | IN_CLOSE_WRITE)
+#define CRASH_GONE_EVENTS        (IN_DELETE | IN_MOVED_FROM)
+#define CRASH_WATCH_EVENTS       (CRASH_NEW_EVENTS | CRASH_GONE_EVENTS)
+#define CRASH_ZSTD_LEVEL         3
+/* compressions of systemd-coredump, undone before a core dump is stored */
+#define CRASH_XZ_EXT             ".xz"
+#define CRASH_LZ4_EXT            ".lz4"
+#define CRASH_COPY_BUF           (64 * 1024)
+/* a decompressed core dump is not written when it would leave less than
+ * CRASH_SPACE_RESERVE free, free space is checked every CRASH_SPACE_CHECK */
+#define CRASH_SPACE_RESERVE      (64ull * 1024 * 1024)
+#define CRASH_SPACE_CHECK        (16ull * 1024 * 1024)
+#define CRASH_XZ_INDEX_MAX       (1024 * 1024)
+#define CRASH_XATTR_LIST_SIZE    4096
+#define CRASH_XATTR_VALUE_SIZE   CRASH_BT_SIZE
+/* set once the crash event of a core dump is logged, it is copied to the
+ * stored versions and a core dump processed again after a restart does not
+ * log its crash twice */
+#define CRASH_LOGGED_XATTR       "user.coredump.event_logged"
+#define CRASH_SITE_SIZE          128
+#define CRASH_SIG_FRAMES         8
+#define CRASH_NOTES_MAX          (8 * 1024 * 1024)
+#define CRASH_BT_FRAMES          16
+#define CRASH_EPOLL_EVENTS       16
+
+/* registers of the crashing thread the stack signature is taken from,
+ * frames are walked through the frame pointer chain */
+#if defined(__x86_64__)
+#define CRASH_REG_PC             16              /* rip */
+#define CRASH_REG_FP             4               /* rbp */
+#elif defined(__aarch64__)
+#define CRASH_REG_PC             32              /* pc */
+#define CRASH_REG_FP             29              /* x29 */
+#endif
+
+/* Open addressing set of processed core dump names */
+struct crash_set {
+    char **slots;
+    size_t size;            /* power of two */
+    size_t count;
+};
+
+/* A stack signature and the core dumps stored for it */
+struct crash_signature {
+    uint64_t hash;
+    unsigned int seen;                      /* crashes with this signature */
+    unsigned int discarded;                 /* core dumps not stored */
+    char process[CRASH_ATTR_SIZE];
+    char site[CRASH_SITE_SIZE];             /* object+offset of the crash */
+    char kept[CRASH_DEDUP_KEEP][CRASH_NAME_SIZE];
+};
+
+/* A core dump being read for its stack signature */
+struct crash_core {
+    int fd;
+    Elf64_Phdr *phdrs;
+    int phnum;
+    char *files;                            /* NT_FILE note */
+    size_t files_size;
+    uint64_t pc;
+    uint64_t fp;
+};
+
+/* A core dump being written, as is or compressed with zstd */
+struct crash_sink {
+    int fd;
+    ZSTD_CCtx *cctx;                        /* NULL when written as is */
+    char *buf;                              /* zstd output */
+    size_t size;
+    uint64_t unchecked;                     /* written since the free space
+                                             * was last checked */
+};
+
+/* A processed core dump waiting for the worker */
+struct crash_job {
+    struct crash_job *next;
+    char name[CRASH_NAME_SIZE];
+    char process[CRASH_ATTR_SIZE];
+    int signal_num;
+};
+
+/* A backtrace being formatted */
+struct crash_bt {
+    Dwfl *dwfl;
+    char *buf;
+    size_t size;
+    size_t len;
+    int frames;
+};
+
+/* protects the processed set, the journal and the job queue, which are
+ * shared with the worker */
+static pthread_mutex_t crash_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t crash_cond = PTHREAD_COND_INITIALIZER;
+static struct crash_job *jobs_head = NULL;
+static struct crash_job *jobs_tail = NULL;
+static pthread_t worker;
+static int worker_started = FALSE;
+static int worker_stop = FALSE;
+static int sweep_pending = FALSE;
+static struct crash_set processed;
+static struct crash_signature *signatures = NULL;
+static size_t num_signatures = 0;
+static int inotify_fd = -1;
+static int epoll_fd = -1;
+/* the subscribers are added and closed by the main thread and written to
+ * by the worker */
+static pthread_mutex_t notify_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int notify_fd = -1;
+static int subscribers[CRASH_NOTIFY_MAX_SUBSCRIBERS];
+static int num_subscribers = 0;
+static int journal_fd = -1;
+
+/* crash_hash
+ * FNV-1a hash of a core dump name
+ */
+static uint32_t
+crash_hash(const char *name)
+{
+    uint32_t hash = 2166136261u;
+
+    while(*name) {
+        hash ^= (unsigned char) *name++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/* crash_set_slot
+ * Finds the slot of name, or the empty slot it would go to.
+ *
+ * Returns the slot index.
+ */
+static size_t
+crash_set_slot(const struct crash_set *set, const char *name)
+{
+    size_t i = crash_hash(name) & (set->size - 1);
+
+    while(set->slots[i] && strcmp(set->slots[i], name)) {
+        i = (i + 1) & (set->size - 1);
+    }
+    return i;
+}
+
+/* crash_set_contains
+ * Returns TRUE if the core dump was processed already.
+ */
+static int
+crash_set_contains(const struct crash_set *set, const char *name)
+{
+    if(set->size == 0) {
+        return FALSE;
+    }
+    return set->slots[crash_set_slot(set, name)] != NULL;
+}
+
+/* crash_set_add
+ * Adds a name to the set, the load factor is kept at or below one half.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+crash_set_add(struct crash_set *set, const char *name)
+{
+    struct crash_set grown;
+    size_t i = 0;
+
+    if(2 * (set->count + 1) > set->size) {
+        grown.size = set->size ? 2 * set->size : CRASH_SET_MIN_SIZE;
+        grown.count = set->count;
+        grown.slots = calloc(grown.size, sizeof(*grown.slots));
+        if(grown.slots == NULL) {
+            return -1;
+        }
+        for(i = 0; i < set->size; i++) {
+            if(set->slots[i]) {
+                grown.slots[crash_set_slot(&grown, set->slots[i])] =
+                    set->slots[i];
+            }
+        }
+        free(set->slots);
+        *set = grown;
+    }
+    i = crash_set_slot(set, name);
+    if(set->slots[i]) {
+        return 0;
+    }
+    set->slots[i] = strdup(name);
+    if(set->slots[i] == NULL) {
+        return -1;
+    }
+    set->count++;
+    return 0;
+}
+
+/* crash_set_clear
+ * Frees all names of the set.
+ */
+static void
+crash_set_clear(struct crash_set *set)
+{
+    size_t i = 0;
+
+    for(i = 0; i < set->size; i++) {
+        free(set->slots[i]);
+    }
+    free(set->slots);
+    memset(set, 0, sizeof(*set));
+}
+
+/* crash_mark_processed
+ * Records a core dump as being processed, in memory only. Its later events
+ * are ignored, and it is processed again if the daemon stops before it is
+ * stored.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+crash_mark_processed(const char *name)
+{
+    int rc = 0;
+
+    pthread_mutex_lock(&crash_mutex);
+    if(crash_set_add(&processed, name) < 0) {
+        VLOG_ERR("Memory allocation failure");
+        rc = -1;
+    }
+    pthread_mutex_unlock(&crash_mutex);
+    return rc;
+}
+
+/* crash_journal_append
+ * Records a core dump as processed, in memory and in the journal.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+crash_journal_append(const char *name)
+{
+    char line[CRASH_NAME_SIZE + 1];
+    int len = 0;
+    int rc = 0;
+
+    len = snprintf(line, sizeof(line), "%s\n", name);
+    if(len <= 0 || len >= (int) sizeof(line)) {
+        return -1;
+    }
+    pthread_mutex_lock(&crash_mutex);
+    if(crash_set_add(&processed, name) < 0) {
+        VLOG_ERR("Memory allocation failure");
+        rc = -1;
+    }
+    /* a single O_APPEND write, the line is never interleaved or torn by a
+     * concurrent writer */
+    else if(journal_fd >= 0 && write(journal_fd, line, len) != len) {
+        VLOG_ERR("Failed to update %s: %s", CRASH_JOURNAL, strerror(errno));
+        rc = -1;
+    }
+    else if(journal_fd >= 0) {
+        fdatasync(journal_fd);
+    }
+    pthread_mutex_unlock(&crash_mutex);
+    return rc;
+}
+
+/* crash_is_processed
+ * Returns TRUE if the core dump was processed already.
+ */
+static int
+crash_is_processed(const char *name)
+{
+    int found = FALSE;
+
+    pthread_mutex_lock(&crash_mutex);
+    found = crash_set_contains(&processed, name);
+    pthread_mutex_unlock(&crash_mutex);
+    return found;
+}
+
+/* crash_journal_load
+ * Loads the names of processed core dumps. The list written by earlier
+ * versions holds the python representation of a list of paths, every
+ * quoted path in it is taken over.
+ */
+static void
+crash_journal_load(const char *path, int legacy)
+{
+    char line[CRASH_NAME_SIZE * 4];
+    char *name = NULL, *end = NULL, *base = NULL;
+    FILE *fp = NULL;
+
+    fp = fopen(path, "r");
+    if(fp == NULL) {
+        return;
+    }
+    while(fgets(line, sizeof(line), fp) != NULL) {
+        if(!legacy) {
+            line[strcspn(line, "\n")] = '\0';
+            if(line[0]) {
+                crash_set_add(&processed, line);
+            }
+            continue;
+        }
+        for(name = strchr(line, '\''); name; name = strchr(end + 1, '\'')) {
+            end = strchr(name + 1, '\'');
+            if(end == NULL) {
+                break;
+            }
+            *end = '\0';
+            base = strrchr(name + 1, '/');
+            crash_set_add(&processed, base ? base + 1 : name + 1);
+        }
+    }
+    fclose(fp);
+}
+
+/* crash_journal_open
+ * Loads the journal and opens it for appending. When it holds many names
+ * of core dumps deleted since, it is first rewritten with the names of the
+ * core dumps still present.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+crash_journal_open(void)
+{
+    struct crash_set present;
+    struct dirent *de = NULL;
+    char tmp_path[CRASH_NAME_SIZE];
+    DIR *dp = NULL;
+    FILE *fp = NULL;
+    size_t i = 0;
+    int legacy = FALSE;
+
+    crash_journal_load(CRASH_JOURNAL, FALSE);
+    if(access(CRASH_LEGACY_LIST, F_OK) == 0) {
+        crash_journal_load(CRASH_LEGACY_LIST, TRUE);
+        legacy = TRUE;
+    }
+
+    memset(&present, 0, sizeof(present));
+    dp = opendir(CRASH_CORE_DIR);
+    while(dp && (de = readdir(dp)) != NULL) {
+        if(crash_set_contains(&processed, de->d_name)) {
+            crash_set_add(&present, de->d_name);
+        }
+    }
+    if(dp) {
+        closedir(dp);
+    }
+
+    /* compact once deleted core dumps make up most of the journal */
+    if(legacy || processed.count > 2 * present.count + CRASH_SET_MIN_SIZE) {
+        snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", CRASH_JOURNAL);
+        fp = fopen(tmp_path, "w");
+        if(fp) {
+            for(i = 0; i < present.size; i++) {
+                if(present.slots[i]) {
+                    fprintf(fp, "%s\n", present.slots[i]);
+                }
+            }
+            if(fclose(fp) == 0 && rename(tmp_path, CRASH_JOURNAL) == 0) {
+                crash_set_clear(&processed);
+                processed = present;
+                memset(&present, 0, sizeof(present));
+                unlink(CRASH_LEGACY_LIST);
+            }
+            else {
+                unlink(tmp_path);
+            }
+        }
+    }
+    crash_set_clear(&present);
+
+    journal_fd = open(CRASH_JOURNAL, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+                      S_IRUSR | S_IWUSR | S_IRGRP);
+    if(journal_fd < 0) {
+        VLOG_ERR("Failed to open %s: %s", CRASH_JOURNAL, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* crash_get_attr
+ * Reads one of the extended attributes systemd-coredump stores with the
+ * core dump.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+crash_get_attr(const char *path, const char *attr, char *value, size_t size)
+{
+    ssize_t len = getxattr(path, attr, value, size - 1);
+
+    if(len <= 0) {
+        return -1;
+    }
+    value[len] = '\0';
+    return 0;
+}
+
+/* crash_process_core
+ * Logs the crash event of one core dump, with the crashed process, the
+ * signal and the time of the crash. The process is returned in process,
+ * of at least CRASH_ATTR_SIZE bytes, and the signal in signal_num.
+ *
+ * Returns 0 on success, 1 if the event was logged before the daemon
+ * restarted, -1 if the core dump information is not available.
+ */
+static int
+crash_process_core(const char *name, char *process, int *signal_num)
+{
+    char path[CRASH_NAME_SIZE * 2];
+    char signal_str[CRASH_ATTR_SIZE];
+    char timestamp[CRASH_ATTR_SIZE];
+    char timestamp_human[CRASH_ATTR_SIZE] = {0,};
+    char value[CRASH_ATTR_SIZE];
+    const char *signal_desc = NULL;
+    struct tm tm_crash;
+    time_t crash_time = 0;
+
+    snprintf(path, sizeof(path), "%s/%s", CRASH_CORE_DIR, name);
+    /* ToFix :: In case of python based daemon crash, this value just
+     *          has the name "python", it doesn't provide information
+     *          on which daemon crashed. */
+    if(crash_get_attr(path, "user.coredump.comm", process, CRASH_ATTR_SIZE)
+       || crash_get_attr(path, "user.coredump.signal", signal_str,
+                         sizeof(signal_str))
+       || crash_get_attr(path, "user.coredump.timestamp", timestamp,
+                         sizeof(timestamp))) {
+        return -1;
+    }
+
+    *signal_num = atoi(signal_str);
+    if(crash_get_attr(path, CRASH_LOGGED_XATTR, value, sizeof(value)) == 0) {
+        return 1;
+    }
+    signal_desc = (*signal_num > 0 && *signal_num < NSIG) ?
+                  strsignal(*signal_num) : NULL;
+    crash_time = (time_t) atoll(timestamp);
+    if(localtime_r(&crash_time, &tm_crash) == NULL
+       || strftime(timestamp_human, sizeof(timestamp_human),
+                   "%Y-%m-%d %H:%M:%S", &tm_crash) == 0) {
+        strncpy(timestamp_human, timestamp, sizeof(timestamp_human) - 1);
+    }
+    if(signal_desc == NULL) {
+        signal_desc = "Unknown signal";
+    }
+
+    log_event(CRASH_EVENT_NAME,
+              EV_KV("process", "%s", process),
+              EV_KV("signal", "%s", signal_desc),
+              EV_KV("timestamp", "%s", timestamp_human),
+              NULL);
+    if(setxattr(path, CRASH_LOGGED_XATTR, "1", 1, 0)) {
+        VLOG_DBG("Failed to mark the crash event of %s: %s", name,
+                 strerror(errno));
+    }
+    return 0;
+}
+
+/* crash_hash64
+ * Adds data to a 64 bit FNV-1a hash
+ */
+static void
+crash_hash64(uint64_t *hash, const void *data, size_t len)
+{
+    const unsigned char *p = data;
+
+    while(len--) {
+        *hash ^= *p++;
+        *hash *= 1099511628211ull;
+    }
+}
+
+/* crash_is_compressed
+ * Returns TRUE for a core dump which is compressed, by crash processing or
+ * by systemd-coredump.
+ */
+static int
+crash_is_compressed(const char *name)
+{
+    static const char *const exts[] = { CRASH_COMPRESSED_EXT, CRASH_XZ_EXT,
+                                       CRASH_LZ4_EXT };
+    size_t len = strlen(name);
+    size_t ext_len = 0;
+    size_t i = 0;
+
+    for(i = 0; i < sizeof(exts) / sizeof(exts[0]); i++) {
+        ext_len = strlen(exts[i]);
+        if(len > ext_len && !strcmp(name + len - ext_len, exts[i])) {
+            return TRUE;
+        }
+    }
+    return FALSE;
+}
+
+/* crash_core_close
+ * Releases a core dump opened by crash_core_open.
+ */
+static void
+crash_core_close(struct crash_core *core)
+{
+    if(core->fd >= 0) {
+        close(core->fd);
+    }
+    free(core->phdrs);
+    free(core->files);
+    memset(core, 0, sizeof(*core));
+    core->fd = -1;
+}
+
+/* crash_core_notes
+ * Takes the registers of the crashing thread, which the kernel writes
+ * first, and the mapped files out of a note segment.
+ */
+static void
+crash_core_notes(struct crash_core *core, const char *notes, size_t size,
+                 int *have_regs)
+{
+    const Elf64_Nhdr *nhdr = NULL;
+    const char *desc = NULL;
+    size_t off = 0, name_size = 0, desc_size = 0;
+#ifdef CRASH_REG_PC
+    prstatus_t prstatus;
+#endif
+
+    while(off + sizeof(*nhdr) <= size) {
+        nhdr = (const Elf64_Nhdr *) (notes + off);
+        name_size = (nhdr->n_namesz + 3) & ~3u;
+        desc_size = ((size_t) nhdr->n_descsz + 3) & ~(size_t) 3;
+        if(name_size + nhdr->n_descsz > size - off - sizeof(*nhdr)) {
+            break;
+        }
+        desc = notes + off + sizeof(*nhdr) + name_size;
+#ifdef CRASH_REG_PC
+        if(nhdr->n_type == NT_PRSTATUS && !*have_regs
+           && nhdr->n_descsz >= sizeof(prstatus)) {
+            memcpy(&prstatus, desc, sizeof(prstatus));
+            core->pc = prstatus.pr_reg[CRASH_REG_PC];
+            core->fp = prstatus.pr_reg[CRASH_REG_FP];
+            *have_regs = TRUE;
+        }
+#endif
+        if(nhdr->n_type == NT_FILE && core->files == NULL
+           && nhdr->n_descsz > 0) {
+            core->files = malloc(nhdr->n_descsz);
+            if(core->files) {
+                memcpy(core->files, desc, nhdr->n_descsz);
+                core->files_size = nhdr->n_descsz;
+            }
+        }
+        off += sizeof(*nhdr) + name_size + desc_size;
+    }
+}
+
+/* crash_core_open
+ * Opens a core dump and reads what the stack signature is taken from.
+ *
+ * Returns 0 on success, -1 if the core dump is not a 64 bit ELF core dump
+ * of this architecture.
+ */
+static int
+crash_core_open(struct crash_core *core, const char *path)
+{
+    Elf64_Ehdr ehdr;
+    char *notes = NULL;
+    size_t size = 0;
+    int have_regs = FALSE;
+    int i = 0;
+
+    memset(core, 0, sizeof(*core));
+    core->fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(core->fd < 0) {
+        return -1;
+    }
+    if(pread(core->fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr)
+       || memcmp(ehdr.e_ident, ELFMAG, SELFMAG)
+       || ehdr.e_ident[EI_CLASS] != ELFCLASS64
+       || ehdr.e_type != ET_CORE
+       || ehdr.e_phentsize != sizeof(Elf64_Phdr)
+       || ehdr.e_phnum == 0) {
+        goto FAIL;
+    }
+    core->phnum = ehdr.e_phnum;
+    size = core->phnum * sizeof(Elf64_Phdr);
+    core->phdrs = malloc(size);
+    if(core->phdrs == NULL
+       || pread(core->fd, core->phdrs, size, ehdr.e_phoff) != (ssize_t) size) {
+        goto FAIL;
+    }
+    for(i = 0; i < core->phnum; i++) {
+        size = core->phdrs[i].p_filesz;
+        if(core->phdrs[i].p_type != PT_NOTE || size > CRASH_NOTES_MAX) {
+            continue;
+        }
+        notes = malloc(size);
+        if(notes && pread(core->fd, notes, size, core->phdrs[i].p_offset)
+                    == (ssize_t) size) {
+            crash_core_notes(core, notes, size, &have_regs);
+        }
+        free(notes);
+    }
+    if(have_regs) {
+        return 0;
+    }
+
+FAIL:
+    crash_core_close(core);
+    return -1;
+}
+
+/* crash_core_read
+ * Reads memory of the crashed process out of the core dump.
+ *
+ * Returns 0 on success, -1 if the memory is not in the core dump.
+ */
+static int
+crash_core_read(const struct crash_core *core, uint64_t addr, void *buf,
+                size_t len)
+{
+    const Elf64_Phdr *ph = NULL;
+    int i = 0;
+
+    for(i = 0; i < core->phnum; i++) {
+        ph = &core->phdrs[i];
+        if(ph->p_type == PT_LOAD && addr >= ph->p_vaddr
+           && addr - ph->p_vaddr + len <= ph->p_filesz) {
+            return (pread(core->fd, buf, len,
+                          ph->p_offset + (addr - ph->p_vaddr))
+                    == (ssize_t) len) ? 0 : -1;
+        }
+    }
+    return -1;
+}
+
+/* crash_core_site
+ * Describes an address as the file it is mapped from and the offset in that
+ * file, which stays the same across runs of the process.
+ *
+ * Returns 0 on success, -1 if the address is not in a mapped file.
+ */
+static int
+crash_core_site(const struct crash_core *core, uint64_t addr, char *site,
+                size_t size)
+{
+    const uint64_t *map = NULL;
+    const char *name = NULL, *end = NULL, *base = NULL;
+    uint64_t count = 0, page_size = 0, i = 0;
+
+    if(core->files == NULL || core->files_size < 2 * sizeof(uint64_t)) {
+        return -1;
+    }
+    /* NT_FILE: count, page size, count (start, end, page offset) triples,
+     * then count file names */
+    map = (const uint64_t *) core->files;
+    count = map[0];
+    page_size = map[1];
+    if(count > (core->files_size / sizeof(uint64_t) - 2) / 3) {
+        return -1;
+    }
+    map += 2;
+    name = (const char *) (map + 3 * count);
+    end = core->files + core->files_size;
+    for(i = 0; i < count && name < end; i++, map += 3) {
+        if(memchr(name, '\0', end - name) == NULL) {
+            return -1;
+        }
+        if(addr >= map[0] && addr < map[1]) {
+            base = strrchr(name, '/');
+            snprintf(site, size, "%s+0x%" PRIx64, base ? base + 1 : name,
+                     addr - map[0] + map[2] * page_size);
+            return 0;
+        }
+        name += strlen(name) + 1;
+    }
+    return -1;
+}
+
+/* crash_stack_signature
+ * Computes the stack signature of a crash: the process, the signal and the
+ * frames of the crashing thread, each as a file and an offset in it. Frames
+ * are found through the frame pointer chain, the walk ends at the first
+ * frame it cannot follow.
+ *
+ * Returns 0 on success, -1 if the core dump can not be read.
+ */
+static int
+crash_stack_signature(const char *path, const char *process, int signal_num,
+                      struct crash_signature *sig)
+{
+    struct crash_core core;
+    char site[CRASH_SITE_SIZE];
+    uint64_t frame[2];              /* saved frame pointer, return address */
+    uint64_t hash = 14695981039346656037ull;
+    uint64_t addr = 0, fp = 0;
+    int i = 0;
+
+    if(crash_core_open(&core, path)) {
+        return -1;
+    }
+    memset(sig, 0, sizeof(*sig));
+    crash_hash64(&hash, process, strlen(process) + 1);
+    crash_hash64(&hash, &signal_num, sizeof(signal_num));
+
+    addr = core.pc;
+    fp = core.fp;
+    for(i = 0; i < CRASH_SIG_FRAMES; i++) {
+        if(crash_core_site(&core, addr, site, sizeof(site))) {
+            break;
+        }
+        if(i == 0) {
+            strncpy(sig->site, site, sizeof(sig->site) - 1);
+        }
+        crash_hash64(&hash, site, strlen(site) + 1);
+        /* callers' frames are above on the stack */
+        if(fp == 0 || crash_core_read(&core, fp, frame, sizeof(frame))
+           || frame[0] <= fp) {
+            break;
+        }
+        fp = frame[0];
+        addr = frame[1];
+    }
+    if(i == 0) {
+        /* the crash is outside of any file, e.g. a call through NULL */
+        snprintf(sig->site, sizeof(sig->site), "0x%" PRIx64, core.pc);
+        crash_hash64(&hash, sig->site, strlen(sig->site) + 1);
+    }
+    crash_core_close(&core);
+
+    sig->hash = hash;
+    strncpy(sig->process, process, sizeof(sig->process) - 1);
+    /* the signature file is separated by blanks */
+    for(i = 0; sig->process[i]; i++) {
+        if(sig->process[i] == ' ') {
+            sig->process[i] = '_';
+        }
+    }
+    for(i = 0; sig->site[i]; i++) {
+        if(sig->site[i] == ' ') {
+            sig->site[i] = '_';
+        }
+    }
+    return 0;
+}
+
+/* crash_bt_frame
+ * Adds a frame to the backtrace: the function and offset when the binary
+ * has symbols, the file and offset otherwise.
+ */
+static int
+crash_bt_frame(Dwfl_Frame *state, void *arg)
+{
+    struct crash_bt *bt = arg;
+    Dwfl_Module *mod = NULL;
+    GElf_Sym sym;
+    GElf_Off offset = 0;
+    Dwarf_Addr pc = 0, start = 0;
+    const char *func = NULL, *file = NULL, *base = NULL;
+    bool activation = false;
+    int adjust = 0, len = 0;
+
+    if(!dwfl_frame_pc(state, &pc, &activation)) {
+        return DWARF_CB_ABORT;
+    }
+    /* a return address is after the call, the call itself is looked up */
+    adjust = activation ? 0 : 1;
+    mod = dwfl_addrmodule(bt->dwfl, pc - adjust);
+    if(mod) {
+        func = dwfl_module_addrinfo(mod, pc - adjust, &offset, &sym,
+                                    NULL, NULL, NULL);
+        file = dwfl_module_info(mod, NULL, &start, NULL, NULL, NULL,
+                                NULL, NULL);
+    }
+    base = file ? strrchr(file, '/') : NULL;
+    file = base ? base + 1 : file;
+
+    if(func) {
+        len = snprintf(bt->buf + bt->len, bt->size - bt->len,
+                       "#%d %s+0x%" PRIx64 " (%s)\n", bt->frames, func,
+                       (uint64_t) offset + adjust, file ? file : "??");
+    }
+    else if(file) {
+        len = snprintf(bt->buf + bt->len, bt->size - bt->len,
+                       "#%d %s+0x%" PRIx64 "\n", bt->frames, file,
+                       (uint64_t) (pc - start));
+    }
+    else {
+        len = snprintf(bt->buf + bt->len, bt->size - bt->len,
+                       "#%d 0x%" PRIx64 "\n", bt->frames, (uint64_t) pc);
+    }
+    if(len < 0 || (size_t) len >= bt->size - bt->len) {
+        bt->buf[bt->len] = '\0';
+        return DWARF_CB_ABORT;
+    }
+    bt->len += len;
+    bt->frames++;
+    return (bt->frames < CRASH_BT_FRAMES) ? DWARF_CB_OK : DWARF_CB_ABORT;
+}
+
+/* crash_bt_thread
+ * Unwinds the first thread of the core dump, the one which crashed.
+ */
+static int
+crash_bt_thread(Dwfl_Thread *thread, void *arg)
+{
+    /* fails once a frame can not be unwound, the frames found until then
+     * are kept */
+    dwfl_thread_getframes(thread, crash_bt_frame, arg);
+    return DWARF_CB_ABORT;
+}
+
+/* crash_backtrace
+ * Unwinds the crashing thread of a core dump. Only the binaries and debug
+ * information found on the switch are used.
+ *
+ * Returns 0 on success, -1 if no frame could be unwound.
+ */
+static int
+crash_backtrace(const char *path, char *buf, size_t size)
+{
+    static const Dwfl_Callbacks callbacks = {
+        .find_elf = dwfl_build_id_find_elf,
+        .find_debuginfo = dwfl_standard_find_debuginfo,
+    };
+    struct crash_bt bt;
+    Elf *elf = NULL;
+    int fd = -1;
+    int rc = -1;
+
+    memset(&bt, 0, sizeof(bt));
+    buf[0] = '\0';
+    elf_version(EV_CURRENT);
+    fd = open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return -1;
+    }
+    elf = elf_begin(fd, ELF_C_READ_MMAP, NULL);
+    bt.dwfl = elf ? dwfl_begin(&callbacks) : NULL;
+    if(bt.dwfl == NULL
+       || dwfl_core_file_report(bt.dwfl, elf, NULL) < 0
+       || dwfl_report_end(bt.dwfl, NULL, NULL) != 0
+       || dwfl_core_file_attach(bt.dwfl, elf) < 0) {
+        VLOG_DBG("Failed to unwind %s: %s", path, dwfl_errmsg(-1));
+        goto EXIT;
+    }
+    bt.buf = buf;
+    bt.size = size;
+    dwfl_getthreads(bt.dwfl, crash_bt_thread, &bt);
+    if(bt.frames > 0) {
+        /* the last frame's line break is not stored */
+        buf[bt.len - 1] = '\0';
+        rc = 0;
+    }
+
+EXIT:
+    if(bt.dwfl) {
+        dwfl_end(bt.dwfl);
+    }
+    if(elf) {
+        elf_end(elf);
+    }
+    close(fd);
+    return rc;
+}
+
+/* crash_signature_find
+ * Returns the known signature with hash, NULL if there is none.
+ */
+static struct crash_signature *
+crash_signature_find(uint64_t hash)
+{
+    size_t i = 0;
+
+    for(i = 0; i < num_signatures; i++) {
+        if(signatures[i].hash == hash) {
+            return &signatures[i];
+        }
+    }
+    return NULL;
+}
+
+/* crash_signature_add
+ * Returns the added signature, NULL on failure.
+ */
+static struct crash_signature *
+crash_signature_add(const struct crash_signature *sig)
+{
+    struct crash_signature *grown = NULL;
+
+    grown = realloc(signatures, (num_signatures + 1) * sizeof(*signatures));
+    if(grown == NULL) {
+        VLOG_ERR("Memory allocation failure");
+        return NULL;
+    }
+    signatures = grown;
+    signatures[num_signatures] = *sig;
+    return &signatures[num_signatures++];
+}
+
+/* crash_signature_save
+ * Rewrites CRASH_SIGNATURE_DB with the known signatures.
+ */
+static void
+crash_signature_save(void)
+{
+    char tmp_path[CRASH_NAME_SIZE];
+    FILE *fp = NULL;
+    size_t i = 0;
+
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", CRASH_SIGNATURE_DB);
+    fp = fopen(tmp_path, "w");
+    if(fp == NULL) {
+        VLOG_ERR("Failed to update %s: %s", CRASH_SIGNATURE_DB,
+                 strerror(errno));
+        return;
+    }
+    for(i = 0; i < num_signatures; i++) {
+        fprintf(fp, "%016" PRIx64 " %u %u %s %s\n", signatures[i].hash,
+                signatures[i].seen, signatures[i].discarded,
+                signatures[i].process, signatures[i].site);
+    }
+    if(fclose(fp) || rename(tmp_path, CRASH_SIGNATURE_DB)) {
+        VLOG_ERR("Failed to update %s: %s", CRASH_SIGNATURE_DB,
+                 strerror(errno));
+        unlink(tmp_path);
+    }
+}
+
+/* crash_signature_load
+ * Loads the known signatures, and finds the core dumps stored for them by
+ * the signature attribute set on each of them.
+ */
+static void
+crash_signature_load(void)
+{
+    struct crash_signature sig, *known = NULL;
+    struct dirent *de = NULL;
+    char path[CRASH_NAME_SIZE * 2];
+    char value[CRASH_ATTR_SIZE];
+    FILE *fp = NULL;
+    DIR *dp = NULL;
+    int i = 0;
+
+    fp = fopen(CRASH_SIGNATURE_DB, "r");
+    memset(&sig, 0, sizeof(sig));
+    while(fp && fscanf(fp, "%" SCNx64 " %u %u %63s %127s", &sig.hash,
+                       &sig.seen, &sig.discarded, sig.process,
+                       sig.site) == 5) {
+        if(crash_signature_find(sig.hash) == NULL) {
+            crash_signature_add(&sig);
+        }
+        memset(&sig, 0, sizeof(sig));
+    }
+    if(fp) {
+        fclose(fp);
+    }
+
+    dp = opendir(CRASH_CORE_DIR);
+    while(dp && (de = readdir(dp)) != NULL) {
+        if(fnmatch(CRASH_CORE_PATTERN, de->d_name, FNM_PERIOD) != 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", CRASH_CORE_DIR, de->d_name);
+        if(crash_get_attr(path, CRASH_SIG_XATTR, value, sizeof(value))) {
+            continue;
+        }
+        known = crash_signature_find(strtoull(value, NULL, 16));
+        for(i = 0; known && i < CRASH_DEDUP_KEEP; i++) {
+            if(known->kept[i][0] == '\0') {
+                strncpy(known->kept[i], de->d_name, CRASH_NAME_SIZE - 1);
+                break;
+            }
+        }
+    }
+    if(dp) {
+        closedir(dp);
+    }
+}
+
+/* crash_write_all
+ * Returns 0 when all of buf was written, -1 on failure.
+ */
+static int
+crash_write_all(int fd, const void *buf, size_t len)
+{
+    const char *p = buf;
+    ssize_t n = 0;
+
+    while(len > 0) {
+        n = write(fd, p, len);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* crash_copy_xattrs
+ * Copies the extended attributes of a core dump to its new version, the
+ * core dump information lives in them.
+ *
+ * Returns 0 on success, -1 if one of systemd-coredump could not be copied.
+ */
+static int
+crash_copy_xattrs(int src, int dst, const char *name)
+{
+    char attrs[CRASH_XATTR_LIST_SIZE];
+    char value[CRASH_XATTR_VALUE_SIZE];
+    const char *attr = NULL;
+    ssize_t len = 0, attrs_len = 0;
+
+    attrs_len = flistxattr(src, attrs, sizeof(attrs));
+    for(attr = attrs; attrs_len > 0 && attr < attrs + attrs_len;
+        attr += strlen(attr) + 1) {
+        len = fgetxattr(src, attr, value, sizeof(value));
+        if(len < 0 || fsetxattr(dst, attr, value, len, 0)) {
+            if(!strncmp(attr, "user.coredump.", strlen("user.coredump."))) {
+                VLOG_ERR("Failed to copy %s of %s: %s", attr, name,
+                         strerror(errno));
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* crash_read_all
+ * Reads up to size bytes, short only at the end of the file.
+ *
+ * Returns the number of bytes read, -1 on failure.
+ */
+static ssize_t
+crash_read_all(int fd, void *buf, size_t size)
+{
+    char *p = buf;
+    ssize_t n = 0;
+
+    while(size > 0) {
+        n = read(fd, p, size);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n < 0) {
+            return -1;
+        }
+        if(n == 0) {
+            break;
+        }
+        p += n;
+        size -= n;
+    }
+    return p - (char *) buf;
+}
+
+/* crash_sink_open
+ * Sets up writing a core dump to fd, as is or, when zstd is set, compressed
+ * with zstd.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+crash_sink_open(struct crash_sink *sink, int fd, int zstd)
+{
+    memset(sink, 0, sizeof(*sink));
+    sink->fd = fd;
+    if(!zstd) {
+        return 0;
+    }
+    sink->size = ZSTD_CStreamOutSize();
+    sink->cctx = ZSTD_createCCtx();
+    sink->buf = malloc(sink->size);
+    if(sink->cctx == NULL || sink->buf == NULL) {
+        VLOG_ERR("Memory allocation failure");
+        return -1;
+    }
+    ZSTD_CCtx_setParameter(sink->cctx, ZSTD_c_compressionLevel,
+                           CRASH_ZSTD_LEVEL);
+    ZSTD_CCtx_setParameter(sink->cctx, ZSTD_c_checksumFlag, 1);
+    return 0;
+}
+
+/* crash_sink_write
+ * Writes len bytes of a core dump, last ends the zstd stream. A core dump
+ * written as is stops once the file system is about to fill up.
+ *
+ * Returns 0 on success, 1 when the file system is about to fill up, -1 on
+ * other failures.
+ */
+static int
+crash_sink_write(struct crash_sink *sink, const void *data, size_t len,
+                 int last)
+{
+    ZSTD_inBuffer in = { data, len, 0 };
+    ZSTD_outBuffer out;
+    struct statvfs vfs;
+    size_t remaining = 0;
+
+    if(sink->cctx == NULL) {
+        sink->unchecked += len;
+        if(sink->unchecked >= CRASH_SPACE_CHECK) {
+            sink->unchecked = 0;
+            if(fstatvfs(sink->fd, &vfs) == 0
+               && (uint64_t) vfs.f_bavail * vfs.f_frsize
+                  < CRASH_SPACE_RESERVE) {
+                return 1;
+            }
+        }
+        return crash_write_all(sink->fd, data, len);
+    }
+    do {
+        out.dst = sink->buf;
+        out.size = sink->size;
+        out.pos = 0;
+        remaining = ZSTD_compressStream2(sink->cctx, &out, &in,
+                                         last ? ZSTD_e_end : ZSTD_e_continue);
+        if(ZSTD_isError(remaining)) {
+            VLOG_ERR("zstd compression failed: %s",
+                     ZSTD_getErrorName(remaining));
+            return -1;
+        }
+        if(crash_write_all(sink->fd, sink->buf, out.pos)) {
+            return -1;
+        }
+    } while(last ? remaining != 0 : in.pos < in.size);
+    return 0;
+}
+
+/* crash_sink_close
+ * Releases what writing a core dump needed.
+ */
+static void
+crash_sink_close(struct crash_sink *sink)
+{
+    ZSTD_freeCCtx(sink->cctx);
+    free(sink->buf);
+    memset(sink, 0, sizeof(*sink));
+}
+
+/* crash_unxz
+ * Decompresses the xz streams read from src in to sink.
+ *
+ * Returns 0 on success, 1 when the file system is about to fill up, -1 on
+ * other failures.
+ */
+static int
+crash_unxz(int src, struct crash_sink *sink, char *in_buf, char *out_buf)
+{
+    lzma_stream strm = LZMA_STREAM_INIT;
+    lzma_action action = LZMA_RUN;
+    lzma_ret ret = LZMA_OK;
+    ssize_t len = 0;
+    int rc = -1;
+
+    /* systemd-coredump may write several streams */
+    if(lzma_stream_decoder(&strm, UINT64_MAX, LZMA_CONCATENATED) != LZMA_OK) {
+        return -1;
+    }
+    strm.next_out = (uint8_t *) out_buf;
+    strm.avail_out = CRASH_COPY_BUF;
+    while(ret == LZMA_OK) {
+        if(strm.avail_in == 0 && action == LZMA_RUN) {
+            len = crash_read_all(src, in_buf, CRASH_COPY_BUF);
+            if(len < 0) {
+                goto EXIT;
+            }
+            strm.next_in = (const uint8_t *) in_buf;
+            strm.avail_in = len;
+            if(len < CRASH_COPY_BUF) {
+                action = LZMA_FINISH;
+            }
+        }
+        ret = lzma_code(&strm, action);
+        if(strm.avail_out == 0 || ret == LZMA_STREAM_END) {
+            len = CRASH_COPY_BUF - strm.avail_out;
+            rc = crash_sink_write(sink, out_buf, len, FALSE);
+            if(rc) {
+                goto EXIT;
+            }
+            rc = -1;
+            strm.next_out = (uint8_t *) out_buf;
+            strm.avail_out = CRASH_COPY_BUF;
+        }
+    }
+    if(ret == LZMA_STREAM_END) {
+        rc = 0;
+    }
+
+EXIT:
+    lzma_end(&strm);
+    return rc;
+}
+
+/* crash_unlz4
+ * Decompresses the lz4 frames read from src in to sink.
+ *
+ * Returns 0 on success, 1 when the file system is about to fill up, -1 on
+ * other failures.
+ */
+static int
+crash_unlz4(int src, struct crash_sink *sink, char *in_buf, char *out_buf)
+{
+    LZ4F_decompressionContext_t dctx = NULL;
+    size_t hint = 0, in_len = 0, out_len = 0, pos = 0;
+    ssize_t len = 0;
+    int ended = FALSE, rc = -1;
+
+    if(LZ4F_isError(LZ4F_createDecompressionContext(&dctx, LZ4F_VERSION))) {
+        return -1;
+    }
+    while((len = crash_read_all(src, in_buf, CRASH_COPY_BUF)) > 0) {
+        pos = 0;
+        /* a full output buffer may leave more output behind */
+        do {
+            in_len = len - pos;
+            out_len = CRASH_COPY_BUF;
+            hint = LZ4F_decompress(dctx, out_buf, &out_len, in_buf + pos,
+                                   &in_len, NULL);
+            if(LZ4F_isError(hint)) {
+                goto EXIT;
+            }
+            rc = crash_sink_write(sink, out_buf, out_len, FALSE);
+            if(rc) {
+                goto EXIT;
+            }
+            rc = -1;
+            /* a hint of 0 tells the frame ended */
+            if(in_len || out_len) {
+                ended = (hint == 0);
+            }
+            pos += in_len;
+        } while(pos < (size_t) len || out_len == CRASH_COPY_BUF);
+    }
+    if(len == 0 && ended) {
+        rc = 0;
+    }
+
+EXIT:
+    LZ4F_freeDecompressionContext(dctx);
+    return rc;
+}
+
+/* crash_xz_size
+ * Reads the size of the core dump compressed with xz in fd from the
+ * indexes of its streams, which are walked from the end of the file.
+ *
+ * Returns the size, -1 if it could not be read.
+ */
+static int64_t
+crash_xz_size(int fd)
+{
+    uint8_t footer[LZMA_STREAM_HEADER_SIZE];
+    lzma_stream_flags flags;
+    lzma_index *index = NULL;
+    uint8_t *buf = NULL;
+    uint64_t memlimit = 0;
+    size_t in_pos = 0;
+    int64_t size = 0;
+    struct stat st;
+    off_t pos = 0;
+
+    if(fstat(fd, &st)) {
+        return -1;
+    }
+    pos = st.st_size;
+    while(pos > 0) {
+        if(pos < 2 * LZMA_STREAM_HEADER_SIZE
+           || pread(fd, footer, sizeof(footer), pos - sizeof(footer))
+              != sizeof(footer)) {
+            return -1;
+        }
+        /* stream padding, a multiple of four null bytes */
+        if(!footer[8] && !footer[9] && !footer[10] && !footer[11]) {
+            pos -= 4;
+            continue;
+        }
+        if(lzma_stream_footer_decode(&flags, footer) != LZMA_OK
+           || flags.backward_size > CRASH_XZ_INDEX_MAX
+           || pos < (off_t) (2 * LZMA_STREAM_HEADER_SIZE
+                             + flags.backward_size)) {
+            return -1;
+        }
+        buf = malloc(flags.backward_size);
+        if(buf == NULL
+           || pread(fd, buf, flags.backward_size,
+                    pos - sizeof(footer) - flags.backward_size)
+              != (ssize_t) flags.backward_size) {
+            free(buf);
+            return -1;
+        }
+        in_pos = 0;
+        memlimit = UINT64_MAX;
+        index = NULL;
+        if(lzma_index_buffer_decode(&index, &memlimit, NULL, buf, &in_pos,
+                                    flags.backward_size) != LZMA_OK) {
+            free(buf);
+            return -1;
+        }
+        free(buf);
+        size += lzma_index_uncompressed_size(index);
+        if(lzma_index_stream_size(index) > (lzma_vli) pos) {
+            lzma_index_end(index, NULL);
+            return -1;
+        }
+        pos -= lzma_index_stream_size(index);
+        lzma_index_end(index, NULL);
+    }
+    return size;
+}
+
+/* crash_lz4_size
+ * Reads the size of the core dump compressed with lz4 in fd from the header
+ * of its frame, systemd-coredump writes one.
+ *
+ * Returns the size, -1 if the frame does not tell it.
+ */
+static int64_t
+crash_lz4_size(int fd)
+{
+    /* magic number, FLG, BD and the content size when FLG has 0x08 */
+    unsigned char header[14];
+    uint64_t size = 0;
+    int i = 0;
+
+    if(pread(fd, header, sizeof(header), 0) != sizeof(header)
+       || header[0] != 0x04 || header[1] != 0x22 || header[2] != 0x4d
+       || header[3] != 0x18 || !(header[4] & 0x08)) {
+        return -1;
+    }
+    for(i = 7; i >= 0; i--) {
+        size = (size << 8) | header[6 + i];
+    }
+    return (int64_t) size;
+}
+
+/* crash_expand
+ * Decompresses the core dump read from src in to dst, written as is or
+ * compressed with zstd, with the same owner, mode and extended attributes.
+ *
+ * Returns 0 on success, 1 when the file system is about to fill up, -1 on
+ * other failures. dst is not created on failure.
+ */
+static int
+crash_expand(int src, const struct stat *st, const char *name,
+             const char *dst, int xz, int zstd)
+{
+    char dst_path[CRASH_NAME_SIZE * 2];
+    char tmp_path[CRASH_NAME_SIZE * 2];
+    char *in_buf = NULL, *out_buf = NULL;
+    struct crash_sink sink;
+    int fd = -1, rc = -1;
+
+    snprintf(dst_path, sizeof(dst_path), "%s/%s", CRASH_CORE_DIR, dst);
+    /* hidden until complete, the core dump patterns do not match it */
+    snprintf(tmp_path, sizeof(tmp_path), "%s/.%s", CRASH_CORE_DIR, dst);
+    memset(&sink, 0, sizeof(sink));
+
+    if(lseek(src, 0, SEEK_SET) < 0) {
+        return -1;
+    }
+    fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+              S_IRUSR | S_IWUSR);
+    if(fd < 0) {
+        VLOG_ERR("Failed to create %s: %s", tmp_path, strerror(errno));
+        return -1;
+    }
+    if(fchown(fd, st->st_uid, st->st_gid) || fchmod(fd, st->st_mode & 07777)) {
+        VLOG_DBG("Failed to set the owner of %s: %s", tmp_path,
+                 strerror(errno));
+    }
+    in_buf = malloc(CRASH_COPY_BUF);
+    out_buf = malloc(CRASH_COPY_BUF);
+    if(in_buf == NULL || out_buf == NULL) {
+        VLOG_ERR("Memory allocation failure");
+        goto EXIT;
+    }
+    if(crash_sink_open(&sink, fd, zstd)) {
+        goto EXIT;
+    }
+    rc = xz ? crash_unxz(src, &sink, in_buf, out_buf)
+            : crash_unlz4(src, &sink, in_buf, out_buf);
+    if(rc == 0) {
+        rc = crash_sink_write(&sink, NULL, 0, TRUE);
+    }
+    if(rc) {
+        if(rc < 0) {
+            VLOG_ERR("Failed to decompress %s", name);
+        }
+        goto EXIT;
+    }
+    rc = -1;
+    if(crash_copy_xattrs(src, fd, name) || fsync(fd)) {
+        goto EXIT;
+    }
+    /* marked before it appears, its inotify event is then ignored */
+    crash_mark_processed(dst);
+    if(rename(tmp_path, dst_path)) {
+        VLOG_ERR("Failed to rename %s: %s", tmp_path, strerror(errno));
+        goto EXIT;
+    }
+    rc = 0;
+
+EXIT:
+    if(rc) {
+        unlink(tmp_path);
+    }
+    close(fd);
+    crash_sink_close(&sink);
+    free(in_buf);
+    free(out_buf);
+    return rc;
+}
+
+/* crash_decompress
+ * Replaces a core dump systemd-coredump compressed with xz or lz4 by the
+ * plain core dump, so that it can be unwound and compressed with zstd like
+ * the others. When the plain core dump does not fit in the file system,
+ * the decompressed core dump is streamed in to zstd instead and it is
+ * stored without its stack signature and backtrace. The name of the new
+ * core dump is returned in out.
+ *
+ * Returns 0 on success, -1 on failure, the core dump is then left as is.
+ */
+static int
+crash_decompress(const char *name, char *out, size_t size)
+{
+    char src_path[CRASH_NAME_SIZE * 2];
+    const char *ext = NULL;
+    struct statvfs vfs;
+    struct stat st;
+    int64_t expanded = 0;
+    size_t len = strlen(name);
+    int src = -1, xz = FALSE, rc = -1;
+
+    ext = strrchr(name, '.');
+    if(ext && !strcmp(ext, CRASH_XZ_EXT)) {
+        xz = TRUE;
+    }
+    else if(ext == NULL || strcmp(ext, CRASH_LZ4_EXT)) {
+        return -1;
+    }
+    len -= strlen(ext);
+    if(len + strlen(CRASH_COMPRESSED_EXT) >= size) {
+        return -1;
+    }
+    memcpy(out, name, len);
+    out[len] = '\0';
+    snprintf(src_path, sizeof(src_path), "%s/%s", CRASH_CORE_DIR, name);
+
+    src = open(src_path, O_RDONLY | O_CLOEXEC);
+    if(src < 0 || fstat(src, &st)) {
+        goto EXIT;
+    }
+    /* the plain core dump is written only when it leaves CRASH_SPACE_RESERVE
+     * free, when its size is not known the sink stops short of that */
+    expanded = xz ? crash_xz_size(src) : crash_lz4_size(src);
+    if(expanded < 0 || fstatvfs(src, &vfs)
+       || (uint64_t) expanded + CRASH_SPACE_RESERVE
+          <= (uint64_t) vfs.f_bavail * vfs.f_frsize) {
+        rc = crash_expand(src, &st, name, out, xz, FALSE);
+    }
+    else {
+        rc = 1;
+    }
+    if(rc > 0) {
+        VLOG_INFO("No space to decompress %s, it is stored without a "
+                  "backtrace", name);
+        strcat(out, CRASH_COMPRESSED_EXT);
+        rc = crash_expand(src, &st, name, out, xz, TRUE);
+    }
+    if(rc == 0) {
+        unlink(src_path);
+    }
+
+EXIT:
+    if(src >= 0) {
+        close(src);
+    }
+    return rc ? -1 : 0;
+}
+
+/* crash_compress
+ * Replaces a core dump with its zstd compressed version, with the same
+ * owner, mode and extended attributes. The name it is stored under is
+ * returned in stored.
+ *
+ * Returns 0 on success, -1 on failure, the core dump is then left as is.
+ */
+static int
+crash_compress(const char *name, char *stored, size_t size)
+{
+    char src_path[CRASH_NAME_SIZE * 2];
+    char tmp_path[CRASH_NAME_SIZE * 2];
+    char dst_path[CRASH_NAME_SIZE * 2];
+    struct crash_sink sink;
+    struct stat st;
+    char *in_buf = NULL;
+    size_t in_size = ZSTD_CStreamInSize();
+    ssize_t len = 0;
+    int src = -1, dst = -1, last = FALSE, rc = -1;
+
+    if(snprintf(stored, size, "%s%s", name, CRASH_COMPRESSED_EXT)
+       >= (int) size) {
+        return -1;
+    }
+    snprintf(src_path, sizeof(src_path), "%s/%s", CRASH_CORE_DIR, name);
+    snprintf(dst_path, sizeof(dst_path), "%s/%s", CRASH_CORE_DIR, stored);
+    /* hidden until complete, the core dump patterns do not match it */
+    snprintf(tmp_path, sizeof(tmp_path), "%s/.%s", CRASH_CORE_DIR, stored);
+    memset(&sink, 0, sizeof(sink));
+
+    src = open(src_path, O_RDONLY | O_CLOEXEC);
+    if(src < 0 || fstat(src, &st)) {
+        goto EXIT;
+    }
+    dst = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+               S_IRUSR | S_IWUSR);
+    if(dst < 0) {
+        VLOG_ERR("Failed to create %s: %s", tmp_path, strerror(errno));
+        goto EXIT;
+    }
+    if(fchown(dst, st.st_uid, st.st_gid) || fchmod(dst, st.st_mode & 07777)) {
+        VLOG_DBG("Failed to set the owner of %s: %s", tmp_path,
+                 strerror(errno));
+    }
+
+    in_buf = malloc(in_size);
+    if(in_buf == NULL) {
+        VLOG_ERR("Memory allocation failure");
+        goto EXIT;
+    }
+    if(crash_sink_open(&sink, dst, TRUE)) {
+        goto EXIT;
+    }
+    ZSTD_CCtx_setPledgedSrcSize(sink.cctx, st.st_size);
+
+    do {
+        len = read(src, in_buf, in_size);
+        if(len < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            VLOG_ERR("Failed to read %s: %s", src_path, strerror(errno));
+            goto EXIT;
+        }
+        last = (len == 0);
+        if(crash_sink_write(&sink, in_buf, len, last)) {
+            VLOG_ERR("Failed to compress %s", name);
+            goto EXIT;
+        }
+    } while(!last);
+
+    if(crash_copy_xattrs(src, dst, name) || fsync(dst)) {
+        goto EXIT;
+    }
+    /* marked before it appears, its inotify event is then ignored */
+    crash_mark_processed(stored);
+    if(rename(tmp_path, dst_path)) {
+        VLOG_ERR("Failed to rename %s: %s", tmp_path, strerror(errno));
+        goto EXIT;
+    }
+    unlink(src_path);
+    rc = 0;
+
+EXIT:
+    if(rc && dst >= 0) {
+        unlink(tmp_path);
+    }
+    if(dst >= 0) {
+        close(dst);
+    }
+    if(src >= 0) {
+        close(src);
+    }
+    crash_sink_close(&sink);
+    free(in_buf);
+    return rc;
+}
+
+/* crash_notify_send
+ * Announces a crash to the subscribers, a subscriber whose socket is full
+ * misses it and one which is gone is shut down for the main thread to
+ * close.
+ */
+static void
+crash_notify_send(const struct crash_notification *n)
+{
+    char msg[CRASH_NOTIFY_MSG_SIZE];
+    int len = crash_notify_format(n, msg, sizeof(msg));
+    int i = 0;
+
+    if(len < 0) {
+        return;
+    }
+    pthread_mutex_lock(&notify_mutex);
+    for(i = 0; i < num_subscribers; i++) {
+        if(send(subscribers[i], msg, len, MSG_DONTWAIT | MSG_NOSIGNAL) == len) {
+            continue;
+        }
+        if(errno == EAGAIN || errno == EWOULDBLOCK) {
+            VLOG_DBG("Crash of %s not announced to a slow subscriber",
+                     n->process);
+        }
+        else {
+            shutdown(subscribers[i], SHUT_RDWR);
+        }
+    }
+    pthread_mutex_unlock(&notify_mutex);
+}
+
+/* crash_notify_prepare
+ * Fills the notification of a crash with what systemd-coredump recorded.
+ */
+static void
+crash_notify_prepare(struct crash_notification *n, const char *path,
+                     const char *process, int signal_num, pid_t pid)
+{
+    char value[CRASH_ATTR_SIZE];
+
+    memset(n, 0, sizeof(*n));
+    strncpy(n->process, process, sizeof(n->process) - 1);
+    n->pid = pid;
+    n->signal_num = signal_num;
+    if(crash_get_attr(path, "user.coredump.timestamp", value,
+                      sizeof(value)) == 0) {
+        n->timestamp = atoll(value);
+    }
+}
+
+/* crash_superseded
+ * Returns TRUE if a later version of a core dump exists, stored by a run
+ * which stopped before removing it: the plain core dump or the zstd one of
+ * a core dump systemd-coredump compressed, the zstd one of a plain core
+ * dump. Versions are complete once they appear, they are renamed in to
+ * place.
+ */
+static int
+crash_superseded(const char *name)
+{
+    char path[CRASH_NAME_SIZE * 2];
+    const char *ext = strrchr(name, '.');
+    int len = strlen(name);
+
+    if(ext && (!strcmp(ext, CRASH_XZ_EXT) || !strcmp(ext, CRASH_LZ4_EXT))) {
+        len -= strlen(ext);
+        snprintf(path, sizeof(path), "%s/%.*s", CRASH_CORE_DIR, len, name);
+        if(access(path, F_OK) == 0) {
+            return TRUE;
+        }
+    }
+    else if(crash_is_compressed(name)) {
+        return FALSE;
+    }
+    snprintf(path, sizeof(path), "%s/%.*s%s", CRASH_CORE_DIR, len, name,
+             CRASH_COMPRESSED_EXT);
+    return access(path, F_OK) == 0;
+}
+
+/* crash_dedup_older
+ * Returns TRUE if kept core dump a is older than kept core dump b, the name
+ * orders core dumps of the same second as core dump retention does.
+ */
+static int
+crash_dedup_older(const struct crash_signature *known, const time_t *times,
+                  int a, int b)
+{
+    if(times[a] != times[b]) {
+        return times[a] < times[b];
+    }
+    return strcmp(known->kept[a], known->kept[b]) < 0;
+}
+
+/* crash_dedup_victim
+ * Picks the kept core dump of a signature a new one replaces: the oldest
+ * one other than the first, which is kept for good.
+ *
+ * Returns the slot of the core dump, -1 if there is none.
+ */
+static int
+crash_dedup_victim(const struct crash_signature *known)
+{
+    char path[CRASH_NAME_SIZE * 2];
+    time_t times[CRASH_DEDUP_KEEP];
+    struct stat st;
+    int i = 0, first = -1, victim = -1;
+
+    for(i = 0; i < CRASH_DEDUP_KEEP; i++) {
+        snprintf(path, sizeof(path), "%s/%s", CRASH_CORE_DIR,
+                 known->kept[i]);
+        if(known->kept[i][0] == '\0' || stat(path, &st)) {
+            return -1;
+        }
+        times[i] = st.st_mtime;
+        if(first < 0 || crash_dedup_older(known, times, i, first)) {
+            first = i;
+        }
+    }
+    for(i = 0; i < CRASH_DEDUP_KEEP; i++) {
+        if(i != first && (victim < 0
+                          || crash_dedup_older(known, times, i, victim))) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+/* crash_store
+ * Stores a processed core dump. A core dump systemd-coredump compressed is
+ * decompressed first. The first and the latest CRASH_DEDUP_KEEP - 1 core
+ * dumps of a stack signature are kept, a new one replaces the oldest kept
+ * core dump other than the first, and every crash is counted. Core dump
+ * retention prefers the same ones. A kept core dump gets its backtrace and
+ * is compressed with zstd.
+ *
+ * The core dump and its versions are journaled once stored. Storing is
+ * redone for a core dump the daemon stopped storing, from the last version
+ * which appeared: earlier versions are removed, a core dump already kept
+ * for its signature keeps its slot and its crash is not counted again.
+ */
+static void
+crash_store(const char *name, const char *process, int signal_num)
+{
+    struct crash_signature sig, *known = NULL;
+    const char *orig = name;
+    char path[CRASH_NAME_SIZE * 2];
+    char raw[CRASH_NAME_SIZE];
+    char stored[CRASH_NAME_SIZE];
+    char hash_str[CRASH_ATTR_SIZE];
+    char bt[CRASH_BT_SIZE];
+    char pid_str[CRASH_ATTR_SIZE];
+    struct crash_notification notification;
+    pid_t pid = 0;
+    int i = 0, slot = -1, victim = -1, kept_core = TRUE;
+
+    snprintf(path, sizeof(path), "%s/%s", CRASH_CORE_DIR, name);
+    /* an earlier version queued again after a restart, the later one is
+     * stored on its own */
+    if(access(path, F_OK)) {
+        return;
+    }
+    if(crash_superseded(name)) {
+        VLOG_DBG("Removing %s, a later version of it is stored", name);
+        unlink(path);
+        crash_journal_append(name);
+        return;
+    }
+    if(crash_is_compressed(name)
+       && strcmp(strrchr(name, '.'), CRASH_COMPRESSED_EXT)
+       && crash_decompress(name, raw, sizeof(raw)) == 0) {
+        name = raw;
+    }
+    if(snprintf(stored, sizeof(stored), "%s%s", name,
+                crash_is_compressed(name) ? "" : CRASH_COMPRESSED_EXT)
+       >= (int) sizeof(stored)) {
+        strncpy(stored, name, sizeof(stored) - 1);
+        stored[sizeof(stored) - 1] = '\0';
+    }
+    snprintf(path, sizeof(path), "%s/%s", CRASH_CORE_DIR, name);
+    if(crash_get_attr(path, "user.coredump.pid", pid_str,
+                      sizeof(pid_str)) == 0) {
+        pid = (pid_t) atoi(pid_str);
+    }
+    crash_notify_prepare(&notification, path, process, signal_num, pid);
+    if(!crash_is_compressed(name)
+       && crash_stack_signature(path, process, signal_num, &sig) == 0) {
+        known = crash_signature_find(sig.hash);
+        if(known == NULL) {
+            known = crash_signature_add(&sig);
+        }
+    }
+    /* a kept core dump compressed before the daemon stopped */
+    else if(crash_is_compressed(name)
+            && crash_get_attr(path, CRASH_SIG_XATTR, hash_str,
+                              sizeof(hash_str)) == 0) {
+        known = crash_signature_find(strtoull(hash_str, NULL, 16));
+    }
+
+    if(known) {
+        for(i = 0; i < CRASH_DEDUP_KEEP; i++) {
+            /* forget the kept core dumps which were deleted since */
+            snprintf(path, sizeof(path), "%s/%s", CRASH_CORE_DIR,
+                     known->kept[i]);
+            if(known->kept[i][0] && access(path, F_OK)) {
+                known->kept[i][0] = '\0';
+            }
+            if(!strcmp(known->kept[i], name)
+               || !strcmp(known->kept[i], stored)) {
+                slot = i;
+                break;
+            }
+        }
+        /* counted when it was first kept */
+        if(slot < 0) {
+            known->seen++;
+        }
+        for(i = 0; i < CRASH_DEDUP_KEEP && slot < 0; i++) {
+            if(known->kept[i][0] == '\0') {
+                slot = i;
+            }
+        }
+        /* all slots taken, the new core dump replaces a kept one */
+        victim = (slot < 0) ? crash_dedup_victim(known) : -1;
+        if(victim >= 0) {
+            snprintf(path, sizeof(path), "%s/%s", CRASH_CORE_DIR,
+                     known->kept[victim]);
+            if(unlink(path) == 0) {
+                VLOG_INFO("Core dump %s replaced by %s, %s crashed in %s %u "
+                          "times", known->kept[victim], name, known->process,
+                          known->site, known->seen);
+                core_retention_remove(known->kept[victim]);
+                known->kept[victim][0] = '\0';
+                known->discarded++;
+                slot = victim;
+            }
+            else {
+                VLOG_ERR("Failed to remove core dump %s: %s",
+                         known->kept[victim], strerror(errno));
+            }
+        }
+        snprintf(notification.signature, sizeof(notification.signature),
+                 "%016" PRIx64, known->hash);
+        strncpy(notification.site, known->site,
+                sizeof(notification.site) - 1);
+        notification.crashes = known->seen;
+        snprintf(path, sizeof(path), "%s/%s", CRASH_CORE_DIR, name);
+        if(slot < 0) {
+            known->discarded++;
+            if(pid > 0) {
+                flightrec_discard(pid);
+            }
+            /* removed before it is counted, it is not counted twice */
+            if(unlink(path) == 0) {
+                VLOG_INFO("Core dump %s not stored, %s crashed in %s %u times",
+                          name, known->process, known->site, known->seen);
+            }
+            crash_signature_save();
+            crash_journal_append(orig);
+            if(name != orig) {
+                crash_journal_append(name);
+            }
+            crash_notify_send(&notification);
+            return;
+        }
+        /* saved before the core dump carries its signature, a core dump
+         * with one was counted */
+        strncpy(known->kept[slot], stored, CRASH_NAME_SIZE - 1);
+        crash_signature_save();
+        snprintf(hash_str, sizeof(hash_str), "%016" PRIx64, known->hash);
+        setxattr(path, CRASH_SIG_XATTR, hash_str, strlen(hash_str), 0);
+    }
+    if(!crash_is_compressed(name) && crash_backtrace(path, bt, sizeof(bt)) == 0
+       && setxattr(path, CRASH_BT_XATTR, bt, strlen(bt), 0)) {
+        VLOG_ERR("Failed to store the backtrace of %s: %s", name,
+                 strerror(errno));
+    }
+
+    if(!crash_is_compressed(name)
+       && crash_compress(name, stored, sizeof(stored))) {
+        strncpy(stored, name, sizeof(stored) - 1);
+        if(known) {
+            strncpy(known->kept[slot], stored, CRASH_NAME_SIZE - 1);
+        }
+    }
+    snprintf(path, sizeof(path), "%s/%s%s", CRASH_CORE_DIR, stored,
+             FLIGHTREC_EXT);
+    if(pid > 0 && flightrec_snapshot(pid, process, path) == 0) {
+        VLOG_DBG("Flight recorder of %s stored with %s", process, stored);
+    }
+    kept_core = core_retention_add(stored, process,
+                                   known ? hash_str : NULL);
+
+    crash_journal_append(orig);
+    if(name != orig) {
+        crash_journal_append(name);
+    }
+    if(strcmp(stored, name)) {
+        crash_journal_append(stored);
+    }
+    /* the policy may have removed the new core dump itself, e.g. when it is
+     * already older than the age limit */
+    notification.stored = kept_core;
+    notification.evicted = !kept_core;
+    strncpy(notification.file, stored, sizeof(notification.file) - 1);
+    crash_notify_send(&notification);
+}
+
+/* crash_remove_flightrec
+ * Removes the flight recorder stored with a core dump which was deleted.
+ */
+static void
+crash_remove_flightrec(const char *name)
+{
+    char path[CRASH_NAME_SIZE * 2];
+
+    if(fnmatch(CRASH_CORE_PATTERN, name, FNM_PERIOD) != 0
+       || fnmatch(CRASH_FLIGHTREC_PATTERN, name, 0) == 0) {
+        return;
+    }
+    snprintf(path, sizeof(path), "%s/%s%s", CRASH_CORE_DIR, name,
+             FLIGHTREC_EXT);
+    unlink(path);
+}
+
+/* crash_worker
+ * Stores the processed core dumps, in the order they were processed.
+ */
+static void *
+crash_worker(void *arg)
+{
+    struct crash_job *job = NULL;
+
+    for(;;) {
+        pthread_mutex_lock(&crash_mutex);
+        while(jobs_head == NULL && !worker_stop && !sweep_pending) {
+            pthread_cond_wait(&crash_cond, &crash_mutex);
+        }
+        /* once the core dumps found on start up are stored, the flight
+         * recorders left are of processes which died without one */
+        if(jobs_head == NULL && sweep_pending) {
+            sweep_pending = FALSE;
+            pthread_mutex_unlock(&crash_mutex);
+            flightrec_sweep();
+            continue;
+        }
+        /* the queued core dumps are stored before stopping */
+        if(jobs_head == NULL) {
+            pthread_mutex_unlock(&crash_mutex);
+            break;
+        }
+        job = jobs_head;
+        jobs_head = job->next;
+        if(jobs_head == NULL) {
+            jobs_tail = NULL;
+        }
+        pthread_mutex_unlock(&crash_mutex);
+
+        crash_store(job->name, job->process, job->signal_num);
+        free(job);
+    }
+    return NULL;
+}
+
+/* crash_enqueue
+ * Hands a processed core dump over to the worker.
+ */
+static void
+crash_enqueue(const char *name, const char *process, int signal_num)
+{
+    struct crash_job *job = NULL;
+
+    job = calloc(1, sizeof(*job));
+    if(job == NULL) {
+        VLOG_ERR("Memory allocation failure");
+        return;
+    }
+    strncpy(job->name, name, sizeof(job->name) - 1);
+    strncpy(job->process, process, sizeof(job->process) - 1);
+    job->signal_num = signal_num;
+
+    pthread_mutex_lock(&crash_mutex);
+    if(jobs_tail) {
+        jobs_tail->next = job;
+    }
+    else {
+        jobs_head = job;
+    }
+    jobs_tail = job;
+    pthread_cond_signal(&crash_cond);
+    pthread_mutex_unlock(&crash_mutex);
+}
+
+/* crash_handle
+ * Processes a core dump unless it was processed already: logs the crash
+ * event and stores the core dump.
+ *
+ * Returns 1 if a crash event was logged, 0 otherwise.
+ */
+static int
+crash_handle(const char *name)
+{
+    char process[CRASH_ATTR_SIZE];
+    int signal_num = 0;
+    int rc = 0;
+
+    if(fnmatch(CRASH_CORE_PATTERN, name, FNM_PERIOD) != 0
+       || fnmatch(CRASH_FLIGHTREC_PATTERN, name, 0) == 0
+       || crash_is_processed(name)) {
+        return 0;
+    }
+    rc = crash_process_core(name, process, &signal_num);
+    if(rc < 0) {
+        VLOG_DBG("Invalid core dump file found %s", name);
+        crash_journal_append(name);
+        return 0;
+    }
+    /* journaled by the worker once stored */
+    crash_mark_processed(name);
+    crash_enqueue(name, process, signal_num);
+    return rc == 0;
+}
+
+/* crash_notify_listen
+ * Creates the subscription socket and adds it to the epoll set.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+crash_notify_listen(void)
+{
+    struct sockaddr_un addr;
+    struct epoll_event ev;
+
+    notify_fd = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                       0);
+    if(notify_fd < 0) {
+        VLOG_ERR("Failed to create the crash notification socket: %s",
+                 strerror(errno));
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, CRASH_NOTIFY_SOCKET, sizeof(addr.sun_path) - 1);
+    unlink(CRASH_NOTIFY_SOCKET);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = notify_fd;
+    /* crash notifications are no secret, show core-dump lists the same
+     * for any user */
+    if(bind(notify_fd, (struct sockaddr *) &addr, sizeof(addr))
+       || chmod(CRASH_NOTIFY_SOCKET, 0666)
+       || listen(notify_fd, CRASH_NOTIFY_MAX_SUBSCRIBERS)
+       || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, notify_fd, &ev)) {
+        VLOG_ERR("Failed to listen on %s: %s", CRASH_NOTIFY_SOCKET,
+                 strerror(errno));
+        close(notify_fd);
+        notify_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+/* crash_notify_accept
+ * Accepts the pending subscribers, they are watched for hang ups.
+ */
+static void
+crash_notify_accept(void)
+{
+    struct epoll_event ev;
+    int fd = -1;
+
+    while((fd = accept4(notify_fd, NULL, NULL,
+                        SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        pthread_mutex_lock(&notify_mutex);
+        if(num_subscribers == CRASH_NOTIFY_MAX_SUBSCRIBERS
+           || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev)) {
+            pthread_mutex_unlock(&notify_mutex);
+            VLOG_WARN("Crash notification subscriber refused");
+            close(fd);
+            continue;
+        }
+        subscribers[num_subscribers++] = fd;
+        pthread_mutex_unlock(&notify_mutex);
+    }
+}
+
+/* crash_notify_drop
+ * Closes a subscriber which hung up or was shut down.
+ */
+static void
+crash_notify_drop(int fd)
+{
+    int i = 0;
+
+    pthread_mutex_lock(&notify_mutex);
+    for(i = 0; i < num_subscribers; i++) {
+        if(subscribers[i] == fd) {
+            subscribers[i] = subscribers[--num_subscribers];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&notify_mutex);
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+    close(fd);
+}
+
+/* crash_notify_close
+ * Closes the subscribers and the subscription socket.
+ */
+static void
+crash_notify_close(void)
+{
+    pthread_mutex_lock(&notify_mutex);
+    while(num_subscribers > 0) {
+        close(subscribers[--num_subscribers]);
+    }
+    pthread_mutex_unlock(&notify_mutex);
+    if(notify_fd >= 0) {
+        close(notify_fd);
+        notify_fd = -1;
+        unlink(CRASH_NOTIFY_SOCKET);
+    }
+}
+
+/* crash_processing_init
+ * Starts crash processing, core dumps which were created while the daemon
+ * was not running are processed right away.
+ *
+ * Returns the epoll fd of the inotify fd and of the subscription socket on
+ * success, -1 on failure.
+ */
+int
+crash_processing_init(void)
+{
+    struct epoll_event ev;
+    struct dirent *de = NULL;
+    DIR *dp = NULL;
+
+    if(epoll_fd >= 0) {
+        return epoll_fd;
+    }
+    event_log_init(CRASH_EVENT_CATEGORY);
+    /* core dumps are unwound against the binaries on the switch only, debug
+     * information is never downloaded */
+    unsetenv("DEBUGINFOD_URLS");
+    crash_journal_open();
+    crash_signature_load();
+    core_retention_init();
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(inotify_fd < 0) {
+        VLOG_ERR("Failed to initialize inotify: %s", strerror(errno));
+        return -1;
+    }
+    /* watch before the scan, a core dump arriving in between is seen twice
+     * and processed once */
+    if(inotify_add_watch(inotify_fd, CRASH_CORE_DIR, CRASH_WATCH_EVENTS) < 0) {
+        VLOG_ERR("Failed to watch %s: %s", CRASH_CORE_DIR, strerror(errno));
+        close(inotify_fd);
+        inotify_fd = -1;
+        return -1;
+    }
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = inotify_fd;
+    if(epoll_fd < 0 || epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &ev)) {
+        VLOG_ERR("Failed to set up epoll: %s", strerror(errno));
+        if(epoll_fd >= 0) {
+            close(epoll_fd);
+            epoll_fd = -1;
+        }
+        close(inotify_fd);
+        inotify_fd = -1;
+        return -1;
+    }
+    /* crashes are still processed without subscribers */
+    crash_notify_listen();
+
+    sweep_pending = TRUE;
+    /* Check boot time core dumps */
+    dp = opendir(CRASH_CORE_DIR);
+    while(dp && (de = readdir(dp)) != NULL) {
+        if(de->d_type != DT_DIR) {
+            crash_handle(de->d_name);
+        }
+    }
+    if(dp) {
+        closedir(dp);
+    }
+    return epoll_fd;
+}
+
+/* crash_processing_run
+ * Handles the pending inotify events, only the announced files are
+ * looked at, and removes the core dumps which exceeded the age limit.
+ *
+ * Returns the number of crash events logged.
+ */
+int
+crash_processing_run(void)
+{
+    char buf[CRASH_EVENT_BUF]
+        __attribute__ ((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *ev = NULL;
+    struct epoll_event events[CRASH_EPOLL_EVENTS];
+    struct dirent *de = NULL;
+    const char *p = NULL;
+    ssize_t len = 0;
+    DIR *dp = NULL;
+    int overflow = FALSE;
+    int logged = 0;
+    int i = 0, n = 0;
+
+    if(inotify_fd < 0) {
+        return 0;
+    }
+    /* started here rather than at init, a daemon forks after init and
+     * the thread would not survive it */
+    if(!worker_started) {
+        worker_stop = FALSE;
+        if(pthread_create(&worker, NULL, crash_worker, NULL)) {
+            VLOG_ERR("Failed to start the crash processing worker");
+        }
+        else {
+            worker_started = TRUE;
+        }
+    }
+    /* subscribers come and go, inotify is read below in any case */
+    n = epoll_wait(epoll_fd, events, CRASH_EPOLL_EVENTS, 0);
+    for(i = 0; i < n; i++) {
+        if(events[i].data.fd == notify_fd) {
+            crash_notify_accept();
+        }
+        else if(events[i].data.fd != inotify_fd) {
+            /* subscribers send nothing, readable means gone */
+            crash_notify_drop(events[i].data.fd);
+        }
+    }
+    while((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+        for(p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+            ev = (const struct inotify_event *) p;
+            if(ev->mask & IN_Q_OVERFLOW) {
+                overflow = TRUE;
+                continue;
+            }
+            if(ev->len == 0 || (ev->mask & IN_ISDIR)) {
+                continue;
+            }
+            if(ev->mask & CRASH_GONE_EVENTS) {
+                core_retention_remove(ev->name);
+                crash_remove_flightrec(ev->name);
+                continue;
+            }
+            logged += crash_handle(ev->name);
+        }
+    }
+    if(overflow) {
+        /* events were lost, fall back to a scan of the directory */
+        dp = opendir(CRASH_CORE_DIR);
+        while(dp && (de = readdir(dp)) != NULL) {
+            if(de->d_type != DT_DIR) {
+                logged += crash_handle(de->d_name);
+            }
+        }
+        if(dp) {
+            closedir(dp);
+        }
+    }
+    core_retention_run();
+    return logged;
+}
+
+/* crash_processing_timeout
+ * Returns the msecs until crash processing must run again without a new
+ * core dump, -1 when it need not.
+ */
+int
+crash_processing_timeout(void)
+{
+    if(inotify_fd < 0) {
+        return -1;
+    }
+    return core_retention_timeout();
+}
+
+/* crash_processing_destroy
+ * Stops crash processing.
+ */
+void
+crash_processing_destroy(void)
+{
+    struct crash_job *job = NULL;
+
+    if(worker_started) {
+        pthread_mutex_lock(&crash_mutex);
+        worker_stop = TRUE;
+        pthread_cond_signal(&crash_cond);
+        pthread_mutex_unlock(&crash_mutex);
+        pthread_join(worker, NULL);
+        worker_started = FALSE;
+    }
+    while(jobs_head) {
+        job = jobs_head;
+        jobs_head = job->next;
+        free(job);
+    }
+    jobs_tail = NULL;
+    core_retention_destroy();
+    crash_notify_close();
+    if(epoll_fd >= 0) {
+        close(epoll_fd);
+        epoll_fd = -1;
+    }
+    if(inotify_fd >= 0) {
+        close(inotify_fd);
+        inotify_fd = -1;
+    }
+    if(journal_fd >= 0) {
+        close(journal_fd);
+        journal_fd = -1;
+    }
+    crash_set_clear(&processed);
+    free(signatures);
+    signatures = NULL;
+    num_signatures = 0;
+}
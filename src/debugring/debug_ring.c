@@ -0,0 +1,383 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/*************************************************************************//**
+ * @ingroup ops_supportability
+ * This module keeps the debug output of a daemon in a ring in memory while
+ * the ring mode is on, so that packet level debugging of a busy daemon does
+ * not flood the log. The ring is read and emptied on demand through the
+ * unixctl commands of the daemon.
+ *
+ * Lines are kept as records of their time and text, one after the other.
+ * A record which does not fit before the end of the ring goes to its start,
+ * the oldest records are dropped to make room.
+ *
+ * @file
+ * Source file for the debug ring part of supportability library.
+ *
+ ****************************************************************************/
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "debug_ring.h"
+#include "dynamic-string.h"
+#include "openvswitch/vlog.h"
+#include "unixctl.h"
+#include "util.h"
+
+VLOG_DEFINE_THIS_MODULE(debug_ring);
+
+/* marks the end of the records before the ring goes back to its start */
+#define DEBUG_RING_WRAP         UINT32_MAX
+#define DEBUG_RING_ALIGN(len)   (((len) + 7) & ~(size_t) 7)
+/* a record with its text and the terminating nul */
+#define DEBUG_RING_REC_SIZE(len) \
+    DEBUG_RING_ALIGN(sizeof(struct debug_ring_rec) + (len) + 1)
+
+struct debug_ring_rec {
+    uint64_t usec;          /* CLOCK_REALTIME */
+    uint32_t len;           /* of the text which follows */
+    uint32_t pad;
+};
+
+struct debug_ring {
+    char *buf;
+    size_t size;
+    size_t head;            /* oldest record */
+    size_t tail;            /* next record */
+    uint64_t records;
+    uint64_t kept;          /* since the ring mode was turned on */
+    uint64_t dropped;       /* to make room */
+};
+
+static pthread_mutex_t debug_ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct debug_ring ring = { NULL, 0, 0, 0, 0, 0, 0 };
+static int ring_enabled = 0;
+
+/* debug_ring_rec_at
+ * Record at off, the start of the ring if off is past the last record.
+ */
+static struct debug_ring_rec *
+debug_ring_rec_at(size_t *off)
+{
+    struct debug_ring_rec *r = NULL;
+
+    if(ring.size - *off < sizeof(*r)) {
+        *off = 0;
+    }
+    r = (struct debug_ring_rec *) (ring.buf + *off);
+    if(r->len == DEBUG_RING_WRAP) {
+        *off = 0;
+        r = (struct debug_ring_rec *) ring.buf;
+    }
+    return r;
+}
+
+/* debug_ring_drop
+ * Drops the oldest record.
+ */
+static void
+debug_ring_drop(void)
+{
+    struct debug_ring_rec *r = debug_ring_rec_at(&ring.head);
+
+    ring.head += DEBUG_RING_REC_SIZE(r->len);
+    ring.records--;
+    ring.dropped++;
+    if(ring.records == 0) {
+        ring.head = ring.tail = 0;
+    } else {
+        debug_ring_rec_at(&ring.head);
+    }
+}
+
+/* debug_ring_reserve
+ * Makes room for a record of need bytes at the tail, going back to the
+ * start of the ring if it does not fit before its end.
+ *
+ * Returns the record.
+ */
+static struct debug_ring_rec *
+debug_ring_reserve(size_t need)
+{
+    if(ring.tail + need > ring.size) {
+        /* the records up to the end go, then the tail wraps */
+        while(ring.records > 0 && ring.head >= ring.tail) {
+            debug_ring_drop();
+        }
+        if(ring.size - ring.tail >= sizeof(struct debug_ring_rec)) {
+            ((struct debug_ring_rec *) (ring.buf + ring.tail))->len =
+                DEBUG_RING_WRAP;
+        }
+        ring.tail = 0;
+    }
+    while(ring.records > 0 && ring.head >= ring.tail
+          && ring.head < ring.tail + need) {
+        debug_ring_drop();
+    }
+    return (struct debug_ring_rec *) (ring.buf + ring.tail);
+}
+
+/* debug_ring_set
+ * Turns the ring mode on with a ring of size KB, or off when size is 0.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+debug_ring_set(size_t size)
+{
+    char *buf = NULL;
+
+    if(size && (size < DEBUG_RING_SIZE_MIN || size > DEBUG_RING_SIZE_MAX)) {
+        return -1;
+    }
+    size *= 1024;
+
+    pthread_mutex_lock(&debug_ring_mutex);
+    if(size == ring.size) {
+        /* nothing to do, the lines kept stay */
+        pthread_mutex_unlock(&debug_ring_mutex);
+        return 0;
+    }
+    if(size) {
+        buf = malloc(size);
+        if(buf == NULL) {
+            pthread_mutex_unlock(&debug_ring_mutex);
+            VLOG_ERR("Failed to allocate a debug ring of %zu bytes", size);
+            return -1;
+        }
+    }
+    free(ring.buf);
+    memset(&ring, 0, sizeof(ring));
+    ring.buf = buf;
+    ring.size = size;
+    __atomic_store_n(&ring_enabled, size ? 1 : 0, __ATOMIC_RELEASE);
+    pthread_mutex_unlock(&debug_ring_mutex);
+
+    VLOG_INFO("Debug output goes to %s",
+              size ? "the debug ring" : "the log");
+    return 0;
+}
+
+/* debug_ring_enabled
+ * Returns 1 if the ring mode is on, 0 otherwise.
+ */
+int
+debug_ring_enabled(void)
+{
+    return __atomic_load_n(&ring_enabled, __ATOMIC_ACQUIRE);
+}
+
+/* debug_ring_record
+ * Keeps message of module in the ring.
+ *
+ * Returns 1 if it was kept, 0 when the ring mode is off.
+ */
+int
+debug_ring_record(const char *module, const char *message)
+{
+    struct debug_ring_rec *r = NULL;
+    struct timespec ts;
+    size_t len = 0;
+    int n = 0;
+
+    if(!debug_ring_enabled()) {
+        return 0;
+    }
+    clock_gettime(CLOCK_REALTIME, &ts);
+    len = strlen(module ? module : "") + 1 + strlen(message ? message : "");
+    if(len > DEBUG_RING_LINE_MAX) {
+        len = DEBUG_RING_LINE_MAX;
+    }
+
+    pthread_mutex_lock(&debug_ring_mutex);
+    if(ring.buf == NULL) {
+        /* turned off meanwhile */
+        pthread_mutex_unlock(&debug_ring_mutex);
+        return 0;
+    }
+    r = debug_ring_reserve(DEBUG_RING_REC_SIZE(len));
+    r->usec = (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    n = snprintf((char *) (r + 1), len + 1, "%s|%s",
+                 module ? module : "", message ? message : "");
+    r->len = (n < 0) ? 0 : ((size_t) n > len ? len : (size_t) n);
+    ring.tail += DEBUG_RING_REC_SIZE(r->len);
+    ring.records++;
+    ring.kept++;
+    pthread_mutex_unlock(&debug_ring_mutex);
+    return 1;
+}
+
+/* debug_ring_log
+ * Formats a line of module and keeps it in the ring.
+ *
+ * Returns 1 if it was kept, 0 when the ring mode is off.
+ */
+int
+debug_ring_log(const char *module, const char *format, ...)
+{
+    char line[DEBUG_RING_LINE_MAX];
+    va_list args;
+
+    if(!debug_ring_enabled()) {
+        return 0;
+    }
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    return debug_ring_record(module, line);
+}
+
+/* debug_ring_dump
+ * Returns the lines of the ring as text, oldest first, and empties it if
+ * clear is set. The caller frees the text.
+ *
+ * Returns the text, NULL on failure.
+ */
+char *
+debug_ring_dump(int clear)
+{
+    struct ds ds = DS_EMPTY_INITIALIZER;
+    struct debug_ring_rec *r = NULL;
+    char stamp[32];
+    struct tm tm;
+    time_t sec = 0;
+    size_t off = 0;
+    uint64_t i = 0;
+
+    pthread_mutex_lock(&debug_ring_mutex);
+    if(ring.buf == NULL) {
+        pthread_mutex_unlock(&debug_ring_mutex);
+        ds_put_cstr(&ds, "Debug ring is off, debug output goes to the log\n");
+        return ds_steal_cstr(&ds);
+    }
+    ds_put_format(&ds, "Debug ring of %zu KB: %llu lines, %llu kept, "
+                  "%llu dropped\n", ring.size / 1024,
+                  (unsigned long long) ring.records,
+                  (unsigned long long) ring.kept,
+                  (unsigned long long) ring.dropped);
+    off = ring.head;
+    for(i = 0; i < ring.records; i++) {
+        r = debug_ring_rec_at(&off);
+        sec = (time_t) (r->usec / 1000000);
+        if(localtime_r(&sec, &tm) == NULL
+           || strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm) == 0) {
+            snprintf(stamp, sizeof(stamp), "%lld", (long long) sec);
+        }
+        ds_put_format(&ds, "%s.%06u|%.*s\n", stamp,
+                      (unsigned int) (r->usec % 1000000), (int) r->len,
+                      (const char *) (r + 1));
+        off += DEBUG_RING_REC_SIZE(r->len);
+    }
+    if(clear) {
+        ring.head = ring.tail = 0;
+        ring.records = 0;
+    }
+    pthread_mutex_unlock(&debug_ring_mutex);
+    return ds_steal_cstr(&ds);
+}
+
+/* debug_ring_unixctl_mode
+ * DEBUG_RING_MODE_CMD log|ring [KB]
+ */
+static void
+debug_ring_unixctl_mode(struct unixctl_conn *conn, int argc,
+                        const char *argv[], void *aux OVS_UNUSED)
+{
+    char reply[128];
+    size_t size = DEBUG_RING_SIZE_DEFAULT;
+    char *end = NULL;
+
+    if(!strcmp(argv[1], DEBUG_RING_MODE_LOG) && argc == 2) {
+        size = 0;
+    } else if(!strcmp(argv[1], DEBUG_RING_MODE_RING)) {
+        if(argc == 3) {
+            size = strtoul(argv[2], &end, 10);
+            if(*argv[2] == '\0' || *end != '\0') {
+                size = 0;
+            }
+            if(size < DEBUG_RING_SIZE_MIN || size > DEBUG_RING_SIZE_MAX) {
+                snprintf(reply, sizeof(reply),
+                         "Debug ring size must be %d to %d KB",
+                         DEBUG_RING_SIZE_MIN, DEBUG_RING_SIZE_MAX);
+                unixctl_command_reply_error(conn, reply);
+                return;
+            }
+        }
+    } else {
+        unixctl_command_reply_error(conn, "Invalid debug ring mode");
+        return;
+    }
+
+    if(debug_ring_set(size)) {
+        unixctl_command_reply_error(conn, "Failed to set the debug ring mode");
+        return;
+    }
+    if(size) {
+        snprintf(reply, sizeof(reply),
+                 "Debug output is kept in a ring of %zu KB", size);
+    } else {
+        snprintf(reply, sizeof(reply), "Debug output goes to the log");
+    }
+    unixctl_command_reply(conn, reply);
+}
+
+/* debug_ring_unixctl_dump
+ * DEBUG_RING_DUMP_CMD [clear]
+ */
+static void
+debug_ring_unixctl_dump(struct unixctl_conn *conn, int argc,
+                        const char *argv[], void *aux OVS_UNUSED)
+{
+    char *text = NULL;
+
+    if(argc == 2 && strcmp(argv[1], DEBUG_RING_DUMP_CLEAR)) {
+        unixctl_command_reply_error(conn, "Invalid debug ring dump option");
+        return;
+    }
+    text = debug_ring_dump(argc == 2);
+    if(text == NULL) {
+        unixctl_command_reply_error(conn, "Failed to dump the debug ring");
+        return;
+    }
+    unixctl_command_reply(conn, text);
+    free(text);
+}
+
+/* debug_ring_init
+ * Registers the unixctl commands of the debug ring.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+debug_ring_init(void)
+{
+    static int registered = 0;
+
+    if(!registered) {
+        unixctl_command_register(DEBUG_RING_MODE_CMD, "log|ring [KB]", 1, 2,
+                                 debug_ring_unixctl_mode, NULL);
+        unixctl_command_register(DEBUG_RING_DUMP_CMD, "[clear]", 0, 1,
+                                 debug_ring_unixctl_dump, NULL);
+        registered = 1;
+    }
+    return 0;
+}
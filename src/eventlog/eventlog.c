@@ -27,9 +27,12 @@
 #define _GNU_SOURCE
 #include <stdio.h>
 #include "eventlog.h"
+#include "flightrec.h"
+#include "config_watch.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <pthread.h>
 #include <systemd/sd-journal.h>
 #include <yaml.h>
 #include "openvswitch/vlog.h"
@@ -39,6 +42,12 @@ VLOG_DEFINE_THIS_MODULE(eventlog);
 static event *ev_table = NULL;
 static char *category_table[MAX_CATEGORIES_PER_DAEMON];
 static int category_index = 0;
+/* ev_mutex serializes the changes of the event table, ev_table_lock is
+ * only write locked to replace it, log_event() read locks it */
+static pthread_mutex_t ev_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_rwlock_t ev_table_lock = PTHREAD_RWLOCK_INITIALIZER;
+static struct config_watch ev_watch =
+    CONFIG_WATCH_INITIALIZER("events", EVENT_YAML_FILE);
 
 
 /* Function        : strcmp_with_nullcheck
@@ -82,7 +91,7 @@ count_keys(char *keys)
  * Returns none
  */
 void
-assign_parsed_values(char *key, int *val, int *fnd, int *index)
+assign_parsed_values(event *table, char *key, int *val, int *fnd, int *index)
 {
     int tmp = *index;
     int size = 0;
@@ -93,32 +102,32 @@ assign_parsed_values(char *key, int *val, int *fnd, int *index)
             break;
 
         case 2:
-            ev_table[tmp].event_id = atoi(key);
+            table[tmp].event_id = atoi(key);
             *val = 0;
             break;
 
         case 3:
             size = strlen(key);
             if((size > 0) && (size < MAX_SEV_NAME_SIZE )) {
-                strncpy(ev_table[tmp].severity, key, (size+1));
+                strncpy(table[tmp].severity, key, (size+1));
             }
             *val = 0;
             break;
 
         case 4:
-            ev_table[tmp].num_of_keys = count_keys(key);
+            table[tmp].num_of_keys = count_keys(key);
             *val =0;
             break;
 
         case 5:
             size = strlen(key);
             if((size > 0) && (size < MAX_LOG_STR)) {
-                strncpy(ev_table[tmp].event_description, key, (size+1));
+                strncpy(table[tmp].event_description, key, (size+1));
             }
             *val = 0;
             *fnd = 0;
             (*index)++;
-            strncpy(ev_table[tmp+1].event_name, EVENT_NAME_DELIMITER_STR,
+            strncpy(table[tmp+1].event_name, EVENT_NAME_DELIMITER_STR,
             (strlen(EVENT_NAME_DELIMITER_STR)+1));
             break;
     }
@@ -131,14 +140,14 @@ assign_parsed_values(char *key, int *val, int *fnd, int *index)
  * Returns index on success, -1 on failure.
  */
 int
-find_last_index()
+find_last_index(event *table)
 {
     int i = 0;
     /* Loop & figure out the index to append
      * in ev_table */
     while(i < MAX_EVENT_TABLE_SIZE)
     {
-        if(!strcmp_with_nullcheck(ev_table[i].event_name,
+        if(!strcmp_with_nullcheck(table[i].event_name,
             EVENT_NAME_DELIMITER_STR)) {
             return i;
         }
@@ -149,13 +158,13 @@ find_last_index()
 
 /* parse_yaml_for_category
  * Parses the events.yaml file for the events with
- * the category passed.
+ * the category passed, and appends them to table.
  *
  * Returns 1 if atleast an event with the category is found
  * on failure returns -1.
  */
 int
-parse_yaml_for_category(char *category)
+parse_yaml_for_category(event *table, char *category)
 {
     yaml_parser_t parser;
     yaml_token_t token;
@@ -174,7 +183,7 @@ parse_yaml_for_category(char *category)
         VLOG_ERR("YAML file open failed");
         return -1;
     }
-    index = find_last_index();
+    index = find_last_index(table);
     if((index < 0) || (index > MAX_EVENT_TABLE_SIZE)) {
         fclose(fh);
         return -1;
@@ -184,6 +193,7 @@ parse_yaml_for_category(char *category)
         fclose(fh);
         return -1;
     }
+    memset(&token, 0, sizeof(token));
     yaml_parser_set_input_file(&parser, fh);
     /* Lets loop through all tokens & assign the values
      * in ev_table index of the given event */
@@ -219,9 +229,9 @@ parse_yaml_for_category(char *category)
                     category_found = 1;
                     size = strlen(buf);
                     if((size > 0) && (size < MAX_EVENT_NAME_SIZE)) {
-                        strncpy(ev_table[index].event_name, buf, (size+1));
+                        strncpy(table[index].event_name, buf, (size+1));
                     }
-                    ret = asprintf(&ev_table[index].category, "%s", category);
+                    ret = asprintf(&table[index].category, "%s", category);
                     if(ret < 0) {
                         yaml_token_delete(&token);
                         fclose(fh);
@@ -231,7 +241,7 @@ parse_yaml_for_category(char *category)
                 }
                 if(found)
                 {
-                    assign_parsed_values(key, &val_flag, &found, &index);
+                    assign_parsed_values(table, key, &val_flag, &found, &index);
                 }
                 if(!strcmp_with_nullcheck(key, "event_definitions"))
                 {
@@ -285,22 +295,43 @@ parse_yaml_for_category(char *category)
 }
 
 /* create_event_table
- * Creates the event ID table.
+ * Creates an empty event ID table.
  *
- * Returns 0 on success, -1 on failure.
+ * Returns the table on success, NULL on failure.
  */
-int
+event *
 create_event_table()
 {
-    ev_table = (event*)malloc((MAX_EVENT_TABLE_SIZE*sizeof(event)));
-    if(ev_table == NULL) {
-        return -1;
+    event *table = (event*)malloc((MAX_EVENT_TABLE_SIZE*sizeof(event)));
+    if(table == NULL) {
+        return NULL;
     }
     /* Lets fill in the delimiter at 1st index to show that
      * table is empty */
-    strncpy(ev_table[0].event_name, EVENT_NAME_DELIMITER_STR,
+    strncpy(table[0].event_name, EVENT_NAME_DELIMITER_STR,
     (strlen(EVENT_NAME_DELIMITER_STR)+1));
-    return 0;
+    return table;
+}
+
+/* free_event_table
+ * Frees an event ID table and the categories of its events.
+ */
+static void
+free_event_table(event *table)
+{
+    int i = 0;
+    if(table == NULL) {
+        return;
+    }
+    for(i = 0; i < MAX_EVENT_TABLE_SIZE; i++)
+    {
+        if(!strcmp_with_nullcheck(table[i].event_name,
+            EVENT_NAME_DELIMITER_STR)) {
+            break;
+        }
+        free(table[i].category);
+    }
+    free(table);
 }
 
 /* add_to_event_table
@@ -311,10 +342,10 @@ create_event_table()
  * API.
  */
 int
-add_to_event_table(char *event_category)
+add_to_event_table(event *table, char *event_category)
 {
     int ret = 0;
-    ret = parse_yaml_for_category(event_category);
+    ret = parse_yaml_for_category(table, event_category);
     return ret;
 }
 
@@ -347,7 +378,8 @@ event_category_search(char *category)
  * Initialization function for event log for daemon.
  * creates daemon event table with category of interest
  *
- * Returns 0 on success, -1 on failure
+ * Returns 1 on success, 0 if no event has the category, -1 on failure
+ * or if the category was already initialized
  */
 int
 event_log_init(char *category_name)
@@ -358,9 +390,14 @@ event_log_init(char *category_name)
     }
 
     VLOG_INFO("Event Category Initialization called for %s", category_name);
+    /* events are recorded from now on, the recorder is kept if the
+     * category turns out to have no events */
+    flightrec_init();
 
-    if(category_index > (MAX_CATEGORIES_PER_DAEMON)) {
+    pthread_mutex_lock(&ev_mutex);
+    if(category_index >= (MAX_CATEGORIES_PER_DAEMON)) {
         VLOG_ERR("Category Index exceeded limit");
+        pthread_mutex_unlock(&ev_mutex);
         return -1;
     }
     if(category_index) {
@@ -368,7 +405,8 @@ event_log_init(char *category_name)
          * was already done. If that is the case it will be present
          * in category table we maintain */
         if(event_category_search(category_name)) {
-            VLOG_ERR("No matching event category found %s", category_name);
+            VLOG_ERR("Event category %s already initialized", category_name);
+            pthread_mutex_unlock(&ev_mutex);
             return -1;
         }
     }
@@ -376,14 +414,19 @@ event_log_init(char *category_name)
         /* It seems this is the first call of event_log_init()
          * by this daemon, lets create the daemon event table then
          */
-        ret = create_event_table();
-        if(ret < 0) {
+        config_watch_begin(&ev_watch);
+        ev_table = create_event_table();
+        config_watch_done(&ev_watch, ev_table != NULL);
+        if(ev_table == NULL) {
             VLOG_ERR("Event table creation failed");
+            pthread_mutex_unlock(&ev_mutex);
             return -1;
         }
     }
     /* Lets add the events belonging to this category to event table */
-    ret = add_to_event_table(category_name);
+    pthread_rwlock_wrlock(&ev_table_lock);
+    ret = add_to_event_table(ev_table, category_name);
+    pthread_rwlock_unlock(&ev_table_lock);
     if(ret > 0) {
         /* Add this category to category table, so that next time
          * if somebody calls with the same category we will not
@@ -391,10 +434,50 @@ event_log_init(char *category_name)
         asprintf(&category_table[category_index], "%s", category_name);
         category_index++;
     }
+    pthread_mutex_unlock(&ev_mutex);
     VLOG_DBG("Event log Initialization returning %d", ret);
     return ret;
 }
 
+/* event_table_reload
+ * Builds the event table again from the changed events.yaml file, with
+ * the categories initialized so far. The new table replaces the old one
+ * only if every category is still defined.
+ */
+static void
+event_table_reload(void)
+{
+    event *table = NULL, *old = NULL;
+    int i = 0, valid = TRUE;
+
+    pthread_mutex_lock(&ev_mutex);
+    if(ev_table == NULL || !config_watch_changed(&ev_watch)) {
+        /* not initialized, or reloaded by another thread */
+        pthread_mutex_unlock(&ev_mutex);
+        return;
+    }
+    config_watch_begin(&ev_watch);
+    table = create_event_table();
+    valid = (table != NULL);
+    for(i = 0; valid && i < category_index; i++)
+    {
+        if(add_to_event_table(table, category_table[i]) <= 0) {
+            VLOG_ERR("Event category %s not found", category_table[i]);
+            valid = FALSE;
+        }
+    }
+    if(valid) {
+        pthread_rwlock_wrlock(&ev_table_lock);
+        old = ev_table;
+        ev_table = table;
+        pthread_rwlock_unlock(&ev_table_lock);
+        table = old;
+    }
+    free_event_table(table);
+    config_watch_done(&ev_watch, valid);
+    pthread_mutex_unlock(&ev_mutex);
+}
+
 /* key_value_string
  * Forms the string in "key=value" format
  *
@@ -594,21 +677,21 @@ populate_str(char *s1, char *s2)
  * Returns event index on success, -1 on failure.
  */
 int
-event_search(char *fmt)
+event_search(event *table, char *fmt)
 {
     int i = 0;
-    if(fmt == NULL || ev_table == NULL) {
+    if(fmt == NULL || table == NULL) {
         return -1;
     }
     /* Loop till we either match event name or
      * we reach the delimter which is EV_TBD_TBD */
     while(i < MAX_EVENT_TABLE_SIZE)
     {
-        if(!strcmp_with_nullcheck(fmt, ev_table[i].event_name)) {
+        if(!strcmp_with_nullcheck(fmt, table[i].event_name)) {
             return i;
         }
         if(!strcmp_with_nullcheck(EVENT_NAME_DELIMITER_STR,
-                    ev_table[i].event_description)) {
+                    table[i].event_description)) {
             break;
         }
         i++;
@@ -640,6 +723,96 @@ severity_level(char *arg)
     return -1;
 }
 
+/* event_lookup
+ * Finds the event ev_name in the event table, reloaded first if
+ * events.yaml changed, and copies it with its category.
+ *
+ * Returns 0 on success, -1 if the event is unknown.
+ */
+static int
+event_lookup(char *ev_name, event *ev, char *category, size_t size)
+{
+    int index = 0, ret = 0;
+
+    /* events.yaml changed on disk */
+    if(config_watch_changed(&ev_watch)) {
+        event_table_reload();
+    }
+    /* Search for the event in event table
+     * Fetch it's index */
+    pthread_rwlock_rdlock(&ev_table_lock);
+    index = event_search(ev_table, ev_name);
+    if((index == (MAX_EVENT_TABLE_SIZE-1)) || (index < 0))
+    {
+        pthread_rwlock_unlock(&ev_table_lock);
+        ret = sd_journal_send("ops-evt|Unknown Event Name %s", ev_name,
+                "MESSAGE_ID=%s", MESSAGE_OPS_EVT,
+                NULL);
+        if(ret != 0) {
+            VLOG_ERR("sd_journal_send failed with %d", ret);
+        }
+        return -1;
+    }
+    /* Copy the event, the table may be replaced once unlocked */
+    *ev = ev_table[index];
+    if(ev_table[index].category) {
+        strncpy(category, ev_table[index].category, (size-1));
+    }
+    pthread_rwlock_unlock(&ev_table_lock);
+    return 0;
+}
+
+/* event_send
+ * Sends the event with its populated description to the journal, with
+ * the key-value pairs and the identifier of the sender if given.
+ *
+ * Returns 0 on success, negative value on failure.
+ */
+static int
+event_send(event *ev, char *category, char *evt_msg, char *pairs,
+           char *identifier)
+{
+    char *message = NULL;
+    int level = 0, ret = 0;
+
+    ret = asprintf(&message, "MESSAGE=ops-evt|%d|%s|%s",
+            ev->event_id, ev->severity, evt_msg);
+    if(ret < 0) {
+        VLOG_ERR("Failed to allocate memory");
+        return -1;
+    }
+    /* Convert severity string to corresponding severity value */
+    level = severity_level(ev->severity);
+    if(level < 0) {
+        VLOG_ERR("Incorrect severity level");
+        free(message);
+        return -1;
+    }
+    flightrec_event(level, message + strlen("MESSAGE="));
+    /* a NULL pairs ends the fields early */
+    if(identifier) {
+        ret = sd_journal_send(message, "PRIORITY=%d", level,
+                "MESSAGE_ID=%s", MESSAGE_OPS_EVT,"OPS_EVENT_ID=%d",
+                ev->event_id, "OPS_EVENT_CATEGORY=%s",
+                category, "SYSLOG_IDENTIFIER=%s", identifier,
+                pairs,
+                NULL);
+    }
+    else {
+        ret = sd_journal_send(message, "PRIORITY=%d", level,
+                "MESSAGE_ID=%s", MESSAGE_OPS_EVT,"OPS_EVENT_ID=%d",
+                ev->event_id, "OPS_EVENT_CATEGORY=%s",
+                category,
+                pairs,
+                NULL);
+    }
+    if(ret != 0) {
+        VLOG_ERR("sd_journal_send failed with %d", ret);
+    }
+    free(message);
+    return ret;
+}
+
 /* log_event
  * API used to log the event logs.
  *
@@ -648,39 +821,29 @@ severity_level(char *arg)
 int
 log_event(char *ev_name,...)
 {
-    int i = 0, index = 0, key_nums = 0, key_value_none = 0;
+    int i = 0, key_nums = 0, key_value_none = 0;
     int ret = 0, str_size = 0;
     va_list arg;
     char key_value_pair[KEY_VALUE_SIZE] = {0,};
     char all_key_value_pairs[(2*KEY_VALUE_SIZE)] = {0,};
     char *tmp = NULL;
-    char *message = NULL;
     char evt_msg[MAX_LOG_STR] = {0,};
-    int level = 0;
+    char category[MAX_EVENT_NAME_SIZE] = {0,};
+    event ev;
     if(ev_name == NULL) {
         return -1;
     }
     va_start(arg, ev_name);
-    /* Search for the event in event table
-     * Fetch it's index */
-    index = event_search(ev_name);
-    if((index == (MAX_EVENT_TABLE_SIZE-1)) || (index < 0))
-    {
-        ret = sd_journal_send("ops-evt|Unknown Event Name %s", ev_name,
-                "MESSAGE_ID=%s", MESSAGE_OPS_EVT,
-                NULL);
-        if(ret != 0) {
-            VLOG_ERR("sd_journal_send failed with %d", ret);
-        }
+    if(event_lookup(ev_name, &ev, category, sizeof(category)) < 0) {
         va_end(arg);
         return -1;
     }
-    str_size = strlen(ev_table[index].event_description);
+    str_size = strlen(ev.event_description);
     if(str_size < MAX_LOG_STR) {
-        strncpy(evt_msg, ev_table[index].event_description, (str_size+1));
+        strncpy(evt_msg, ev.event_description, (str_size+1));
     }
     /* Get the number of key's in the event */
-    key_nums = ev_table[index].num_of_keys;
+    key_nums = ev.num_of_keys;
     while(i < key_nums)
     {
         tmp = va_arg(arg, char*);
@@ -711,39 +874,59 @@ log_event(char *ev_name,...)
         i++;
         free(tmp);
     }
-    ret = asprintf(&message, "MESSAGE=ops-evt|%d|%s|%s",
-            ev_table[index].event_id, ev_table[index].severity, evt_msg);
-    if(ret < 0) {
-        VLOG_ERR("Failed to allocate memory");
-        va_end(arg);
+    ret = event_send(&ev, category, evt_msg,
+            key_value_none ? NULL : all_key_value_pairs, NULL);
+    va_end(arg);
+    return ret;
+}
+
+/* log_event_kv
+ * API used to log the event logs from bindings, which cannot build the
+ * va_list of log_event(). pairs are count "key=value" strings, left to
+ * the caller, and identifier the SYSLOG_IDENTIFIER of the event, the one
+ * of the process when NULL.
+ *
+ * Returns -1 on failure & 0 on success
+ */
+int
+log_event_kv(char *ev_name, char *identifier, int count, char *pairs[])
+{
+    int i = 0, ret = 0, str_size = 0;
+    char key_value_pair[KEY_VALUE_SIZE] = {0,};
+    char all_key_value_pairs[(2*KEY_VALUE_SIZE)] = {0,};
+    char evt_msg[MAX_LOG_STR] = {0,};
+    char category[MAX_EVENT_NAME_SIZE] = {0,};
+    event ev;
+    if(ev_name == NULL || count < 0 || (count && pairs == NULL)) {
         return -1;
     }
-    /* Convert severity string to corresponding severity value */
-    level = severity_level(ev_table[index].severity);
-    if(level < 0) {
-        VLOG_ERR("Incorrect severity level");
-        free(message);
-        va_end(arg);
+    if(event_lookup(ev_name, &ev, category, sizeof(category)) < 0) {
         return -1;
     }
-    if(key_value_none) {
-        ret = sd_journal_send(message, "PRIORITY=%d", level,
-                "MESSAGE_ID=%s", MESSAGE_OPS_EVT,"OPS_EVENT_ID=%d",
-                ev_table[index].event_id,"OPS_EVENT_CATEGORY=%s",
-                 ev_table[index].category, NULL);
-    }
-    else {
-        ret = sd_journal_send(message, "PRIORITY=%d", level,
-                "MESSAGE_ID=%s", MESSAGE_OPS_EVT,"OPS_EVENT_ID=%d",
-                ev_table[index].event_id, "OPS_EVENT_CATEGORY=%s",
-                ev_table[index].category,
-                all_key_value_pairs,
-                NULL);
+    str_size = strlen(ev.event_description);
+    if(str_size < MAX_LOG_STR) {
+        strncpy(evt_msg, ev.event_description, (str_size+1));
     }
-    if(ret != 0) {
-        VLOG_ERR("sd_journal_send failed with %d", ret);
+    for(i = 0; i < count && i < ev.num_of_keys; i++)
+    {
+        if(pairs[i] == NULL) {
+            break;
+        }
+        str_size = strlen(pairs[i]);
+        if(str_size >= (KEY_VALUE_SIZE-1)) {
+            VLOG_ERR("Key value pair too large for %s", ev_name);
+            return -1;
+        }
+        strncpy(key_value_pair, pairs[i], (str_size+1));
+        if(populate_str(evt_msg, key_value_pair) < 0) {
+            VLOG_ERR("Failure at populate_str()");
+            return -1;
+        }
+        strcat(key_value_pair, ",");
+        strncat(all_key_value_pairs, key_value_pair,
+        (sizeof(all_key_value_pairs)-strlen(all_key_value_pairs)-1));
     }
-    free(message);
-    va_end(arg);
+    ret = event_send(&ev, category, evt_msg,
+            (i > 0) ? all_key_value_pairs : NULL, identifier);
     return ret;
 }
@@ -23,16 +23,19 @@
  */
 
 #include "feature_mapping.h"
+#include "config_watch.h"
 #include <yaml.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
 #include "openvswitch/vlog.h"
 
 VLOG_DEFINE_THIS_MODULE(feature_mapping);
 
 static int
-parse_feature_mapping_yaml(void);
+parse_feature_mapping_yaml(struct feature** head);
 
 static int
 feature_mapping_check_key(const char *data);
@@ -60,7 +63,6 @@ const char* keystr_feat[MAX_NUM_KEYS] = {
   [ DIAGDUMP_FLAG ] = "diag_dump"
 };
 
-static struct feature* feature_head = NULL;
 
 
 /*
@@ -183,12 +185,14 @@ feature_mapping_check_key(const char *data)
 * Function       : parse_feature_mapping_yaml
 * Responsibility : parse feature to daemon mapping config file
 *                  and store in linkedlist
-* Parameters     : void
+* Parameters
+*                : head - set to the head of the linked list, a partial
+*                         list on failure
 * Returns        : 0 on sucess and nonzero on failure
 */
 
 static int
-parse_feature_mapping_yaml(void)
+parse_feature_mapping_yaml(struct feature** head)
 {
 #define  CASE_SET_FEATURE_STATE(STATE) \
     case (STATE): \
@@ -245,9 +249,9 @@ parse_feature_mapping_yaml(void)
                                             curr_feature,
                                             (const char*)
                                             event.data.scalar.value);
-                                    if(!feature_head)
+                                    if(!*head)
                                     {
-                                        feature_head = curr_feature;
+                                        *head = curr_feature;
                                     }
                                     break;
                                 }
@@ -327,20 +331,429 @@ parse_feature_mapping_yaml(void)
 #undef  CASE_SET_FEATURE_STATE
 }
 
+/*
+* Function       : feature_mapping_free
+* Responsibility : free a feature linked list and its daemons
+* Parameters
+*                : head - head of the linked list
+* Returns        : void
+*/
+
+static void
+feature_mapping_free(struct feature* head)
+{
+  struct feature* next_feature = NULL;
+  struct daemon* iter_daemon = NULL;
+  struct daemon* next_daemon = NULL;
+
+  for( ; head; head = next_feature) {
+    next_feature = head->next;
+    for(iter_daemon = head->p_daemon; iter_daemon; iter_daemon = next_daemon) {
+      next_daemon = iter_daemon->next;
+      free(iter_daemon->name);
+      free(iter_daemon);
+    }
+    free(head->name);
+    free(head->desc);
+    free(head);
+  }
+}
+
+/*
+* Function       : feature_mapping_hash
+* Responsibility : FNV-1a hash of a feature or daemon name
+* Parameters
+*                : name
+* Returns        : hash
+*/
+
+static uint32_t
+feature_mapping_hash(const char* name)
+{
+  uint32_t hash = 2166136261u;
+
+  while(*name) {
+    hash ^= (unsigned char) *name++;
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+/*
+* Function       : feature_mapping_index_size
+* Responsibility : size of an open addressing index, a power of two at least
+*                  twice the number of entries
+* Parameters
+*                : count - number of entries
+* Returns        : size
+*/
+
+static size_t
+feature_mapping_index_size(size_t count)
+{
+  size_t size = 16;
+
+  while(size < 2 * count) {
+    size *= 2;
+  }
+  return size;
+}
+
+/*
+* Function       : feature_mapping_slot
+* Responsibility : find the slot of name in an index, or the empty slot it
+*                  would go to. Slots hold an entry index + 1, 0 is empty
+* Parameters
+*                : index , size - the index
+*                : name
+*                : entry_name - name of the entry of table at an index
+*                : table - the table
+* Returns        : slot
+*/
+
+static size_t
+feature_mapping_slot(const size_t* index, size_t size, const char* name,
+                     const char* (*entry_name)(const void*, size_t),
+                     const void* table)
+{
+  size_t slot = feature_mapping_hash(name) & (size - 1);
+
+  while(index[slot] && strcmp(entry_name(table, index[slot] - 1), name)) {
+    slot = (slot + 1) & (size - 1);
+  }
+  return slot;
+}
+
+static const char*
+feature_mapping_feature_name(const void* table, size_t i)
+{
+  return ((struct feature* const*) table)[i]->name;
+}
+
+static const char*
+feature_mapping_daemon_name(const void* table, size_t i)
+{
+  return ((const struct daemon_features*) table)[i].name;
+}
+
+/* feature mapping compiled from the linked list */
+struct feature_registry {
+  struct feature* head;
+  size_t n_features;
+  struct feature** features;
+  size_t feature_index_size;
+  size_t* feature_index;
+  size_t n_daemons;
+  struct daemon_features* daemons;
+  size_t daemon_index_size;
+  size_t* daemon_index;
+  struct daemon_feature* pairs;
+  /* registry replaced by this one, kept as callers may still use it */
+  struct feature_registry* previous;
+};
+
+static struct feature_registry* registry = NULL;
+static pthread_mutex_t registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct config_watch registry_watch =
+  CONFIG_WATCH_INITIALIZER("feature mapping", FEATURE_MAPPING_CONF);
+
+/*
+* Function       : feature_mapping_registry_free
+* Responsibility : free a registry and its feature linked list
+* Parameters
+*                : reg
+* Returns        : void
+*/
+
+static void
+feature_mapping_registry_free(struct feature_registry* reg)
+{
+  if(reg == NULL) {
+    return;
+  }
+  feature_mapping_free(reg->head);
+  free(reg->features);
+  free(reg->feature_index);
+  free(reg->daemons);
+  free(reg->daemon_index);
+  free(reg->pairs);
+  free(reg);
+}
+
+/*
+* Function       : feature_mapping_compile
+* Responsibility : build the feature table, the daemon table and their hash
+*                  indexes from a feature linked list. The first definition
+*                  of a feature wins, as it did with the list walk. A feature
+*                  supports diag-dump if any of its daemons does
+* Parameters
+*                : head - linked list, owned by the registry on success
+* Returns        : registry, NULL on failure
+*/
+
+static struct feature_registry*
+feature_mapping_compile(struct feature* head)
+{
+  struct feature_registry* reg = NULL;
+  struct feature* iter = NULL;
+  struct daemon* iter_daemon = NULL;
+  struct daemon_features* entry = NULL;
+  size_t n_pairs = 0, i = 0, slot = 0, offset = 0;
+
+  reg = calloc(1, sizeof(*reg));
+  if(reg == NULL) {
+    VLOG_ERR("Memory Allocation Failure");
+    return NULL;
+  }
+  for(iter = head; iter; iter = iter->next) {
+    reg->n_features++;
+    for(iter_daemon = iter->p_daemon; iter_daemon;
+        iter_daemon = iter_daemon->next) {
+      n_pairs++;
+    }
+  }
+  reg->feature_index_size = feature_mapping_index_size(reg->n_features);
+  reg->daemon_index_size = feature_mapping_index_size(n_pairs);
+  reg->features = calloc(reg->n_features + 1, sizeof(*reg->features));
+  reg->feature_index = calloc(reg->feature_index_size, sizeof(size_t));
+  reg->daemons = calloc(n_pairs + 1, sizeof(*reg->daemons));
+  reg->daemon_index = calloc(reg->daemon_index_size, sizeof(size_t));
+  reg->pairs = calloc(n_pairs + 1, sizeof(*reg->pairs));
+  if(!reg->features || !reg->feature_index || !reg->daemons
+     || !reg->daemon_index || !reg->pairs) {
+    VLOG_ERR("Memory Allocation Failure");
+    feature_mapping_registry_free(reg);
+    return NULL;
+  }
+
+  /* features, and the number of features of each daemon */
+  for(iter = head; iter; iter = iter->next) {
+    if(iter->name == NULL) {
+      continue;
+    }
+    reg->features[i++] = iter;
+    slot = feature_mapping_slot(reg->feature_index, reg->feature_index_size,
+                                iter->name, feature_mapping_feature_name,
+                                reg->features);
+    if(reg->feature_index[slot] == 0) {
+      reg->feature_index[slot] = i;
+    }
+    iter->diag_flag = DISABLE;
+    for(iter_daemon = iter->p_daemon; iter_daemon;
+        iter_daemon = iter_daemon->next) {
+      if(iter_daemon->name == NULL) {
+        continue;
+      }
+      slot = feature_mapping_slot(reg->daemon_index, reg->daemon_index_size,
+                                  iter_daemon->name,
+                                  feature_mapping_daemon_name, reg->daemons);
+      if(reg->daemon_index[slot] == 0) {
+        reg->daemons[reg->n_daemons].name = iter_daemon->name;
+        reg->daemon_index[slot] = ++reg->n_daemons;
+      }
+      reg->daemons[reg->daemon_index[slot] - 1].n_features++;
+      if(iter_daemon->diag_flag == ENABLE) {
+        iter->diag_flag = ENABLE;
+      }
+    }
+  }
+  reg->n_features = i;
+  reg->head = head;
+
+  /* features of each daemon */
+  for(i = 0; i < reg->n_daemons; i++) {
+    reg->daemons[i].features = reg->pairs + offset;
+    offset += reg->daemons[i].n_features;
+    reg->daemons[i].n_features = 0;
+  }
+  for(i = 0; i < reg->n_features; i++) {
+    for(iter_daemon = reg->features[i]->p_daemon; iter_daemon;
+        iter_daemon = iter_daemon->next) {
+      if(iter_daemon->name == NULL) {
+        continue;
+      }
+      slot = feature_mapping_slot(reg->daemon_index, reg->daemon_index_size,
+                                  iter_daemon->name,
+                                  feature_mapping_daemon_name, reg->daemons);
+      entry = &reg->daemons[reg->daemon_index[slot] - 1];
+      entry->features[entry->n_features].feature = reg->features[i];
+      entry->features[entry->n_features].diag_flag = iter_daemon->diag_flag;
+      entry->n_features++;
+      if(iter_daemon->diag_flag == ENABLE) {
+        entry->diag_flag = ENABLE;
+      }
+    }
+  }
+  return reg;
+}
+
+/*
+* Function       : feature_mapping_registry
+* Responsibility : parse and compile the feature mapping on first use, and
+*                  again once the config file changed. The new registry
+*                  replaces the previous one in a single pointer swap, only
+*                  if the file parsed. A failed first parse is retried on
+*                  the next use
+* Parameters     : void
+* Returns        : registry, NULL on failure
+*/
+
+static struct feature_registry*
+feature_mapping_registry(void)
+{
+  struct feature_registry* reg = __atomic_load_n(&registry, __ATOMIC_ACQUIRE);
+  struct feature_registry* next = NULL;
+  struct feature* head = NULL;
+
+  if(reg != NULL && !config_watch_changed(&registry_watch)) {
+    return reg;
+  }
+  pthread_mutex_lock(&registry_mutex);
+  reg = registry;
+  if(reg == NULL || config_watch_changed(&registry_watch)) {
+    config_watch_begin(&registry_watch);
+    if(parse_feature_mapping_yaml(&head) || head == NULL) {
+      VLOG_ERR("Failed to parse feature mapping %s", FEATURE_MAPPING_CONF);
+      feature_mapping_free(head);
+    }
+    else {
+      next = feature_mapping_compile(head);
+      if(next == NULL) {
+        feature_mapping_free(head);
+      }
+      else {
+        next->previous = reg;
+        reg = next;
+        __atomic_store_n(&registry, reg, __ATOMIC_RELEASE);
+      }
+    }
+    config_watch_done(&registry_watch, next != NULL);
+  }
+  pthread_mutex_unlock(&registry_mutex);
+  return reg;
+}
+
 /*
 * Function       : get_feature_mapping
 * Responsibility : singleton function to get the feature mapping
-* Parameters
-*                : data
+* Parameters     : void
 * Returns        : header to the feature mapping link list
 */
 
 struct feature*
 get_feature_mapping(void)
 {
-  if(feature_head == NULL)
-  {
-    parse_feature_mapping_yaml();
+  struct feature_registry* reg = feature_mapping_registry();
+
+  return reg ? reg->head : NULL;
+}
+
+/*
+* Function       : feature_mapping_find
+* Responsibility : look a feature up by name
+* Parameters
+*                : name - name of feature
+* Returns        : feature, NULL if not found
+*/
+
+struct feature*
+feature_mapping_find(const char* name)
+{
+  struct feature_registry* reg = feature_mapping_registry();
+  size_t slot = 0;
+
+  if(reg == NULL || name == NULL) {
+    return NULL;
+  }
+  slot = feature_mapping_slot(reg->feature_index, reg->feature_index_size,
+                              name, feature_mapping_feature_name,
+                              reg->features);
+  return reg->feature_index[slot] ?
+         reg->features[reg->feature_index[slot] - 1] : NULL;
+}
+
+/*
+* Function       : feature_mapping_find_daemon
+* Responsibility : look the features of a daemon up
+* Parameters
+*                : daemon - name of daemon
+* Returns        : daemon entry, NULL if the daemon serves no feature
+*/
+
+const struct daemon_features*
+feature_mapping_find_daemon(const char* daemon)
+{
+  struct feature_registry* reg = feature_mapping_registry();
+  size_t slot = 0;
+
+  if(reg == NULL || daemon == NULL) {
+    return NULL;
   }
-  return feature_head;
+  slot = feature_mapping_slot(reg->daemon_index, reg->daemon_index_size,
+                              daemon, feature_mapping_daemon_name,
+                              reg->daemons);
+  return reg->daemon_index[slot] ?
+         &reg->daemons[reg->daemon_index[slot] - 1] : NULL;
+}
+
+/*
+* Function       : feature_mapping_count
+* Responsibility : number of features
+* Parameters     : void
+* Returns        : count, 0 if the mapping failed
+*/
+
+size_t
+feature_mapping_count(void)
+{
+  struct feature_registry* reg = feature_mapping_registry();
+
+  return reg ? reg->n_features : 0;
+}
+
+/*
+* Function       : feature_mapping_get
+* Responsibility : feature by index, in the order of the config file
+* Parameters
+*                : index
+* Returns        : feature, NULL if out of range
+*/
+
+struct feature*
+feature_mapping_get(size_t index)
+{
+  struct feature_registry* reg = feature_mapping_registry();
+
+  return (reg && index < reg->n_features) ? reg->features[index] : NULL;
+}
+
+/*
+* Function       : feature_mapping_daemon_count
+* Responsibility : number of daemons
+* Parameters     : void
+* Returns        : count, 0 if the mapping failed
+*/
+
+size_t
+feature_mapping_daemon_count(void)
+{
+  struct feature_registry* reg = feature_mapping_registry();
+
+  return reg ? reg->n_daemons : 0;
+}
+
+/*
+* Function       : feature_mapping_get_daemon
+* Responsibility : daemon by index, in order of first appearance
+* Parameters
+*                : index
+* Returns        : daemon entry, NULL if out of range
+*/
+
+const struct daemon_features*
+feature_mapping_get_daemon(size_t index)
+{
+  struct feature_registry* reg = feature_mapping_registry();
+
+  return (reg && index < reg->n_daemons) ? &reg->daemons[index] : NULL;
 }
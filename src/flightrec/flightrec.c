@@ -0,0 +1,499 @@
+/*
+ Copyright (C) 2016 Hewlett-Packard Development Company, L.P.
+ All Rights Reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License"); you may
+    not use this file except in compliance with the License. You may obtain
+    a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+    License for the specific language governing permissions and limitations
+    under the License.
+*/
+
+/*************************************************************************//**
+ * @ingroup ops_supportability
+ * This module keeps the last FLIGHTREC_RECORDS events and log lines of a
+ * daemon in a ring in shared memory, which survives the daemon when it
+ * crashes.
+ *
+ * Writers take a position with an atomic increment and fill the record in
+ * place, no lock is taken and nothing is copied besides the text. Each
+ * record carries the position it was written for, set once it is complete,
+ * so that a record being written when the daemon crashed, or overwritten by
+ * a writer which went around the ring, is recognized and skipped.
+ *
+ * The segment is removed when the daemon exits. After a crash, crash
+ * processing writes it next to the core dump as text and removes it.
+ *
+ * @file
+ * Source file for the flight recorder part of supportability library.
+ *
+ ****************************************************************************/
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syslog.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "eventlog.h"
+#include "flightrec.h"
+#include "openvswitch/vlog.h"
+
+VLOG_DEFINE_THIS_MODULE(flightrec);
+
+#define FLIGHTREC_MAGIC          0x4345525448474c46ULL  /* "FLGHTREC" */
+#define FLIGHTREC_VERSION        1
+#define FLIGHTREC_PROCESS_SIZE   16                     /* TASK_COMM_LEN */
+#define FLIGHTREC_PATH_SIZE      64
+#define FLIGHTREC_LINE_SIZE      (FLIGHTREC_TEXT_SIZE + 96)
+
+enum flightrec_type {
+    FLIGHTREC_EVENT = 1,
+    FLIGHTREC_LOG
+};
+
+struct flightrec_record {
+    uint64_t seq;                           /* position + 1, 0 while written */
+    uint64_t usec;                          /* wall clock */
+    uint32_t tid;
+    uint8_t type;
+    uint8_t level;                          /* vlog level or syslog level */
+    uint16_t len;
+    char text[FLIGHTREC_TEXT_SIZE];
+};
+
+struct flightrec_header {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t records;
+    int32_t pid;
+    char process[FLIGHTREC_PROCESS_SIZE];
+    uint64_t head;                          /* next position */
+    /* records start on a cache line of their own */
+    struct flightrec_record ring[] __attribute__ ((aligned(64)));
+};
+
+static pthread_mutex_t flightrec_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct flightrec_header *recorder = NULL;
+static pid_t recorder_pid = 0;
+static int recorder_failed = FALSE;
+static int recorder_hooked = FALSE;
+static __thread uint32_t recorder_tid = 0;
+
+/* flightrec_size
+ * Size of a segment of records records
+ */
+static size_t
+flightrec_size(uint32_t records)
+{
+    return sizeof(struct flightrec_header)
+           + records * sizeof(struct flightrec_record);
+}
+
+/* flightrec_name
+ * shm_open name of the segment of a process
+ */
+static void
+flightrec_name(pid_t pid, char *name, size_t size)
+{
+    snprintf(name, size, "/%s%d", FLIGHTREC_SHM_PREFIX, (int) pid);
+}
+
+/* flightrec_exit
+ * Removes the segment of this process, it exited normally.
+ */
+static void
+flightrec_exit(void)
+{
+    char name[FLIGHTREC_PATH_SIZE];
+
+    if(recorder && recorder_pid == getpid()) {
+        flightrec_name(recorder_pid, name, sizeof(name));
+        shm_unlink(name);
+    }
+}
+
+/* flightrec_atfork_child
+ * Forgets the segment of the parent, a child records in its own segment.
+ */
+static void
+flightrec_atfork_child(void)
+{
+    if(recorder) {
+        munmap(recorder, flightrec_size(FLIGHTREC_RECORDS));
+    }
+    recorder = NULL;
+    recorder_failed = FALSE;
+    recorder_tid = 0;
+    pthread_mutex_init(&flightrec_mutex, NULL);
+}
+
+/* flightrec_init
+ * Creates and maps the segment of this process.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+flightrec_init(void)
+{
+    struct flightrec_header *h = NULL;
+    char name[FLIGHTREC_PATH_SIZE];
+    size_t size = flightrec_size(FLIGHTREC_RECORDS);
+    int fd = -1, ret = -1;
+
+    pthread_mutex_lock(&flightrec_mutex);
+    if(recorder) {
+        ret = 0;
+        goto out;
+    }
+    if(recorder_failed) {
+        goto out;
+    }
+    if(!recorder_hooked) {
+        atexit(flightrec_exit);
+        pthread_atfork(NULL, NULL, flightrec_atfork_child);
+        recorder_hooked = TRUE;
+    }
+
+    flightrec_name(getpid(), name, sizeof(name));
+    fd = shm_open(name, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if(fd < 0) {
+        VLOG_ERR("Failed to create the flight recorder: %s", strerror(errno));
+        goto out;
+    }
+    if(ftruncate(fd, size)) {
+        VLOG_ERR("Failed to size the flight recorder: %s", strerror(errno));
+        close(fd);
+        shm_unlink(name);
+        goto out;
+    }
+    h = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(h == MAP_FAILED) {
+        VLOG_ERR("Failed to map the flight recorder: %s", strerror(errno));
+        shm_unlink(name);
+        goto out;
+    }
+    h->version = FLIGHTREC_VERSION;
+    h->records = FLIGHTREC_RECORDS;
+    h->pid = getpid();
+    prctl(PR_GET_NAME, h->process, 0, 0, 0);
+    h->process[FLIGHTREC_PROCESS_SIZE - 1] = '\0';
+    /* the magic last, a reader ignores a segment not set up yet */
+    __atomic_store_n(&h->magic, FLIGHTREC_MAGIC, __ATOMIC_RELEASE);
+
+    recorder_pid = h->pid;
+    __atomic_store_n(&recorder, h, __ATOMIC_RELEASE);
+    ret = 0;
+out:
+    /* not retried on every record */
+    if(ret) {
+        recorder_failed = TRUE;
+    }
+    pthread_mutex_unlock(&flightrec_mutex);
+    return ret;
+}
+
+/* flightrec_begin
+ * Takes the next record of the ring and marks it as being written.
+ *
+ * Returns the record, NULL if there is no flight recorder.
+ */
+static struct flightrec_record *
+flightrec_begin(uint64_t *seq)
+{
+    struct flightrec_header *h = __atomic_load_n(&recorder, __ATOMIC_ACQUIRE);
+    struct flightrec_record *r = NULL;
+    struct timespec ts;
+    uint64_t pos = 0;
+
+    if(h == NULL) {
+        if(__atomic_load_n(&recorder_failed, __ATOMIC_RELAXED)
+           || flightrec_init()) {
+            return NULL;
+        }
+        h = __atomic_load_n(&recorder, __ATOMIC_ACQUIRE);
+    }
+    pos = __atomic_fetch_add(&h->head, 1, __ATOMIC_RELAXED);
+    r = &h->ring[pos & (FLIGHTREC_RECORDS - 1)];
+    __atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+    /* the record is marked before its content changes */
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    r->usec = (uint64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if(recorder_tid == 0) {
+        recorder_tid = (uint32_t) syscall(SYS_gettid);
+    }
+    r->tid = recorder_tid;
+    *seq = pos + 1;
+    return r;
+}
+
+/* flightrec_commit
+ * Marks a record complete.
+ */
+static void
+flightrec_commit(struct flightrec_record *r, uint64_t seq, int len)
+{
+    if(len < 0) {
+        len = 0;
+    }
+    r->len = (len < FLIGHTREC_TEXT_SIZE) ? len : FLIGHTREC_TEXT_SIZE - 1;
+    __atomic_store_n(&r->seq, seq, __ATOMIC_RELEASE);
+}
+
+/* flightrec_log
+ * Records a log line, formatted in the ring.
+ */
+void
+flightrec_log(enum vlog_level level, const char *module,
+              const char *format, ...)
+{
+    struct flightrec_record *r = NULL;
+    uint64_t seq = 0;
+    va_list args;
+    int len = 0, n = 0;
+
+    r = flightrec_begin(&seq);
+    if(r == NULL) {
+        return;
+    }
+    r->type = FLIGHTREC_LOG;
+    r->level = level;
+    len = snprintf(r->text, FLIGHTREC_TEXT_SIZE, "%s: ", module);
+    if(len >= 0 && len < FLIGHTREC_TEXT_SIZE) {
+        va_start(args, format);
+        n = vsnprintf(r->text + len, FLIGHTREC_TEXT_SIZE - len, format, args);
+        va_end(args);
+        len = (n < 0) ? len : len + n;
+    }
+    flightrec_commit(r, seq, len);
+}
+
+/* flightrec_event
+ * Records an event.
+ */
+void
+flightrec_event(int severity, const char *message)
+{
+    struct flightrec_record *r = NULL;
+    uint64_t seq = 0;
+    size_t len = strlen(message);
+
+    r = flightrec_begin(&seq);
+    if(r == NULL) {
+        return;
+    }
+    r->type = FLIGHTREC_EVENT;
+    r->level = severity;
+    if(len >= FLIGHTREC_TEXT_SIZE) {
+        len = FLIGHTREC_TEXT_SIZE - 1;
+    }
+    memcpy(r->text, message, len);
+    r->text[len] = '\0';
+    flightrec_commit(r, seq, len);
+}
+
+/* flightrec_level_name
+ * Name of the level of a record.
+ */
+static const char *
+flightrec_level_name(const struct flightrec_record *r)
+{
+    static const char *severities[] = {"EMERG", "ALERT", "CRIT", "ERR",
+                                       "WARN", "NOTICE", "INFO", "DEBUG"};
+
+    if(r->type == FLIGHTREC_EVENT) {
+        return (r->level <= LOG_DEBUG) ? severities[r->level] : "?";
+    }
+    return (r->level < VLL_N_LEVELS) ? vlog_get_level_name(r->level) : "?";
+}
+
+/* flightrec_format
+ * Formats a record as a line of the snapshot, when it is complete.
+ *
+ * Returns the length of the line, 0 if the record is not valid.
+ */
+static int
+flightrec_format(const struct flightrec_record *shared, uint64_t seq,
+                 char *line, size_t size)
+{
+    struct flightrec_record r;
+    struct tm tm;
+    time_t sec = 0;
+    char stamp[32];
+
+    if(__atomic_load_n(&shared->seq, __ATOMIC_ACQUIRE) != seq) {
+        return 0;
+    }
+    memcpy(&r, shared, sizeof(r));
+    /* the copy is only good if nobody started writing the record since */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if(__atomic_load_n(&shared->seq, __ATOMIC_RELAXED) != seq
+       || r.len >= FLIGHTREC_TEXT_SIZE) {
+        return 0;
+    }
+    r.text[r.len] = '\0';
+
+    sec = (time_t) (r.usec / 1000000);
+    if(localtime_r(&sec, &tm) == NULL
+       || strftime(stamp, sizeof(stamp), "%Y-%m-%d %H:%M:%S", &tm) == 0) {
+        snprintf(stamp, sizeof(stamp), "%lld", (long long) sec);
+    }
+    return snprintf(line, size, "%s.%06u %-6u %-5s %-5s %s\n", stamp,
+                    (unsigned int) (r.usec % 1000000), r.tid,
+                    (r.type == FLIGHTREC_EVENT) ? "event" : "log",
+                    flightrec_level_name(&r), r.text);
+}
+
+/* flightrec_open
+ * Maps the segment of another process, read only, once checked it is a
+ * flight recorder of this version.
+ *
+ * Returns the segment on success, NULL on failure.
+ */
+static const struct flightrec_header *
+flightrec_open(pid_t pid)
+{
+    const struct flightrec_header *h = NULL;
+    char name[FLIGHTREC_PATH_SIZE];
+    struct stat st;
+    int fd = -1;
+
+    flightrec_name(pid, name, sizeof(name));
+    fd = shm_open(name, O_RDONLY | O_CLOEXEC, 0);
+    if(fd < 0) {
+        return NULL;
+    }
+    if(fstat(fd, &st) || st.st_size != flightrec_size(FLIGHTREC_RECORDS)) {
+        close(fd);
+        return NULL;
+    }
+    h = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if(h == MAP_FAILED) {
+        return NULL;
+    }
+    if(h->magic != FLIGHTREC_MAGIC || h->version != FLIGHTREC_VERSION
+       || h->records != FLIGHTREC_RECORDS || h->pid != pid) {
+        munmap((void *) h, flightrec_size(FLIGHTREC_RECORDS));
+        return NULL;
+    }
+    return h;
+}
+
+/* flightrec_snapshot
+ * Writes the records of a crashed process to path, oldest first, and
+ * removes its segment.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+flightrec_snapshot(pid_t pid, const char *process, const char *path)
+{
+    const struct flightrec_header *h = NULL;
+    char line[FLIGHTREC_LINE_SIZE];
+    char tmp[FLIGHTREC_PATH_SIZE * 8];
+    uint64_t head = 0, pos = 0;
+    FILE *fp = NULL;
+    int len = 0, ret = -1;
+
+    h = flightrec_open(pid);
+    if(h == NULL) {
+        return -1;
+    }
+    /* comm is truncated to 15 characters in both */
+    if(process && strncmp(h->process, process, FLIGHTREC_PROCESS_SIZE - 1)) {
+        VLOG_DBG("Flight recorder of %d belongs to %s, not %s", (int) pid,
+                 h->process, process);
+        goto out;
+    }
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    fp = fopen(tmp, "w");
+    if(fp == NULL) {
+        VLOG_ERR("Failed to create %s: %s", tmp, strerror(errno));
+        goto out;
+    }
+    head = __atomic_load_n(&h->head, __ATOMIC_ACQUIRE);
+    pos = (head > FLIGHTREC_RECORDS) ? head - FLIGHTREC_RECORDS : 0;
+    for(; pos < head; pos++) {
+        len = flightrec_format(&h->ring[pos & (FLIGHTREC_RECORDS - 1)],
+                               pos + 1, line, sizeof(line));
+        if(len > 0) {
+            fwrite(line, 1, len, fp);
+        }
+    }
+    if(fclose(fp) || rename(tmp, path)) {
+        VLOG_ERR("Failed to write %s: %s", path, strerror(errno));
+        unlink(tmp);
+        goto out;
+    }
+    ret = 0;
+out:
+    munmap((void *) h, flightrec_size(FLIGHTREC_RECORDS));
+    flightrec_discard(pid);
+    return ret;
+}
+
+/* flightrec_discard
+ * Removes the segment of a process.
+ */
+void
+flightrec_discard(pid_t pid)
+{
+    char name[FLIGHTREC_PATH_SIZE];
+
+    flightrec_name(pid, name, sizeof(name));
+    shm_unlink(name);
+}
+
+/* flightrec_sweep
+ * Removes the segments of the processes which no longer exist, they
+ * crashed without a core dump or were killed.
+ */
+void
+flightrec_sweep(void)
+{
+    struct dirent *de = NULL;
+    DIR *dp = NULL;
+    char *end = NULL;
+    long pid = 0;
+
+    dp = opendir(FLIGHTREC_SHM_DIR);
+    while(dp && (de = readdir(dp)) != NULL) {
+        if(strncmp(de->d_name, FLIGHTREC_SHM_PREFIX,
+                   strlen(FLIGHTREC_SHM_PREFIX))) {
+            continue;
+        }
+        pid = strtol(de->d_name + strlen(FLIGHTREC_SHM_PREFIX), &end, 10);
+        if(*end != '\0' || pid <= 0) {
+            continue;
+        }
+        if(kill((pid_t) pid, 0) && errno == ESRCH) {
+            VLOG_DBG("Removing the flight recorder of %ld", pid);
+            flightrec_discard((pid_t) pid);
+        }
+    }
+    if(dp) {
+        closedir(dp);
+    }
+}
@@ -14,107 +14,90 @@
 #    License for the specific language governing permissions and limitations
 #    under the License.
 
-from systemd import journal
-import yaml
+# The events are looked up and formatted by the supportability library, as
+# for the C daemons, from the event table it builds out of ops_events.yaml.
+
+import ctypes
 import ovs.vlog
 import sys
-content = []
-category = []
 
 FAIL = -1
 NOT_FOUND = 0
-EV_CATEGORY = "event_category"
-EV_DEFINITION = "event_definitions"
-EV_NAME = "event_name"
-EV_ID = "event_ID"
-EV_SEVERITY = "severity"
-EV_DESCRIPTION = "description"
-EV_DESCRIPTION_YAML = "event_description_template"
+category = []
 
+# The library is loaded on the first event_log_init(). PyDLL keeps the GIL
+# held during the calls, the event formatting of the library is not
+# reentrant.
+libsupportability = 'libsupportability.so'
+supportability_lib = None
 
 # Logging.
 vlog = ovs.vlog.Vlog("ops-eventlog")
 
+
+def to_bytes(value):
+    if not isinstance(value, bytes):
+        value = str(value).encode('utf-8')
+    return value
+
+
+def daemon_name():
+    name = str(sys.argv[0])
+    if "/" in name:
+        name = name.split("/")[-1]
+    return name
+
+
+def load_library():
+    global supportability_lib
+    if supportability_lib is None:
+        lib = ctypes.PyDLL(libsupportability)
+        lib.event_log_init.argtypes = [ctypes.c_char_p]
+        lib.event_log_init.restype = ctypes.c_int
+        lib.log_event_kv.argtypes = [ctypes.c_char_p, ctypes.c_char_p,
+                                     ctypes.c_int,
+                                     ctypes.POINTER(ctypes.c_char_p)]
+        lib.log_event_kv.restype = ctypes.c_int
+        supportability_lib = lib
+    return supportability_lib
+
 # Initialization API for event Log category
 
 
 def event_log_init(cat):
-    global content
-    global category
-    found = 0
-# Search whether category is already initialised
-    for i in range(len(category)):
-        if cat in category[i]:
-# Already initialised, so return.
-            return FAIL
     try:
-        with open('/etc/openswitch/supportability/ops_events.yaml', 'r') as f:
-            doc = yaml.load(f)
-            f.close()
-            for txt in range(len(doc[EV_DEFINITION])):
-                yaml_cat = doc[EV_DEFINITION][txt][EV_CATEGORY]
-                if yaml_cat == cat:
-                    mydic = {
-                        EV_CATEGORY: yaml_cat,
-                        EV_NAME: doc[EV_DEFINITION][txt][EV_NAME],
-                        EV_ID: doc[EV_DEFINITION][txt][EV_ID],
-                        EV_SEVERITY: doc[EV_DEFINITION][txt][EV_SEVERITY],
-                        EV_DESCRIPTION: doc[EV_DEFINITION][
-                            txt][EV_DESCRIPTION_YAML],
-                    }
-# Now add it to global event list
-                    content.append(mydic)
-                    found = 1
-
-            if found is NOT_FOUND:
-# This means supplied category name is not there in YAML, so return.
-                vlog.err("Event Category not Found")
-                return FAIL
-            else:
-# Add category to global category list
-                category.append(cat)
-
-    except:
+        lib = load_library()
+    except OSError:
         vlog.err("Event Log Initialization Failed")
         return FAIL
+# Search whether category is already initialised, the library fails it as
+# any other error
+    if cat in category:
+        return FAIL
+    ret = lib.event_log_init(to_bytes(cat))
+    if ret < 0:
+        vlog.err("Event Log Initialization Failed")
+        return FAIL
+    if ret == NOT_FOUND:
+# This means supplied category name is not there in YAML, so return.
+        vlog.err("Event Category not Found")
+        return FAIL
+# Add category to global category list
+    category.append(cat)
 
-# Utility API used to replace key with value provided.
-
-
-def replace_str(keys, desc):
-    for j in range(len(keys)):
-        key = keys[j][0]
-        key = "{" + key + "}"
-        value = keys[j][1]
-        desc = desc.replace(str(key), str(value))
-    return desc
-
-# API to log events from a python daemon
+# API to log events from a python daemon, arg are (key, value) pairs
 
 
 def log_event(name, *arg):
-    found = 0
-    for i in range(len(content)):
-        if name == content[i][EV_NAME]:
-# Found the event in list!
-            ev_id = str(content[i][EV_ID])
-            severity = content[i][EV_SEVERITY]
-            desc = content[i][EV_DESCRIPTION]
-            categ = content[i][EV_CATEGORY]
-            if len(arg):
-                desc = replace_str(arg, desc)
-            found = 1
-            break
-    if found is NOT_FOUND:
-# This means supplied event name is not there in YAML, so return.
-        vlog.err("Event not Found")
+    if supportability_lib is None:
+        vlog.err("Event Log not Initialized")
+        return FAIL
+    pairs = (ctypes.c_char_p * len(arg))()
+    for i in range(len(arg)):
+        pairs[i] = to_bytes(arg[i][0]) + b'=' + to_bytes(arg[i][1])
+    ret = supportability_lib.log_event_kv(to_bytes(name),
+                                          to_bytes(daemon_name()),
+                                          len(arg), pairs)
+    if ret < 0:
+        vlog.err("Failed to log event %s" % name)
         return FAIL
-    mesg = 'ops-evt|' + ev_id + '|' + severity + '|' + desc
-    daemon_name = str(sys.argv[0])
-    if "/" in daemon_name:
-        daemon_name = daemon_name.split("/")[-1]
-
-    journal.send(
-        mesg, MESSAGE_ID='50c0fa81c2a545ec982a54293f1b1945', PRIORITY=severity,
-        OPS_EVENT_ID=ev_id,
-        OPS_EVENT_CATEGORY=categ, SYSLOG_IDENTIFIER=daemon_name)
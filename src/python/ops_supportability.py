@@ -17,34 +17,34 @@
 # Common Daemon for Supportability activities.
 # Currently this Daemon takes care of the following features
 # 1. Syslog configuration update
-#       Updates the syslog configuration file based on the values stored in
-#       the ovsdb.
+#       Forwards the journal to the remote syslog servers stored in the
+#       ovsdb.
 #      Its responsibilities include:
-#       - Read the ovsdb configuration for syslog during init and generate
-#         the syslog configuration file.
-#       - Monitor changes in syslog table and regenerate the syslog
-#         configuration file as needed
-#       - Restart the rsyslog daemon whenever the configuration changes.
+#       - Read the ovsdb configuration for syslog during init and hand the
+#         remotes over to the forwarder of the supportability library.
+#       - Monitor changes in syslog table and update the remotes as needed.
+#       - When the forwarder cannot start, generate the rsyslog
+#         configuration file instead and restart the rsyslog daemon
+#         whenever the configuration changes.
+# 2. Temporary vlog levels
+#       The CLI hands over the levels a daemon had before "vlog ... duration"
+#       raised them, they are restored once the duration expired, or when
+#       this daemon exits.
 
 import argparse
-import array
-import datetime
-import fcntl
+import ctypes
 import filecmp
-import glob
-import ops_eventlog
 import os
 import ovs.daemon
 import ovs.db.idl
 import ovs.dirs
 import ovs.poller
+import ovs.timeval
 import ovs.unixctl
+import ovs.unixctl.client
 import ovs.unixctl.server
-import pyinotify
 import subprocess
 import sys
-import termios
-import xattr
 import signal
 import socket
 from shutil import copyfile
@@ -70,25 +70,12 @@ SYSLOG_REMOTE_SEVERTIY_COLUMN = 'severity'
 # Default DB path.
 def_db = 'unix:/var/run/openvswitch/db.sock'
 
-# Signal to String mapping
-
-strsignal = ("Unknown signal", "Hangup", "Interrupt", "Quit",
-             "Illegal instruction", "Trace/breakpoint trap", "Aborted",
-             "Bus error", "Floating point exception", "Killed",
-             "User defined signal 1", "Segmentation fault",
-             "User defined signal 2", "Broken pipe", "Alarm clock",
-             "Terminated", "Stack fault", "Child exited", "Continued",
-             "Stopped (signal)", "Stopped", "Stopped (tty input)",
-             "Stopped (tty output)", "Urgent I/O condition",
-             "CPU time limit exceeded", "File size limit exceeded",
-             "Virtual timer expired", "Profiling timer expired",
-             "Window changed", "I/O possible", "Power failure",
-             "Bad system call")
-
-core_folder = '/var/lib/systemd/coredump/'
-processed_files = core_folder + 'processed_core_files.cfl'
-core_pattern = core_folder + 'core*'
-watchmanager_inst = None
+# Crash processing and syslog forwarding are done by the supportability
+# daemon library
+libsupportability = 'libsupportability_daemon.so'
+supportability_lib = None
+crash_fd = -1
+forward_fd = -1
 
 # TODO: Need to pull these from the build env.
 ovs_schema = '/usr/share/openvswitch/vswitch.ovsschema'
@@ -98,10 +85,13 @@ vlog = ovs.vlog.Vlog("ops-supportabilityd")
 # Globals
 exiting = False
 seqno = 0
-syslog_transport = ''
-syslog_remote = ''
-syslog_port_number = 0
-syslog_severity = 'info'
+# Remotes applied, (transport, host, port) -> severity, None before the
+# first reconfiguration
+syslog_remotes = None
+
+# Temporary vlog levels, daemon name -> [deadline in msec,
+# setting shown by the CLI, vlog/set specs restoring the previous levels]
+vlog_reverts = {}
 
 
 def is_ipv6(address):
@@ -119,37 +109,81 @@ def unixctl_exit(conn, unused_argv, unused_aux):
     conn.reply(None)
 
 
-# ------------------- post_crash_processing() -----------------
-# Performs post crash task
-# Currently this function performs the following action
-# 1. Send Crash Event Log
-#      Read core dump information stored in the extended attributes of the
-#      core dump file and send crash event using this information.
-def post_crash_processing(corefile):
+# ---------------- unixctl_vlog_revert() ------------------------
+# vlog/revert DAEMON SECONDS SETTING [SPEC...]
+# Restores the levels of SPECs on DAEMON after SECONDS. When the daemon
+# already has a pending revert only its deadline moves, the levels to
+# restore stay the ones before the first raise.
+def unixctl_vlog_revert(conn, argv, unused_aux):
+    daemon = argv[0]
     try:
-        # Name of the Crashed process
-        # ToFix :: In case of python based daemon crash, this value just
-        #          has the name "python", it doesn't provide information
-        #          on which daemon crashed.  This needs to be improved.
-        process = xattr.getxattr(corefile, 'user.coredump.comm')
-
-        # Signal Number leading to crash
-        signal = int(xattr.getxattr(corefile, 'user.coredump.signal'))
-        if signal >= len(strsignal):
-            signal = 0
-
-        # Timestamp of the crash event
-        timestamp = xattr.getxattr(corefile, 'user.coredump.timestamp')
-        timestamp_human = datetime.datetime.fromtimestamp(
-            int(timestamp)
-        ).strftime('%Y-%m-%d %H:%M:%S')
-
-        ops_eventlog.log_event('SUPPORTABILITY_DAEMON_CRASH',
-                               ['process', process],
-                               ['signal', strsignal[signal]],
-                               ['timestamp', timestamp_human])
-    except:
-        vlog.dbg("Invalid core dump file found")
+        seconds = int(argv[1])
+    except ValueError:
+        conn.reply_error("invalid duration " + argv[1])
+        return
+
+    if daemon in vlog_reverts:
+        specs = vlog_reverts[daemon][2]
+    else:
+        specs = argv[3:]
+    vlog_reverts[daemon] = [ovs.timeval.msec() + seconds * 1000, argv[2],
+                            specs]
+    vlog.info("%s vlog %s for %d seconds" % (daemon, argv[2], seconds))
+    conn.reply(None)
+
+
+# ---------------- unixctl_vlog_overrides() ---------------------
+# One "daemon setting seconds" line per pending revert
+def unixctl_vlog_overrides(conn, unused_argv, unused_aux):
+    now = ovs.timeval.msec()
+    lines = ""
+    for daemon, (deadline, setting, specs) in sorted(vlog_reverts.items()):
+        lines += "%s %s %d\n" % (daemon, setting,
+                                 max(0, (deadline - now + 999) // 1000))
+    conn.reply(lines)
+
+
+# ---------------- vlog_revert() --------------------------------
+def vlog_revert(daemon, specs):
+    if len(specs) == 0:
+        return
+
+    pid = ovs.daemon.read_pidfile("%s/%s.pid" % (ovs.dirs.RUNDIR, daemon))
+    if pid < 0:
+        # the levels went away with the daemon
+        vlog.info("%s is not running, no vlog level to revert" % daemon)
+        return
+
+    error, client = ovs.unixctl.client.UnixctlClient.create(
+        "%s/%s.%d.ctl" % (ovs.dirs.RUNDIR, daemon, pid))
+    if error:
+        vlog.err("Failed to connect to %s to revert its vlog levels: %s"
+                 % (daemon, os.strerror(error)))
+        return
+
+    error, err_str, unused_result = client.transact("vlog/set", specs)
+    client.close()
+    if error or err_str:
+        vlog.err("Failed to revert the vlog levels of %s: %s"
+                 % (daemon, err_str if err_str else os.strerror(error)))
+    else:
+        vlog.info("%s vlog levels reverted" % daemon)
+
+
+# ---------------- vlog_revert_run() ----------------------------
+def vlog_revert_run():
+    now = ovs.timeval.msec()
+    for daemon, (deadline, setting, specs) in list(vlog_reverts.items()):
+        if deadline <= now:
+            del vlog_reverts[daemon]
+            vlog_revert(daemon, specs)
+
+
+# ---------------- vlog_revert_wait() ---------------------------
+def vlog_revert_wait(poller):
+    if vlog_reverts:
+        poller.timer_wait_until(min(r[0] for r in vlog_reverts.values()))
+
 
 # ---------------- journald_init() ------------------------------
 # Flush systemd-journald & make journal logs persistent
@@ -165,75 +199,65 @@ def journald_init():
     journal_pid = check_output(["pidof", "systemd-journald"])
     os.kill(int(journal_pid), signal.SIGUSR1)
 
-# ---------------- process_coredumps() ------------------------------
-# Checks whether a new core dump is available.  If found it will
-# call post_crash_processing to perform post crash processing
-
-
-def process_coredumps():
-    corefile_list = glob.glob(core_pattern)
-    new_core_dump_found = False
-
-    # If the processed file is not available, then create the same
-    if os.path.exists(processed_files) is not True:
-        with open(processed_files, "w") as f:
-            pass
-
-    # Chech whether the coredump files available in the coredump folder
-    # are already processed.  In case if a file is not processed, call
-    # post_crash_processing over that file.
-    with open(processed_files, "r") as f:
-        try:
-            for corefile in corefile_list:
-                core_existing = False
-                f.seek(0)
-                for line in f:
-                    if corefile in line:
-                        core_existing = True
-                        break
-                if core_existing is False:
-                    new_core_dump_found = True
-                    post_crash_processing(corefile)
-        except:
-            vlog.info("Hit exception during coredump processing")
-
-    # Update the processed coredump list file
-    if new_core_dump_found:
-        with open(processed_files, "w") as f:
-            f.write(str(corefile_list))
-
-
 # We are using inotify to watch the core dump folder for new core dumps
 # The fd returned by inotify is polled using ovs poller for notification
 # ovs poller will return when one of the fd it polls over has become readable
-# This function checks whether inotify fd has become readable or not
-# If inotify fd is readable then it will call the process_coredumps function
-# to process the core dump present
+# The library reads the pending notifications and logs a crash event for each
+# new core dump, without scanning the core dump folder
 def crashprocessing_run():
-    global watchmanager_inst
-    watch_fd = watchmanager_inst.get_fd()
-    sizebuffer = array.array('i', [0])
-
-    if fcntl.ioctl(watch_fd, termios.FIONREAD, sizebuffer, 1) == -1:
+    if crash_fd < 0:
         return
 
-    bytes_available = sizebuffer[0]
-    if bytes_available > 0:
-        vlog.dbg("Core Dump file available " + str(bytes_available))
-        os.read(watch_fd, bytes_available)
-        process_coredumps()
+    logged = supportability_lib.crash_processing_run()
+    if logged > 0:
+        vlog.dbg("Core Dump files processed " + str(logged))
 
 
 # Watches core dump folder for new core dump files
-# Uses INotify system call to monitor the core dump folder
-# INotify returns a fd which could be polled for notification
 # Uses the ovs poller and adds the fd for polling.
-# Currently the poller polls over ovsdb, unixctl and inotify
+# Currently the poller polls over ovsdb, unixctl and inotify. The timeout is
+# for the next core dump exceeding the age limit of the retention policy
 def crashprocessing_poll(poller):
-    global watchmanager_inst
+    if crash_fd < 0:
+        return
+
+    poller.fd_wait(crash_fd, ovs.poller.POLLIN)
+    timeout = supportability_lib.crash_processing_timeout()
+    if timeout >= 0:
+        poller.timer_wait(timeout)
+
+
+# The journal fd is readable when there are new entries, the timeout is
+# for the remotes being retried or which took all they could
+def syslogforward_run():
+    if forward_fd < 0:
+        return
+
+    supportability_lib.syslog_forward_run()
+
+
+def syslogforward_poll(poller):
+    if forward_fd < 0:
+        return
+
+    poller.fd_wait(forward_fd, ovs.poller.POLLIN)
+    timeout = supportability_lib.syslog_forward_timeout()
+    if timeout >= 0:
+        poller.timer_wait(timeout)
+
 
-    watch_fd = watchmanager_inst.get_fd()
-    poller.fd_wait(watch_fd, ovs.poller.POLLIN)
+# ---------------- unixctl_syslog_stats() -----------------------
+# Shows the spool and the connection of each remote
+def unixctl_syslog_stats(conn, unused_argv, unused_aux):
+    if forward_fd < 0:
+        conn.reply_error("syslog is forwarded by rsyslog")
+        return
+
+    stats = ctypes.create_string_buffer(16384)
+    if supportability_lib.syslog_forward_stats(stats, len(stats)) < 0:
+        conn.reply_error("too many remotes")
+        return
+    conn.reply(stats.value)
 
 
 # ---------------- supportability_run_command() ------------
@@ -265,7 +289,9 @@ def supportability_init(remote):
     '''
 
     global idl
-    global watchmanager_inst
+    global supportability_lib
+    global crash_fd
+    global forward_fd
     schema_helper = ovs.db.idl.SchemaHelper(location=ovs_schema)
     schema_helper.register_columns(SYSTEM_TABLE,
                                    [SYSTEM_SYSLOG_REMOTES_COLUMN])
@@ -295,28 +321,82 @@ def supportability_init(remote):
     # make the journal persistent after sending SIGUSR1
     journald_init()
 
-    ops_eventlog.event_log_init('SUPPORTABILITY')
+    # Starts watching the core dump folder, boot time core dumps are
+    # processed right away
+    supportability_lib = ctypes.CDLL(libsupportability)
+    crash_fd = supportability_lib.crash_processing_init()
+    if crash_fd < 0:
+        vlog.err("Failed to initialize crash processing")
 
-    watchmanager_inst = pyinotify.WatchManager()
+    # Forwards the journal from where it stopped, rsyslog forwards it when
+    # this fails
+    forward_fd = supportability_lib.syslog_forward_init()
+    if forward_fd < 0:
+        vlog.err("Failed to initialize syslog forwarding, using rsyslog")
 
-    watchmanager_inst.add_watch(core_folder,
-                                pyinotify.IN_MOVED_TO)
 
-    # Check boot time core dumps
-    process_coredumps()
+# ------------------ syslog_remotes_read() ----------------
+def syslog_remotes_read():
+    '''
+    Returns the remotes of the Syslog_Remote table, (transport, host, port)
+    -> severity, with the defaults of the columns which are not set
+    '''
+    remotes = {}
+    for syslog_row in idl.tables[SYSLOG_REMOTE_TABLE].rows.itervalues():
+        # Set Default Tranport Method
+        if len(syslog_row.transport) == 0:
+            transport = "udp"
+        else:
+            transport = syslog_row.transport[0]
+
+        # Set Default Port
+        if len(syslog_row.port_number) > 0:
+            port_number = syslog_row.port_number[0]
+        elif transport == "tcp":
+            port_number = 1470
+        else:
+            port_number = 514
+
+        # Set Default Severity
+        if len(syslog_row.severity) == 0:
+            severity = "info"
+        else:
+            severity = syslog_row.severity[0]
+
+        remotes[(transport, syslog_row.remote_host, port_number)] = severity
+    return remotes
+
+
+# ------------------ syslog_forward_update() ----------------
+def syslog_forward_update(remotes):
+    '''
+    Applies the remotes added, changed or removed since the last update to
+    the forwarder, the spools of the other remotes are left alone
+    '''
+    if syslog_remotes is None:
+        supportability_lib.syslog_forward_begin()
+        for (transport, remote, port), severity in remotes.items():
+            supportability_lib.syslog_forward_add(str(remote), str(transport),
+                                                  int(port), str(severity))
+        supportability_lib.syslog_forward_commit()
+        return
 
+    for (transport, remote, port) in syslog_remotes:
+        if (transport, remote, port) not in remotes:
+            supportability_lib.syslog_forward_remove(str(remote),
+                                                     str(transport),
+                                                     int(port))
+    for (transport, remote, port), severity in remotes.items():
+        if syslog_remotes.get((transport, remote, port)) != severity:
+            supportability_lib.syslog_forward_add(str(remote), str(transport),
+                                                  int(port), str(severity))
 
-# ------------------ supportability_reconfigure() ----------------
-def supportability_reconfigure():
-    # Check if any of the monitored parameter has changed,
-    # if changed then update the configuration
-    global syslog_transport
-    global syslog_remote
-    global syslog_port_number
-    global syslog_severity
-
-    vlog.info("supportability reconfiguration called")
 
+# ------------------ syslog_rsyslog_update() ----------------
+def syslog_rsyslog_update(remotes):
+    '''
+    Generates the remotes of rsyslog, restarted when they changed
+    '''
     sysserver_tmpl_udp = Template('*.$severity @$remote:$port\n')
     sysserver_tmpl_tcp = Template('*.$severity @@$remote:$port\n')
 
@@ -325,57 +405,28 @@ def supportability_reconfigure():
 
     syslogfile = open("/tmp/rsyslog.remote.conf", "w")
 
-    for syslog_row in idl.tables[SYSLOG_REMOTE_TABLE].rows.itervalues():
-        if syslog_row is not None:
-            # Set Default Severity
-            if len(syslog_row.severity) == 0:
-                syslog_severity = "info"
-            else:
-                syslog_severity = syslog_row.severity[0]
+    # The forwarder sends the remotes itself
+    if forward_fd >= 0:
+        remotes = {}
 
-            # Set Default Tranport Method
-            if len(syslog_row.transport) == 0:
-                syslog_transport = "udp"
+    for (transport, remote, port) in sorted(remotes):
+        if transport == "udp":
+            if is_ipv6(remote):
+                tmpl = ipv6sysserver_tmpl_udp
             else:
-                syslog_transport = syslog_row.transport[0]
-
-            # Set Default Port
-            if syslog_transport == "udp":
-                if len(syslog_row.port_number) > 0:
-                    syslog_port_number = syslog_row.port_number[0]
-                else:
-                    syslog_port_number = 514
-
-                if is_ipv6(syslog_row.remote_host):
-                    syslogfile.write(ipv6sysserver_tmpl_udp.safe_substitute(
-                                     severity=syslog_severity,
-                                     remote=syslog_row.remote_host,
-                                     port=syslog_port_number
-                                     ))
-                else:
-                    syslogfile.write(sysserver_tmpl_udp.safe_substitute(
-                                     severity=syslog_severity,
-                                     remote=syslog_row.remote_host,
-                                     port=syslog_port_number
-                                     ))
-            elif syslog_transport == "tcp":
-                if len(syslog_row.port_number) > 0:
-                    syslog_port_number = syslog_row.port_number[0]
-                else:
-                    syslog_port_number = 1470
-
-                if is_ipv6(syslog_row.remote_host):
-                    syslogfile.write(ipv6sysserver_tmpl_tcp.safe_substitute(
-                                     severity=syslog_severity,
-                                     remote=syslog_row.remote_host,
-                                     port=syslog_port_number
-                                     ))
-                else:
-                    syslogfile.write(sysserver_tmpl_tcp.safe_substitute(
-                                     severity=syslog_severity,
-                                     remote=syslog_row.remote_host,
-                                     port=syslog_port_number
-                                     ))
+                tmpl = sysserver_tmpl_udp
+        elif transport == "tcp":
+            if is_ipv6(remote):
+                tmpl = ipv6sysserver_tmpl_tcp
+            else:
+                tmpl = sysserver_tmpl_tcp
+        else:
+            continue
+        syslogfile.write(tmpl.safe_substitute(
+                         severity=remotes[(transport, remote, port)],
+                         remote=remote,
+                         port=port
+                         ))
 
     syslogfile.close()
 
@@ -400,6 +451,29 @@ def supportability_reconfigure():
     os.remove("/tmp/rsyslog.remote.conf")
 
 
+# ------------------ supportability_reconfigure() ----------------
+def supportability_reconfigure():
+    # Check if any of the monitored parameter has changed,
+    # if changed then update the configuration
+    global syslog_remotes
+
+    remotes = syslog_remotes_read()
+    if remotes == syslog_remotes:
+        return
+
+    vlog.info("supportability reconfiguration called")
+
+    if forward_fd >= 0:
+        syslog_forward_update(remotes)
+
+    # With the forwarder, rsyslog is left without remotes on the first
+    # reconfiguration only
+    if forward_fd < 0 or syslog_remotes is None:
+        syslog_rsyslog_update(remotes)
+
+    syslog_remotes = remotes
+
+
 # ------------------ supportability_run() ----------------
 def supportability_run():
 
@@ -446,6 +520,13 @@ def main():
     ovs.daemon.daemonize()
 
     ovs.unixctl.command_register("exit", "", 0, 0, unixctl_exit, None)
+    ovs.unixctl.command_register("vlog/revert",
+                                 "daemon seconds setting [spec...]",
+                                 3, sys.maxsize, unixctl_vlog_revert, None)
+    ovs.unixctl.command_register("vlog/overrides", "", 0, 0,
+                                 unixctl_vlog_overrides, None)
+    ovs.unixctl.command_register("syslog/stats", "", 0, 0,
+                                 unixctl_syslog_stats, None)
     error, unixctl_server = ovs.unixctl.server.UnixctlServer.create(None)
 
     if error:
@@ -464,6 +545,10 @@ def main():
 
         crashprocessing_run()
 
+        syslogforward_run()
+
+        vlog_revert_run()
+
         if exiting:
             break
 
@@ -472,8 +557,18 @@ def main():
             unixctl_server.wait(poller)
             idl.wait(poller)
             crashprocessing_poll(poller)
+            syslogforward_poll(poller)
+            vlog_revert_wait(poller)
             poller.block()
 
+    # Raised levels are not left behind
+    for daemon, (deadline, setting, specs) in list(vlog_reverts.items()):
+        vlog_revert(daemon, specs)
+
+    # The spools are kept for the next start
+    if forward_fd >= 0:
+        supportability_lib.syslog_forward_exit()
+
     # Daemon Exit.
     unixctl_server.close()
     idl.close()
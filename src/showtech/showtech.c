@@ -23,8 +23,14 @@
  ***************************************************************************/
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
 #include <yaml.h>
 #include "showtech.h"
+#include "config_watch.h"
 #include "openvswitch/vlog.h"
 
 VLOG_DEFINE_THIS_MODULE(showtech);
@@ -44,11 +50,23 @@ enum
   TABLE,
   TABLE_NAME,
   COLNAMES,
+  COMMAND,
+  TIMEOUT,
+  PRIORITY,
+  MAX_OUTPUT_BYTES,
   VALUE,
   MAX_NUM_KEYS
 };
 
-static struct feature* feature_head;
+/* list under construction by the parser */
+static struct feature* parse_head;
+/* table in use, swapped in one step on reload */
+static struct showtech_table* current_table;
+/* reference held for the caller of get_showtech_config */
+static struct showtech_table* config_table;
+static pthread_mutex_t showtech_table_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct config_watch showtech_watch =
+  CONFIG_WATCH_INITIALIZER ("show tech", SHOWTECH_DEFAULT_CONFIG);
 static const char* keystr[MAX_NUM_KEYS] =
 {
    "feature",
@@ -64,11 +82,22 @@ static const char* keystr[MAX_NUM_KEYS] =
    "table",
    "table_name",
    "col_names",
+   "command",
+   "timeout",
+   "priority",
+   "max_output_bytes",
    "values"
 };
 
+static const char* prioritystr[SHOWTECH_PRIORITY_MAX] =
+{
+   "critical",
+   "high",
+   "normal",
+   "low"
+};
+
 #define SHOWTECH_CMD_PATTERN      "^\\s*show\\s+tech\\s*"
-static  regex_t showtechregx;
 
 
 /* getValueType
@@ -326,9 +355,10 @@ static struct clicmds*
 add_clicmds (struct clicmds* afternode, const char* command)
 {
   struct clicmds* element = NULL;
+  const regex_t* showtechregx = regex_cache_get(SHOWTECH_CMD_PATTERN);
 
   /* verify that the cli command "show tech" is not added here */
-  if(regexec(&showtechregx,command, 0,NULL,0) == 0)
+  if(showtechregx && regexec(showtechregx,command, 0,NULL,0) == 0)
   {
      /* show tech is given as the cli command, dont add it
       * otherwise it might result in recursion */
@@ -348,6 +378,8 @@ add_clicmds (struct clicmds* afternode, const char* command)
 
 
   element->command = strdup_with_nullcheck (command);
+  element->timeout = SHOWTECH_CMD_DEFAULT_TIMEOUT;
+  element->priority = SHOWTECH_PRIORITY_NORMAL;
   if (afternode != NULL)
   {
     element->next = afternode->next;
@@ -355,6 +387,115 @@ add_clicmds (struct clicmds* afternode, const char* command)
   }
   return element;
 
+}
+
+ /* parse_ulong
+  *
+  * Converts a decimal configuration value, the whole string has to be a
+  * number
+  *
+  * returns 0 on success and -1 on failure
+  */
+
+static int
+parse_ulong (const char* value, unsigned long* result)
+{
+  char* end = NULL;
+
+  if (value == NULL || !isdigit ((unsigned char) *value))
+  {
+    return -1;
+  }
+  errno = 0;
+  *result = strtoul (value, &end, 10);
+  if (errno || *end != '\0')
+  {
+    return -1;
+  }
+  return 0;
+}
+
+ /* set_clicmd_timeout
+  *
+  * Sets the time the cli command is allowed to run. An invalid value keeps
+  * the default, a single bad entry should not disable show tech.
+  *
+  * returns 0 on success and -1 on failure
+  */
+
+static int
+set_clicmd_timeout (struct clicmds* element, const char* timeout)
+{
+  unsigned long secs = 0;
+
+  if (element == NULL)
+  {
+    return -1;
+  }
+  if (parse_ulong (timeout, &secs) || secs == 0
+      || secs > SHOWTECH_CMD_MAX_TIMEOUT)
+  {
+    VLOG_ERR ("Invalid timeout %s for command %s, allowed range is 1-%d",
+      timeout, element->command, SHOWTECH_CMD_MAX_TIMEOUT);
+    return -1;
+  }
+  element->timeout = secs;
+  return 0;
+}
+
+ /* set_clicmd_priority
+  *
+  * Sets the execution class of the cli command
+  *
+  * returns 0 on success and -1 on failure
+  */
+
+static int
+set_clicmd_priority (struct clicmds* element, const char* priority)
+{
+  int i = 0;
+
+  if (element == NULL)
+  {
+    return -1;
+  }
+  for (i = 0; i < SHOWTECH_PRIORITY_MAX; i++)
+  {
+    if (!strcmp_with_nullcheck (prioritystr[i], priority))
+    {
+      element->priority = i;
+      return 0;
+    }
+  }
+  VLOG_ERR ("Invalid priority %s for command %s", priority, element->command);
+  return -1;
+}
+
+ /* set_clicmd_max_output
+  *
+  * Sets the number of output bytes of the cli command that is displayed,
+  * 0 displays everything
+  *
+  * returns 0 on success and -1 on failure
+  */
+
+static int
+set_clicmd_max_output (struct clicmds* element, const char* max_output)
+{
+  unsigned long bytes = 0;
+
+  if (element == NULL)
+  {
+    return -1;
+  }
+  if (parse_ulong (max_output, &bytes))
+  {
+    VLOG_ERR ("Invalid max_output_bytes %s for command %s",
+      max_output, element->command);
+    return -1;
+  }
+  element->max_output_bytes = bytes;
+  return 0;
 }
 
  /* add_ovstable
@@ -508,24 +649,21 @@ list_config (struct feature* head)
 
 }
 
-/* free_feature_data
+/* free_feature_list
  *
  * Function used to free the Show Tech Data structure which was used to
  * hold the show tech configuration.
- * This function is also responsible to reset the head pointer
-
  */
 
 static void
-free_feature_data ()
+free_feature_list (struct feature* head)
 {
-  struct feature* iter = feature_head;
+  struct feature* iter = head;
   struct sub_feature* iter_sub = NULL;
   struct clicmds* iter_cli = NULL;
   struct ovstable* iter_table = NULL;
   struct ovscolm* iter_col = NULL;
   void* tempptr = NULL;
-  feature_head = NULL;
   while (iter != NULL)
   {
       /* Free Feature Specific Data */
@@ -589,16 +727,16 @@ free_feature_data ()
   }
 }
 
-/* free_show_tech_config
+/* free_feature_data
  *
- * Function used to Free Show Tech Configuration.
- * All necessary datastructure and other free activities will be done here
- * This is exported as an API to other modules
+ * Frees the partially parsed configuration and resets the parser head
  */
-void
-free_show_tech_config ()
+
+static void
+free_feature_data ()
 {
-  free_feature_data ();
+  free_feature_list (parse_head);
+  parse_head = NULL;
 }
 
 /* parse_showtech_config
@@ -620,12 +758,12 @@ parse_showtech_config (const char* config_file)
   struct clicmds* curr_clicmd = NULL;
   struct ovstable* curr_table = NULL;
   struct ovscolm* curr_col = NULL;
-  const char* default_config_file = "/etc/openswitch/supportability/ops_showtech.yaml";
+  const char* default_config_file = SHOWTECH_DEFAULT_CONFIG;
   const char* cf = NULL;
   VLOG_INFO("Show Tech configuration parser invoked");
 
-  /* Free the Datastructure in use */
-  free_show_tech_config ();
+  /* The previous result is owned by a command table now */
+  parse_head = NULL;
   /* Initialize parser */
 
   if (!yaml_parser_initialize (&parser))
@@ -680,7 +818,7 @@ parse_showtech_config (const char* config_file)
               {
                 VLOG_ERR ("Parsing error while adding new feature %s",
                   (const char*) event.data.scalar.value);
-                free_show_tech_config ();
+                free_feature_data ();
                 goto CLEAN_UP;
               }
               add_feature_name (curr_feature,
@@ -694,7 +832,7 @@ parse_showtech_config (const char* config_file)
                 VLOG_ERR (
                   "Parsing error while adding new feature description : %s",
                   (const char*) event.data.scalar.value);
-                free_show_tech_config ();
+                free_feature_data ();
                 goto CLEAN_UP;
               }
 
@@ -709,7 +847,7 @@ parse_showtech_config (const char* config_file)
                 VLOG_ERR (
                   "Parsing error while adding new sub feature %s",
                   (const char*) event.data.scalar.value);
-                free_show_tech_config ();
+                free_feature_data ();
                 goto CLEAN_UP;
               }
 
@@ -725,7 +863,7 @@ parse_showtech_config (const char* config_file)
                 VLOG_ERR (
                   "Parsing error while adding new sub feature description :  %s",
                   (const char*) event.data.scalar.value);
-                free_show_tech_config ();
+                free_feature_data ();
                 goto CLEAN_UP;
               }
               add_subfeature_desc (
@@ -745,7 +883,7 @@ parse_showtech_config (const char* config_file)
                 {
                   VLOG_ERR (
                     "Parsing error while adding dummy sub feature ");
-                  free_show_tech_config ();
+                  free_feature_data ();
                   goto CLEAN_UP;
                 }
                 set_subfeature_as_dummy(curr_subfeature);
@@ -774,7 +912,7 @@ parse_showtech_config (const char* config_file)
                 {
                   VLOG_ERR (
                     "Parsing error while adding dummy sub feature ");
-                  free_show_tech_config ();
+                  free_feature_data ();
                   goto CLEAN_UP;
                 }
                 set_subfeature_as_dummy(curr_subfeature);
@@ -804,7 +942,7 @@ parse_showtech_config (const char* config_file)
                 {
                   VLOG_ERR (
                     "Parsing error while adding dummy sub feature ");
-                  free_show_tech_config ();
+                  free_feature_data ();
                   goto CLEAN_UP;
                 }
                 set_subfeature_as_dummy(curr_subfeature);
@@ -822,7 +960,7 @@ parse_showtech_config (const char* config_file)
               {
                 VLOG_ERR (
                   "Parsing error while adding cli command ");
-                free_show_tech_config ();
+                free_feature_data ();
                 goto CLEAN_UP;
               }
               if (curr_subfeature->p_clicmds == NULL)
@@ -841,7 +979,7 @@ parse_showtech_config (const char* config_file)
               {
                 VLOG_ERR ("Parsing error while adding table %s ",
                   (const char*) event.data.scalar.value);
-                free_show_tech_config ();
+                free_feature_data ();
                 goto CLEAN_UP;
               }
               add_ovstable_name (curr_table,
@@ -854,7 +992,7 @@ parse_showtech_config (const char* config_file)
               {
                 VLOG_ERR ("Parsing error while adding column %s ",
                   (const char*) event.data.scalar.value);
-                free_show_tech_config ();
+                free_feature_data ();
                 goto CLEAN_UP;
               }
               curr_col = add_ovscolumn (
@@ -863,7 +1001,7 @@ parse_showtech_config (const char* config_file)
               {
                 VLOG_ERR ("Parsing error while adding column %s ",
                   (const char*) event.data.scalar.value);
-                free_show_tech_config ();
+                free_feature_data ();
                 goto CLEAN_UP;
               }
               if (curr_table->p_colmname == NULL)
@@ -872,6 +1010,37 @@ parse_showtech_config (const char* config_file)
               }
               break;
             }
+            case TIMEOUT:
+            case PRIORITY:
+            case MAX_OUTPUT_BYTES:
+            {
+              /* attributes follow the command key of the same entry */
+              if (NULL == curr_clicmd)
+              {
+                VLOG_ERR ("Parsing error, %s %s is not preceded by a command",
+                  keystr[current_state], (const char*) event.data.scalar.value);
+                free_feature_data ();
+                goto CLEAN_UP;
+              }
+              if (current_state == TIMEOUT)
+              {
+                set_clicmd_timeout (curr_clicmd,
+                  (const char*) event.data.scalar.value);
+              }
+              else if (current_state == PRIORITY)
+              {
+                set_clicmd_priority (curr_clicmd,
+                  (const char*) event.data.scalar.value);
+              }
+              else
+              {
+                set_clicmd_max_output (curr_clicmd,
+                  (const char*) event.data.scalar.value);
+              }
+              /* plain command strings may follow in the same list */
+              current_state = CLI_CMDS;
+              break;
+            }
             default:
             {
               VLOG_ERR ("Unexpected state : %d %s", current_state,
@@ -892,12 +1061,12 @@ parse_showtech_config (const char* config_file)
           if (NULL == curr_feature)
           {
             VLOG_ERR ("Parsing error while adding new feature");
-            free_show_tech_config ();
+            free_feature_data ();
             goto CLEAN_UP;
           }
-          if (!feature_head)
+          if (!parse_head)
           {
-            feature_head = curr_feature;
+            parse_head = curr_feature;
           }
 
           break;
@@ -922,14 +1091,14 @@ parse_showtech_config (const char* config_file)
           if (NULL == curr_feature)
           {
             VLOG_ERR ("Parsing error while creating new subfeature ");
-            free_show_tech_config ();
+            free_feature_data ();
             goto CLEAN_UP;
           }
           curr_subfeature = add_subfeature (curr_subfeature);
           if (NULL == curr_subfeature)
           {
             VLOG_ERR ("Parsing error while adding new subfeature");
-            free_show_tech_config ();
+            free_feature_data ();
             goto CLEAN_UP;
           }
 
@@ -961,10 +1130,20 @@ parse_showtech_config (const char* config_file)
           break;
         }
         case CLI_CMDS:
+        case COMMAND:
         {
+          /* a cli_cmds entry is either the command string or a map with
+           * the command and its attributes */
           current_state = CLI_CMDS;
           break;
         }
+        case TIMEOUT:
+        case PRIORITY:
+        case MAX_OUTPUT_BYTES:
+        {
+          current_state = event_value;
+          break;
+        }
         case OVSDB:
         {
           current_state = OVSDB;
@@ -976,7 +1155,7 @@ parse_showtech_config (const char* config_file)
           if (NULL == curr_feature)
           {
             VLOG_ERR ("Parsing error while creating new table ");
-            free_show_tech_config ();
+            free_feature_data ();
             goto CLEAN_UP;
           }
           current_state = TABLE;
@@ -989,7 +1168,7 @@ parse_showtech_config (const char* config_file)
             {
               VLOG_ERR (
                 "Parsing error while adding dummy sub feature ");
-              free_show_tech_config ();
+              free_feature_data ();
               goto CLEAN_UP;
             }
             set_subfeature_as_dummy(curr_subfeature);
@@ -1009,7 +1188,7 @@ parse_showtech_config (const char* config_file)
           {
             VLOG_ERR (
               "Parsing error while adding new table ");
-            free_show_tech_config ();
+            free_feature_data ();
             goto CLEAN_UP;
           }
           if (curr_subfeature->p_ovstable == NULL)
@@ -1035,7 +1214,7 @@ parse_showtech_config (const char* config_file)
     if (!yaml_parser_parse (&parser, &event))
     {
       VLOG_ERR ("Parser error %d\n", parser.error);
-      free_show_tech_config ();
+      free_feature_data ();
       goto CLEAN_UP;
     }
   }
@@ -1045,30 +1224,431 @@ CLEAN_UP:
   yaml_event_delete (&event);
   yaml_parser_delete (&parser);
   fclose (fh);
-  return feature_head;
+  return parse_head;
+}
+
+/* showtech_hash
+ *
+ * FNV-1a hash of a feature name and an optional sub feature name
+ */
+static uint32_t
+showtech_hash (const char* feature, const char* sub_feature)
+{
+  uint32_t hash = 2166136261u;
+  const unsigned char* p = NULL;
+
+  for (p = (const unsigned char*) feature; p && *p; p++)
+  {
+    hash = (hash ^ *p) * 16777619u;
+  }
+  /* separator, so that "ab"+"c" and "a"+"bc" differ */
+  hash = (hash ^ 0xff) * 16777619u;
+  for (p = (const unsigned char*) sub_feature; p && *p; p++)
+  {
+    hash = (hash ^ *p) * 16777619u;
+  }
+  return hash;
+}
+
+/* name_equal
+ *
+ * String equality where two NULL names are equal
+ */
+static int
+name_equal (const char* name1, const char* name2)
+{
+  if (name1 == NULL || name2 == NULL)
+  {
+    return name1 == name2;
+  }
+  return !strcmp (name1, name2);
+}
+
+/* add_group
+ *
+ * Inserts a feature or sub feature range in to the open addressing hash
+ * index. The first definition of a name wins, as it did with the list walk.
+ */
+static void
+add_group (struct showtech_table* table, struct feature* feat,
+  struct sub_feature* sub, size_t first, size_t count)
+{
+  const char* sub_name = sub ? sub->name : NULL;
+  size_t mask = table->index_size - 1;
+  size_t slot = showtech_hash (feat->name, sub_name) & mask;
+  struct showtech_group* group = NULL;
+
+  if (feat->name == NULL || (sub && sub_name == NULL))
+  {
+    return;
+  }
+  for (;; slot = (slot + 1) & mask)
+  {
+    group = &table->index[slot];
+    if (group->feature == NULL)
+    {
+      break;
+    }
+    if (name_equal (group->feature, feat->name)
+        && name_equal (group->sub_feature, sub_name))
+    {
+      /* duplicate definition */
+      return;
+    }
+  }
+  group->feature = feat->name;
+  group->sub_feature = sub_name;
+  group->p_feature = feat;
+  group->p_subfeature = sub;
+  group->first = first;
+  group->count = count;
+}
+
+/* compile_showtech_table
+ *
+ * Flattens the parsed feature -> sub feature -> command lists in to one
+ * contiguous command table and builds the hash index on top of it
+ *
+ * returns the table on success and NULL on failure
+ */
+static struct showtech_table*
+compile_showtech_table (struct feature* head)
+{
+  struct showtech_table* table = NULL;
+  struct feature* iter = NULL;
+  struct sub_feature* iter_sub = NULL;
+  struct clicmds* iter_cli = NULL;
+  size_t n_rows = 0, n_groups = 0, row = 0, feat_first = 0, sub_first = 0;
+
+  for (iter = head; iter; iter = iter->next)
+  {
+    n_groups++;
+    if (iter->p_subfeature == NULL)
+    {
+      n_rows++;
+    }
+    for (iter_sub = iter->p_subfeature; iter_sub; iter_sub = iter_sub->next)
+    {
+      n_groups++;
+      if (iter_sub->p_clicmds == NULL)
+      {
+        n_rows++;
+      }
+      for (iter_cli = iter_sub->p_clicmds; iter_cli; iter_cli = iter_cli->next)
+      {
+        n_rows++;
+      }
+    }
+  }
+
+  table = (struct showtech_table*) calloc (1, sizeof(struct showtech_table));
+  if (table == NULL)
+  {
+    VLOG_ERR ("Memory allocation failure\n");
+    return NULL;
+  }
+  /* keep the load factor at or below one half */
+  table->index_size = 16;
+  while (table->index_size < 2 * n_groups)
+  {
+    table->index_size <<= 1;
+  }
+  table->cmds = (struct showtech_cmd*) calloc (n_rows ? n_rows : 1,
+                  sizeof(struct showtech_cmd));
+  table->index = (struct showtech_group*) calloc (table->index_size,
+                  sizeof(struct showtech_group));
+  if (table->cmds == NULL || table->index == NULL)
+  {
+    VLOG_ERR ("Memory allocation failure\n");
+    free (table->cmds);
+    free (table->index);
+    free (table);
+    return NULL;
+  }
+
+  for (iter = head; iter; iter = iter->next)
+  {
+    feat_first = row;
+    if (iter->p_subfeature == NULL)
+    {
+      table->cmds[row++].feature = iter;
+    }
+    for (iter_sub = iter->p_subfeature; iter_sub; iter_sub = iter_sub->next)
+    {
+      sub_first = row;
+      if (iter_sub->p_clicmds == NULL)
+      {
+        table->cmds[row].feature = iter;
+        table->cmds[row++].sub_feature = iter_sub;
+      }
+      for (iter_cli = iter_sub->p_clicmds; iter_cli; iter_cli = iter_cli->next)
+      {
+        table->cmds[row].feature = iter;
+        table->cmds[row].sub_feature = iter_sub;
+        table->cmds[row++].clicmd = iter_cli;
+      }
+      /* dummy sub features are not addressable by name */
+      if (!iter_sub->is_dummy)
+      {
+        add_group (table, iter, iter_sub, sub_first, row - sub_first);
+      }
+    }
+    add_group (table, iter, NULL, feat_first, row - feat_first);
+  }
+  table->n_cmds = row;
+  table->feature_head = head;
+  table->refcnt = 1;
+  return table;
+}
+
+/* free_showtech_table
+ *
+ * Frees a command table together with the configuration it was built from
+ */
+static void
+free_showtech_table (struct showtech_table* table)
+{
+  if (table == NULL)
+  {
+    return;
+  }
+  free_feature_list (table->feature_head);
+  free (table->cmds);
+  free (table->index);
+  free (table->config_file);
+  free (table);
+}
+
+/* load_showtech_table
+ *
+ * Parses the configuration file and compiles it. The table currently in use
+ * is not touched, so a broken file never replaces a working configuration.
+ *
+ * returns the new table on success and NULL on failure
+ */
+static struct showtech_table*
+load_showtech_table (const char* config_file, const struct stat* sb)
+{
+  struct feature* head = NULL;
+  struct showtech_table* table = NULL;
+
+  if(regex_cache_get(SHOWTECH_CMD_PATTERN) == NULL)
+  {
+     VLOG_ERR("Invalid Show Tech Regex Pattern");
+     return NULL;
+  }
+  head = parse_showtech_config(config_file);
+  parse_head = NULL;
+  if (head == NULL)
+  {
+    return NULL;
+  }
+
+  table = compile_showtech_table (head);
+  if (table == NULL)
+  {
+    free_feature_list (head);
+    return NULL;
+  }
+  table->config_file = strdup_with_nullcheck (config_file);
+  if (sb)
+  {
+    table->dev = sb->st_dev;
+    table->ino = sb->st_ino;
+    table->size = sb->st_size;
+    table->mtime = sb->st_mtim;
+  }
+  return table;
+}
+
+/* showtech_table_stale
+ *
+ * Checks whether the file on disk is not the one the table was built from.
+ * An editor saving through rename changes the inode, an in place write
+ * changes the size or the modification time.
+ */
+static int
+showtech_table_stale (const struct showtech_table* table,
+  const char* config_file, const struct stat* sb)
+{
+  if (!name_equal (table->config_file, config_file))
+  {
+    return 1;
+  }
+  if (sb == NULL)
+  {
+    /* file vanished, keep serving the last good configuration */
+    return 0;
+  }
+  return (table->dev != sb->st_dev) || (table->ino != sb->st_ino)
+         || (table->size != sb->st_size)
+         || (table->mtime.tv_sec != sb->st_mtim.tv_sec)
+         || (table->mtime.tv_nsec != sb->st_mtim.tv_nsec);
+}
+
+/* showtech_table_acquire
+ *
+ * External API returning a reference to the current command table. The
+ * configuration file is checked on every call, by the configuration watch
+ * and against its stat, and reparsed when it changed, the new table
+ * replaces the old one in a single pointer swap. The old table
+ * is freed once its last user releases it.
+ *
+ * returns the table on success and NULL on failure
+ */
+struct showtech_table*
+showtech_table_acquire (const char* config_file)
+{
+  const char* cf = config_file ? config_file : SHOWTECH_DEFAULT_CONFIG;
+  struct showtech_table* table = NULL;
+  struct showtech_table* old = NULL;
+  struct stat sb;
+  int have_stat = 0;
+  unsigned int generation = 0;
+
+  have_stat = (stat (cf, &sb) == 0);
+
+  pthread_mutex_lock (&showtech_table_mutex);
+  if (current_table == NULL || config_watch_changed (&showtech_watch)
+      || showtech_table_stale (current_table, cf, have_stat ? &sb : NULL))
+  {
+    config_watch_begin (&showtech_watch);
+    table = load_showtech_table (cf, have_stat ? &sb : NULL);
+    generation = config_watch_done (&showtech_watch, table != NULL);
+    if (table)
+    {
+      old = current_table;
+      table->generation = generation;
+      current_table = table;
+      if (old && --old->refcnt == 0)
+      {
+        free_showtech_table (old);
+      }
+    }
+  }
+  table = current_table;
+  if (table)
+  {
+    table->refcnt++;
+  }
+  pthread_mutex_unlock (&showtech_table_mutex);
+  return table;
+}
+
+/* showtech_table_release
+ *
+ * External API to give back a reference taken by showtech_table_acquire
+ */
+void
+showtech_table_release (struct showtech_table* table)
+{
+  if (table == NULL)
+  {
+    return;
+  }
+  pthread_mutex_lock (&showtech_table_mutex);
+  if (--table->refcnt == 0)
+  {
+    free_showtech_table (table);
+  }
+  pthread_mutex_unlock (&showtech_table_mutex);
+}
+
+/* showtech_table_lookup
+ *
+ * External API to find the command range of a feature, or of a sub feature
+ * when sub_feature is given
+ *
+ * returns the group on success and NULL if it is not configured
+ */
+const struct showtech_group*
+showtech_table_lookup (const struct showtech_table* table,
+  const char* feature, const char* sub_feature)
+{
+  size_t mask = 0, slot = 0;
+  const struct showtech_group* group = NULL;
+
+  if (table == NULL || feature == NULL)
+  {
+    return NULL;
+  }
+  mask = table->index_size - 1;
+  for (slot = showtech_hash (feature, sub_feature) & mask;;
+       slot = (slot + 1) & mask)
+  {
+    group = &table->index[slot];
+    if (group->feature == NULL)
+    {
+      return NULL;
+    }
+    if (name_equal (group->feature, feature)
+        && name_equal (group->sub_feature, sub_feature))
+    {
+      return group;
+    }
+  }
+}
+
+/* showtech_priority_name
+ *
+ * Returns the configuration name of a priority class
+ */
+const char*
+showtech_priority_name (enum showtech_priority priority)
+{
+  if (priority < 0 || priority >= SHOWTECH_PRIORITY_MAX)
+  {
+    return "unknown";
+  }
+  return prioritystr[priority];
 }
 
 /* get_showtech_config
  *
  * External API to expose the Show Tech Configuration datastructure
- * Currently used by CLI to find the list of commands to be executed under
- * various show tech features
+ * The returned list stays valid until the next call of get_showtech_config
+ * or free_show_tech_config, which hold the reference of its table. New
+ * code uses showtech_table_acquire and showtech_table_release instead.
  *
  * returns feature head on Success and NULL on failure
  */
 struct feature*
 get_showtech_config(const char* config_file)
 {
-  if(feature_head == NULL)
+  struct showtech_table* table = showtech_table_acquire (config_file);
+  struct showtech_table* old = NULL;
+
+  pthread_mutex_lock (&showtech_table_mutex);
+  old = config_table;
+  config_table = table;
+  pthread_mutex_unlock (&showtech_table_mutex);
+  showtech_table_release (old);
+  return table ? table->feature_head : NULL;
+}
+
+/* free_show_tech_config
+ *
+ * Function used to Free Show Tech Configuration.
+ * All necessary datastructure and other free activities will be done here
+ * This is exported as an API to other modules
+ */
+void
+free_show_tech_config ()
+{
+  struct showtech_table* table = NULL;
+
+  pthread_mutex_lock (&showtech_table_mutex);
+  table = current_table;
+  current_table = NULL;
+  if (table && --table->refcnt == 0)
   {
-    if(0 != compile_corefile_pattern(&showtechregx, SHOWTECH_CMD_PATTERN))
-    {
-       VLOG_ERR("Invalid Show Tech Regex Pattern");
-       regfree(&showtechregx);
-       return NULL;
-    }
-    feature_head = parse_showtech_config(config_file);
-    regfree(&showtechregx);
+    free_showtech_table (table);
+  }
+  table = config_table;
+  config_table = NULL;
+  if (table && --table->refcnt == 0)
+  {
+    free_showtech_table (table);
   }
-  return feature_head;
+  pthread_mutex_unlock (&showtech_table_mutex);
 }
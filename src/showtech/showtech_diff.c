@@ -0,0 +1,929 @@
+/*
+ *  (c) Copyright 2016 Hewlett Packard Enterprise Development LP
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License"); you may
+ *  not use this file except in compliance with the License. You may obtain
+ *  a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing, software
+ *  distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+ *  WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+ *  License for the specific language governing permissions and limitations
+ *  under the License.
+ */
+
+/************************************************************************//**
+ * @ingroup ops-supportability
+ *
+ * @file
+ * Source file for the show tech capture store and the unified diff used by
+ * show tech diff
+ ***************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "showtech_diff.h"
+#include "openvswitch/vlog.h"
+
+VLOG_DEFINE_THIS_MODULE(showtech_diff);
+
+#define STORE_INDEX          "index"
+#define STORE_OBJECTS        "objects"
+#define STORE_LOCK           "lock"
+#define STORE_PATH_MAX       512
+#define STORE_LINE_MAX       1024
+
+struct store_entry
+{
+  char* command;
+  char digest[SHA256_HEX_LEN];
+};
+
+struct showtech_store
+{
+  char* dir;
+  char* index;                   /* index file of the scope */
+  int lock_fd;
+  struct store_entry* entries;
+  size_t n_entries;
+  size_t max_entries;
+};
+
+/* valid_digest
+ *
+ * index lines and object names are only trusted when they look like a digest
+ */
+static int
+valid_digest(const char* s, size_t len)
+{
+  size_t i;
+
+  if (len != SHA256_HEX_LEN - 1) {
+    return 0;
+  }
+  for (i = 0; i < len; i++) {
+    if (!((s[i] >= '0' && s[i] <= '9') || (s[i] >= 'a' && s[i] <= 'f'))) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static struct store_entry*
+find_entry(const struct showtech_store* store, const char* command)
+{
+  size_t i;
+
+  for (i = 0; i < store->n_entries; i++) {
+    if (strcmp(store->entries[i].command, command) == 0) {
+      return &store->entries[i];
+    }
+  }
+  return NULL;
+}
+
+static struct store_entry*
+add_entry(struct showtech_store* store, const char* command)
+{
+  struct store_entry* entries;
+  struct store_entry* entry;
+  size_t max;
+
+  if (store->n_entries == store->max_entries) {
+    max = store->max_entries ? 2 * store->max_entries : 64;
+    entries = realloc(store->entries, max * sizeof *entries);
+    if (entries == NULL) {
+      return NULL;
+    }
+    store->entries = entries;
+    store->max_entries = max;
+  }
+  entry = &store->entries[store->n_entries];
+  entry->command = strdup(command);
+  if (entry->command == NULL) {
+    return NULL;
+  }
+  entry->digest[0] = '\0';
+  store->n_entries++;
+  return entry;
+}
+
+static void
+object_path(const struct showtech_store* store, const char* digest,
+            char* path, size_t size)
+{
+  snprintf(path, size, "%s/%s/%s", store->dir, STORE_OBJECTS, digest);
+}
+
+static int
+write_all(int fd, const char* data, size_t len)
+{
+  ssize_t n;
+
+  while (len) {
+    n = write(fd, data, len);
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    data += n;
+    len -= n;
+  }
+  return 0;
+}
+
+/* write_file_atomic
+ *
+ * write data to a temporary file next to path and rename it in place, so a
+ * reader never sees a partial object or index. The temporary file is named
+ * after the process, sessions may write the same object at the same time.
+ */
+static int
+write_file_atomic(const char* path, const char* data, size_t len)
+{
+  char tmp[STORE_PATH_MAX];
+  int fd;
+
+  snprintf(tmp, sizeof tmp, "%s.tmp.%ld", path, (long)getpid());
+  fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR | S_IRGRP);
+  if (fd < 0) {
+    VLOG_ERR("Failed to create %s: %s", tmp, strerror(errno));
+    return -1;
+  }
+  if (write_all(fd, data, len) < 0 || fsync(fd) < 0) {
+    VLOG_ERR("Failed to write %s: %s", tmp, strerror(errno));
+    close(fd);
+    unlink(tmp);
+    return -1;
+  }
+  close(fd);
+  if (rename(tmp, path) < 0) {
+    VLOG_ERR("Failed to rename %s: %s", tmp, strerror(errno));
+    unlink(tmp);
+    return -1;
+  }
+  return 0;
+}
+
+/* make_dir
+ *
+ * create path and its missing parents
+ */
+static int
+make_dir(const char* path)
+{
+  char parent[STORE_PATH_MAX];
+  char* slash;
+
+  snprintf(parent, sizeof parent, "%s", path);
+  for (slash = strchr(parent + 1, '/'); slash; slash = strchr(slash + 1, '/')) {
+    *slash = '\0';
+    if (mkdir(parent, S_IRWXU | S_IRGRP | S_IXGRP) < 0 && errno != EEXIST) {
+      VLOG_ERR("Failed to create %s: %s", parent, strerror(errno));
+      return -1;
+    }
+    *slash = '/';
+  }
+  if (mkdir(path, S_IRWXU | S_IRGRP | S_IXGRP) < 0 && errno != EEXIST) {
+    VLOG_ERR("Failed to create %s: %s", path, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+/* lock_store
+ *
+ * flock the store, retried when a signal interrupts the wait
+ */
+static int
+lock_store(int fd, int operation)
+{
+  int rc;
+
+  while ((rc = flock(fd, operation)) < 0 && errno == EINTR);
+  return rc;
+}
+
+/* index_name
+ *
+ * file name of the index of scope. A feature name is only made of the
+ * characters which are safe in a file name, any other is replaced.
+ */
+static char*
+index_name(const char* scope)
+{
+  char* name;
+  size_t i, len;
+
+  if (scope == NULL) {
+    return strdup(STORE_INDEX);
+  }
+  len = strlen(STORE_INDEX) + 1;
+  name = malloc(len + strlen(scope) + 1);
+  if (name == NULL) {
+    return NULL;
+  }
+  sprintf(name, "%s.%s", STORE_INDEX, scope);
+  for (i = len; name[i]; i++) {
+    if (!isalnum((unsigned char)name[i]) && name[i] != '-'
+        && name[i] != '_') {
+      name[i] = '_';
+    }
+  }
+  return name;
+}
+
+static int
+load_index(struct showtech_store* store)
+{
+  char path[STORE_PATH_MAX];
+  char line[STORE_LINE_MAX];
+  struct store_entry* entry;
+  char* command;
+  size_t len;
+  FILE* fp;
+
+  snprintf(path, sizeof path, "%s/%s", store->dir, store->index);
+  fp = fopen(path, "r");
+  if (fp == NULL) {
+    /* first capture */
+    return (errno == ENOENT) ? 0 : -1;
+  }
+  while (fgets(line, sizeof line, fp) != NULL) {
+    len = strlen(line);
+    if (len && line[len - 1] == '\n') {
+      line[--len] = '\0';
+    }
+    command = strchr(line, ' ');
+    if (command == NULL || !valid_digest(line, command - line)) {
+      continue;
+    }
+    *command++ = '\0';
+    entry = find_entry(store, command);
+    if (entry == NULL) {
+      entry = add_entry(store, command);
+    }
+    if (entry == NULL) {
+      fclose(fp);
+      return -1;
+    }
+    memcpy(entry->digest, line, SHA256_HEX_LEN);
+  }
+  fclose(fp);
+  return 0;
+}
+
+struct showtech_store*
+showtech_store_open(const char* dir, const char* scope)
+{
+  char path[STORE_PATH_MAX];
+  struct showtech_store* store;
+
+  store = calloc(1, sizeof *store);
+  if (store == NULL) {
+    return NULL;
+  }
+  store->lock_fd = -1;
+  store->dir = strdup(dir ? dir : SHOWTECH_DIFF_DIR);
+  store->index = index_name(scope);
+  if (store->dir == NULL || store->index == NULL) {
+    goto error;
+  }
+  snprintf(path, sizeof path, "%s/%s", store->dir, STORE_OBJECTS);
+  if (make_dir(store->dir) < 0 || make_dir(path) < 0) {
+    goto error;
+  }
+  /* held until close, so that no object of this session is removed by
+   * another one before it is in the index */
+  snprintf(path, sizeof path, "%s/%s", store->dir, STORE_LOCK);
+  store->lock_fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC,
+                        S_IRUSR | S_IWUSR | S_IRGRP);
+  if (store->lock_fd < 0 || lock_store(store->lock_fd, LOCK_SH) < 0) {
+    VLOG_ERR("Failed to lock %s: %s", path, strerror(errno));
+    goto error;
+  }
+  if (load_index(store) < 0) {
+    VLOG_ERR("Failed to load the show tech store index in %s", store->dir);
+    goto error;
+  }
+  return store;
+
+error:
+  showtech_store_close(store);
+  return NULL;
+}
+
+const char*
+showtech_store_lookup(const struct showtech_store* store, const char* command)
+{
+  const struct store_entry* entry = find_entry(store, command);
+
+  return (entry && entry->digest[0]) ? entry->digest : NULL;
+}
+
+int
+showtech_store_read(const struct showtech_store* store, const char* digest,
+                    char** data, size_t* len)
+{
+  char path[STORE_PATH_MAX];
+  struct stat st;
+  char* buf;
+  ssize_t n;
+  size_t off = 0;
+  int fd;
+
+  object_path(store, digest, path, sizeof path);
+  fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return -1;
+  }
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    return -1;
+  }
+  buf = malloc(st.st_size + 1);
+  if (buf == NULL) {
+    close(fd);
+    return -1;
+  }
+  while (off < (size_t)st.st_size) {
+    n = read(fd, buf + off, st.st_size - off);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      break;
+    }
+    off += n;
+  }
+  close(fd);
+  buf[off] = '\0';
+  *data = buf;
+  *len = off;
+  return 0;
+}
+
+int
+showtech_store_put(struct showtech_store* store, const char* command,
+                   const char* data, size_t len, char digest[SHA256_HEX_LEN])
+{
+  char path[STORE_PATH_MAX];
+  struct store_entry* entry;
+
+  sha256_hex(data, len, digest);
+  object_path(store, digest, path, sizeof path);
+  /* identical output is stored once */
+  if (access(path, F_OK) < 0 && write_file_atomic(path, data, len) < 0) {
+    return -1;
+  }
+  entry = find_entry(store, command);
+  if (entry == NULL) {
+    entry = add_entry(store, command);
+  }
+  if (entry == NULL) {
+    return -1;
+  }
+  memcpy(entry->digest, digest, SHA256_HEX_LEN);
+  return 0;
+}
+
+/* Digests referred to by any index of the store, sorted */
+struct digest_set
+{
+  char (*digests)[SHA256_HEX_LEN];
+  size_t n;
+  size_t max;
+};
+
+static int
+compare_digests(const void* a, const void* b)
+{
+  return strcmp((const char*)a, (const char*)b);
+}
+
+static int
+add_index_digests(struct digest_set* set, const char* path)
+{
+  char line[STORE_LINE_MAX];
+  char (*digests)[SHA256_HEX_LEN];
+  char* command;
+  size_t max;
+  FILE* fp;
+
+  fp = fopen(path, "r");
+  if (fp == NULL) {
+    /* removed since it was listed */
+    return (errno == ENOENT) ? 0 : -1;
+  }
+  while (fgets(line, sizeof line, fp) != NULL) {
+    command = strchr(line, ' ');
+    if (command == NULL || !valid_digest(line, command - line)) {
+      continue;
+    }
+    if (set->n == set->max) {
+      max = set->max ? 2 * set->max : 256;
+      digests = realloc(set->digests, max * sizeof *digests);
+      if (digests == NULL) {
+        fclose(fp);
+        return -1;
+      }
+      set->digests = digests;
+      set->max = max;
+    }
+    memcpy(set->digests[set->n], line, SHA256_HEX_LEN - 1);
+    set->digests[set->n++][SHA256_HEX_LEN - 1] = '\0';
+  }
+  fclose(fp);
+  return 0;
+}
+
+/* is_index
+ *
+ * index or index.<feature>, the temporary files being written have a
+ * second dot
+ */
+static int
+is_index(const char* name)
+{
+  size_t len = strlen(STORE_INDEX);
+
+  return strncmp(name, STORE_INDEX, len) == 0
+         && (name[len] == '\0'
+             || (name[len] == '.' && strchr(name + len + 1, '.') == NULL));
+}
+
+/* collect_objects
+ *
+ * remove the objects which no index of the store refers to, with the store
+ * locked exclusively. Nothing is removed if an index cannot be read.
+ */
+static void
+collect_objects(const struct showtech_store* store)
+{
+  struct digest_set set = { NULL, 0, 0 };
+  char path[STORE_PATH_MAX];
+  struct dirent* de;
+  DIR* dir;
+  int rc = 0;
+
+  dir = opendir(store->dir);
+  if (dir == NULL) {
+    return;
+  }
+  while (rc == 0 && (de = readdir(dir)) != NULL) {
+    if (is_index(de->d_name)) {
+      snprintf(path, sizeof path, "%s/%s", store->dir, de->d_name);
+      rc = add_index_digests(&set, path);
+    }
+  }
+  closedir(dir);
+  if (rc < 0) {
+    VLOG_ERR("Failed to read the show tech store indexes in %s", store->dir);
+    free(set.digests);
+    return;
+  }
+  if (set.n) {
+    qsort(set.digests, set.n, sizeof *set.digests, compare_digests);
+  }
+
+  snprintf(path, sizeof path, "%s/%s", store->dir, STORE_OBJECTS);
+  dir = opendir(path);
+  if (dir == NULL) {
+    free(set.digests);
+    return;
+  }
+  while ((de = readdir(dir)) != NULL) {
+    if (de->d_name[0] == '.'
+        || (set.n && bsearch(de->d_name, set.digests, set.n,
+                             sizeof *set.digests, compare_digests))) {
+      continue;
+    }
+    snprintf(path, sizeof path, "%s/%s/%s", store->dir, STORE_OBJECTS,
+             de->d_name);
+    unlink(path);
+  }
+  closedir(dir);
+  free(set.digests);
+}
+
+int
+showtech_store_commit(struct showtech_store* store)
+{
+  char path[STORE_PATH_MAX];
+  char* buf = NULL;
+  size_t size = 0;
+  FILE* fp;
+  size_t i;
+  int rc;
+
+  fp = open_memstream(&buf, &size);
+  if (fp == NULL) {
+    return -1;
+  }
+  for (i = 0; i < store->n_entries; i++) {
+    if (store->entries[i].digest[0]) {
+      fprintf(fp, "%s %s\n", store->entries[i].digest,
+              store->entries[i].command);
+    }
+  }
+  fclose(fp);
+  snprintf(path, sizeof path, "%s/%s", store->dir, store->index);
+  rc = write_file_atomic(path, buf, size);
+  free(buf);
+  if (rc < 0) {
+    return rc;
+  }
+
+  /* drop the outputs which were replaced, unless another session still
+   * has objects which are in no index yet. A later session collects them. */
+  if (lock_store(store->lock_fd, LOCK_EX | LOCK_NB) == 0) {
+    collect_objects(store);
+  }
+  return 0;
+}
+
+void
+showtech_store_close(struct showtech_store* store)
+{
+  size_t i;
+
+  if (store == NULL) {
+    return;
+  }
+  for (i = 0; i < store->n_entries; i++) {
+    free(store->entries[i].command);
+  }
+  if (store->lock_fd >= 0) {
+    close(store->lock_fd);
+  }
+  free(store->entries);
+  free(store->index);
+  free(store->dir);
+  free(store);
+}
+
+/*
+ * Unified diff
+ */
+
+struct diff_line
+{
+  const char* text;
+  size_t len;
+  uint32_t hash;
+};
+
+enum diff_op_type
+{
+  DIFF_EQUAL,
+  DIFF_DELETE,
+  DIFF_INSERT
+};
+
+struct diff_op
+{
+  enum diff_op_type type;
+  int line;          /* index in the old text, or the new one on insert */
+};
+
+struct diff_lines
+{
+  struct diff_line* lines;
+  int n;
+};
+
+/* split_lines
+ *
+ * lines keep pointing into text; the trailing newline is not part of a line
+ */
+static int
+split_lines(const char* text, size_t len, struct diff_lines* out)
+{
+  const char* p = text;
+  const char* end = text + len;
+  const char* nl;
+  uint32_t h;
+  size_t i;
+  int max = 0;
+
+  out->lines = NULL;
+  out->n = 0;
+  while (p < end) {
+    if (out->n == max) {
+      struct diff_line* lines;
+
+      max = max ? 2 * max : 256;
+      lines = realloc(out->lines, max * sizeof *lines);
+      if (lines == NULL) {
+        free(out->lines);
+        out->lines = NULL;
+        return -1;
+      }
+      out->lines = lines;
+    }
+    nl = memchr(p, '\n', end - p);
+    if (nl == NULL) {
+      nl = end;
+    }
+    out->lines[out->n].text = p;
+    out->lines[out->n].len = nl - p;
+    /* FNV-1a */
+    h = 2166136261u;
+    for (i = 0; i < (size_t)(nl - p); i++) {
+      h = (h ^ (unsigned char)p[i]) * 16777619u;
+    }
+    out->lines[out->n].hash = h;
+    out->n++;
+    p = nl + 1;
+  }
+  return 0;
+}
+
+static inline int
+line_equal(const struct diff_line* a, const struct diff_line* b)
+{
+  return a->hash == b->hash && a->len == b->len
+         && memcmp(a->text, b->text, a->len) == 0;
+}
+
+/* myers_diff
+ *
+ * Myers' O(ND) shortest edit script between a[lo_a..hi_a) and
+ * b[lo_b..hi_b). The ops are appended to ops in forward order. Returns -1 if
+ * the script is longer than SHOWTECH_DIFF_MAX_EDITS, in which case nothing
+ * is appended.
+ */
+static int
+myers_diff(const struct diff_line* a, int n, const struct diff_line* b, int m,
+           int off_a, int off_b, struct diff_op* ops, int* n_ops)
+{
+  int max = n + m;
+  int d_max = (max < SHOWTECH_DIFF_MAX_EDITS) ? max : SHOWTECH_DIFF_MAX_EDITS;
+  int* v;
+  int** trace;
+  int d, k, x, y, prev_k, prev_x, prev_y, count = 0, found = -1;
+  struct diff_op* rev;
+
+  v = calloc(2 * (d_max + 1) + 1, sizeof *v);
+  trace = calloc(d_max + 1, sizeof *trace);
+  if (v == NULL || trace == NULL) {
+    free(v);
+    free(trace);
+    return -1;
+  }
+#define V(K) v[(K) + d_max + 1]
+  for (d = 0; d <= d_max && found < 0; d++) {
+    /* keep V of the previous round for the backtrack */
+    trace[d] = malloc((2 * d + 3) * sizeof **trace);
+    if (trace[d] == NULL) {
+      break;
+    }
+    for (k = -d - 1; k <= d + 1; k++) {
+      trace[d][k + d + 1] = V(k);
+    }
+    for (k = -d; k <= d; k += 2) {
+      if (k == -d || (k != d && V(k - 1) < V(k + 1))) {
+        x = V(k + 1);
+      } else {
+        x = V(k - 1) + 1;
+      }
+      y = x - k;
+      while (x < n && y < m && line_equal(&a[x], &b[y])) {
+        x++;
+        y++;
+      }
+      V(k) = x;
+      if (x >= n && y >= m) {
+        found = d;
+        break;
+      }
+    }
+  }
+#undef V
+
+  if (found >= 0) {
+    rev = malloc((n + m + 1) * sizeof *rev);
+    if (rev == NULL) {
+      found = -1;
+    } else {
+      x = n;
+      y = m;
+      for (d = found; d >= 0; d--) {
+#define T(K) trace[d][(K) + d + 1]
+        k = x - y;
+        if (d == 0) {
+          prev_x = 0;
+          prev_y = 0;
+        } else {
+          if (k == -d || (k != d && T(k - 1) < T(k + 1))) {
+            prev_k = k + 1;
+          } else {
+            prev_k = k - 1;
+          }
+          prev_x = T(prev_k);
+          prev_y = prev_x - prev_k;
+        }
+#undef T
+        while (x > prev_x && y > prev_y) {
+          x--;
+          y--;
+          rev[count].type = DIFF_EQUAL;
+          rev[count++].line = off_a + x;
+        }
+        if (d > 0) {
+          if (x == prev_x) {
+            rev[count].type = DIFF_INSERT;
+            rev[count++].line = off_b + y - 1;
+          } else {
+            rev[count].type = DIFF_DELETE;
+            rev[count++].line = off_a + x - 1;
+          }
+        }
+        x = prev_x;
+        y = prev_y;
+      }
+      while (count > 0) {
+        ops[(*n_ops)++] = rev[--count];
+      }
+      free(rev);
+    }
+  }
+
+  for (d = 0; d <= d_max; d++) {
+    free(trace[d]);
+  }
+  free(trace);
+  free(v);
+  return (found >= 0) ? 0 : -1;
+}
+
+static void
+emit_line(FILE* fp, char tag, const struct diff_line* line)
+{
+  fputc(tag, fp);
+  fwrite(line->text, 1, line->len, fp);
+  fputc('\n', fp);
+}
+
+static void
+emit_hunks(FILE* fp, const struct diff_op* ops, int n_ops,
+           const struct diff_lines* a, const struct diff_lines* b)
+{
+  int* pos_a;
+  int* pos_b;
+  int i, j, start, end, last, count_a, count_b;
+
+  /* lines of each side consumed before an op, for the hunk headers */
+  pos_a = malloc((n_ops + 1) * sizeof *pos_a);
+  pos_b = malloc((n_ops + 1) * sizeof *pos_b);
+  if (pos_a == NULL || pos_b == NULL) {
+    free(pos_a);
+    free(pos_b);
+    return;
+  }
+  pos_a[0] = pos_b[0] = 0;
+  for (i = 0; i < n_ops; i++) {
+    pos_a[i + 1] = pos_a[i] + (ops[i].type != DIFF_INSERT);
+    pos_b[i + 1] = pos_b[i] + (ops[i].type != DIFF_DELETE);
+  }
+
+  i = 0;
+  while (i < n_ops) {
+    while (i < n_ops && ops[i].type == DIFF_EQUAL) {
+      i++;
+    }
+    if (i == n_ops) {
+      break;
+    }
+    /* a hunk ends once two changes are more than twice the context apart */
+    last = i;
+    for (j = i; j < n_ops && j - last <= 2 * SHOWTECH_DIFF_CONTEXT; j++) {
+      if (ops[j].type != DIFF_EQUAL) {
+        last = j;
+      }
+    }
+    start = i - SHOWTECH_DIFF_CONTEXT;
+    if (start < 0) {
+      start = 0;
+    }
+    end = last + SHOWTECH_DIFF_CONTEXT + 1;
+    if (end > n_ops) {
+      end = n_ops;
+    }
+    count_a = pos_a[end] - pos_a[start];
+    count_b = pos_b[end] - pos_b[start];
+    fprintf(fp, "@@ -%d,%d +%d,%d @@\n",
+            count_a ? pos_a[start] + 1 : pos_a[start], count_a,
+            count_b ? pos_b[start] + 1 : pos_b[start], count_b);
+    for (j = start; j < end; j++) {
+      switch (ops[j].type) {
+        case DIFF_EQUAL:
+          emit_line(fp, ' ', &a->lines[ops[j].line]);
+          break;
+        case DIFF_DELETE:
+          emit_line(fp, '-', &a->lines[ops[j].line]);
+          break;
+        case DIFF_INSERT:
+          emit_line(fp, '+', &b->lines[ops[j].line]);
+          break;
+      }
+    }
+    i = end;
+  }
+  free(pos_a);
+  free(pos_b);
+}
+
+char*
+showtech_unified_diff(const char* old_text, size_t old_len,
+                      const char* new_text, size_t new_len,
+                      const char* old_label, const char* new_label)
+{
+  struct diff_lines a, b;
+  struct diff_op* ops = NULL;
+  char* out = NULL;
+  size_t size = 0;
+  int n_ops = 0;
+  int head = 0, tail = 0, i;
+  FILE* fp;
+
+  if (split_lines(old_text, old_len, &a) < 0) {
+    return NULL;
+  }
+  if (split_lines(new_text, new_len, &b) < 0) {
+    free(a.lines);
+    return NULL;
+  }
+  ops = malloc((a.n + b.n + 1) * sizeof *ops);
+  fp = open_memstream(&out, &size);
+  if (ops == NULL || fp == NULL) {
+    if (fp) {
+      fclose(fp);
+      free(out);
+    }
+    out = NULL;
+    goto CLEAN_UP;
+  }
+
+  /* common prefix and suffix are cheap to strip and usually most of it */
+  while (head < a.n && head < b.n && line_equal(&a.lines[head], &b.lines[head])) {
+    head++;
+  }
+  while (tail < a.n - head && tail < b.n - head
+         && line_equal(&a.lines[a.n - 1 - tail], &b.lines[b.n - 1 - tail])) {
+    tail++;
+  }
+  if (head == a.n && head == b.n) {
+    /* identical */
+    fclose(fp);
+    goto CLEAN_UP;
+  }
+
+  for (i = 0; i < head; i++) {
+    ops[n_ops].type = DIFF_EQUAL;
+    ops[n_ops++].line = i;
+  }
+  if (myers_diff(a.lines + head, a.n - head - tail,
+                 b.lines + head, b.n - head - tail,
+                 head, head, ops, &n_ops) < 0) {
+    /* too different to be worth a minimal script: replace the middle */
+    VLOG_DBG("Edit script exceeds %d lines, emitting a full replace",
+             SHOWTECH_DIFF_MAX_EDITS);
+    for (i = head; i < a.n - tail; i++) {
+      ops[n_ops].type = DIFF_DELETE;
+      ops[n_ops++].line = i;
+    }
+    for (i = head; i < b.n - tail; i++) {
+      ops[n_ops].type = DIFF_INSERT;
+      ops[n_ops++].line = i;
+    }
+  }
+  for (i = a.n - tail; i < a.n; i++) {
+    ops[n_ops].type = DIFF_EQUAL;
+    ops[n_ops++].line = i;
+  }
+
+  fprintf(fp, "--- %s\n+++ %s\n", old_label, new_label);
+  emit_hunks(fp, ops, n_ops, &a, &b);
+  fclose(fp);
+
+CLEAN_UP:
+  free(ops);
+  free(a.lines);
+  free(b.lines);
+  return out;
+}
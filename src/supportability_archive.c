@@ -0,0 +1,406 @@
+/* Supportability archive writer
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: supportability_archive.c
+ *
+ * Purpose: POSIX ustar archive compressed on the fly with zstd
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <zstd.h>
+#include "openvswitch/vlog.h"
+#include "supportability_archive.h"
+
+VLOG_DEFINE_THIS_MODULE(supportability_archive);
+
+#define TAR_BLOCK_SIZE      512
+#define TAR_NAME_LEN        100
+#define TAR_PREFIX_LEN      155
+#define ARCHIVE_READ_CHUNK  (64 * 1024)
+
+struct tar_header
+{
+    char name[100];
+    char mode[8];
+    char uid[8];
+    char gid[8];
+    char size[12];
+    char mtime[12];
+    char chksum[8];
+    char typeflag;
+    char linkname[100];
+    char magic[6];
+    char version[2];
+    char uname[32];
+    char gname[32];
+    char devmajor[8];
+    char devminor[8];
+    char prefix[155];
+    char pad[12];
+};
+
+struct archive_writer
+{
+    int fd;
+    int error;
+    ZSTD_CCtx *cctx;
+    void *out_buf;
+    size_t out_size;
+    uint64_t tar_size;
+    uint64_t compressed_size;
+};
+
+/* Function       : archive_write_out
+ * Resposibility  : write the whole of a compressed chunk to the output fd
+ * Return         : 0 on success, -1 otherwise
+ */
+static int
+archive_write_out(struct archive_writer *aw, const void *data, size_t len)
+{
+    const char *p = data;
+    ssize_t n = 0;
+
+    while (len) {
+        n = write(aw->fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            VLOG_ERR("archive write failed: %s", strerror(errno));
+            return -1;
+        }
+        p += n;
+        len -= n;
+        aw->compressed_size += n;
+    }
+    return 0;
+}
+
+/* Function       : archive_compress
+ * Resposibility  : feed uncompressed tar bytes to the compressor, or with
+ *                  ZSTD_e_end flush the end of the frame
+ * Return         : 0 on success, -1 otherwise
+ */
+static int
+archive_compress(struct archive_writer *aw, const void *data, size_t len,
+                 ZSTD_EndDirective mode)
+{
+    ZSTD_inBuffer in = { data, len, 0 };
+    ZSTD_outBuffer out;
+    size_t remaining = 0;
+
+    if (aw->error) {
+        return -1;
+    }
+    do {
+        out.dst = aw->out_buf;
+        out.size = aw->out_size;
+        out.pos = 0;
+        remaining = ZSTD_compressStream2(aw->cctx, &out, &in, mode);
+        if (ZSTD_isError(remaining)) {
+            VLOG_ERR("archive compression failed: %s",
+                     ZSTD_getErrorName(remaining));
+            aw->error = 1;
+            return -1;
+        }
+        if (out.pos && archive_write_out(aw, aw->out_buf, out.pos)) {
+            aw->error = 1;
+            return -1;
+        }
+    } while ((mode == ZSTD_e_end) ? remaining != 0 : in.pos < in.size);
+
+    aw->tar_size += len;
+    return 0;
+}
+
+/* Function       : tar_octal
+ * Resposibility  : format a numeric header field. Values which do not fit
+ *                  in octal use the base-256 encoding understood by GNU and
+ *                  bsd tar, so cores larger than 8GB still archive.
+ * Return         : void
+ */
+static void
+tar_octal(char *field, size_t len, uint64_t value)
+{
+    size_t i = 0;
+
+    if (len < 2 || value < (1ULL << (3 * (len - 1)))) {
+        snprintf(field, len, "%0*llo", (int)(len - 1),
+                 (unsigned long long)value);
+        return;
+    }
+    memset(field, 0, len);
+    for (i = len - 1; i > 0; i--) {
+        field[i] = (char)(value & 0xff);
+        value >>= 8;
+    }
+    field[0] = (char)0x80;
+}
+
+/* Function       : tar_set_name
+ * Resposibility  : store the member name, splitting it in to prefix and
+ *                  name on a '/' when it is longer than 100 characters
+ * Return         : 0 on success, -1 if the name cannot be represented
+ */
+static int
+tar_set_name(struct tar_header *hdr, const char *name)
+{
+    size_t len = strlen(name);
+    const char *slash = NULL;
+
+    if (len <= TAR_NAME_LEN) {
+        memcpy(hdr->name, name, len);
+        return 0;
+    }
+    for (slash = name + len - 1; slash > name; slash--) {
+        if (*slash == '/' && (size_t)(slash - name) <= TAR_PREFIX_LEN
+            && len - (slash - name) - 1 <= TAR_NAME_LEN) {
+            memcpy(hdr->prefix, name, slash - name);
+            memcpy(hdr->name, slash + 1, len - (slash - name) - 1);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+/* Function       : archive_header
+ * Resposibility  : emit the ustar header of a regular file member
+ * Return         : 0 on success, -1 otherwise
+ */
+static int
+archive_header(struct archive_writer *aw, const char *name, uint64_t size,
+               time_t mtime, struct archive_member_info *info)
+{
+    struct tar_header hdr;
+    const unsigned char *p = (const unsigned char *)&hdr;
+    unsigned int sum = 0;
+    size_t i = 0;
+
+    memset(&hdr, 0, sizeof(hdr));
+    if (tar_set_name(&hdr, name)) {
+        VLOG_ERR("archive member name too long: %s", name);
+        return -1;
+    }
+    tar_octal(hdr.mode, sizeof(hdr.mode), 0644);
+    tar_octal(hdr.uid, sizeof(hdr.uid), 0);
+    tar_octal(hdr.gid, sizeof(hdr.gid), 0);
+    tar_octal(hdr.size, sizeof(hdr.size), size);
+    tar_octal(hdr.mtime, sizeof(hdr.mtime), (uint64_t)mtime);
+    hdr.typeflag = '0';
+    memcpy(hdr.magic, "ustar", 6);
+    memcpy(hdr.version, "00", 2);
+    strncpy(hdr.uname, "root", sizeof(hdr.uname));
+    strncpy(hdr.gname, "root", sizeof(hdr.gname));
+
+    /* checksum is computed with its own field set to spaces */
+    memset(hdr.chksum, ' ', sizeof(hdr.chksum));
+    for (i = 0; i < sizeof(hdr); i++) {
+        sum += p[i];
+    }
+    snprintf(hdr.chksum, sizeof(hdr.chksum), "%06o", sum);
+    hdr.chksum[7] = ' ';
+
+    if (info) {
+        info->offset = aw->tar_size;
+        info->size = size;
+    }
+    return archive_compress(aw, &hdr, sizeof(hdr), ZSTD_e_continue);
+}
+
+/* Function       : archive_pad
+ * Resposibility  : pad the member data to a whole tar block
+ * Return         : 0 on success, -1 otherwise
+ */
+static int
+archive_pad(struct archive_writer *aw, uint64_t size)
+{
+    static const char zero[TAR_BLOCK_SIZE];
+    size_t rem = size % TAR_BLOCK_SIZE;
+
+    if (rem == 0) {
+        return 0;
+    }
+    return archive_compress(aw, zero, TAR_BLOCK_SIZE - rem, ZSTD_e_continue);
+}
+
+struct archive_writer *
+archive_open(int fd)
+{
+    struct archive_writer *aw = NULL;
+    size_t rc = 0;
+
+    aw = calloc(1, sizeof(*aw));
+    if (aw == NULL) {
+        return NULL;
+    }
+    aw->fd = fd;
+    aw->out_size = ZSTD_CStreamOutSize();
+    aw->out_buf = malloc(aw->out_size);
+    aw->cctx = ZSTD_createCCtx();
+    if (aw->out_buf == NULL || aw->cctx == NULL) {
+        VLOG_ERR("archive: memory allocation failed");
+        goto error;
+    }
+    rc = ZSTD_CCtx_setParameter(aw->cctx, ZSTD_c_compressionLevel,
+                                ARCHIVE_ZSTD_LEVEL);
+    if (ZSTD_isError(rc)) {
+        VLOG_ERR("archive: %s", ZSTD_getErrorName(rc));
+        goto error;
+    }
+    ZSTD_CCtx_setParameter(aw->cctx, ZSTD_c_checksumFlag, 1);
+    /* libzstd built without thread support rejects this, compress inline */
+    rc = ZSTD_CCtx_setParameter(aw->cctx, ZSTD_c_nbWorkers,
+                                ARCHIVE_ZSTD_WORKERS);
+    if (ZSTD_isError(rc)) {
+        VLOG_DBG("archive: multi threaded compression unavailable");
+    }
+    return aw;
+
+error:
+    ZSTD_freeCCtx(aw->cctx);
+    free(aw->out_buf);
+    free(aw);
+    return NULL;
+}
+
+int
+archive_add_buffer(struct archive_writer *aw, const char *name,
+                   const void *data, size_t len, time_t mtime,
+                   struct archive_member_info *info)
+{
+    if (aw == NULL || name == NULL || (data == NULL && len)) {
+        return -1;
+    }
+    if (archive_header(aw, name, len, mtime, info)) {
+        return -1;
+    }
+    if (len && archive_compress(aw, data, len, ZSTD_e_continue)) {
+        return -1;
+    }
+    if (info) {
+        sha256_hex(data ? data : "", len, info->sha256);
+    }
+    return archive_pad(aw, len);
+}
+
+int
+archive_add_file(struct archive_writer *aw, const char *name,
+                 const char *path, struct archive_member_info *info)
+{
+    struct sha256_ctx ctx;
+    uint8_t digest[SHA256_DIGEST_LEN];
+    struct stat st;
+    uint64_t left = 0;
+    ssize_t n = 0;
+    char *buf = NULL;
+    int fd = -1;
+    int rc = -1;
+
+    if (aw == NULL || name == NULL || path == NULL) {
+        return -1;
+    }
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        VLOG_ERR("archive: unable to open %s: %s", path, strerror(errno));
+        return 1;
+    }
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        VLOG_ERR("archive: %s is not a regular file", path);
+        close(fd);
+        return 1;
+    }
+    buf = malloc(ARCHIVE_READ_CHUNK);
+    if (buf == NULL) {
+        close(fd);
+        return 1;
+    }
+    if (archive_header(aw, name, st.st_size, st.st_mtime, info)) {
+        goto EXIT_FUN;
+    }
+
+    sha256_init(&ctx);
+    for (left = st.st_size; left; left -= n) {
+        n = read(fd, buf, (left < ARCHIVE_READ_CHUNK) ? left
+                                                      : ARCHIVE_READ_CHUNK);
+        if (n < 0 && errno == EINTR) {
+            n = 0;
+            continue;
+        }
+        if (n <= 0) {
+            /* truncated under us, the header already promised the size */
+            VLOG_ERR("archive: %s shrank while archived, zero padded", path);
+            n = (left < ARCHIVE_READ_CHUNK) ? left : ARCHIVE_READ_CHUNK;
+            memset(buf, 0, n);
+        }
+        sha256_update(&ctx, buf, n);
+        if (archive_compress(aw, buf, n, ZSTD_e_continue)) {
+            goto EXIT_FUN;
+        }
+    }
+    sha256_final(&ctx, digest);
+    if (info) {
+        sha256_to_hex(digest, info->sha256);
+    }
+    rc = archive_pad(aw, st.st_size);
+
+EXIT_FUN:
+    if (rc < 0 && !aw->error) {
+        /* rejected before anything reached the archive */
+        rc = 1;
+    }
+    free(buf);
+    close(fd);
+    return rc;
+}
+
+uint64_t
+archive_tar_size(const struct archive_writer *aw)
+{
+    return aw ? aw->tar_size : 0;
+}
+
+uint64_t
+archive_compressed_size(const struct archive_writer *aw)
+{
+    return aw ? aw->compressed_size : 0;
+}
+
+int
+archive_close(struct archive_writer *aw)
+{
+    static const char zero[2 * TAR_BLOCK_SIZE];
+    int rc = 0;
+
+    if (aw == NULL) {
+        return -1;
+    }
+    /* end of archive is two zero blocks */
+    if (archive_compress(aw, zero, sizeof(zero), ZSTD_e_continue)
+        || archive_compress(aw, NULL, 0, ZSTD_e_end)) {
+        rc = -1;
+    }
+    ZSTD_freeCCtx(aw->cctx);
+    free(aw->out_buf);
+    free(aw);
+    return rc;
+}
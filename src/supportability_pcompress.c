@@ -0,0 +1,463 @@
+/* Supportability parallel compression
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: supportability_pcompress.c
+ *
+ * Purpose: pzstd style compression in independent frames on a thread pool
+ *
+ *          A reader thread fills a ring of blocks, worker threads compress
+ *          any block filled and a writer thread sends the blocks in ring
+ *          order and hands them back to the reader. The ring holds a few
+ *          more blocks than there are workers, so that memory use is
+ *          bounded whatever the size of the input.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <zlib.h>
+#include <zstd.h>
+#include "openvswitch/vlog.h"
+#include "supportability_pcompress.h"
+
+VLOG_DEFINE_THIS_MODULE(supportability_pcompress);
+
+/* skippable frame holding the size of the zstd frame which follows */
+#define PZSTD_SKIPPABLE_MAGIC  0x184D2A50
+#define PZSTD_HEADER_LEN       12
+#define PCOMPRESS_GZ_BUFFER    (128 * 1024)
+
+enum block_state {
+    BLOCK_FREE = 0,       /* for the reader to fill */
+    BLOCK_FILLED,         /* for a worker to compress */
+    BLOCK_BUSY,           /* being compressed */
+    BLOCK_DONE            /* for the writer to send */
+};
+
+struct pcompress_block
+{
+    enum block_state state;
+    uint64_t seq;
+    uint8_t *in;
+    size_t in_len;
+    uint8_t *out;
+    size_t out_len;
+};
+
+struct pcompress
+{
+    int fd[2];                        /* [0] read by the caller */
+    gzFile gz;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_t reader;
+    pthread_t writer;
+    pthread_t workers[PCOMPRESS_MAX_WORKERS];
+    int n_workers;
+    int n_threads;                    /* started, to be joined */
+    struct pcompress_block *blocks;
+    int n_blocks;
+    uint64_t n_read;                  /* blocks read once eof is set */
+    int eof;
+    int stop;                         /* failure or caller gave up */
+    int failed;                       /* input unreadable or compression
+                                         failed */
+};
+
+/* Function       : pcompress_fail
+ * Resposibility  : stop every thread, with the mutex held
+ * Return         : void
+ */
+static void
+pcompress_fail(struct pcompress *pc)
+{
+    pc->stop = 1;
+    pthread_cond_broadcast(&pc->cond);
+}
+
+/* Function       : pcompress_read_block
+ * Resposibility  : fill a block from the input, short only at its end
+ * Return         : bytes read, -1 on failure
+ */
+static ssize_t
+pcompress_read_block(struct pcompress *pc, uint8_t *buf)
+{
+    const char *msg = NULL;
+    size_t done = 0;
+    int err = Z_OK;
+    int n = 0;
+
+    while (done < PCOMPRESS_BLOCK_SIZE) {
+        n = gzread(pc->gz, buf + done, PCOMPRESS_BLOCK_SIZE - done);
+        if (n <= 0) {
+            /* a truncated gzip stream only shows in the error state */
+            msg = gzerror(pc->gz, &err);
+            if (n < 0 || (err != Z_OK && err != Z_STREAM_END)) {
+                VLOG_ERR("pcompress: read failed: %s", msg);
+                return -1;
+            }
+            break;
+        }
+        done += n;
+    }
+    return done;
+}
+
+/* Function       : pcompress_reader
+ * Resposibility  : fill the blocks of the ring in order
+ * Return         : NULL
+ */
+static void *
+pcompress_reader(void *arg)
+{
+    struct pcompress *pc = arg;
+    struct pcompress_block *b = NULL;
+    uint64_t seq = 0;
+    ssize_t n = 0;
+
+    for (seq = 0; ; seq++) {
+        b = &pc->blocks[seq % pc->n_blocks];
+        pthread_mutex_lock(&pc->mutex);
+        while (!pc->stop && b->state != BLOCK_FREE) {
+            pthread_cond_wait(&pc->cond, &pc->mutex);
+        }
+        pthread_mutex_unlock(&pc->mutex);
+        if (pc->stop) {
+            break;
+        }
+
+        n = pcompress_read_block(pc, b->in);
+
+        pthread_mutex_lock(&pc->mutex);
+        if (n < 0) {
+            pc->failed = 1;
+            pcompress_fail(pc);
+        } else if (n == 0 && seq > 0) {
+            pc->eof = 1;
+            pc->n_read = seq;
+        } else {
+            /* an empty input still makes one empty frame, zstd takes no
+             * file without any as valid */
+            b->seq = seq;
+            b->in_len = n;
+            b->state = BLOCK_FILLED;
+        }
+        pthread_cond_broadcast(&pc->cond);
+        pthread_mutex_unlock(&pc->mutex);
+        if (n < 0 || pc->eof) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* Function       : put_le32
+ * Resposibility  : store a little endian 32 bit value
+ * Return         : void
+ */
+static void
+put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+/* Function       : pcompress_worker
+ * Resposibility  : compress any block filled, as an independent frame
+ *                  after its skippable size frame
+ * Return         : NULL
+ */
+static void *
+pcompress_worker(void *arg)
+{
+    struct pcompress *pc = arg;
+    struct pcompress_block *b = NULL;
+    ZSTD_CCtx *cctx = NULL;
+    size_t len = 0;
+    int i = 0;
+
+    cctx = ZSTD_createCCtx();
+    pthread_mutex_lock(&pc->mutex);
+    if (cctx == NULL) {
+        VLOG_ERR("pcompress: unable to create compression context");
+        pc->failed = 1;
+        pcompress_fail(pc);
+    }
+    while (!pc->stop) {
+        for (i = 0, b = NULL; i < pc->n_blocks; i++) {
+            if (pc->blocks[i].state == BLOCK_FILLED) {
+                b = &pc->blocks[i];
+                break;
+            }
+        }
+        if (b == NULL) {
+            if (pc->eof) {
+                break;
+            }
+            pthread_cond_wait(&pc->cond, &pc->mutex);
+            continue;
+        }
+        b->state = BLOCK_BUSY;
+        pthread_mutex_unlock(&pc->mutex);
+
+        len = ZSTD_compressCCtx(cctx, b->out + PZSTD_HEADER_LEN,
+                                ZSTD_compressBound(PCOMPRESS_BLOCK_SIZE),
+                                b->in, b->in_len, PCOMPRESS_LEVEL);
+        if (!ZSTD_isError(len)) {
+            put_le32(b->out, PZSTD_SKIPPABLE_MAGIC);
+            put_le32(b->out + 4, 4);
+            put_le32(b->out + 8, len);
+            b->out_len = PZSTD_HEADER_LEN + len;
+        }
+
+        pthread_mutex_lock(&pc->mutex);
+        if (ZSTD_isError(len)) {
+            VLOG_ERR("pcompress: compression failed: %s",
+                     ZSTD_getErrorName(len));
+            pc->failed = 1;
+            pcompress_fail(pc);
+        }
+        b->state = BLOCK_DONE;
+        pthread_cond_broadcast(&pc->cond);
+    }
+    pthread_mutex_unlock(&pc->mutex);
+    ZSTD_freeCCtx(cctx);
+    return NULL;
+}
+
+/* Function       : pcompress_send
+ * Resposibility  : write a compressed block to the socket
+ * Return         : 0 on success, -1 once the reading end is gone
+ */
+static int
+pcompress_send(struct pcompress *pc, const uint8_t *data, size_t len)
+{
+    ssize_t n = 0;
+
+    while (len) {
+        n = send(pc->fd[1], data, len, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/* Function       : pcompress_writer
+ * Resposibility  : send the blocks compressed in input order, then end the
+ *                  stream
+ * Return         : NULL
+ */
+static void *
+pcompress_writer(void *arg)
+{
+    struct pcompress *pc = arg;
+    struct pcompress_block *b = NULL;
+    uint64_t seq = 0;
+    int last = 0;
+
+    for (seq = 0; ; seq++) {
+        b = &pc->blocks[seq % pc->n_blocks];
+        pthread_mutex_lock(&pc->mutex);
+        while (!pc->stop && !(pc->eof && seq >= pc->n_read)
+               && !(b->state == BLOCK_DONE && b->seq == seq)) {
+            pthread_cond_wait(&pc->cond, &pc->mutex);
+        }
+        last = pc->stop || (pc->eof && seq >= pc->n_read);
+        pthread_mutex_unlock(&pc->mutex);
+        if (last) {
+            break;
+        }
+
+        if (pcompress_send(pc, b->out, b->out_len)) {
+            pthread_mutex_lock(&pc->mutex);
+            pcompress_fail(pc);
+            pthread_mutex_unlock(&pc->mutex);
+            break;
+        }
+
+        pthread_mutex_lock(&pc->mutex);
+        b->state = BLOCK_FREE;
+        pthread_cond_broadcast(&pc->cond);
+        pthread_mutex_unlock(&pc->mutex);
+    }
+    /* the reader of the stream sees its end. On a failure a byte left
+     * unread on this end resets the connection, so that the reader gets
+     * an error once it has read what was sent, and not an end which would
+     * pass for a complete stream. */
+    pthread_mutex_lock(&pc->mutex);
+    if (pc->failed && pc->fd[0] >= 0) {
+        send(pc->fd[0], "", 1, MSG_NOSIGNAL | MSG_DONTWAIT);
+    }
+    pthread_mutex_unlock(&pc->mutex);
+    close(pc->fd[1]);
+    pc->fd[1] = -1;
+    return NULL;
+}
+
+/* Function       : pcompress_free
+ * Resposibility  : release what pcompress_start allocated
+ * Return         : void
+ */
+static void
+pcompress_free(struct pcompress *pc)
+{
+    int i = 0;
+
+    for (i = 0; pc->blocks && i < pc->n_blocks; i++) {
+        free(pc->blocks[i].in);
+        free(pc->blocks[i].out);
+    }
+    free(pc->blocks);
+    if (pc->gz) {
+        gzclose(pc->gz);
+    }
+    if (pc->fd[0] >= 0) {
+        close(pc->fd[0]);
+    }
+    if (pc->fd[1] >= 0) {
+        close(pc->fd[1]);
+    }
+    pthread_cond_destroy(&pc->cond);
+    pthread_mutex_destroy(&pc->mutex);
+    free(pc);
+}
+
+struct pcompress *
+pcompress_start(const char *path)
+{
+    struct pcompress *pc = NULL;
+    pthread_t *threads[PCOMPRESS_MAX_WORKERS + 2];
+    void *(*bodies[PCOMPRESS_MAX_WORKERS + 2])(void *);
+    long cpus = 0;
+    int i = 0;
+
+    pc = calloc(1, sizeof(*pc));
+    if (pc == NULL) {
+        return NULL;
+    }
+    pc->fd[0] = pc->fd[1] = -1;
+    pthread_mutex_init(&pc->mutex, NULL);
+    pthread_cond_init(&pc->cond, NULL);
+
+    cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    pc->n_workers = (cpus < 1) ? 1 : (cpus > PCOMPRESS_MAX_WORKERS)
+                                     ? PCOMPRESS_MAX_WORKERS : cpus;
+    /* one block being read and one being sent besides those compressed */
+    pc->n_blocks = pc->n_workers + 2;
+    pc->blocks = calloc(pc->n_blocks, sizeof(*pc->blocks));
+    if (pc->blocks == NULL) {
+        goto FAIL;
+    }
+    for (i = 0; i < pc->n_blocks; i++) {
+        pc->blocks[i].in = malloc(PCOMPRESS_BLOCK_SIZE);
+        pc->blocks[i].out = malloc(PZSTD_HEADER_LEN
+                                   + ZSTD_compressBound(PCOMPRESS_BLOCK_SIZE));
+        if (pc->blocks[i].in == NULL || pc->blocks[i].out == NULL) {
+            goto FAIL;
+        }
+    }
+
+    /* gzip input is decompressed, anything else read as is */
+    pc->gz = gzopen(path, "rb");
+    if (pc->gz == NULL) {
+        VLOG_ERR("pcompress: unable to open %s: %s", path, strerror(errno));
+        goto FAIL;
+    }
+    gzbuffer(pc->gz, PCOMPRESS_GZ_BUFFER);
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, pc->fd) < 0) {
+        VLOG_ERR("pcompress: socketpair failed: %s", strerror(errno));
+        pc->fd[0] = pc->fd[1] = -1;
+        goto FAIL;
+    }
+
+    threads[0] = &pc->reader;
+    bodies[0] = pcompress_reader;
+    threads[1] = &pc->writer;
+    bodies[1] = pcompress_writer;
+    for (i = 0; i < pc->n_workers; i++) {
+        threads[i + 2] = &pc->workers[i];
+        bodies[i + 2] = pcompress_worker;
+    }
+    for (i = 0; i < pc->n_workers + 2; i++) {
+        if (pthread_create(threads[i], NULL, bodies[i], pc)) {
+            VLOG_ERR("pcompress: unable to start threads");
+            pthread_mutex_lock(&pc->mutex);
+            pcompress_fail(pc);
+            pthread_mutex_unlock(&pc->mutex);
+            break;
+        }
+        pc->n_threads++;
+    }
+    if (pc->n_threads < pc->n_workers + 2) {
+        pcompress_finish(pc);
+        return NULL;
+    }
+    VLOG_DBG("pcompress %s: %d workers", path, pc->n_workers);
+    return pc;
+
+FAIL:
+    pcompress_free(pc);
+    return NULL;
+}
+
+int
+pcompress_fd(const struct pcompress *pc)
+{
+    return pc->fd[0];
+}
+
+int
+pcompress_finish(struct pcompress *pc)
+{
+    int rc = 0;
+    int i = 0;
+
+    if (pc == NULL) {
+        return -1;
+    }
+    /* a writer blocked on a reader which went away fails */
+    pthread_mutex_lock(&pc->mutex);
+    close(pc->fd[0]);
+    pc->fd[0] = -1;
+    pcompress_fail(pc);
+    pthread_mutex_unlock(&pc->mutex);
+
+    if (pc->n_threads > 0) {
+        pthread_join(pc->reader, NULL);
+    }
+    if (pc->n_threads > 1) {
+        pthread_join(pc->writer, NULL);
+    }
+    for (i = 0; i + 2 < pc->n_threads; i++) {
+        pthread_join(pc->workers[i], NULL);
+    }
+    rc = pc->failed ? -1 : 0;
+    pcompress_free(pc);
+    return rc;
+}
@@ -0,0 +1,1407 @@
+/* Supportability file transfer
+ * Copyright (C) 2016 Hewlett Packard Enterprise Development LP
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * File: supportability_transfer.c
+ *
+ * Purpose: tftp (RFC 1350, 2347, 2348, 7440) and sftp version 3 uploads
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include "openvswitch/vlog.h"
+#include "supportability_transfer.h"
+
+VLOG_DEFINE_THIS_MODULE(supportability_transfer);
+
+/* tftp opcodes and error codes */
+#define TFTP_WRQ             2
+#define TFTP_DATA            3
+#define TFTP_ACK             4
+#define TFTP_ERROR           5
+#define TFTP_OACK            6
+#define TFTP_EBADID          5
+#define TFTP_EOPTNEG         8
+#define TFTP_DEFAULT_BLKSIZE 512
+#define TFTP_PKT_LEN         (4 + TRANSFER_TFTP_BLKSIZE)
+
+/* sftp version 3 packet types, flags and status codes */
+#define SSH_FXP_INIT         1
+#define SSH_FXP_VERSION      2
+#define SSH_FXP_OPEN         3
+#define SSH_FXP_CLOSE        4
+#define SSH_FXP_READ         5
+#define SSH_FXP_WRITE        6
+#define SSH_FXP_FSTAT        8
+#define SSH_FXP_REMOVE       13
+#define SSH_FXP_RENAME       18
+#define SSH_FXP_STATUS       101
+#define SSH_FXP_HANDLE       102
+#define SSH_FXP_DATA         103
+#define SSH_FXP_ATTRS        105
+#define SSH_FXF_WRITE        0x02
+#define SSH_FXF_CREAT        0x08
+#define SSH_FXF_TRUNC        0x10
+#define SSH_ATTR_SIZE        0x01
+#define SSH_FX_OK            0
+#define SSH_FX_EOF           1
+#define SFTP_VERSION         3
+#define SFTP_HANDLE_LEN      256
+#define SFTP_PKT_LEN         (TRANSFER_SFTP_CHUNK + 1024)
+
+/* sftp_upload results */
+#define SFTP_LOST            -1   /* connection lost, worth another session */
+#define SFTP_REFUSED         1    /* the server said no */
+
+/* Data sent, read from fd or a buffer in memory when fd is -1. Only a
+ * seekable fd can be sent again from an offset. */
+struct transfer_source
+{
+    int fd;
+    int seekable;
+    const char *buf;
+    size_t len;
+    size_t pos;
+    uint64_t total;                   /* bytes read */
+};
+
+struct tftp_session
+{
+    int sock;
+    struct sockaddr_storage server;   /* where requests are sent */
+    socklen_t server_len;
+    struct sockaddr_storage peer;     /* transfer id picked by the server */
+    socklen_t peer_len;
+    unsigned int blksize;
+    unsigned int windowsize;
+    uint8_t pkt[TFTP_PKT_LEN];
+};
+
+struct sftp_session
+{
+    int fd;                           /* socket to the ssh client */
+    int err_fd;                       /* its stderr */
+    pid_t pid;
+    uint32_t id;                      /* of the next request */
+    uint8_t *pkt;
+    size_t len;                       /* of the packet built or received */
+    size_t pos;                       /* parse position */
+    int bad;                          /* a received packet was malformed */
+    char handle[SFTP_HANDLE_LEN];
+    uint32_t handle_len;
+};
+
+/* Function       : transfer_error
+ * Resposibility  : tell why an upload failed, the first reason wins
+ * Return         : void
+ */
+static void
+transfer_error(struct transfer_result *res, const char *fmt, ...)
+{
+    va_list args;
+
+    if (res->error[0]) {
+        return;
+    }
+    va_start(args, fmt);
+    vsnprintf(res->error, sizeof(res->error), fmt, args);
+    va_end(args);
+}
+
+/* Function       : transfer_source_read
+ * Resposibility  : read up to len bytes, short only at the end of the data
+ * Return         : bytes read, -1 on failure
+ */
+static ssize_t
+transfer_source_read(struct transfer_source *src, void *buf, size_t len)
+{
+    size_t done = 0;
+    ssize_t n = 0;
+
+    if (src->fd < 0) {
+        n = (src->len - src->pos < len) ? src->len - src->pos : len;
+        memcpy(buf, src->buf + src->pos, n);
+        src->pos += n;
+        src->total += n;
+        return n;
+    }
+    while (done < len) {
+        n = read(src->fd, (char *)buf + done, len - done);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            return -1;
+        }
+        if (n == 0) {
+            break;
+        }
+        done += n;
+    }
+    src->total += done;
+    return done;
+}
+
+/* Function       : transfer_sum_line
+ * Resposibility  : format the sha256sum line stored next to the file
+ * Return         : length of the line
+ */
+static size_t
+transfer_sum_line(const struct transfer_request *req,
+                  const struct transfer_result *res, char *buf, size_t len)
+{
+    const char *base = strrchr(req->remote, '/');
+    int n = 0;
+
+    n = snprintf(buf, len, "%s  %s\n", res->sha256,
+                 base ? base + 1 : req->remote);
+    return (n < 0 || (size_t)n >= len) ? 0 : n;
+}
+
+/* Function       : msec_left
+ * Resposibility  : milliseconds until a CLOCK_MONOTONIC deadline
+ * Return         : 0 once passed
+ */
+static int
+msec_left(const struct timespec *deadline)
+{
+    struct timespec now;
+    long msec = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    msec = (deadline->tv_sec - now.tv_sec) * 1000
+           + (deadline->tv_nsec - now.tv_nsec) / 1000000;
+    return (msec > 0) ? msec : 0;
+}
+
+/* Function       : same_host
+ * Resposibility  : compare two socket addresses, with or without the port
+ * Return         : 1 if equal, 0 otherwise
+ */
+static int
+same_host(const struct sockaddr_storage *a, const struct sockaddr_storage *b,
+          int with_port)
+{
+    const struct sockaddr_in *a4 = (const struct sockaddr_in *)a;
+    const struct sockaddr_in *b4 = (const struct sockaddr_in *)b;
+    const struct sockaddr_in6 *a6 = (const struct sockaddr_in6 *)a;
+    const struct sockaddr_in6 *b6 = (const struct sockaddr_in6 *)b;
+
+    if (a->ss_family != b->ss_family) {
+        return 0;
+    }
+    if (a->ss_family == AF_INET) {
+        return a4->sin_addr.s_addr == b4->sin_addr.s_addr
+               && (!with_port || a4->sin_port == b4->sin_port);
+    }
+    if (a->ss_family == AF_INET6) {
+        return !memcmp(&a6->sin6_addr, &b6->sin6_addr, sizeof(a6->sin6_addr))
+               && (!with_port || a6->sin6_port == b6->sin6_port);
+    }
+    return 0;
+}
+
+/* Function       : tftp_open
+ * Resposibility  : resolve the server and open the socket of a session
+ * Return         : 0 on success, -1 otherwise
+ */
+static int
+tftp_open(struct tftp_session *s, const char *host,
+          struct transfer_result *res)
+{
+    struct addrinfo hints, *ai = NULL;
+    int rc = 0;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    rc = getaddrinfo(host, TRANSFER_TFTP_PORT, &hints, &ai);
+    if (rc != 0) {
+        transfer_error(res, "unable to resolve %s: %s", host,
+                       gai_strerror(rc));
+        return -1;
+    }
+    s->sock = socket(ai->ai_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (s->sock < 0) {
+        transfer_error(res, "socket failed: %s", strerror(errno));
+        freeaddrinfo(ai);
+        return -1;
+    }
+    memcpy(&s->server, ai->ai_addr, ai->ai_addrlen);
+    s->server_len = ai->ai_addrlen;
+    s->peer_len = 0;
+    freeaddrinfo(ai);
+    return 0;
+}
+
+/* Function       : tftp_error_reply
+ * Resposibility  : turn away a packet of another transfer id, as the RFC
+ *                  asks, without disturbing the transfer
+ * Return         : void
+ */
+static void
+tftp_error_reply(struct tftp_session *s, const struct sockaddr_storage *to,
+                 socklen_t to_len)
+{
+    static const uint8_t pkt[] = { 0, TFTP_ERROR, 0, TFTP_EBADID,
+                                   'U', 'n', 'k', 'n', 'o', 'w', 'n', ' ',
+                                   'T', 'I', 'D', 0 };
+
+    sendto(s->sock, pkt, sizeof(pkt), MSG_NOSIGNAL,
+           (const struct sockaddr *)to, to_len);
+}
+
+/* Function       : tftp_recv
+ * Resposibility  : wait for a packet of the server until the deadline.
+ *                  The first reply fixes the transfer id of the server.
+ * Return         : packet length, 0 on timeout, -1 on failure
+ */
+static ssize_t
+tftp_recv(struct tftp_session *s, const struct timespec *deadline)
+{
+    struct sockaddr_storage from;
+    socklen_t from_len = 0;
+    struct pollfd pfd;
+    ssize_t n = 0;
+    int rc = 0;
+
+    for (;;) {
+        pfd.fd = s->sock;
+        pfd.events = POLLIN;
+        rc = poll(&pfd, 1, msec_left(deadline));
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            return rc;
+        }
+        from_len = sizeof(from);
+        n = recvfrom(s->sock, s->pkt, sizeof(s->pkt), 0,
+                     (struct sockaddr *)&from, &from_len);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        if (s->peer_len == 0 && same_host(&from, &s->server, 0)) {
+            memcpy(&s->peer, &from, from_len);
+            s->peer_len = from_len;
+        }
+        if (s->peer_len == 0 || !same_host(&from, &s->peer, 1)) {
+            tftp_error_reply(s, &from, from_len);
+            continue;
+        }
+        if (n >= 4) {
+            return n;
+        }
+    }
+}
+
+/* Function       : tftp_server_error
+ * Resposibility  : report the message of an ERROR packet
+ * Return         : its error code
+ */
+static int
+tftp_server_error(struct tftp_session *s, ssize_t n,
+                  struct transfer_result *res)
+{
+    s->pkt[n - 1] = '\0';
+    transfer_error(res, "tftp server error %d: %s",
+                   (s->pkt[2] << 8) | s->pkt[3], (char *)s->pkt + 4);
+    return (s->pkt[2] << 8) | s->pkt[3];
+}
+
+/* Function       : tftp_parse_oack
+ * Resposibility  : apply the options the server acknowledged
+ * Return         : void
+ */
+static void
+tftp_parse_oack(struct tftp_session *s, ssize_t n)
+{
+    const char *p = (const char *)s->pkt + 2;
+    const char *end = (const char *)s->pkt + n;
+    const char *name = NULL, *value = NULL;
+    unsigned long v = 0;
+
+    while (p < end) {
+        name = p;
+        p = memchr(p, '\0', end - p);
+        if (p == NULL || ++p >= end) {
+            return;
+        }
+        value = p;
+        p = memchr(p, '\0', end - p);
+        if (p == NULL) {
+            return;
+        }
+        p++;
+        v = strtoul(value, NULL, 10);
+        if (!strcasecmp(name, "blksize") && v >= 8
+            && v <= TRANSFER_TFTP_BLKSIZE) {
+            s->blksize = v;
+        } else if (!strcasecmp(name, "windowsize") && v >= 1
+                   && v <= TRANSFER_TFTP_WINDOWSIZE) {
+            s->windowsize = v;
+        }
+    }
+}
+
+/* Function       : tftp_request
+ * Resposibility  : send the write request and negotiate the options
+ * Return         : 0 once accepted, 1 if the server refused the options,
+ *                  -1 otherwise
+ */
+static int
+tftp_request(struct tftp_session *s, const char *remote, long long size,
+             int with_options, struct transfer_result *res)
+{
+    uint8_t req[TFTP_PKT_LEN];
+    struct timespec deadline;
+    unsigned int tries = 0;
+    ssize_t n = 0;
+    int len = 0;
+
+    req[0] = 0;
+    req[1] = TFTP_WRQ;
+    len = 2 + snprintf((char *)req + 2, sizeof(req) - 2, "%s%coctet%c",
+                       remote, 0, 0);
+    if (with_options) {
+        len += snprintf((char *)req + len, sizeof(req) - len,
+                        "blksize%c%d%cwindowsize%c%d%c", 0,
+                        TRANSFER_TFTP_BLKSIZE, 0, 0,
+                        TRANSFER_TFTP_WINDOWSIZE, 0);
+        if (size >= 0) {
+            len += snprintf((char *)req + len, sizeof(req) - len,
+                            "tsize%c%lld%c", 0, size, 0);
+        }
+    }
+    if (len >= (int)sizeof(req)) {
+        transfer_error(res, "file name too long");
+        return -1;
+    }
+    s->blksize = TFTP_DEFAULT_BLKSIZE;
+    s->windowsize = 1;
+
+    for (tries = 0; tries <= TRANSFER_RETRIES; tries++) {
+        if (sendto(s->sock, req, len, MSG_NOSIGNAL,
+                   (struct sockaddr *)&s->server, s->server_len) < 0) {
+            transfer_error(res, "send failed: %s", strerror(errno));
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &deadline);
+        deadline.tv_sec += TRANSFER_TFTP_TIMEOUT_MSEC / 1000;
+        n = tftp_recv(s, &deadline);
+        if (n < 0) {
+            transfer_error(res, "receive failed: %s", strerror(errno));
+            return -1;
+        }
+        if (n == 0) {
+            continue;
+        }
+        switch (s->pkt[1]) {
+            case TFTP_OACK:
+                tftp_parse_oack(s, n);
+                return 0;
+            case TFTP_ACK:
+                if (s->pkt[2] == 0 && s->pkt[3] == 0) {
+                    /* server without option support */
+                    return 0;
+                }
+                break;
+            case TFTP_ERROR:
+                if (tftp_server_error(s, n, res) != TFTP_EOPTNEG) {
+                    return -1;
+                }
+                res->error[0] = '\0';
+                if (with_options) {
+                    return 1;
+                }
+                /* late answer to a request with options sent again
+                 * before the refusal came, from its own transfer id */
+                s->peer_len = 0;
+                break;
+            default:
+                break;
+        }
+    }
+    transfer_error(res, "no reply from tftp server");
+    return -1;
+}
+
+/* Function       : tftp_wait_ack
+ * Resposibility  : wait for the acknowledgement of the window, sent up to
+ *                  block sent. Block numbers roll over at 65536. The
+ *                  first duplicate of an acknowledgement tells a block was
+ *                  lost and the window is sent again at once, *resent
+ *                  remembers the block it acknowledges. Duplicates which
+ *                  follow within half the timeout were already on their
+ *                  way and are ignored, a later one is the server timing
+ *                  out on the window sent again.
+ * Return         : 1 with *acked updated, 0 on timeout, -1 on failure
+ */
+static int
+tftp_wait_ack(struct tftp_session *s, uint64_t *acked, uint64_t sent,
+              uint64_t *resent, struct transfer_result *res)
+{
+    struct timespec deadline;
+    uint64_t ack = 0;
+    uint16_t block = 0;
+    ssize_t n = 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += TRANSFER_TFTP_TIMEOUT_MSEC / 1000;
+    for (;;) {
+        n = tftp_recv(s, &deadline);
+        if (n <= 0) {
+            if (n < 0) {
+                transfer_error(res, "receive failed: %s", strerror(errno));
+            }
+            return n;
+        }
+        if (s->pkt[1] == TFTP_ERROR) {
+            tftp_server_error(s, n, res);
+            return -1;
+        }
+        if (s->pkt[1] == TFTP_OACK && *acked == 0) {
+            /* the first block was lost, the server repeats itself */
+            ack = 0;
+        } else if (s->pkt[1] == TFTP_ACK) {
+            block = (s->pkt[2] << 8) | s->pkt[3];
+            ack = *acked + (uint16_t)(block - (uint16_t)*acked);
+        } else {
+            continue;
+        }
+        if (ack > sent || (ack == *acked && ack == *resent
+                           && msec_left(&deadline)
+                              > TRANSFER_TFTP_TIMEOUT_MSEC / 2)) {
+            continue;
+        }
+        if (ack == *acked) {
+            *resent = ack;
+        }
+        *acked = ack;
+        return 1;
+    }
+}
+
+/* Function       : tftp_send
+ * Resposibility  : send the data, a window of blocks at a time. A window
+ *                  not acknowledged in full is sent again from the block
+ *                  following the last one acknowledged.
+ * Return         : 0 on success, -1 otherwise
+ */
+static int
+tftp_send(struct tftp_session *s, struct transfer_source *src,
+          struct sha256_ctx *ctx, struct transfer_result *res,
+          const struct executor_task *task)
+{
+    uint8_t *window = NULL;
+    size_t *lens = NULL;
+    uint8_t *data = NULL;
+    uint64_t acked = 0, filled = 0, last = 0, sent = 0, blk = 0;
+    uint64_t resent = UINT64_MAX;
+    unsigned int tries = 0;
+    size_t slot = 0;
+    ssize_t n = 0;
+    int rc = -1;
+
+    window = malloc((size_t)s->windowsize * (4 + s->blksize));
+    lens = calloc(s->windowsize, sizeof(*lens));
+    if (window == NULL || lens == NULL) {
+        transfer_error(res, "memory allocation failed");
+        goto EXIT_FUN;
+    }
+
+    while (last == 0 || acked < last) {
+        if (executor_task_cancelled(task)) {
+            transfer_error(res, "interrupted");
+            goto EXIT_FUN;
+        }
+        for (blk = acked + 1; blk <= acked + s->windowsize; blk++) {
+            slot = (blk - 1) % s->windowsize;
+            data = window + slot * (4 + s->blksize);
+            if (blk > filled) {
+                if (last) {
+                    break;
+                }
+                n = transfer_source_read(src, data + 4, s->blksize);
+                if (n < 0) {
+                    transfer_error(res, "read failed: %s", strerror(errno));
+                    goto EXIT_FUN;
+                }
+                if (ctx) {
+                    sha256_update(ctx, data + 4, n);
+                }
+                lens[slot] = n;
+                filled = blk;
+                if ((size_t)n < s->blksize) {
+                    last = blk;
+                }
+            }
+            data[0] = 0;
+            data[1] = TFTP_DATA;
+            data[2] = (blk >> 8) & 0xff;
+            data[3] = blk & 0xff;
+            if (sendto(s->sock, data, 4 + lens[slot], MSG_NOSIGNAL,
+                       (struct sockaddr *)&s->peer, s->peer_len) < 0) {
+                transfer_error(res, "send failed: %s", strerror(errno));
+                goto EXIT_FUN;
+            }
+            sent = blk;
+        }
+
+        rc = tftp_wait_ack(s, &acked, sent, &resent, res);
+        if (rc < 0) {
+            goto EXIT_FUN;
+        }
+        /* a window sent again counts as a try, whether on a duplicate
+         * acknowledgement or on a timeout */
+        if (rc == 1 && acked != resent) {
+            tries = 0;
+        } else if (++tries > TRANSFER_RETRIES) {
+            transfer_error(res, "tftp server stopped acknowledging at "
+                           "block %llu", (unsigned long long)acked + 1);
+            rc = -1;
+            goto EXIT_FUN;
+        }
+    }
+    rc = 0;
+
+EXIT_FUN:
+    free(window);
+    free(lens);
+    return rc ? -1 : 0;
+}
+
+/* Function       : tftp_put
+ * Resposibility  : run one tftp write session. tsize is the size announced,
+ *                  negative when unknown.
+ * Return         : 0 on success, -1 otherwise
+ */
+static int
+tftp_put(const char *host, const char *remote, struct transfer_source *src,
+         long long tsize, struct sha256_ctx *ctx,
+         struct transfer_result *res, const struct executor_task *task)
+{
+    struct tftp_session *s = NULL;
+    int rc = -1;
+
+    s = calloc(1, sizeof(*s));
+    if (s == NULL) {
+        transfer_error(res, "memory allocation failed");
+        return -1;
+    }
+    if (tftp_open(s, host, res)) {
+        free(s);
+        return -1;
+    }
+    rc = tftp_request(s, remote, tsize, 1, res);
+    if (rc == 1) {
+        s->peer_len = 0;
+        rc = tftp_request(s, remote, tsize, 0, res);
+    }
+    if (rc == 0) {
+        VLOG_DBG("tftp %s: blksize %u, windowsize %u", remote, s->blksize,
+                 s->windowsize);
+        rc = tftp_send(s, src, ctx, res, task);
+    }
+    close(s->sock);
+    free(s);
+    return rc ? -1 : 0;
+}
+
+/* Function       : transfer_tftp
+ * Resposibility  : upload the data and its checksum with tftp. tftp cannot
+ *                  write at an offset, so nothing is resumed across
+ *                  sessions.
+ * Return         : 0 on success, -1 otherwise
+ */
+static int
+transfer_tftp(const struct transfer_request *req, struct transfer_source *src,
+              struct transfer_result *res, const struct executor_task *task)
+{
+    struct transfer_source sum_src;
+    struct transfer_result sum_res;
+    struct sha256_ctx ctx;
+    uint8_t digest[SHA256_DIGEST_LEN];
+    char sum_path[TRANSFER_PATH_LEN + sizeof(TRANSFER_SUM_EXT)];
+    char line[TRANSFER_PATH_LEN + SHA256_HEX_LEN + 4];
+
+    sha256_init(&ctx);
+    if (tftp_put(req->host, req->remote, src,
+                 src->seekable ? (long long)res->size : -1, &ctx, res,
+                 task)) {
+        return -1;
+    }
+    sha256_final(&ctx, digest);
+    sha256_to_hex(digest, res->sha256);
+    res->size = src->total;
+
+    memset(&sum_res, 0, sizeof(sum_res));
+    memset(&sum_src, 0, sizeof(sum_src));
+    snprintf(sum_path, sizeof(sum_path), "%s%s", req->remote,
+             TRANSFER_SUM_EXT);
+    sum_src.fd = -1;
+    sum_src.buf = line;
+    sum_src.len = transfer_sum_line(req, res, line, sizeof(line));
+    if (tftp_put(req->host, sum_path, &sum_src, sum_src.len, NULL, &sum_res,
+                 task)) {
+        /* servers often refuse to create files, the copy is still good */
+        VLOG_WARN("tftp %s: checksum not stored: %s", req->remote,
+                  sum_res.error);
+    } else {
+        res->sum_stored = 1;
+    }
+    return 0;
+}
+
+/* Function       : sftp_put_u32
+ * Resposibility  : append to the packet being built
+ * Return         : void
+ */
+static void
+sftp_put_u32(struct sftp_session *s, uint32_t v)
+{
+    s->pkt[s->len++] = v >> 24;
+    s->pkt[s->len++] = v >> 16;
+    s->pkt[s->len++] = v >> 8;
+    s->pkt[s->len++] = v;
+}
+
+static void
+sftp_put_u64(struct sftp_session *s, uint64_t v)
+{
+    sftp_put_u32(s, v >> 32);
+    sftp_put_u32(s, v & 0xffffffff);
+}
+
+static void
+sftp_put_str(struct sftp_session *s, const void *data, uint32_t len)
+{
+    sftp_put_u32(s, len);
+    memcpy(s->pkt + s->len, data, len);
+    s->len += len;
+}
+
+/* Function       : sftp_begin
+ * Resposibility  : start a request packet, with room for its length
+ * Return         : id of the request
+ */
+static uint32_t
+sftp_begin(struct sftp_session *s, uint8_t type)
+{
+    s->len = 4;
+    s->pkt[s->len++] = type;
+    sftp_put_u32(s, s->id);
+    return s->id++;
+}
+
+/* Function       : sftp_send
+ * Resposibility  : send the packet built
+ * Return         : 0 on success, -1 if the connection is lost
+ */
+static int
+sftp_send(struct sftp_session *s)
+{
+    size_t done = 0;
+    ssize_t n = 0;
+
+    s->pkt[0] = (s->len - 4) >> 24;
+    s->pkt[1] = (s->len - 4) >> 16;
+    s->pkt[2] = (s->len - 4) >> 8;
+    s->pkt[3] = s->len - 4;
+    while (done < s->len) {
+        n = send(s->fd, s->pkt + done, s->len - done, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+/* Function       : sftp_read_full
+ * Resposibility  : read exactly len bytes of the server reply
+ * Return         : 0 on success, -1 if the connection is lost
+ */
+static int
+sftp_read_full(struct sftp_session *s, uint8_t *buf, size_t len)
+{
+    size_t done = 0;
+    ssize_t n = 0;
+
+    while (done < len) {
+        n = recv(s->fd, buf + done, len - done, 0);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+/* Function       : sftp_recv
+ * Resposibility  : read a reply and return its type, the parse position is
+ *                  left after the request id
+ * Return         : packet type, -1 if the connection is lost
+ */
+static int
+sftp_recv(struct sftp_session *s, uint32_t *id)
+{
+    uint8_t hdr[4];
+    uint32_t len = 0;
+
+    if (sftp_read_full(s, hdr, sizeof(hdr))) {
+        return -1;
+    }
+    len = (hdr[0] << 24) | (hdr[1] << 16) | (hdr[2] << 8) | hdr[3];
+    if (len < 5 || len > SFTP_PKT_LEN) {
+        return -1;
+    }
+    if (sftp_read_full(s, s->pkt, len)) {
+        return -1;
+    }
+    s->len = len;
+    s->pos = 5;
+    s->bad = 0;
+    *id = (s->pkt[1] << 24) | (s->pkt[2] << 16) | (s->pkt[3] << 8)
+          | s->pkt[4];
+    return s->pkt[0];
+}
+
+/* Function       : sftp_get_u32
+ * Resposibility  : parse the reply, a short packet sets s->bad
+ * Return         : the value read, 0 past the end
+ */
+static uint32_t
+sftp_get_u32(struct sftp_session *s)
+{
+    const uint8_t *p = s->pkt + s->pos;
+
+    if (s->len - s->pos < 4) {
+        s->bad = 1;
+        return 0;
+    }
+    s->pos += 4;
+    return (p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint64_t
+sftp_get_u64(struct sftp_session *s)
+{
+    uint64_t hi = sftp_get_u32(s);
+
+    return (hi << 32) | sftp_get_u32(s);
+}
+
+static const uint8_t *
+sftp_get_str(struct sftp_session *s, uint32_t *len)
+{
+    const uint8_t *data = NULL;
+
+    *len = sftp_get_u32(s);
+    if (s->bad || s->len - s->pos < *len) {
+        s->bad = 1;
+        *len = 0;
+        return NULL;
+    }
+    data = s->pkt + s->pos;
+    s->pos += *len;
+    return data;
+}
+
+/* Function       : sftp_status_reply
+ * Resposibility  : parse a status reply received
+ * Return         : SSH_FX_OK, SFTP_REFUSED with the server message in
+ *                  res->error, SFTP_LOST if malformed
+ */
+static int
+sftp_status_reply(struct sftp_session *s, struct transfer_result *res)
+{
+    const uint8_t *msg = NULL;
+    uint32_t code = 0, len = 0;
+
+    code = sftp_get_u32(s);
+    msg = sftp_get_str(s, &len);
+    if (s->bad) {
+        return SFTP_LOST;
+    }
+    if (code != SSH_FX_OK) {
+        transfer_error(res, "sftp server error %u: %.*s", code, (int)len,
+                       msg);
+        return SFTP_REFUSED;
+    }
+    return SSH_FX_OK;
+}
+
+/* Function       : sftp_status
+ * Resposibility  : read the status reply of a request
+ * Return         : as sftp_status_reply, SFTP_LOST if the connection is
+ *                  lost
+ */
+static int
+sftp_status(struct sftp_session *s, struct transfer_result *res)
+{
+    uint32_t id = 0;
+
+    if (sftp_recv(s, &id) != SSH_FXP_STATUS) {
+        return SFTP_LOST;
+    }
+    return sftp_status_reply(s, res);
+}
+
+/* Function       : sftp_start
+ * Resposibility  : run the sftp subsystem of ssh on a socket pair and
+ *                  agree on the protocol version. ssh runs in batch mode,
+ *                  authentication must not need a password.
+ * Return         : 0 on success, SFTP_LOST otherwise
+ */
+static int
+sftp_start(struct sftp_session *s, const struct transfer_request *req,
+           struct transfer_result *res)
+{
+    struct timeval tv = { TRANSFER_SFTP_TIMEOUT_MSEC / 1000, 0 };
+    int sv[2] = { -1, -1 };
+    int err[2] = { -1, -1 };
+    uint32_t id = 0;
+
+    s->fd = s->err_fd = -1;
+    s->pid = -1;
+    s->id = 0;
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0
+        || pipe(err) < 0) {
+        transfer_error(res, "socketpair failed: %s", strerror(errno));
+        goto FAIL;
+    }
+    s->pid = fork();
+    if (s->pid < 0) {
+        transfer_error(res, "fork failed: %s", strerror(errno));
+        goto FAIL;
+    }
+    if (s->pid == 0) {
+        dup2(sv[1], STDIN_FILENO);
+        dup2(sv[1], STDOUT_FILENO);
+        dup2(err[1], STDERR_FILENO);
+        execl(TRANSFER_SSH_PATH, "ssh", "-oBatchMode=yes",
+              "-oServerAliveInterval=10", "-x", "-a", "-s", "-l", req->user,
+              "--", req->host, "sftp", (char *)NULL);
+        _exit(127);
+    }
+    close(sv[1]);
+    close(err[1]);
+    s->fd = sv[0];
+    s->err_fd = err[0];
+    fcntl(s->err_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(s->err_fd, F_SETFL, O_NONBLOCK);
+    /* a server which went away must not hang the CLI */
+    setsockopt(s->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(s->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    s->len = 4;
+    s->pkt[s->len++] = SSH_FXP_INIT;
+    sftp_put_u32(s, SFTP_VERSION);
+    if (sftp_send(s) || sftp_recv(s, &id) != SSH_FXP_VERSION) {
+        transfer_error(res, "sftp session to %s failed", req->host);
+        return SFTP_LOST;
+    }
+    return 0;
+
+FAIL:
+    if (sv[0] >= 0) {
+        close(sv[0]);
+        close(sv[1]);
+    }
+    if (err[0] >= 0) {
+        close(err[0]);
+        close(err[1]);
+    }
+    return SFTP_LOST;
+}
+
+/* Function       : sftp_stop
+ * Resposibility  : end the session and reap ssh. When the connection was
+ *                  lost what ssh printed is a better reason than ours.
+ * Return         : void
+ */
+static void
+sftp_stop(struct sftp_session *s, int lost, struct transfer_result *res)
+{
+    char msg[TRANSFER_ERROR_LEN];
+    ssize_t n = 0;
+    int status = 0;
+
+    if (s->fd >= 0) {
+        close(s->fd);
+    }
+    if (s->pid > 0) {
+        if (lost) {
+            kill(s->pid, SIGTERM);
+        }
+        while (waitpid(s->pid, &status, 0) < 0 && errno == EINTR);
+    }
+    if (s->err_fd >= 0) {
+        n = read(s->err_fd, msg, sizeof(msg) - 1);
+        if (lost && n > 0) {
+            msg[n] = '\0';
+            msg[strcspn(msg, "\r\n")] = '\0';
+            res->error[0] = '\0';
+            transfer_error(res, "%s", msg);
+        }
+        close(s->err_fd);
+    }
+    s->fd = s->err_fd = -1;
+    s->pid = -1;
+}
+
+/* Function       : sftp_open
+ * Resposibility  : open a remote file for writing and keep its handle
+ * Return         : 0 on success, SFTP_REFUSED or SFTP_LOST otherwise
+ */
+static int
+sftp_open(struct sftp_session *s, const char *path, uint32_t flags,
+          struct transfer_result *res)
+{
+    const uint8_t *handle = NULL;
+    uint32_t id = 0;
+    int type = 0;
+
+    sftp_begin(s, SSH_FXP_OPEN);
+    sftp_put_str(s, path, strlen(path));
+    sftp_put_u32(s, SSH_FXF_WRITE | flags);
+    sftp_put_u32(s, 0);
+    if (sftp_send(s)) {
+        return SFTP_LOST;
+    }
+    type = sftp_recv(s, &id);
+    if (type == SSH_FXP_STATUS) {
+        return (sftp_status_reply(s, res) == SSH_FX_OK) ? SFTP_LOST
+                                                          : SFTP_REFUSED;
+    }
+    if (type != SSH_FXP_HANDLE) {
+        return SFTP_LOST;
+    }
+    handle = sftp_get_str(s, &s->handle_len);
+    if (s->bad || s->handle_len > sizeof(s->handle)) {
+        return SFTP_LOST;
+    }
+    memcpy(s->handle, handle, s->handle_len);
+    return 0;
+}
+
+/* Function       : sftp_handle_request
+ * Resposibility  : send a request on the open handle with no other data
+ * Return         : 0 on success, SFTP_LOST otherwise
+ */
+static int
+sftp_handle_request(struct sftp_session *s, uint8_t type)
+{
+    sftp_begin(s, type);
+    sftp_put_str(s, s->handle, s->handle_len);
+    return sftp_send(s) ? SFTP_LOST : 0;
+}
+
+/* Function       : sftp_size
+ * Resposibility  : size of the open remote file
+ * Return         : 0 on success, SFTP_LOST otherwise
+ */
+static int
+sftp_size(struct sftp_session *s, uint64_t *size)
+{
+    uint32_t id = 0, flags = 0;
+
+    if (sftp_handle_request(s, SSH_FXP_FSTAT)
+        || sftp_recv(s, &id) != SSH_FXP_ATTRS) {
+        return SFTP_LOST;
+    }
+    flags = sftp_get_u32(s);
+    *size = (flags & SSH_ATTR_SIZE) ? sftp_get_u64(s) : 0;
+    return s->bad ? SFTP_LOST : 0;
+}
+
+/* Function       : sftp_same_chunk
+ * Resposibility  : whether the remote file holds the same len bytes at
+ *                  offset as the local one
+ * Return         : 1 if so, 0 if not, SFTP_LOST on a lost connection
+ */
+static int
+sftp_same_chunk(struct sftp_session *s, int fd, uint64_t offset, uint32_t len,
+                uint8_t *local)
+{
+    const uint8_t *data = NULL;
+    uint32_t id = 0, got = 0;
+    int type = 0;
+
+    if (pread(fd, local, len, offset) != (ssize_t)len) {
+        return 0;
+    }
+    sftp_begin(s, SSH_FXP_READ);
+    sftp_put_str(s, s->handle, s->handle_len);
+    sftp_put_u64(s, offset);
+    sftp_put_u32(s, len);
+    if (sftp_send(s)) {
+        return SFTP_LOST;
+    }
+    type = sftp_recv(s, &id);
+    if (type == SSH_FXP_STATUS) {
+        /* write only servers refuse, then nothing can be trusted */
+        return 0;
+    }
+    if (type != SSH_FXP_DATA) {
+        return SFTP_LOST;
+    }
+    data = sftp_get_str(s, &got);
+    return !s->bad && got == len && !memcmp(data, local, len);
+}
+
+/* Function       : sftp_path_request
+ * Resposibility  : remove or rename a remote file
+ * Return         : SSH_FX_OK, SFTP_REFUSED or SFTP_LOST
+ */
+static int
+sftp_path_request(struct sftp_session *s, uint8_t type, const char *path,
+                  const char *new_path, struct transfer_result *res)
+{
+    sftp_begin(s, type);
+    sftp_put_str(s, path, strlen(path));
+    if (new_path) {
+        sftp_put_str(s, new_path, strlen(new_path));
+    }
+    if (sftp_send(s)) {
+        return SFTP_LOST;
+    }
+    return sftp_status(s, res);
+}
+
+/* Function       : sftp_write_data
+ * Resposibility  : write the rest of the source from offset to the open
+ *                  handle, with up to TRANSFER_SFTP_WINDOW chunks in flight
+ * Return         : 0 on success, SFTP_REFUSED or SFTP_LOST
+ */
+static int
+sftp_write_data(struct sftp_session *s, struct transfer_source *src,
+                uint64_t offset, struct sha256_ctx *ctx,
+                struct transfer_result *res,
+                const struct executor_task *task)
+{
+    unsigned int in_flight = 0;
+    size_t len_pos = 0;
+    ssize_t n = 0;
+    int more = 1;
+    int rc = 0;
+
+    while (more || in_flight) {
+        if (more && in_flight < TRANSFER_SFTP_WINDOW) {
+            if (executor_task_cancelled(task)) {
+                transfer_error(res, "interrupted");
+                return SFTP_REFUSED;
+            }
+            sftp_begin(s, SSH_FXP_WRITE);
+            sftp_put_str(s, s->handle, s->handle_len);
+            sftp_put_u64(s, offset);
+            len_pos = s->len;
+            s->len += 4;
+            n = transfer_source_read(src, s->pkt + s->len,
+                                     TRANSFER_SFTP_CHUNK);
+            if (n < 0) {
+                transfer_error(res, "read failed: %s", strerror(errno));
+                return SFTP_REFUSED;
+            }
+            more = (n == TRANSFER_SFTP_CHUNK);
+            if (n == 0) {
+                continue;
+            }
+            s->len = len_pos;
+            sftp_put_u32(s, n);
+            sha256_update(ctx, s->pkt + s->len, n);
+            s->len += n;
+            if (sftp_send(s)) {
+                return SFTP_LOST;
+            }
+            offset += n;
+            in_flight++;
+            continue;
+        }
+        rc = sftp_status(s, res);
+        if (rc != SSH_FX_OK) {
+            return rc;
+        }
+        in_flight--;
+    }
+    return 0;
+}
+
+/* Function       : sftp_upload
+ * Resposibility  : upload the data as <name>.part and rename it once
+ *                  complete. A file resumes from what an earlier session
+ *                  left. The last window before the end of the partial
+ *                  file may have holes, it is sent again, and the chunk
+ *                  before that is compared to tell a partial copy of
+ *                  another file.
+ * Return         : 0 on success, SFTP_REFUSED or SFTP_LOST
+ */
+static int
+sftp_upload(struct sftp_session *s, const struct transfer_request *req,
+            struct transfer_source *src, struct transfer_result *res,
+            const struct executor_task *task)
+{
+    char part[TRANSFER_PATH_LEN + sizeof(TRANSFER_PART_EXT)];
+    uint8_t digest[SHA256_DIGEST_LEN];
+    struct sha256_ctx ctx;
+    uint64_t remote_size = 0, offset = 0, pos = 0;
+    uint8_t *local = NULL;
+    ssize_t n = 0;
+    int rc = 0;
+
+    snprintf(part, sizeof(part), "%s%s", req->remote, TRANSFER_PART_EXT);
+    if ((rc = sftp_open(s, part, SSH_FXF_CREAT, res))
+        || (rc = sftp_size(s, &remote_size))) {
+        return rc;
+    }
+    if (src->seekable && remote_size <= res->size
+        && remote_size > (uint64_t)TRANSFER_SFTP_WINDOW * TRANSFER_SFTP_CHUNK) {
+        offset = remote_size
+                 - (uint64_t)TRANSFER_SFTP_WINDOW * TRANSFER_SFTP_CHUNK;
+        offset -= offset % TRANSFER_SFTP_CHUNK;
+    }
+    local = malloc(TRANSFER_SFTP_CHUNK);
+    if (local == NULL) {
+        transfer_error(res, "memory allocation failed");
+        return SFTP_REFUSED;
+    }
+    if (offset) {
+        rc = sftp_same_chunk(s, src->fd, offset - TRANSFER_SFTP_CHUNK,
+                             TRANSFER_SFTP_CHUNK, local);
+        if (rc == SFTP_LOST) {
+            goto EXIT_FUN;
+        }
+        if (rc == 0) {
+            VLOG_INFO("sftp %s: partial upload of another file, restarted",
+                      part);
+            offset = 0;
+        }
+    }
+    if (offset == 0 && remote_size) {
+        if ((rc = sftp_handle_request(s, SSH_FXP_CLOSE))
+            || (rc = sftp_status(s, res))
+            || (rc = sftp_open(s, part, SSH_FXF_CREAT | SSH_FXF_TRUNC, res))) {
+            goto EXIT_FUN;
+        }
+    }
+
+    /* the data already sent still counts in the checksum */
+    sha256_init(&ctx);
+    for (pos = 0; pos < offset; pos += n) {
+        n = pread(src->fd, local, TRANSFER_SFTP_CHUNK, pos);
+        if (n <= 0) {
+            transfer_error(res, "read failed: %s", strerror(errno));
+            rc = SFTP_REFUSED;
+            goto EXIT_FUN;
+        }
+        sha256_update(&ctx, local, n);
+    }
+    res->resumed = offset;
+    if (src->seekable) {
+        if (lseek(src->fd, offset, SEEK_SET) < 0) {
+            transfer_error(res, "seek failed: %s", strerror(errno));
+            rc = SFTP_REFUSED;
+            goto EXIT_FUN;
+        }
+        src->total = offset;
+    }
+
+    if ((rc = sftp_write_data(s, src, offset, &ctx, res, task))
+        || (rc = sftp_handle_request(s, SSH_FXP_CLOSE))
+        || (rc = sftp_status(s, res))) {
+        goto EXIT_FUN;
+    }
+    sha256_final(&ctx, digest);
+    sha256_to_hex(digest, res->sha256);
+    res->size = src->total;
+
+    /* version 3 rename does not replace, an older copy goes first */
+    rc = sftp_path_request(s, SSH_FXP_REMOVE, req->remote, NULL, res);
+    if (rc == SFTP_LOST) {
+        goto EXIT_FUN;
+    }
+    res->error[0] = '\0';
+    rc = sftp_path_request(s, SSH_FXP_RENAME, part, req->remote, res);
+
+EXIT_FUN:
+    free(local);
+    return rc;
+}
+
+/* Function       : sftp_store_sum
+ * Resposibility  : write the checksum file next to the upload
+ * Return         : 0 on success
+ */
+static int
+sftp_store_sum(struct sftp_session *s, const struct transfer_request *req,
+               struct transfer_result *res)
+{
+    char sum_path[TRANSFER_PATH_LEN + sizeof(TRANSFER_SUM_EXT)];
+    char line[TRANSFER_PATH_LEN + SHA256_HEX_LEN + 4];
+    struct transfer_result sum_res;
+    size_t len = 0;
+
+    memset(&sum_res, 0, sizeof(sum_res));
+    snprintf(sum_path, sizeof(sum_path), "%s%s", req->remote,
+             TRANSFER_SUM_EXT);
+    len = transfer_sum_line(req, res, line, sizeof(line));
+    if (sftp_open(s, sum_path, SSH_FXF_CREAT | SSH_FXF_TRUNC, &sum_res)) {
+        return -1;
+    }
+    sftp_begin(s, SSH_FXP_WRITE);
+    sftp_put_str(s, s->handle, s->handle_len);
+    sftp_put_u64(s, 0);
+    sftp_put_str(s, line, len);
+    if (sftp_send(s) || sftp_status(s, &sum_res)
+        || sftp_handle_request(s, SSH_FXP_CLOSE)
+        || sftp_status(s, &sum_res)) {
+        return -1;
+    }
+    return 0;
+}
+
+/* Function       : transfer_sftp
+ * Resposibility  : upload the data and its checksum with sftp. When a
+ *                  session is lost while sending a file, a new one resumes
+ *                  the upload.
+ * Return         : 0 on success, -1 otherwise
+ */
+static int
+transfer_sftp(const struct transfer_request *req, struct transfer_source *src,
+              struct transfer_result *res, const struct executor_task *task)
+{
+    struct sftp_session s;
+    int rc = SFTP_LOST;
+
+    memset(&s, 0, sizeof(s));
+    s.pkt = malloc(SFTP_PKT_LEN);
+    if (s.pkt == NULL) {
+        transfer_error(res, "memory allocation failed");
+        return -1;
+    }
+    for (;;) {
+        rc = sftp_start(&s, req, res);
+        if (rc == 0) {
+            rc = sftp_upload(&s, req, src, res, task);
+        }
+        if (rc == 0) {
+            res->sum_stored = !sftp_store_sum(&s, req, res);
+        }
+        sftp_stop(&s, rc == SFTP_LOST, res);
+        if (rc != SFTP_LOST || !src->seekable
+            || res->restarts >= TRANSFER_RETRIES
+            || executor_task_cancelled(task)) {
+            break;
+        }
+        VLOG_INFO("sftp %s: session lost, resuming%s%s", req->remote,
+                  res->error[0] ? ": " : "", res->error);
+        res->error[0] = '\0';
+        res->restarts++;
+        sleep(1);
+    }
+    free(s.pkt);
+    if (rc == SFTP_LOST) {
+        transfer_error(res, "connection to %s lost", req->host);
+    }
+    return rc ? -1 : 0;
+}
+
+/* Function       : transfer_source_send
+ * Resposibility  : upload the source with the protocol requested
+ * Return         : 0 on success, -1 otherwise
+ */
+static int
+transfer_source_send(const struct transfer_request *req,
+                     struct transfer_source *src, struct transfer_result *res,
+                     const struct executor_task *task)
+{
+    int rc = -1;
+
+    if (req->protocol == TRANSFER_TFTP) {
+        rc = transfer_tftp(req, src, res, task);
+    } else {
+        rc = transfer_sftp(req, src, res, task);
+    }
+    if (rc) {
+        VLOG_ERR("copy of %s to %s failed: %s", req->local, req->host,
+                 res->error);
+    }
+    return rc;
+}
+
+int
+transfer_file(const struct transfer_request *req, struct transfer_result *res,
+              const struct executor_task *task)
+{
+    struct transfer_source src;
+    struct stat st;
+    int fd = -1;
+    int rc = -1;
+
+    memset(res, 0, sizeof(*res));
+    fd = open(req->local, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        transfer_error(res, "unable to read %s", req->local);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    res->size = st.st_size;
+
+    memset(&src, 0, sizeof(src));
+    src.fd = fd;
+    src.seekable = 1;
+    rc = transfer_source_send(req, &src, res, task);
+    close(fd);
+    return rc;
+}
+
+int
+transfer_stream(const struct transfer_request *req, int fd,
+                struct transfer_result *res, const struct executor_task *task)
+{
+    struct transfer_source src;
+
+    memset(res, 0, sizeof(*res));
+    memset(&src, 0, sizeof(src));
+    src.fd = fd;
+    return transfer_source_send(req, &src, res, task);
+}
@@ -24,6 +24,7 @@
 
 
 #include <errno.h>
+#include <pthread.h>
 #include <unistd.h>
 #include "jsonrpc.h"
 #include "openvswitch/vlog.h"
@@ -39,13 +40,25 @@
 #define MIN_PID               1
 #define MAX_PID_LEN           5
 #define MIN_PID_LEN           1
+#define REGEX_CACHE_SIZE      32
 
 
+/* a pattern compiled once, status is what regcomp returned */
+struct regex_cache_entry {
+    const char *pattern;
+    regex_t regex;
+    int status;
+};
+
 VLOG_DEFINE_THIS_MODULE (supportability_utils_debug);
 
 
 static int read_pid_file (char *pidfile);
 
+static pthread_mutex_t regex_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct regex_cache_entry regex_cache[REGEX_CACHE_SIZE];
+static int regex_cache_count = 0;
+
 
 /* Function        : strncmp_with_nullcheck
  * Responsibility  : Ensure arguments are not null before calling strncmp
@@ -128,12 +141,54 @@ trim_white_space(char *string)
    return beginptr;
 }
 
-/* Helper function to compile the regex pattern */
-int
-compile_corefile_pattern (regex_t * regexst, const char * pattern)
+/*
+ * Function       : regex_cache_get
+ * Responsibility : Compiles a pattern on first use and keeps it for the
+ *                  life of the process. Patterns are the string constants
+ *                  of the headers, looked up by address first.
+ * Returns        : the compiled pattern, NULL if it does not compile
+ */
+const regex_t*
+regex_cache_get(const char * pattern)
 {
-    int status = regcomp (regexst, pattern, REG_EXTENDED|REG_NEWLINE);
-    return status;
+    struct regex_cache_entry *entry = NULL;
+    int i = 0;
+
+    if (pattern == NULL)
+    {
+        return NULL;
+    }
+    pthread_mutex_lock(&regex_cache_mutex);
+    for (i = 0; i < regex_cache_count; i++)
+    {
+        if (regex_cache[i].pattern == pattern
+            || !strcmp(regex_cache[i].pattern, pattern))
+        {
+            entry = &regex_cache[i];
+            break;
+        }
+    }
+    if (entry == NULL && regex_cache_count < REGEX_CACHE_SIZE)
+    {
+        entry = &regex_cache[regex_cache_count];
+        entry->status = regcomp(&entry->regex, pattern,
+                REG_EXTENDED|REG_NEWLINE);
+        if (entry->status)
+        {
+            VLOG_ERR("Invalid regular expression %s", pattern);
+            regfree(&entry->regex);
+        }
+        entry->pattern = pattern;
+        regex_cache_count++;
+    }
+    pthread_mutex_unlock(&regex_cache_mutex);
+
+    if (entry == NULL)
+    {
+        VLOG_ERR("Too many regular expressions, %s not cached", pattern);
+        return NULL;
+    }
+    return entry->status ? NULL : &entry->regex;
 }
 
 /* Function       : sev_level
@@ -285,23 +340,17 @@ strnlwr(char *str, int size)
 int
 validate_cli_args(const char * arg , const char * regex)
 {
-    regex_t r;
-    int rc = 0;
-    const int n_matches = 10;
-    regmatch_t m[n_matches];
+    const regex_t *r = NULL;
 
     if (!( arg && regex ) )
         return 1;
 
-    rc = regcomp(&r, regex , REG_EXTENDED|REG_NEWLINE);
-    if ( rc )  {
-        regfree (&r);
-        return rc;
+    r = regex_cache_get(regex);
+    if ( r == NULL )  {
+        return REG_BADPAT;
     }
 
-    rc = regexec (&r,arg,n_matches, m, 0);
-    regfree (&r);
-    return rc;
+    return regexec (r, arg, 0, NULL, 0);
 }
 
 /*
@@ -0,0 +1,1464 @@
+/*
+ Copyright (C) 2016 Hewlett-Packard Development Company, L.P.
+ All Rights Reserved.
+
+    Licensed under the Apache License, Version 2.0 (the "License"); you may
+    not use this file except in compliance with the License. You may obtain
+    a copy of the License at
+
+         http://www.apache.org/licenses/LICENSE-2.0
+
+    Unless required by applicable law or agreed to in writing, software
+    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+    License for the specific language governing permissions and limitations
+    under the License.
+*/
+
+/*************************************************************************//**
+ * @ingroup ops_supportability
+ * This module forwards the journal to the remote syslog servers.
+ *
+ * The journal is read from a cursor, an entry is formatted once as an
+ * RFC 5424 message and appended to the spool of each remote whose severity
+ * lets it through. A spool is a file of SYSLOG_FWD_DIR bounded by
+ * SYSLOG_FWD_SPOOL_MAX, it is sent by batches of SYSLOG_FWD_BATCH messages,
+ * with sendmmsg() over UDP and with octet counting (RFC 6587) over TCP. A
+ * remote which cannot be reached is retried with a backoff, its spool keeps
+ * the messages meanwhile.
+ *
+ * The spools are synced before the cursor of the last entry read is saved,
+ * and each spool records the last entry it was given. After a restart the
+ * journal is read again from the saved cursor and a spool skips the entries
+ * it already has, so that none is lost or forwarded twice.
+ *
+ * When the spool of a remote which takes messages is full the journal is
+ * not read until it drains, the journal is the backlog. A remote which is
+ * unreachable, or which took nothing for SYSLOG_FWD_STALL_MAX, drops the
+ * new messages and counts them instead, so that it does not hold back the
+ * other remotes.
+ *
+ * syslog_forward_run() is called by the poll loop of the supportability
+ * daemon and never blocks it. The address of a remote is looked up by a
+ * helper thread, from the time the remote is added, and cached; a failure
+ * to connect or to send looks it up again.
+ *
+ * @file
+ * Source file for the syslog forwarder of supportability library.
+ *
+ ****************************************************************************/
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <systemd/sd-journal.h>
+#include "syslog_forward.h"
+#include "openvswitch/vlog.h"
+
+VLOG_DEFINE_THIS_MODULE(syslog_forward);
+
+#define FWD_SPOOL_MAGIC          0x44574653      /* "SFWD" */
+#define FWD_SPOOL_VERSION        1
+#define FWD_SPOOL_EXT            ".spool"
+#define FWD_CURSOR_SIZE          256
+#define FWD_RECORD_MAX           (sizeof(uint32_t) + SYSLOG_FWD_MSG_MAX)
+#define FWD_BATCH_SIZE           (SYSLOG_FWD_BATCH * FWD_RECORD_MAX)
+/* the octet count and its space before each TCP frame */
+#define FWD_FRAME_PREFIX_MAX     12
+#define FWD_COPY_SIZE            65536
+#define FWD_DEFAULT_SEVERITY     6       /* info */
+#define FWD_DEFAULT_FACILITY     1       /* user */
+#define FWD_APP_NAME_MAX         48
+#define FWD_PROCID_MAX           128
+#define FWD_HOSTNAME_MAX         255
+
+/* A spool file starts with its header, the messages follow, each as its
+ * 32 bit length and the message. The records after write_off are the end
+ * of an interrupted append. */
+struct fwd_spool_header {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t read_off;              /* first message not sent */
+    uint64_t write_off;             /* end of the messages */
+    uint64_t dropped;               /* messages which did not fit */
+    uint64_t realtime;              /* of the last entry given */
+    char cursor[FWD_CURSOR_SIZE];   /* last entry given, empty if none */
+};
+
+enum fwd_state {
+    FWD_IDLE,                       /* no socket */
+    FWD_CONNECTING,                 /* TCP connect() in progress */
+    FWD_READY,
+};
+
+/* A lookup of the address of a remote. It is freed by the remote once done,
+ * or by its thread when the remote was removed meanwhile. */
+struct fwd_lookup {
+    char *host;
+    char port[8];
+    int socktype;
+    int done;
+    int abandoned;                  /* the remote is gone */
+    int err;                        /* errno, 0 on success */
+    struct sockaddr_storage addr;
+    socklen_t addr_len;
+};
+
+struct fwd_remote {
+    char *host;
+    int tcp;
+    int port;
+    int severity;                   /* highest syslog level forwarded */
+    int keep;                       /* added since syslog_forward_begin */
+    char path[PATH_MAX];
+    int spool_fd;
+    int dirty;                      /* appended since the last sync */
+    struct fwd_spool_header hdr;
+    /* after a restart, the entries up to the cursor of the spool are
+     * spooled already, 0 once the spool caught up */
+    uint64_t skip_realtime;
+    int sock;
+    enum fwd_state state;
+    struct sockaddr_storage addr;
+    socklen_t addr_len;             /* 0 until the address is known */
+    int stale;                      /* the address is looked up again */
+    struct fwd_lookup *lookup;      /* in progress, NULL if none */
+    /* batch being sent, from the spool at read_off */
+    char *batch;
+    const char *msg[SYSLOG_FWD_BATCH];
+    uint32_t msg_len[SYSLOG_FWD_BATCH];
+    unsigned int frames;
+    unsigned int frames_sent;
+    char *out;                      /* the TCP frames of the batch */
+    size_t out_end[SYSLOG_FWD_BATCH];
+    size_t out_sent;
+    long long retry_at;
+    long long progress_at;          /* last time it took messages */
+    long long connect_at;
+    unsigned int backoff;
+    uint64_t sent;
+    struct fwd_remote *next;
+};
+
+static const char *fwd_severities[] = {
+    "emerg", "alert", "crit", "err", "warning", "notice", "info", "debug",
+};
+
+static sd_journal *journal = NULL;
+static int journal_fd = -1;
+static char saved_cursor[FWD_CURSOR_SIZE];
+static int resume = 0;              /* the journal is at saved_cursor */
+static int configured = 0;          /* remotes were committed once */
+static int more = 0;                /* the last run left entries to read */
+static uint64_t last_realtime = 0;
+static char hostname[FWD_HOSTNAME_MAX + 1] = "-";
+static struct fwd_remote *remotes = NULL;
+static pthread_mutex_t lookup_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* fwd_now
+ * Returns the monotonic time in msec.
+ */
+static long long
+fwd_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/* fwd_token
+ * Copies a header field of a message, RFC 5424 only allows printable
+ * ASCII with no space there.
+ */
+static void
+fwd_token(char *buf, size_t size, const char *value, size_t len)
+{
+    size_t i = 0;
+
+    for(i = 0; i < len && i < size - 1; i++) {
+        buf[i] = (value[i] > ' ' && value[i] < 127) ? value[i] : '_';
+    }
+    buf[i] = '\0';
+    if(i == 0) {
+        strcpy(buf, "-");
+    }
+}
+
+/* fwd_field
+ * Finds a field of the current journal entry.
+ *
+ * Returns 0 with the value, which is not nul terminated, -1 if the entry
+ * has no such field.
+ */
+static int
+fwd_field(const char *name, const char **value, size_t *len)
+{
+    const void *data = NULL;
+    size_t size = 0, name_len = strlen(name);
+
+    if(sd_journal_get_data(journal, name, &data, &size) < 0
+       || size <= name_len) {
+        return -1;
+    }
+    *value = (const char *) data + name_len + 1;
+    *len = size - name_len - 1;
+    return 0;
+}
+
+/* fwd_field_int
+ * Returns the numeric field of the current journal entry, def if it has
+ * none.
+ */
+static int
+fwd_field_int(const char *name, int def)
+{
+    char buf[16];
+    const char *value = NULL;
+    char *end = NULL;
+    size_t len = 0;
+    long n = 0;
+
+    if(fwd_field(name, &value, &len) || len >= sizeof(buf)) {
+        return def;
+    }
+    memcpy(buf, value, len);
+    buf[len] = '\0';
+    n = strtol(buf, &end, 10);
+    return (end == buf || *end != '\0' || n < 0) ? def : (int) n;
+}
+
+/* fwd_field_token
+ * Copies the field of the current journal entry, or its fallback, as a
+ * header field of a message.
+ */
+static void
+fwd_field_token(const char *name, const char *fallback, char *buf,
+                size_t size)
+{
+    const char *value = NULL;
+    size_t len = 0;
+
+    if(fwd_field(name, &value, &len) && fwd_field(fallback, &value, &len)) {
+        len = 0;
+    }
+    fwd_token(buf, size, value, len);
+}
+
+/* fwd_format
+ * Formats the current journal entry as an RFC 5424 message.
+ *
+ * Returns the length of the message.
+ */
+static int
+fwd_format(char *msg, size_t size, int severity, uint64_t realtime)
+{
+    char app[FWD_APP_NAME_MAX + 1], procid[FWD_PROCID_MAX + 1];
+    time_t secs = realtime / 1000000;
+    const char *text = NULL;
+    size_t text_len = 0;
+    struct tm tm;
+    int facility = 0, len = 0;
+
+    facility = fwd_field_int("SYSLOG_FACILITY", FWD_DEFAULT_FACILITY);
+    if(facility > 23) {
+        facility = FWD_DEFAULT_FACILITY;
+    }
+    fwd_field_token("SYSLOG_IDENTIFIER", "_COMM", app, sizeof(app));
+    fwd_field_token("SYSLOG_PID", "_PID", procid, sizeof(procid));
+    gmtime_r(&secs, &tm);
+    len = snprintf(msg, size,
+                   "<%d>1 %04d-%02d-%02dT%02d:%02d:%02d.%06uZ %s %s %s - - ",
+                   facility * 8 + severity, tm.tm_year + 1900, tm.tm_mon + 1,
+                   tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec,
+                   (unsigned int) (realtime % 1000000), hostname, app, procid);
+    if(len < 0 || (size_t) len >= size) {
+        return -1;
+    }
+    if(fwd_field("MESSAGE", &text, &text_len) == 0) {
+        if(text_len > size - len) {
+            text_len = size - len;
+        }
+        memcpy(msg + len, text, text_len);
+        len += text_len;
+    }
+    return len;
+}
+
+/* fwd_remote_name
+ * Formats a remote as shown in the logs and the stats.
+ */
+static const char *
+fwd_remote_name(const struct fwd_remote *r, char *buf, size_t size)
+{
+    snprintf(buf, size, strchr(r->host, ':') ? "%s [%s]:%d" : "%s %s:%d",
+             r->tcp ? "tcp" : "udp", r->host, r->port);
+    return buf;
+}
+
+/* fwd_spool_write_header
+ * Writes the header of a spool.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+fwd_spool_write_header(struct fwd_remote *r)
+{
+    if(pwrite(r->spool_fd, &r->hdr, sizeof(r->hdr), 0) != sizeof(r->hdr)) {
+        VLOG_ERR("Failed to write the spool %s: %s", r->path,
+                 strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/* fwd_spool_reset
+ * Empties a spool.
+ */
+static void
+fwd_spool_reset(struct fwd_remote *r)
+{
+    r->hdr.read_off = sizeof(r->hdr);
+    r->hdr.write_off = sizeof(r->hdr);
+    r->frames = 0;
+    r->frames_sent = 0;
+    fwd_spool_write_header(r);
+    if(ftruncate(r->spool_fd, sizeof(r->hdr))) {
+        VLOG_DBG("Failed to truncate the spool %s: %s", r->path,
+                 strerror(errno));
+    }
+}
+
+/* fwd_spool_open
+ * Opens the spool of a remote, what it has from before a restart is kept.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+fwd_spool_open(struct fwd_remote *r)
+{
+    struct stat st;
+
+    r->spool_fd = open(r->path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if(r->spool_fd < 0) {
+        VLOG_ERR("Failed to open the spool %s: %s", r->path, strerror(errno));
+        return -1;
+    }
+    if(fstat(r->spool_fd, &st) == 0 && st.st_size >= sizeof(r->hdr)
+       && pread(r->spool_fd, &r->hdr, sizeof(r->hdr), 0) == sizeof(r->hdr)
+       && r->hdr.magic == FWD_SPOOL_MAGIC
+       && r->hdr.version == FWD_SPOOL_VERSION
+       && r->hdr.read_off >= sizeof(r->hdr)
+       && r->hdr.read_off <= r->hdr.write_off
+       && r->hdr.write_off <= st.st_size) {
+        if(r->hdr.write_off < st.st_size
+           && ftruncate(r->spool_fd, r->hdr.write_off)) {
+            VLOG_DBG("Failed to truncate the spool %s: %s", r->path,
+                     strerror(errno));
+        }
+        r->hdr.cursor[FWD_CURSOR_SIZE - 1] = '\0';
+        if(r->hdr.cursor[0]) {
+            r->skip_realtime = r->hdr.realtime;
+        }
+        return 0;
+    }
+    if(st.st_size > 0) {
+        VLOG_ERR("Discarding the spool %s, it is corrupted", r->path);
+    }
+    memset(&r->hdr, 0, sizeof(r->hdr));
+    r->hdr.magic = FWD_SPOOL_MAGIC;
+    r->hdr.version = FWD_SPOOL_VERSION;
+    fwd_spool_reset(r);
+    return 0;
+}
+
+/* fwd_spool_compact
+ * Moves the messages not sent to the beginning of a spool. Only done when
+ * they fit before read_off, so that the spool is never left inconsistent.
+ */
+static void
+fwd_spool_compact(struct fwd_remote *r)
+{
+    char buf[FWD_COPY_SIZE];
+    uint64_t unread = r->hdr.write_off - r->hdr.read_off;
+    uint64_t done = 0;
+    ssize_t len = 0;
+
+    if(r->hdr.read_off - sizeof(r->hdr) < unread || unread == 0) {
+        return;
+    }
+    for(done = 0; done < unread; done += len) {
+        len = pread(r->spool_fd, buf,
+                    unread - done < sizeof(buf) ? unread - done : sizeof(buf),
+                    r->hdr.read_off + done);
+        if(len <= 0
+           || pwrite(r->spool_fd, buf, len, sizeof(r->hdr) + done) != len) {
+            VLOG_ERR("Failed to compact the spool %s: %s", r->path,
+                     strerror(errno));
+            return;
+        }
+    }
+    if(fdatasync(r->spool_fd)) {
+        return;
+    }
+    r->hdr.read_off = sizeof(r->hdr);
+    r->hdr.write_off = sizeof(r->hdr) + unread;
+    if(fwd_spool_write_header(r) == 0
+       && ftruncate(r->spool_fd, r->hdr.write_off)) {
+        VLOG_DBG("Failed to truncate the spool %s: %s", r->path,
+                 strerror(errno));
+    }
+}
+
+/* fwd_spool_room
+ * Returns the space left in a spool, compacted if it is full.
+ */
+static uint64_t
+fwd_spool_room(struct fwd_remote *r)
+{
+    if(r->hdr.write_off + FWD_RECORD_MAX > SYSLOG_FWD_SPOOL_MAX) {
+        fwd_spool_compact(r);
+    }
+    return r->hdr.write_off < SYSLOG_FWD_SPOOL_MAX
+           ? SYSLOG_FWD_SPOOL_MAX - r->hdr.write_off : 0;
+}
+
+/* fwd_spool_append
+ * Appends a message to a spool, it is dropped when the spool is full.
+ */
+static void
+fwd_spool_append(struct fwd_remote *r, const char *msg, uint32_t len)
+{
+    struct iovec iov[2] = {
+        { &len, sizeof(len) },
+        { (void *) msg, len },
+    };
+
+    r->dirty = 1;
+    if(fwd_spool_room(r) < sizeof(len) + len
+       || pwritev(r->spool_fd, iov, 2, r->hdr.write_off)
+          != sizeof(len) + len) {
+        r->hdr.dropped++;
+        return;
+    }
+    r->hdr.write_off += sizeof(len) + len;
+}
+
+/* fwd_spool_sent
+ * Records the messages sent, the spool is emptied once all were.
+ */
+static void
+fwd_spool_sent(struct fwd_remote *r)
+{
+    if(r->hdr.read_off == r->hdr.write_off) {
+        fwd_spool_reset(r);
+    }
+    else {
+        fwd_spool_write_header(r);
+    }
+}
+
+/* fwd_alive
+ * Returns 1 if the remote takes messages, so that the journal waits
+ * for its spool to drain.
+ */
+static int
+fwd_alive(const struct fwd_remote *r, long long now)
+{
+    return r->retry_at <= now && now - r->progress_at < SYSLOG_FWD_STALL_MAX;
+}
+
+/* fwd_fail
+ * Closes the connection to a remote, it is retried after a backoff. The
+ * batch is read again from the spool then.
+ */
+static void
+fwd_fail(struct fwd_remote *r, long long now, const char *what, int err)
+{
+    char name[FWD_HOSTNAME_MAX + 32];
+
+    if(r->backoff == 0) {
+        VLOG_WARN("Failed to %s syslog remote %s: %s, retrying", what,
+                  fwd_remote_name(r, name, sizeof(name)), strerror(err));
+    }
+    if(r->sock >= 0) {
+        close(r->sock);
+        r->sock = -1;
+    }
+    r->state = FWD_IDLE;
+    r->stale = 1;
+    r->frames = 0;
+    r->frames_sent = 0;
+    r->backoff = r->backoff ? r->backoff * 2 : SYSLOG_FWD_RETRY_MIN;
+    if(r->backoff > SYSLOG_FWD_RETRY_MAX) {
+        r->backoff = SYSLOG_FWD_RETRY_MAX;
+    }
+    r->retry_at = now + r->backoff;
+}
+
+/* fwd_lookup_free
+ * Frees a lookup.
+ */
+static void
+fwd_lookup_free(struct fwd_lookup *l)
+{
+    free(l->host);
+    free(l);
+}
+
+/* fwd_lookup_thread
+ * Looks the address of a remote up, getaddrinfo() may block for as long
+ * as the resolver times out.
+ */
+static void *
+fwd_lookup_thread(void *arg)
+{
+    struct fwd_lookup *l = arg;
+    struct addrinfo hints, *res = NULL;
+    int err = 0;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = l->socktype;
+    hints.ai_flags = AI_NUMERICSERV;
+    err = getaddrinfo(l->host, l->port, &hints, &res);
+    if(err) {
+        err = (err == EAI_SYSTEM) ? errno : ENOENT;
+    }
+
+    pthread_mutex_lock(&lookup_mutex);
+    if(err) {
+        l->err = err;
+    }
+    else {
+        memcpy(&l->addr, res->ai_addr, res->ai_addrlen);
+        l->addr_len = res->ai_addrlen;
+        freeaddrinfo(res);
+    }
+    l->done = 1;
+    if(l->abandoned) {
+        fwd_lookup_free(l);
+    }
+    pthread_mutex_unlock(&lookup_mutex);
+    return NULL;
+}
+
+/* fwd_lookup_start
+ * Starts looking the address of a remote up.
+ *
+ * Returns 0 on success, an errno on failure.
+ */
+static int
+fwd_lookup_start(struct fwd_remote *r)
+{
+    struct fwd_lookup *l = NULL;
+    pthread_attr_t attr;
+    pthread_t thread;
+    int err = 0;
+
+    l = calloc(1, sizeof(*l));
+    if(l == NULL || (l->host = strdup(r->host)) == NULL) {
+        free(l);
+        return ENOMEM;
+    }
+    snprintf(l->port, sizeof(l->port), "%d", r->port);
+    l->socktype = r->tcp ? SOCK_STREAM : SOCK_DGRAM;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    err = pthread_create(&thread, &attr, fwd_lookup_thread, l);
+    pthread_attr_destroy(&attr);
+    if(err) {
+        fwd_lookup_free(l);
+        return err;
+    }
+    r->lookup = l;
+    return 0;
+}
+
+/* fwd_lookup_abandon
+ * Lets the thread of a lookup in progress free it.
+ */
+static void
+fwd_lookup_abandon(struct fwd_remote *r)
+{
+    if(r->lookup == NULL) {
+        return;
+    }
+    pthread_mutex_lock(&lookup_mutex);
+    if(r->lookup->done) {
+        fwd_lookup_free(r->lookup);
+    }
+    else {
+        r->lookup->abandoned = 1;
+    }
+    pthread_mutex_unlock(&lookup_mutex);
+    r->lookup = NULL;
+}
+
+/* fwd_resolve
+ * Takes the result of the lookup of a remote once it is done, and starts a
+ * lookup when the address is unknown or stale. A failed lookup keeps the
+ * last address.
+ *
+ * Returns 0 when the address is known, 1 while it is looked up, -1 on
+ * failure with err set.
+ */
+static int
+fwd_resolve(struct fwd_remote *r, int *err)
+{
+    struct fwd_lookup *l = NULL;
+
+    pthread_mutex_lock(&lookup_mutex);
+    if(r->lookup && r->lookup->done) {
+        l = r->lookup;
+        r->lookup = NULL;
+    }
+    pthread_mutex_unlock(&lookup_mutex);
+    if(l) {
+        *err = l->err;
+        if(*err == 0) {
+            memcpy(&r->addr, &l->addr, l->addr_len);
+            r->addr_len = l->addr_len;
+        }
+        fwd_lookup_free(l);
+        r->stale = 0;
+        if(*err && r->addr_len == 0) {
+            return -1;
+        }
+    }
+    if(r->lookup == NULL && (r->addr_len == 0 || r->stale)) {
+        *err = fwd_lookup_start(r);
+        if(*err) {
+            r->stale = 0;
+            return r->addr_len ? 0 : -1;
+        }
+    }
+    return r->lookup ? 1 : 0;
+}
+
+/* fwd_connect
+ * Connects to a remote once its address is known, a TCP connection is
+ * completed by later calls.
+ *
+ * Returns 0 when connected, 1 while looking up or connecting, -1 on
+ * failure.
+ */
+static int
+fwd_connect(struct fwd_remote *r, long long now)
+{
+    struct pollfd pfd;
+    int err = 0, ret = 0;
+    socklen_t len = sizeof(err);
+
+    if(r->state == FWD_IDLE) {
+        ret = fwd_resolve(r, &err);
+        if(ret < 0) {
+            fwd_fail(r, now, "resolve", err);
+            return -1;
+        }
+        if(ret > 0) {
+            return 1;
+        }
+        r->sock = socket(r->addr.ss_family,
+                         (r->tcp ? SOCK_STREAM : SOCK_DGRAM)
+                         | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(r->sock < 0) {
+            fwd_fail(r, now, "create a socket for", errno);
+            return -1;
+        }
+        if(!r->tcp) {
+            r->state = FWD_READY;
+            return 0;
+        }
+        if(connect(r->sock, (struct sockaddr *) &r->addr, r->addr_len)
+           && errno != EINPROGRESS) {
+            fwd_fail(r, now, "connect to", errno);
+            return -1;
+        }
+        r->state = FWD_CONNECTING;
+        r->connect_at = now;
+    }
+    if(r->state == FWD_CONNECTING) {
+        pfd.fd = r->sock;
+        pfd.events = POLLOUT;
+        if(poll(&pfd, 1, 0) <= 0) {
+            if(now - r->connect_at < SYSLOG_FWD_CONNECT_TIMEOUT) {
+                return 1;
+            }
+            fwd_fail(r, now, "connect to", ETIMEDOUT);
+            return -1;
+        }
+        if(getsockopt(r->sock, SOL_SOCKET, SO_ERROR, &err, &len) || err) {
+            fwd_fail(r, now, "connect to", err ? err : errno);
+            return -1;
+        }
+        r->state = FWD_READY;
+        r->progress_at = now;
+    }
+    return 0;
+}
+
+/* fwd_batch_load
+ * Reads the next batch from the spool at read_off, and frames it for TCP.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+static int
+fwd_batch_load(struct fwd_remote *r)
+{
+    uint64_t avail = r->hdr.write_off - r->hdr.read_off;
+    size_t size = avail < FWD_BATCH_SIZE ? avail : FWD_BATCH_SIZE;
+    size_t off = 0, out_len = 0;
+    uint32_t len = 0;
+    int prefix = 0;
+
+    r->frames = 0;
+    r->frames_sent = 0;
+    r->out_sent = 0;
+    if(pread(r->spool_fd, r->batch, size, r->hdr.read_off) != size) {
+        VLOG_ERR("Failed to read the spool %s: %s", r->path, strerror(errno));
+        return -1;
+    }
+    while(r->frames < SYSLOG_FWD_BATCH && off + sizeof(len) <= size) {
+        memcpy(&len, r->batch + off, sizeof(len));
+        if(len == 0 || len > SYSLOG_FWD_MSG_MAX) {
+            break;
+        }
+        if(off + sizeof(len) + len > size) {
+            break;
+        }
+        r->msg[r->frames] = r->batch + off + sizeof(len);
+        r->msg_len[r->frames] = len;
+        if(r->tcp) {
+            prefix = sprintf(r->out + out_len, "%u ", len);
+            memcpy(r->out + out_len + prefix, r->msg[r->frames], len);
+            out_len += prefix + len;
+            r->out_end[r->frames] = out_len;
+        }
+        off += sizeof(len) + len;
+        r->frames++;
+    }
+    if(r->frames == 0) {
+        VLOG_ERR("Discarding the spool %s, it is corrupted", r->path);
+        fwd_spool_reset(r);
+        return -1;
+    }
+    return 0;
+}
+
+/* fwd_batch_done
+ * Advances read_off past the messages of the batch sent.
+ */
+static void
+fwd_batch_done(struct fwd_remote *r, unsigned int frames, long long now)
+{
+    for(; frames > 0; frames--) {
+        r->hdr.read_off += sizeof(uint32_t) + r->msg_len[r->frames_sent++];
+        r->sent++;
+    }
+    if(r->backoff) {
+        char name[FWD_HOSTNAME_MAX + 32];
+
+        VLOG_INFO("Forwarding to syslog remote %s again",
+                  fwd_remote_name(r, name, sizeof(name)));
+        r->backoff = 0;
+    }
+    r->progress_at = now;
+}
+
+/* fwd_send_tcp
+ * Sends what the socket takes of the batch, the messages partly sent are
+ * sent again after a reconnection.
+ *
+ * Returns 1 when the batch was sent, 0 when the socket is full, -1 on
+ * failure.
+ */
+static int
+fwd_send_tcp(struct fwd_remote *r, long long now)
+{
+    size_t out_len = r->out_end[r->frames - 1];
+    unsigned int done = 0;
+    ssize_t len = 0;
+
+    while(r->out_sent < out_len) {
+        len = send(r->sock, r->out + r->out_sent, out_len - r->out_sent,
+                   MSG_NOSIGNAL | MSG_DONTWAIT);
+        if(len < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            fwd_fail(r, now, "send to", errno);
+            return -1;
+        }
+        r->out_sent += len;
+        for(done = 0; r->frames_sent + done < r->frames
+            && r->out_end[r->frames_sent + done] <= r->out_sent; done++);
+        if(done) {
+            fwd_batch_done(r, done, now);
+        }
+    }
+    return 1;
+}
+
+/* fwd_send_udp
+ * Sends what the socket takes of the batch, a datagram per message.
+ *
+ * Returns 1 when the batch was sent, 0 when the socket is full, -1 on
+ * failure.
+ */
+static int
+fwd_send_udp(struct fwd_remote *r, long long now)
+{
+    struct mmsghdr msgs[SYSLOG_FWD_BATCH];
+    struct iovec iov[SYSLOG_FWD_BATCH];
+    unsigned int i = 0, count = 0;
+    int sent = 0;
+
+    while(r->frames_sent < r->frames) {
+        count = r->frames - r->frames_sent;
+        memset(msgs, 0, count * sizeof(msgs[0]));
+        for(i = 0; i < count; i++) {
+            iov[i].iov_base = (void *) r->msg[r->frames_sent + i];
+            iov[i].iov_len = r->msg_len[r->frames_sent + i];
+            msgs[i].msg_hdr.msg_name = &r->addr;
+            msgs[i].msg_hdr.msg_namelen = r->addr_len;
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        sent = sendmmsg(r->sock, msgs, count, MSG_DONTWAIT);
+        if(sent < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            if(errno == EAGAIN || errno == EWOULDBLOCK) {
+                return 0;
+            }
+            fwd_fail(r, now, "send to", errno);
+            return -1;
+        }
+        fwd_batch_done(r, sent, now);
+    }
+    return 1;
+}
+
+/* fwd_send
+ * Sends the spool of a remote until it is empty or the remote takes no
+ * more.
+ */
+static void
+fwd_send(struct fwd_remote *r, long long now)
+{
+    uint64_t read_off = r->hdr.read_off;
+    int ret = 1;
+
+    while(ret > 0 && (r->frames_sent < r->frames
+                      || r->hdr.read_off < r->hdr.write_off)) {
+        if(now < r->retry_at || fwd_connect(r, now)) {
+            break;
+        }
+        if(r->frames_sent == r->frames && fwd_batch_load(r)) {
+            break;
+        }
+        ret = r->tcp ? fwd_send_tcp(r, now) : fwd_send_udp(r, now);
+    }
+    if(r->hdr.read_off != read_off) {
+        fwd_spool_sent(r);
+    }
+    if(r->hdr.read_off == r->hdr.write_off) {
+        /* nothing to send is not a stall */
+        r->progress_at = now;
+    }
+}
+
+/* fwd_blocked
+ * Returns 1 if the spool of a remote which takes messages is full, the
+ * journal is not read until it drains.
+ */
+static int
+fwd_blocked(long long now)
+{
+    struct fwd_remote *r = NULL;
+
+    for(r = remotes; r; r = r->next) {
+        if(fwd_spool_room(r) < FWD_RECORD_MAX && fwd_alive(r, now)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/* fwd_entry
+ * Spools the current journal entry for the remotes its severity is
+ * forwarded to.
+ */
+static void
+fwd_entry(void)
+{
+    char msg[SYSLOG_FWD_MSG_MAX];
+    struct fwd_remote *r = NULL;
+    int severity = 0, len = 0;
+
+    severity = fwd_field_int("PRIORITY", FWD_DEFAULT_SEVERITY) & 7;
+    if(sd_journal_get_realtime_usec(journal, &last_realtime) < 0) {
+        last_realtime = 0;
+    }
+    for(r = remotes; r; r = r->next) {
+        if(r->skip_realtime) {
+            if(last_realtime <= r->skip_realtime) {
+                if(sd_journal_test_cursor(journal, r->hdr.cursor) > 0) {
+                    r->skip_realtime = 0;
+                }
+                continue;
+            }
+            r->skip_realtime = 0;
+        }
+        if(severity > r->severity) {
+            continue;
+        }
+        if(len == 0) {
+            len = fwd_format(msg, sizeof(msg), severity, last_realtime);
+        }
+        if(len > 0) {
+            fwd_spool_append(r, msg, len);
+        }
+    }
+}
+
+/* fwd_cursor_save
+ * Saves the cursor of the last entry read, the spools have it already.
+ */
+static void
+fwd_cursor_save(const char *cursor)
+{
+    const char *tmp = SYSLOG_FWD_CURSOR_FILE ".tmp";
+    size_t len = strlen(cursor);
+    int fd = -1;
+
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if(fd < 0) {
+        VLOG_ERR("Failed to save the journal cursor: %s", strerror(errno));
+        return;
+    }
+    if(write(fd, cursor, len) != len || fdatasync(fd)) {
+        VLOG_ERR("Failed to save the journal cursor: %s", strerror(errno));
+        close(fd);
+        unlink(tmp);
+        return;
+    }
+    close(fd);
+    if(rename(tmp, SYSLOG_FWD_CURSOR_FILE)) {
+        VLOG_ERR("Failed to save the journal cursor: %s", strerror(errno));
+    }
+}
+
+/* fwd_cursor_load
+ * Reads the saved cursor.
+ *
+ * Returns 0 on success, -1 if there is none.
+ */
+static int
+fwd_cursor_load(char *cursor, size_t size)
+{
+    ssize_t len = 0;
+    int fd = -1;
+
+    fd = open(SYSLOG_FWD_CURSOR_FILE, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) {
+        return -1;
+    }
+    len = read(fd, cursor, size - 1);
+    close(fd);
+    if(len <= 0) {
+        return -1;
+    }
+    cursor[len] = '\0';
+    return 0;
+}
+
+/* fwd_sync
+ * Syncs the spools given new messages, then saves the cursor of the last
+ * entry read.
+ */
+static void
+fwd_sync(void)
+{
+    struct fwd_remote *r = NULL;
+    char *cursor = NULL;
+
+    if(sd_journal_get_cursor(journal, &cursor) < 0) {
+        VLOG_ERR("Failed to get the journal cursor");
+        return;
+    }
+    for(r = remotes; r; r = r->next) {
+        if(r->skip_realtime) {
+            continue;
+        }
+        strncpy(r->hdr.cursor, cursor, FWD_CURSOR_SIZE - 1);
+        r->hdr.realtime = last_realtime;
+        if(r->dirty) {
+            r->dirty = 0;
+            if(fwd_spool_write_header(r) == 0 && fdatasync(r->spool_fd)) {
+                VLOG_ERR("Failed to sync the spool %s: %s", r->path,
+                         strerror(errno));
+            }
+        }
+    }
+    fwd_cursor_save(cursor);
+    free(cursor);
+}
+
+/* fwd_read
+ * Reads the new journal entries, until the spool of a remote which takes
+ * messages is full.
+ *
+ * Returns the number of entries read.
+ */
+static int
+fwd_read(long long now)
+{
+    int count = 0, ret = 0;
+
+    more = 0;
+    while(count < SYSLOG_FWD_READ_MAX) {
+        if(fwd_blocked(now)) {
+            return count;
+        }
+        ret = sd_journal_next(journal);
+        if(ret <= 0) {
+            if(ret < 0) {
+                VLOG_ERR("Failed to read the journal: %s", strerror(-ret));
+            }
+            return count;
+        }
+        count++;
+        if(resume) {
+            /* the saved cursor is the last entry read before */
+            resume = 0;
+            if(sd_journal_test_cursor(journal, saved_cursor) > 0) {
+                continue;
+            }
+        }
+        fwd_entry();
+    }
+    more = 1;
+    return count;
+}
+
+/* fwd_remote_free
+ * Closes and frees a remote, its spool is left on disk.
+ */
+static void
+fwd_remote_free(struct fwd_remote *r)
+{
+    fwd_lookup_abandon(r);
+    if(r->sock >= 0) {
+        close(r->sock);
+    }
+    if(r->spool_fd >= 0) {
+        close(r->spool_fd);
+    }
+    free(r->batch);
+    free(r->out);
+    free(r->host);
+    free(r);
+}
+
+/* fwd_remote_remove
+ * Removes a remote from the list, its spool is discarded.
+ */
+static void
+fwd_remote_remove(struct fwd_remote **iter)
+{
+    char name[FWD_HOSTNAME_MAX + 32];
+    struct fwd_remote *r = *iter;
+
+    *iter = r->next;
+    VLOG_INFO("Stopped forwarding syslog to %s, %llu bytes discarded",
+              fwd_remote_name(r, name, sizeof(name)),
+              (unsigned long long) (r->hdr.write_off - r->hdr.read_off));
+    unlink(r->path);
+    fwd_remote_free(r);
+}
+
+/* fwd_remote_find
+ * Finds a remote.
+ *
+ * Returns the link to the remote, to the end of the list if there is none,
+ * NULL if transport is invalid.
+ */
+static struct fwd_remote **
+fwd_remote_find(const char *host, const char *transport, int port, int *tcp)
+{
+    struct fwd_remote **iter = NULL;
+
+    *tcp = 0;
+    if(transport && !strcmp(transport, "tcp")) {
+        *tcp = 1;
+    }
+    else if(transport && strcmp(transport, "udp")) {
+        VLOG_ERR("Invalid transport %s for syslog remote %s", transport,
+                 host);
+        return NULL;
+    }
+    for(iter = &remotes; *iter; iter = &(*iter)->next) {
+        if((*iter)->tcp == *tcp && (*iter)->port == port
+           && !strcmp((*iter)->host, host)) {
+            break;
+        }
+    }
+    return iter;
+}
+
+/* fwd_spool_sweep
+ * Removes the spools of the remotes which are not configured anymore,
+ * removed while the daemon was not running for instance.
+ */
+static void
+fwd_spool_sweep(void)
+{
+    char path[PATH_MAX];
+    struct fwd_remote *r = NULL;
+    struct dirent *ent = NULL;
+    size_t len = 0;
+    DIR *dir = NULL;
+
+    dir = opendir(SYSLOG_FWD_DIR);
+    if(dir == NULL) {
+        return;
+    }
+    while((ent = readdir(dir))) {
+        len = strlen(ent->d_name);
+        if(len <= strlen(FWD_SPOOL_EXT)
+           || strcmp(ent->d_name + len - strlen(FWD_SPOOL_EXT),
+                     FWD_SPOOL_EXT)) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "%s/%s", SYSLOG_FWD_DIR, ent->d_name);
+        for(r = remotes; r && strcmp(r->path, path); r = r->next);
+        if(r == NULL) {
+            unlink(path);
+        }
+    }
+    closedir(dir);
+}
+
+/* syslog_forward_init
+ * Opens the journal at the saved cursor, at its end if there is none so
+ * that only the new entries are forwarded.
+ *
+ * Returns the fd to poll for new entries, -1 on failure.
+ */
+int
+syslog_forward_init(void)
+{
+    int ret = 0;
+
+    if(journal) {
+        return journal_fd;
+    }
+    if(mkdir(SYSLOG_FWD_DIR, 0700) && errno != EEXIST) {
+        VLOG_ERR("Failed to create %s: %s", SYSLOG_FWD_DIR, strerror(errno));
+        return -1;
+    }
+    if(gethostname(hostname, sizeof(hostname)) == 0) {
+        hostname[sizeof(hostname) - 1] = '\0';
+        fwd_token(hostname, sizeof(hostname), hostname, strlen(hostname));
+    }
+    ret = sd_journal_open(&journal, SD_JOURNAL_LOCAL_ONLY);
+    if(ret < 0) {
+        VLOG_ERR("Failed to open the journal: %s", strerror(-ret));
+        journal = NULL;
+        return -1;
+    }
+    if(fwd_cursor_load(saved_cursor, sizeof(saved_cursor)) == 0
+       && sd_journal_seek_cursor(journal, saved_cursor) >= 0) {
+        resume = 1;
+    }
+    else {
+        sd_journal_seek_tail(journal);
+        sd_journal_previous(journal);
+    }
+    journal_fd = sd_journal_get_fd(journal);
+    if(journal_fd < 0) {
+        VLOG_ERR("Failed to watch the journal: %s", strerror(-journal_fd));
+        sd_journal_close(journal);
+        journal = NULL;
+        return -1;
+    }
+    return journal_fd;
+}
+
+/* syslog_forward_begin
+ * The remotes are about to be set again.
+ */
+void
+syslog_forward_begin(void)
+{
+    struct fwd_remote *r = NULL;
+
+    for(r = remotes; r; r = r->next) {
+        r->keep = 0;
+    }
+}
+
+/* syslog_forward_add
+ * Adds a remote, or keeps it with its spool when it is there already.
+ *
+ * Returns 0 on success, -1 on failure.
+ */
+int
+syslog_forward_add(const char *host, const char *transport, int port,
+                   const char *severity)
+{
+    char name[FWD_HOSTNAME_MAX + 32];
+    struct fwd_remote *r = NULL, **iter = NULL;
+    int tcp = 0, level = FWD_DEFAULT_SEVERITY;
+    char *p = NULL;
+
+    if(host == NULL || *host == '\0' || port <= 0 || port > 65535) {
+        VLOG_ERR("Invalid syslog remote %s:%d", host ? host : "", port);
+        return -1;
+    }
+    if(severity) {
+        for(level = 0; level < 8 && strcmp(fwd_severities[level], severity);
+            level++);
+        if(level == 8) {
+            VLOG_ERR("Invalid severity %s for syslog remote %s", severity,
+                     host);
+            return -1;
+        }
+    }
+    iter = fwd_remote_find(host, transport, port, &tcp);
+    if(iter == NULL) {
+        return -1;
+    }
+    if(*iter) {
+        (*iter)->keep = 1;
+        if((*iter)->severity != level) {
+            VLOG_INFO("Forwarding syslog of severity %s to %s",
+                      fwd_severities[level],
+                      fwd_remote_name(*iter, name, sizeof(name)));
+            (*iter)->severity = level;
+        }
+        return 0;
+    }
+    r = calloc(1, sizeof(*r));
+    if(r == NULL) {
+        return -1;
+    }
+    r->host = strdup(host);
+    r->batch = malloc(FWD_BATCH_SIZE);
+    r->out = malloc(SYSLOG_FWD_BATCH
+                    * (FWD_FRAME_PREFIX_MAX + SYSLOG_FWD_MSG_MAX));
+    r->tcp = tcp;
+    r->port = port;
+    r->severity = level;
+    r->keep = 1;
+    r->sock = -1;
+    r->spool_fd = -1;
+    r->progress_at = fwd_now();
+    snprintf(r->path, sizeof(r->path), "%s/%s_%s_%d%s", SYSLOG_FWD_DIR,
+             tcp ? "tcp" : "udp", host, port, FWD_SPOOL_EXT);
+    for(p = r->path + strlen(SYSLOG_FWD_DIR) + 1; *p; p++) {
+        if(*p == '/') {
+            *p = '_';
+        }
+    }
+    if(r->host == NULL || r->batch == NULL || r->out == NULL
+       || fwd_spool_open(r)) {
+        fwd_remote_free(r);
+        return -1;
+    }
+    /* looked up from now on, the first send does not wait for it */
+    if(fwd_lookup_start(r)) {
+        VLOG_WARN("Failed to look syslog remote %s up, retrying when sending",
+                  fwd_remote_name(r, name, sizeof(name)));
+    }
+    *iter = r;
+    VLOG_INFO("Forwarding syslog of severity %s to %s", fwd_severities[level],
+              fwd_remote_name(r, name, sizeof(name)));
+    return 0;
+}
+
+/* syslog_forward_commit
+ * Removes the remotes which were not added again, their spools are
+ * discarded.
+ */
+void
+syslog_forward_commit(void)
+{
+    struct fwd_remote **iter = &remotes;
+
+    while(*iter) {
+        if((*iter)->keep) {
+            iter = &(*iter)->next;
+        }
+        else {
+            fwd_remote_remove(iter);
+        }
+    }
+    fwd_spool_sweep();
+    configured = 1;
+}
+
+/* syslog_forward_remove
+ * Removes a remote, its spool is discarded.
+ *
+ * Returns 0 on success, -1 if there is no such remote.
+ */
+int
+syslog_forward_remove(const char *host, const char *transport, int port)
+{
+    struct fwd_remote **iter = NULL;
+    int tcp = 0;
+
+    if(host == NULL) {
+        return -1;
+    }
+    iter = fwd_remote_find(host, transport, port, &tcp);
+    if(iter == NULL || *iter == NULL) {
+        return -1;
+    }
+    fwd_remote_remove(iter);
+    return 0;
+}
+
+/* syslog_forward_run
+ * Reads the new journal entries into the spools, nothing is read before
+ * the remotes are committed. Then sends the spools.
+ *
+ * Returns the number of entries read.
+ */
+int
+syslog_forward_run(void)
+{
+    struct fwd_remote *r = NULL;
+    long long now = fwd_now();
+    int count = 0;
+
+    if(journal == NULL || !configured) {
+        return 0;
+    }
+    sd_journal_process(journal);
+    count = fwd_read(now);
+    if(count) {
+        fwd_sync();
+    }
+    for(r = remotes; r; r = r->next) {
+        fwd_send(r, now);
+    }
+    return count;
+}
+
+/* syslog_forward_timeout
+ * Returns the msec until the next run is due, -1 if only new journal
+ * entries need one.
+ */
+int
+syslog_forward_timeout(void)
+{
+    struct fwd_remote *r = NULL;
+    long long now = fwd_now(), wait = -1, t = 0;
+
+    if(journal == NULL || !configured) {
+        return -1;
+    }
+    if(more) {
+        return 0;
+    }
+    for(r = remotes; r; r = r->next) {
+        if(r->frames_sent == r->frames && r->hdr.read_off == r->hdr.write_off) {
+            continue;
+        }
+        t = r->retry_at > now ? r->retry_at - now : SYSLOG_FWD_POLL_INTERVAL;
+        if(wait < 0 || t < wait) {
+            wait = t;
+        }
+    }
+    return wait;
+}
+
+/* syslog_forward_stats
+ * Writes a line per remote.
+ *
+ * Returns the length written, -1 if buf is too small.
+ */
+int
+syslog_forward_stats(char *buf, size_t size)
+{
+    char name[FWD_HOSTNAME_MAX + 32], state[32];
+    struct fwd_remote *r = NULL;
+    long long now = fwd_now();
+    size_t used = 0;
+    int len = 0, resolving = 0;
+
+    if(size == 0) {
+        return -1;
+    }
+    buf[0] = '\0';
+    for(r = remotes; r; r = r->next) {
+        pthread_mutex_lock(&lookup_mutex);
+        resolving = r->lookup && !r->lookup->done;
+        pthread_mutex_unlock(&lookup_mutex);
+        if(r->retry_at > now) {
+            snprintf(state, sizeof(state), "retry in %llds",
+                     (r->retry_at - now + 999) / 1000);
+        }
+        else {
+            snprintf(state, sizeof(state), "%s",
+                     r->state == FWD_READY ? "connected"
+                     : r->state == FWD_CONNECTING ? "connecting"
+                     : resolving ? "resolving" : "idle");
+        }
+        len = snprintf(buf + used, size - used,
+                       "%s %s queued=%llu sent=%llu dropped=%llu %s\n",
+                       fwd_remote_name(r, name, sizeof(name)),
+                       fwd_severities[r->severity],
+                       (unsigned long long) (r->hdr.write_off
+                                             - r->hdr.read_off),
+                       (unsigned long long) r->sent,
+                       (unsigned long long) r->hdr.dropped, state);
+        if(len < 0 || (size_t) len >= size - used) {
+            return -1;
+        }
+        used += len;
+    }
+    return used;
+}
+
+/* syslog_forward_exit
+ * Saves the spools and closes the journal.
+ */
+void
+syslog_forward_exit(void)
+{
+    struct fwd_remote *r = NULL;
+
+    while((r = remotes)) {
+        remotes = r->next;
+        fwd_spool_write_header(r);
+        fwd_remote_free(r);
+    }
+    if(journal) {
+        sd_journal_close(journal);
+        journal = NULL;
+        journal_fd = -1;
+    }
+    configured = 0;
+}
@@ -0,0 +1,118 @@
+#!/usr/bin/env python
+# (C) Copyright 2016 Hewlett Packard Enterprise Development LP
+# All Rights Reserved.
+#
+#    Licensed under the Apache License, Version 2.0 (the "License"); you may
+#    not use this file except in compliance with the License. You may obtain
+#    a copy of the License at
+#
+#         http://www.apache.org/licenses/LICENSE-2.0
+#
+#    Unless required by applicable law or agreed to in writing, software
+#    distributed under the License is distributed on an "AS IS" BASIS, WITHOUT
+#    WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. See the
+#    License for the specific language governing permissions and limitations
+#    under the License.
+#
+# Per event cost of ops_eventlog.log_event(), backed by the supportability
+# library, against the former pure Python implementation kept below. Run on
+# a switch, the events go to the journal:
+#
+#   python eventlog_bench.py --category LLDP --event LLDP_ENABLED
+#   python eventlog_bench.py --category LLDP --event LLDP_NEIGHBOUR_ADD \
+#       --key interface=1
+
+import argparse
+import sys
+import timeit
+
+import yaml
+from systemd import journal
+
+import ops_eventlog
+
+EVENTS_YAML = '/etc/openswitch/supportability/ops_events.yaml'
+
+
+class LegacyEventLog(object):
+    '''
+    ops_eventlog before the library binding: the events of the category
+    parsed from ops_events.yaml, their keys replaced on each event.
+    '''
+
+    def __init__(self, cat):
+        self.content = []
+        with open(EVENTS_YAML, 'r') as f:
+            doc = yaml.safe_load(f)
+        for ev in doc['event_definitions']:
+            if ev['event_category'] == cat:
+                self.content.append({
+                    'event_category': ev['event_category'],
+                    'event_name': ev['event_name'],
+                    'event_ID': ev['event_ID'],
+                    'severity': ev['severity'],
+                    'description': ev['event_description_template'],
+                })
+        if not self.content:
+            raise ValueError("Event category %s not found" % cat)
+        self.daemon_name = str(sys.argv[0]).split("/")[-1]
+
+    def replace_str(self, keys, desc):
+        for j in range(len(keys)):
+            key = "{" + keys[j][0] + "}"
+            desc = desc.replace(str(key), str(keys[j][1]))
+        return desc
+
+    def log_event(self, name, *arg):
+        for i in range(len(self.content)):
+            if name == self.content[i]['event_name']:
+                ev_id = str(self.content[i]['event_ID'])
+                severity = self.content[i]['severity']
+                desc = self.content[i]['description']
+                categ = self.content[i]['event_category']
+                if len(arg):
+                    desc = self.replace_str(arg, desc)
+                break
+        else:
+            return -1
+        mesg = 'ops-evt|' + ev_id + '|' + severity + '|' + desc
+        journal.send(
+            mesg, MESSAGE_ID='50c0fa81c2a545ec982a54293f1b1945',
+            PRIORITY=severity, OPS_EVENT_ID=ev_id,
+            OPS_EVENT_CATEGORY=categ, SYSLOG_IDENTIFIER=self.daemon_name)
+
+
+def usec_per_event(func, args, count, repeat):
+    timer = timeit.Timer(lambda: func(*args))
+    return min(timer.repeat(repeat, count)) * 1000000.0 / count
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description='Per event cost of the Python event log')
+    parser.add_argument('--category', required=True)
+    parser.add_argument('--event', required=True)
+    parser.add_argument('--key', action='append', default=[],
+                        help='key=value of the event, repeated')
+    parser.add_argument('--count', type=int, default=10000,
+                        help='events per run (default: 10000)')
+    parser.add_argument('--repeat', type=int, default=5,
+                        help='runs, the fastest counts (default: 5)')
+    args = parser.parse_args()
+
+    pairs = [tuple(kv.split('=', 1)) for kv in args.key]
+    legacy = LegacyEventLog(args.category)
+    if ops_eventlog.event_log_init(args.category) == ops_eventlog.FAIL:
+        sys.exit("Failed to initialize the event log of %s" % args.category)
+
+    before = usec_per_event(legacy.log_event, [args.event] + pairs,
+                            args.count, args.repeat)
+    after = usec_per_event(ops_eventlog.log_event, [args.event] + pairs,
+                           args.count, args.repeat)
+    print("%-10s %10.2f usec/event" % ("python", before))
+    print("%-10s %10.2f usec/event" % ("library", after))
+    print("%-10s %10.2fx" % ("speedup", before / after))
+
+
+if __name__ == '__main__':
+    main()